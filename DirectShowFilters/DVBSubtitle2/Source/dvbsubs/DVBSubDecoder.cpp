@@ -87,7 +87,8 @@ CDVBSubDecoder::CDVBSubDecoder() :
   m_CurrentSubtitle( NULL ),	
   m_pObserver( NULL ),
   m_ScreenWidth( 720 ), // use PAL resolution as default as PAL streams don't
-  m_ScreenHeight( 576 ) // provide the screen specification information
+  m_ScreenHeight( 576 ), // provide the screen specification information
+  m_ComposedWidth( 0 )
 {
 }
 
@@ -111,29 +112,28 @@ void CDVBSubDecoder::Create_region(int region_id,int region_width,int region_hei
   memset(regions[region_id].img,15,sizeof(regions[region_id].img));
 }
 
-void CDVBSubDecoder::Do_plot( int r,int x, int y, unsigned char pixel ) 
+void CDVBSubDecoder::Plot( int r, int run_length, unsigned char pixel ) 
 {
-  int i;
-  if ( ( y >= 0 ) && ( y < regions[r].height ) ) 
-  {
-    i = ( y * regions[r].width ) + x;
-    regions[r].img[i] = pixel;
-  } 
-  else 
+  int x1 = x;
+  int x2 = x + run_length;
+  x = x2;
+
+  //  LogDebug("DVBsubs: plot: x=%d,y=%d,length=%d,pixel=%d", x1, y, run_length,pixel );
+  if ( ( y < 0 ) || ( y >= regions[r].height ) ) 
   {
-    LogDebug("DVBsubs: plot out of region: x=%d, y=%d - r=%d, height=%d",x,y,r,regions[r].height);
+    LogDebug("DVBsubs: plot out of region: x=%d, y=%d - r=%d, height=%d",x1,y,r,regions[r].height);
+    return;
   }
-}
 
-void CDVBSubDecoder::Plot( int r, int run_length, unsigned char pixel ) 
-{
-  int x2 = x + run_length;
+  // Fill the whole run at once, clipped to the region line and the image buffer
+  int line = y * regions[r].width;
+  if ( x1 < 0 ) x1 = 0;
+  if ( x2 > regions[r].width ) x2 = regions[r].width;
+  if ( line + x2 > (int)sizeof( regions[r].img ) ) x2 = sizeof( regions[r].img ) - line;
 
-  //  LogDebug("DVBsubs: plot: x=%d,y=%d,length=%d,pixel=%d", x, y, run_length,pixel );
-  while ( x < x2 ) 
+  if ( x2 > x1 )
   {
-    Do_plot( r, x , y , pixel );
-    x++;
+    memset( &regions[r].img[line + x1], pixel, x2 - x1 );
   }
 }
 
@@ -292,15 +292,15 @@ void CDVBSubDecoder::Decode_4bit_pixel_code_string( int r, int object_id, int of
   }
 }
 
-void CDVBSubDecoder::Process_pixel_data_sub_block( int r, int o, int ofs, int n ) 
+void CDVBSubDecoder::Process_pixel_data_sub_block( int r, unsigned int object_pos, int ofs, int n ) 
 {
   int data_type;
   int j;
  
   j = i + n;
 
-  x = ( regions[r].object_pos[o] ) >> 16;
-  y = ( ( regions[r].object_pos[o] ) & 0xffff ) + ofs;
+  x = object_pos >> 16;
+  y = ( object_pos & 0xffff ) + ofs;
 //	LogDebug("DVBsubs: process_pixel_data_sub_block: r=%d, x=%d, y=%d, o=%d, ofs=%d, n=%d",r,x,y,o,ofs);
 //	LogDebug("DVBsubs: process_pixel_data: %02x %02x %02x %02x %02x %02x",buf[i],buf[i+1],buf[i+2],buf[i+3],buf[i+4],buf[i+5]);
 
@@ -313,11 +313,11 @@ void CDVBSubDecoder::Process_pixel_data_sub_block( int r, int o, int ofs, int n
       case 0: 
         i++;
       case 0x11: 
-        Decode_4bit_pixel_code_string( r, o, ofs, n-1 );
+        Decode_4bit_pixel_code_string( r, 0, ofs, n-1 );
         break;
       case 0xf0: 
         in_scanline = 0;
-        x = ( regions[r].object_pos[o] ) >> 16;
+        x = object_pos >> 16;
         y += 2;
         break;
       default: 
@@ -407,7 +407,7 @@ void CDVBSubDecoder::Process_region_composition_segment()
     foreground_pixel_code,
     background_pixel_code;
   int j;
-  int o;
+  unsigned int o;
 
   page_id = (buf[i]<<8)|buf[i+1]; i+=2;
   segment_length = (buf[i]<<8)|buf[i+1]; i+=2;
@@ -456,10 +456,8 @@ void CDVBSubDecoder::Process_region_composition_segment()
   regions[region_id].objects_start = i;  
   regions[region_id].objects_end = j;  
 
-  for ( o = 0 ;o < 65536 ; o++ ) 
-  {
-    regions[region_id].object_pos[o]=0xffffffff;
-  }
+  std::vector<region_object_t>& objects = regions[region_id].objects;
+  objects.clear();
 
   while ( i < j ) 
   {
@@ -469,7 +467,20 @@ void CDVBSubDecoder::Process_region_composition_segment()
     object_x = ((buf[i]&0x0f)<<8)|buf[i+1]; i+=2;
     object_y = ((buf[i]&0x0f)<<8)|buf[i+1]; i+=2;
 
-    regions[region_id].object_pos[object_id]=(object_x<<16)|object_y;
+    // A repeated object id moves the object, the last position wins
+    for ( o = 0 ; o < objects.size() ; o++ ) 
+    {
+      if ( objects[o].object_id == object_id ) 
+      {
+        break;
+      }
+    }
+    if ( o == objects.size() ) 
+    {
+      objects.resize( o + 1 );
+      objects[o].object_id = object_id;
+    }
+    objects[o].pos = (object_x<<16)|object_y;
       
     if ((object_type==0x01) || (object_type==0x02)) 
     {
@@ -549,6 +560,7 @@ void CDVBSubDecoder::Process_object_data_segment()
   int j;
   int old_i;
   int r;
+  unsigned int o;
 
   page_id = (buf[i]<<8)|buf[i+1]; i+=2;
   segment_length = (buf[i]<<8)|buf[i+1]; i+=2;
@@ -569,8 +581,17 @@ void CDVBSubDecoder::Process_object_data_segment()
     // If this object is in this region...
     if (regions[r].win >= 0) 
     {
-      //LogDebug("DVBsubs: "testing region %d, object_pos=%08x", r, regions[r].object_pos[object_id] );
-      if (regions[r].object_pos[object_id]!=0xffffffff) 
+      std::vector<region_object_t>& objects = regions[r].objects;
+      for ( o = 0 ; o < objects.size() ; o++ ) 
+      {
+        if ( objects[o].object_id == object_id ) 
+        {
+          break;
+        }
+      }
+
+      //LogDebug("DVBsubs: "testing region %d, object found=%d", r, o < objects.size() );
+      if ( o < objects.size() ) 
       {
         //LogDebug("DVBsubs: "rendering object %d into region %d", object_id, r );
         i=old_i;
@@ -579,8 +600,8 @@ void CDVBSubDecoder::Process_object_data_segment()
         {
           top_field_data_block_length=(buf[i]<<8)|buf[i+1]; i+=2;
           bottom_field_data_block_length=(buf[i]<<8)|buf[i+1]; i+=2;
-          Process_pixel_data_sub_block(r,object_id,0,top_field_data_block_length);
-          Process_pixel_data_sub_block(r,object_id,1,bottom_field_data_block_length);
+          Process_pixel_data_sub_block(r,objects[o].pos,0,top_field_data_block_length);
+          Process_pixel_data_sub_block(r,objects[o].pos,1,bottom_field_data_block_length);
         }
       }
     }
@@ -610,35 +631,83 @@ void CDVBSubDecoder::Process_display_definition_segment()
 void CDVBSubDecoder::Compose_subtitle() 
 {
   int r;
-  int x, y, out_y;
-  int v;
-  int count;
+  int y;
+  unsigned int k;
+  int top, bottom;
+  int lines;
+  RECT rc;
+
+  lines = sizeof( m_Buffer ) / m_ScreenWidth;
+  if ( lines > m_ScreenHeight ) lines = m_ScreenHeight;
+
+  // m_Buffer is kept between pages, only the areas composed for the previous page
+  // need to be cleared. A new screen size invalidates the whole buffer.
+  if ( m_ComposedWidth != m_ScreenWidth ) 
+  {
+    memset( m_Buffer, 0x00, sizeof( m_Buffer ) );
+    m_ComposedRects.clear();
+    m_ComposedWidth = m_ScreenWidth;
+  }
 
-  out_y = 0;  
+  for ( k = 0 ; k < m_ComposedRects.size() ; k++ ) 
+  {
+    rc = m_ComposedRects[k];
+    for ( y = rc.top ; y < rc.bottom ; y++ ) 
+    {
+      memset( &m_Buffer[y*m_ScreenWidth+rc.left], 0x00, rc.right - rc.left );
+    }
+  }
+  m_ComposedRects.clear();
+
+  top = lines;
+  bottom = 0;
 
-  count = 0;
   for ( r = 0; r < MAX_REGIONS ; r++ ) 
   {
-    if (regions[r].win >= 0) 
+    if ( ( regions[r].win < 0 ) || ( !page.regions[r].is_visible ) ) 
     {
-      if (page.regions[r].is_visible) 
+      continue;
+    }
+
+    rc.left = page.regions[r].x;
+    rc.top = page.regions[r].y;
+    rc.right = min( rc.left + regions[r].width, m_ScreenWidth );
+    rc.bottom = min( rc.top + regions[r].height, lines );
+    rc.bottom = min( rc.bottom, rc.top + (int)sizeof( regions[r].img ) / max( regions[r].width, 1 ) );
+
+    if ( ( rc.left >= rc.right ) || ( rc.top >= rc.bottom ) ) 
+    {
+      continue;
+    }
+
+    unsigned char clut_offset = 16 * regions[r].CLUT_id;
+    int w = rc.right - rc.left;
+
+    for ( y = rc.top ; y < rc.bottom ; y++ ) 
+    {
+      const unsigned char* src = &regions[r].img[( y - rc.top ) * regions[r].width];
+      unsigned char* dst = &m_Buffer[y*m_ScreenWidth+rc.left];
+
+      if ( clut_offset == 0 ) 
       {
-        count++;
-        out_y=page.regions[r].y*m_ScreenWidth;
-        for ( y = 0 ; y < regions[r].height ; y++ ) 
+        memcpy( dst, src, w );
+      }
+      else
+      {
+        for ( int x = 0 ; x < w ; x++ ) 
         {
-          for ( x = 0 ; x < regions[r].width ; x++ ) 
-          {
-            v = regions[r].img[(y*regions[r].width)+x];
-            m_Buffer[out_y+x+page.regions[r].x]=v+16*regions[r].CLUT_id;
-          }
-        
-        out_y+=m_ScreenWidth;
+          dst[x] = src[x] + clut_offset;
         }
       }
     }
+
+    m_ComposedRects.push_back( rc );
+    if ( rc.top < top ) top = rc.top;
+    if ( rc.bottom > bottom ) bottom = rc.bottom;
   }
-  m_CurrentSubtitle->RenderBitmap( m_Buffer, colours, trans, 256 );
+
+  m_CurrentSubtitle->RenderBitmap( m_Buffer, colours, trans, 256, top, bottom );
+
   
   m_RenderedSubtitles.resize( m_RenderedSubtitles.size() + 1 );
   m_RenderedSubtitles[m_RenderedSubtitles.size() - 1] = m_CurrentSubtitle;
@@ -656,8 +725,6 @@ int CDVBSubDecoder::ProcessPES( const unsigned char* data, int length, int pid )
 
   m_CurrentSubtitle = new CSubtitle( m_ScreenWidth, m_ScreenHeight );
 
-  memset( m_Buffer, 0x00, sizeof( m_Buffer ) );
-
   int n;
   int vdrmode = 0;
   int page_id;
@@ -942,6 +1009,9 @@ void CDVBSubDecoder::Reset()
   m_ScreenWidth = 720;
   m_ScreenHeight = 576;
 
+  m_ComposedRects.clear();
+  m_ComposedWidth = 0;
+
   i = 0;
 
   nibble_flag = 0;
@@ -49,6 +49,12 @@ typedef struct
   visible_region_t regions[MAX_REGIONS];
 } page_t;
 
+typedef struct 
+{
+  int object_id;
+  unsigned int pos;
+} region_object_t;
+
 typedef struct 
 {
   int width,height;
@@ -56,7 +62,7 @@ typedef struct
   int win;
   int CLUT_id;
   int objects_start,objects_end;
-  unsigned int object_pos[65536];
+  std::vector<region_object_t> objects; // only the objects referenced by the region
   unsigned char img[720*576];
 } region_t;
 
@@ -86,12 +92,11 @@ private:
 
   void Init_data(); 
   void Create_region( int region_id, int region_width, int region_height, int region_depth );
-  void Do_plot( int r,int x, int y, unsigned char pixel );
   void Plot( int r, int run_length, unsigned char pixel );
   unsigned char Next_nibble();
   void Set_clut( int CLUT_id,int CLUT_entry_id,int Y, int Cr, int Cb, int T_value );
   void Decode_4bit_pixel_code_string( int r, int object_id, int ofs, int n );
-  void Process_pixel_data_sub_block( int r, int o, int ofs, int n );
+  void Process_pixel_data_sub_block( int r, unsigned int object_pos, int ofs, int n );
   void Process_page_composition_segment();
   void Process_region_composition_segment();
   void Process_CLUT_definition_segment();
@@ -107,6 +112,10 @@ private:
   int m_ScreenWidth;
   int m_ScreenHeight;
 
+  // Areas of m_Buffer written by the previous composition, m_Buffer is zero elsewhere
+  std::vector<RECT> m_ComposedRects;
+  int m_ComposedWidth;
+
   CSubtitle*	m_CurrentSubtitle;
   MSubdecoderObserver* m_pObserver;
   std::vector<CSubtitle*> m_RenderedSubtitles;
@@ -46,14 +46,17 @@ CSubtitle::CSubtitle( int screenWidth, int screenHeight )
   m_Bitmap.bmPlanes		  = 1;
   m_Bitmap.bmWidthBytes	= screenWidth * 4; // 32 bits per pixel
 
+  m_Bitmap.bmBits	    = NULL;
+
   m_ScreenWidth = screenWidth;
   m_ScreenHeight = screenHeight;
+  m_FirstScanline = -1;
 
   count++;
   //LogDebug("CSubtitle:: CREATE count %d width %d height %d", count, width, height);
 
-  m_Data = new unsigned char[ m_Bitmap.bmHeight * m_Bitmap.bmWidth *4 ];
-  ZeroMemory( m_Data, m_Bitmap.bmHeight * m_Bitmap.bmWidth * 4 );
+  // The bitmap data is allocated by RenderBitmap() for the used scanlines only
+  m_Data = NULL;
 }
 
 //
@@ -70,51 +73,58 @@ CSubtitle::~CSubtitle()
 //
 // RenderBitmap
 //
-int CSubtitle::RenderBitmap( unsigned char* buffer, unsigned char* my_palette, unsigned char* my_trans, int col_count )
+// Converts the scanlines [top, bottom) of the composed 8 bit buffer, trimmed to
+// the scanlines containing non zero pixels, into the 32 bit bitmap.
+//
+int CSubtitle::RenderBitmap( unsigned char* buffer, unsigned char* my_palette, unsigned char* my_trans, int col_count, int top, int bottom )
 {
-  uint8_t colorData( 0 );
-  long position( 0 );
-  m_FirstScanline = -1;
+  int width = m_Bitmap.bmWidth;
+
+  if( top < 0 ) top = 0;
+  if( bottom > m_ScreenHeight ) bottom = m_ScreenHeight;
 
-  for( int i = 0 ; i < m_Bitmap.bmHeight * m_Bitmap.bmWidth; i++ )
+  int first = top, last = bottom;
+
+  while( first < last && !HasPixels( &buffer[first * width], width ) )
   {
-    for( int j = 0 ; j < 3 ; j++ )
-    {
-      if( m_FirstScanline == -1 )
-      {
-        if( buffer[i] > 0 )
-        {
-          m_FirstScanline = i / m_Bitmap.bmWidth;
-          m_Bitmap.bmHeight -= m_FirstScanline;
-        }
-      }
-    }
+    first++;
+  }
+  while( last > first && !HasPixels( &buffer[(last - 1) * width], width ) )
+  {
+    last--;
+  }
+
+  if( first >= last )
+  {
+    // Nothing visible, keep a single (transparent) scanline to have a valid bitmap
+    first = min( top, m_ScreenHeight - 1 );
+    last = first + 1;
   }
 
+  m_FirstScanline = first;
+  m_Bitmap.bmHeight = last - first;
+
+  delete[] m_Data;
+  m_Data = new unsigned char[ m_Bitmap.bmHeight * width * 4 ];
   m_Bitmap.bmBits	= (LPVOID)m_Data;
 
-  for( int i =  m_Bitmap.bmWidth * m_FirstScanline ; i < ( m_Bitmap.bmHeight + m_FirstScanline ) * m_Bitmap.bmWidth; i++ )
+  // Expand the palette once, every pixel is then a single lookup
+  DWORD lut[256];
+  for( int i = 0 ; i < col_count && i < 256 ; i++ )
   {
-    if( i < 0 )
-    {
-      // Could happen when no display definition segment has arrived yet and we have HD subtitles.
-      // Just ignore the optimization then.
-      i = 0; 
-    }
-    
-    colorData = buffer[i];
-    for( int j = 0 ; j < 3 ; j++ )
-    {
-      m_Data[position] = my_palette[colorData * 3 + j];
-      position++;
-
-      // Add alpha channel 
-      if( j == 2 )
-      {      
-        m_Data[position] = my_trans[colorData];
-        position++;
-      }
-    }
+    lut[i] = my_palette[i * 3] | ( my_palette[i * 3 + 1] << 8 ) | ( my_palette[i * 3 + 2] << 16 ) | ( my_trans[i] << 24 );
+  }
+  for( int i = col_count ; i < 256 ; i++ )
+  {
+    lut[i] = 0;
+  }
+
+  DWORD* dst = (DWORD*)m_Data;
+  const unsigned char* src = &buffer[first * width];
+
+  for( int i = 0 ; i < m_Bitmap.bmHeight * width ; i++ )
+  {
+    dst[i] = lut[src[i]];
   }
 /*
   char file_name_tmp[500];
@@ -150,6 +160,22 @@ int CSubtitle::RenderBitmap( unsigned char* buffer, unsigned char* my_palette, u
 }
 
 
+//
+// HasPixels
+//
+bool CSubtitle::HasPixels( const unsigned char* line, int width )
+{
+  for( int i = 0 ; i < width ; i++ )
+  {
+    if( line[i] )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
 //
 // GetBitmap
 //
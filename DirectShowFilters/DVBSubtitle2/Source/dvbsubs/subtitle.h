@@ -38,7 +38,7 @@ public:
   BITMAP m_Bitmap;
   BITMAP* GetBitmap();
 
-  int RenderBitmap( unsigned char* buffer, unsigned char* my_palette, unsigned char* my_trans, int col_count );
+  int RenderBitmap( unsigned char* buffer, unsigned char* my_palette, unsigned char* my_trans, int col_count, int top, int bottom );
   
   int Width();
   int Height();
@@ -54,6 +54,8 @@ public:
 
 private:
 
+  bool HasPixels( const unsigned char* line, int width );
+
   unsigned char* m_Data;
   int m_FirstScanline;
   uint64_t m_PTS;
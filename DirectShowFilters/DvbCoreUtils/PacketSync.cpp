@@ -20,12 +20,22 @@
  */
 #pragma warning(disable : 4995)
 #include <windows.h>
+#include <emmintrin.h>
+#include <intrin.h>
 #include "..\shared\PacketSync.h"
 
+static bool HasSSE2()
+{
+  static const bool fSSE2 = !!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+  return fSSE2;
+}
 
 CPacketSync::CPacketSync(void)
 {
-  m_tempBufferPos=-1;
+  m_iLockPackets=2;
+  m_iUnlockPackets=1;
+  m_iRunCount=0;
+  Reset();
 }
 
 CPacketSync::~CPacketSync(void)
@@ -34,51 +44,168 @@ CPacketSync::~CPacketSync(void)
 
 void CPacketSync::Reset(void)
 {
-  m_tempBufferPos=-1;
+  m_tempBufferPos=0;
+  m_bLocked=false;
+}
+
+void CPacketSync::SetSyncHysteresis(int lockPackets, int unlockPackets)
+{
+  m_iLockPackets=max(2, min(lockPackets, SYNC_MAX_HYSTERESIS));
+  m_iUnlockPackets=max(1, min(unlockPackets, SYNC_MAX_HYSTERESIS));
 }
 
 // Ambass : Now, need to have 2 consecutive TS_PACKET_SYNC to try avoiding bad synchronisation.  
 //          In case of data flow change ( Seek, tv Zap .... ) Reset() should be called first to flush buffer.
 void CPacketSync::OnRawData(byte* pData, int nDataLen)
 {
+  if (nDataLen<=0) return;
   int syncOffset=0;
-  if (m_tempBufferPos > 0 )
+  if (m_tempBufferPos > 0)
   {
-    if (pData[TS_PACKET_LEN - m_tempBufferPos]==TS_PACKET_SYNC)
+    // parse the positions in the left over bytes with enough of the new data behind them
+    int carry=m_tempBufferPos;
+    int copy=min(nDataLen, (SYNC_MAX_HYSTERESIS+1)*TS_PACKET_LEN);
+    memcpy(&m_tempBuffer[carry], pData, copy);
+    int pos=Parse(m_tempBuffer, 0, carry+copy, carry);
+    if (pos < carry)
     {
-      syncOffset = TS_PACKET_LEN - m_tempBufferPos;
-      if (syncOffset) memcpy(&m_tempBuffer[m_tempBufferPos], pData, syncOffset);
-      OnTsPacket(m_tempBuffer);
+      // still not enough data to decide
+      m_tempBufferPos=carry+copy-pos;
+      memmove(m_tempBuffer, &m_tempBuffer[pos], m_tempBufferPos);
+      return;
     }
-    m_tempBufferPos = 0;
+    syncOffset=pos-carry;
   }
 
-  while (syncOffset + TS_PACKET_LEN < nDataLen)
+  syncOffset=Parse(pData, syncOffset, nDataLen, nDataLen);
+  m_tempBufferPos=nDataLen-syncOffset;
+  if (m_tempBufferPos > 0) memcpy(m_tempBuffer, &pData[syncOffset], m_tempBufferPos);
+}
+
+// Handles the packets starting before limit, returns the position to continue at.
+// Stops early at the end of the data if the decision needs bytes behind it.
+int CPacketSync::Parse(byte* pData, int pos, int nDataLen, int limit)
+{
+  m_iRunCount=0;
+  while (pos < limit)
   {
-    if ((pData[syncOffset] == TS_PACKET_SYNC) &&
-        (pData[syncOffset + TS_PACKET_LEN]==TS_PACKET_SYNC))
+    if (!m_bLocked)
+    {
+      int end=min(limit, nDataLen-(m_iLockPackets-1)*TS_PACKET_LEN);
+      if (pos >= end) break;
+      pos=FindSync(pData, pos, end);
+      if (pos==end) break;
+      m_bLocked=true;
+    }
+
+    // the sync byte of the next packet confirms the length of this one
+    if (pos+TS_PACKET_LEN >= nDataLen) break;
+    if (pData[pos+TS_PACKET_LEN]==TS_PACKET_SYNC)
+    {
+      Emit(pData, pos);
+      pos+=TS_PACKET_LEN;
+      continue;
+    }
+
+    // tolerate a few broken sync bytes if the packet grid continues behind them
+    int next=0;
+    for (int i=2; i <= m_iUnlockPackets; ++i)
+    {
+      if (pos+i*TS_PACKET_LEN >= nDataLen)
+      {
+        next=-1;
+        break;
+      }
+      if (pData[pos+i*TS_PACKET_LEN]==TS_PACKET_SYNC)
+      {
+        next=pos+i*TS_PACKET_LEN;
+        break;
+      }
+    }
+    if (next < 0) break;
+    if (next > 0)
     {
-      OnTsPacket( &pData[syncOffset] );
-      syncOffset += TS_PACKET_LEN;
+      // the packets with the broken sync bytes are dropped
+      Emit(pData, pos);
+      pos=next;
     }
     else
-      syncOffset++;
+    {
+      m_bLocked=false;
+      pos++;
+    }
+  }
+  FlushRun(pData);
+  return pos;
+}
+
+// Returns the first position in pos..end-1 with m_iLockPackets sync bytes at packet
+// distance, end if there is none. All sync bytes checked must be before nDataLen,
+// so end must not be beyond nDataLen-(m_iLockPackets-1)*TS_PACKET_LEN.
+int CPacketSync::FindSync(byte* pData, int pos, int end)
+{
+  if (HasSSE2())
+  {
+    // 16 candidates at once
+    const __m128i sync=_mm_set1_epi8(TS_PACKET_SYNC);
+    while (pos+16 <= end)
+    {
+      __m128i match=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&pData[pos]), sync);
+      for (int i=1; i < m_iLockPackets; ++i)
+      {
+        match=_mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&pData[pos+i*TS_PACKET_LEN]), sync));
+      }
+      int mask=_mm_movemask_epi8(match);
+      if (mask!=0)
+      {
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+        return pos+(int)bit;
+      }
+      pos+=16;
+    }
   }
 
-  // Here we have less than 188+1 bytes
-  while (syncOffset < nDataLen)
+  for (; pos < end; ++pos)
   {
-    if (pData[syncOffset] == TS_PACKET_SYNC)
+    int i=0;
+    while (i < m_iLockPackets && pData[pos+i*TS_PACKET_LEN]==TS_PACKET_SYNC)
     {
-      m_tempBufferPos= nDataLen - syncOffset;
-      memcpy( m_tempBuffer, &pData[syncOffset], m_tempBufferPos );
-      return ;
+      i++;
     }
-    else
-      syncOffset++;
+    if (i==m_iLockPackets) return pos;
+  }
+  return end;
+}
+
+void CPacketSync::Emit(byte* pData, int pos)
+{
+  if (m_iRunCount > 0 && m_iRunStart+m_iRunCount*TS_PACKET_LEN==pos)
+  {
+    m_iRunCount++;
+    return;
+  }
+  FlushRun(pData);
+  m_iRunStart=pos;
+  m_iRunCount=1;
+}
+
+void CPacketSync::FlushRun(byte* pData)
+{
+  if (m_iRunCount > 0)
+  {
+    int count=m_iRunCount;
+    m_iRunCount=0;
+    OnTsPackets(&pData[m_iRunStart], count);
   }
+}
 
-  m_tempBufferPos=0 ;
+void CPacketSync::OnTsPackets(byte* tsPackets, int count)
+{
+  for (int i=0; i < count; ++i)
+  {
+    OnTsPacket(&tsPackets[i*TS_PACKET_LEN]);
+  }
 }
 
 void CPacketSync::OnTsPacket(byte* tsPacket)
@@ -79,6 +79,17 @@ void CSectionDecoder::OnTsPacket(byte* tsPacket)
   OnTsPacket(m_header,tsPacket);
 }
 
+void CSectionDecoder::OnTsPacket(const TsPacketView& packet)
+{
+  if (m_pid < 0) return;
+  // packets of other pids are skipped without decoding, unless they are damaged
+  // which drops the section being collected
+  if (packet.Pid != m_pid && !packet.TransportError) return;
+
+  m_header.Decode(packet.Data);
+  OnTsPacket(m_header,packet.Data);
+}
+
 int CSectionDecoder::StartNewSection(byte* tsPacket,int index,int sectionLen)
 {
 	int newstart=-1;
@@ -0,0 +1,586 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include <math.h>
+#include <limits.h>
+#include <emmintrin.h>
+#include "AudioKernels.h"
+
+// The SSE2 and C versions only match bit for bit when the C code also uses SSE2
+// floating point math (x64, or /arch:SSE2 for x86). The SSE2 versions round to
+// integers with cvtps2dq/cvtpd2dq (round to nearest even), the C versions do the
+// same rounding without SSE2 instructions.
+// Full scale is 2^(bits-1) in both directions, +1.0 ends up as the largest
+// positive sample.
+
+namespace AudioKernels
+{
+
+static const float k16 = 32768.0f;
+static const float k24 = 8388608.0f;
+static const double k32 = 2147483648.0;
+
+static const float k16max = 32767.0f;
+static const float k24max = 8388607.0f;
+static const double k32max = 2147483647.0;
+
+static const float k16inv = 1.0f / 32768.0f;
+static const float k24inv = 1.0f / 8388608.0f;
+static const float k32inv = 1.0f / 2147483648.0f;
+
+static bool HasSSE2()
+{
+	static const bool fSSE2 = !!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	return fSSE2;
+}
+
+static __forceinline float Clip(float s)
+{
+	if(s < -1.0f) s = -1.0f;
+	if(s > 1.0f) s = 1.0f;
+	return s;
+}
+
+static __forceinline float Scale(float s, float scale, float smax)
+{
+	s *= scale;
+	return s > smax ? smax : s;
+}
+
+static __forceinline double Scale(double s, double scale, double smax)
+{
+	s *= scale;
+	return s > smax ? smax : s;
+}
+
+static __forceinline int Round(double s)
+{
+	// to nearest, halves to even; every float and 32 bit sample is exact in double
+	double f = floor(s);
+	double d = s - f;
+	if(d > 0.5 || d == 0.5 && fmod(f, 2) != 0) f += 1;
+	return (int)f;
+}
+
+static __forceinline int Read24(const BYTE* p)
+{
+	return (int)((p[0] << 8) | (p[1] << 16) | (p[2] << 24)) >> 8;
+}
+
+static __forceinline void Write24(BYTE* p, int v)
+{
+	p[0] = (BYTE)v;
+	p[1] = (BYTE)(v >> 8);
+	p[2] = (BYTE)(v >> 16);
+}
+
+SampleFormat GetSampleFormat(bool fPCM, bool fFloat, int bitsPerSample)
+{
+	if(fPCM && bitsPerSample == 16) return SF_PCM16;
+	if(fPCM && bitsPerSample == 24) return SF_PCM24;
+	if(fPCM && bitsPerSample == 32) return SF_PCM32;
+	if(fFloat && bitsPerSample == 32) return SF_FLOAT;
+	return SF_NONE;
+}
+
+int GetBytesPerSample(SampleFormat fmt)
+{
+	switch(fmt)
+	{
+	case SF_PCM16: return 2;
+	case SF_PCM24: return 3;
+	case SF_PCM32: return 4;
+	case SF_FLOAT: return 4;
+	}
+	return 0;
+}
+
+//
+// C versions
+//
+
+void Reference::ToFloat(SampleFormat fmt, const BYTE* src, float* dst, int count)
+{
+	int i;
+
+	switch(fmt)
+	{
+	case SF_PCM16:
+		for(i = 0; i < count; i++) dst[i] = (float)((const short*)src)[i] * k16inv;
+		break;
+	case SF_PCM24:
+		for(i = 0; i < count; i++) dst[i] = (float)Read24(&src[i*3]) * k24inv;
+		break;
+	case SF_PCM32:
+		for(i = 0; i < count; i++) dst[i] = (float)((const int*)src)[i] * k32inv;
+		break;
+	case SF_FLOAT:
+		memcpy(dst, src, count*sizeof(float));
+		break;
+	}
+}
+
+void Reference::FromFloat(SampleFormat fmt, const float* src, BYTE* dst, int count)
+{
+	int i;
+
+	switch(fmt)
+	{
+	case SF_PCM16:
+		for(i = 0; i < count; i++) ((short*)dst)[i] = (short)Round(Scale(Clip(src[i]), k16, k16max));
+		break;
+	case SF_PCM24:
+		for(i = 0; i < count; i++) Write24(&dst[i*3], Round(Scale(Clip(src[i]), k24, k24max)));
+		break;
+	case SF_PCM32:
+		for(i = 0; i < count; i++) ((int*)dst)[i] = Round(Scale((double)Clip(src[i]), k32, k32max));
+		break;
+	case SF_FLOAT:
+		for(i = 0; i < count; i++) ((float*)dst)[i] = Clip(src[i]);
+		break;
+	}
+}
+
+void Reference::Mix(const float* src, int inChannels, float* dst, int outChannels, const float* matrix, int frames)
+{
+	for(int f = 0; f < frames; f++, src += inChannels, dst += outChannels)
+	{
+		for(int o = 0; o < outChannels; o++)
+		{
+			const float* m = &matrix[o*inChannels];
+			float sum = 0;
+
+			for(int i = 0; i < inChannels; i++)
+			{
+				if(m[i] != 0)
+				{
+					float t = m[i] * src[i];
+					sum = sum + t;
+				}
+			}
+
+			dst[o] = sum;
+		}
+	}
+}
+
+float Reference::GetPeak(const float* src, int count)
+{
+	float peak = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		float s = fabs(src[i]);
+		if(peak < s) peak = s;
+	}
+
+	return peak > 1.0f ? 1.0f : peak;
+}
+
+void Reference::ApplyGain(float* buff, int count, float gain)
+{
+	for(int i = 0; i < count; i++)
+	{
+		buff[i] = Clip(buff[i] * gain);
+	}
+}
+
+//
+// SSE2 versions, the tails are handled by the C versions
+//
+
+void ToFloat(SampleFormat fmt, const BYTE* src, float* dst, int count)
+{
+	if(!HasSSE2())
+	{
+		Reference::ToFloat(fmt, src, dst, count);
+		return;
+	}
+
+	int i = 0;
+
+	switch(fmt)
+	{
+	case SF_PCM16:
+		{
+			const __m128 scale = _mm_set1_ps(k16inv);
+
+			for(; i + 8 <= count; i += 8)
+			{
+				__m128i s = _mm_loadu_si128((const __m128i*)&src[i*2]);
+				__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+				__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+				_mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+				_mm_storeu_ps(&dst[i+4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+			}
+		}
+		break;
+	case SF_PCM24:
+		{
+			const __m128 scale = _mm_set1_ps(k24inv);
+
+			for(; i + 4 <= count; i += 4)
+			{
+				const BYTE* p = &src[i*3];
+				__m128i s = _mm_set_epi32(Read24(p+9), Read24(p+6), Read24(p+3), Read24(p));
+				_mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+			}
+		}
+		break;
+	case SF_PCM32:
+		{
+			const __m128 scale = _mm_set1_ps(k32inv);
+
+			for(; i + 4 <= count; i += 4)
+			{
+				__m128i s = _mm_loadu_si128((const __m128i*)&src[i*4]);
+				_mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+			}
+		}
+		break;
+	}
+
+	Reference::ToFloat(fmt, &src[i*GetBytesPerSample(fmt)], &dst[i], count - i);
+}
+
+void FromFloat(SampleFormat fmt, const float* src, BYTE* dst, int count)
+{
+	if(!HasSSE2())
+	{
+		Reference::FromFloat(fmt, src, dst, count);
+		return;
+	}
+
+	const __m128 vmin = _mm_set1_ps(-1.0f);
+	const __m128 vmax = _mm_set1_ps(1.0f);
+
+	int i = 0;
+
+	switch(fmt)
+	{
+	case SF_PCM16:
+		{
+			const __m128 scale = _mm_set1_ps(k16);
+			const __m128 smax = _mm_set1_ps(k16max);
+
+			for(; i + 8 <= count; i += 8)
+			{
+				__m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i]), vmin), vmax);
+				__m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i+4]), vmin), vmax);
+				lo = _mm_min_ps(_mm_mul_ps(lo, scale), smax);
+				hi = _mm_min_ps(_mm_mul_ps(hi, scale), smax);
+				__m128i s = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+				_mm_storeu_si128((__m128i*)&dst[i*2], s);
+			}
+		}
+		break;
+	case SF_PCM24:
+		{
+			const __m128 scale = _mm_set1_ps(k24);
+			const __m128 smax = _mm_set1_ps(k24max);
+			__declspec(align(16)) int v[4];
+
+			for(; i + 4 <= count; i += 4)
+			{
+				__m128 s = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i]), vmin), vmax);
+				_mm_store_si128((__m128i*)v, _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(s, scale), smax)));
+
+				BYTE* p = &dst[i*3];
+				Write24(p, v[0]);
+				Write24(p+3, v[1]);
+				Write24(p+6, v[2]);
+				Write24(p+9, v[3]);
+			}
+		}
+		break;
+	case SF_PCM32:
+		{
+			const __m128d scale = _mm_set1_pd(k32);
+			const __m128d smax = _mm_set1_pd(k32max);
+
+			for(; i + 4 <= count; i += 4)
+			{
+				__m128 s = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i]), vmin), vmax);
+				__m128i lo = _mm_cvtpd_epi32(_mm_min_pd(_mm_mul_pd(_mm_cvtps_pd(s), scale), smax));
+				__m128i hi = _mm_cvtpd_epi32(_mm_min_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(s, s)), scale), smax));
+				_mm_storeu_si128((__m128i*)&dst[i*4], _mm_unpacklo_epi64(lo, hi));
+			}
+		}
+		break;
+	case SF_FLOAT:
+		for(; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps((float*)&dst[i*4], _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i]), vmin), vmax));
+		}
+		break;
+	}
+
+	Reference::FromFloat(fmt, &src[i], &dst[i*GetBytesPerSample(fmt)], count - i);
+}
+
+void Mix(const float* src, int inChannels, float* dst, int outChannels, const float* matrix, int frames)
+{
+	if(!HasSSE2())
+	{
+		Reference::Mix(src, inChannels, dst, outChannels, matrix, frames);
+		return;
+	}
+
+	// Four frames at a time, every lane adds the terms in the same order as the C version
+	int f = 0;
+	int step = inChannels*4;
+
+	for(; f + 4 <= frames; f += 4, src += step, dst += outChannels*4)
+	{
+		for(int o = 0; o < outChannels; o++)
+		{
+			const float* m = &matrix[o*inChannels];
+			__m128 sum = _mm_setzero_ps();
+
+			for(int i = 0; i < inChannels; i++)
+			{
+				if(m[i] != 0)
+				{
+					__m128 s = _mm_set_ps(src[i+inChannels*3], src[i+inChannels*2], src[i+inChannels], src[i]);
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[i]), s));
+				}
+			}
+
+			__declspec(align(16)) float v[4];
+			_mm_store_ps(v, sum);
+			dst[o] = v[0];
+			dst[o+outChannels] = v[1];
+			dst[o+outChannels*2] = v[2];
+			dst[o+outChannels*3] = v[3];
+		}
+	}
+
+	Reference::Mix(src, inChannels, dst, outChannels, matrix, frames - f);
+}
+
+void MaskMatrix(const DWORD* masks, int inChannels, int outChannels, float* matrix)
+{
+	for(int o = 0; o < outChannels; o++)
+	{
+		for(int i = 0; i < inChannels; i++)
+		{
+			matrix[o*inChannels+i] = (i < MAX_CHANNELS && (masks[o] & (1<<i))) ? 1.0f : 0.0f;
+		}
+	}
+}
+
+bool StereoDownmixMatrix(int inChannels, float* matrix)
+{
+	// ITU-R BS.775 coefficients, channel order FL FR FC LFE BL BR (SL SR), LFE dropped
+	static const float c = 0.7071068f;
+	static const float m51[2*6] =
+	{
+		1, 0, c, 0, c, 0,
+		0, 1, c, 0, 0, c
+	};
+	static const float m71[2*8] =
+	{
+		1, 0, c, 0, c, 0, c, 0,
+		0, 1, c, 0, 0, c, 0, c
+	};
+
+	if(inChannels == 6)
+	{
+		memcpy(matrix, m51, sizeof(m51));
+		return true;
+	}
+	if(inChannels == 8)
+	{
+		memcpy(matrix, m71, sizeof(m71));
+		return true;
+	}
+	return false;
+}
+
+bool IsStereoDownmix(const DWORD* masks, int inChannels)
+{
+	float matrix[2*8];
+	if(!StereoDownmixMatrix(inChannels, matrix)) return false;
+
+	for(int o = 0; o < 2; o++)
+	{
+		for(int i = 0; i < inChannels; i++)
+		{
+			// LFE may be routed or not, it is dropped either way
+			if(i != 3 && (matrix[o*inChannels+i] != 0) != ((masks[o] & (1<<i)) != 0))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+template<class T, class S>
+static void MaskMix(const T* src, int inChannels, T* dst, int outChannels, const DWORD* masks, int frames, S smin, S smax)
+{
+	// the input channels of every output channel, looked up once per call
+	int inputs[MAX_CHANNELS][MAX_CHANNELS];
+	int counts[MAX_CHANNELS];
+
+	for(int o = 0; o < outChannels; o++)
+	{
+		counts[o] = 0;
+
+		for(int i = 0; i < inChannels && i < MAX_CHANNELS; i++)
+		{
+			if(masks[o] & (1<<i)) inputs[o][counts[o]++] = i;
+		}
+	}
+
+	for(int f = 0; f < frames; f++, src += inChannels, dst += outChannels)
+	{
+		for(int o = 0; o < outChannels; o++)
+		{
+			const int* in = inputs[o];
+
+			switch(counts[o])
+			{
+			case 0:
+				dst[o] = 0;
+				break;
+			case 1:
+				dst[o] = src[in[0]];
+				break;
+			default:
+				{
+					S sum = 0;
+					for(int k = 0; k < counts[o]; k++) sum += src[in[k]];
+					if(sum < smin) sum = smin;
+					if(sum > smax) sum = smax;
+					dst[o] = (T)sum;
+				}
+				break;
+			}
+		}
+	}
+}
+
+void MaskMixPCM16(const short* src, int inChannels, short* dst, int outChannels, const DWORD* masks, int frames)
+{
+	MaskMix<short, int>(src, inChannels, dst, outChannels, masks, frames, SHRT_MIN, SHRT_MAX);
+}
+
+void MaskMixPCM32(const int* src, int inChannels, int* dst, int outChannels, const DWORD* masks, int frames)
+{
+	MaskMix<int, __int64>(src, inChannels, dst, outChannels, masks, frames, INT_MIN, INT_MAX);
+}
+
+float GetPeak(const float* src, int count)
+{
+	if(!HasSSE2())
+	{
+		return Reference::GetPeak(src, count);
+	}
+
+	const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 peak = _mm_setzero_ps();
+
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+	{
+		peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(&src[i]), absmask));
+	}
+
+	peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+	peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+
+	float p = _mm_cvtss_f32(peak);
+	float t = Reference::GetPeak(&src[i], count - i);
+
+	p = p < t ? t : p;
+	return p > 1.0f ? 1.0f : p;
+}
+
+//
+// 32 bit PCM in double, float would drop its low 8 bits
+//
+
+void ToDouble(const int* src, double* dst, int count)
+{
+	for(int i = 0; i < count; i++) dst[i] = (double)src[i] * (1.0 / k32);
+}
+
+void FromDouble(const double* src, int* dst, int count)
+{
+	for(int i = 0; i < count; i++)
+	{
+		double s = src[i];
+		if(s < -1.0) s = -1.0;
+		if(s > 1.0) s = 1.0;
+		dst[i] = Round(Scale(s, k32, k32max));
+	}
+}
+
+double GetPeak(const double* src, int count)
+{
+	double peak = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		double s = fabs(src[i]);
+		if(peak < s) peak = s;
+	}
+
+	return peak > 1.0 ? 1.0 : peak;
+}
+
+void ApplyGain(double* buff, int count, double gain)
+{
+	for(int i = 0; i < count; i++)
+	{
+		double s = buff[i] * gain;
+		if(s < -1.0) s = -1.0;
+		if(s > 1.0) s = 1.0;
+		buff[i] = s;
+	}
+}
+
+void ApplyGain(float* buff, int count, float gain)
+{
+	if(!HasSSE2())
+	{
+		Reference::ApplyGain(buff, count, gain);
+		return;
+	}
+
+	const __m128 vmin = _mm_set1_ps(-1.0f);
+	const __m128 vmax = _mm_set1_ps(1.0f);
+	const __m128 vgain = _mm_set1_ps(gain);
+
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 s = _mm_mul_ps(_mm_loadu_ps(&buff[i]), vgain);
+		_mm_storeu_ps(&buff[i], _mm_min_ps(_mm_max_ps(s, vmin), vmax));
+	}
+
+	Reference::ApplyGain(&buff[i], count - i, gain);
+}
+
+}
@@ -0,0 +1,89 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+// Sample conversion and mixing kernels used by CAudioSwitcherFilter::Transform.
+//
+// All processing is done on interleaved float samples in the [-1, 1] range. Every
+// float kernel has a plain C version and an SSE2 version selected at runtime, both
+// give bit identical results. Integer PCM is scaled by 2^(bits-1) both ways, so a
+// sample converted to float and back is unchanged.
+
+namespace AudioKernels
+{
+	enum SampleFormat
+	{
+		SF_NONE,
+		SF_PCM16,
+		SF_PCM24,
+		SF_PCM32,
+		SF_FLOAT
+	};
+
+	enum { MAX_CHANNELS = 18 };
+
+	SampleFormat GetSampleFormat(bool fPCM, bool fFloat, int bitsPerSample);
+	int GetBytesPerSample(SampleFormat fmt);
+
+	// src/dst hold count samples of the given format
+	void ToFloat(SampleFormat fmt, const BYTE* src, float* dst, int count);
+	void FromFloat(SampleFormat fmt, const float* src, BYTE* dst, int count);
+
+	// dst[o] = sum(matrix[o*inChannels+i] * src[i]) for every frame, results are not clipped
+	void Mix(const float* src, int inChannels, float* dst, int outChannels, const float* matrix, int frames);
+
+	// Builds a 0/1 matrix summing the input channels selected by each output channel mask
+	void MaskMatrix(const DWORD* masks, int inChannels, int outChannels, float* matrix);
+	// 5.1 (6 channels) and 7.1 (8 channels) to stereo matrix, false for other layouts
+	bool StereoDownmixMatrix(int inChannels, float* matrix);
+	// true when the two output masks fold 5.1 or 7.1 into the channels StereoDownmixMatrix
+	// weights, so the matrix can replace the plain sums
+	bool IsStereoDownmix(const DWORD* masks, int inChannels);
+
+	// Channel mapping for 16 and 32 bit PCM without going through float: every output
+	// channel is the saturated sum of the input channels selected by its mask, a plain
+	// shuffle copies the samples unchanged
+	void MaskMixPCM16(const short* src, int inChannels, short* dst, int outChannels, const DWORD* masks, int frames);
+	void MaskMixPCM32(const int* src, int inChannels, int* dst, int outChannels, const DWORD* masks, int frames);
+
+	// Largest absolute sample value, clipped to 1
+	float GetPeak(const float* src, int count);
+	// Multiplies by gain and clips to [-1, 1]
+	void ApplyGain(float* buff, int count, float gain);
+
+	// Normalize/boost for 32 bit PCM, which float can not hold without losing its low
+	// bits. Plain C only, the same scaling and rounding as ToFloat/FromFloat
+	void ToDouble(const int* src, double* dst, int count);
+	void FromDouble(const double* src, int* dst, int count);
+	double GetPeak(const double* src, int count);
+	void ApplyGain(double* buff, int count, double gain);
+
+	// Plain C versions, always available to compare the SSE2 versions against
+	namespace Reference
+	{
+		void ToFloat(SampleFormat fmt, const BYTE* src, float* dst, int count);
+		void FromFloat(SampleFormat fmt, const float* src, BYTE* dst, int count);
+		void Mix(const float* src, int inChannels, float* dst, int outChannels, const float* matrix, int frames);
+		float GetPeak(const float* src, int count);
+		void ApplyGain(float* buff, int count, float gain);
+	}
+}
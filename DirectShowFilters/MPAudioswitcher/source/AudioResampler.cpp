@@ -0,0 +1,416 @@
+/*
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include <math.h>
+#include <malloc.h>
+#include <emmintrin.h>
+#include "AudioResampler.h"
+
+// Kaiser window designed for 80 dB stopband attenuation. The passband ends at 90%
+// of the output nyquist and the stopband starts at 105%, the little aliasing in
+// between folds back above 20 kHz for 44.1 kHz output.
+
+static const double PI = 3.14159265358979323846;
+static const double ATTENUATION = 80.0;
+static const double KAISER_BETA = 0.1102 * (ATTENUATION - 8.7);
+static const double PASSBAND = 0.90;
+static const double STOPBAND = 1.05;
+
+static double BesselI0(double x)
+{
+	double sum = 1, term = 1;
+	x = x*x/4;
+
+	for(int k = 1; k < 50 && term > sum*1e-12; k++)
+	{
+		term *= x / ((double)k*k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+static long Gcd(long a, long b)
+{
+	while(b) {long t = a % b; a = b; b = t;}
+	return a;
+}
+
+AudioPolyphaseResampler::AudioPolyphaseResampler(int channels, long org_rate, long new_rate)
+	: m_channels(channels)
+	, m_bank(NULL)
+	, m_coef(NULL)
+	, m_buff(NULL)
+	, m_frames(0)
+	, m_maxframes(0)
+{
+	m_fSSE2 = !!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+
+	long g = Gcd(org_rate, new_rate);
+	long up = new_rate / g, down = org_rate / g;
+
+	if(up <= MAX_EXACT_PHASES)
+	{
+		m_phases = up * ((MIN_PHASES + up - 1) / up);
+		m_nominalStep = ((__int64)down * (m_phases / up)) << SUBPHASE_BITS;
+	}
+	else
+	{
+		m_phases = DEFAULT_PHASES;
+		m_nominalStep = (__int64)((double)org_rate / new_rate * ((__int64)m_phases << SUBPHASE_BITS) + 0.5);
+	}
+
+	m_step = m_nominalStep;
+
+	// bandwidth relative to the input nyquist, transition width from the usual kaiser estimate
+
+	double ratio = min(1.0, (double)new_rate / org_rate);
+	double transition = ratio * 0.5 * (STOPBAND - PASSBAND);
+	int taps = (int)ceil((ATTENUATION - 8) / (2.285 * 2 * PI * transition));
+
+	m_taps = (max(taps, 8) + 3) & ~3;
+	m_rowlen = m_channels == 2 ? m_taps*2 : m_taps;
+
+	m_bank = (float*)_aligned_malloc((m_phases+1) * m_rowlen * sizeof(float), 16);
+	m_coef = (float*)_aligned_malloc(m_rowlen * sizeof(float), 16);
+
+	MakeBank(ratio * 0.5 * (PASSBAND + STOPBAND) / 2);
+
+	Reset();
+}
+
+AudioPolyphaseResampler::~AudioPolyphaseResampler()
+{
+	_aligned_free(m_bank);
+	_aligned_free(m_coef);
+	delete [] m_buff;
+}
+
+void AudioPolyphaseResampler::MakeBank(double cutoff)
+{
+	// output at phase p of frame n is centered at n + m_taps/2-1 + p/m_phases
+
+	double half = m_taps / 2;
+	double i0beta = BesselI0(KAISER_BETA);
+
+	double* row = new double[m_taps];
+
+	for(int p = 0; p <= m_phases; p++)
+	{
+		double sum = 0;
+
+		for(int j = 0; j < m_taps; j++)
+		{
+			double x = j - (half - 1) - (double)p / m_phases;
+			double u = x / half;
+			double t = 2 * cutoff * x;
+
+			double s = t == 0 ? 1 : sin(PI * t) / (PI * t);
+			double w = fabs(u) < 1 ? BesselI0(KAISER_BETA * sqrt(1 - u*u)) / i0beta : 0;
+
+			row[j] = 2 * cutoff * s * w;
+			sum += row[j];
+		}
+
+		// unity gain at dc for every phase
+
+		float* dst = m_bank + p * m_rowlen;
+
+		for(int j = 0; j < m_taps; j++)
+		{
+			float h = (float)(row[j] / sum);
+
+			if(m_channels == 2) {dst[j*2] = dst[j*2+1] = h;}
+			else dst[j] = h;
+		}
+	}
+
+	delete [] row;
+}
+
+void AudioPolyphaseResampler::SetRateAdjust(double factor)
+{
+	m_step = (__int64)(m_nominalStep * factor + 0.5);
+}
+
+void AudioPolyphaseResampler::Reset()
+{
+	// prime with half a filter of silence, so the first output is centered on the first input frame
+
+	int frames = m_taps/2 - 1;
+
+	if(m_maxframes < frames)
+	{
+		delete [] m_buff;
+		m_maxframes = m_taps * 2;
+		m_buff = new float[m_maxframes * m_channels];
+	}
+
+	memset(m_buff, 0, frames * m_channels * sizeof(float));
+	m_frames = frames;
+	m_pos = 0;
+}
+
+double AudioPolyphaseResampler::GetDelay() const
+{
+	// the output at m_pos is centered on buffered frame m_pos + m_taps/2-1
+	const __int64 unit = (__int64)m_phases << SUBPHASE_BITS;
+	return (m_frames - (m_taps/2 - 1)) - (double)m_pos / unit;
+}
+
+void AudioPolyphaseResampler::Filter(const float* src, const float* h, float* dst)
+{
+	const int C = m_channels;
+	const int T = m_taps;
+
+	if(m_fSSE2 && C != 3)
+	{
+		if(C <= 2)
+		{
+			// mono and stereo rows match the interleaved input one to one
+
+			__m128 acc0 = _mm_setzero_ps();
+			__m128 acc1 = _mm_setzero_ps();
+
+			int j = 0;
+
+			for(; j + 8 <= m_rowlen; j += 8)
+			{
+				acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&src[j]), _mm_load_ps(&h[j])));
+				acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&src[j+4]), _mm_load_ps(&h[j+4])));
+			}
+
+			if(j < m_rowlen)
+			{
+				acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&src[j]), _mm_load_ps(&h[j])));
+			}
+
+			acc0 = _mm_add_ps(acc0, acc1);
+			acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+
+			if(C == 1)
+			{
+				acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+				_mm_store_ss(dst, acc0);
+			}
+			else
+			{
+				_mm_storel_pi((__m64*)dst, acc0);
+			}
+		}
+		else
+		{
+			// groups of 4 channels, the last group overlaps the previous one
+			// when the channel count is not a multiple of 4
+
+			for(int c = 0; c < C; c += 4)
+			{
+				int offset = min(c, C - 4);
+
+				__m128 acc = _mm_setzero_ps();
+
+				const float* s = src + offset;
+
+				for(int j = 0; j < T; j++, s += C)
+				{
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(s), _mm_set1_ps(h[j])));
+				}
+
+				_mm_storeu_ps(&dst[offset], acc);
+			}
+		}
+
+		return;
+	}
+
+	int stride = m_rowlen / T;
+
+	for(int c = 0; c < C; c++)
+	{
+		float sum = 0;
+
+		for(int j = 0; j < T; j++)
+		{
+			sum += src[j*C + c] * h[j*stride];
+		}
+
+		dst[c] = sum;
+	}
+}
+
+int AudioPolyphaseResampler::Process(const float* src, int frames, float* dst, int maxout)
+{
+	if(frames > 0)
+	{
+		if(m_frames + frames > m_maxframes)
+		{
+			m_maxframes = (m_frames + frames) * 2;
+
+			float* buff = new float[m_maxframes * m_channels];
+			memcpy(buff, m_buff, m_frames * m_channels * sizeof(float));
+			delete [] m_buff;
+			m_buff = buff;
+		}
+
+		memcpy(m_buff + m_frames * m_channels, src, frames * m_channels * sizeof(float));
+		m_frames += frames;
+	}
+
+	const __int64 unit = (__int64)m_phases << SUBPHASE_BITS;
+	const int submask = (1 << SUBPHASE_BITS) - 1;
+
+	int out = 0;
+
+	while(out < maxout)
+	{
+		int n = (int)(m_pos / unit);
+		if(n + m_taps > m_frames) break;
+
+		int r = (int)(m_pos - n * unit);
+
+		const float* h = m_bank + (r >> SUBPHASE_BITS) * m_rowlen;
+
+		if(int w = r & submask)
+		{
+			// between two phases, only happens for odd ratios or after SetRateAdjust
+
+			float f = (float)w / (1 << SUBPHASE_BITS);
+			const float* h1 = h + m_rowlen;
+
+			if(m_fSSE2)
+			{
+				// rows are aligned and a multiple of 4 floats long
+				__m128 vf = _mm_set1_ps(f);
+
+				for(int j = 0; j < m_rowlen; j += 4)
+				{
+					__m128 a = _mm_load_ps(&h[j]);
+					_mm_store_ps(&m_coef[j], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&h1[j]), a), vf)));
+				}
+			}
+			else
+			{
+				for(int j = 0; j < m_rowlen; j++)
+					m_coef[j] = h[j] + (h1[j] - h[j]) * f;
+			}
+
+			h = m_coef;
+		}
+
+		Filter(m_buff + n * m_channels, h, dst + out * m_channels);
+
+		m_pos += m_step;
+		out++;
+	}
+
+	// drop the frames no longer needed by the next output
+
+	int consumed = (int)min(m_pos / unit, (__int64)m_frames);
+
+	if(consumed > 0)
+	{
+		m_frames -= consumed;
+		memmove(m_buff, m_buff + consumed * m_channels, m_frames * m_channels * sizeof(float));
+		m_pos -= consumed * unit;
+	}
+
+	return out;
+}
+
+//
+// AudioClockDrift
+//
+
+// a timestamp further than 200 ms plus the largest drift off the frame count is a
+// gap or a jump, not drift
+static const double MAX_DRIFT = 0.005;
+static const __int64 MAX_JITTER = 2000000;
+
+AudioClockDrift::AudioClockDrift()
+{
+	Reset();
+}
+
+void AudioClockDrift::Reset()
+{
+	m_rate = 0;
+	m_factor = 1;
+	Restart();
+}
+
+void AudioClockDrift::Restart()
+{
+	m_rtStart = -1;
+	m_frames = 0;
+	m_n = m_sx = m_sy = m_sxx = m_sxy = 0;
+}
+
+bool AudioClockDrift::Update(bool fTime, __int64 rtStart, int frames, long rate)
+{
+	bool fChanged = false;
+
+	if(rate != m_rate)
+	{
+		fChanged = m_factor != 1;
+		Reset();
+		m_rate = rate;
+	}
+
+	if(fTime)
+	{
+		__int64 elapsed = rtStart - m_rtStart;
+		double expected = (double)m_frames * 10000000 / rate;
+
+		if(m_rtStart < 0 || elapsed < 0 || fabs(expected - elapsed) > MAX_JITTER + elapsed * MAX_DRIFT)
+		{
+			Restart();
+			m_rtStart = rtStart;
+			elapsed = 0;
+			expected = 0;
+		}
+
+		double x = expected / 10000000, y = (double)elapsed / 10000000;
+
+		m_n += 1;
+		m_sx += x;
+		m_sy += y;
+		m_sxx += x*x;
+		m_sxy += x*y;
+
+		if(elapsed >= MIN_WINDOW)
+		{
+			// the slope is timestamp time per frame time, the factor its inverse
+			double slope = (m_n*m_sxy - m_sx*m_sy) / (m_n*m_sxx - m_sx*m_sx);
+			double factor = min(max(1 / slope, 1 - MAX_DRIFT), 1 + MAX_DRIFT);
+
+			if(fabs(factor - m_factor) > 1e-6)
+			{
+				m_factor = factor;
+				fChanged = true;
+			}
+		}
+	}
+
+	if(m_rtStart >= 0) m_frames += frames;
+
+	return fChanged;
+}
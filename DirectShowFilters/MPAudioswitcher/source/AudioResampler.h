@@ -0,0 +1,111 @@
+/*
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+// Windowed sinc (Kaiser) polyphase resampler working on interleaved float samples.
+//
+// The read position is kept in units of 1/(phases*65536) input frames. When the
+// ratio reduces to a small fraction (44.1 <-> 48 <-> 96 kHz and friends) the number
+// of phases is a multiple of the output rate term, so every output lands exactly on
+// a precomputed phase. Any other ratio, or a ratio changed with SetRateAdjust, uses
+// 256 phases and interpolates linearly between the two nearest ones.
+//
+// Input is buffered between calls, nothing is dropped when the caller's output
+// buffer is full; the remaining frames are produced by the next call.
+
+class AudioPolyphaseResampler
+{
+	enum { SUBPHASE_BITS = 16, MIN_PHASES = 64, MAX_EXACT_PHASES = 1024, DEFAULT_PHASES = 256 };
+
+	int m_channels;
+	int m_taps;			// filter length per phase, multiple of 4
+	int m_phases;
+	int m_rowlen;		// floats per bank row, stereo rows hold every coefficient twice
+
+	float* m_bank;		// (m_phases+1) rows, the last one is phase 0 shifted by one frame
+	float* m_coef;		// interpolated row
+
+	__int64 m_nominalStep;
+	__int64 m_step;
+	__int64 m_pos;		// read position relative to m_buff
+
+	float* m_buff;		// pending interleaved input
+	int m_frames;
+	int m_maxframes;
+
+	bool m_fSSE2;
+
+	void MakeBank(double cutoff);
+	void Filter(const float* src, const float* h, float* dst);
+
+public:
+	AudioPolyphaseResampler(int channels, long org_rate, long new_rate);
+	~AudioPolyphaseResampler();
+
+	// factor > 1 consumes the input faster (fewer output frames), used to
+	// correct small clock drifts without touching the media type
+	void SetRateAdjust(double factor);
+
+	// Drops the buffered input, call on discontinuities
+	void Reset();
+
+	// Input frames from the first output of the next Process call to the first frame
+	// it appends, the filter delay to take off the output timestamps
+	double GetDelay() const;
+
+	// Appends frames of input and writes at most maxout frames, returns the number written
+	int Process(const float* src, int frames, float* dst, int maxout);
+};
+
+// Estimates how far the sample clock of a source drifts from its timestamps: a
+// least squares line through the timestamps against the frames delivered before
+// them, since the last discontinuity, so the jitter of single timestamps averages
+// out. Capture cards with an audio clock of their own are off by a few hundred ppm.
+// The factor is meant for AudioPolyphaseResampler::SetRateAdjust.
+
+class AudioClockDrift
+{
+	enum { MIN_WINDOW = 100000000 };	// 10 s in 100 ns units before the first estimate
+
+	__int64 m_rtStart;		// timestamp of the first frame counted, -1 before it
+	__int64 m_frames;
+	long m_rate;
+	double m_factor;
+
+	// sums for the fit, x is the time of the frames and y the timestamp, in seconds
+	double m_n, m_sx, m_sy, m_sxx, m_sxy;
+
+public:
+	AudioClockDrift();
+
+	// Back to a factor of 1, for a new source
+	void Reset();
+	// Starts measuring again from the next timestamp, keeps the factor
+	void Restart();
+
+	// Counts the frames of a media sample, rtStart is only valid with fTime. Returns
+	// true when the factor changed
+	bool Update(bool fTime, __int64 rtStart, int frames, long rate);
+
+	// > 1 when the source delivers more frames than its timestamps account for
+	double GetFactor() const {return m_factor;}
+};
@@ -29,7 +29,8 @@
 #include <ks.h>
 #include <ksmedia.h>
 #include "AudioSwitcher.h"
-#include "Audio.h"
+#include "AudioKernels.h"
+#include "AudioResampler.h"
 #include "DSUtil.h"
 
 #include <initguid.h>
@@ -251,8 +252,15 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 	int len = pIn->GetActualDataLength() / (bps*wfe->nChannels);
 	int lenout = len * wfeout->nSamplesPerSec / wfe->nSamplesPerSec;
 
-	REFERENCE_TIME rtStart, rtStop;
-	if(SUCCEEDED(pIn->GetTime(&rtStart, &rtStop)))
+	REFERENCE_TIME rtStart = 0, rtStop = 0;
+	bool fTime = SUCCEEDED(pIn->GetTime(&rtStart, &rtStop));
+
+	// the resampler makes up for a source whose sample clock drifts from its timestamps
+	if(pIn->IsDiscontinuity() == S_OK) m_drift.Restart();
+	if(m_drift.Update(fTime, rtStart, len, wfe->nSamplesPerSec) && m_pResampler)
+		m_pResampler->SetRateAdjust(m_drift.GetFactor());
+
+	if(fTime)
 	{
 		rtStart += m_rtAudioTimeShift;
 		rtStop += m_rtAudioTimeShift;
@@ -274,6 +282,8 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 	if(pIn->IsDiscontinuity() == S_OK)
 	{
 		m_sample_max = 0.1f;
+
+		if(m_pResampler) m_pResampler->Reset();
 	}
 
 	WORD tag = wfe->wFormatTag;
@@ -281,6 +291,10 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 	bool fFloat = tag == WAVE_FORMAT_IEEE_FLOAT || tag == WAVE_FORMAT_EXTENSIBLE && wfex->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
 	if(!fPCM && !fFloat) return __super::Transform(pIn, pOut);
 
+	// 16/24/32 bit PCM and 32 bit float go through the kernels, 8 bit PCM and 64 bit
+	// float keep the per sample code below
+	AudioKernels::SampleFormat fmt = AudioKernels::GetSampleFormat(fPCM, fFloat, wfe->wBitsPerSample);
+
 	BYTE* pDataIn = NULL;
 	BYTE* pDataOut = NULL;
 
@@ -294,7 +308,44 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 
 	if(m_fCustomChannelMapping)
 	{
-		if(m_chs[wfe->nChannels-1].GetCount() > 0)
+		DWORD masks[18];
+
+		for(int i = 0; i < wfeout->nChannels && i < m_chs[wfe->nChannels-1].GetCount(); i++)
+			masks[i] = m_chs[wfe->nChannels-1][i].Channel;
+
+		// a 5.1/7.1 fold down to front left/right is weighted like ITU-R BS.775 instead
+		// of summing the channels at full level; 32 bit PCM keeps its integer sums
+		bool fDownmix = m_chs[wfe->nChannels-1].GetCount() == 2 && fmt != AudioKernels::SF_NONE && fmt != AudioKernels::SF_PCM32
+			&& m_chs[wfe->nChannels-1][0].Speaker == SPEAKER_FRONT_LEFT
+			&& m_chs[wfe->nChannels-1][1].Speaker == SPEAKER_FRONT_RIGHT
+			&& AudioKernels::IsStereoDownmix(masks, wfe->nChannels);
+
+		if(m_chs[wfe->nChannels-1].GetCount() > 0 && !fDownmix && (fmt == AudioKernels::SF_PCM16 || fmt == AudioKernels::SF_PCM32))
+		{
+			// float only has 24 bits of precision, 32 bit PCM would lose its low bits
+			if(fmt == AudioKernels::SF_PCM16)
+				AudioKernels::MaskMixPCM16((const short*)pDataIn, wfe->nChannels, (short*)pDataOut, wfeout->nChannels, masks, len);
+			else
+				AudioKernels::MaskMixPCM32((const int*)pDataIn, wfe->nChannels, (int*)pDataOut, wfeout->nChannels, masks, len);
+		}
+		else if(m_chs[wfe->nChannels-1].GetCount() > 0 && fmt != AudioKernels::SF_NONE)
+		{
+			float matrix[18*18];
+
+			if(fDownmix)
+				AudioKernels::StereoDownmixMatrix(wfe->nChannels, matrix);
+			else
+				AudioKernels::MaskMatrix(masks, wfe->nChannels, wfeout->nChannels, matrix);
+
+			m_buffIn.SetCount(len*wfe->nChannels);
+			m_buffOut.SetCount(len*wfeout->nChannels);
+
+			// the sums are clipped when converting back
+			AudioKernels::ToFloat(fmt, pDataIn, m_buffIn.GetData(), len*wfe->nChannels);
+			AudioKernels::Mix(m_buffIn.GetData(), wfe->nChannels, m_buffOut.GetData(), wfeout->nChannels, matrix, len);
+			AudioKernels::FromFloat(fmt, m_buffOut.GetData(), pDataOut, len*wfeout->nChannels);
+		}
+		else if(m_chs[wfe->nChannels-1].GetCount() > 0)
 		{
 			for(int i = 0; i < wfeout->nChannels; i++)
 			{
@@ -367,28 +418,79 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 
 	if(m_fDownSampleTo441
 	&& wfe->nSamplesPerSec > 44100 && wfeout->nSamplesPerSec == 44100 
-	&& wfe->wBitsPerSample <= 16 && fPCM)
+	&& fmt == AudioKernels::SF_PCM16 && m_pResampler)
 	{
-		if(BYTE* buff = new BYTE[len*bps])
-		{
-			for(int ch = 0; ch < wfeout->nChannels; ch++)
-			{
-				memset(buff, 0, len*bps);
+		// the resampler keeps its state between samples, the number of output
+		// frames may differ by one from the nominal lenout
+		int maxout = pOut->GetSize() / (bps*wfeout->nChannels);
 
-				for(int i = 0; i < len; i++)
-					memcpy(buff + i*bps, (char*)pDataOut + (ch + i*wfeout->nChannels)*bps, bps);
+		m_buffIn.SetCount(len*wfeout->nChannels);
+		m_buffOut.SetCount(maxout*wfeout->nChannels);
 
-				m_pResamplers[ch]->Downsample(buff, len, buff, lenout);
+		// the first output frame lies this many input frames before the first new one
+		double delay = m_pResampler->GetDelay();
 
-				for(int i = 0; i < lenout; i++)
-					memcpy((char*)pDataOut + (ch + i*wfeout->nChannels)*bps, buff + i*bps, bps);
-			}
+		AudioKernels::ToFloat(fmt, pDataOut, m_buffIn.GetData(), len*wfeout->nChannels);
+		lenout = m_pResampler->Process(m_buffIn.GetData(), len, m_buffOut.GetData(), maxout);
+		AudioKernels::FromFloat(fmt, m_buffOut.GetData(), pDataOut, lenout*wfeout->nChannels);
 
-			delete [] buff;
+		REFERENCE_TIME rtOutStart, rtOutStop;
+		if(SUCCEEDED(pOut->GetTime(&rtOutStart, &rtOutStop)))
+		{
+			rtOutStart -= (REFERENCE_TIME)(delay * 10000000 / wfe->nSamplesPerSec + 0.5);
+			rtOutStop = rtOutStart + 10000000i64*lenout/wfeout->nSamplesPerSec;
+			pOut->SetTime(&rtOutStart, &rtOutStop);
 		}
 	}
 
-	if(m_fNormalize || m_boost > 1)
+	if((m_fNormalize || m_boost > 1) && fmt != AudioKernels::SF_NONE)
+	{
+		int samples = lenout*wfeout->nChannels;
+		double peak = 0;
+
+		// 32 bit PCM is scaled in double, float would drop its low 8 bits
+		if(fmt == AudioKernels::SF_PCM32)
+		{
+			m_buffDouble.SetCount(samples);
+			AudioKernels::ToDouble((const int*)pDataOut, m_buffDouble.GetData(), samples);
+			if(m_fNormalize) peak = AudioKernels::GetPeak(m_buffDouble.GetData(), samples);
+		}
+		else
+		{
+			m_buffOut.SetCount(samples);
+			AudioKernels::ToFloat(fmt, pDataOut, m_buffOut.GetData(), samples);
+			if(m_fNormalize) peak = AudioKernels::GetPeak(m_buffOut.GetData(), samples);
+		}
+
+		double sample_mul = 1;
+
+		if(m_fNormalize)
+		{
+			if(m_sample_max < peak) m_sample_max = peak;
+
+			sample_mul = 1.0f / m_sample_max;
+
+			if(m_fNormalizeRecover) m_sample_max -= 1.0*rtDur/200000000; // -5%/sec
+			if(m_sample_max < 0.1) m_sample_max = 0.1;
+		}
+
+		if(m_boost > 1)
+		{
+			sample_mul *= (1+log10(m_boost));
+		}
+
+		if(fmt == AudioKernels::SF_PCM32)
+		{
+			AudioKernels::ApplyGain(m_buffDouble.GetData(), samples, sample_mul);
+			AudioKernels::FromDouble(m_buffDouble.GetData(), (int*)pDataOut, samples);
+		}
+		else
+		{
+			AudioKernels::ApplyGain(m_buffOut.GetData(), samples, (float)sample_mul);
+			AudioKernels::FromFloat(fmt, m_buffOut.GetData(), pDataOut, samples);
+		}
+	}
+	else if(m_fNormalize || m_boost > 1)
 	{
 		int samples = lenout*wfeout->nChannels;
 
@@ -439,7 +541,7 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 				else if(fFloat && wfe->wBitsPerSample == 64) ((double*)pDataOut)[i] = clamp<double>(s, -1, +1);
 			}
 
-			delete buff;
+			delete [] buff;
 		}
 	}
 
@@ -498,7 +600,7 @@ CMediaType CAudioSwitcherFilter::CreateNewOutputMediaType(CMediaType mt, long& c
 
 	if(m_fDownSampleTo441)
 	{
-		if(wfeout->nSamplesPerSec > 44100 && wfeout->wBitsPerSample <= 16)
+		if(wfeout->nSamplesPerSec > 44100 && wfeout->wBitsPerSample == 16)
 		{
 			wfeout->nSamplesPerSec = 44100;
 			wfeout->nAvgBytesPerSec = wfeout->nBlockAlign*wfeout->nSamplesPerSec;
@@ -508,6 +610,8 @@ CMediaType CAudioSwitcherFilter::CreateNewOutputMediaType(CMediaType mt, long& c
 	int bps = wfe->wBitsPerSample>>3;
 	int len = cbBuffer / (bps*wfe->nChannels);
 	int lenout = len * wfeout->nSamplesPerSec / wfe->nSamplesPerSec;
+	// room for the drift correction and the frame the resampler may carry over
+	if(wfeout->nSamplesPerSec != wfe->nSamplesPerSec) lenout += lenout/100 + 1;
 	cbBuffer = lenout*bps*wfeout->nChannels;
 
 //	mt.lSampleSize = (ULONG)max(mt.lSampleSize, wfe->nAvgBytesPerSec * rtLen / 10000000i64);
@@ -521,12 +625,11 @@ void CAudioSwitcherFilter::OnNewOutputMediaType(const CMediaType& mtIn, const CM
 	const WAVEFORMATEX* wfe = (WAVEFORMATEX*)mtIn.pbFormat;
 	const WAVEFORMATEX* wfeout = (WAVEFORMATEX*)mtOut.pbFormat;
 
-	m_pResamplers.RemoveAll();
-	for(int i = 0; i < wfeout->nChannels; i++)
+	m_pResampler.Free();
+	if(wfe->nSamplesPerSec != wfeout->nSamplesPerSec)
 	{
-		CAutoPtr<AudioStreamResampler> pResampler;
-		pResampler.Attach(new AudioStreamResampler(wfeout->wBitsPerSample>>3, wfe->nSamplesPerSec, wfeout->nSamplesPerSec, true));
-		m_pResamplers.Add(pResampler);
+		m_pResampler.Attach(new AudioPolyphaseResampler(wfeout->nChannels, wfe->nSamplesPerSec, wfeout->nSamplesPerSec));
+		m_pResampler->SetRateAdjust(m_drift.GetFactor());
 	}
 
 	TRACE(_T("CAudioSwitcherFilter::OnNewOutputMediaType\n"));
@@ -51,7 +51,7 @@ interface IAudioSwitcherFilter : public IUnknown
 	STDMETHOD(SetNormalizeBoost) (bool fNormalize, bool fNormalizeRecover, float boost) = 0;
 };
 
-class AudioStreamResampler;
+class AudioPolyphaseResampler;
 
 [uuid("18C16B08-6497-420e-AD14-22D21C2CEAB7")]
 class CAudioSwitcherFilter : public CStreamSwitcherFilter, public IAudioSwitcherFilter, public IMPAudioSwitcherFilter
@@ -63,13 +63,18 @@ class CAudioSwitcherFilter : public CStreamSwitcherFilter, public IAudioSwitcher
 	DWORD m_pSpeakerToChannelMap[18][18];
 	bool m_fDownSampleTo441;
 	REFERENCE_TIME m_rtAudioTimeShift;
-	CAutoPtrArray<AudioStreamResampler> m_pResamplers;
+	CAutoPtr<AudioPolyphaseResampler> m_pResampler;
+	AudioClockDrift m_drift;
 	double m_sample_max;
 	bool m_fNormalize, m_fNormalizeRecover;
 	float m_boost;
 
 	REFERENCE_TIME m_rtNextStart, m_rtNextStop;
 
+	// float work buffers for the AudioKernels, reused between samples
+	CAtlArray<float> m_buffIn, m_buffOut;
+	CAtlArray<double> m_buffDouble;
+
 public:
 	CAudioSwitcherFilter(LPUNKNOWN lpunk, HRESULT* phr);
 
@@ -25,7 +25,6 @@
 #include <ks.h>
 #include <ksmedia.h>
 #include "AudioSwitcher.h"
-#include "Audio.h"
 #include "DSUtil.h"
 
 #include <initguid.h>
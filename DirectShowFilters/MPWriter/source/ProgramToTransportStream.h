@@ -4,7 +4,7 @@
 #include "BasicUsageEnvironment.hh"
 #include "MPTaskScheduler.h"
 #include "MemoryBuffer.h"
-#include "TSThread.h"
+#include "..\..\shared\TSThread.h"
 #include "MultiWriterFileSink.h"
 #include "MemoryStreamSource.h" 
 #include "AnalogVideoAudioObserver.h"
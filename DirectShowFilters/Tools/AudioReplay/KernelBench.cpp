@@ -0,0 +1,117 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Throughput of the sample kernels of the audio switcher, SSE2 against the C
+// versions, in million samples per second.
+//
+//   kernelbench [seconds per kernel]
+//
+// Every format runs the conversion to float and back, then the 5.1 to stereo
+// downmix, the gain and the 32 bit double path. The buffers are 4096 frames of
+// 5.1, about what one media sample holds.
+
+#include <windows.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "audiokernels.h"
+
+using namespace AudioKernels;
+
+static const int FRAMES = 4096;
+static const int CHANNELS = 6;
+static const int SAMPLES = FRAMES*CHANNELS;
+
+static double s_seconds = 0.5;
+
+template<class F> static double Rate(F kernel)
+{
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start=clock::now();
+  double elapsed=0;
+  long runs=0;
+
+  do
+  {
+    for (int i=0; i < 16; i++) kernel();
+    runs+=16;
+    elapsed=std::chrono::duration<double>(clock::now()-start).count();
+  }
+  while (elapsed < s_seconds);
+
+  return runs*(double)SAMPLES/elapsed/1e6;
+}
+
+static void Report(const char* what, double sse2, double c)
+{
+  printf("%-24s %9.0f %9.0f %6.2fx\n", what, sse2, c, sse2/c);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1) s_seconds=atof(argv[1]);
+
+  std::vector<BYTE> pcm(SAMPLES*4);
+  std::vector<float> f(SAMPLES), out(FRAMES*2);
+  std::vector<double> d(SAMPLES);
+
+  for (int i=0; i < SAMPLES; i++) f[i]=(float)sin(i*0.01)*0.9f;
+
+  printf("%-24s %9s %9s\n", "Msamples/s", "sse2", "c");
+
+  const SampleFormat formats[]={SF_PCM16, SF_PCM24, SF_PCM32, SF_FLOAT};
+  const char* names[]={"16 bit to float", "24 bit to float", "32 bit to float", "float to float"};
+  const char* backNames[]={"float to 16 bit", "float to 24 bit", "float to 32 bit", "float clip"};
+
+  for (int k=0; k < 4; k++)
+  {
+    SampleFormat fmt=formats[k];
+    FromFloat(fmt, &f[0], &pcm[0], SAMPLES);
+
+    Report(names[k],
+      Rate([&] { ToFloat(fmt, &pcm[0], &f[0], SAMPLES); }),
+      Rate([&] { Reference::ToFloat(fmt, &pcm[0], &f[0], SAMPLES); }));
+    Report(backNames[k],
+      Rate([&] { FromFloat(fmt, &f[0], &pcm[0], SAMPLES); }),
+      Rate([&] { Reference::FromFloat(fmt, &f[0], &pcm[0], SAMPLES); }));
+  }
+
+  float matrix[2*CHANNELS];
+  StereoDownmixMatrix(CHANNELS, matrix);
+  Report("5.1 to stereo",
+    Rate([&] { Mix(&f[0], CHANNELS, &out[0], 2, matrix, FRAMES); }),
+    Rate([&] { Reference::Mix(&f[0], CHANNELS, &out[0], 2, matrix, FRAMES); }));
+
+  Report("peak and gain",
+    Rate([&] { ApplyGain(&f[0], SAMPLES, GetPeak(&f[0], SAMPLES) > 0.5f ? 0.999f : 1.001f); }),
+    Rate([&] { Reference::ApplyGain(&f[0], SAMPLES, Reference::GetPeak(&f[0], SAMPLES) > 0.5f ? 0.999f : 1.001f); }));
+
+  // the 32 bit normalize path is plain C only
+  double doubleRate=Rate([&]
+  {
+    ToDouble((const int*)&pcm[0], &d[0], SAMPLES);
+    ApplyGain(&d[0], SAMPLES, GetPeak(&d[0], SAMPLES) > 0.5 ? 0.999 : 1.001);
+    FromDouble(&d[0], (int*)&pcm[0], SAMPLES);
+  });
+  printf("%-24s %9s %9.0f\n", "32 bit gain in double", "-", doubleRate);
+
+  return 0;
+}
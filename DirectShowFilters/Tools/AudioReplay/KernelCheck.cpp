@@ -0,0 +1,261 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Checks the sample kernels of the audio switcher against their C versions and
+// against the precision the filter relies on.
+//
+//   kernelcheck
+//
+// - every 16 bit value, random 24 bit values and 32 bit values with 24 significant
+//   bits come back unchanged from ToFloat/FromFloat, any 32 bit value comes back
+//   unchanged from ToDouble/FromDouble
+// - FromFloat, Mix, GetPeak and ApplyGain give the same bits with SSE2 as the C
+//   versions; the input has values out of range and halves between two steps
+// - the C versions round halves to even like cvtps2dq
+// - the downmix matrices and the saturated integer channel mapping
+//
+// NO_SSE2=1 runs the round trips through the C versions.
+
+#include <windows.h>
+#include <math.h>
+#include <vector>
+#include "audiokernels.h"
+
+using namespace AudioKernels;
+
+static int s_failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("%s  FAILED\n", what);
+    s_failures++;
+  }
+}
+
+static unsigned int s_seed = 20111019;
+
+static unsigned int Random()
+{
+  s_seed=s_seed*1103515245+12345;
+  return s_seed>>8;
+}
+
+static float RandomSample(float range)
+{
+  return ((float)(Random() & 0xffff) / 32768.0f - 1.0f) * range;
+}
+
+static void CheckRoundTrip()
+{
+  // 16 bit, every value
+  std::vector<short> pcm16(65536), back16(65536);
+  std::vector<float> f(65536);
+  for (int i=0; i < 65536; i++) pcm16[i]=(short)(i-32768);
+  ToFloat(SF_PCM16, (const BYTE*)&pcm16[0], &f[0], 65536);
+  FromFloat(SF_PCM16, &f[0], (BYTE*)&back16[0], 65536);
+  Check(pcm16==back16, "16 bit round trip");
+
+  // 24 bit, random values and both ends
+  const int n=1<<20;
+  std::vector<BYTE> pcm24(n*3), back24(n*3);
+  std::vector<float> f24(n);
+  for (int i=0; i < n; i++)
+  {
+    int v=i==0 ? -8388608 : i==1 ? 8388607 : (int)(Random() & 0xffffff)-8388608;
+    pcm24[i*3]=(BYTE)v;
+    pcm24[i*3+1]=(BYTE)(v>>8);
+    pcm24[i*3+2]=(BYTE)(v>>16);
+  }
+  ToFloat(SF_PCM24, &pcm24[0], &f24[0], n);
+  FromFloat(SF_PCM24, &f24[0], &back24[0], n);
+  Check(pcm24==back24, "24 bit round trip");
+
+  // 32 bit through float, 24 significant bits
+  std::vector<int> pcm32(n), back32(n);
+  for (int i=0; i < n; i++) pcm32[i]=(int)((Random() & 0xffffff) << 8);
+  pcm32[0]=INT32_MIN;
+  ToFloat(SF_PCM32, (const BYTE*)&pcm32[0], &f24[0], n);
+  FromFloat(SF_PCM32, &f24[0], (BYTE*)&back32[0], n);
+  Check(pcm32==back32, "32 bit round trip through float");
+
+  // 32 bit through double, any value
+  std::vector<double> d(n);
+  for (int i=0; i < n; i++) pcm32[i]=(int)(Random() ^ (Random() << 24));
+  pcm32[0]=INT32_MIN;
+  pcm32[1]=INT32_MAX;
+  ToDouble(&pcm32[0], &d[0], n);
+  FromDouble(&d[0], &back32[0], n);
+  Check(pcm32==back32, "32 bit round trip through double");
+
+  // and a gain of 1 leaves them alone
+  ApplyGain(&d[0], n, 1.0);
+  FromDouble(&d[0], &back32[0], n);
+  Check(pcm32==back32, "32 bit normalize with a gain of 1");
+}
+
+static void CheckFromFloat()
+{
+  const SampleFormat formats[]={SF_PCM16, SF_PCM24, SF_PCM32, SF_FLOAT};
+  const float steps[]={32768.0f, 8388608.0f, 2147483648.0f, 1.0f};
+  const int n=100003;   // not a multiple of 8, so the C tails run too
+
+  std::vector<float> src(n);
+
+  for (int k=0; k < 4; k++)
+  {
+    for (int i=0; i < n; i++)
+    {
+      switch (i % 4)
+      {
+        case 0:  src[i]=RandomSample(1.5f); break;
+        // a half between two steps
+        case 1:  src[i]=((float)((int)(Random() % 60000)-30000)+0.5f) / steps[k < 2 ? k : 0]; break;
+        case 2:  src[i]=i & 8 ? 1.0f : -1.0f; break;
+        default: src[i]=RandomSample(1.0f); break;
+      }
+    }
+
+    int bytes=n*GetBytesPerSample(formats[k]);
+    std::vector<BYTE> a(bytes), b(bytes);
+    FromFloat(formats[k], &src[0], &a[0], n);
+    Reference::FromFloat(formats[k], &src[0], &b[0], n);
+
+    char what[64];
+    sprintf(what, "FromFloat format %d, SSE2 against C", (int)formats[k]);
+    Check(a==b, what);
+  }
+
+  // halves go to the even step
+  const float halves[]={0.5f/32768, 1.5f/32768, 2.5f/32768, -0.5f/32768, -1.5f/32768, -2.5f/32768, 32766.5f/32768};
+  const short even[]={0, 2, 2, 0, -2, -2, 32766};
+  short out[7];
+  Reference::FromFloat(SF_PCM16, halves, (BYTE*)out, 7);
+  Check(memcmp(out, even, sizeof(out))==0, "C FromFloat rounds halves to even");
+  FromFloat(SF_PCM16, halves, (BYTE*)out, 7);
+  Check(memcmp(out, even, sizeof(out))==0, "FromFloat rounds halves to even");
+}
+
+static void CheckMix()
+{
+  const int frames=4099;
+
+  for (int in=1; in <= 8; in++)
+  {
+    for (int out=1; out <= 8; out++)
+    {
+      std::vector<float> src(frames*in), matrix(in*out), a(frames*out), b(frames*out);
+      for (size_t i=0; i < src.size(); i++) src[i]=RandomSample(1.0f);
+      for (size_t i=0; i < matrix.size(); i++) matrix[i]=Random() % 3==0 ? 0.0f : RandomSample(1.0f);
+
+      Mix(&src[0], in, &a[0], out, &matrix[0], frames);
+      Reference::Mix(&src[0], in, &b[0], out, &matrix[0], frames);
+
+      char what[64];
+      sprintf(what, "Mix %d to %d channels, SSE2 against C", in, out);
+      Check(memcmp(&a[0], &b[0], a.size()*sizeof(float))==0, what);
+    }
+  }
+
+  float matrix[2*8];
+  for (int in=6; in <= 8; in+=2)
+  {
+    Check(StereoDownmixMatrix(in, matrix), "downmix matrix");
+
+    std::vector<float> src(frames*in), a(frames*2), b(frames*2);
+    for (size_t i=0; i < src.size(); i++) src[i]=RandomSample(1.0f);
+    Mix(&src[0], in, &a[0], 2, matrix, frames);
+    Reference::Mix(&src[0], in, &b[0], 2, matrix, frames);
+    Check(memcmp(&a[0], &b[0], a.size()*sizeof(float))==0, "downmix, SSE2 against C");
+
+    // a centre only signal ends up at -3 dB on both sides, LFE is dropped
+    std::vector<float> centre(in, 0.0f);
+    float lr[2];
+    centre[2]=1.0f;
+    centre[3]=1.0f;
+    Reference::Mix(&centre[0], in, lr, 2, matrix, 1);
+    Check(fabs(lr[0]-0.7071068f) < 1e-6f && lr[0]==lr[1], "downmix centre at -3 dB");
+  }
+  Check(!StereoDownmixMatrix(2, matrix) && !StereoDownmixMatrix(7, matrix), "no downmix matrix for other layouts");
+
+  const DWORD itu51[2]={0x15, 0x26}, itu51lfe[2]={0x1d, 0x2e}, itu71[2]={0x55, 0xa6}, front[2]={0x01, 0x02};
+  Check(IsStereoDownmix(itu51, 6) && IsStereoDownmix(itu51lfe, 6) && IsStereoDownmix(itu71, 8), "fold downs are found");
+  Check(!IsStereoDownmix(front, 6) && !IsStereoDownmix(itu51, 8) && !IsStereoDownmix(front, 8), "other mappings are not");
+}
+
+static void CheckMaskMix()
+{
+  // FL+C to left and FR+C to right, then the plain swap
+  const DWORD sums[2]={0x05, 0x06}, swap[2]={0x02, 0x01};
+  const short in16[2*3]={30000, -30000, 10000, 100, -100, 7};
+  short out16[2*2];
+  MaskMixPCM16(in16, 3, out16, 2, sums, 2);
+  Check(out16[0]==32767 && out16[1]==-20000 && out16[2]==107 && out16[3]==-93, "16 bit sums saturate");
+
+  const int in32[2*2]={INT32_MIN, 123456789, -7, INT32_MAX};
+  int out32[2*2];
+  MaskMixPCM32(in32, 2, out32, 2, swap, 2);
+  Check(out32[0]==123456789 && out32[1]==INT32_MIN && out32[2]==INT32_MAX && out32[3]==-7, "32 bit shuffle copies");
+
+  const DWORD both[1]={0x03};
+  MaskMixPCM32(in32, 2, out32, 1, both, 2);
+  Check(out32[0]==INT32_MIN+123456789 && out32[1]==INT32_MAX-7, "32 bit sums");
+  const int loud[2]={INT32_MAX, INT32_MAX};
+  MaskMixPCM32(loud, 2, out32, 1, both, 1);
+  Check(out32[0]==INT32_MAX, "32 bit sums saturate");
+}
+
+static void CheckGain()
+{
+  const int n=10007;
+  std::vector<float> a(n), b;
+  for (int i=0; i < n; i++) a[i]=RandomSample(1.2f);
+  b=a;
+
+  Check(GetPeak(&a[0], n)==Reference::GetPeak(&b[0], n), "GetPeak, SSE2 against C");
+
+  ApplyGain(&a[0], n, 1.7f);
+  Reference::ApplyGain(&b[0], n, 1.7f);
+  Check(memcmp(&a[0], &b[0], n*sizeof(float))==0, "ApplyGain, SSE2 against C");
+
+  std::vector<double> d(n);
+  for (int i=0; i < n; i++) d[i]=RandomSample(1.0f);
+  d[17]=-1.25;
+  Check(GetPeak(&d[0], n)==1.0, "double peak clipped to 1");
+}
+
+int main()
+{
+  CheckRoundTrip();
+  CheckFromFloat();
+  CheckMix();
+  CheckMaskMix();
+  CheckGain();
+
+  if (s_failures > 0)
+  {
+    printf("%d checks FAILED\n", s_failures);
+    return 1;
+  }
+  printf("kernels %s  ok\n", IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? "sse2" : "c");
+  return 0;
+}
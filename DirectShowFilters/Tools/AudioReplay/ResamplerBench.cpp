@@ -0,0 +1,91 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Throughput of AudioPolyphaseResampler, SSE2 against the C dot products, in
+// million input frames per second and as a multiple of real time.
+//
+//   resamplerbench [seconds per case]
+//
+// The input comes in 40 ms media samples like from a DVB audio decoder.
+
+#include <windows.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "audioresampler.h"
+
+static double s_seconds = 0.5;
+
+static double Rate(bool fSSE2, int channels, long inRate, long outRate, double factor)
+{
+  if (fSSE2) unsetenv("NO_SSE2"); else setenv("NO_SSE2", "1", 1);
+  AudioPolyphaseResampler r(channels, inRate, outRate);
+  if (factor != 1) r.SetRateAdjust(factor);
+
+  int frames=inRate/25;
+  std::vector<float> in(frames*channels), out((frames+frames/10)*channels);
+  for (int n=0; n < frames; n++)
+    for (int c=0; c < channels; c++)
+      in[n*channels+c]=(float)(0.5*sin(n*0.05+c));
+
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start=clock::now();
+  double elapsed=0;
+  long runs=0;
+
+  do
+  {
+    for (int i=0; i < 8; i++) r.Process(&in[0], frames, &out[0], frames+frames/10);
+    runs+=8;
+    elapsed=std::chrono::duration<double>(clock::now()-start).count();
+  }
+  while (elapsed < s_seconds);
+
+  return runs*(double)frames/elapsed;
+}
+
+static void Report(int channels, long inRate, long outRate, double factor)
+{
+  double sse2=Rate(true, channels, inRate, outRate, factor);
+  double c=Rate(false, channels, inRate, outRate, factor);
+
+  char what[64];
+  sprintf(what, "%ld -> %ld Hz %d ch%s", inRate, outRate, channels, factor != 1 ? " adjusted" : "");
+  printf("%-30s %8.2f %8.2f %6.2fx %7.0f %7.0f\n", what, sse2/1e6, c/1e6, sse2/c, sse2/inRate, c/inRate);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1) s_seconds=atof(argv[1]);
+
+  printf("%-30s %8s %8s %7s %7s %7s\n", "Mframes/s, x real time", "sse2", "c", "", "sse2", "c");
+
+  Report(1, 48000, 44100, 1);
+  Report(2, 48000, 44100, 1);
+  Report(6, 48000, 44100, 1);
+  Report(8, 48000, 44100, 1);
+  Report(2, 96000, 44100, 1);
+  Report(2, 88200, 44100, 1);
+  Report(2, 48000, 44100, 1.0003);
+  Report(6, 48000, 44100, 1.0003);
+
+  return 0;
+}
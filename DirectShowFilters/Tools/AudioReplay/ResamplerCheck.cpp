@@ -0,0 +1,323 @@
+/* 
+ *	Copyright (C) 2005-2011 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Sine sweeps through AudioPolyphaseResampler and checks of the drift estimate
+// the audio switcher feeds it with.
+//
+//   resamplercheck [-v]
+//
+// - SNR and THD of sines from 100 Hz to 18 kHz for the rates the switcher
+//   downsamples to 44.1 kHz, and 44.1 to 48 kHz, mono, stereo and 5.1, with
+//   random media sample sizes; -v prints every tone
+// - tones between the output nyquist and the stopband edge must be gone
+// - the output timestamps the switcher derives with GetDelay put every output
+//   frame where it belongs, with and without a rate adjustment
+// - AudioClockDrift finds a drift in jittered timestamps, keeps it across gaps
+//   and drops it for a new rate
+//
+// SNR is the fitted sine against everything else in the output, THD the second to
+// fifth harmonic against the fundamental. NO_SSE2=1 runs the C dot products.
+
+#include <windows.h>
+#include <math.h>
+#include <vector>
+#include "audioresampler.h"
+
+static const double PI = 3.14159265358979323846;
+
+static int s_failures = 0;
+static bool s_verbose = false;
+
+static void Check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("%s  FAILED\n", what);
+    s_failures++;
+  }
+}
+
+static unsigned int s_seed = 20111019;
+
+static unsigned int Random()
+{
+  s_seed=s_seed*1103515245+12345;
+  return s_seed>>8;
+}
+
+// runs the input through the resampler in media samples of random size, the way
+// the switcher does, and checks the output timestamps on the way
+static void Resample(AudioPolyphaseResampler& r, const std::vector<float>& in, int channels, long inRate, long outRate,
+                     double factor, std::vector<float>& out, double* maxTimeError)
+{
+  int frames=(int)in.size()/channels;
+  int done=0;
+  *maxTimeError=0;
+  out.clear();
+
+  while (done < frames)
+  {
+    int len=min(frames-done, 256+(int)(Random()%4000));
+    int maxout=len*outRate/inRate+len/50+16;
+    std::vector<float> buff(maxout*channels);
+
+    double start=(double)done/inRate-r.GetDelay()/inRate;
+    int produced=r.Process(&in[done*channels], len, &buff[0], maxout);
+
+    // output frame m is centered on input time m*factor/outRate
+    if (produced > 0)
+    {
+      double expected=(double)(out.size()/channels)*factor/outRate;
+      *maxTimeError=max(*maxTimeError, fabs(start-expected));
+    }
+
+    out.insert(out.end(), buff.begin(), buff.begin()+produced*channels);
+    done+=len;
+  }
+}
+
+// amplitude of the sine at f in channel c, least squares over the frames in [first, last);
+// with fSubtract the fitted sine is taken out of y
+static double Fit(std::vector<float>& y, int channels, int c, double f, int first, int last, bool fSubtract)
+{
+  double ss=0, sc=0, cc=0, ys=0, yc=0;
+  for (int n=first; n < last; n++)
+  {
+    double s=sin(2*PI*f*n), k=cos(2*PI*f*n), v=y[n*channels+c];
+    ss+=s*s; sc+=s*k; cc+=k*k; ys+=v*s; yc+=v*k;
+  }
+  double det=ss*cc-sc*sc;
+  double a=(ys*cc-yc*sc)/det, b=(yc*ss-ys*sc)/det;
+
+  if (fSubtract)
+  {
+    for (int n=first; n < last; n++)
+      y[n*channels+c]-=(float)(a*sin(2*PI*f*n)+b*cos(2*PI*f*n));
+  }
+  return sqrt(a*a+b*b);
+}
+
+static double Power(const std::vector<float>& y, int channels, int c, int first, int last)
+{
+  double p=0;
+  for (int n=first; n < last; n++) p+=(double)y[n*channels+c]*y[n*channels+c];
+  return p/(last-first);
+}
+
+struct Result
+{
+  double snr;
+  double thd;
+  double gain;
+  double timeError;
+};
+
+// f is in Hz; the channels carry the same tone with different phases
+static Result Tone(long inRate, long outRate, int channels, double f, double factor)
+{
+  const double seconds=1.5;
+  int frames=(int)(inRate*seconds);
+  std::vector<float> in(frames*channels), out;
+
+  for (int n=0; n < frames; n++)
+    for (int c=0; c < channels; c++)
+      in[n*channels+c]=(float)(0.5*sin(2*PI*f*n/inRate+c));
+
+  AudioPolyphaseResampler r(channels, inRate, outRate);
+  if (factor != 1) r.SetRateAdjust(factor);
+
+  Result result;
+  Resample(r, in, channels, inRate, outRate, factor, out, &result.timeError);
+
+  // skip the ramp at both ends
+  int outFrames=(int)out.size()/channels;
+  int first=outRate/10, last=outFrames-outRate/10;
+  double fo=f*factor/outRate;
+
+  result.snr=1e9;
+  result.thd=-1e9;
+  result.gain=0;
+
+  for (int c=0; c < channels; c++)
+  {
+    // the harmonics are fitted to what is left without the fundamental
+    double a=Fit(out, channels, c, fo, first, last, true);
+    double noise=Power(out, channels, c, first, last);
+    double harmonics=0;
+    for (int h=2; h <= 5 && h*fo < 0.5; h++)
+    {
+      double ah=Fit(out, channels, c, h*fo, first, last, false);
+      harmonics+=ah*ah;
+    }
+
+    result.snr=min(result.snr, 10*log10(a*a/2/max(noise, 1e-30)));
+    result.thd=max(result.thd, 10*log10(max(harmonics, 1e-30)/(a*a)));
+    result.gain=max(result.gain, fabs(20*log10(a/0.5)));
+  }
+
+  return result;
+}
+
+static void Sweep(long inRate, long outRate, int channels, double minSnr)
+{
+  const double tones[]={100, 440, 1000, 3000, 6000, 10000, 14000, 16000, 18000};
+  double worstSnr=1e9, worstThd=-1e9, worstGain=0, worstTime=0;
+
+  for (double f : tones)
+  {
+    Result r=Tone(inRate, outRate, channels, f, 1.0);
+    if (s_verbose) printf("  %6ld -> %6ld %d ch %6.0f Hz: snr %6.1f dB thd %7.1f dB gain %.4f dB\n", inRate, outRate, channels, f, r.snr, r.thd, r.gain);
+    worstSnr=min(worstSnr, r.snr);
+    worstThd=max(worstThd, r.thd);
+    worstGain=max(worstGain, r.gain);
+    worstTime=max(worstTime, r.timeError);
+  }
+
+  printf("%6ld -> %6ld Hz %d ch: snr >= %5.1f dB, thd <= %6.1f dB, passband within %.4f dB, timestamps within %.2f us\n",
+         inRate, outRate, channels, worstSnr, worstThd, worstGain, worstTime*1e6);
+
+  char what[128];
+  sprintf(what, "%ld -> %ld Hz %d channels", inRate, outRate, channels);
+  Check(worstSnr >= minSnr && worstThd <= -minSnr && worstGain < 0.01 && worstTime < 0.1/outRate, what);
+}
+
+// tones the output can not carry, between its nyquist and the input nyquist
+static void Stopband(long inRate, long outRate, double f)
+{
+  const int channels=2;
+  int frames=inRate;
+  std::vector<float> in(frames*channels), out;
+  for (int n=0; n < frames; n++)
+    in[n*channels]=in[n*channels+1]=(float)(0.5*sin(2*PI*f*n/inRate));
+
+  AudioPolyphaseResampler r(channels, inRate, outRate);
+  double timeError;
+  Resample(r, in, channels, inRate, outRate, 1.0, out, &timeError);
+
+  double power=0;
+  int outFrames=(int)out.size()/channels;
+  for (int n=outRate/10; n < outFrames-outRate/10; n++) power+=(double)out[n*channels]*out[n*channels];
+  power/=outFrames-outRate/5;
+
+  double db=10*log10(max(power, 1e-30)/0.125);
+  printf("%6ld -> %6ld Hz, %5.0f Hz tone: %6.1f dB\n", inRate, outRate, f, db);
+
+  char what[128];
+  sprintf(what, "%ld -> %ld Hz, %.0f Hz rejected", inRate, outRate, f);
+  Check(db < -75, what);
+}
+
+static void RateAdjust()
+{
+  // 1000 ppm faster: still a clean sine, 0.1% fewer frames, timestamps still right
+  const double factor=1.001;
+  Result r=Tone(48000, 44100, 2, 1000, factor);
+  printf("48000 -> 44100 Hz adjusted by %.4f: snr %5.1f dB, thd %6.1f dB, timestamps within %.2f us\n", factor, r.snr, r.thd, r.timeError*1e6);
+  Check(r.snr >= 80 && r.thd <= -80 && r.timeError < 0.1/44100, "rate adjustment");
+
+  AudioPolyphaseResampler a(2, 48000, 44100);
+  a.SetRateAdjust(factor);
+  std::vector<float> in(48000*2*10, 0.0f), out(48000*2*10);
+  int produced=a.Process(&in[0], 48000*10, &out[0], 48000*10);
+  double expected=44100*10/factor;
+  Check(fabs(produced-expected) < 100, "rate adjustment output frames");
+}
+
+static void Drift()
+{
+  const long rate=48000;
+  const double ppm=300;
+  const int frames=1920;    // 40 ms media samples
+
+  // a capture card whose audio clock runs 300 ppm fast, stamped by a clock that is
+  // right, with +-2 ms jitter
+  AudioClockDrift drift;
+  double t=0;
+  int updates=0;
+
+  for (int i=0; i < 60*25; i++)
+  {
+    __int64 stamp=(__int64)(t*10000000)+(int)(Random()%40001)-20000;
+    // every tenth sample has no timestamp
+    if (drift.Update(i % 10 != 5, stamp, frames, rate)) updates++;
+    t+=frames/(rate*(1+ppm/1e6));
+  }
+
+  double found=(drift.GetFactor()-1)*1e6;
+  printf("drift of %.0f ppm found as %.1f ppm after 60 s, %d updates\n", ppm, found, updates);
+  Check(fabs(found-ppm) < 20, "drift estimate");
+  Check(updates > 0 && updates < 60*25, "drift updates");
+
+  // a 5 s jump in the timestamps starts measuring again, the factor stays
+  double before=drift.GetFactor();
+  t+=5;
+  for (int i=0; i < 5*25; i++)
+  {
+    drift.Update(true, (__int64)(t*10000000), frames, rate);
+    t+=frames/(rate*(1+ppm/1e6));
+  }
+  Check(drift.GetFactor()==before, "drift kept over a gap");
+
+  // a discontinuity, then the same again
+  drift.Restart();
+  for (int i=0; i < 30*25; i++)
+  {
+    drift.Update(true, (__int64)(t*10000000), frames, rate);
+    t+=frames/(rate*(1+ppm/1e6));
+  }
+  Check(fabs((drift.GetFactor()-1)*1e6-ppm) < 5, "drift after a restart");
+
+  // no drift at all stays at 1
+  AudioClockDrift none;
+  for (int i=0; i < 60*25; i++)
+    none.Update(true, (__int64)i*400000, frames, rate);
+  Check(none.GetFactor()==1, "no drift");
+
+  // a new rate drops the factor
+  Check(drift.Update(true, (__int64)(t*10000000), 1764, 44100) && drift.GetFactor()==1, "drift reset for a new rate");
+}
+
+int main(int argc, char** argv)
+{
+  s_verbose=argc > 1 && strcmp(argv[1], "-v")==0;
+
+  Sweep(48000, 44100, 1, 85);
+  Sweep(48000, 44100, 2, 85);
+  Sweep(48000, 44100, 6, 85);
+  Sweep(96000, 44100, 2, 85);
+  Sweep(88200, 44100, 2, 85);
+  Sweep(44100, 48000, 2, 85);
+
+  Stopband(48000, 44100, 23500);
+  Stopband(96000, 44100, 30000);
+  Stopband(96000, 44100, 45000);
+
+  RateAdjust();
+  Drift();
+
+  if (s_failures > 0)
+  {
+    printf("%d checks FAILED\n", s_failures);
+    return 1;
+  }
+  printf("resampler %s  ok\n", IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? "sse2" : "c");
+  return 0;
+}
@@ -0,0 +1,4 @@
+// Stands in for the precompiled header of the audio switcher.
+#pragma once
+
+#include "windows.h"
@@ -0,0 +1,46 @@
+// Just enough of windows.h for the sample kernels and the resampler of the audio
+// switcher, so the drivers build with g++ on Linux.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+typedef unsigned char  BYTE;
+typedef int            BOOL;
+typedef unsigned short WORD;
+typedef uint32_t       DWORD;
+typedef int64_t        LONGLONG;
+typedef uint64_t       UINT64;
+
+// long is 64 bit here, so this matches the stdint types
+#define __int64 long
+
+#define TRUE  1
+#define FALSE 0
+
+#define __forceinline inline __attribute__((always_inline))
+
+using std::min;
+using std::max;
+
+// the drivers can force the C versions with NO_SSE2=1
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+inline BOOL IsProcessorFeaturePresent(DWORD)
+{
+  return getenv("NO_SSE2")==NULL;
+}
+
+inline void* _aligned_malloc(size_t size, size_t alignment)
+{
+  void* p=NULL;
+  return posix_memalign(&p, alignment, size)==0 ? p : NULL;
+}
+
+inline void _aligned_free(void* p)
+{
+  free(p);
+}
@@ -0,0 +1,399 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Replays muxes through CPatParser, the part of CChannelScan::OnTsPacket that
+// decides when a scan is done, and reports how long each mux took to complete.
+// The tick count follows the stream, so the timeouts of the scanner run on
+// stream time and a replay takes milliseconds.
+//
+//   chanscanreplay [hash]                  synthetic muxes; with a hash the channel
+//                                          lists must hash to it and each mux must
+//                                          be done 1 ms after its tables are in
+//   chanscanreplay -dvb|-vct <file.ts>...  captured muxes, the tick count follows
+//                                          the first pcr pid of each file
+//
+// The synthetic muxes repeat each table at its own period from a random start,
+// all sections of a table back to back, and a null packet every millisecond. A
+// mux is in once the PAT and, after it, every table of the mux has come by once; only
+// the mux without NIT has to wait for the fallback timeout. "make scan-reference"
+// runs the muxes through the scanner before it tracked table sections as well.
+
+#include <windows.h>
+#include <stdarg.h>
+#include "SiTables.h"
+#include "patparser.h"
+#include "tspacketview.h"
+
+#define NULL_PID      0x1fff
+#define PID_SDT_TABLE 0x11
+#define PID_VCT_TABLE 0x1ffb
+#define SCAN_LIMIT    30000      // ms of stream a scan gets before it counts as hung
+#define SCAN_FALLBACK 5000       // the timeout of the scanner for muxes without NIT
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+bool DisableCRCCheck()
+{
+  return false;
+}
+
+class CScanDone : public IChannelScanCallback
+{
+public:
+  CScanDone() { m_done=false; }
+  HRESULT OnScannerDone() { m_done=true; return S_OK; }
+  bool m_done;
+};
+
+struct Table
+{
+  int             pid;
+  int             period;        // ms
+  int             phase;         // ms of the first one
+  vector<Section> sections;
+  BYTE            continuity;
+};
+
+struct Mux
+{
+  string        name;
+  bool          waitForVCT;
+  bool          hasNit;
+  int           services;
+  vector<Table> tables;
+};
+
+static unsigned int s_seed=41;
+
+static int Random(int range)
+{
+  s_seed=s_seed*1664525+1013904223;
+  return (int)((s_seed>>8)%range);
+}
+
+static void AddTable(Mux& mux, int pid, int period, const vector<Section>& sections)
+{
+  Table table;
+  table.pid=pid;
+  table.period=period;
+  table.phase=Random(period);
+  table.sections=sections;
+  table.continuity=0;
+  mux.tables.push_back(table);
+}
+
+static void AddTable(Mux& mux, int pid, int period, const Section& section)
+{
+  AddTable(mux, pid, period, vector<Section>(1, section));
+}
+
+// PAT and the PMTs, every 100 ms
+static void AddPsi(Mux& mux, const SiTransport& ts)
+{
+  AddTable(mux, PID_PAT, 100, CSiTables::Pat(ts, 1));
+  for (size_t i=0; i < ts.services.size();++i)
+    AddTable(mux, ts.services[i].pmtPid, 100, CSiTables::Pmt(ts.services[i], 1));
+  mux.services=(int)ts.services.size();
+}
+
+static SiTransport Transport(int networkId, int transportId, int services, int firstLcn, bool satellite, int frequency)
+{
+  SiTransport ts;
+  ts.networkId=networkId;
+  ts.transportId=transportId;
+  ts.satellite=satellite;
+  ts.frequency=frequency;
+  ts.polarisation=(transportId&1);
+  ts.symbolRate=27500;
+  for (int i=0; i < services;++i)
+  {
+    SiService service;
+    service.serviceId=(transportId&0xff)*0x100+i+1;
+    service.pmtPid=0x100+i*0x10;
+    service.serviceType=(i%5==4 ? 2 : 1);
+    service.lcn=(firstLcn > 0 ? firstLcn+i : 0);
+    char name[64];
+    sprintf(name, "%s %d.%d", satellite ? "Sat" : "Channel", transportId, i+1);
+    service.name=name;
+    service.provider=(i%2 ? "Provider A" : "Provider B");
+    ts.services.push_back(service);
+  }
+  return ts;
+}
+
+static vector<Mux> SyntheticMuxes()
+{
+  vector<Mux> muxes;
+
+  // dvb-t: LCNs in the NIT of three transports, SDT other and NIT other as well
+  {
+    Mux mux;
+    mux.name="dvb-t";
+    mux.waitForVCT=false;
+    mux.hasNit=true;
+    vector<SiTransport> network;
+    network.push_back(Transport(0x2174, 0x1001, 10, 1, false, 506000));
+    network.push_back(Transport(0x2174, 0x1002, 8, 20, false, 514000));
+    network.push_back(Transport(0x2174, 0x1003, 9, 40, false, 522000));
+    vector<SiTransport> other;
+    other.push_back(Transport(0x2175, 0x2001, 6, 1, false, 650000));
+    AddPsi(mux, network[0]);
+    AddTable(mux, PID_SDT_TABLE, 2000, CSiTables::Sdt(network[0], true, 1, 20));
+    AddTable(mux, PID_SDT_TABLE, 5000, CSiTables::Sdt(network[1], false, 1, 20));
+    AddTable(mux, PID_SDT_TABLE, 5000, CSiTables::Sdt(network[2], false, 1, 20));
+    AddTable(mux, PID_NIT, 4000, CSiTables::Nit(0x3001, "Terrestrial", network, true, 1, 2));
+    AddTable(mux, PID_NIT, 8000, CSiTables::Nit(0x3002, "Neighbour", other, false, 1, 2));
+    muxes.push_back(mux);
+  }
+
+  // dvb-s: a big SDT in three sections and a NIT of 30 transponders in two,
+  // without LCNs. Some transponders share a frequency in the other polarisation
+  {
+    Mux mux;
+    mux.name="dvb-s";
+    mux.waitForVCT=false;
+    mux.hasNit=true;
+    vector<SiTransport> network;
+    for (int i=0; i < 30;++i)
+      network.push_back(Transport(1, 1000+i, (i==0 ? 60 : 4), 0, true, 1072000+(i/2)*1950));
+    AddPsi(mux, network[0]);
+    AddTable(mux, PID_SDT_TABLE, 2000, CSiTables::Sdt(network[0], true, 1, 20));
+    AddTable(mux, PID_NIT, 3000, CSiTables::Nit(1, "Satellite", network, true, 1, 15));
+    muxes.push_back(mux);
+  }
+
+  // no NIT at all, only the fallback timeout ends the scan
+  {
+    Mux mux;
+    mux.name="no nit";
+    mux.waitForVCT=false;
+    mux.hasNit=false;
+    SiTransport ts=Transport(0x22d4, 0x0801, 6, 0, false, 578000);
+    AddPsi(mux, ts);
+    AddTable(mux, PID_SDT_TABLE, 2000, CSiTables::Sdt(ts, true, 1, 20));
+    muxes.push_back(mux);
+  }
+
+  // a data service of the PAT that the complete SDT doesn't name
+  {
+    Mux mux;
+    mux.name="unnamed";
+    mux.waitForVCT=false;
+    mux.hasNit=true;
+    vector<SiTransport> network;
+    network.push_back(Transport(0x233a, 0x4001, 5, 1, false, 474000));
+    network[0].services[4].name="";
+    network[0].services[4].serviceType=0x0c;
+    AddPsi(mux, network[0]);
+    AddTable(mux, PID_SDT_TABLE, 2000, CSiTables::Sdt(network[0], true, 1, 20));
+    AddTable(mux, PID_NIT, 4000, CSiTables::Nit(0x3003, "Cable", network, true, 1, 2));
+    muxes.push_back(mux);
+  }
+
+  // atsc, the channels are named by the terrestrial VCT
+  {
+    Mux mux;
+    mux.name="atsc";
+    mux.waitForVCT=true;
+    mux.hasNit=false;
+    SiTransport ts=Transport(0, 0x0653, 6, 0, false, 533000);
+    AddPsi(mux, ts);
+    AddTable(mux, PID_VCT_TABLE, 400, CSiTables::Vct(ts, 7, 1));
+    muxes.push_back(mux);
+  }
+  return muxes;
+}
+
+// when the last table of the mux came by once, counting the PMTs, SDTs and VCTs
+// only from the first PAT on. NIT and SDT of other transports don't hold a scan
+// back when they come all at once
+static int TablesIn(const Mux& mux)
+{
+  int pat=mux.tables[0].phase;
+  int in=pat;
+  for (size_t i=1; i < mux.tables.size();++i)
+  {
+    const Table& table=mux.tables[i];
+    int tableId=table.sections[0][0];
+    if (tableId==0x41 || tableId==0x46) continue;
+    int first=table.phase;
+    if (table.pid!=PID_NIT)
+    {
+      while (first < pat) first+=table.period;
+    }
+    in=max(in, first);
+  }
+  if (!mux.waitForVCT && !mux.hasNit) in=max(in, SCAN_FALLBACK);
+  return in;
+}
+
+static void Hash(UINT64& hash, const void* data, size_t length)
+{
+  const byte* bytes=(const byte*)data;
+  for (size_t i=0; i < length;++i) hash=(hash ^ bytes[i])*1099511628211ULL;
+}
+
+static UINT64 HashChannels(CPatParser& parser, int* named)
+{
+  UINT64 hash=1469598103934665603ULL;
+  *named=0;
+  for (int i=0; i < parser.Count();++i)
+  {
+    CChannelInfo info;
+    parser.GetChannel(i, info);
+    int fields[]={ info.NetworkId, info.TransportId, info.ServiceId, info.MajorChannel, info.MinorChannel,
+                   info.Frequency, info.LCN, info.FreeCAMode, info.ServiceType, info.hasVideo, info.hasAudio,
+                   info.hasCaDescriptor, (int)info.PidTable.PmtPid, info.OtherMux ? 1 : 0 };
+    Hash(hash, fields, sizeof(fields));
+    Hash(hash, info.ServiceName, strlen(info.ServiceName));
+    Hash(hash, info.ProviderName, strlen(info.ProviderName));
+    if (info.ServiceName[0]!=0) (*named)++;
+  }
+  return hash;
+}
+
+// the ms at which the scanner called back, -1 if it didn't within SCAN_LIMIT
+static int Scan(const Mux& source, CPatParser& parser)
+{
+  Mux mux=source;
+  CScanDone done;
+  byte null[188];
+  memset(null, 0xff, sizeof(null));
+  null[0]=0x47; null[1]=NULL_PID>>8; null[2]=NULL_PID&0xff; null[3]=0x10;
+
+  ReplayTickCount()=0;
+  parser.Reset(&done, mux.waitForVCT);
+  vector<byte> packets;
+  for (int t=0; t < SCAN_LIMIT;++t)
+  {
+    ReplayTickCount()=t;
+    for (size_t i=0; i < mux.tables.size();++i)
+    {
+      Table& table=mux.tables[i];
+      if (t < table.phase || (t-table.phase)%table.period!=0) continue;
+      packets.clear();
+      for (size_t s=0; s < table.sections.size();++s)
+        CSiTables::Packetize(table.sections[s], table.pid, table.continuity, packets);
+      for (size_t p=0; p < packets.size(); p+=188)
+        parser.OnTsPacket(&packets[p]);
+    }
+    parser.OnTsPacket(null);
+    if (done.m_done) return t;
+  }
+  return -1;
+}
+
+static int Replay(const char* file, bool waitForVCT)
+{
+  FILE* f=fopen(file, "rb");
+  if (f==NULL)
+  {
+    printf("%s: can't open\n", file);
+    return 1;
+  }
+  CPatParser parser;
+  CScanDone done;
+  ReplayTickCount()=0;
+  parser.Reset(&done, waitForVCT);
+
+  byte packet[188];
+  int pcrPid=-1;
+  UINT64 firstPcr=0;
+  LONGLONG packets=0;
+  while (!done.m_done && fread(packet, 1, sizeof(packet), f)==sizeof(packet))
+  {
+    packets++;
+    TsPacketView view(packet);
+    if (view.HasPcr() && (pcrPid < 0 || pcrPid==view.Pid))
+    {
+      if (pcrPid < 0)
+      {
+        pcrPid=view.Pid;
+        firstPcr=view.PcrBase();
+      }
+      ReplayTickCount()=(LONGLONG)((view.PcrBase()-firstPcr)/90);
+    }
+    parser.OnTsPacket(packet);
+  }
+  fclose(f);
+
+  int named;
+  UINT64 hash=HashChannels(parser, &named);
+  if (done.m_done)
+    printf("%-24s %4d services, %4d named, complete after %6d ms  %016llx\n", file, parser.Count(), named,
+           (int)ReplayTickCount(), (unsigned long long)hash);
+  else
+    printf("%-24s %4d services, %4d named, not complete at the end, %d ms and %lld packets in\n", file, parser.Count(),
+           named, (int)ReplayTickCount(), (long long)packets);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 2 && (strcmp(argv[1], "-dvb")==0 || strcmp(argv[1], "-vct")==0))
+  {
+    int failed=0;
+    for (int i=2; i < argc;++i) failed|=Replay(argv[i], strcmp(argv[1], "-vct")==0);
+    return failed;
+  }
+  const char* expected=(argc > 1 ? argv[1] : NULL);
+
+  vector<Mux> muxes=SyntheticMuxes();
+  UINT64 hash=1469598103934665603ULL;
+  bool ok=true;
+  for (size_t m=0; m < muxes.size();++m)
+  {
+    const Mux& mux=muxes[m];
+    CPatParser* parser=new CPatParser();
+    int complete=Scan(mux, *parser);
+    int in=TablesIn(mux);
+    int named;
+    UINT64 channels=HashChannels(*parser, &named);
+    Hash(hash, &channels, sizeof(channels));
+
+    bool muxOk=(complete >= 0 && complete <= in+1 && parser->Count()==mux.services);
+    if (complete >= 0)
+      printf("%-8s %3d services, %3d named, tables in at %5d ms, complete after %5d ms", mux.name.c_str(),
+             parser->Count(), named, in, complete);
+    else
+      printf("%-8s %3d services, %3d named, tables in at %5d ms, not complete after %d ms", mux.name.c_str(),
+             parser->Count(), named, in, SCAN_LIMIT);
+    if (expected!=NULL) printf("  %s", muxOk ? "ok" : "FAILED");
+    printf("\n");
+    ok&=muxOk;
+    delete parser;
+  }
+  ReplayTickCount()=-1;
+
+  printf("channel lists %016llx", (unsigned long long)hash);
+  if (expected==NULL)
+  {
+    printf("\n");
+    return 0;
+  }
+  char text[32];
+  sprintf(text, "%016llx", (unsigned long long)hash);
+  bool same=(strcmp(text, expected)==0);
+  printf(", expected %s  %s\n", expected, same ? "ok" : "FAILED");
+  return (ok && same) ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Feeds CChannelWorker the way CMpTs does: samples of 64 packets at 38 Mbit/s,
+// written to every channel and flushed at the end of each sample.
+//
+//   isolation  four channels for 4 s, one of them stalls for 1 s every 20000
+//              packets. The streaming thread must never wait, the other channels
+//              must see every packet in order and the stalled one drops packets
+//              instead of blocking anyone.
+//   stop       a channel is deleted right after a partial batch was written while
+//              its sink is blocked. The delete must wait for the sink and every
+//              packet must have been processed.
+
+#include <windows.h>
+#include <mmsystem.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include "tschannel.h"
+#include "channelworker.h"
+
+#define SIM_SAMPLE_PACKETS   64
+#define SIM_SAMPLE_INTERVAL  2.56    // ms, 64 packets at 38 Mbit/s
+#define SIM_SAMPLES          1600
+
+void LogDebug(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+  printf("\n");
+}
+
+// checks that the packets arrive in order, the sequence number is in the payload
+class CSimChannel : public CTsChannel
+{
+public:
+  CSimChannel(int id, int stallEvery, int stallMs) : CTsChannel(id)
+  {
+    m_stallEvery=stallEvery;
+    m_stallMs=stallMs;
+    m_processed=0;
+    m_lastSequence=-1;
+    m_orderErrors=0;
+    m_pWorker=new CChannelWorker(this);
+  }
+
+  void ProcessTsPacket(const TsPacketView& packet)
+  {
+    int sequence;
+    memcpy(&sequence, packet.Data+4, sizeof(sequence));
+    if (sequence <= m_lastSequence) m_orderErrors++;
+    m_lastSequence=sequence;
+    m_processed++;
+    if (m_stallEvery > 0 && (m_processed % m_stallEvery)==0) usleep(m_stallMs*1000);
+  }
+
+  CChannelWorker* m_pWorker;
+  volatile int    m_processed;
+  int             m_orderErrors;
+
+private:
+  int m_stallEvery;
+  int m_stallMs;
+  int m_lastSequence;
+};
+
+static void Packet(byte* tsPacket, int sequence)
+{
+  memset(tsPacket, 0xff, 188);
+  tsPacket[0]=0x47;
+  tsPacket[1]=0x01;
+  tsPacket[2]=0x00;
+  tsPacket[3]=0x10;
+  memcpy(tsPacket+4, &sequence, sizeof(sequence));
+}
+
+static bool Isolation()
+{
+  CSimChannel* channels[4];
+  for (int i=0; i < 4;++i)
+  {
+    channels[i]=new CSimChannel(i, (i==3 ? 20000 : 0), 1000);
+  }
+
+  byte tsPacket[188];
+  int sequence=0;
+  DWORD maxWrite=0;
+  DWORD start=timeGetTime();
+  for (int sample=0; sample < SIM_SAMPLES;++sample)
+  {
+    while (timeGetTime()-start < sample*SIM_SAMPLE_INTERVAL) usleep(200);
+    DWORD writeStart=timeGetTime();
+    for (int k=0; k < SIM_SAMPLE_PACKETS;++k)
+    {
+      Packet(tsPacket, sequence++);
+      for (int i=0; i < 4;++i) channels[i]->m_pWorker->Write(tsPacket);
+    }
+    for (int i=0; i < 4;++i) channels[i]->m_pWorker->Flush();
+    DWORD writeTime=timeGetTime()-writeStart;
+    if (writeTime > maxWrite) maxWrite=writeTime;
+  }
+
+  bool ok=(maxWrite < 20);
+  printf("isolation: %d packets in %u ms, longest sample took %u ms to hand over\n", sequence, timeGetTime()-start, maxWrite);
+  for (int i=0; i < 4;++i)
+  {
+    int queued, maxQueued, dropped, maxLatency;
+    channels[i]->m_pWorker->GetCounters(&queued, &maxQueued, &dropped, &maxLatency);
+    delete channels[i]->m_pWorker;
+    bool stalls=(i==3);
+    bool channelOk=(channels[i]->m_orderErrors==0 && channels[i]->m_processed+dropped==sequence &&
+                    (stalls ? dropped > 0 : dropped==0));
+    printf("  channel %d%s: processed %d, dropped %d, order errors %d, max queued %d  %s\n", i, (stalls ? " (stalls)" : ""),
+           channels[i]->m_processed, dropped, channels[i]->m_orderErrors, maxQueued, channelOk ? "ok" : "FAILED");
+    ok&=channelOk;
+    delete channels[i];
+  }
+  return ok;
+}
+
+static bool Stop()
+{
+  // every 300th packet blocks the sink for 1.5 s
+  CSimChannel* channel=new CSimChannel(0, 300, 1500);
+  byte tsPacket[188];
+  int packets=1000;
+  for (int i=0; i < packets;++i)
+  {
+    Packet(tsPacket, i);
+    channel->m_pWorker->Write(tsPacket);
+  }
+  DWORD start=timeGetTime();
+  delete channel->m_pWorker;
+  DWORD stopTime=timeGetTime()-start;
+  bool ok=(channel->m_processed==packets && channel->m_orderErrors==0);
+  printf("stop: %d of %d packets processed, the delete waited %u ms  %s\n", channel->m_processed, packets, stopTime, ok ? "ok" : "FAILED");
+  delete channel;
+  return ok;
+}
+
+int main()
+{
+  bool ok=Isolation();
+  ok&=Stop();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,798 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Replays a synthetic service through the TsReader demuxer, with the
+// FillBuffer() loops of the audio and video pins on their own threads, and
+// measures how soon the pins deliver after a channel change or a seek and how
+// often they wake up while they wait for data.
+//
+//   demuxreplay [zaps] [seeks]
+//
+// The service is mpeg2 video at 25 fps with a pcr in every frame and mpeg
+// audio in 20 ms frames. A tuner writes it to the timeshift file in a burst
+// every frame; a recording is there all at once.
+// - zap: a new timeshift file from a random point of the service, with the
+//   player answering the audio and media type callbacks from its own loop. The
+//   time from the first byte written to the first audio and video sample
+// - seek: the recording from a random position, with the pins stopped and
+//   restarted as CTsReaderFilter::SeekPreStart() does. The time the pins take
+//   to stop, and from the seek to the first audio and video sample
+// - while live: how often the pins wake up, how many of the wakeups find
+//   nothing, and how long a sample waits between the burst that completes it
+//   being written and the pin delivering it
+// Every sample must follow the one before on its pin. Built with
+// -DTSREADER_BASE the pins sleep instead of waiting on the demuxer, as before
+// the demuxer signalled them; see the demux-reference target of the Makefile.
+
+#include <windows.h>
+#include <streams.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "demultiplexer.h"
+#include "tsreader.h"
+#include "SiTables.h"
+
+using namespace std;
+
+#define PMT_PID         0x100       // CSiTables::Pmt() puts the video and the pcr on the next pid
+#define VIDEO_PID       0x101
+#define AUDIO_PID       0x102
+#define FRAME_TICKS     3600        // 90 kHz, 25 fps
+#define FRAME_S         0.04
+#define AUDIO_TICKS     1800        // 20 ms audio frames, two a video frame
+#define GOP_FRAMES      12
+#define TIME_BASE       90000       // pcr of the first frame
+#define PTS_DELAY       45000
+#define STREAM_FRAMES   1500        // 60 s
+#define ZAP_S           2.5         // how long a channel is watched
+#define SEEK_S          1.0         // and the recording after a seek
+#define QUEUE_S         0.5         // how far ahead of its time the renderer takes a sample
+#define HOST_MS         20          // the process loop of the player
+#define ZAP_MAX_MS      3000
+#define SEEK_MAX_MS     1500
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+class CStreamGenerator
+{
+public:
+  CStreamGenerator()
+  {
+    m_seed=1;
+    m_patContinuity=0;
+    m_pmtContinuity=0;
+    m_videoContinuity=0;
+    m_audioContinuity=0;
+
+    SiService service={ 1, PMT_PID, 1, 0, "Replay", "StreamReplay" };
+    m_transport.transportId=1;
+    m_transport.networkId=1;
+    m_transport.frequency=0;
+    m_transport.polarisation=0;
+    m_transport.symbolRate=0;
+    m_transport.satellite=false;
+    m_transport.services.push_back(service);
+
+    for (int frame=0; frame < STREAM_FRAMES;++frame)
+    {
+      m_frameStart.push_back(m_ts.size());
+      Frame(frame);
+    }
+    m_frameStart.push_back(m_ts.size());
+  }
+
+  const vector<byte>&   Stream()     { return m_ts; }
+  const vector<size_t>& FrameStart() { return m_frameStart; }
+
+  unsigned int Random()
+  {
+    m_seed=m_seed*1664525+1013904223;
+    return m_seed>>8;
+  }
+
+private:
+  // the tables, a video frame and the two audio frames that go with it
+  void Frame(int frame)
+  {
+    CSiTables::Packetize(CSiTables::Pat(m_transport, 1), 0, m_patContinuity, m_ts);
+    CSiTables::Packetize(CSiTables::Pmt(m_transport.services[0], 1), PMT_PID, m_pmtContinuity, m_ts);
+
+    UINT64 time=TIME_BASE+(UINT64)frame*FRAME_TICKS;
+    bool intra=(frame%GOP_FRAMES==0);
+    vector<byte> pes;
+    PesHeader(pes, 0xe0, time+PTS_DELAY);
+    if (intra) SequenceHeader(pes);
+    // picture header: temporal reference and coding type, I or P
+    int reference=frame%GOP_FRAMES;
+    StartCode(pes, 0x00);
+    pes.push_back((byte)(reference>>2));
+    pes.push_back((byte)(((reference&3)<<6) | ((intra ? 1 : 2)<<3)));
+    pes.push_back(0xff);
+    pes.push_back(0xf8);
+    Payload(pes, intra ? 30000 : 5000+Random()%4000);
+    Packetize(VIDEO_PID, m_videoContinuity, pes, true, time*300);
+
+    for (int audio=0; audio < 2;++audio)
+    {
+      pes.clear();
+      PesHeader(pes, 0xc0, time+PTS_DELAY+audio*AUDIO_TICKS);
+      Payload(pes, 480);
+      pes[4]=(byte)((pes.size()-6)>>8);
+      pes[5]=(byte)((pes.size()-6)&0xff);
+      Packetize(AUDIO_PID, m_audioContinuity, pes, false, 0);
+    }
+  }
+
+  static void StartCode(vector<byte>& pes, byte code)
+  {
+    pes.push_back(0);
+    pes.push_back(0);
+    pes.push_back(1);
+    pes.push_back(code);
+  }
+
+  static void PesHeader(vector<byte>& pes, byte streamId, UINT64 pts)
+  {
+    StartCode(pes, streamId);
+    pes.push_back(0);
+    pes.push_back(0);
+    pes.push_back(0x80);
+    pes.push_back(0x80);
+    pes.push_back(5);
+    pes.push_back((byte)(0x21 | ((pts>>29)&0x0e)));
+    pes.push_back((byte)(pts>>22));
+    pes.push_back((byte)(((pts>>14)&0xfe) | 1));
+    pes.push_back((byte)(pts>>7));
+    pes.push_back((byte)(((pts<<1)&0xfe) | 1));
+  }
+
+  // 720x576 4:3 25 fps main profile, then a gop header
+  static void SequenceHeader(vector<byte>& pes)
+  {
+    static const byte sequence[]={ 0x00, 0x00, 0x01, 0xb3, 0x2d, 0x02, 0x40, 0x23, 0x0e, 0xa6, 0x20, 0xe0,
+                                   0x00, 0x00, 0x01, 0xb5, 0x14, 0x8a, 0x00, 0x01, 0x00, 0x00,
+                                   0x00, 0x00, 0x01, 0xb8, 0x00, 0x08, 0x00, 0x00 };
+    pes.insert(pes.end(), sequence, sequence+sizeof(sequence));
+  }
+
+  // no zero bytes, so no start codes
+  void Payload(vector<byte>& pes, int length)
+  {
+    for (int i=0; i < length;++i) pes.push_back((byte)(1+Random()%255));
+  }
+
+  void Packetize(int pid, BYTE& continuity, const vector<byte>& pes, bool hasPcr, UINT64 pcr)
+  {
+    size_t pos=0;
+    bool first=true;
+    while (pos < pes.size())
+    {
+      size_t at=m_ts.size();
+      m_ts.resize(at+188, 0xff);
+      byte* tsPacket=&m_ts[at];
+      bool withPcr=(first && hasPcr);
+      int adaptionField=(withPcr ? 7 : -1);     // length byte of the adaption field, -1 for none
+      int room=184-(adaptionField >= 0 ? adaptionField+1 : 0);
+      int payload=(int)min(pes.size()-pos, (size_t)room);
+      if (payload < room)
+      {
+        // the last packet is stuffed
+        adaptionField=(adaptionField >= 0 ? adaptionField+room-payload : room-payload-1);
+      }
+
+      tsPacket[0]=0x47;
+      tsPacket[1]=(byte)((first ? 0x40 : 0) | (pid>>8));
+      tsPacket[2]=(byte)(pid&0xff);
+      tsPacket[3]=(byte)((adaptionField >= 0 ? 0x30 : 0x10) | (continuity++ & 0x0f));
+      int header=4;
+      if (adaptionField >= 0)
+      {
+        tsPacket[4]=(byte)adaptionField;
+        if (adaptionField > 0)
+        {
+          tsPacket[5]=(withPcr ? 0x10 : 0);
+          if (withPcr)
+          {
+            UINT64 base=pcr/300;
+            UINT64 extension=pcr%300;
+            tsPacket[6]=(byte)(base>>25);
+            tsPacket[7]=(byte)(base>>17);
+            tsPacket[8]=(byte)(base>>9);
+            tsPacket[9]=(byte)(base>>1);
+            tsPacket[10]=(byte)(((base&1)<<7) | 0x7e | (extension>>8));
+            tsPacket[11]=(byte)(extension&0xff);
+          }
+        }
+        header=5+adaptionField;
+      }
+      memcpy(&tsPacket[header], &pes[pos], payload);
+      pos+=payload;
+      first=false;
+    }
+  }
+
+  unsigned int   m_seed;
+  SiTransport    m_transport;
+  BYTE           m_patContinuity;
+  BYTE           m_pmtContinuity;
+  BYTE           m_videoContinuity;
+  BYTE           m_audioContinuity;
+  vector<byte>   m_ts;
+  vector<size_t> m_frameStart;
+};
+
+// FileReader.cpp reads real files; the replay reader below is all the demuxer
+// and the duration see of it
+FileReader::FileReader()
+{
+  m_hFile=INVALID_HANDLE_VALUE;
+  m_hInfoFile=INVALID_HANDLE_VALUE;
+  m_pFileName=NULL;
+  m_bReadOnly=TRUE;
+  m_bDelay=FALSE;
+  m_fileSize=0;
+  m_infoFileSize=0;
+  m_fileStartPos=0;
+  m_llBufferPointer=0;
+  m_bDebugOutput=FALSE;
+}
+
+FileReader::~FileReader()                                                  {}
+HRESULT FileReader::GetFileName(LPOLESTR*)                                 { return E_FAIL; }
+HRESULT FileReader::SetFileName(LPCOLESTR)                                 { return E_FAIL; }
+HRESULT FileReader::OpenFile()                                             { return S_OK; }
+HRESULT FileReader::CloseFile()                                            { return S_OK; }
+HRESULT FileReader::Read(PBYTE, ULONG, ULONG*)                             { return E_FAIL; }
+HRESULT FileReader::Read(PBYTE, ULONG, ULONG*, __int64, DWORD)             { return E_FAIL; }
+HRESULT FileReader::get_ReadOnly(WORD* ReadOnly)                           { *ReadOnly=TRUE; return S_OK; }
+HRESULT FileReader::get_DelayMode(WORD* DelayMode)                         { *DelayMode=FALSE; return S_OK; }
+HRESULT FileReader::set_DelayMode(WORD)                                    { return S_OK; }
+HRESULT FileReader::get_ReaderMode(WORD* ReaderMode)                       { *ReaderMode=0; return S_OK; }
+HRESULT FileReader::GetFileSize(__int64* pStartPosition, __int64* pLength) { *pStartPosition=0; *pLength=GetFileSize(); return S_OK; }
+BOOL    FileReader::IsFileInvalid()                                        { return FALSE; }
+DWORD   FileReader::SetFilePointer(__int64, DWORD)                         { return 0; }
+__int64 FileReader::GetFilePointer()                                       { return 0; }
+DWORD   FileReader::setFilePointer(__int64 llDistanceToMove, DWORD dwMoveMethod) { return SetFilePointer(llDistanceToMove, dwMoveMethod); }
+__int64 FileReader::getFilePointer()                                       { return GetFilePointer(); }
+__int64 FileReader::getBufferPointer()                                     { return m_llBufferPointer; }
+void    FileReader::setBufferPointer()                                     { m_llBufferPointer=GetFilePointer(); }
+__int64 FileReader::GetFileSize()                                          { return 0; }
+
+// a timeshift file the tuner writes a frame at a time from Open(), or a recording
+class CReplayReader : public FileReader
+{
+public:
+  CReplayReader(const vector<byte>& ts, const vector<size_t>& frameStart) : m_ts(ts), m_frameStart(frameStart)
+  {
+    Open(0, false);
+  }
+
+  void Open(int firstFrame, bool live)
+  {
+    m_firstFrame=firstFrame;
+    m_live=live;
+    m_pos=0;
+    m_start=Now();
+  }
+
+  // when the burst with a frame was written
+  double WrittenAt(int frame)
+  {
+    return m_start+(frame-m_firstFrame+1)*FRAME_S;
+  }
+
+  // the frame a sample with this media time belongs to, audio or video
+  static int FrameOf(LONG ms)
+  {
+    return (int)((ms+1-(TIME_BASE+PTS_DELAY)/90)/40);
+  }
+
+  virtual HRESULT Read(PBYTE pbData, ULONG lDataLength, ULONG* dwReadBytes)
+  {
+    __int64 available=max(GetFileSize()-m_pos, (__int64)0);
+    ULONG length=(ULONG)min((__int64)lDataLength, available);
+    if (length > 0) memcpy(pbData, &m_ts[m_frameStart[m_firstFrame]+m_pos], length);
+    m_pos+=length;
+    *dwReadBytes=length;
+    return S_OK;
+  }
+
+  virtual DWORD SetFilePointer(__int64 llDistanceToMove, DWORD dwMoveMethod)
+  {
+    if (dwMoveMethod==FILE_BEGIN) m_pos=llDistanceToMove;
+    else if (dwMoveMethod==FILE_CURRENT) m_pos+=llDistanceToMove;
+    else m_pos=GetFileSize()+llDistanceToMove;
+    return 0;
+  }
+
+  virtual __int64 GetFilePointer() { return m_pos; }
+
+  virtual __int64 GetFileSize()
+  {
+    int last=STREAM_FRAMES;
+    if (m_live) last=min(m_firstFrame+(int)((Now()-m_start)/FRAME_S), STREAM_FRAMES);
+    return (__int64)(m_frameStart[last]-m_frameStart[m_firstFrame]);
+  }
+
+private:
+  const vector<byte>&   m_ts;
+  const vector<size_t>& m_frameStart;
+  int                   m_firstFrame;
+  bool                  m_live;
+  __int64               m_pos;
+  double                m_start;
+};
+
+// the renderer: it starts its clock on the first audio sample and takes a
+// sample QUEUE_S ahead of its time; a flush lets go of a waiting pin
+class CReplayRenderer
+{
+public:
+  CReplayRenderer() { m_started=false; m_clockStart=0; m_mediaStart=0; }
+
+  void Start(LONG ms)
+  {
+    lock_guard<mutex> lock(m_lock);
+    m_started=true;
+    m_clockStart=Now();
+    m_mediaStart=ms;
+  }
+
+  void Flush()
+  {
+    lock_guard<mutex> lock(m_lock);
+    m_started=false;
+    m_changed.notify_all();
+  }
+
+  void Deliver(LONG ms, volatile bool& abort)
+  {
+    unique_lock<mutex> lock(m_lock);
+    while (m_started && !abort)
+    {
+      double wait=m_clockStart+(ms-m_mediaStart)/1000.0-QUEUE_S-Now();
+      if (wait <= 0) break;
+      m_changed.wait_for(lock, chrono::microseconds((LONGLONG)(wait*1e6)));
+    }
+  }
+
+  void Wake()
+  {
+    lock_guard<mutex> lock(m_lock);
+    m_changed.notify_all();
+  }
+
+private:
+  mutex              m_lock;
+  condition_variable m_changed;
+  bool               m_started;
+  double             m_clockStart;
+  LONG               m_mediaStart;
+};
+
+struct PinStats
+{
+  int    wakeups;       // timed waits for the demuxer
+  int    empty;         // of them, those after which there still was no buffer
+  int    samples;
+  int    outOfOrder;
+  double lag;           // s, from the burst being written to the delivery, summed
+  int    lagged;
+};
+
+// the FillBuffer() loop of an output pin on its own thread, as CSourceStream
+// runs it; Stop() waits for FillBuffer() to return
+class CPinThread
+{
+public:
+  CPinThread(bool audio, CDeMultiplexer& demux, CTsReaderFilter& filter, CReplayRenderer& renderer, CReplayReader& reader)
+    : m_audio(audio), m_demux(demux), m_filter(filter), m_renderer(renderer), m_reader(reader)
+  {
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_exit=false;
+    m_stopRequest=true;           // until Run()
+    m_stopped=false;
+    m_afterWait=false;
+    m_lastMs=-1;
+    m_first=0;
+    m_live=false;
+    m_thread=thread(&CPinThread::ThreadProc, this);
+  }
+
+  ~CPinThread()
+  {
+    {
+      lock_guard<mutex> lock(m_lock);
+      m_exit=true;
+      m_stopRequest=true;
+      m_changed.notify_all();
+    }
+    m_renderer.Wake();
+    m_thread.join();
+  }
+
+  void Stop()
+  {
+    unique_lock<mutex> lock(m_lock);
+    m_stopRequest=true;
+    lock.unlock();
+    m_renderer.Wake();
+    lock.lock();
+    while (!m_stopped) m_changed.wait(lock);
+  }
+
+  void Run(bool live)
+  {
+    lock_guard<mutex> lock(m_lock);
+    m_live=live;
+    m_first=0;
+    m_lastMs=-1;
+    m_afterWait=false;
+    m_stopRequest=false;
+    m_changed.notify_all();
+  }
+
+  double    First() { return m_first; }
+  PinStats& Stats() { return m_stats; }
+
+private:
+  void ThreadProc()
+  {
+    unique_lock<mutex> lock(m_lock);
+    while (!m_exit)
+    {
+      if (m_stopRequest)
+      {
+        m_stopped=true;
+        m_changed.notify_all();
+        while (m_stopRequest && !m_exit) m_changed.wait(lock);
+        m_stopped=false;
+        continue;
+      }
+      lock.unlock();
+      FillBuffer();
+      lock.lock();
+    }
+    m_stopped=true;
+    m_changed.notify_all();
+  }
+
+  void Wait(DWORD ms)
+  {
+#ifdef TSREADER_BASE
+    Sleep(ms);
+#else
+    if (m_audio) m_demux.WaitForAudio(ms);
+    else m_demux.WaitForVideo(ms);
+#endif
+    m_stats.wakeups++;
+    m_afterWait=true;
+  }
+
+  // CAudioPin/CVideoPin::FillBuffer() up to the media sample
+  void FillBuffer()
+  {
+    CBuffer* buffer=NULL;
+    do
+    {
+      if (m_filter.IsSeeking() || m_filter.IsStopping())
+      {
+        Wait(m_audio ? 20 : 5);
+        return;
+      }
+
+      if (m_audio) buffer=m_demux.GetAudio();
+      else if (m_filter.m_bStreamCompensated) buffer=m_demux.GetVideo();
+
+      if (m_demux.EndOfFile()) return;
+
+      if (buffer==NULL)
+      {
+        if (m_afterWait) m_stats.empty++;
+        Wait(10);
+      }
+      else
+      {
+        m_afterWait=false;
+        Present(buffer);
+        delete buffer;
+      }
+    } while (buffer==NULL);
+  }
+
+  void Present(CBuffer* buffer)
+  {
+    CRefTime mediaTime;
+    if (!buffer->MediaTime(mediaTime)) return;
+    LONG ms=mediaTime.Millisecs();
+    if (m_audio && !m_filter.m_bStreamCompensated)
+    {
+      m_renderer.Start(ms);
+      m_filter.m_bStreamCompensated=true;
+    }
+    // the pacing sleeps of the pins
+    Sleep(m_audio ? 5 : 1);
+
+    m_renderer.Deliver(ms, m_stopRequest);
+    double now=Now();
+    if (m_first==0) m_first=now;
+    if (m_lastMs >= 0 && abs(ms-m_lastMs-(m_audio ? 20 : 40)) > 1) m_stats.outOfOrder++;
+    m_lastMs=ms;
+    m_stats.samples++;
+    if (m_live)
+    {
+      m_stats.lag+=now-m_reader.WrittenAt(CReplayReader::FrameOf(ms));
+      m_stats.lagged++;
+    }
+  }
+
+  bool               m_audio;
+  CDeMultiplexer&    m_demux;
+  CTsReaderFilter&   m_filter;
+  CReplayRenderer&   m_renderer;
+  CReplayReader&     m_reader;
+  PinStats           m_stats;
+  mutex              m_lock;
+  condition_variable m_changed;
+  bool               m_exit;
+  volatile bool      m_stopRequest;
+  bool               m_stopped;
+  bool               m_afterWait;
+  bool               m_live;
+  LONG               m_lastMs;
+  double             m_first;
+  thread             m_thread;
+};
+
+// the process loop of the player: it rebuilds the graph when the media types
+// change, which is instant here, and selects the first audio stream
+class CReplayHost
+{
+public:
+  CReplayHost(CDeMultiplexer& demux, CTsReaderFilter& filter) : m_demux(demux), m_filter(filter)
+  {
+    m_exit=false;
+    m_thread=thread(&CReplayHost::ThreadProc, this);
+  }
+
+  ~CReplayHost()
+  {
+    m_exit=true;
+    m_thread.join();
+  }
+
+private:
+  void ThreadProc()
+  {
+    while (!m_exit)
+    {
+      if (m_filter.m_bMediaTypeChanged)
+      {
+        m_filter.m_bMediaTypeChanged=false;
+        m_demux.SetMediaChanging(false);
+      }
+      if (m_filter.m_bRequestAudioChange)
+      {
+        m_filter.m_bRequestAudioChange=false;
+        m_demux.SetAudioStream(0);
+      }
+      Sleep(HOST_MS);
+    }
+  }
+
+  CDeMultiplexer&  m_demux;
+  CTsReaderFilter& m_filter;
+  volatile bool    m_exit;
+  thread           m_thread;
+};
+
+struct Latency
+{
+  Latency() { count=0; sum=0; max=0; }
+  void Add(double s) { count++; sum+=s; max=std::max(max, s); }
+  double MeanMs() { return count > 0 ? sum/count*1000 : 0; }
+  double MaxMs()  { return max*1000; }
+
+  int    count;
+  double sum;
+  double max;
+};
+
+static bool Check(const char* name, bool ok, const char* fmt, ...)
+{
+  char text[256];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(text, sizeof(text), fmt, ap);
+  va_end(ap);
+  printf("%-14s %-76s %s\n", name, text, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static void SignalStateChange(CDeMultiplexer& demux)
+{
+#ifdef TSREADER_BASE
+  (void)demux;
+#else
+  demux.SignalStateChange();
+#endif
+}
+
+static void AddStats(PinStats& total, PinStats& pin)
+{
+  total.wakeups+=pin.wakeups;
+  total.empty+=pin.empty;
+  total.samples+=pin.samples;
+  total.outOfOrder+=pin.outOfOrder;
+  total.lag+=pin.lag;
+  total.lagged+=pin.lagged;
+}
+
+// each zap is a new graph on a new timeshift file
+static bool Zaps(CStreamGenerator& generator, int zaps)
+{
+  CReplayReader reader(generator.Stream(), generator.FrameStart());
+  Latency audioLatency, videoLatency;
+  PinStats audioStats, videoStats;
+  memset(&audioStats, 0, sizeof(audioStats));
+  memset(&videoStats, 0, sizeof(videoStats));
+  int missing=0;
+  double watched=0;
+
+  for (int zap=0; zap < zaps;++zap)
+  {
+    CTsDuration duration;
+    CTsReaderFilter filter;
+    CDeMultiplexer demux(duration, filter);
+    CReplayRenderer renderer;
+    int frame=(int)(generator.Random()%(STREAM_FRAMES-(int)(ZAP_S/FRAME_S)-50));
+    reader.Open(frame, true);
+    double start=Now();
+    demux.SetFileReader(&reader);
+    {
+      CReplayHost host(demux, filter);
+      demux.Start();
+      CPinThread audio(true, demux, filter, renderer, reader);
+      CPinThread video(false, demux, filter, renderer, reader);
+      audio.Run(true);
+      video.Run(true);
+      Sleep((DWORD)(ZAP_S*1000));
+      watched+=Now()-start;
+
+      filter.m_bStopping=true;
+      SignalStateChange(demux);
+      audio.Stop();
+      video.Stop();
+      if (audio.First()==0 || video.First()==0) missing++;
+      if (audio.First()!=0) audioLatency.Add(audio.First()-start);
+      if (video.First()!=0) videoLatency.Add(video.First()-start);
+      AddStats(audioStats, audio.Stats());
+      AddStats(videoStats, video.Stats());
+    }
+  }
+
+  bool ok=Check("zap", missing==0 && audioLatency.MaxMs() < ZAP_MAX_MS && videoLatency.MaxMs() < ZAP_MAX_MS,
+                "%d: first audio %.0f ms, max %.0f; first video %.0f ms, max %.0f", zaps,
+                audioLatency.MeanMs(), audioLatency.MaxMs(), videoLatency.MeanMs(), videoLatency.MaxMs());
+  Check("live audio", audioStats.samples > 0, "%.0f wakeups/s, %.0f found nothing; %.1f samples/s, %.1f ms from the write",
+        audioStats.wakeups/watched, audioStats.empty/watched, audioStats.samples/watched,
+        audioStats.lagged > 0 ? audioStats.lag/audioStats.lagged*1000 : 0);
+  Check("live video", videoStats.samples > 0, "%.0f wakeups/s, %.0f found nothing; %.1f samples/s, %.1f ms from the write",
+        videoStats.wakeups/watched, videoStats.empty/watched, videoStats.samples/watched,
+        videoStats.lagged > 0 ? videoStats.lag/videoStats.lagged*1000 : 0);
+  ok&=Check("live order", audioStats.outOfOrder==0 && videoStats.outOfOrder==0, "%d audio and %d video samples out of order",
+            audioStats.outOfOrder, videoStats.outOfOrder);
+  return ok;
+}
+
+// CTsReaderFilter::SeekPreStart() on a recording
+static bool Seeks(CStreamGenerator& generator, int seeks)
+{
+  CReplayReader reader(generator.Stream(), generator.FrameStart());
+  const vector<size_t>& frameStart=generator.FrameStart();
+  CTsDuration duration;
+  CTsReaderFilter filter;
+  filter.m_bLiveTv=false;
+  filter.m_bTimeShifting=false;
+  CDeMultiplexer demux(duration, filter);
+  CReplayRenderer renderer;
+  demux.SetFileReader(&reader);
+
+  Latency stopLatency, audioLatency, videoLatency;
+  int missing=0, outOfOrder=0;
+  {
+    CReplayHost host(demux, filter);
+    demux.Start();
+    CPinThread audio(true, demux, filter, renderer, reader);
+    CPinThread video(false, demux, filter, renderer, reader);
+    audio.Run(false);
+    video.Run(false);
+    Sleep((DWORD)(SEEK_S*1000));
+
+    for (int seek=0; seek < seeks;++seek)
+    {
+      int frame=(int)(generator.Random()%(STREAM_FRAMES-(int)(SEEK_S/FRAME_S)-100));
+      int packets=(int)((frameStart[frame+1]-frameStart[frame])/188);
+      __int64 position=frameStart[frame]+(generator.Random()%packets)*188;
+
+      double start=Now();
+      filter.m_bSeeking=true;
+      SignalStateChange(demux);
+      renderer.Flush();
+      audio.Stop();
+      video.Stop();
+      stopLatency.Add(Now()-start);
+      outOfOrder+=audio.Stats().outOfOrder+video.Stats().outOfOrder;
+      audio.Stats().outOfOrder=video.Stats().outOfOrder=0;
+
+      filter.m_bStreamCompensated=false;
+      demux.m_bAudioVideoReady=false;
+      demux.FlushAudio();
+      demux.FlushVideo();
+      reader.SetFilePointer(position, FILE_BEGIN);
+      filter.m_bSeeking=false;
+      SignalStateChange(demux);
+      audio.Run(false);
+      video.Run(false);
+      Sleep((DWORD)(SEEK_S*1000));
+
+      if (audio.First()==0 || video.First()==0) missing++;
+      if (audio.First()!=0) audioLatency.Add(audio.First()-start);
+      if (video.First()!=0) videoLatency.Add(video.First()-start);
+    }
+    filter.m_bStopping=true;
+    SignalStateChange(demux);
+    audio.Stop();
+    video.Stop();
+    outOfOrder+=audio.Stats().outOfOrder+video.Stats().outOfOrder;
+  }
+
+  bool ok=Check("seek", missing==0 && audioLatency.MaxMs() < SEEK_MAX_MS && videoLatency.MaxMs() < SEEK_MAX_MS,
+                "%d: pins stop in %.1f ms, max %.1f; first audio %.0f ms, max %.0f; video %.0f, max %.0f", seeks,
+                stopLatency.MeanMs(), stopLatency.MaxMs(), audioLatency.MeanMs(), audioLatency.MaxMs(),
+                videoLatency.MeanMs(), videoLatency.MaxMs());
+  ok&=Check("seek order", outOfOrder==0, "%d samples out of order", outOfOrder);
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  int zaps=(argc > 1 ? atoi(argv[1]) : 3);
+  int seeks=(argc > 2 ? atoi(argv[2]) : 6);
+  CStreamGenerator generator;
+  bool ok=Zaps(generator, zaps);
+  ok&=Seeks(generator, seeks);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+/*
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Replays synthetic DVB subtitle PES packets through CDVBSubDecoder and hashes
+// the subtitle bitmaps it makes.
+//
+//   dvbsubreplay [expected hash]
+//
+// The stream is the same on every run: an SD and an HD service, each with pages
+// of one to three regions holding run length coded objects that stay inside
+// their region and the screen, two CLUTs, pages the decoder has to ignore and
+// empty pages. The bitmaps are compared as they would be shown: every non empty
+// scanline is hashed with its screen line, so a bitmap cropped to the used
+// scanlines hashes like a full screen one. "make check" passes the hash of the
+// decoder before the run fill and dirty rectangle changes, see the
+// dvbsub-reference target of the Makefile. The CPU time per page is printed so
+// both builds can be compared.
+
+#include <windows.h>
+#include <stdarg.h>
+#include <string.h>
+#include <vector>
+#include "dvbsubdecoder.h"
+
+#define SD_PAGES         2000
+#define HD_PAGES         1000
+#define PAGE_TICKS       (90000*3)   // a page every 3 s
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+void LogDebugPTS(const char* /*fmt*/, uint64_t /*pts*/)
+{
+}
+
+// Writes the 4 bit pixel code strings of an object
+class CPixelWriter
+{
+public:
+  CPixelWriter(std::vector<byte>& out) : m_out(out) { m_half=false; }
+
+  void Nibble(int value)
+  {
+    if (m_half)
+      m_out.back()|=(byte)(value & 0x0f);
+    else
+      m_out.push_back((byte)(value<<4));
+    m_half=!m_half;
+  }
+
+  void Run(int code, int length)
+  {
+    while (length > 0)
+    {
+      int n;
+      if (length >= 25)
+      {
+        n=min(length, 280);
+        Nibble(0); Nibble(0x0f); Nibble((n-25)>>4); Nibble((n-25) & 0x0f); Nibble(code);
+      }
+      else if (length >= 9)
+      {
+        n=length;
+        Nibble(0); Nibble(0x0e); Nibble(n-9); Nibble(code);
+      }
+      else if (length >= 4)
+      {
+        n=min(length, 7);
+        Nibble(0); Nibble(0x08 | (n-4)); Nibble(code);
+      }
+      else if (code!=0)
+      {
+        n=1;
+        Nibble(code);
+      }
+      else if (length==3)
+      {
+        n=3;
+        Nibble(0); Nibble(0x01);
+      }
+      else
+      {
+        n=length;
+        Nibble(0); Nibble(n==1 ? 0x0c : 0x0d);
+      }
+      length-=n;
+    }
+  }
+
+  // end of string, padded to a byte, then the end of line code
+  void EndLine()
+  {
+    Nibble(0); Nibble(0);
+    if (m_half) Nibble(0);
+    m_out.push_back(0xf0);
+  }
+
+private:
+  std::vector<byte>& m_out;
+  bool m_half;
+};
+
+class CSubStream
+{
+public:
+  CSubStream(int width, int height, unsigned int seed)
+  {
+    m_width=width;
+    m_height=height;
+    m_seed=seed;
+  }
+
+  // only a display definition; the decoder sizes the subtitle of a PES before it
+  // parses it, so a new screen size has to come one PES ahead of the pages
+  const std::vector<byte>& Definition()
+  {
+    Begin(0);
+    DisplayDefinition();
+    return End();
+  }
+
+  const std::vector<byte>& Page(int page)
+  {
+    Begin((UINT64)page*PAGE_TICKS+90000);
+    DisplayDefinition();
+
+    // the first page and every 10th one are acquisition points with new CLUTs,
+    // every 7th is a normal case page the decoder drops, every 13th is empty
+    bool acquisition=(page % 10==0);
+    int state=acquisition ? 2 : (page % 7==3 ? 0 : 1);
+    int regionCount=(page % 13==5) ? 0 : 1+Next(3);
+
+    int lineHeight=m_height/12;
+    struct { int id, x, y, width, height, clut; } regions[3];
+    for (int r=0; r < regionCount;++r)
+    {
+      regions[r].id=r;
+      regions[r].width=m_width/3+Next(m_width/2);
+      regions[r].height=lineHeight/2+Next(lineHeight/2);
+      regions[r].x=Next(m_width-regions[r].width);
+      regions[r].y=m_height-(r+1)*lineHeight-Next(lineHeight/4);
+      if (r==2) regions[r].y=Next(lineHeight); // an extra line at the top
+      regions[r].clut=Next(2);
+    }
+
+    std::vector<byte> pcs;
+    pcs.push_back((byte)(2+Next(5)));
+    pcs.push_back((byte)(((page & 0x0f)<<4) | (state<<2)));
+    for (int r=0; r < regionCount;++r)
+    {
+      pcs.push_back((byte)regions[r].id);
+      pcs.push_back(0xff);
+      Add16(pcs, regions[r].x);
+      Add16(pcs, regions[r].y);
+    }
+    Segment(0x10, pcs);
+
+    if (acquisition)
+    {
+      for (int clut=0; clut < 2;++clut)
+      {
+        std::vector<byte> cds;
+        cds.push_back((byte)clut);
+        cds.push_back((byte)((page & 0x0f)<<4));
+        for (int entry=0; entry < 16;++entry)
+        {
+          cds.push_back((byte)entry);
+          cds.push_back(0x41); // 4 bit entry, full range
+          bool transparent=(clut==0 && entry==0);
+          cds.push_back(transparent ? 0 : (byte)(16+Next(220)));
+          cds.push_back((byte)(16+Next(225)));
+          cds.push_back((byte)(16+Next(225)));
+          cds.push_back((byte)(Next(4)==0 ? Next(256) : 0));
+        }
+        Segment(0x12, cds);
+      }
+    }
+
+    std::vector<byte> objects;
+    int objectId=page*8;
+    for (int r=0; r < regionCount;++r)
+    {
+      std::vector<byte> rcs;
+      rcs.push_back((byte)regions[r].id);
+      bool fill=Next(2)==1;
+      rcs.push_back((byte)(((page & 0x0f)<<4) | (fill ? 0x08 : 0)));
+      Add16(rcs, regions[r].width);
+      Add16(rcs, regions[r].height);
+      rcs.push_back((byte)((3<<5) | (2<<2))); // level 3, 4 bit depth
+      rcs.push_back((byte)regions[r].clut);
+      rcs.push_back(0);
+      rcs.push_back((byte)(Next(4)<<4));
+
+      int count=1+Next(2);
+      for (int o=0; o < count;++o)
+      {
+        int width=regions[r].width/(count+1)+Next(regions[r].width/(count+1));
+        int height=regions[r].height/2+Next(regions[r].height/2);
+        int x=o*regions[r].width/count+Next(regions[r].width/count-width/count);
+        x=min(x, regions[r].width-width);
+        int y=Next(regions[r].height-height+1);
+        int id=objectId++;
+        Add16(rcs, id);
+        rcs.push_back((byte)(x>>8));
+        rcs.push_back((byte)x);
+        rcs.push_back((byte)(y>>8));
+        rcs.push_back((byte)y);
+        Object(objects, id, width, height);
+      }
+      Segment(0x11, rcs);
+    }
+    m_pes.insert(m_pes.end(), objects.begin(), objects.end());
+
+    std::vector<byte> end;
+    Segment(0x80, end);
+    return End();
+  }
+
+private:
+  void Begin(UINT64 pts)
+  {
+    byte header[]={ 0x00, 0x00, 0x01, 0xbd, 0x00, 0x00, 0x80, 0x80, 0x05,
+                    (byte)(0x21 | ((pts>>29) & 0x0e)), (byte)(pts>>22), (byte)(0x01 | ((pts>>14) & 0xfe)),
+                    (byte)(pts>>7), (byte)(0x01 | ((pts<<1) & 0xfe)), 0x20, 0x00 };
+    m_pes.assign(header, header+sizeof(header));
+  }
+
+  const std::vector<byte>& End()
+  {
+    m_pes.push_back(0xff);
+    m_pes[4]=(byte)((m_pes.size()-6)>>8);
+    m_pes[5]=(byte)(m_pes.size()-6);
+    return m_pes;
+  }
+
+  void DisplayDefinition()
+  {
+    if (m_width!=720 || m_height!=576)
+    {
+      std::vector<byte> dds;
+      dds.push_back(0x00);
+      Add16(dds, m_width-1);
+      Add16(dds, m_height-1);
+      Segment(0x14, dds);
+    }
+  }
+
+  int Next(int range)
+  {
+    m_seed=m_seed*1103515245+12345;
+    return range > 0 ? (int)((m_seed>>8) % (unsigned int)range) : 0;
+  }
+
+  static void Add16(std::vector<byte>& out, int value)
+  {
+    out.push_back((byte)(value>>8));
+    out.push_back((byte)value);
+  }
+
+  // text like lines: background with glyph runs, top field and bottom field
+  void Object(std::vector<byte>& out, int id, int width, int height)
+  {
+    std::vector<byte> fields[2];
+    for (int field=0; field < 2;++field)
+    {
+      CPixelWriter writer(fields[field]);
+      for (int line=field; line < height; line+=2)
+      {
+        fields[field].push_back(0x11);
+        int x=0;
+        while (x < width)
+        {
+          int length=min(width-x, 1+Next(Next(4)==0 ? 300 : 12));
+          int code=Next(3)==0 ? 0 : 1+Next(15);
+          writer.Run(code, length);
+          x+=length;
+        }
+        writer.EndLine();
+      }
+    }
+
+    std::vector<byte> ods;
+    Add16(ods, id);
+    ods.push_back(0x00); // pixel coded
+    Add16(ods, (int)fields[0].size());
+    Add16(ods, (int)fields[1].size());
+    ods.insert(ods.end(), fields[0].begin(), fields[0].end());
+    ods.insert(ods.end(), fields[1].begin(), fields[1].end());
+
+    std::vector<byte> pes;
+    pes.swap(m_pes);
+    Segment(0x13, ods);
+    pes.swap(m_pes);
+    out.insert(out.end(), pes.begin(), pes.end());
+  }
+
+  void Segment(int type, const std::vector<byte>& payload)
+  {
+    m_pes.push_back(0x0f);
+    m_pes.push_back((byte)type);
+    Add16(m_pes, 1);
+    Add16(m_pes, (int)payload.size());
+    m_pes.insert(m_pes.end(), payload.begin(), payload.end());
+  }
+
+  int m_width;
+  int m_height;
+  unsigned int m_seed;
+  std::vector<byte> m_pes;
+};
+
+struct ReplayResult
+{
+  int    pages;
+  int    subtitles;
+  UINT64 hash;
+  double cpu;
+};
+
+static void Hash(UINT64& hash, const void* data, size_t len)
+{
+  const byte* p=(const byte*)data;
+  for (size_t i=0; i < len;++i) hash=(hash ^ p[i])*1099511628211ULL;
+}
+
+// hashes the non empty scanlines of a subtitle with their screen line
+static void HashSubtitle(UINT64& hash, CSubtitle* subtitle)
+{
+  BITMAP* bitmap=subtitle->GetBitmap();
+  UINT64 pts=subtitle->PTS();
+  Hash(hash, &pts, sizeof(pts));
+  int first=max(subtitle->FirstScanline(), 0);
+  int stride=bitmap->bmWidth*4;
+  const byte* bits=(const byte*)bitmap->bmBits;
+  for (int line=0; line < bitmap->bmHeight;++line)
+  {
+    const byte* row=&bits[line*stride];
+    bool empty=true;
+    for (int x=0; x < stride && empty;++x) empty=(row[x]==0);
+    if (empty) continue;
+    int screenLine=first+line;
+    Hash(hash, &screenLine, sizeof(screenLine));
+    Hash(hash, row, stride);
+  }
+}
+
+static void Replay(CDVBSubDecoder* decoder, int width, int height, int pages, unsigned int seed, ReplayResult& result)
+{
+  CSubStream stream(width, height, seed);
+  const std::vector<byte>& definition=stream.Definition();
+  decoder->ProcessPES(&definition[0], (int)definition.size(), 0x100);
+  for (int page=0; page < pages;++page)
+  {
+    const std::vector<byte>& pes=stream.Page(page);
+    clock_t start=clock();
+    decoder->ProcessPES(&pes[0], (int)pes.size(), 0x100);
+    result.cpu+=(double)(clock()-start)/CLOCKS_PER_SEC;
+    result.pages++;
+    while (decoder->GetSubtitleCount() > 0)
+    {
+      HashSubtitle(result.hash, decoder->GetSubtitle(0));
+      decoder->ReleaseOldestSubtitle();
+      result.subtitles++;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* expected=argc > 1 ? argv[1] : NULL;
+
+  ReplayResult sd={ 0, 0, 1469598103934665603ULL, 0 };
+  ReplayResult hd=sd;
+  CDVBSubDecoder* decoder=new CDVBSubDecoder();
+  decoder->Reset();
+  Replay(decoder, 720, 576, SD_PAGES, 1, sd);
+  hd.hash=sd.hash;
+  Replay(decoder, 1920, 1080, HD_PAGES, 2, hd);
+  delete decoder;
+
+  char hash[17];
+  sprintf(hash, "%016llx", (unsigned long long)hd.hash);
+  bool ok=(expected==NULL || strcmp(expected, hash)==0);
+  printf("sd: %d pages, %d subtitles, %.1f us cpu per page\n", sd.pages, sd.subtitles, sd.cpu*1e6/sd.pages);
+  printf("hd: %d pages, %d subtitles, %.1f us cpu per page\n", hd.pages, hd.subtitles, hd.cpu*1e6/hd.pages);
+  printf("bitmap hash %s  %s\n", hash, expected==NULL ? "" : ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
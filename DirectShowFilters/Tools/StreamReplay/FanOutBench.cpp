@@ -0,0 +1,287 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Times the fan-out of CMpTs::AnalyzeTsPacket(): every packet of a mux goes to
+// the listeners of each channel and to the channel scan.
+//
+//   fanoutbench [channels] [seconds]
+//
+// The mux is synthetic and the same on every run: 8 services of 120 video, 5
+// audio and 2 teletext packets every 40 ms, the PAT, the CAT and the PMTs every
+// 200 ms and some null packets, 26,000 packets a second. The video of service 1
+// is scrambled. Each channel is tuned to a service the way CTsChannel is: the
+// video analyzer, the PMT grabber, the teletext grabber and the CA grabber get
+// every packet in that order. The recorder and the timeshifter are left out,
+// they return before looking at the packet while they are stopped. A CPatParser
+// scans the mux next to the channels.
+// The driver fails if a channel misses its PMT or CAT, gets the wrong number of
+// teletext callbacks or the wrong scrambling state, or the scan misses a
+// service. "make fanout-reference" runs it against the listeners from before
+// they were handed a decoded header.
+
+#include <windows.h>
+#include <stdarg.h>
+#include <streams.h>
+#include "SiTables.h"
+#include "patparser.h"
+#include "videoanalyzer.h"
+#include "pmtgrabber.h"
+#include "cagrabber.h"
+#include "teletextgrabber.h"
+#ifndef FANOUT_BASE
+#include "tspacketview.h"
+#endif
+
+#define SERVICES         8
+#define SCRAMBLED        1           // the service with scrambled video
+#define SLOTS            25          // 40 ms each
+#define VIDEO_PACKETS    120         // a slot
+#define AUDIO_PACKETS    5
+#define TEXT_PACKETS     2
+#define NULL_PACKETS     20
+#define PSI_EVERY        5           // slots
+#define PID_CAT          1
+#define PID_NULL         0x1fff
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+bool DisableCRCCheck()
+{
+  return false;
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+// counts the callbacks of one grabber
+class CPmtCount : public IPMTCallback
+{
+public:
+  CPmtCount() { m_count=0; }
+  STDMETHODIMP OnPMTReceived(int /*pmtPid*/) { m_count++; return S_OK; }
+  int m_count;
+};
+
+class CCaCount : public ICACallback
+{
+public:
+  CCaCount() { m_count=0; }
+  STDMETHODIMP OnCaReceived() { m_count++; return S_OK; }
+  int m_count;
+};
+
+class CTeletextCount : public ITeletextCallBack
+{
+public:
+  CTeletextCount() { m_count=0; }
+  STDMETHODIMP OnTeletextReceived(BYTE* /*data*/, int /*packetCounts*/) { m_count++; return S_OK; }
+  int m_count;
+};
+
+// the listeners of one CTsChannel
+class CReplayChannel
+{
+public:
+  CReplayChannel(const SiService& service)
+    : m_analyzer(NULL, NULL), m_pmtGrabber(NULL, NULL), m_teletextGrabber(NULL, NULL), m_caGrabber(NULL, NULL)
+  {
+    m_analyzer.SetVideoPid(service.pmtPid+1);
+    m_analyzer.SetAudioPid(service.pmtPid+2);
+    m_pmtGrabber.SetPmtPid(service.pmtPid, service.serviceId);
+    m_pmtGrabber.SetCallBack(&m_pmtCount);
+    m_teletextGrabber.Start();
+    m_teletextGrabber.SetTeletextPid(service.pmtPid+3);
+    m_teletextGrabber.SetCallBack(&m_teletextCount);
+    m_caGrabber.SetCallBack(&m_caCount);
+  }
+
+  template <class P> void OnTsPacket(P packet)
+  {
+    m_analyzer.OnTsPacket(packet);
+    m_pmtGrabber.OnTsPacket(packet);
+    m_teletextGrabber.OnTsPacket(packet);
+    m_caGrabber.OnTsPacket(packet);
+  }
+
+  CVideoAnalyzer   m_analyzer;
+  CPmtGrabber      m_pmtGrabber;
+  CTeletextGrabber m_teletextGrabber;
+  CCaGrabber       m_caGrabber;
+  CPmtCount        m_pmtCount;
+  CCaCount         m_caCount;
+  CTeletextCount   m_teletextCount;
+};
+
+class CMuxGenerator
+{
+public:
+  CMuxGenerator()
+  {
+    memset(m_continuity, 0, sizeof(m_continuity));
+    m_seed=1;
+    m_ts.transportId=1;
+    m_ts.networkId=1;
+    for (int i=0; i < SERVICES;++i)
+    {
+      SiService service;
+      service.serviceId=100+i;
+      service.pmtPid=0x100+i*0x10;
+      service.serviceType=1;
+      service.lcn=0;
+      m_ts.services.push_back(service);
+    }
+  }
+
+  // one second of the mux
+  void Make(vector<byte>& packets)
+  {
+    packets.clear();
+    for (int slot=0; slot < SLOTS;++slot)
+    {
+      if (slot%PSI_EVERY==0)
+      {
+        CSiTables::Packetize(CSiTables::Pat(m_ts, 1), PID_PAT, m_continuity[PID_PAT], packets);
+        CSiTables::Packetize(Cat(), PID_CAT, m_continuity[PID_CAT], packets);
+        for (int i=0; i < SERVICES;++i)
+        {
+          const SiService& service=m_ts.services[i];
+          CSiTables::Packetize(CSiTables::Pmt(service, 1), service.pmtPid, m_continuity[service.pmtPid], packets);
+        }
+      }
+      for (int i=0; i < SERVICES;++i)
+      {
+        int pid=m_ts.services[i].pmtPid;
+        for (int k=0; k < VIDEO_PACKETS;++k) Pes(packets, pid+1, 0xe0, k==0, i==SCRAMBLED);
+        for (int k=0; k < AUDIO_PACKETS;++k) Pes(packets, pid+2, 0xc0, k==0, false);
+        for (int k=0; k < TEXT_PACKETS;++k) Pes(packets, pid+3, 0xbd, k==0, false);
+      }
+      for (int k=0; k < NULL_PACKETS;++k) Pes(packets, PID_NULL, 0, false, false);
+    }
+  }
+
+  const SiService& Service(int i) { return m_ts.services[i]; }
+
+private:
+  unsigned int Random()
+  {
+    m_seed=m_seed*1664525+1013904223;
+    return m_seed>>8;
+  }
+
+  // a ca descriptor for one system
+  static Section Cat()
+  {
+    Section s=CSiTables::Begin(0x01, 0xffff, 1, 0, 0);
+    byte descriptor[]={ 0x09, 4, 0x01, 0x00, 0xe1, 0xff };
+    s.insert(s.end(), descriptor, descriptor+sizeof(descriptor));
+    CSiTables::Finish(s);
+    return s;
+  }
+
+  void Pes(vector<byte>& packets, int pid, int streamId, bool start, bool scrambled)
+  {
+    size_t pos=packets.size();
+    packets.resize(pos+188);
+    byte* packet=&packets[pos];
+    packet[0]=0x47;
+    packet[1]=(byte)((start ? 0x40 : 0) | (pid>>8));
+    packet[2]=(byte)(pid&0xff);
+    packet[3]=(byte)((scrambled ? 0x80 : 0) | 0x10 | (m_continuity[pid]++ & 0x0f));
+    for (int i=4; i < 188;++i) packet[i]=(byte)Random();
+    if (start)
+    {
+      packet[4]=0; packet[5]=0; packet[6]=1; packet[7]=(byte)streamId;
+      packet[8]=0; packet[9]=0;
+    }
+  }
+
+  SiTransport m_ts;
+  BYTE        m_continuity[0x2000];
+  unsigned    m_seed;
+};
+
+static void FanOut(vector<CReplayChannel*>& channels, CPatParser& scanner, byte* tsPacket)
+{
+#ifdef FANOUT_BASE
+  // every listener decoded the header itself
+  byte* packet=tsPacket;
+#else
+  TsPacketView packet(tsPacket);
+#endif
+  for (size_t i=0; i < channels.size();++i)
+    channels[i]->OnTsPacket(packet);
+  scanner.OnTsPacket(packet);
+}
+
+int main(int argc, char** argv)
+{
+  int channelCount=(argc > 1 ? atoi(argv[1]) : 4);
+  int seconds=(argc > 2 ? atoi(argv[2]) : 60);
+  if (channelCount < 1 || channelCount > SERVICES) channelCount=4;
+
+  CMuxGenerator generator;
+  vector<byte> mux;
+  generator.Make(mux);
+  int packets=(int)(mux.size()/188);
+
+  vector<CReplayChannel*> channels;
+  for (int i=0; i < channelCount;++i)
+    channels.push_back(new CReplayChannel(generator.Service(i)));
+  CPatParser* scanner=new CPatParser();
+  scanner->Reset(NULL, false);
+
+  double start=Now();
+  for (int second=0; second < seconds;++second)
+  {
+    for (int p=0; p < packets;++p)
+      FanOut(channels, *scanner, &mux[p*188]);
+  }
+  double time=Now()-start;
+  double perPacket=time*1e9/((double)packets*seconds);
+
+  bool ok=(scanner->Count()==SERVICES);
+  int teletext=seconds*SLOTS*TEXT_PACKETS/25;
+  for (int i=0; i < channelCount;++i)
+  {
+    CReplayChannel& channel=*channels[i];
+    int scrambled=0;
+    channel.m_analyzer.IsVideoEncrypted(&scrambled);
+    bool channelOk=(channel.m_pmtCount.m_count==1 && channel.m_caCount.m_count==1 &&
+                    channel.m_teletextCount.m_count==teletext && scrambled==(i==SCRAMBLED ? 1 : 0));
+    printf("channel %d: pmt %d, cat %d, %d teletext callbacks, video %s  %s\n", i, channel.m_pmtCount.m_count,
+           channel.m_caCount.m_count, channel.m_teletextCount.m_count, scrambled ? "scrambled" : "clear",
+           channelOk ? "ok" : "FAILED");
+    ok=ok && channelOk;
+  }
+  printf("%d channels, %d packets a second for %d s: %.1f ns a packet, %.1f ns a packet and channel, "
+         "scan found %d services  %s\n", channelCount, packets, seconds, perPacket, perPacket/channelCount,
+         scanner->Count(), ok ? "ok" : "FAILED");
+
+  delete scanner;
+  for (int i=0; i < channelCount;++i) delete channels[i];
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,400 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Injects faults into a synthetic mux, checks that CStreamHealthMonitor counts
+// them, and times the monitor.
+//
+//   healthreplay [benchmark seconds]
+//
+// The mux runs at 10 Mbit/s. It has a PAT and a PMT every 100 ms, video on pid
+// 0x101 with a pcr every 30 ms, audio on 0x102 and null packets. The tick count
+// follows the stream. Each run sends 20 s of it with one kind of fault and
+// compares the counters with what was injected:
+// - continuity gaps, and duplicate packets which are allowed
+// - alternating pcr jitter, and pcrs left out
+// - PAT and PMT dropouts
+// - transport error indicators
+// - scrambled audio
+// The benchmark sends the clean mux through the monitor on the real clock and
+// reports the time a packet takes on top of decoding the header, for the given
+// seconds of stream in each of its 5 runs.
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "streamhealthmonitor.h"
+
+using namespace std;
+
+#define MUX_BITRATE   10000000
+#define PACKET_US     (188*8*1e6/MUX_BITRATE)
+#define STREAM_MS     20000
+#define PAT_PID       0x0
+#define PMT_PID       0x100
+#define VIDEO_PID     0x101
+#define AUDIO_PID     0x102
+#define NULL_PID      0x1fff
+#define TABLE_MS      100
+#define PCR_MS        30
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+struct Faults
+{
+  int ccGaps;            // audio packets replaced by null packets
+  int duplicates;        // audio packets sent twice
+  int pcrJitter;         // ns, added to the pcrs with alternating sign
+  int pcrGaps;           // pcrs left out
+  int patDropout;        // ms without PAT, once
+  int pmtDropout;        // ms without PMT, once
+  int transportErrors;   // video packets with the transport error indicator
+  bool scrambledAudio;
+};
+
+// times of n faults spread over the stream
+class CFaultTimes
+{
+public:
+  CFaultTimes(int count)
+  {
+    for (int i=0; i < count;++i) m_times.push_back((double)(i+1)*STREAM_MS/(count+1));
+    m_next=0;
+  }
+
+  bool Due(double ms)
+  {
+    if (m_next >= m_times.size() || ms < m_times[m_next]) return false;
+    m_next++;
+    return true;
+  }
+
+private:
+  vector<double> m_times;
+  size_t         m_next;
+};
+
+class CMuxGenerator
+{
+public:
+  CMuxGenerator(const Faults& faults)
+    : m_faults(faults), m_ccGaps(faults.ccGaps), m_duplicates(faults.duplicates), m_pcrGaps(faults.pcrGaps),
+      m_transportErrors(faults.transportErrors)
+  {
+    memset(m_continuity, 0, sizeof(m_continuity));
+    m_nextTable=0;
+    m_nextPcr=0;
+    m_pcrCount=0;
+    m_audioPackets=0;
+  }
+
+  // the whole stream, the tick count of each packet in ticks
+  void Make(vector<byte>& packets, vector<DWORD>& ticks)
+  {
+    packets.clear();
+    ticks.clear();
+    for (LONGLONG n=0;;++n)
+    {
+      double ms=n*PACKET_US/1000;
+      if (ms >= STREAM_MS) break;
+      ticks.push_back((DWORD)ms);
+      Slot(n, ms, packets);
+      if (m_duplicate)
+      {
+        // the same packet again in the next slot
+        packets.insert(packets.end(), packets.end()-188, packets.end());
+        ticks.push_back((DWORD)((++n)*PACKET_US/1000));
+      }
+    }
+  }
+
+  int AudioPackets() { return m_audioPackets; }
+
+private:
+  void Slot(LONGLONG n, double ms, vector<byte>& packets)
+  {
+    m_duplicate=false;
+    if (ms >= m_nextTable)
+    {
+      if (m_tablePid==PAT_PID)
+      {
+        m_tablePid=PMT_PID;
+        if (!Dropped(ms, m_faults.patDropout)) { Pat(packets); return; }
+      }
+      m_tablePid=PAT_PID;
+      m_nextTable+=TABLE_MS;
+      if (!Dropped(ms, m_faults.pmtDropout)) { Pmt(packets); return; }
+    }
+    if (ms >= m_nextPcr)
+    {
+      m_nextPcr+=PCR_MS;
+      if (!m_pcrGaps.Due(ms))
+      {
+        // 27 MHz, the packet time of slot n
+        LONGLONG pcr=(LONGLONG)(n*PACKET_US*27+0.5);
+        if (m_faults.pcrJitter) pcr+=(m_pcrCount & 1 ? 1 : -1)*(LONGLONG)m_faults.pcrJitter*27/1000;
+        m_pcrCount++;
+        Packet(packets, VIDEO_PID, false, pcr);
+        return;
+      }
+    }
+    switch (n % 10)
+    {
+      case 0:
+      case 5:
+        if (m_ccGaps.Due(ms))
+        {
+          m_continuity[AUDIO_PID]++;
+          Packet(packets, NULL_PID, false, -1);
+          return;
+        }
+        m_duplicate=m_duplicates.Due(ms);
+        m_audioPackets+=(m_duplicate ? 2 : 1);
+        Packet(packets, AUDIO_PID, m_faults.scrambledAudio, -1);
+        return;
+      case 9:
+        Packet(packets, NULL_PID, false, -1);
+        return;
+    }
+    Packet(packets, VIDEO_PID, false, -1);
+    if (m_transportErrors.Due(ms)) packets[packets.size()-188+1]|=0x80;
+  }
+
+  // the dropout starts at a third of the stream
+  static bool Dropped(double ms, int dropout)
+  {
+    return ms >= STREAM_MS/3 && ms < STREAM_MS/3+dropout;
+  }
+
+  void Pat(vector<byte>& packets)
+  {
+    byte section[]={ 0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00, 0x00, 0x01, 0xe0 | (PMT_PID>>8), PMT_PID & 0xff,
+                     0, 0, 0, 0 };
+    Section(packets, PAT_PID, section, sizeof(section));
+  }
+
+  void Pmt(vector<byte>& packets)
+  {
+    byte section[]={ 0x02, 0xb0, 0x17, 0x00, 0x01, 0xc1, 0x00, 0x00, 0xe0 | (VIDEO_PID>>8), VIDEO_PID & 0xff, 0xf0, 0x00,
+                     0x02, 0xe0 | (VIDEO_PID>>8), VIDEO_PID & 0xff, 0xf0, 0x00,
+                     0x03, 0xe0 | (AUDIO_PID>>8), AUDIO_PID & 0xff, 0xf0, 0x00, 0, 0, 0, 0 };
+    Section(packets, PMT_PID, section, sizeof(section));
+  }
+
+  // the monitor does not check the crc
+  void Section(vector<byte>& packets, int pid, const byte* section, int len)
+  {
+    byte* packet=Packet(packets, pid, false, -1);
+    packet[1]|=0x40;
+    memset(&packet[4], 0xff, 184);
+    packet[4]=0;
+    memcpy(&packet[5], section, len);
+  }
+
+  byte* Packet(vector<byte>& packets, int pid, bool scrambled, LONGLONG pcr)
+  {
+    size_t at=packets.size();
+    packets.resize(at+188);
+    byte* packet=&packets[at];
+    packet[0]=0x47;
+    packet[1]=(byte)(pid>>8);
+    packet[2]=(byte)(pid & 0xff);
+    packet[3]=(byte)((scrambled ? 0x80 : 0) | (pcr >= 0 ? 0x30 : 0x10) | (m_continuity[pid]++ & 0x0f));
+    memset(&packet[4], 0x55, 184);
+    if (pcr >= 0)
+    {
+      LONGLONG base=pcr/300;
+      int extension=(int)(pcr%300);
+      packet[4]=7;
+      packet[5]=0x10;
+      packet[6]=(byte)(base>>25);
+      packet[7]=(byte)(base>>17);
+      packet[8]=(byte)(base>>9);
+      packet[9]=(byte)(base>>1);
+      packet[10]=(byte)(((base & 1)<<7) | 0x7e | (extension>>8));
+      packet[11]=(byte)(extension & 0xff);
+    }
+    return packet;
+  }
+
+  Faults      m_faults;
+  CFaultTimes m_ccGaps;
+  CFaultTimes m_duplicates;
+  CFaultTimes m_pcrGaps;
+  CFaultTimes m_transportErrors;
+  BYTE        m_continuity[0x2000];
+  int         m_tablePid;
+  double      m_nextTable;
+  double      m_nextPcr;
+  int         m_pcrCount;
+  int         m_audioPackets;
+  bool        m_duplicate;
+};
+
+static void Replay(CStreamHealthMonitor& monitor, CMuxGenerator& generator)
+{
+  vector<byte> packets;
+  vector<DWORD> ticks;
+  generator.Make(packets, ticks);
+  monitor.Reset();
+  for (size_t p=0; p < ticks.size();++p)
+  {
+    ReplayTickCount()=ticks[p];
+    monitor.OnTsPacket(TsPacketView(&packets[p*188]));
+  }
+}
+
+static bool Check(const char* name, bool ok, const char* fmt, ...)
+{
+  char text[256];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(text, sizeof(text), fmt, ap);
+  va_end(ap);
+  printf("%-18s %-72s %s\n", name, text, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool Run(CStreamHealthMonitor& monitor, const char* name, const Faults& faults)
+{
+  CMuxGenerator generator(faults);
+  Replay(monitor, generator);
+
+  PidHealth pat, pmt, video, audio;
+  if (!monitor.GetHealth(PAT_PID, &pat) || !monitor.GetHealth(PMT_PID, &pmt) || !monitor.GetHealth(VIDEO_PID, &video) ||
+      !monitor.GetHealth(AUDIO_PID, &audio))
+    return Check(name, false, "a pid is missing");
+
+  int errors=video.continuityErrors+pat.continuityErrors+pmt.continuityErrors;
+  bool ok=(errors==0 && audio.continuityErrors==faults.ccGaps && video.transportErrors==faults.transportErrors);
+  bool tablesOk=(pat.tableRepetitionErrors==(faults.patDropout > TABLE_MS*5 ? 1 : 0) &&
+                 pmt.tableRepetitionErrors==(faults.pmtDropout > TABLE_MS*5 ? 1 : 0) &&
+                 pat.tableMaxInterval <= TABLE_MS+faults.patDropout+TABLE_MS &&
+                 pat.tableMaxInterval >= TABLE_MS+faults.patDropout-TABLE_MS);
+  // the model predicts each pcr from the last one, so alternating jitter shows twice
+  bool pcrOk=(video.pcrRepetitionErrors==faults.pcrGaps && video.pcrDiscontinuities==0 &&
+              (faults.pcrJitter ? abs(video.pcrJitter-2*faults.pcrJitter) < faults.pcrJitter/4 : video.pcrJitter < 50));
+  bool scrambledOk=(audio.scrambled==(faults.scrambledAudio ? 1 : 0) &&
+                    audio.scrambledPackets==(faults.scrambledAudio ? generator.AudioPackets() : 0) &&
+                    video.scrambled==0 && video.scrambledPackets==0);
+  // 7 of every 10 slots are video or pcr, less the tables
+  int expectedBitrate=MUX_BITRATE/10*2;
+  bool bitrateOk=(abs(audio.averageBitrate-expectedBitrate) < expectedBitrate/50 &&
+                  abs(audio.bitrate-expectedBitrate) < expectedBitrate/20);
+
+  return Check(name, ok && tablesOk && pcrOk && scrambledOk && bitrateOk,
+               "cc %d/%d tei %d pat %d/%d ms pmt %d/%d ms pcr %d/%d jitter %d ns audio %d kbit/s",
+               audio.continuityErrors, errors, video.transportErrors, pat.tableRepetitionErrors, pat.tableMaxInterval,
+               pmt.tableRepetitionErrors, pmt.tableMaxInterval, video.pcrRepetitionErrors, video.pcrCount,
+               video.pcrJitter, audio.averageBitrate/1000);
+}
+
+// the packets come in hot from the tuner buffer, so the benchmark loops over
+// half a second of the mux, which stays in the cache; the best of 5 runs
+static void Benchmark(CStreamHealthMonitor& monitor, int seconds)
+{
+  Faults clean={};
+  CMuxGenerator generator(clean);
+  vector<byte> packets;
+  vector<DWORD> ticks;
+  generator.Make(packets, ticks);
+  int count=(int)(500*1000/PACKET_US);
+  int passes=max(1, seconds*2);
+  ReplayTickCount()=-1;
+  monitor.Reset();
+
+  double header=1e9;
+  double total=1e9;
+  int pids=0;
+  for (int run=0; run < 5;++run)
+  {
+    // the header is decoded for all listeners anyway
+    double start=Now();
+    for (int pass=0; pass < passes;++pass)
+    {
+      for (int p=0; p < count;++p)
+      {
+        TsPacketView view(&packets[p*188]);
+        pids+=view.Pid+view.HasPcr();
+      }
+    }
+    header=min(header, Now()-start);
+
+    start=Now();
+    for (int pass=0; pass < passes;++pass)
+    {
+      for (int p=0; p < count;++p)
+      {
+        TsPacketView view(&packets[p*188]);
+        pids+=view.Pid+view.HasPcr();
+        monitor.OnTsPacket(view);
+      }
+    }
+    total=min(total, Now()-start);
+  }
+  double packetsDone=(double)count*passes;
+  printf("%.0f packets: header %.2f ns a packet, with the monitor %.2f ns, the monitor %.2f ns a packet "
+         "(target 5 ns)%s\n", packetsDone, header*1e9/packetsDone, total*1e9/packetsDone,
+         (total-header)*1e9/packetsDone, (pids & 1) ? " " : "");
+}
+
+int main(int argc, char** argv)
+{
+  int seconds=(argc > 1 ? atoi(argv[1]) : 200);
+  CStreamHealthMonitor* monitor=new CStreamHealthMonitor();
+
+  Faults clean={};
+  Faults continuity={};
+  continuity.ccGaps=7;
+  continuity.duplicates=5;
+  Faults jitter={};
+  jitter.pcrJitter=2000;
+  Faults pcrGaps={};
+  pcrGaps.pcrGaps=4;
+  Faults tables={};
+  tables.patDropout=2000;
+  tables.pmtDropout=800;
+  Faults transport={};
+  transport.transportErrors=9;
+  Faults scrambled={};
+  scrambled.scrambledAudio=true;
+
+  bool ok=Run(*monitor, "clean", clean);
+  ok&=Run(*monitor, "cc gaps, dups", continuity);
+  ok&=Run(*monitor, "pcr jitter 2 us", jitter);
+  ok&=Run(*monitor, "pcr gaps", pcrGaps);
+  ok&=Run(*monitor, "table dropouts", tables);
+  ok&=Run(*monitor, "transport errors", transport);
+  ok&=Run(*monitor, "scrambled audio", scrambled);
+  Benchmark(*monitor, seconds);
+  delete monitor;
+  return ok ? 0 : 1;
+}
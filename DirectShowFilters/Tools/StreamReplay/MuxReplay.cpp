@@ -0,0 +1,243 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Runs a synthetic mpeg2 service through CMultiplexer and writes the program
+// stream it makes.
+//
+//   muxreplay <GB of ts> [output.ps]
+//
+// The stream is the same on every run: 25 fps video on pid 0x100 with a pcr in
+// every frame, two mpeg audio frames per video frame on pid 0x101. When a hash is
+// given the driver fails if the program stream hashes differently. "make check"
+// passes the hash the multiplexer made before its pack output was batched, see
+// the mux-reference target of the Makefile.
+
+#include <windows.h>
+#include <stdarg.h>
+#include <string.h>
+#include "multiplexer.h"
+
+#define VIDEO_PID          0x100
+#define AUDIO_PID          0x101
+#define FRAME_TICKS        3600        // 90 kHz, 25 fps
+#define PTS_DELAY          45000
+#define MAX_FRAME_PACKETS  (1<<16)
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+class CReplayWriter : public IFileWriter
+{
+public:
+  CReplayWriter(FILE* file) { m_file=file; m_bytes=0; m_writes=0; m_hash=1469598103934665603ULL; }
+
+  void Write(byte* buffer, int len)
+  {
+    m_writes++;
+    m_bytes+=len;
+    for (int i=0; i < len;++i) m_hash=(m_hash ^ buffer[i])*1099511628211ULL;
+    if (m_file!=NULL) fwrite(buffer, 1, len, m_file);
+  }
+
+  FILE*  m_file;
+  UINT64 m_bytes;
+  UINT64 m_writes;
+  UINT64 m_hash;
+};
+
+class CStreamGenerator
+{
+public:
+  CStreamGenerator()
+  {
+    m_seed=1;
+    m_continuity[0]=0;
+    m_continuity[1]=0;
+    m_packets=new byte[MAX_FRAME_PACKETS][188];
+    m_count=0;
+  }
+
+  ~CStreamGenerator()
+  {
+    delete[] m_packets;
+  }
+
+  // one video frame and the two audio frames that go with it
+  void Frame(int frame)
+  {
+    m_count=0;
+    UINT64 time=(UINT64)frame*FRAME_TICKS;
+
+    int length=8000+Random()%30000;
+    byte* pes=m_pes;
+    pes[0]=0; pes[1]=0; pes[2]=1; pes[3]=0xe0;
+    pes[4]=0; pes[5]=0;
+    pes[6]=0x80; pes[7]=0xc0; pes[8]=10;
+    Timestamp(&pes[9], 3, time+PTS_DELAY+FRAME_TICKS);
+    Timestamp(&pes[14], 1, time+PTS_DELAY);
+    pes[19]=0; pes[20]=0; pes[21]=1; pes[22]=0xb3;
+    for (int i=23; i < length;++i) pes[i]=(byte)Random();
+    Packetize(VIDEO_PID, 0, pes, length, true, (time+PTS_DELAY/5)*300);
+
+    for (int audio=0; audio < 2;++audio)
+    {
+      length=600+Random()%200;
+      pes[0]=0; pes[1]=0; pes[2]=1; pes[3]=0xc0;
+      pes[4]=(byte)((length-6)>>8); pes[5]=(byte)((length-6)&0xff);
+      pes[6]=0x80; pes[7]=0x80; pes[8]=5;
+      Timestamp(&pes[9], 2, time+PTS_DELAY+audio*FRAME_TICKS/2);
+      for (int i=14; i < length;++i) pes[i]=(byte)Random();
+      Packetize(AUDIO_PID, 1, pes, length, false, 0);
+    }
+  }
+
+  byte* Packet(int i) { return m_packets[i]; }
+  int   Count() { return m_count; }
+
+private:
+  unsigned int Random()
+  {
+    m_seed=m_seed*1664525+1013904223;
+    return m_seed>>8;
+  }
+
+  static void Timestamp(byte* data, int marker, UINT64 value)
+  {
+    data[0]=(byte)((marker<<4) | ((value>>29)&0x0e) | 1);
+    data[1]=(byte)(value>>22);
+    data[2]=(byte)(((value>>14)&0xfe) | 1);
+    data[3]=(byte)(value>>7);
+    data[4]=(byte)(((value<<1)&0xfe) | 1);
+  }
+
+  void Packetize(int pid, int stream, byte* pes, int length, bool hasPcr, UINT64 pcr)
+  {
+    int pos=0;
+    bool first=true;
+    while (pos < length)
+    {
+      byte* tsPacket=m_packets[m_count++];
+      bool withPcr=(first && hasPcr);
+      int adaptionField=(withPcr ? 7 : -1);     // length byte of the adaption field, -1 for none
+      int room=184-(adaptionField >= 0 ? adaptionField+1 : 0);
+      int payload=min(length-pos, room);
+      if (payload < room)
+      {
+        // the last packet is stuffed
+        adaptionField=(adaptionField >= 0 ? adaptionField+room-payload : room-payload-1);
+      }
+
+      tsPacket[0]=0x47;
+      tsPacket[1]=(byte)((first ? 0x40 : 0) | (pid>>8));
+      tsPacket[2]=(byte)(pid&0xff);
+      tsPacket[3]=(byte)((adaptionField >= 0 ? 0x30 : 0x10) | (m_continuity[stream]++ & 0x0f));
+      int header=4;
+      if (adaptionField >= 0)
+      {
+        tsPacket[4]=(byte)adaptionField;
+        int fill=6;
+        if (adaptionField > 0)
+        {
+          tsPacket[5]=(withPcr ? 0x10 : 0);
+          if (withPcr)
+          {
+            UINT64 base=pcr/300;
+            UINT64 extension=pcr%300;
+            tsPacket[6]=(byte)(base>>25);
+            tsPacket[7]=(byte)(base>>17);
+            tsPacket[8]=(byte)(base>>9);
+            tsPacket[9]=(byte)(base>>1);
+            tsPacket[10]=(byte)(((base&1)<<7) | 0x7e | (extension>>8));
+            tsPacket[11]=(byte)(extension&0xff);
+            fill=12;
+          }
+          for (; fill < 5+adaptionField;++fill) tsPacket[fill]=0xff;
+        }
+        header=5+adaptionField;
+      }
+      memcpy(&tsPacket[header], &pes[pos], payload);
+      pos+=payload;
+      first=false;
+    }
+  }
+
+  unsigned int m_seed;
+  int          m_continuity[2];
+  byte         (*m_packets)[188];
+  int          m_count;
+  byte         m_pes[200000];
+};
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    printf("usage: muxreplay <GB of ts> [expected hash|-] [output.ps]\n");
+    return 1;
+  }
+  double gigabytes=atof(argv[1]);
+  const char* expected=(argc > 2 && strcmp(argv[2], "-")!=0) ? argv[2] : NULL;
+  FILE* output=NULL;
+  if (argc > 3)
+  {
+    output=fopen(argv[3], "wb");
+    if (output==NULL)
+    {
+      printf("can't create %s\n", argv[3]);
+      return 1;
+    }
+  }
+
+  CStreamGenerator* generator=new CStreamGenerator();
+  CReplayWriter writer(output);
+  CMultiplexer* multiplexer=new CMultiplexer();
+  multiplexer->SetFileWriterCallBack(&writer);
+  multiplexer->SetPcrPid(VIDEO_PID);
+  multiplexer->AddPesStream(VIDEO_PID, false, false, true);
+  multiplexer->AddPesStream(AUDIO_PID, false, true, false);
+
+  UINT64 input=0;
+  double seconds=0;
+  for (int frame=0; input < gigabytes*1e9;++frame)
+  {
+    generator->Frame(frame);
+    auto start=std::chrono::steady_clock::now();
+    for (int i=0; i < generator->Count();++i)
+    {
+      multiplexer->OnTsPacket(generator->Packet(i));
+    }
+    seconds+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    input+=generator->Count()*188;
+  }
+  multiplexer->Reset();
+
+  char hash[17];
+  sprintf(hash, "%016llx", (unsigned long long)writer.m_hash);
+  bool ok=(expected==NULL || strcmp(expected, hash)==0);
+  printf("%.2f GB of ts, %llu bytes of ps in %llu writes, hash %s, muxed in %.2f s  %s\n", input/1e9,
+         (unsigned long long)writer.m_bytes, (unsigned long long)writer.m_writes, hash, seconds,
+         expected==NULL ? "" : ok ? "ok" : "FAILED");
+  if (output!=NULL) fclose(output);
+  delete multiplexer;
+  delete generator;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Streams a synthetic service through CNetworkSink to a receiver on the
+// loopback interface, as raw udp and as rtp.
+//
+//   netsinkloopback [seconds]
+//
+// The service runs at 8 Mbit/s with a pcr every 40 ms. It is written in real
+// time, but in bursts every 20 ms like a tuner delivers it. Each packet carries
+// its sequence number and the time it was written. The receiver checks:
+// - the continuity counters of every pid, and the rtp sequence numbers
+// - that every packet arrives, and the datagram counters of the sink. The
+//   datagrams after the last pcr wait for the next one, so they are not sent
+// - the pacing: how far a datagram arrives from the stream time of its first
+//   packet, around the median, after the first second
+// - the end to end latency, which should be the send delay of the sink
+// The pacing of the input bursts is printed for comparison.
+
+#include <winsock2.h>
+#include <windows.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "networksink.h"
+
+using namespace std;
+
+#define MUX_BITRATE   8000000
+#define PACKET_S      (188*8.0/MUX_BITRATE)
+#define BURST_MS      20
+#define PCR_MS        40
+#define VIDEO_PID     0x101
+#define AUDIO_PID     0x102
+#define SEND_DELAY    0.2         // NETWORK_SEND_DELAY of the sink
+#define SETTLE_S      1.0         // the pcr clock locks in the first second
+#define PACING_MAX    0.005       // s, 99th percentile
+#define LATENCY_MAX   0.02        // s, median from the send delay
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+// what is known of a packet at the end of its payload
+struct PacketStamp
+{
+  int    sequence;
+  double written;
+};
+
+class CLoopbackReceiver
+{
+public:
+  CLoopbackReceiver(bool rtp)
+  {
+    m_rtp=rtp;
+    m_stop=false;
+    m_datagrams=0;
+    m_packets=0;
+    m_ccErrors=0;
+    m_rtpErrors=0;
+    m_sequenceErrors=0;
+    m_nextSequence=0;
+    m_lastRtpSequence=-1;
+    memset(m_continuity, -1, sizeof(m_continuity));
+
+    m_socket=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int receiveBuffer=8*1024*1024;
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    timeval timeout={ 0, 100000 };
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family=AF_INET;
+    address.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    address.sin_port=0;
+    bind(m_socket, (sockaddr*)&address, sizeof(address));
+    socklen_t length=sizeof(address);
+    getsockname(m_socket, (sockaddr*)&address, &length);
+    m_port=ntohs(address.sin_port);
+  }
+
+  ~CLoopbackReceiver()
+  {
+    close(m_socket);
+  }
+
+  void Run()
+  {
+    byte data[NETWORK_RTP_HEADER_SIZE+NETWORK_PACKETS_PER_DATAGRAM*188+1];
+    while (!m_stop)
+    {
+      int length=(int)recv(m_socket, data, sizeof(data), 0);
+      if (length <= 0) continue;
+      OnDatagram(data, length, Now());
+    }
+  }
+
+  void OnDatagram(byte* data, int length, double arrived)
+  {
+    m_datagrams++;
+    if (m_rtp)
+    {
+      int sequence=(data[2]<<8) | data[3];
+      if (length < NETWORK_RTP_HEADER_SIZE || data[0]!=0x80 || data[1]!=33 ||
+          (m_lastRtpSequence >= 0 && sequence!=((m_lastRtpSequence+1) & 0xffff)))
+        m_rtpErrors++;
+      m_lastRtpSequence=sequence;
+      data+=NETWORK_RTP_HEADER_SIZE;
+      length-=NETWORK_RTP_HEADER_SIZE;
+    }
+    if (length!=NETWORK_PACKETS_PER_DATAGRAM*188) m_rtpErrors++;
+
+    for (int p=0; p+188 <= length; p+=188)
+    {
+      byte* packet=&data[p];
+      int pid=((packet[1] & 0x1f)<<8) | packet[2];
+      int continuity=packet[3] & 0x0f;
+      if (packet[0]!=0x47 || (m_continuity[pid] >= 0 && continuity!=((m_continuity[pid]+1) & 0x0f)))
+        m_ccErrors++;
+      m_continuity[pid]=continuity;
+
+      PacketStamp stamp;
+      memcpy(&stamp, &packet[188-sizeof(stamp)], sizeof(stamp));
+      if (stamp.sequence!=m_nextSequence) m_sequenceErrors++;
+      m_nextSequence=stamp.sequence+1;
+      m_packets++;
+      if (p==0)
+      {
+        m_streamTimes.push_back(stamp.sequence*PACKET_S);
+        m_written.push_back(stamp.written);
+        m_arrived.push_back(arrived);
+      }
+    }
+  }
+
+  int              m_port;
+  volatile bool    m_stop;
+  bool             m_rtp;
+  int              m_datagrams;
+  int              m_packets;
+  int              m_ccErrors;
+  int              m_rtpErrors;
+  int              m_sequenceErrors;
+  vector<double>   m_streamTimes;   // of the first packet of each datagram
+  vector<double>   m_written;
+  vector<double>   m_arrived;
+
+private:
+  SOCKET           m_socket;
+  int              m_nextSequence;
+  int              m_lastRtpSequence;
+  int              m_continuity[0x2000];
+};
+
+// p99 of how far the times are from the stream times, around their median
+static double Pacing(const vector<double>& times, const vector<double>& streamTimes, size_t from)
+{
+  vector<double> offsets;
+  for (size_t i=from; i < times.size();++i) offsets.push_back(times[i]-streamTimes[i]);
+  if (offsets.empty()) return 0;
+  vector<double> sorted=offsets;
+  sort(sorted.begin(), sorted.end());
+  double median=sorted[sorted.size()/2];
+  for (size_t i=0; i < offsets.size();++i) offsets[i]=fabs(offsets[i]-median);
+  sort(offsets.begin(), offsets.end());
+  return offsets[offsets.size()*99/100];
+}
+
+static double Median(vector<double> values)
+{
+  if (values.empty()) return 0;
+  sort(values.begin(), values.end());
+  return values[values.size()/2];
+}
+
+static void Packet(byte* packet, int pid, BYTE& continuity, int sequence, LONGLONG pcr)
+{
+  memset(packet, 0xff, 188);
+  packet[0]=0x47;
+  packet[1]=(byte)(pid>>8);
+  packet[2]=(byte)(pid & 0xff);
+  packet[3]=(byte)((pcr >= 0 ? 0x30 : 0x10) | (continuity++ & 0x0f));
+  if (pcr >= 0)
+  {
+    LONGLONG base=pcr/300;
+    int extension=(int)(pcr%300);
+    packet[4]=7;
+    packet[5]=0x10;
+    packet[6]=(byte)(base>>25);
+    packet[7]=(byte)(base>>17);
+    packet[8]=(byte)(base>>9);
+    packet[9]=(byte)(base>>1);
+    packet[10]=(byte)(((base & 1)<<7) | 0x7e | (extension>>8));
+    packet[11]=(byte)(extension & 0xff);
+  }
+  PacketStamp stamp;
+  stamp.sequence=sequence;
+  stamp.written=0;
+  memcpy(&packet[188-sizeof(stamp)], &stamp, sizeof(stamp));
+}
+
+static bool Run(bool rtp, double seconds)
+{
+  CLoopbackReceiver receiver(rtp);
+  thread receiving(&CLoopbackReceiver::Run, &receiver);
+
+  CNetworkSink sink;
+  if (!sink.Open(L"127.0.0.1", receiver.m_port, rtp))
+  {
+    receiver.m_stop=true;
+    receiving.join();
+    printf("%s: can't open the sink\n", rtp ? "rtp" : "udp");
+    return false;
+  }
+
+  // a burst every 20 ms with the packets of that time, 6 of 7 video
+  BYTE videoContinuity=0;
+  BYTE audioContinuity=0;
+  int packets=(int)(seconds/PACKET_S);
+  int sequence=0;
+  double nextPcr=0;
+  double start=Now();
+  byte packet[188];
+  for (int burst=0; sequence < packets;++burst)
+  {
+    double due=start+(burst+1)*BURST_MS/1000.0;
+    double now=Now();
+    if (due > now) usleep((useconds_t)((due-now)*1e6));
+    for (; sequence < packets && sequence*PACKET_S < (burst+1)*BURST_MS/1000.0;++sequence)
+    {
+      double streamTime=sequence*PACKET_S;
+      if (streamTime >= nextPcr)
+      {
+        nextPcr+=PCR_MS/1000.0;
+        Packet(packet, VIDEO_PID, videoContinuity, sequence, (LONGLONG)(streamTime*27e6));
+      }
+      else if (sequence%7==3)
+        Packet(packet, AUDIO_PID, audioContinuity, sequence, -1);
+      else
+        Packet(packet, VIDEO_PID, videoContinuity, sequence, -1);
+      PacketStamp stamp;
+      stamp.sequence=sequence;
+      stamp.written=Now();
+      memcpy(&packet[188-sizeof(stamp)], &stamp, sizeof(stamp));
+      sink.Write(packet);
+    }
+  }
+
+  // the last datagrams leave the send delay later
+  usleep((useconds_t)((SEND_DELAY+0.3)*1e6));
+  int sent, dropped;
+  sink.GetCounters(&sent, &dropped);
+  sink.Close();
+  usleep(100000);
+  receiver.m_stop=true;
+  receiving.join();
+
+  size_t from=0;
+  while (from < receiver.m_streamTimes.size() && receiver.m_streamTimes[from] < SETTLE_S) from++;
+  double inputPacing=Pacing(receiver.m_written, receiver.m_streamTimes, from);
+  double outputPacing=Pacing(receiver.m_arrived, receiver.m_streamTimes, from);
+  vector<double> latencies;
+  for (size_t i=from; i < receiver.m_arrived.size();++i) latencies.push_back(receiver.m_arrived[i]-receiver.m_written[i]);
+  double latency=Median(latencies);
+  double worst=latencies.empty() ? 0 : *max_element(latencies.begin(), latencies.end());
+
+  // all but the datagrams after the last pcr
+  int whole=packets/NETWORK_PACKETS_PER_DATAGRAM;
+  int unpaced=(int)(PCR_MS/1000.0/PACKET_S/NETWORK_PACKETS_PER_DATAGRAM)+1;
+  bool ok=(receiver.m_ccErrors==0 && receiver.m_rtpErrors==0 && receiver.m_sequenceErrors==0 &&
+           receiver.m_datagrams==sent && whole-sent <= unpaced && dropped==0 &&
+           outputPacing < PACING_MAX && fabs(latency-SEND_DELAY) < LATENCY_MAX);
+  printf("%s: %d datagrams of %d, %d sent, %d dropped, cc errors %d, sequence errors %d; pacing p99 in %.2f ms, "
+         "out %.2f ms; latency median %.1f ms, max %.1f ms  %s\n", rtp ? "rtp" : "udp", receiver.m_datagrams, whole,
+         sent, dropped, receiver.m_ccErrors, receiver.m_sequenceErrors+receiver.m_rtpErrors, inputPacing*1000,
+         outputPacing*1000, latency*1000, worst*1000, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  double seconds=(argc > 1 ? atof(argv[1]) : 4);
+  bool ok=Run(false, seconds);
+  ok&=Run(true, seconds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Times the NIT and SDT parsing and the channel export of a scan on a satellite
+// network of 5,000 services: 250 transponders of 20 services each, on 125
+// frequencies in both polarisations.
+//
+//   nitsdtbench [passes]
+//
+// "nit" feeds the NIT with the delivery descriptor and the LCNs of every
+// transponder through CNITDecoder, a pass at a time like the table repeats.
+// "sdt" feeds a PAT of all services, the SDT actual of the first transponder
+// and the SDT other of the rest through CPatParser, "export" reads every channel
+// back with GetChannel() the way the scan does. The driver fails if a
+// transponder, a name or an LCN is missing. "make nit-reference" runs it against
+// the parsers before the LCNs and channels were indexed.
+
+#include <windows.h>
+#include <stdarg.h>
+#include "SiTables.h"
+#include "patparser.h"
+
+#define NETWORK_ID     1
+#define TRANSPONDERS   250
+#define SERVICES       20          // per transponder
+#define PID_SDT_TABLE  0x11
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+bool DisableCRCCheck()
+{
+  return false;
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+static vector<SiTransport> Network()
+{
+  vector<SiTransport> network;
+  for (int t=0; t < TRANSPONDERS;++t)
+  {
+    SiTransport ts;
+    ts.networkId=NETWORK_ID;
+    ts.transportId=1000+t;
+    ts.satellite=true;
+    ts.frequency=1072000+(t/2)*1950;     // 10.72 GHz on, 19.5 MHz apart
+    ts.polarisation=(t&1);
+    ts.symbolRate=27500;
+    for (int i=0; i < SERVICES;++i)
+    {
+      SiService service;
+      service.serviceId=t*SERVICES+i+1;
+      service.pmtPid=0x20+(t*SERVICES+i)%0x1f00;
+      service.serviceType=(i%5==4 ? 2 : 1);
+      service.lcn=(service.serviceId-1)%999+1;
+      char name[32];
+      sprintf(name, "Service %d", service.serviceId);
+      service.name=name;
+      service.provider=(t%3 ? "Provider A" : "Provider B");
+      ts.services.push_back(service);
+    }
+    network.push_back(ts);
+  }
+  return network;
+}
+
+static void Packets(const vector<Section>& sections, int pid, BYTE& continuity, vector<byte>& packets)
+{
+  for (size_t i=0; i < sections.size();++i)
+    CSiTables::Packetize(sections[i], pid, continuity, packets);
+}
+
+template <class T> static void Feed(T& parser, vector<byte>& packets)
+{
+  for (size_t p=0; p < packets.size(); p+=188)
+    parser.OnTsPacket(&packets[p]);
+}
+
+int main(int argc, char** argv)
+{
+  int passes=(argc > 1 ? atoi(argv[1]) : 10);
+  vector<SiTransport> network=Network();
+
+  // all services in one PAT, so the export sees each of them
+  SiTransport all;
+  all.transportId=network[0].transportId;
+  all.networkId=NETWORK_ID;
+  for (size_t t=0; t < network.size();++t)
+    all.services.insert(all.services.end(), network[t].services.begin(), network[t].services.end());
+
+  BYTE nitContinuity=0;
+  BYTE patContinuity=0;
+  BYTE sdtContinuity=0;
+  vector<byte> nit;
+  vector<byte> psi;
+  Packets(CSiTables::Nit(NETWORK_ID, "Satellite", network, true, 1, 8), PID_NIT, nitContinuity, nit);
+  Packets(CSiTables::Pat(all, 1, 250), PID_PAT, patContinuity, psi);
+  Packets(CSiTables::Sdt(network[0], true, 1, 25), PID_SDT_TABLE, sdtContinuity, psi);
+  for (size_t t=1; t < network.size();++t)
+    Packets(CSiTables::Sdt(network[t], false, 1, 25), PID_SDT_TABLE, sdtContinuity, psi);
+  int services=(int)all.services.size();
+  printf("%d services on %d transponders: nit %d packets, pat and sdt %d packets\n", services,
+         (int)network.size(), (int)(nit.size()/188), (int)(psi.size()/188));
+
+  // nit on its own
+  CNITDecoder* decoder=new CNITDecoder();
+  decoder->Reset();
+  double start=Now();
+  for (int pass=0; pass < passes;++pass) Feed(*decoder, nit);
+  double nitTime=(Now()-start)/passes;
+  int transponders=(int)decoder->m_nit.satteliteNIT.size();
+  int lcns=0;
+  for (int i=0; i < services;++i)
+  {
+    const SiService& service=all.services[i];
+    if (decoder->GetLogicialChannelNumber(NETWORK_ID, 1000+i/SERVICES, service.serviceId)==service.lcn) lcns++;
+  }
+  delete decoder;
+  bool ok=(transponders==TRANSPONDERS && lcns==services);
+  printf("nit:    %8.3f ms a pass, %d transponders of %d, %d lcns of %d  %s\n", nitTime*1000, transponders,
+         TRANSPONDERS, lcns, services, ok ? "ok" : "FAILED");
+
+  // the scan: pat, sdt and nit through the pat parser, then the export
+  double sdtTime=0;
+  double exportTime=0;
+  int named=0;
+  int exported=0;
+  for (int pass=0; pass < passes;++pass)
+  {
+    CPatParser* parser=new CPatParser();
+    parser->Reset(NULL, false);
+    start=Now();
+    Feed(*parser, psi);
+    Feed(*parser, nit);
+    sdtTime+=Now()-start;
+
+    start=Now();
+    named=0;
+    exported=0;
+    for (int i=0; i < parser->Count();++i)
+    {
+      CChannelInfo info;
+      if (!parser->GetChannel(i, info)) continue;
+      const SiService& service=all.services[info.ServiceId-1];
+      if (strcmp(info.ServiceName, service.name.c_str())==0) named++;
+      if (info.LCN==service.lcn && info.TransportId==1000+(info.ServiceId-1)/SERVICES) exported++;
+    }
+    exportTime+=Now()-start;
+    delete parser;
+  }
+  sdtTime/=passes;
+  exportTime/=passes;
+  bool scanOk=(named==services && exported==services);
+  printf("sdt:    %8.3f ms a pass, %d services named of %d\n", sdtTime*1000, named, services);
+  printf("export: %8.3f ms, %6.1f us a channel, %d channels with their lcn of %d  %s\n", exportTime*1000,
+         exportTime*1e6/services, exported, services, scanOk ? "ok" : "FAILED");
+  return (ok && scanOk) ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Checks the resync of CPacketSync. The packets carry a sequence number, so
+// every lost, repeated or invented packet shows up. The synthetic payload and
+// garbage never contain a sync byte, so each loss is predictable and any invented
+// packet is a bug.
+//
+//   packetsyncreplay            synthetic streams: leading garbage, garbage bursts
+//                               and truncated packets, broken sync bytes with both
+//                               hysteresis settings, then the throughput
+//   packetsyncreplay <file.ts>  replays a recording in random chunks and in 64 kB
+//                               blocks, both must give the same packets
+//
+// NO_SSE2=1 forces the scalar sync search.
+
+#include <windows.h>
+#include <vector>
+#include "packetsync.h"
+
+#define REPLAY_BLOCK   65536
+
+class CReplaySync : public CPacketSync
+{
+public:
+  CReplaySync() { m_runs=0; m_packets=0; m_hash=1469598103934665603ULL; m_countOnly=false; }
+
+  void OnTsPackets(byte* tsPackets, int count)
+  {
+    m_runs++;
+    if (m_countOnly)
+    {
+      m_packets+=count;
+      return;
+    }
+    CPacketSync::OnTsPackets(tsPackets, count);
+  }
+
+  void OnTsPacket(byte* tsPacket)
+  {
+    int sequence;
+    memcpy(&sequence, tsPacket+4, sizeof(sequence));
+    m_sequences.push_back(tsPacket[0]==TS_PACKET_SYNC ? sequence : -1);
+    for (int i=0; i < TS_PACKET_LEN;++i) m_hash=(m_hash ^ tsPacket[i])*1099511628211ULL;
+    m_packets++;
+  }
+
+  std::vector<int> m_sequences;
+  long             m_runs;
+  long             m_packets;
+  UINT64           m_hash;
+  bool             m_countOnly;
+};
+
+static void Packets(std::vector<byte>& data, int count, int first)
+{
+  size_t start=data.size();
+  data.resize(start+count*TS_PACKET_LEN);
+  for (int i=0; i < count;++i)
+  {
+    byte* tsPacket=&data[start+i*TS_PACKET_LEN];
+    for (int j=0; j < TS_PACKET_LEN;++j) tsPacket[j]=(byte)(rand()%TS_PACKET_SYNC);
+    tsPacket[0]=TS_PACKET_SYNC;
+    int sequence=first+i;
+    memcpy(tsPacket+4, &sequence, sizeof(sequence));
+  }
+}
+
+static void Garbage(std::vector<byte>& data, int length)
+{
+  for (int i=0; i < length;++i) data.push_back((byte)(rand()%TS_PACKET_SYNC));
+}
+
+static void Feed(CPacketSync& sync, std::vector<byte>& data, int maxChunk)
+{
+  size_t pos=0;
+  while (pos < data.size())
+  {
+    size_t length=min(data.size()-pos, (size_t)(1+rand()%maxChunk));
+    sync.OnRawData(&data[pos], (int)length);
+    pos+=length;
+  }
+}
+
+// packets with a sequence outside of 0..last, and packets out of order
+static void Verify(CReplaySync& sync, int last, int* bogus, int* order)
+{
+  *bogus=0;
+  *order=0;
+  int previous=-1;
+  for (size_t i=0; i < sync.m_sequences.size();++i)
+  {
+    int sequence=sync.m_sequences[i];
+    if (sequence < 0 || sequence > last)
+    {
+      (*bogus)++;
+      continue;
+    }
+    if (sequence <= previous) (*order)++;
+    previous=sequence;
+  }
+}
+
+static bool Clean()
+{
+  std::vector<byte> data;
+  Garbage(data, 1000);
+  Packets(data, 10000, 0);
+  CReplaySync sync;
+  Feed(sync, data, 3000);
+
+  // the last packet waits for the sync byte of the next one
+  bool ok=(sync.m_sequences.size()==9999);
+  for (int i=0; ok && i < 9999;++i) ok=(sync.m_sequences[i]==i);
+  printf("leading garbage: %d packets of 9999 in order  %s\n", (int)sync.m_sequences.size(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool Damaged()
+{
+  // bursts of garbage after every 3rd group of 20 packets, every 7th group loses the
+  // end of its last packet. Either way the last packet of the group can't be
+  // confirmed and is lost, the next group is found again.
+  std::vector<byte> data;
+  int sequence=0;
+  int lost=0;
+  bool damaged=false;
+  for (int group=0; group < 500;++group)
+  {
+    Packets(data, 20, sequence);
+    sequence+=20;
+    damaged=false;
+    if ((group%7)==1)
+    {
+      data.resize(data.size()-50);
+      damaged=true;
+    }
+    if ((group%3)==0)
+    {
+      int length=rand()%400;
+      Garbage(data, length);
+      damaged|=(length > 0);
+    }
+    if (damaged) lost++;
+  }
+  // the last packet waits for the sync byte of the next one
+  if (!damaged) lost++;
+
+  CReplaySync chunked;
+  Feed(chunked, data, 3000);
+  CReplaySync bytes;
+  Feed(bytes, data, 1);
+  int bogus, order;
+  Verify(chunked, sequence-1, &bogus, &order);
+  int got=(int)chunked.m_sequences.size();
+
+  bool ok=(bogus==0 && order==0 && got==sequence-lost && chunked.m_hash==bytes.m_hash);
+  printf("garbage bursts: %d packets of %d expected, %d invented, %d out of order, byte by byte %s  %s\n",
+         got, sequence-lost, bogus, order, (chunked.m_hash==bytes.m_hash ? "the same" : "DIFFERENT"), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool BrokenSyncBytes()
+{
+  // a bit error in every 97th sync byte
+  bool ok=true;
+  for (int unlock=1; unlock <= 3; unlock+=2)
+  {
+    std::vector<byte> data;
+    Packets(data, 10000, 0);
+    int broken=0;
+    for (int i=100; i < 10000; i+=97)
+    {
+      data[i*TS_PACKET_LEN]=TS_PACKET_SYNC-1;
+      broken++;
+    }
+    CReplaySync sync;
+    sync.SetSyncHysteresis(3, unlock);
+    Feed(sync, data, 3000);
+    int bogus, order;
+    Verify(sync, 9999, &bogus, &order);
+    int got=(int)sync.m_sequences.size();
+
+    // unlock 1 drops the sync at each broken byte, which loses the packet in front of
+    // it as well. Unlock 3 keeps the sync and only drops the broken packet.
+    int expected=9999-(unlock==1 ? 2*broken : broken);
+    bool unlockOk=(bogus==0 && order==0 && got==expected);
+    printf("broken sync bytes, unlock after %d: %d packets of %d expected, %ld runs  %s\n",
+           unlock, got, expected, sync.m_runs, unlockOk ? "ok" : "FAILED");
+    ok&=unlockOk;
+  }
+  return ok;
+}
+
+static void Throughput()
+{
+  std::vector<byte> data;
+  Packets(data, 200000, 0);
+  CReplaySync sync;
+  sync.m_countOnly=true;
+  auto start=std::chrono::steady_clock::now();
+  for (int pass=0; pass < 20;++pass)
+  {
+    for (size_t pos=0; pos < data.size(); pos+=REPLAY_BLOCK)
+    {
+      sync.OnRawData(&data[pos], (int)min((size_t)REPLAY_BLOCK, data.size()-pos));
+    }
+  }
+  double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  printf("in sync: %.2f GB/s\n", 20.0*data.size()/seconds/1e9);
+
+  std::vector<byte> garbage;
+  for (int i=0; i < (64<<20);++i) garbage.push_back((byte)(rand()%TS_PACKET_SYNC));
+  CReplaySync search;
+  start=std::chrono::steady_clock::now();
+  for (size_t pos=0; pos < garbage.size(); pos+=REPLAY_BLOCK)
+  {
+    search.OnRawData(&garbage[pos], REPLAY_BLOCK);
+  }
+  seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  printf("sync search: %.2f GB/s\n", garbage.size()/seconds/1e9);
+}
+
+static int Replay(const char* fileName)
+{
+  FILE* file=fopen(fileName, "rb");
+  if (file==NULL)
+  {
+    printf("can't open %s\n", fileName);
+    return 1;
+  }
+  std::vector<byte> data;
+  byte buffer[REPLAY_BLOCK];
+  size_t length;
+  while ((length=fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer+length);
+  fclose(file);
+
+  CReplaySync chunked;
+  Feed(chunked, data, 3000);
+  CReplaySync blocks;
+  Feed(blocks, data, REPLAY_BLOCK);
+  bool ok=(chunked.m_packets==blocks.m_packets && chunked.m_hash==blocks.m_hash);
+  printf("%s: %ld packets in random chunks, %ld in blocks  %s\n", fileName, chunked.m_packets, blocks.m_packets, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  srand(3);
+  if (argc > 1)
+  {
+    return Replay(argv[1]);
+  }
+  bool ok=Clean();
+  ok&=Damaged();
+  ok&=BrokenSyncBytes();
+  Throughput();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Replays pcr arrivals through the pll of CPcrRefClock.
+//
+//   pcrclockreplay           simulates streams with a clock offset of +/-50 ppm,
+//                            3 and 10 ms arrival jitter, some late pcrs and a jump
+//                            of the stream clock after 360 s. Every run has to
+//                            lock within 60 s and end within 1 ppm of the offset.
+//   pcrclockreplay <trace>   replays a recorded trace, one pcr per line:
+//                            <arrival s> <pcr s as received> [1 = discontinuity]
+
+#include <windows.h>
+#include <math.h>
+#include <stdarg.h>
+#include "pcrrefclock.h"
+
+#define SIM_PCR_INTERVAL   0.04     // s
+#define SIM_DURATION       600      // s
+#define SIM_JUMP_AT        360      // s
+#define SIM_JUMP           12.345   // s
+#define SIM_MAX_LOCK_TIME  60       // s
+#define SIM_MAX_RESIDUAL   1.0      // ppm
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+// system time as set by the replay, in 100 ns ticks
+class CReplayClockSource : public CRefClockSource
+{
+public:
+  CReplayClockSource() { m_ticks=0; }
+  LONGLONG Frequency() { return 10000000; }
+  LONGLONG Ticks() { return m_ticks; }
+  void SetTime(double seconds) { m_ticks=(LONGLONG)(seconds*1e7); }
+private:
+  LONGLONG m_ticks;
+};
+
+static CPcr WrappedPcr(double stream)
+{
+  CPcr pcr;
+  pcr.FromClock(fmod(stream, (double)0x200000000LL/90000.0));
+  return pcr;
+}
+
+static bool Simulate(double ppm, double jitter)
+{
+  CReplayClockSource source;
+  CPcrRefClock clock(&source);
+  srand(1);
+
+  // start close to the pcr wrap, the clock has to unwrap it on the way
+  double streamStart=95000.0;
+  double lockedAt=-1;
+  double maxError=0;
+  int pcrs=(int)(SIM_DURATION/SIM_PCR_INTERVAL);
+  for (int i=0; i < pcrs;++i)
+  {
+    double system=i*SIM_PCR_INTERVAL;
+    double stream=streamStart + system*(1+ppm*1e-6);
+    if (system >= SIM_JUMP_AT) stream+=SIM_JUMP;
+
+    // the arrival is delayed by the jitter, every 997th pcr is 50 ms late
+    double arrival=system + (rand()/(double)RAND_MAX)*jitter + ((i%997)==0 ? 0.05 : 0);
+    source.SetTime(arrival);
+    clock.OnPcr(WrappedPcr(stream), false);
+
+    double error=clock.SystemToStream(system+jitter/2)-stream;
+    if (lockedAt < 0 && clock.IsLocked() && fabs(clock.FrequencyOffsetPpm()-ppm) < 2 && fabs(error) < 0.002)
+    {
+      lockedAt=system;
+    }
+    if (system > SIM_JUMP_AT+SIM_MAX_LOCK_TIME && fabs(error) > maxError) maxError=fabs(error);
+  }
+
+  double residual=clock.FrequencyOffsetPpm()-ppm;
+  bool ok=(lockedAt >= 0 && lockedAt <= SIM_MAX_LOCK_TIME && fabs(residual) < SIM_MAX_RESIDUAL &&
+           clock.Discontinuities() > 0 && maxError < 0.002);
+  printf("%+6.1f ppm, %4.1f ms jitter: locked after %5.1f s, residual %+.3f ppm, max error after the jump %.2f ms, %d outliers, %d discontinuities  %s\n",
+         ppm, jitter*1000, lockedAt, residual, maxError*1000, clock.Outliers(), clock.Discontinuities(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static int Replay(const char* fileName)
+{
+  FILE* file=fopen(fileName, "r");
+  if (file==NULL)
+  {
+    printf("can't open %s\n", fileName);
+    return 1;
+  }
+  CReplayClockSource source;
+  CPcrRefClock clock(&source);
+  char line[256];
+  int pcrs=0;
+  while (fgets(line, sizeof(line), file)!=NULL)
+  {
+    double arrival, stream;
+    int discontinuity=0;
+    if (sscanf(line, "%lf %lf %d", &arrival, &stream, &discontinuity) < 2) continue;
+    source.SetTime(arrival);
+    CPcr pcr;
+    pcr.FromClock(stream);
+    clock.OnPcr(pcr, discontinuity!=0);
+    printf("%10.3f %14.6f %+9.3f ppm %+8.3f ms %s\n", arrival, clock.LastStreamTime(), clock.FrequencyOffsetPpm(),
+           clock.PhaseError()*1000, clock.IsLocked() ? "locked" : "");
+    pcrs++;
+  }
+  fclose(file);
+  printf("%d pcrs, %d outliers, %d discontinuities\n", pcrs, clock.Outliers(), clock.Discontinuities());
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1)
+  {
+    return Replay(argv[1]);
+  }
+  bool ok=true;
+  const double offsets[]={ -50, -10, 0, 10, 50 };
+  const double jitters[]={ 0.003, 0.010 };
+  for (int o=0; o < 5;++o)
+  {
+    for (int j=0; j < 2;++j)
+    {
+      ok&=Simulate(offsets[o], jitters[j]);
+    }
+  }
+  return ok ? 0 : 1;
+}
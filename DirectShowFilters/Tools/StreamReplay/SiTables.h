@@ -0,0 +1,327 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Builds the psi/si sections a channel scan reads (PAT, PMT, SDT, NIT and the
+// ATSC VCT) and cuts them into ts packets, for the replay drivers that feed the
+// table parsers. Every section starts in a packet of its own, the last packet
+// of a section is stuffed with 0xff.
+#pragma once
+
+#include <windows.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "dvbutil.h"
+
+using namespace std;
+
+typedef vector<byte> Section;
+
+struct SiService
+{
+  int    serviceId;
+  int    pmtPid;
+  int    serviceType;    // 1 tv, 2 radio, 0x0c data
+  int    lcn;            // 0 for none
+  string name;
+  string provider;
+};
+
+struct SiTransport
+{
+  int  transportId;
+  int  networkId;
+  int  frequency;        // kHz for cable/terrestrial, 10 kHz for satellite as in the descriptor
+  int  polarisation;     // satellite only, 0..3 as in the descriptor
+  int  symbolRate;       // ks/s, satellite only
+  bool satellite;
+  vector<SiService> services;
+};
+
+class CSiTables
+{
+public:
+  // long section header, the caller appends the body; Finish() fills in the
+  // length and appends the crc
+  static Section Begin(int tableId, int extension, int version, int number, int last)
+  {
+    Section s(8);
+    s[0]=(byte)tableId;
+    s[1]=0xb0;
+    s[2]=0;
+    s[3]=(byte)(extension>>8);
+    s[4]=(byte)(extension&0xff);
+    s[5]=(byte)(0xc1 | ((version&0x1f)<<1));
+    s[6]=(byte)number;
+    s[7]=(byte)last;
+    return s;
+  }
+
+  static void Finish(Section& s)
+  {
+    int length=(int)s.size()-3+4;
+    s[1]=(byte)(0xb0 | (length>>8));
+    s[2]=(byte)(length&0xff);
+    DWORD crc=crc32((char*)&s[0], (int)s.size());
+    Put32(s, crc);
+  }
+
+  static Section Pat(const SiTransport& ts, int version)
+  {
+    return Pat(ts, version, (int)ts.services.size()+1)[0];
+  }
+
+  // the network pid and perSection-1 services in the first section, perSection
+  // services in the others
+  static vector<Section> Pat(const SiTransport& ts, int version, int perSection)
+  {
+    vector<Section> sections;
+    int count=(int)ts.services.size()+1;
+    int last=(count-1)/perSection;
+    for (int number=0; number <= last;++number)
+    {
+      Section s=Begin(0x00, ts.transportId, version, number, last);
+      for (int i=number*perSection; i < count && i < (number+1)*perSection;++i)
+      {
+        if (i==0)
+        {
+          Put16(s, 0);
+          Put16(s, 0xe000 | 0x10);
+          continue;
+        }
+        Put16(s, ts.services[i-1].serviceId);
+        Put16(s, 0xe000 | ts.services[i-1].pmtPid);
+      }
+      Finish(s);
+      sections.push_back(s);
+    }
+    return sections;
+  }
+
+  // mpeg2 video and mpeg1 audio, or only the audio for a radio service
+  static Section Pmt(const SiService& service, int version)
+  {
+    Section s=Begin(0x02, service.serviceId, version, 0, 0);
+    Put16(s, 0xe000 | (service.pmtPid+1));
+    Put16(s, 0xf000);
+    if (service.serviceType!=2)
+    {
+      s.push_back(0x02);
+      Put16(s, 0xe000 | (service.pmtPid+1));
+      Put16(s, 0xf000);
+    }
+    s.push_back(0x03);
+    Put16(s, 0xe000 | (service.pmtPid+2));
+    Put16(s, 0xf000);
+    Finish(s);
+    return s;
+  }
+
+  // sdt actual (0x42) or other (0x46) of a transport, perSection services per section
+  static vector<Section> Sdt(const SiTransport& ts, bool actual, int version, int perSection)
+  {
+    vector<Section> sections;
+    int count=(int)ts.services.size();
+    int last=(count-1)/perSection;
+    for (int number=0; number <= last;++number)
+    {
+      Section s=Begin(actual ? 0x42 : 0x46, ts.transportId, version, number, last);
+      Put16(s, ts.networkId);
+      s.push_back(0xff);
+      for (int i=number*perSection; i < count && i < (number+1)*perSection;++i)
+      {
+        const SiService& service=ts.services[i];
+        if (service.name.empty()) continue;     // a service the sdt doesn't list
+        int descriptor=2+3+(int)service.provider.size()+(int)service.name.size();
+        Put16(s, service.serviceId);
+        s.push_back(0xfc);
+        Put16(s, 0x8000 | descriptor);           // running, free to air
+        s.push_back(0x48);
+        s.push_back((byte)(descriptor-2));
+        s.push_back((byte)service.serviceType);
+        PutString(s, service.provider);
+        PutString(s, service.name);
+      }
+      Finish(s);
+      sections.push_back(s);
+    }
+    return sections;
+  }
+
+  // nit actual (0x40) or other (0x41) with a delivery system descriptor and the
+  // lcns of each transport, perSection transports per section
+  static vector<Section> Nit(int networkId, const string& name, const vector<SiTransport>& transports,
+                             bool actual, int version, int perSection)
+  {
+    vector<Section> sections;
+    int count=(int)transports.size();
+    int last=(count-1)/perSection;
+    for (int number=0; number <= last;++number)
+    {
+      Section s=Begin(actual ? 0x40 : 0x41, networkId, version, number, last);
+      Put16(s, 0xf000 | (2+(int)name.size()));
+      s.push_back(0x40);
+      s.push_back((byte)name.size());
+      s.insert(s.end(), name.begin(), name.end());
+      size_t loop=s.size();
+      Put16(s, 0xf000);
+      for (int t=number*perSection; t < count && t < (number+1)*perSection;++t)
+      {
+        const SiTransport& ts=transports[t];
+        Put16(s, ts.transportId);
+        Put16(s, ts.networkId);
+        size_t descriptors=s.size();
+        Put16(s, 0xf000);
+        if (ts.satellite)
+        {
+          s.push_back(0x43);
+          s.push_back(11);
+          Put32(s, Bcd(ts.frequency, 8));
+          Put16(s, Bcd(192, 4));                // 19.2 east
+          s.push_back((byte)(0x80 | ((ts.polarisation&3)<<5) | 0x01));      // dvb-s, qpsk
+          Put32(s, (Bcd(ts.symbolRate*10, 7)<<4) | 0x3);                     // fec 3/4
+        }
+        else
+        {
+          s.push_back(0x5a);
+          s.push_back(11);
+          Put32(s, (DWORD)ts.frequency*100);     // 10 Hz units
+          s.push_back(0x1f);                     // 8 MHz
+          s.push_back(0x82);                     // 64qam, 3/4
+          s.push_back(0x1a);                     // 1/4 guard, 8k
+          Put32(s, 0xffffffff);
+        }
+        // a descriptor holds 63 lcns at most
+        size_t lcns=0;
+        for (size_t i=0; i < ts.services.size();++i)
+        {
+          if (ts.services[i].lcn==0) continue;
+          if (lcns==0 || s.size()-lcns-2 >= 63*4)
+          {
+            lcns=s.size();
+            s.push_back(0x83);
+            s.push_back(0);
+          }
+          Put16(s, ts.services[i].serviceId);
+          Put16(s, 0xfc00 | ts.services[i].lcn);
+          s[lcns+1]=(byte)(s.size()-lcns-2);
+        }
+        Set12(s, descriptors, (int)(s.size()-descriptors-2));
+      }
+      Set12(s, loop, (int)(s.size()-loop-2));
+      Finish(s);
+      sections.push_back(s);
+    }
+    return sections;
+  }
+
+  // terrestrial VCT (0xc8), 8vsb channels numbered major.minor from 1
+  static Section Vct(const SiTransport& ts, int major, int version)
+  {
+    Section s=Begin(0xc8, ts.transportId, version, 0, 0);
+    s.push_back(0);
+    s.push_back((byte)ts.services.size());
+    for (size_t i=0; i < ts.services.size();++i)
+    {
+      const SiService& service=ts.services[i];
+      for (int c=0; c < 7;++c)
+      {
+        s.push_back(0);
+        s.push_back(c < (int)service.name.size() ? (byte)service.name[c] : 0);
+      }
+      int minor=(int)i+1;
+      s.push_back((byte)(0xf0 | (major>>6)));
+      s.push_back((byte)(((major&0x3f)<<2) | (minor>>8)));
+      s.push_back((byte)(minor&0xff));
+      s.push_back(0x04);
+      Put32(s, (DWORD)ts.frequency*1000);
+      Put16(s, ts.transportId);
+      Put16(s, service.serviceId);
+      s.push_back(0x0d);
+      s.push_back((byte)(0xc0 | (service.serviceType==2 ? 0x03 : 0x02)));
+      Put16(s, service.serviceId);
+      Put16(s, 0xfc00);
+    }
+    Put16(s, 0xfc00);
+    Finish(s);
+    return s;
+  }
+
+  // cuts a section into ts packets on pid, the continuity counter is the caller's
+  static void Packetize(const Section& s, int pid, BYTE& continuity, vector<byte>& packets)
+  {
+    size_t pos=0;
+    bool first=true;
+    while (pos < s.size())
+    {
+      size_t at=packets.size();
+      packets.resize(at+188, 0xff);
+      byte* p=&packets[at];
+      p[0]=0x47;
+      p[1]=(byte)((first ? 0x40 : 0) | (pid>>8));
+      p[2]=(byte)(pid&0xff);
+      p[3]=(byte)(0x10 | (continuity++ & 0x0f));
+      int header=4;
+      if (first) p[header++]=0;                   // pointer field
+      size_t payload=min(s.size()-pos, (size_t)(188-header));
+      memcpy(p+header, &s[pos], payload);
+      pos+=payload;
+      first=false;
+    }
+  }
+
+private:
+  static void Put16(Section& s, int value)
+  {
+    s.push_back((byte)((value>>8)&0xff));
+    s.push_back((byte)(value&0xff));
+  }
+
+  static void Put32(Section& s, DWORD value)
+  {
+    Put16(s, (int)(value>>16));
+    Put16(s, (int)(value&0xffff));
+  }
+
+  // the low 12 bits of a length field at pos
+  static void Set12(Section& s, size_t pos, int value)
+  {
+    s[pos]=(byte)((s[pos]&0xf0) | ((value>>8)&0x0f));
+    s[pos+1]=(byte)(value&0xff);
+  }
+
+  static void PutString(Section& s, const string& text)
+  {
+    s.push_back((byte)text.size());
+    s.insert(s.end(), text.begin(), text.end());
+  }
+
+  static DWORD Bcd(int value, int digits)
+  {
+    DWORD bcd=0;
+    for (int i=0; i < digits;++i)
+    {
+      bcd|=(DWORD)(value%10)<<(4*i);
+      value/=10;
+    }
+    return bcd;
+  }
+};
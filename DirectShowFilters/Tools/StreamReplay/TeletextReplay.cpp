@@ -0,0 +1,406 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// Replays teletext through CTeletextAssembler and reports the pages it decodes
+// a second and how often it calls back.
+//
+//   teletextreplay [cycles]          synthetic carousels, fails on a wrong page
+//                                    cache or callback count
+//   teletextreplay <file.ts> <pid>   a captured teletext pid
+//
+// The synthetic carousel has 24 pages in each of the 8 magazines, three
+// subpages of page x01 and the subtitle page 888, sent over and over in
+// 31 data units every 40 ms. Every fifth page changes its text each cycle,
+// the clock in the page headers changes all the time. It is sent in parallel
+// mode, in serial mode, and in parallel mode with single bit errors in the
+// hamming coded bytes, which the assembler has to correct. A page has to be in
+// the cache as it was sent last. The page callback has to come once for each
+// new page and once for each changed page in each later cycle. The clock alone
+// must not cause one. Next to the callback rate the driver prints how many
+// raw 25 packet batches the grabber hands to the managed side for the same
+// stream.
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <vector>
+#include "teletextassembler.h"
+
+#define TELETEXT_PID     0x200
+#define UNITS_PER_PES    31          // with the pes header that fills 8 ts packets
+#define PES_MS           40
+#define PAGES            24          // a magazine
+#define SUBPAGES         3           // of page x01
+#define CHANGE_EVERY     5           // every fifth page changes each cycle
+#define SUBTITLE_PAGE    0x88        // in magazine 0, page 888
+#define FILLER_PAGE      0xff
+
+// hamming 8/4 code words of the values 0..15, as CTeletextAssembler decodes them
+static const byte HAMMING_84_ENCODE[16]={0x15,0x02,0x49,0x5E,0x64,0x73,0x38,0x2F,0xD0,0xC7,0x8C,0x9B,0xA1,0xB6,0xFD,0xEA};
+
+void LogDebug(const char* /*fmt*/, ...)
+{
+}
+
+static double Now()
+{
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return c.QuadPart/1e9;
+}
+
+static byte Reverse(byte b)
+{
+  byte reversed=0;
+  for (int bit=0; bit < 8;++bit)
+  {
+    if (b & (1<<bit)) reversed|=0x80>>bit;
+  }
+  return reversed;
+}
+
+static byte Parity(char c)
+{
+  byte b=(byte)(c & 0x7f);
+  int ones=0;
+  for (int bit=0; bit < 7;++bit) ones+=(b>>bit) & 1;
+  return (ones & 1) ? b : (byte)(b | 0x80);
+}
+
+class CPageCounter : public ITeletextPageCallBack
+{
+public:
+  CPageCounter() { m_callbacks=0; m_subtitles=0; }
+
+  STDMETHODIMP OnTeletextPageChanged(int pageNumber, int subPageNumber, BOOL isSubtitle)
+  {
+    m_callbacks++;
+    if (isSubtitle) m_subtitles++;
+    m_pages.insert((pageNumber<<16) | subPageNumber);
+    return S_OK;
+  }
+
+  int      m_callbacks;
+  int      m_subtitles;
+  set<int> m_pages;
+};
+
+struct TeletextPage
+{
+  int  magazine;       // 0..7, magazine 0 is shown as 8
+  int  page;           // the two bcd digits
+  int  subPage;
+  bool subtitle;
+  bool changing;
+
+  int Number() const { return (magazine==0 ? 8 : magazine)*0x100+page; }
+  int Key() const { return (Number()<<16) | subPage; }
+};
+
+class CTeletextGenerator
+{
+public:
+  CTeletextGenerator(bool serial, bool bitErrors)
+  {
+    m_serial=serial;
+    m_bitErrors=bitErrors;
+    m_seed=1;
+    m_continuity=0;
+    m_clock=0;
+    m_pesCount=0;
+    m_headers=0;
+    for (int magazine=0; magazine < 8;++magazine)
+    {
+      for (int i=0; i < PAGES;++i)
+      {
+        int subPages=(i==1 ? SUBPAGES : 1);
+        for (int s=0; s < subPages;++s)
+        {
+          TeletextPage page;
+          page.magazine=magazine;
+          page.page=((i/10)<<4) | (i%10);
+          page.subPage=(subPages > 1 ? s+1 : 0);
+          page.subtitle=false;
+          page.changing=(i%CHANGE_EVERY==0);
+          m_pages.push_back(page);
+        }
+      }
+    }
+    TeletextPage subtitle;
+    subtitle.magazine=0;
+    subtitle.page=SUBTITLE_PAGE;
+    subtitle.subPage=0;
+    subtitle.subtitle=true;
+    subtitle.changing=true;
+    m_pages.push_back(subtitle);
+  }
+
+  // the ts packets of all cycles, then a filler header in each magazine so the
+  // last pages are finished
+  void Make(int cycles, vector<byte>& packets)
+  {
+    packets.clear();
+    m_units.clear();
+    for (int cycle=0; cycle < cycles;++cycle)
+    {
+      vector<vector<byte> > queues(m_serial ? 1 : 8);
+      for (size_t i=0; i < m_pages.size();++i)
+      {
+        vector<byte>& queue=queues[m_serial ? 0 : m_pages[i].magazine];
+        const TeletextPage& page=m_pages[i];
+        Unit(queue, page.magazine, 0, Header(page.magazine, page.page, page.subPage, page.subtitle), page.subtitle);
+        for (int row=1; row <= 24;++row)
+          Unit(queue, page.magazine, row, Text(page, row, cycle), page.subtitle);
+      }
+      Interleave(queues);
+    }
+    vector<vector<byte> > fillers(1);
+    for (int magazine=0; magazine < 8;++magazine)
+      Unit(fillers[0], magazine, 0, Header(magazine, FILLER_PAGE, 0, false), false);
+    Interleave(fillers);
+    while (m_units.size() % (UNITS_PER_PES*46)!=0) Stuffing(m_units);
+
+    for (size_t pos=0; pos < m_units.size(); pos+=UNITS_PER_PES*46)
+      Pes(&m_units[pos], packets);
+  }
+
+  // the cache entry of the page as it was sent in the last cycle
+  void Expected(const TeletextPage& page, int cycle, byte* rows)
+  {
+    memset(rows, ' ', TELETEXT_PAGE_SIZE);
+    for (int row=1; row <= 24;++row)
+    {
+      vector<byte> text=Text(page, row, cycle);
+      Address(text, page.magazine, row);
+      memcpy(&rows[row*42], &text[0], 42);
+    }
+  }
+
+  const vector<TeletextPage>& Pages() { return m_pages; }
+  int   PesCount() { return m_pesCount; }
+  int   Headers() { return m_headers; }
+
+private:
+  unsigned int Random()
+  {
+    m_seed=m_seed*1664525+1013904223;
+    return m_seed>>8;
+  }
+
+  vector<byte> Header(int magazine, int page, int subPage, bool subtitle)
+  {
+    vector<byte> row(42);
+    byte control[8];
+    control[0]=(byte)(page & 0xf);
+    control[1]=(byte)(page>>4);
+    control[2]=(byte)(subPage & 0xf);
+    control[3]=(byte)((subPage>>4) & 7);
+    control[4]=(byte)((subPage>>8) & 0xf);
+    control[5]=(byte)(((subPage>>12) & 3) | (subtitle ? 8 : 0));
+    control[6]=0;
+    control[7]=(byte)(m_serial ? 1 : 0);
+    for (int i=0; i < 8;++i) row[2+i]=HAMMING_84_ENCODE[control[i]];
+
+    char text[40];
+    m_clock++;
+    sprintf(text, "  %d%02X MPTV   %02d:%02d:%02d           ", magazine==0 ? 8 : magazine, page,
+            (m_clock/3600)%24, (m_clock/60)%60, m_clock%60);
+    for (int i=0; i < 32;++i) row[10+i]=Parity(text[i]);
+    m_headers+=(page!=FILLER_PAGE);
+    return row;
+  }
+
+  vector<byte> Text(const TeletextPage& page, int row, int cycle)
+  {
+    vector<byte> text(42);
+    char line[48];
+    sprintf(line, "page %03X/%d row %02d %s %-18d", page.Number(), page.subPage, row,
+            page.changing ? "cycle" : "fixed", page.changing ? cycle : 0);
+    for (int i=0; i < 40;++i) text[2+i]=Parity(line[i]);
+    return text;
+  }
+
+  static void Address(vector<byte>& row, int magazine, int packetNumber)
+  {
+    row[0]=HAMMING_84_ENCODE[magazine | ((packetNumber & 1)<<3)];
+    row[1]=HAMMING_84_ENCODE[packetNumber>>1];
+  }
+
+  // a 46 byte data unit: id, length, field/line, framing code and the 42 bytes
+  // of the row, bit reversed as they are in the pes
+  void Unit(vector<byte>& queue, int magazine, int packetNumber, vector<byte> row, bool subtitle)
+  {
+    Address(row, magazine, packetNumber);
+    if (m_bitErrors && Random()%4==0)
+    {
+      // one bit of the address or of a header control byte
+      int pos=(packetNumber==0 ? Random()%10 : Random()%2);
+      row[pos]^=(byte)(1<<(Random()%8));
+    }
+    queue.push_back(subtitle ? 0x03 : 0x02);
+    queue.push_back(0x2c);
+    queue.push_back(0xe0 | 7);
+    queue.push_back(0xe4);
+    for (int i=0; i < 42;++i) queue.push_back(Reverse(row[i]));
+  }
+
+  static void Stuffing(vector<byte>& queue)
+  {
+    queue.push_back(0xff);
+    queue.push_back(0x2c);
+    queue.insert(queue.end(), 44, 0xff);
+  }
+
+  // parallel mode sends a row of each magazine in turn, serial mode has one queue
+  void Interleave(vector<vector<byte> >& queues)
+  {
+    size_t longest=0;
+    for (size_t q=0; q < queues.size();++q) longest=max(longest, queues[q].size());
+    for (size_t pos=0; pos < longest; pos+=46)
+    {
+      for (size_t q=0; q < queues.size();++q)
+      {
+        if (pos < queues[q].size())
+          m_units.insert(m_units.end(), queues[q].begin()+pos, queues[q].begin()+pos+46);
+      }
+    }
+  }
+
+  void Pes(const byte* units, vector<byte>& packets)
+  {
+    vector<byte> pes(46);
+    pes[0]=0; pes[1]=0; pes[2]=1; pes[3]=0xbd;
+    int length=46+UNITS_PER_PES*46-6;
+    pes[4]=(byte)(length>>8); pes[5]=(byte)(length&0xff);
+    pes[6]=0x84; pes[7]=0; pes[8]=36;
+    for (int i=9; i < 45;++i) pes[i]=0xff;
+    pes[45]=0x10;        // data_identifier, EBU data
+    pes.insert(pes.end(), units, units+UNITS_PER_PES*46);
+
+    for (size_t pos=0; pos < pes.size(); pos+=184)
+    {
+      size_t at=packets.size();
+      packets.resize(at+188);
+      byte* packet=&packets[at];
+      packet[0]=0x47;
+      packet[1]=(byte)((pos==0 ? 0x40 : 0) | (TELETEXT_PID>>8));
+      packet[2]=(byte)(TELETEXT_PID & 0xff);
+      packet[3]=(byte)(0x10 | (m_continuity++ & 0x0f));
+      memcpy(&packet[4], &pes[pos], 184);
+    }
+    m_pesCount++;
+  }
+
+  bool                 m_serial;
+  bool                 m_bitErrors;
+  unsigned int         m_seed;
+  BYTE                 m_continuity;
+  int                  m_clock;
+  int                  m_pesCount;
+  int                  m_headers;
+  vector<TeletextPage> m_pages;
+  vector<byte>         m_units;
+};
+
+static bool Synthetic(const char* name, bool serial, bool bitErrors, int cycles)
+{
+  CTeletextGenerator generator(serial, bitErrors);
+  vector<byte> packets;
+  generator.Make(cycles, packets);
+  int count=(int)(packets.size()/188);
+
+  CTeletextAssembler assembler;
+  CPageCounter counter;
+  assembler.SetCallBack(&counter);
+  double start=Now();
+  for (int p=0; p < count;++p)
+    assembler.OnTsPacket(TsPacketView(&packets[p*188]));
+  double time=Now()-start;
+
+  // every page once, then the changing ones again each cycle
+  const vector<TeletextPage>& pages=generator.Pages();
+  int expectedCallbacks=0;
+  int wrongPages=0;
+  byte expected[TELETEXT_PAGE_SIZE];
+  byte cached[TELETEXT_PAGE_SIZE];
+  for (size_t i=0; i < pages.size();++i)
+  {
+    const TeletextPage& page=pages[i];
+    expectedCallbacks+=(page.changing ? cycles : 1);
+    generator.Expected(page, cycles-1, expected);
+    if (!assembler.GetPage(page.Number(), page.subPage, cached) ||
+        memcmp(&cached[42], &expected[42], TELETEXT_PAGE_SIZE-42)!=0)
+      wrongPages++;
+  }
+  bool unknown=assembler.GetPage(0x199, 0, cached);
+  double seconds=generator.PesCount()*PES_MS/1000.0;
+  bool ok=(wrongPages==0 && !unknown && counter.m_callbacks==expectedCallbacks &&
+           counter.m_subtitles==cycles && (int)counter.m_pages.size()==(int)pages.size());
+  printf("%-20s %5d pages in %6.1f s of stream: %8.0f pages/s, %6.1f callbacks/s of stream (%d of %d), "
+         "%5.1f raw batches/s, %d wrong pages  %s\n", name, generator.Headers(), seconds,
+         generator.Headers()/time, counter.m_callbacks/seconds, counter.m_callbacks, expectedCallbacks,
+         count/25/seconds, wrongPages, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static int Replay(const char* file, int pid)
+{
+  FILE* f=fopen(file, "rb");
+  if (f==NULL)
+  {
+    printf("%s: can't open\n", file);
+    return 1;
+  }
+  vector<byte> packets;
+  byte packet[188];
+  while (fread(packet, 1, sizeof(packet), f)==sizeof(packet))
+  {
+    TsPacketView view(packet);
+    if (view.Pid==pid) packets.insert(packets.end(), packet, packet+188);
+  }
+  fclose(f);
+  int count=(int)(packets.size()/188);
+
+  CTeletextAssembler assembler;
+  CPageCounter counter;
+  assembler.SetCallBack(&counter);
+  double start=Now();
+  for (int p=0; p < count;++p)
+    assembler.OnTsPacket(TsPacketView(&packets[p*188]));
+  double time=Now()-start;
+  printf("%s: %d packets on pid 0x%x in %.3f ms, %d callbacks for %d pages, %d of them subtitles, "
+         "%d raw batches\n", file, count, pid, time*1000, counter.m_callbacks, (int)counter.m_pages.size(),
+         counter.m_subtitles, count/25);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 2) return Replay(argv[1], (int)strtol(argv[2], NULL, 0));
+
+  int cycles=(argc > 1 ? atoi(argv[1]) : 20);
+  bool ok=Synthetic("parallel", false, false, cycles);
+  ok&=Synthetic("serial", true, false, cycles);
+  ok&=Synthetic("parallel, bit errors", false, true, cycles);
+  return ok ? 0 : 1;
+}
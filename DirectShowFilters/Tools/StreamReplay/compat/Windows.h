@@ -0,0 +1,3 @@
+// the filters include it in this case as well
+#pragma once
+#include "windows.h"
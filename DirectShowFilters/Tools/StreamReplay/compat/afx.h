@@ -0,0 +1,9 @@
+// MFC is only included for the windows types, _T and ASSERT, which is a no-op as
+// in a release build
+#pragma once
+#include "windows.h"
+#include "tchar.h"
+
+#ifndef ASSERT
+#define ASSERT(x) ((void)0)
+#endif
@@ -0,0 +1,3 @@
+// MFC is only included for the windows types
+#pragma once
+#include "windows.h"
@@ -0,0 +1,2 @@
+// no allocation tracing in the replay drivers
+#pragma once
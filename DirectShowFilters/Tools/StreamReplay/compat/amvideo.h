@@ -0,0 +1,28 @@
+// The video formats the TsReader demuxer describes its video with
+#pragma once
+#include "strmif.h"
+
+typedef struct tagBITMAPINFOHEADER
+{
+  DWORD biSize;
+  LONG  biWidth;
+  LONG  biHeight;
+  WORD  biPlanes;
+  WORD  biBitCount;
+  DWORD biCompression;
+  DWORD biSizeImage;
+  LONG  biXPelsPerMeter;
+  LONG  biYPelsPerMeter;
+  DWORD biClrUsed;
+  DWORD biClrImportant;
+} BITMAPINFOHEADER;
+
+typedef struct tagVIDEOINFOHEADER
+{
+  RECT             rcSource;
+  RECT             rcTarget;
+  DWORD            dwBitRate;
+  DWORD            dwBitErrorRate;
+  REFERENCE_TIME   AvgTimePerFrame;
+  BITMAPINFOHEADER bmiHeader;
+} VIDEOINFOHEADER;
@@ -0,0 +1,76 @@
+// The ATL collections the h.264 path of the TsReader demuxer uses. CAutoPtr hands
+// its pointer over on copy, like the ATL one.
+#pragma once
+#include "windows.h"
+#include <vector>
+#include <deque>
+
+template <class E> class CAtlArray
+{
+public:
+  size_t GetCount() const                 { return m_items.size(); }
+  bool   SetCount(size_t count)           { m_items.resize(count); return true; }
+  E*     GetData()                        { return m_items.empty() ? NULL : &m_items[0]; }
+  size_t Add(const E& item)               { m_items.push_back(item); return m_items.size()-1; }
+  void   RemoveAt(size_t index, size_t count=1)
+  {
+    m_items.erase(m_items.begin()+index, m_items.begin()+index+count);
+  }
+  size_t Append(const CAtlArray<E>& other)
+  {
+    size_t start=m_items.size();
+    m_items.insert(m_items.end(), other.m_items.begin(), other.m_items.end());
+    return start;
+  }
+  void   RemoveAll()                      { m_items.clear(); }
+  E&     operator[](size_t index)         { return m_items[index]; }
+private:
+  std::vector<E> m_items;
+};
+
+template <class T> class CAutoPtr
+{
+public:
+  CAutoPtr()                              { m_p=NULL; }
+  explicit CAutoPtr(T* p)                 { m_p=p; }
+  CAutoPtr(CAutoPtr<T>& other)            { m_p=other.Detach(); }
+  CAutoPtr(CAutoPtr<T>&& other)           { m_p=other.Detach(); }
+  ~CAutoPtr()                             { Free(); }
+  CAutoPtr<T>& operator=(CAutoPtr<T>& other)
+  {
+    if (this!=&other) Attach(other.Detach());
+    return *this;
+  }
+  CAutoPtr<T>& operator=(CAutoPtr<T>&& other)
+  {
+    return *this=other;
+  }
+  void Attach(T* p)                       { Free(); m_p=p; }
+  T*   Detach()                           { T* p=m_p; m_p=NULL; return p; }
+  void Free()                             { delete m_p; m_p=NULL; }
+  T*   operator->() const                 { return m_p; }
+  T&   operator*() const                  { return *m_p; }
+  operator T*() const                     { return m_p; }
+  T*   m_p;
+};
+
+template <class T> class CAutoPtrList
+{
+public:
+  ~CAutoPtrList()                         { RemoveAll(); }
+  size_t GetCount() const                 { return m_items.size(); }
+  void AddTail(CAutoPtr<T>& item)         { m_items.push_back(item.Detach()); }
+  CAutoPtr<T> RemoveHead()
+  {
+    CAutoPtr<T> head(m_items.front());
+    m_items.pop_front();
+    return head;
+  }
+  void RemoveAll()
+  {
+    for (size_t i=0; i < m_items.size();++i) delete m_items[i];
+    m_items.clear();
+  }
+private:
+  std::deque<T*> m_items;
+};
@@ -0,0 +1,49 @@
+// the tuning enums of bdatypes.h the table parsers map descriptors to, with the
+// values of the windows sdk
+#pragma once
+#include "windows.h"
+
+enum ModulationType
+{
+  BDA_MOD_NOT_SET=-1, BDA_MOD_NOT_DEFINED=0, BDA_MOD_16QAM=1, BDA_MOD_32QAM=2, BDA_MOD_64QAM=3,
+  BDA_MOD_128QAM=7, BDA_MOD_256QAM=11, BDA_MOD_QPSK=20, BDA_MOD_8VSB=23, BDA_MOD_16VSB=24,
+  BDA_MOD_ANALOG_FREQUENCY=26
+};
+
+enum Polarisation
+{
+  BDA_POLARISATION_NOT_SET=-1, BDA_POLARISATION_NOT_DEFINED=0, BDA_POLARISATION_LINEAR_H=1,
+  BDA_POLARISATION_LINEAR_V=2, BDA_POLARISATION_CIRCULAR_L=3, BDA_POLARISATION_CIRCULAR_R=4
+};
+
+enum RollOff
+{
+  BDA_ROLL_OFF_NOT_SET=-1, BDA_ROLL_OFF_NOT_DEFINED=0, BDA_ROLL_OFF_20=1, BDA_ROLL_OFF_25=2, BDA_ROLL_OFF_35=3
+};
+
+enum BinaryConvolutionCodeRate
+{
+  BDA_BCC_RATE_NOT_SET=-1, BDA_BCC_RATE_NOT_DEFINED=0, BDA_BCC_RATE_1_2=1, BDA_BCC_RATE_2_3=2,
+  BDA_BCC_RATE_3_4=3, BDA_BCC_RATE_3_5=4, BDA_BCC_RATE_4_5=5, BDA_BCC_RATE_5_6=6, BDA_BCC_RATE_7_8=8,
+  BDA_BCC_RATE_8_9=13, BDA_BCC_RATE_9_10=14
+};
+
+enum FECMethod
+{
+  BDA_FEC_METHOD_NOT_SET=-1, BDA_FEC_METHOD_NOT_DEFINED=0, BDA_FEC_VITERBI=1, BDA_FEC_RS_204_188=2
+};
+
+enum GuardInterval
+{
+  BDA_GUARD_NOT_SET=-1, BDA_GUARD_NOT_DEFINED=0, BDA_GUARD_1_32=1, BDA_GUARD_1_16=2, BDA_GUARD_1_8=3, BDA_GUARD_1_4=4
+};
+
+enum HierarchyAlpha
+{
+  BDA_HALPHA_NOT_SET=-1, BDA_HALPHA_NOT_DEFINED=0, BDA_HALPHA_1=1, BDA_HALPHA_2=2, BDA_HALPHA_4=3
+};
+
+enum TransmissionMode
+{
+  BDA_XMIT_MODE_NOT_SET=-1, BDA_XMIT_MODE_NOT_DEFINED=0, BDA_XMIT_MODE_2K=1, BDA_XMIT_MODE_8K=2, BDA_XMIT_MODE_4K=3
+};
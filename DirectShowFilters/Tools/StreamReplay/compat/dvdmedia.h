@@ -0,0 +1,40 @@
+// The mpeg video formats the TsReader demuxer describes its video with
+#pragma once
+#include "amvideo.h"
+
+typedef struct tagVIDEOINFOHEADER2
+{
+  RECT             rcSource;
+  RECT             rcTarget;
+  DWORD            dwBitRate;
+  DWORD            dwBitErrorRate;
+  REFERENCE_TIME   AvgTimePerFrame;
+  DWORD            dwInterlaceFlags;
+  DWORD            dwCopyProtectFlags;
+  DWORD            dwPictAspectRatioX;
+  DWORD            dwPictAspectRatioY;
+  DWORD            dwControlFlags;
+  DWORD            dwReserved2;
+  BITMAPINFOHEADER bmiHeader;
+} VIDEOINFOHEADER2;
+
+typedef struct tagMPEG1VIDEOINFO
+{
+  VIDEOINFOHEADER hdr;
+  DWORD           dwStartTimeCode;
+  DWORD           cbSequenceHeader;
+  BYTE            bSequenceHeader[1];
+} MPEG1VIDEOINFO;
+
+typedef struct tagMPEG2VIDEOINFO
+{
+  VIDEOINFOHEADER2 hdr;
+  DWORD            dwStartTimeCode;
+  DWORD            cbSequenceHeader;
+  DWORD            dwProfile;
+  DWORD            dwLevel;
+  DWORD            dwFlags;
+  DWORD            dwSequenceHeader[1];
+} MPEG2VIDEOINFO;
+
+#define AMINTERLACE_IsInterlaced 0x00000001
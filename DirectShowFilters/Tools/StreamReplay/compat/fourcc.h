@@ -0,0 +1,18 @@
+// FOURCCMap turns a fourcc or a wave format tag into its media subtype
+#pragma once
+#include "strmif.h"
+
+#define MAKEFOURCC(a, b, c, d) ((DWORD)(BYTE)(a) | ((DWORD)(BYTE)(b)<<8) | ((DWORD)(BYTE)(c)<<16) | ((DWORD)(BYTE)(d)<<24))
+
+class FOURCCMap : public GUID
+{
+public:
+  FOURCCMap(DWORD fourcc)
+  {
+    Data1=fourcc;
+    Data2=0x0000;
+    Data3=0x0010;
+    static const BYTE tail[8]={ 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 };
+    memcpy(Data4, tail, sizeof(Data4));
+  }
+};
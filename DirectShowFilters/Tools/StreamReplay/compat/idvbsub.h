@@ -0,0 +1,14 @@
+// The part of the DVB subtitle filter interface the TsReader demuxer calls; the
+// driver has no subtitle filter
+#pragma once
+#include <streams.h>
+
+DECLARE_INTERFACE_( IDVBSubtitle, IUnknown )
+{
+  STDMETHOD(Test)( int status ) PURE;
+  STDMETHOD(NotifyChannelChange)() PURE;
+  STDMETHOD(SetSubtitlePid)( LONG pPid ) PURE;
+  STDMETHOD(SetFirstPcr)( LONGLONG pPcr ) PURE;
+  STDMETHOD(SeekDone)( CRefTime& rtSeek ) PURE;
+  STDMETHOD(SetTimeCompensation)( CRefTime& rtCompensation ) PURE;
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include "windows.h"
+
+inline unsigned char _BitScanForward(unsigned long* index, unsigned long mask)
+{
+  if (mask==0) return 0;
+  *index=__builtin_ctzl(mask);
+  return 1;
+}
@@ -0,0 +1,62 @@
+// The wave formats the TsReader demuxer describes its audio with
+#pragma once
+#include "windows.h"
+
+#pragma pack(push, 1)
+typedef struct tWAVEFORMATEX
+{
+  WORD  wFormatTag;
+  WORD  nChannels;
+  DWORD nSamplesPerSec;
+  DWORD nAvgBytesPerSec;
+  WORD  nBlockAlign;
+  WORD  wBitsPerSample;
+  WORD  cbSize;
+} WAVEFORMATEX;
+
+typedef struct mpeg1waveformat_tag
+{
+  WAVEFORMATEX wfx;
+  WORD         fwHeadLayer;
+  DWORD        dwHeadBitrate;
+  WORD         fwHeadMode;
+  WORD         fwHeadModeExt;
+  WORD         wHeadEmphasis;
+  WORD         fwHeadFlags;
+  DWORD        dwPTSLow;
+  DWORD        dwPTSHigh;
+} MPEG1WAVEFORMAT;
+
+typedef struct mpeglayer3waveformat_tag
+{
+  WAVEFORMATEX wfx;
+  WORD         wID;
+  DWORD        fdwFlags;
+  WORD         nBlockSize;
+  WORD         nFramesPerBlock;
+  WORD         nCodecDelay;
+} MPEGLAYER3WAVEFORMAT;
+#pragma pack(pop)
+
+#define WAVE_FORMAT_UNKNOWN           0x0000
+#define WAVE_FORMAT_PCM               0x0001
+#define WAVE_FORMAT_MPEG              0x0050
+
+#define ACM_MPEG_LAYER1               0x0001
+#define ACM_MPEG_LAYER2               0x0002
+#define ACM_MPEG_LAYER3               0x0004
+#define ACM_MPEG_STEREO               0x0001
+#define ACM_MPEG_JOINTSTEREO          0x0002
+#define ACM_MPEG_DUALCHANNEL          0x0004
+#define ACM_MPEG_SINGLECHANNEL        0x0008
+#define ACM_MPEG_PRIVATEBIT           0x0001
+#define ACM_MPEG_COPYRIGHT            0x0002
+#define ACM_MPEG_ORIGINALHOME         0x0004
+#define ACM_MPEG_PROTECTIONBIT        0x0008
+#define ACM_MPEG_ID_MPEG1             0x0010
+
+#define MPEGLAYER3_ID_UNKNOWN         0
+#define MPEGLAYER3_ID_MPEG            1
+#define MPEGLAYER3_FLAG_PADDING_ISO   0x00000000
+#define MPEGLAYER3_FLAG_PADDING_ON    0x00000001
+#define MPEGLAYER3_FLAG_PADDING_OFF   0x00000002
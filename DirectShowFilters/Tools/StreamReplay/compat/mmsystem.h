@@ -0,0 +1,18 @@
+#pragma once
+#include "windows.h"
+
+inline DWORD timeGetTime()
+{
+  return GetTickCount();
+}
+
+// the timers here are fine grained anyway
+inline DWORD timeBeginPeriod(DWORD)
+{
+  return 0;
+}
+
+inline DWORD timeEndPeriod(DWORD)
+{
+  return 0;
+}
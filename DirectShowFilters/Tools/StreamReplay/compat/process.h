@@ -0,0 +1,12 @@
+#pragma once
+#include "windows.h"
+#include <thread>
+
+// the handle is a manual reset event which is set once the thread has returned,
+// so WaitForSingleObject() and CloseHandle() work on it like on a thread handle
+inline uintptr_t _beginthreadex(void*, unsigned, unsigned (*function)(void*), void* argument, unsigned, unsigned*)
+{
+  HANDLE handle=CreateEvent(NULL, TRUE, FALSE, NULL);
+  std::thread([=] { function(argument); SetEvent(handle); }).detach();
+  return (uintptr_t)handle;
+}
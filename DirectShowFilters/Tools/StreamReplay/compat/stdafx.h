@@ -0,0 +1,4 @@
+// the precompiled header of the filters, only the windows types here
+#pragma once
+#include "windows.h"
+#include "tchar.h"
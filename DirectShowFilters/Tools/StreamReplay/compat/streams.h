@@ -0,0 +1,136 @@
+// The stream code mostly needs the windows types from the DirectShow base
+// classes, CUnknown for the grabbers, which the drivers create directly, and
+// the reference time, lock, event and media type classes for the TsReader
+// demuxer
+#pragma once
+#include "windows.h"
+#include "strmif.h"
+#include "amvideo.h"
+#include "mmreg.h"
+#include "fourcc.h"
+#include "uuids.h"
+#include "wxdebug.h"
+#include <vector>
+
+#define E_POINTER ((HRESULT)0x80004003L)
+#define NAME(x)   (x)
+
+typedef IUnknown* LPUNKNOWN;
+
+class CUnknown
+{
+public:
+  CUnknown(const char*, LPUNKNOWN) {}
+  virtual ~CUnknown() {}
+};
+#define DECLARE_IUNKNOWN
+
+#define MILLISECONDS_TO_100NS_UNITS(ms) (((LONGLONG)(ms))*10000)
+
+class CRefTime
+{
+public:
+  REFERENCE_TIME m_time;
+
+  CRefTime()                           { m_time=0; }
+  CRefTime(LONG msecs)                 { m_time=MILLISECONDS_TO_100NS_UNITS(msecs); }
+  CRefTime(REFERENCE_TIME rt)          { m_time=rt; }
+  operator REFERENCE_TIME() const      { return m_time; }
+  CRefTime& operator=(const CRefTime& rt)      { m_time=rt.m_time; return *this; }
+  CRefTime& operator=(const LONGLONG ll)       { m_time=ll; return *this; }
+  CRefTime& operator+=(const CRefTime& rt)     { m_time+=rt.m_time; return *this; }
+  CRefTime& operator-=(const CRefTime& rt)     { m_time-=rt.m_time; return *this; }
+  LONG Millisecs()                     { return (LONG)(m_time/10000); }
+  LONGLONG GetUnits()                  { return m_time; }
+};
+
+class CCritSec
+{
+public:
+  void Lock()   { m_lock.lock(); }
+  void Unlock() { m_lock.unlock(); }
+private:
+  std::recursive_mutex m_lock;
+};
+
+class CAutoLock
+{
+public:
+  CAutoLock(CCritSec* lock) { m_lock=lock; m_lock->Lock(); }
+  ~CAutoLock()              { m_lock->Unlock(); }
+private:
+  CCritSec* m_lock;
+};
+
+class CAMEvent
+{
+public:
+  CAMEvent(BOOL manualReset=FALSE, HRESULT* result=NULL)
+  {
+    m_event=CreateEvent(NULL, manualReset, FALSE, NULL);
+    if (result) *result=S_OK;
+  }
+  ~CAMEvent()                    { CloseHandle(m_event); }
+  void Set()                     { SetEvent(m_event); }
+  void Reset()                   { ResetEvent(m_event); }
+  BOOL Wait(DWORD timeout=INFINITE) { return WaitForSingleObject(m_event, timeout)==WAIT_OBJECT_0; }
+  BOOL Check()                   { return Wait(0); }
+private:
+  HANDLE m_event;
+};
+
+class CMediaType : public AM_MEDIA_TYPE
+{
+public:
+  CMediaType()                   { InitMediaType(); }
+  CMediaType(const CMediaType& other)
+  {
+    InitMediaType();
+    *this=other;
+  }
+  CMediaType& operator=(const CMediaType& other)
+  {
+    if (this==&other) return *this;
+    m_format=other.m_format;
+    AM_MEDIA_TYPE::operator=(other);
+    pbFormat=m_format.empty() ? NULL : &m_format[0];
+    return *this;
+  }
+
+  void InitMediaType()
+  {
+    memset((AM_MEDIA_TYPE*)this, 0, sizeof(AM_MEDIA_TYPE));
+    lSampleSize=1;
+    bFixedSizeSamples=TRUE;
+    m_format.clear();
+  }
+  void SetType(const GUID* type)         { majortype=*type; }
+  void SetSubtype(const GUID* type)      { subtype=*type; }
+  void SetFormatType(const GUID* type)   { formattype=*type; }
+  void SetTemporalCompression(BOOL on)   { bTemporalCompression=on; }
+  void SetSampleSize(ULONG size)         { if (size==0) SetVariableSize(); else { bFixedSizeSamples=TRUE; lSampleSize=size; } }
+  void SetVariableSize()                 { bFixedSizeSamples=FALSE; }
+  BYTE* AllocFormatBuffer(ULONG length)
+  {
+    m_format.resize(length);
+    cbFormat=length;
+    pbFormat=length ? &m_format[0] : NULL;
+    return pbFormat;
+  }
+  BOOL SetFormat(BYTE* format, ULONG length)
+  {
+    AllocFormatBuffer(length);
+    if (length) memcpy(pbFormat, format, length);
+    return TRUE;
+  }
+  BYTE* Format() const                   { return pbFormat; }
+  ULONG FormatLength() const             { return cbFormat; }
+  const GUID* Type() const               { return &majortype; }
+  const GUID* Subtype() const            { return &subtype; }
+  const GUID* FormatType() const         { return &formattype; }
+
+private:
+  std::vector<BYTE> m_format;
+};
+
+class CBasePin;
@@ -0,0 +1,24 @@
+// The media type and filter state of the DirectShow interfaces, for the TsReader
+// demuxer. No interface is ever called by the drivers.
+#pragma once
+#include "windows.h"
+
+typedef LONGLONG REFERENCE_TIME;
+
+inline bool operator==(const GUID& a, const GUID& b) { return memcmp(&a, &b, sizeof(GUID))==0; }
+inline bool operator!=(const GUID& a, const GUID& b) { return !(a==b); }
+
+typedef struct _AMMediaType
+{
+  GUID      majortype;
+  GUID      subtype;
+  BOOL      bFixedSizeSamples;
+  BOOL      bTemporalCompression;
+  ULONG     lSampleSize;
+  GUID      formattype;
+  IUnknown* pUnk;
+  ULONG     cbFormat;
+  BYTE*     pbFormat;
+} AM_MEDIA_TYPE;
+
+typedef enum _FilterState { State_Stopped, State_Paused, State_Running } FILTER_STATE;
@@ -0,0 +1,3 @@
+// the pins are part of the CTsReaderFilter stand-in
+#pragma once
+#include "tsreader.h"
@@ -0,0 +1,4 @@
+// narrow strings only
+#pragma once
+#include "windows.h"
+#define _T(x) x
@@ -0,0 +1,16 @@
+// Replaces the real CTsChannel for the channel worker driver, the driver derives
+// its own channels with a sink of its choice.
+#pragma once
+#include "windows.h"
+#include "tspacketview.h"
+
+class CTsChannel
+{
+public:
+  CTsChannel(int id) { m_id=id; }
+  virtual ~CTsChannel() {}
+  int Handle() { return m_id; }
+  virtual void ProcessTsPacket(const TsPacketView& packet)=0;
+protected:
+  int m_id;
+};
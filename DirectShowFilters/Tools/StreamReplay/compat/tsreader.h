@@ -0,0 +1,80 @@
+// Replaces the real CTsReaderFilter and its output pins for the TsReader demuxer
+// driver: what the demuxer asks the filter and the pins, set directly by the
+// driver. The driver runs the FillBuffer() loops of the pins itself, and plays
+// the host application: the callbacks only raise a flag, as the player does,
+// and the driver answers them from its own thread.
+#pragma once
+#include <streams.h>
+#include "demultiplexer.h"
+#include "tsduration.h"
+#include "iteletextsource.h"
+#include "idvbsub.h"
+
+class CReplayPin
+{
+public:
+  CReplayPin()                     { m_bConnected=true; m_bDiscontinuity=false; m_EnableSlowMotionOnZapping=false; }
+  bool IsConnected()               { return m_bConnected; }
+  void SetDiscontinuity(bool onOff) { m_bDiscontinuity=onOff; }
+
+  bool m_bConnected;
+  bool m_bDiscontinuity;
+  bool m_EnableSlowMotionOnZapping;
+};
+
+class CAudioPin : public CReplayPin {};
+class CVideoPin : public CReplayPin {};
+class CSubtitlePin : public CReplayPin {};
+
+class CTsReaderFilter
+{
+public:
+  CTsReaderFilter()
+  {
+    m_bStreamCompensated=false;
+    m_bLiveTv=true;
+    m_bStopping=false;
+    m_bOnZap=false;
+    m_bForceSeekOnStop=false;
+    m_bRenderingClockTooFast=false;
+    m_bRunning=true;
+    m_bSeeking=false;
+    m_bTimeShifting=true;
+    m_bMediaTypeChanged=false;
+    m_bRequestAudioChange=false;
+  }
+
+  CAudioPin*      GetAudioPin()                       { return &m_audioPin; }
+  CVideoPin*      GetVideoPin()                       { return &m_videoPin; }
+  CSubtitlePin*   GetSubtitlePin()                    { return &m_subtitlePin; }
+  IDVBSubtitle*   GetSubtitleFilter()                 { return NULL; }
+  bool            IsFilterRunning()                   { return m_bRunning; }
+  bool            IsTimeShifting()                    { return m_bTimeShifting; }
+  bool            IsRTSP()                            { return false; }
+  bool            IsLiveTV()                          { return m_bLiveTv; }
+  bool            IsSeeking()                         { return m_bSeeking; }
+  bool            IsStopping()                        { return m_bStopping; }
+  FILTER_STATE    State()                             { return State_Running; }
+  void            GetMediaPosition(REFERENCE_TIME* pMediaTime) { *pMediaTime=0; }
+  void            OnMediaTypeChanged(int)             { m_bMediaTypeChanged=true; }
+  void            OnRequestAudioChange()              { m_bRequestAudioChange=true; }
+  void            OnVideoFormatChanged(int, int, int, int, int, int, int) {}
+
+  CRefTime        Compensation;
+  bool            m_bStreamCompensated;
+  bool            m_bLiveTv;
+  volatile bool   m_bStopping;
+  bool            m_bOnZap;
+  bool            m_bForceSeekOnStop;
+  bool            m_bRenderingClockTooFast;
+  volatile bool   m_bRunning;
+  volatile bool   m_bSeeking;
+  volatile bool   m_bTimeShifting;
+  volatile bool   m_bMediaTypeChanged;
+  volatile bool   m_bRequestAudioChange;
+
+private:
+  CAudioPin       m_audioPin;
+  CVideoPin       m_videoPin;
+  CSubtitlePin    m_subtitlePin;
+};
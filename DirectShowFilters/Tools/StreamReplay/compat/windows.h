@@ -0,0 +1,222 @@
+// Just enough of windows.h for the stream code of the filters, so the replay
+// drivers build with g++ on Linux.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+typedef unsigned char  byte;
+typedef unsigned char  BYTE;
+typedef int            BOOL;
+typedef unsigned short WORD;
+typedef uint32_t       DWORD;
+typedef int32_t        LONG;
+typedef uint32_t       ULONG;
+typedef int64_t        LONGLONG;
+typedef uint64_t       ULONGLONG;
+typedef uint64_t       UINT64;
+typedef long           HRESULT;
+typedef wchar_t*       LPWSTR;
+typedef const char*    LPCTSTR;
+typedef void*          HANDLE;
+typedef void*          LPVOID;
+typedef uintptr_t      UINT_PTR;
+typedef char           CHAR;
+typedef wchar_t        WCHAR;
+typedef short          SHORT;
+typedef int            INT;
+typedef unsigned int   UINT;
+typedef int64_t        INT64;
+typedef uint64_t       DWORD64;
+typedef BYTE*          PBYTE;
+typedef wchar_t*       LPOLESTR;
+typedef const wchar_t* LPCOLESTR;
+
+// a define rather than a typedef, the filters also write "unsigned __int64";
+// long is 64 bit here, so these match the stdint types
+#define __int64 long
+#define __int32 int
+#define __int16 short
+#define __int8  char
+typedef union { LONGLONG QuadPart; } LARGE_INTEGER;
+
+#define TRUE  1
+#define FALSE 0
+#define S_OK     ((HRESULT)0)
+#define S_FALSE  ((HRESULT)1)
+#define E_FAIL   ((HRESULT)0x80004005L)
+#define INFINITE      0xffffffff
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT  258
+#define HRESULT_FROM_WIN32(x) ((HRESULT)(x))
+#define SUCCEEDED(hr) ((HRESULT)(hr) >= 0)
+#define FAILED(hr)    ((HRESULT)(hr) < 0)
+#define FILE_BEGIN    0
+#define FILE_CURRENT  1
+#define FILE_END      2
+#define _I64_MIN      INT64_MIN
+#define FIELD_OFFSET(type, field) offsetof(type, field)
+
+inline DWORD GetLastError() { return 0; }
+
+typedef struct { LONG left; LONG top; LONG right; LONG bottom; } RECT;
+
+typedef struct
+{
+  LONG   bmType;
+  LONG   bmWidth;
+  LONG   bmHeight;
+  LONG   bmWidthBytes;
+  WORD   bmPlanes;
+  WORD   bmBitsPixel;
+  LPVOID bmBits;
+} BITMAP;
+
+#define __stdcall
+#define __cdecl
+#define CALLBACK
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+
+#define _snprintf snprintf
+#define sprintf_s snprintf
+
+using std::min;
+using std::max;
+// the windows.h macros take mixed types and bit fields too
+template <class A, class B> inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <class A, class B> inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+inline LONG InterlockedIncrement(volatile LONG* p)              { return __sync_add_and_fetch(p, 1); }
+inline LONG InterlockedDecrement(volatile LONG* p)              { return __sync_sub_and_fetch(p, 1); }
+inline LONG InterlockedExchangeAdd(volatile LONG* p, LONG v)    { return __sync_fetch_and_add(p, v); }
+inline LONG InterlockedExchange(volatile LONG* p, LONG v)       { __sync_synchronize(); return __sync_lock_test_and_set(p, v); }
+
+inline void Sleep(DWORD ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* f)
+{
+  f->QuadPart=1000000000;
+  return TRUE;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* c)
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  c->QuadPart=(LONGLONG)t.tv_sec*1000000000+t.tv_nsec;
+  return TRUE;
+}
+
+// a driver that replays a stream at its own pace sets the tick count here, -1
+// gives the monotonic clock back
+inline LONGLONG& ReplayTickCount()
+{
+  static LONGLONG ticks=-1;
+  return ticks;
+}
+
+inline DWORD GetTickCount()
+{
+  if (ReplayTickCount() >= 0) return (DWORD)ReplayTickCount();
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+  return (DWORD)(c.QuadPart/1000000);
+}
+
+// the replay drivers can force the scalar code paths with NO_SSE2=1
+#define PF_XMMI_INSTRUCTIONS_AVAILABLE   6
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+inline BOOL IsProcessorFeaturePresent(DWORD)
+{
+  return getenv("NO_SSE2")==NULL;
+}
+
+// critical sections, recursive like the windows ones
+typedef std::recursive_mutex CRITICAL_SECTION;
+typedef CRITICAL_SECTION*    LPCRITICAL_SECTION;
+inline void InitializeCriticalSection(LPCRITICAL_SECTION) {}
+inline void DeleteCriticalSection(LPCRITICAL_SECTION)     {}
+inline void EnterCriticalSection(LPCRITICAL_SECTION cs)   { cs->lock(); }
+inline void LeaveCriticalSection(LPCRITICAL_SECTION cs)   { cs->unlock(); }
+
+// COM interfaces as plain abstract classes, the drivers never query them
+struct GUID { DWORD Data1; WORD Data2; WORD Data3; BYTE Data4[8]; };
+#define DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+  static const GUID name={ l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }
+struct IUnknown
+{
+  virtual ~IUnknown() {}
+};
+#define DECLARE_INTERFACE_(iface, base) struct iface : public base
+#define STDMETHOD(method)               virtual HRESULT method
+#define STDMETHODIMP                    HRESULT
+#define PURE                            =0
+#define THIS_
+#define THIS                            void
+
+// events, only what TSThread and the channel workers use
+struct CompatEvent
+{
+  std::mutex              lock;
+  std::condition_variable signal;
+  bool                    manualReset;
+  bool                    set;
+};
+
+inline HANDLE CreateEvent(void*, BOOL manualReset, BOOL initialState, void*)
+{
+  CompatEvent* e=new CompatEvent;
+  e->manualReset=manualReset!=FALSE;
+  e->set=initialState!=FALSE;
+  return e;
+}
+
+inline BOOL SetEvent(HANDLE h)
+{
+  CompatEvent* e=(CompatEvent*)h;
+  std::lock_guard<std::mutex> guard(e->lock);
+  e->set=true;
+  if (e->manualReset) e->signal.notify_all(); else e->signal.notify_one();
+  return TRUE;
+}
+
+inline BOOL ResetEvent(HANDLE h)
+{
+  CompatEvent* e=(CompatEvent*)h;
+  std::lock_guard<std::mutex> guard(e->lock);
+  e->set=false;
+  return TRUE;
+}
+
+inline DWORD WaitForSingleObject(HANDLE h, DWORD ms)
+{
+  CompatEvent* e=(CompatEvent*)h;
+  std::unique_lock<std::mutex> guard(e->lock);
+  if (ms==INFINITE)
+    e->signal.wait(guard, [e] { return e->set; });
+  else if (!e->signal.wait_for(guard, std::chrono::milliseconds(ms), [e] { return e->set; }))
+    return WAIT_TIMEOUT;
+  if (!e->manualReset) e->set=false;
+  return WAIT_OBJECT_0;
+}
+
+inline BOOL CloseHandle(HANDLE h)
+{
+  delete (CompatEvent*)h;
+  return TRUE;
+}
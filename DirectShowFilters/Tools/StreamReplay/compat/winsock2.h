@@ -0,0 +1,36 @@
+// winsock on top of the bsd sockets, for the network sink
+#pragma once
+#include "windows.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET  (-1)
+#define SOCKET_ERROR    (-1)
+#define MAKEWORD(a, b)  ((WORD)(((BYTE)(a)) | (((WORD)(BYTE)(b))<<8)))
+
+typedef struct { WORD wVersion; } WSADATA;
+
+inline int WSAStartup(WORD version, WSADATA* data)
+{
+  data->wVersion=version;
+  return 0;
+}
+
+inline int WSACleanup()
+{
+  return 0;
+}
+
+inline int WSAGetLastError()
+{
+  return errno;
+}
+
+inline int closesocket(SOCKET s)
+{
+  return close(s);
+}
@@ -0,0 +1,5 @@
+// the dolby digital plus subtype of the windows media codec headers
+#pragma once
+#include "strmif.h"
+
+DEFINE_GUID(MEDIASUBTYPE_DOLBY_DDPLUS, 0xa7fb87af, 0x2d02, 0x42fb, 0xa4, 0xd4, 0x05, 0xcd, 0x93, 0x84, 0x3b, 0xdd);
@@ -0,0 +1,7 @@
+// the debug macros of the DirectShow base classes, as in a release build
+#pragma once
+
+#ifndef ASSERT
+#define ASSERT(x) ((void)0)
+#endif
+#define EXECUTE_ASSERT(x) ((void)(x))
@@ -63,6 +63,7 @@ CAudioPin::CAudioPin(LPUNKNOWN pUnk, CTsReaderFilter *pFilter, HRESULT *phr,CCri
 {
   m_bConnected=false;
   m_rtStart=0;
+  m_durationVersion=-1;
   m_dwSeekingCaps =
     AM_SEEKING_CanSeekAbsolute  |
     AM_SEEKING_CanSeekForwards  |
@@ -200,7 +201,7 @@ HRESULT CAudioPin::FillBuffer(IMediaSample *pSample)
       if (m_pTsReaderFilter->IsSeeking() || m_pTsReaderFilter->IsStopping())// /*|| m_bSeeking*/ || m_pTsReaderFilter->IsSeekingToEof())
       {
         //if (m_pTsReaderFilter->m_ShowBufferAudio) LogDebug("aud:isseeking");
-        Sleep(20);
+        demux.WaitForAudio(20);
         pSample->SetTime(NULL,NULL);
         pSample->SetActualDataLength(0);
         pSample->SetSyncPoint(FALSE);
@@ -223,7 +224,8 @@ HRESULT CAudioPin::FillBuffer(IMediaSample *pSample)
 
       if (buffer==NULL)
       {
-        Sleep(10);
+        //wait for the demuxer to queue audio or to change state
+        demux.WaitForAudio(10);
       }
       else
       {
@@ -554,9 +556,17 @@ STDMETHODIMP CAudioPin::GetAvailable( LONGLONG * pEarliest, LONGLONG * pLatest )
 STDMETHODIMP CAudioPin::GetDuration(LONGLONG *pDuration)
 {
   //LogDebug("aud:GetDuration");
+  CTsDuration& duration=m_pTsReaderFilter->GetDuration();
+  LONG version=duration.Version();
+  //FillBuffer() polls with pDuration==NULL, nothing to do until the pcrs change
+  if (pDuration==NULL && version==m_durationVersion)
+  {
+    return S_OK;
+  }
+  m_durationVersion=version;
+
   if (m_pTsReaderFilter->IsTimeShifting())
   {
-    CTsDuration duration=m_pTsReaderFilter->GetDuration();
     CRefTime totalDuration=duration.TotalDuration();
     m_rtDuration=totalDuration;
   }
@@ -63,6 +63,7 @@ protected:
   BOOL      m_bDiscontinuity;
   CCritSec* m_section;
   bool      m_bPresentSample;
+  LONG      m_durationVersion;
   bool      m_bSubtitleCompensationSet;
 };
 
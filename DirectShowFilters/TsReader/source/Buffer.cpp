@@ -163,7 +163,7 @@ void CBuffer::SetPts(CPcr& pts)
 // m_firstPcr   : earliest pcr value found since start of playback
 // m_maxPcr     : in case of a PCR rollover, endpcr contains the last pcr timestamp before the
 //                rollover occured
-void CBuffer::SetPcr(CPcr& firstPcr,CPcr& maxPcr)
+void CBuffer::SetPcr(const CPcr& firstPcr,const CPcr& maxPcr)
 {
   m_firstPcr=firstPcr;
   m_maxPcr=maxPcr;
@@ -31,7 +31,7 @@ public:
   byte*  Data();
   void   Add(CBuffer* pBuffer);
   void   Add(byte* data, int len);
-  void   SetPcr(CPcr& firstPcr,CPcr& maxPcr);
+  void   SetPcr(const CPcr& firstPcr,const CPcr& maxPcr);
   void   SetPts(CPcr& pts);
   void   SetLength(int len);
   CPcr&  Pcr();
@@ -488,6 +488,29 @@ void CDeMultiplexer::Flush()
   SetHoldAudio(holdAudio);
   SetHoldVideo(holdVideo);
   SetHoldSubtitle(holdSubtitle);
+  SignalStateChange();
+}
+
+bool CDeMultiplexer::WaitForAudio(DWORD dwTimeout)
+{
+  return m_eventAudio.Wait(dwTimeout) != FALSE;
+}
+
+bool CDeMultiplexer::WaitForVideo(DWORD dwTimeout)
+{
+  return m_eventVideo.Wait(dwTimeout) != FALSE;
+}
+
+bool CDeMultiplexer::WaitForSubtitle(DWORD dwTimeout)
+{
+  return m_eventSubtitle.Wait(dwTimeout) != FALSE;
+}
+
+void CDeMultiplexer::SignalStateChange()
+{
+  m_eventAudio.Set();
+  m_eventVideo.Set();
+  m_eventSubtitle.Set();
 }
 
 ///
@@ -682,6 +705,7 @@ void CDeMultiplexer::Start()
 void CDeMultiplexer::SetEndOfFile(bool bEndOfFile)
 {
   m_bEndOfFile=bEndOfFile;
+  SignalStateChange();
 }
 /// Returns true if we reached the end of the file
 bool CDeMultiplexer::EndOfFile()
@@ -739,6 +763,7 @@ int CDeMultiplexer::ReadFromFile(bool isAudio, bool isVideo)
         {
           LogDebug("demux:endoffile");
           m_bEndOfFile=true;
+          SignalStateChange();
           return 0;
         }
       }
@@ -769,6 +794,7 @@ int CDeMultiplexer::ReadFromFile(bool isAudio, bool isVideo)
           //set EOF flag and return
           LogDebug("demux:endoffile");
           m_bEndOfFile=true;
+          SignalStateChange();
           return 0;
         }
       }
@@ -1024,6 +1050,7 @@ void CDeMultiplexer::FillAudio(CTsHeader& header, byte* tsPacket)
 
           m_vecAudioBuffers.push_back(*it);
           m_t_vecAudioBuffers.erase(it);
+          m_eventAudio.Set();
         }
       }
       else
@@ -1349,6 +1376,7 @@ void CDeMultiplexer::FillVideoH264(CTsHeader& header, byte* tsPacket)
 
             // ownership is transfered to vector
             m_vecVideoBuffers.push_back(pCurrentVideoBuffer);
+            m_eventVideo.Set();
           }
 
           if (Gop)
@@ -1699,6 +1727,7 @@ void CDeMultiplexer::FillVideoMPEG2(CTsHeader& header, byte* tsPacket)
 
               // ownership is transfered to vector
               m_vecVideoBuffers.push_back(pCurrentVideoBuffer);
+              m_eventVideo.Set();
             }
             m_CurrentVideoPts.IsValid=false ;   
             
@@ -1825,6 +1854,7 @@ void CDeMultiplexer::FillSubtitle(CTsHeader& header, byte* tsPacket)
     m_pCurrentSubtitleBuffer->Add(tsPacket,188);
 
     m_vecSubtitleBuffers.push_back(m_pCurrentSubtitleBuffer);
+    m_eventSubtitle.Set();
 
     m_pCurrentSubtitleBuffer = new CBuffer();
   }
@@ -130,6 +130,14 @@ public:
   void SetAudioChanging(bool onOff);
   bool IsAudioChanging(void);
 
+  // Blocks until a buffer has been queued for the stream or SignalStateChange()
+  // has been called, returns false when the timeout expired first
+  bool WaitForAudio(DWORD dwTimeout);
+  bool WaitForVideo(DWORD dwTimeout);
+  bool WaitForSubtitle(DWORD dwTimeout);
+  // Wakes up all output pins waiting for data, used on seek/stop/eof
+  void SignalStateChange();
+
   bool m_DisableDiscontinuitiesFiltering;
   DWORD m_LastDataFromRtsp;
   bool m_bAudioVideoReady;
@@ -159,6 +167,9 @@ private:
   CCritSec m_sectionRead;
   CCritSec m_sectionAudioChanging;
   CCritSec m_sectionMediaChanging;
+  CAMEvent m_eventAudio;
+  CAMEvent m_eventVideo;
+  CAMEvent m_eventSubtitle;
   FileReader* m_reader;
   CPatParser m_patParser;
   CMpegPesParser *m_mpegPesParser;
@@ -46,6 +46,7 @@ CSubtitlePin::CSubtitlePin(LPUNKNOWN pUnk, CTsReaderFilter *pFilter, HRESULT *ph
 {
   m_rtStart=0;
   m_bConnected=false;
+  m_durationVersion=-1;
   m_dwSeekingCaps =
   AM_SEEKING_CanSeekAbsolute  |
   AM_SEEKING_CanSeekForwards  |
@@ -208,7 +209,7 @@ HRESULT CSubtitlePin::FillBuffer(IMediaSample *pSample)
       if (m_pTsReaderFilter->IsSeeking() || m_pTsReaderFilter->IsStopping() || !m_bRunning)
       {
         //LogDebug("sub:isseeking:%d %d",m_pTsReaderFilter->IsSeeking() ,m_bSeeking);
-        Sleep(20);
+        demux.WaitForSubtitle(20);
         pSample->SetTime(NULL,NULL);
         pSample->SetActualDataLength(0);
         pSample->SetSyncPoint(FALSE);
@@ -241,7 +242,8 @@ HRESULT CSubtitlePin::FillBuffer(IMediaSample *pSample)
       if (buffer == NULL)
       {
         m_bInFillBuffer = false;
-        Sleep(20);
+        //wait for the demuxer to queue subtitles or to change state
+        demux.WaitForSubtitle(20);
       }
       else
       {
@@ -524,9 +526,17 @@ STDMETHODIMP CSubtitlePin::GetAvailable( LONGLONG * pEarliest, LONGLONG * pLates
 //
 STDMETHODIMP CSubtitlePin::GetDuration(LONGLONG *pDuration)
 {
+  CTsDuration& duration=m_pTsReaderFilter->GetDuration();
+  LONG version=duration.Version();
+  //FillBuffer() polls with pDuration==NULL, nothing to do until the pcrs change
+  if (pDuration==NULL && version==m_durationVersion)
+  {
+    return S_OK;
+  }
+  m_durationVersion=version;
+
   if (m_pTsReaderFilter->IsTimeShifting())
   {
-    CTsDuration duration = m_pTsReaderFilter->GetDuration();
     CRefTime totalDuration = duration.TotalDuration();
     m_rtDuration = totalDuration;
   }
@@ -553,6 +563,7 @@ STDMETHODIMP CSubtitlePin::GetCurrentPosition(LONGLONG *pCurrent)
 void CSubtitlePin::SetRunningStatus(bool onOff)
 {
 	m_bRunning = onOff;
+	m_pTsReaderFilter->GetDemultiplexer().SignalStateChange();
 }
 
 void CSubtitlePin::LogCurrentPosition()
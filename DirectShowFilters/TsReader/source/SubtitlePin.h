@@ -68,6 +68,7 @@ protected:
   CRefTime  m_lastSeek;
   bool      m_bInFillBuffer;
   bool      m_bPresentSample;
+  LONG      m_durationVersion;
 	bool      m_bRunning ;
 };
 
@@ -31,6 +31,7 @@ extern void LogDebug(const char *fmt, ...) ;
 CTsDuration::CTsDuration()
 {
   m_videoPid=-1;
+  m_version=0;
 }
 
 CTsDuration::~CTsDuration(void)
@@ -45,6 +46,10 @@ void CTsDuration::SetFileReader(FileReader* reader)
 
 void CTsDuration::Set(CPcr& startPcr, CPcr& endPcr, CPcr& maxPcr)
 {
+  if (m_startPcr!=startPcr || m_endPcr!=endPcr || m_maxPcr!=maxPcr || !m_firstStartPcr.IsValid)
+  {
+    InterlockedIncrement(&m_version);
+  }
   m_startPcr=startPcr;
   m_endPcr=endPcr;
   m_maxPcr=maxPcr;
@@ -185,6 +190,12 @@ void CTsDuration::UpdateDuration()
   //park filepointer at end of file
   m_reader->SetFilePointer(-1,FILE_END);
   m_reader->Read(buffer,1,&dwBytesRead);
+  InterlockedIncrement(&m_version);
+}
+
+LONG CTsDuration::Version()
+{
+  return m_version;
 }
 
 void CTsDuration::OnTsPacket(byte* tsPacket)
@@ -21,6 +21,8 @@ public:
   CPcr     FirstStartPcr();
   CRefTime TotalDuration();
   void     Set(CPcr& startPcr, CPcr& endPcr, CPcr& maxPcr);
+  // changes whenever the pcr values change, lets callers skip recalculating the duration
+  LONG     Version();
 private:
   int          m_pid;
   int          m_videoPid;
@@ -42,4 +44,5 @@ private:
   bool         m_bSearchStart;
   bool         m_bSearchEnd;
   bool         m_bSearchMax;
+  volatile LONG m_version;
 };
@@ -464,6 +464,7 @@ STDMETHODIMP CTsReaderFilter::Stop()
   //guarantees that audio/video/subtitle pins dont block in the fillbuffer() method
   //m_bSeeking = true;
   m_bStopping = true;
+  m_demultiplexer.SignalStateChange();
 
   if (m_pSubtitlePin)
   {
@@ -1023,6 +1024,7 @@ void CTsReaderFilter::SeekPreStart(CRefTime& rtAbsSeek)
 //    m_demultiplexer.SetHoldVideo(true) ;
  
     m_WaitForSeekToEof=1 ; // 
+    m_demultiplexer.SignalStateChange();
 
     m_demultiplexer.CallTeletextEventCallback(TELETEXT_EVENT_SEEK_START,TELETEXT_EVENTVALUE_NONE);
  
@@ -1065,6 +1067,7 @@ void CTsReaderFilter::SeekPreStart(CRefTime& rtAbsSeek)
 //    m_pTsReaderFilter->SeekDone(rtSeek);
 
     m_WaitForSeekToEof=0 ; // 
+    m_demultiplexer.SignalStateChange();
 
     if (m_fileDuration != NULL)
     {
@@ -49,6 +49,7 @@ CVideoPin::CVideoPin(LPUNKNOWN pUnk, CTsReaderFilter *pFilter, HRESULT *phr,CCri
 {
   m_rtStart=0;
   m_bConnected=false;
+  m_durationVersion=-1;
   m_dwSeekingCaps =
     AM_SEEKING_CanSeekAbsolute  |
     AM_SEEKING_CanSeekForwards  |
@@ -282,7 +283,7 @@ HRESULT CVideoPin::FillBuffer(IMediaSample *pSample)
       if (m_pTsReaderFilter->IsSeeking() || m_pTsReaderFilter->IsStopping()) //|| m_bSeeking*/ || m_pTsReaderFilter->IsSeekingToEof())
       {
         //if (m_pTsReaderFilter->m_ShowBufferVideo) LogDebug("vid:isseeking:%d %d",m_pTsReaderFilter->IsSeeking() ,m_bSeeking);
-        Sleep(5);
+        demux.WaitForVideo(5);
         pSample->SetActualDataLength(0);
         return NOERROR;
       }
@@ -306,7 +307,8 @@ HRESULT CVideoPin::FillBuffer(IMediaSample *pSample)
 
       if (buffer == NULL)
       {
-        Sleep(10);
+        //wait for the demuxer to queue video or to change state
+        demux.WaitForVideo(10);
       }
       else
       {
@@ -610,9 +612,17 @@ STDMETHODIMP CVideoPin::GetAvailable( LONGLONG * pEarliest, LONGLONG * pLatest )
 //
 STDMETHODIMP CVideoPin::GetDuration(LONGLONG *pDuration)
 {
+  CTsDuration& duration=m_pTsReaderFilter->GetDuration();
+  LONG version=duration.Version();
+  //FillBuffer() polls with pDuration==NULL, nothing to do until the pcrs change
+  if (pDuration==NULL && version==m_durationVersion)
+  {
+    return S_OK;
+  }
+  m_durationVersion=version;
+
   if (m_pTsReaderFilter->IsTimeShifting())
   {
-    CTsDuration duration=m_pTsReaderFilter->GetDuration();
     CRefTime totalDuration=duration.TotalDuration();
     m_rtDuration=totalDuration;
   }
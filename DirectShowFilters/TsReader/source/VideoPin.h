@@ -67,6 +67,7 @@ protected:
   BOOL      m_bDiscontinuity;
   CCritSec* m_section;
   bool      m_bPresentSample;
+  LONG      m_durationVersion;
 
   FILTER_INFO m_filterInfo;
   
@@ -62,11 +62,11 @@ STDMETHODIMP CCaGrabber::SetCallBack( ICACallback* callback)
 	return S_OK;
 }
 
-void CCaGrabber::OnTsPacket(byte* tsPacket)
+void CCaGrabber::OnTsPacket(const TsPacketView& packet)
 {
   CEnterCriticalSection enter(m_section);
 	if (m_pCallback==NULL) return;
-	CSectionDecoder::OnTsPacket(tsPacket);
+	CSectionDecoder::OnTsPacket(packet);
 }
 
 void CCaGrabber::OnNewSection(CSection& section)
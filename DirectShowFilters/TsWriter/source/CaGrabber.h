@@ -54,7 +54,7 @@ public:
 	STDMETHODIMP GetCaData(BYTE *caData);
 	STDMETHODIMP Reset();
 
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
   virtual void OnNewSection(CSection& section);
 private:
 	ICACallback* m_pCallback;
@@ -171,15 +171,15 @@ STDMETHODIMP CChannelScan::GetChannel(int index,
 	return S_OK;
 }
 
-void CChannelScan::OnTsPacket(byte* tsPacket)
+void CChannelScan::OnTsPacket(const TsPacketView& packet)
 {
 	CEnterCriticalSection enter(m_section);
 
 	if (m_bIsParsing)
-		m_patParser.OnTsPacket(tsPacket);
+		m_patParser.OnTsPacket(packet);
 
 	if (m_bIsParsingNIT)
-    m_nit.OnTsPacket(tsPacket);
+    m_nit.OnTsPacket(packet);
 }
 
 
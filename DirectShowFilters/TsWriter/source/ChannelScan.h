@@ -102,7 +102,7 @@ public:
 	STDMETHODIMP GetNITCount(int* transponderCount);
 	STDMETHODIMP GetNITChannel(int channel,int* type, int* frequency,int *polarisation, int* modulation, int* symbolrate, int* bandwidth, int* fecInner, int* rollOff, char** networkName);
 
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
 private:
 	CPatParser m_patParser;
 	bool m_bIsParsing;
@@ -0,0 +1,144 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#include <windows.h>
+#include <mmsystem.h>
+#include <streams.h>
+#include "ChannelWorker.h"
+#include "TsChannel.h"
+
+extern void LogDebug(const char *fmt, ...) ;
+
+CChannelWorker::CChannelWorker(CTsChannel* pChannel)
+{
+  m_pChannel=pChannel;
+  m_batches=new Batch[CHANNEL_QUEUE_BATCHES];
+  m_pFill=NULL;
+  m_hDataEvent=CreateEvent(NULL, FALSE, FALSE, NULL);
+  m_lWritten=0;
+  m_lRead=0;
+  m_lQueuedPackets=0;
+  m_lMaxQueuedPackets=0;
+  m_lDroppedPackets=0;
+  m_lMaxLatency=0;
+  m_bDropping=false;
+  StartThread();
+}
+
+CChannelWorker::~CChannelWorker(void)
+{
+  // the channel is already gone from the streaming thread, hand over what is left
+  // and wait for the worker to write it, it is still using the channel until then
+  if (m_pFill!=NULL && m_pFill->packets > 0)
+  {
+    Publish();
+  }
+  StopThread(INFINITE);
+  CloseHandle(m_hDataEvent);
+  delete[] m_batches;
+}
+
+void CChannelWorker::Write(byte* tsPacket)
+{
+  if (m_pFill==NULL)
+  {
+    if ((ULONG)(m_lWritten-m_lRead) >= CHANNEL_QUEUE_BATCHES)
+    {
+      if (!m_bDropping)
+      {
+        LogDebug("ChannelWorker: channel %d can't keep up, dropping packets", m_pChannel->Handle());
+        m_bDropping=true;
+      }
+      InterlockedIncrement(&m_lDroppedPackets);
+      return;
+    }
+    m_bDropping=false;
+    m_pFill=&m_batches[(ULONG)m_lWritten & (CHANNEL_QUEUE_BATCHES-1)];
+    m_pFill->packets=0;
+    m_pFill->time=timeGetTime();
+  }
+  memcpy(m_pFill->data[m_pFill->packets], tsPacket, 188);
+  m_pFill->packets++;
+  if (m_pFill->packets==CHANNEL_BATCH_PACKETS)
+  {
+    Publish();
+  }
+}
+
+void CChannelWorker::Flush()
+{
+  // a worker which is behind gets full batches, that keeps small samples from
+  // wasting the queue
+  if (m_pFill!=NULL && m_pFill->packets > 0 && m_lRead==m_lWritten)
+  {
+    Publish();
+  }
+}
+
+void CChannelWorker::Publish()
+{
+  LONG queued=InterlockedExchangeAdd(&m_lQueuedPackets, m_pFill->packets)+m_pFill->packets;
+  if (queued > m_lMaxQueuedPackets) m_lMaxQueuedPackets=queued;
+  m_pFill=NULL;
+  // the interlocked increment is a full barrier, the worker sees the batch before the new count
+  InterlockedIncrement(&m_lWritten);
+  SetEvent(m_hDataEvent);
+}
+
+bool CChannelWorker::ProcessBatches()
+{
+  bool processed=false;
+  while (m_lRead!=m_lWritten)
+  {
+    Batch& batch=m_batches[(ULONG)m_lRead & (CHANNEL_QUEUE_BATCHES-1)];
+    for (int i=0; i < batch.packets;++i)
+    {
+      TsPacketView packet(batch.data[i]);
+      m_pChannel->ProcessTsPacket(packet);
+    }
+    LONG latency=(LONG)(timeGetTime()-batch.time);
+    if (latency > m_lMaxLatency) m_lMaxLatency=latency;
+    InterlockedExchangeAdd(&m_lQueuedPackets, -batch.packets);
+    // the batch may be reused from now on
+    InterlockedIncrement(&m_lRead);
+    processed=true;
+  }
+  return processed;
+}
+
+void CChannelWorker::ThreadProc()
+{
+  while (!ThreadIsStopping(0))
+  {
+    if (!ProcessBatches())
+    {
+      WaitForSingleObject(m_hDataEvent, 10);
+    }
+  }
+  ProcessBatches();
+}
+
+void CChannelWorker::GetCounters(int* queuedPackets, int* maxQueuedPackets, int* droppedPackets, int* maxLatencyMs)
+{
+  *queuedPackets=m_lQueuedPackets;
+  *maxQueuedPackets=InterlockedExchange(&m_lMaxQueuedPackets, 0);
+  *droppedPackets=m_lDroppedPackets;
+  *maxLatencyMs=InterlockedExchange(&m_lMaxLatency, 0);
+}
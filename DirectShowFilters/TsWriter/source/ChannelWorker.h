@@ -0,0 +1,78 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+#include "..\..\shared\TSThread.h"
+
+#define CHANNEL_BATCH_PACKETS   128     // ts packets per batch
+#define CHANNEL_QUEUE_BATCHES   128     // power of 2, about 0.6 s of a 38 Mbit/s mux
+
+class CTsChannel;
+
+// Runs the analyzers, grabbers and recorders of a channel on a thread of their own,
+// so a slow consumer (a WriteFile blocking on the disk) only delays its own channel
+// instead of the streaming thread and every other channel.
+// The streaming thread copies the packets into batches and hands complete batches
+// over through a single producer / single consumer ring, no locks are taken on
+// either side. The worker processes the batches in order, so the channel sees its
+// packets in the order they arrived.
+// The streaming thread is never blocked: if the ring is full the packets are
+// dropped and counted until the worker has made room again, the recorders see the
+// gap as a continuity error like any other loss.
+class CChannelWorker : public TSThread
+{
+public:
+  CChannelWorker(CTsChannel* pChannel);
+  virtual ~CChannelWorker(void);
+
+  // streaming thread
+  void Write(byte* tsPacket);
+  // hands over the partial batch if the worker is idle, call at the end of each media sample
+  void Flush();
+
+  // queued and dropped packets, the maxima are reset by each call
+  void GetCounters(int* queuedPackets, int* maxQueuedPackets, int* droppedPackets, int* maxLatencyMs);
+
+  void ThreadProc();
+
+private:
+  typedef struct stBatch
+  {
+    int   packets;
+    DWORD time;             // timeGetTime() when the first packet was queued
+    byte  data[CHANNEL_BATCH_PACKETS][188];
+  }Batch;
+
+  void Publish();
+  bool ProcessBatches();
+
+  CTsChannel*   m_pChannel;
+  Batch*        m_batches;
+  Batch*        m_pFill;    // batch being filled by the streaming thread, NULL if none
+  HANDLE        m_hDataEvent;
+
+  volatile LONG m_lWritten;   // batches handed over, only written by the streaming thread
+  volatile LONG m_lRead;      // batches processed, only written by the worker
+  volatile LONG m_lQueuedPackets;
+  volatile LONG m_lMaxQueuedPackets;
+  volatile LONG m_lDroppedPackets;
+  volatile LONG m_lMaxLatency;
+  bool          m_bDropping;
+};
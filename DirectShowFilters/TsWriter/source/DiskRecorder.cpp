@@ -93,6 +93,12 @@ CDiskRecorder::CDiskRecorder(RecordingMode mode)
 
 	m_bRunning=false;
 	m_pTimeShiftFile=NULL;
+	m_pNetworkSink=NULL;
+	m_wszAddress[0]=0;
+	m_iPort=0;
+	m_bRtp=false;
+	if (m_recordingMode == Network)
+		m_pNetworkSink=new CNetworkSink();
 
   m_iTsContinuityCounter=0;
 
@@ -154,6 +160,11 @@ CDiskRecorder::~CDiskRecorder(void)
   {
 	  CloseHandle(m_hFile);
 	  m_hFile = INVALID_HANDLE_VALUE; // Invalidate the file
+  }
+  if (m_pNetworkSink!=NULL)
+  {
+    delete m_pNetworkSink;
+    m_pNetworkSink=NULL;
   }
 	delete [] m_pWriteBuffer;
 	m_pPmtParser->Reset();
@@ -204,6 +215,40 @@ void CDiskRecorder::SetFileNameW(wchar_t* pwszFileName)
 	}
 }
 
+void CDiskRecorder::SetDestination(wchar_t* address, int port, bool rtp)
+{
+	CEnterCriticalSection enter(m_section);
+	try
+	{
+		m_iPacketCounter=0;
+		m_iPmtPid=-1;
+		m_pcrPid=-1;
+		m_vecPids.clear();
+		m_AudioOrVideoSeen=false ;
+		m_bStartPcrFound=false;
+		m_bDetermineNewStartPcr=false;
+		wcsncpy(m_wszAddress,address,63);
+		m_wszAddress[63]=0;
+		m_iPort=port;
+		m_bRtp=rtp;
+		WriteLog(L"set destination:%s:%d %s", m_wszAddress, m_iPort, (rtp ? L"rtp" : L"udp"));
+	}
+	catch(...)
+	{
+		WriteLog(L"SetDestination exception");
+	}
+}
+
+void CDiskRecorder::GetNetworkCounters(int* datagramsSent, int* datagramsDropped)
+{
+	*datagramsSent=0;
+	*datagramsDropped=0;
+	if (m_pNetworkSink!=NULL)
+	{
+		m_pNetworkSink->GetCounters(datagramsSent,datagramsDropped);
+	}
+}
+
 bool CDiskRecorder::Start()
 {
 	CEnterCriticalSection enter(m_section);
@@ -216,41 +261,53 @@ bool CDiskRecorder::Start()
 			return false;
 		}
 
-		if (wcslen(m_wszFileName)==0) return false;
-		::DeleteFileW((LPCWSTR) m_wszFileName);
-		m_iPart=2;
-		if (m_recordingMode==RecordingMode::TimeShift)
+		if (m_recordingMode==RecordingMode::Network)
 		{
-			m_pTimeShiftFile = new MultiFileWriter(&m_params);
-			if (FAILED(m_pTimeShiftFile->OpenFile(m_wszFileName))) 
+			if (wcslen(m_wszAddress)==0) return false;
+			if (!m_pNetworkSink->Open(m_wszAddress,m_iPort,m_bRtp))
 			{
-				WriteLog(L"failed to open filename:%s %d",m_wszFileName,GetLastError());
-				m_pTimeShiftFile->CloseFile();
-				delete m_pTimeShiftFile;
-				m_pTimeShiftFile=NULL;
+				WriteLog(L"failed to open destination:%s:%d %d",m_wszAddress,m_iPort,GetLastError());
 				return false;
 			}
 		}
 		else
 		{
-			if (m_hFile!=INVALID_HANDLE_VALUE)
+			if (wcslen(m_wszFileName)==0) return false;
+			::DeleteFileW((LPCWSTR) m_wszFileName);
+			m_iPart=2;
+			if (m_recordingMode==RecordingMode::TimeShift)
 			{
-				CloseHandle(m_hFile);
-				m_hFile=INVALID_HANDLE_VALUE;
+				m_pTimeShiftFile = new MultiFileWriter(&m_params);
+				if (FAILED(m_pTimeShiftFile->OpenFile(m_wszFileName))) 
+				{
+					WriteLog(L"failed to open filename:%s %d",m_wszFileName,GetLastError());
+					m_pTimeShiftFile->CloseFile();
+					delete m_pTimeShiftFile;
+					m_pTimeShiftFile=NULL;
+					return false;
+				}
 			}
-			m_hFile = CreateFileW(	m_wszFileName,						// The filename
-									(DWORD) GENERIC_WRITE,				// File access
-									(DWORD) FILE_SHARE_READ,			// Share access
-									NULL,								// Security
-									(DWORD) OPEN_ALWAYS,				// Open flags
+			else
+			{
+				if (m_hFile!=INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(m_hFile);
+					m_hFile=INVALID_HANDLE_VALUE;
+				}
+				m_hFile = CreateFileW(	m_wszFileName,						// The filename
+										(DWORD) GENERIC_WRITE,				// File access
+										(DWORD) FILE_SHARE_READ,			// Share access
+										NULL,								// Security
+										(DWORD) OPEN_ALWAYS,				// Open flags
 //									(DWORD) FILE_FLAG_RANDOM_ACCESS,
 //									(DWORD) FILE_FLAG_WRITE_THROUGH,	// More flags
-									(DWORD) 0,							// More flags
-									NULL);								// Template
-			if (m_hFile == INVALID_HANDLE_VALUE)
-			{
-				LogDebug(L"Recorder:unable to create file:'%s' %d",m_wszFileName, GetLastError());
-				return false;
+										(DWORD) 0,							// More flags
+										NULL);								// Template
+				if (m_hFile == INVALID_HANDLE_VALUE)
+				{
+					LogDebug(L"Recorder:unable to create file:'%s' %d",m_wszFileName, GetLastError());
+					return false;
+				}
 			}
 		}
 		m_iPmtContinuityCounter=-1;
@@ -297,6 +354,10 @@ void CDiskRecorder::Stop()
 			CloseHandle(m_hFile);
 			m_hFile=INVALID_HANDLE_VALUE;
 		}
+		if (m_pNetworkSink!=NULL)
+		{
+			m_pNetworkSink->Close();
+		}
 		m_iPmtPid=-1;
 		Reset();
 	}
@@ -506,17 +567,15 @@ void CDiskRecorder::GetTotalBytes(int* packetsProcessed)
   (*packetsProcessed) = m_TsPacketCount;
 }
 
-void CDiskRecorder::OnTsPacket(byte* tsPacket)
+void CDiskRecorder::OnTsPacket(const TsPacketView& packet)
 {
 	if (m_bPaused) return;
 	if (m_bRunning)
 	{
+		if (packet.Pid==0x1fff) return;
+		if (packet.TransportError) return;
 		CEnterCriticalSection enter(m_section);		
-		CTsHeader header(tsPacket);
-		if (header.Pid==0x1fff) return;
-		if (header.SyncByte!=0x47) return;
-		if (header.TransportError) return;
-  	WriteTs(tsPacket);
+  	WriteTs(packet.Data);
 	}
 }
 
@@ -525,10 +584,22 @@ void CDiskRecorder::Write(byte* buffer,int len)
 	CEnterCriticalSection enter(m_section);
 	if (m_recordingMode==RecordingMode::TimeShift)
 		WriteToTimeshiftFile(buffer,len);
+	else if (m_recordingMode==RecordingMode::Network)
+		WriteToNetwork(buffer,len);
 	else
 		WriteToRecording(buffer,len);
 }
 
+void CDiskRecorder::WriteToNetwork(byte* buffer, int len)
+{
+	// the sink queues the packets and paces them by their pcrs
+	if (!m_bRunning || m_bPaused || buffer==NULL) return;
+	for (int i=0; i+188 <= len; i+=188)
+	{
+		m_pNetworkSink->Write(&buffer[i]);
+	}
+}
+
 void CDiskRecorder::WriteToRecording(byte* buffer, int len)
 {
 	CEnterCriticalSection enter(m_section);
@@ -728,6 +799,8 @@ void CDiskRecorder::WriteLog(const char* fmt,...)
 
 	if (m_recordingMode==RecordingMode::TimeShift)
 		LogDebug("Recorder: TIMESHIFT %s",logbuffer);
+	else if (m_recordingMode==RecordingMode::Network)
+		LogDebug("Recorder: NETWORK   %s",logbuffer);
 	else
 		LogDebug("Recorder: RECORD    %s",logbuffer);
 }
@@ -745,6 +818,8 @@ void CDiskRecorder::WriteLog(const wchar_t* fmt,...)
 
   if (m_recordingMode==RecordingMode::TimeShift)
     LogDebug(L"Recorder: TIMESHIFT %s",logbuffer);
+  else if (m_recordingMode==RecordingMode::Network)
+    LogDebug(L"Recorder: NETWORK   %s",logbuffer);
   else
     LogDebug(L"Recorder: RECORD    %s",logbuffer);
 }
@@ -23,10 +23,12 @@
 #include "criticalsection.h"
 #include "entercriticalsection.h"
 #include "..\..\shared\TsHeader.h"
+#include "..\..\shared\TsPacketView.h"
 #include "..\..\shared\adaptionfield.h"
 #include "..\..\shared\pcr.h"
 #include "videoaudioobserver.h"
 #include "PmtParser.h"
+#include "NetworkSink.h"
 #include <vector>
 #include <map>
 using namespace std;
@@ -42,7 +44,8 @@ using namespace Mediaportal;
 enum RecordingMode
 {
 	TimeShift=0,
-	Recording=1
+	Recording=1,
+	Network=2
 };
 
 //* enum which specified the pid type 
@@ -83,6 +86,9 @@ public:
 	~CDiskRecorder(void);
 	
 	void SetFileNameW(wchar_t* pwszFileName);
+	// Only needed for network streaming
+	void SetDestination(wchar_t* address, int port, bool rtp);
+	void GetNetworkCounters(int* datagramsSent, int* datagramsDropped);
 	void SetChannelType(int channelType);
 	bool Start();
 	void Stop();
@@ -111,12 +117,13 @@ public:
   void GetDiscontinuityCounter(int* counter);
   void GetTotalBytes(int* packetsProcessed);
 
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
 	void Write(byte* buffer, int len);
 
 private:  
 	void WriteToRecording(byte* buffer, int len);
 	void WriteToTimeshiftFile(byte* buffer, int len);
+	void WriteToNetwork(byte* buffer, int len);
 	void WriteLog(const char *fmt, ...);
 	void WriteLog(const wchar_t *fmt, ...);
 	void SetPcrPid(int pcrPid);
@@ -138,6 +145,10 @@ private:
 	wchar_t				         m_wszFileName[2048];
 	MultiFileWriter*     m_pTimeShiftFile;
 	HANDLE							 m_hFile;
+	CNetworkSink*        m_pNetworkSink;
+	wchar_t              m_wszAddress[64];
+	int                  m_iPort;
+	bool                 m_bRtp;
 	CCriticalSection     m_section;
   int                  m_iPmtPid;
   int                  m_pcrPid;
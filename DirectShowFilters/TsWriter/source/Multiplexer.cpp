@@ -39,12 +39,17 @@ CMultiplexer::CMultiplexer()
 {
 	m_pCallback=NULL;
 	m_pcrPid=-1;
+	m_pOutput=new byte[MUX_OUTPUT_PACKS*PACK_SIZE];
+	m_iOutputPacks=0;
+	memset(m_pidTable,0,sizeof(m_pidTable));
   Reset();
 }
 
 CMultiplexer::~CMultiplexer()
 {
-  Reset();
+  // the writer may be gone already, whatever is left is dropped
+  ClearStreams();
+  delete[] m_pOutput;
 }
 
 void CMultiplexer::SetFileWriterCallBack(IFileWriter* callback)
@@ -54,9 +59,19 @@ void CMultiplexer::SetFileWriterCallBack(IFileWriter* callback)
 
 void CMultiplexer::Reset()
 {
+	Flush();
 	ClearStreams();
 }
 
+void CMultiplexer::Flush()
+{
+	if (m_iOutputPacks>0 && m_pCallback!=NULL)
+	{
+		m_pCallback->Write(m_pOutput,m_iOutputPacks*PACK_SIZE);
+	}
+	m_iOutputPacks=0;
+}
+
 void CMultiplexer::ClearStreams()
 {
 	ivecPesDecoders it;
@@ -66,6 +81,7 @@ void CMultiplexer::ClearStreams()
 		delete decoder;
 	}
 	m_pesDecoders.clear();
+	memset(m_pidTable,0,sizeof(m_pidTable));
 	m_pcrPid=-1;
 	m_adaptionField.Pcr.Reset();
 	m_bVideoStartFound=false;
@@ -93,7 +109,8 @@ void CMultiplexer::RemovePesStream(int pid)
 		CPesDecoder* decoder=*it;
 		if (decoder->GetPid()== pid) 
 		{
-			delete[] decoder;
+			m_pidTable[pid & 0x1fff]=NULL;
+			delete decoder;
 			m_pesDecoders.erase(it);
 			return;
 		}
@@ -104,12 +121,9 @@ void CMultiplexer::RemovePesStream(int pid)
 
 void CMultiplexer::AddPesStream(int pid, bool isAc3, bool isAudio, bool isVideo)
 {
+	if (pid < 0 || pid >= 0x2000) return;
+	if (m_pidTable[pid]!=NULL) return;
 	ivecPesDecoders it;
-	for (it=m_pesDecoders.begin(); it != m_pesDecoders.end();++it)
-	{
-		CPesDecoder* decoder=*it;
-		if (decoder->GetPid()== pid) return;
-	}
 	
 //	LogDebug("mux: add pes pid:%x", pid);
 	int audioStreamId=0xc0;
@@ -147,6 +161,7 @@ void CMultiplexer::AddPesStream(int pid, bool isAc3, bool isAudio, bool isVideo)
 		decoder->SetStreamId(-1);
 	}
 	m_pesDecoders.push_back(decoder);
+	m_pidTable[pid]=decoder;
 
 	//LogDebug("mux streams:%d", m_pesDecoders.size());
   m_system_header_size=get_system_header_size();
@@ -167,10 +182,9 @@ void CMultiplexer::OnTsPacket(byte* tsPacket)
 	if (m_pcr.PcrReferenceBase==0)
     return;
 
-	ivecPesDecoders it;
-	for (it=m_pesDecoders.begin(); it != m_pesDecoders.end();++it)
+	CPesDecoder* decoder=m_pidTable[m_header.Pid];
+	if (decoder!=NULL)
 	{
-		CPesDecoder* decoder=*it;
 		decoder->OnTsPacket(tsPacket,m_pcr);
 	}
 }
@@ -475,7 +489,8 @@ void CMultiplexer::flush_packet(CPesPacket& packet, int streamId)
   byte *buf_ptr;
   int size;
   int packet_size;
-  byte buffer[PACK_SIZE];
+  // the pack is built in place in the output buffer
+  byte* buffer=&m_pOutput[m_iOutputPacks*PACK_SIZE];
   int zero_trail_bytes = 0;
   int pad_packet_bytes = 0;
   buf_ptr = buffer;
@@ -560,7 +575,11 @@ void CMultiplexer::flush_packet(CPesPacket& packet, int streamId)
   if (m_pCallback!=NULL)
   {
 		PatchPtsDts(ptrPesStart,m_pcrStart);
-    m_pCallback->Write(buffer,PACK_SIZE);
+    m_iOutputPacks++;
+    if (m_iOutputPacks==MUX_OUTPUT_PACKS)
+    {
+      Flush();
+    }
   }
 	m_bFirstPacket=false;
 
@@ -30,6 +30,8 @@
 
 using namespace std;
 
+#define MUX_OUTPUT_PACKS                64    // packs handed to the writer at once
+
 class IFileWriter
 {
 public:
@@ -50,6 +52,8 @@ public:
 	void Reset();
 	void ClearStreams();
 	void SetFileWriterCallBack(IFileWriter* callback);
+	// hands the packs collected so far to the writer
+	void Flush();
 	int OnNewPesPacket(CPesDecoder* decoder);
 
 private:
@@ -64,11 +68,14 @@ private:
 	void PatchPtsDts(byte* pesPacket,CPcr& startPcr);
 	vector<CPesDecoder*> m_pesDecoders;
 	typedef vector<CPesDecoder*>::iterator ivecPesDecoders;
+	CPesDecoder* m_pidTable[0x2000];    // decoder of each pid, NULL if none
   
   vector<CPesPacket*> m_packets;
 	typedef vector<CPesPacket*>::iterator ivecPackets;
 
 	IFileWriter* m_pCallback;
+	byte*        m_pOutput;             // MUX_OUTPUT_PACKS packs
+	int          m_iOutputPacks;
 	CAdaptionField m_adaptionField;
 	CTsHeader m_header;
   int m_system_header_size;
@@ -39,6 +39,8 @@ CNITDecoder::~CNITDecoder(void)
 
 void CNITDecoder::OnNewSection(CSection& sections)
 {
+	if (sections.table_id==0x40 || sections.table_id==0x41)
+		m_tracker.OnSection(sections);
 	if (sections.table_id!=0x40) return;
 
 	byte* section=sections.Data;
@@ -47,32 +49,51 @@ void CNITDecoder::OnNewSection(CSection& sections)
 
 bool CNITDecoder::Ready()
 {
+	if (IsComplete()) return true;
+	// fallback for muxes without a NIT
 	DWORD timeSpan=GetTickCount()-m_timer;
 	if (timeSpan >=5000) return true;
 	return false;
 }
+
+//returns true once all sections of the actual NIT and of the other NITs seen so far are in
+bool CNITDecoder::IsComplete()
+{
+	return (m_tracker.HasTable(0x40) && m_tracker.IsComplete(0x40) && m_tracker.IsComplete(0x41));
+}
 void CNITDecoder::Reset()
 {
   LogDebug("NIT:Reset");
-//	m_vecLCN.clear();
+//	m_mapLCN.clear();
 	CSectionDecoder::Reset();
+	m_tracker.Reset();
 	m_timer=GetTickCount();
   m_nit.satteliteNIT.clear();
   m_nit.cableNIT.clear();
   m_nit.terrestialNIT.clear();
   m_nit.lcnNIT.clear();
+  m_satTransponders.clear();
+  m_cableFrequencies.clear();
+  m_terrestrialFrequencies.clear();
+}
+
+__int64 CNITDecoder::ServiceKey(int networkId, int transportId, int serviceId)
+{
+	return ((__int64)(networkId & 0xffff)<<32) | ((__int64)(transportId & 0xffff)<<16) | (serviceId & 0xffff);
+}
+
+// a satellite carries different transponders on one frequency in the other polarisation
+__int64 CNITDecoder::TransponderKey(int frequency, int polarisation)
+{
+	return ((__int64)frequency<<8) | (polarisation & 0xff);
 }
+
 int CNITDecoder::GetLogicialChannelNumber(int networkId, int transportId, int serviceId)
 {
-	for (int i=0; i < (int)m_vecLCN.size();++i)
+	imapLCN it=m_mapLCN.find(ServiceKey(networkId,transportId,serviceId));
+	if (it!=m_mapLCN.end())
 	{
-		NITLCN& lcn=m_vecLCN[i];
-		if (lcn.network_id==networkId &&
-			  lcn.transport_id==transportId &&
-				lcn.service_id==serviceId)
-		{
-			return lcn.LCN;
-		}
+		return it->second;
 	}
 	return 10000;
 }
@@ -231,7 +252,7 @@ void  CNITDecoder::decodeNITTable(byte* buf)
 		}
 		
 		//LogDebug("NIT: terrestial:%d satellite:%d cable:%d LCN:%d",
-		//	m_nit.terrestialNIT.size(),m_nit.satteliteNIT.size(),m_nit.cableNIT.size(),m_vecLCN.size());
+		//	m_nit.terrestialNIT.size(),m_nit.satteliteNIT.size(),m_nit.cableNIT.size(),m_mapLCN.size());
 	}
 	catch(...)
 	{
@@ -265,28 +286,13 @@ void CNITDecoder::DVB_GetLogicalChannelNumber(int original_network_id,int transp
 			else if (LCN>=1000) LCN=10000;//reserved
 
 			pointer+=4;
-			bool alreadyAdded=false;
-			for (int j=0; j < (int)m_vecLCN.size();++j)
-			{
-				NITLCN& lcn = m_vecLCN[j];
-				if (lcn.network_id==original_network_id && lcn.transport_id==transport_stream_id && lcn.service_id==ServiceID)
-				{
-					alreadyAdded=true;
-					break;
-				}
-			}
-			if (!alreadyAdded)
+			if (original_network_id>0 && transport_stream_id>0 &&ServiceID>0 && LCN>=0)
 			{
-				if (original_network_id>0 && transport_stream_id>0 &&ServiceID>0 && LCN>=0)
+				// the first lcn seen for a service is kept
+				if (m_mapLCN.insert(pair<__int64,int>(ServiceKey(original_network_id,transport_stream_id,ServiceID),LCN)).second)
 				{
-					NITLCN lcn;
-					lcn.LCN=LCN;
-					lcn.network_id=original_network_id;
-					lcn.transport_id=transport_stream_id;
-					lcn.service_id=ServiceID;
-					m_vecLCN.push_back(lcn);
 					m_timer=GetTickCount();
-					//LogDebug("LCN:%03.3d network id:0x%x transport id:0x%x service id:0x%x (%d)", LCN,original_network_id,transport_stream_id,ServiceID,m_vecLCN.size());
+					//LogDebug("LCN:%03.3d network id:0x%x transport id:0x%x service id:0x%x (%d)", LCN,original_network_id,transport_stream_id,ServiceID,m_mapLCN.size());
 				}
 			}
 		}
@@ -427,21 +433,14 @@ void CNITDecoder::DVB_GetSatDelivSys(byte* b,int maxLen)
         case 9: satteliteNIT.FECInner = BDA_BCC_RATE_9_10; break;
 			}
 			
-			bool alreadyAdded=false;
-			for (int i=0; i < m_nit.satteliteNIT.size();++i)
+			if (m_satTransponders.insert(TransponderKey(satteliteNIT.Frequency,satteliteNIT.Polarisation)).second)
 			{
-				NITSatDescriptor& nit=m_nit.satteliteNIT[i];
-				if (nit.Frequency==satteliteNIT.Frequency)
-				{
-          LogDebug("Sat nit: frequency:%d Symbolrate:%d Polarisation:%d FEC:%d S2:%d RollOff:%d", 
-            satteliteNIT.Frequency,satteliteNIT.Symbolrate,satteliteNIT.Polarisation, satteliteNIT.FECInner, satteliteNIT.isS2, satteliteNIT.RollOff);
-					alreadyAdded=true;
-					break;
-				}
+				m_nit.satteliteNIT.push_back(satteliteNIT);
 			}
-			if (!alreadyAdded)
+			else
 			{
-				m_nit.satteliteNIT.push_back(satteliteNIT);
+        LogDebug("Sat nit: frequency:%d Symbolrate:%d Polarisation:%d FEC:%d S2:%d RollOff:%d", 
+          satteliteNIT.Frequency,satteliteNIT.Symbolrate,satteliteNIT.Polarisation, satteliteNIT.FECInner, satteliteNIT.isS2, satteliteNIT.RollOff);
 			}
 		}	
 
@@ -568,17 +567,7 @@ void CNITDecoder::DVB_GetTerrestrialDelivSys(byte*b , int maxLen)
 			
 			terrestialNIT.OtherFrequencyFlag=(b[8] & 1);
 			// 0 - no other frequency in use
-			bool alreadyAdded=false;
-			for (int i=0; i < m_nit.terrestialNIT.size();++i)
-			{
-				NITTerrestrialDescriptor& nit=m_nit.terrestialNIT[i];
-				if (nit.CentreFrequency==terrestialNIT.CentreFrequency)
-				{
-					alreadyAdded=true;
-					break;
-				}
-			}
-			if (!alreadyAdded)
+			if (m_terrestrialFrequencies.insert(terrestialNIT.CentreFrequency).second)
 			{
 				LogDebug("NIT: terrestial frequency=%d bandwidth=%d other freqs:%d", terrestialNIT.CentreFrequency,terrestialNIT.Bandwidth,terrestialNIT.OtherFrequencyFlag);
 				m_nit.terrestialNIT.push_back(terrestialNIT);
@@ -688,17 +677,7 @@ void CNITDecoder::DVB_GetCableDelivSys(byte* b, int maxLen)
 				case 15:cableNIT.FECInner=BDA_BCC_RATE_NOT_DEFINED;break;
 				default:cableNIT.FECInner=BDA_BCC_RATE_NOT_SET;break;
 			}
-			bool alreadyAdded=false;
-			for (int i=0; i < m_nit.cableNIT.size();++i)
-			{
-				NITCableDescriptor& nit=m_nit.cableNIT[i];
-				if (nit.Frequency==cableNIT.Frequency)
-				{
-					alreadyAdded=true;
-					break;
-				}
-			}
-			if (!alreadyAdded)
+			if (m_cableFrequencies.insert(cableNIT.Frequency).second)
 			{
 				m_nit.cableNIT.push_back(cableNIT);
 				//LogDebug("NIT: network:%s", cableNIT.NetworkName);
@@ -21,7 +21,10 @@
 #pragma once
 #include "..\..\shared\sectiondecoder.h"
 #include "..\..\shared\section.h"
+#include "SectionTracker.h"
 #include <vector>
+#include <map>
+#include <set>
 using namespace std;
 
 #define PID_NIT 0x10
@@ -97,6 +100,7 @@ public:
 	void  OnNewSection(CSection& sections);
 	void  Reset();
 	bool  Ready();
+	bool  IsComplete();
 	int		GetLogicialChannelNumber(int networkId, int transportId, int serviceId);
 	DVBNetworkInfo m_nit;
 private:
@@ -105,15 +109,15 @@ private:
   void DVB_GetSatDelivSys(byte* b,int maxLen);
   void DVB_GetTerrestrialDelivSys(byte*b , int maxLen);
   void DVB_GetCableDelivSys(byte* b, int maxLen);
-	typedef  struct stNITLCN
-	{
-		int network_id;
-		int transport_id;
-		int service_id;
-		int LCN;
-	}NITLCN;
+	static __int64 ServiceKey(int networkId, int transportId, int serviceId);
+	static __int64 TransponderKey(int frequency, int polarisation);
 
-	vector<NITLCN> m_vecLCN;
-	typedef vector<NITLCN>::iterator ivecLCN;
+	map<__int64,int> m_mapLCN;	// key from ServiceKey()
+	typedef map<__int64,int>::iterator imapLCN;
+	// transponders already in m_nit, satellites by TransponderKey()
+	set<__int64> m_satTransponders;
+	set<int> m_cableFrequencies;
+	set<int> m_terrestrialFrequencies;
 	DWORD m_timer;
+	CSectionTracker m_tracker;
 };
@@ -0,0 +1,264 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <mmsystem.h>
+#include <stdlib.h>
+#include "NetworkSink.h"
+
+extern void LogDebug(const char *fmt, ...) ;
+
+#define NETWORK_SEND_DELAY        0.2     // s
+#define NETWORK_MAX_UNSCHEDULED   64      // datagrams without pcr before they are sent right away
+#define NETWORK_BATCH_SIZE        32      // datagrams sent per wake up at most
+#define NETWORK_MULTICAST_TTL     4
+#define NETWORK_SEND_BUFFER       (1024*1024)
+#define RTP_PAYLOAD_TYPE_MP2T     33
+
+CNetworkSink::CNetworkSink(void)
+{
+  m_socket=INVALID_SOCKET;
+  m_bOpen=false;
+  m_bRtp=false;
+  m_queue=new Datagram[NETWORK_QUEUE_SIZE];
+  m_iWritten=0;
+  m_iScheduled=0;
+  m_iSent=0;
+  m_iLastPcr=-1;
+  m_iFillPackets=0;
+  m_iDroppedPackets=0;
+}
+
+CNetworkSink::~CNetworkSink(void)
+{
+  Close();
+  delete[] m_queue;
+}
+
+bool CNetworkSink::Open(const wchar_t* address, int port, bool rtp)
+{
+  Close();
+
+  char szAddress[64];
+  if (wcstombs(szAddress, address, sizeof(szAddress))==(size_t)-1) return false;
+  szAddress[sizeof(szAddress)-1]=0;
+  m_address=inet_addr(szAddress);
+  if (m_address==INADDR_NONE)
+  {
+    LogDebug("NetworkSink: invalid address %s", szAddress);
+    return false;
+  }
+  m_port=htons((unsigned short)port);
+  m_bRtp=rtp;
+
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData)!=0) return false;
+  SOCKET s=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (s==INVALID_SOCKET)
+  {
+    LogDebug("NetworkSink: socket failed %d", WSAGetLastError());
+    WSACleanup();
+    return false;
+  }
+  int sendBuffer=NETWORK_SEND_BUFFER;
+  setsockopt(s, SOL_SOCKET, SO_SNDBUF, (char*)&sendBuffer, sizeof(sendBuffer));
+  if (IN_MULTICAST(ntohl(m_address)))
+  {
+    int ttl=NETWORK_MULTICAST_TTL;
+    setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, (char*)&ttl, sizeof(ttl));
+  }
+  m_socket=s;
+
+  {
+    CEnterCriticalSection enter(m_section);
+    m_clock.Reset();
+    m_ssrc=GetTickCount() ^ (DWORD)(UINT_PTR)this;
+    m_iWritten=0;
+    m_iScheduled=0;
+    m_iSent=0;
+    m_iLastPcr=-1;
+    m_iFillPackets=0;
+    m_iDroppedPackets=0;
+    m_bOpen=true;
+  }
+  LogDebug("NetworkSink: sending %s to %s:%d", (rtp ? "rtp" : "udp"), szAddress, port);
+  StartThread();
+  return true;
+}
+
+void CNetworkSink::Close()
+{
+  {
+    CEnterCriticalSection enter(m_section);
+    if (!m_bOpen) return;
+    m_bOpen=false;
+  }
+  StopThread(INFINITE);
+  closesocket((SOCKET)m_socket);
+  m_socket=INVALID_SOCKET;
+  WSACleanup();
+  LogDebug("NetworkSink: closed, %d datagrams sent, %d packets dropped", (int)m_iSent, m_iDroppedPackets);
+}
+
+void CNetworkSink::GetCounters(int* datagramsSent, int* datagramsDropped)
+{
+  CEnterCriticalSection enter(m_section);
+  *datagramsSent=(int)m_iSent;
+  *datagramsDropped=m_iDroppedPackets/NETWORK_PACKETS_PER_DATAGRAM;
+}
+
+void CNetworkSink::Write(byte* tsPacket)
+{
+  CEnterCriticalSection enter(m_section);
+  if (!m_bOpen) return;
+  if (m_iWritten-m_iSent >= NETWORK_QUEUE_SIZE)
+  {
+    // the sender can't keep up
+    m_iDroppedPackets++;
+    return;
+  }
+
+  Datagram& datagram=m_queue[m_iWritten % NETWORK_QUEUE_SIZE];
+  int headerSize=(m_bRtp ? NETWORK_RTP_HEADER_SIZE : 0);
+  memcpy(&datagram.data[headerSize+m_iFillPackets*188], tsPacket, 188);
+  m_iFillPackets++;
+
+  // adaption field with pcr
+  if ((tsPacket[3] & 0x20) && tsPacket[4] >= 7 && (tsPacket[5] & 0x10)) OnPcr(tsPacket);
+
+  if (m_iFillPackets==NETWORK_PACKETS_PER_DATAGRAM)
+  {
+    datagram.packets=m_iFillPackets;
+    m_iFillPackets=0;
+    m_iWritten++;
+    if (m_iWritten-m_iScheduled > NETWORK_MAX_UNSCHEDULED)
+    {
+      // no pcrs to pace by
+      double now=m_clock.SystemTime();
+      for (__int64 i=m_iScheduled; i < m_iWritten;++i)
+      {
+        m_queue[i % NETWORK_QUEUE_SIZE].due=now;
+      }
+      m_iScheduled=m_iWritten;
+    }
+  }
+}
+
+void CNetworkSink::OnPcr(byte* tsPacket)
+{
+  __int64 current=m_iWritten;
+  if (current==m_iLastPcr) return;
+
+  CPcr pcr;
+  pcr.Decode(&tsPacket[6]);
+  m_clock.OnPcr(pcr, (tsPacket[5] & 0x80)!=0);
+  double due=m_clock.StreamToSystem(m_clock.LastStreamTime())+NETWORK_SEND_DELAY;
+
+  if (m_iLastPcr < 0)
+  {
+    double now=m_clock.SystemTime();
+    for (__int64 i=m_iScheduled; i < current;++i)
+    {
+      m_queue[i % NETWORK_QUEUE_SIZE].due=now;
+    }
+  }
+  else
+  {
+    // spread the datagrams since the last pcr, after a jump send them right away
+    double from=m_lastPcrDue;
+    if (due < from || due-from > 1.0) from=due;
+    for (__int64 i=max(m_iScheduled, m_iLastPcr+1); i < current;++i)
+    {
+      m_queue[i % NETWORK_QUEUE_SIZE].due=from + (due-from)*(i-m_iLastPcr)/(current-m_iLastPcr);
+    }
+  }
+  m_queue[current % NETWORK_QUEUE_SIZE].due=due;
+  m_iScheduled=current+1;
+  m_iLastPcr=current;
+  m_lastPcrDue=due;
+}
+
+void CNetworkSink::ThreadProc()
+{
+  timeBeginPeriod(1);
+  DWORD wait=1;
+  while (!ThreadIsStopping(wait))
+  {
+    __int64 first;
+    int count=0;
+    wait=10;
+    {
+      CEnterCriticalSection enter(m_section);
+      double now=m_clock.SystemTime();
+      first=m_iSent;
+      __int64 ready=min(m_iWritten, m_iScheduled);
+      while (first+count < ready && count < NETWORK_BATCH_SIZE)
+      {
+        double due=m_queue[(first+count) % NETWORK_QUEUE_SIZE].due;
+        if (due > now)
+        {
+          wait=(DWORD)((due-now)*1000)+1;
+          break;
+        }
+        count++;
+      }
+      if (count==NETWORK_BATCH_SIZE) wait=0;
+    }
+
+    // the writer doesn't touch datagrams between m_iSent and m_iWritten
+    sockaddr_in destination;
+    memset(&destination, 0, sizeof(destination));
+    destination.sin_family=AF_INET;
+    destination.sin_addr.s_addr=m_address;
+    destination.sin_port=m_port;
+    for (int i=0; i < count;++i)
+    {
+      Datagram& datagram=m_queue[(first+i) % NETWORK_QUEUE_SIZE];
+      int length=datagram.packets*188;
+      if (m_bRtp)
+      {
+        WORD sequence=(WORD)(first+i);
+        DWORD timestamp=(DWORD)(__int64)(datagram.due*90000.0);
+        datagram.data[0]=0x80;
+        datagram.data[1]=RTP_PAYLOAD_TYPE_MP2T;
+        datagram.data[2]=(byte)(sequence>>8);
+        datagram.data[3]=(byte)sequence;
+        datagram.data[4]=(byte)(timestamp>>24);
+        datagram.data[5]=(byte)(timestamp>>16);
+        datagram.data[6]=(byte)(timestamp>>8);
+        datagram.data[7]=(byte)timestamp;
+        datagram.data[8]=(byte)(m_ssrc>>24);
+        datagram.data[9]=(byte)(m_ssrc>>16);
+        datagram.data[10]=(byte)(m_ssrc>>8);
+        datagram.data[11]=(byte)m_ssrc;
+        length+=NETWORK_RTP_HEADER_SIZE;
+      }
+      sendto((SOCKET)m_socket, (char*)datagram.data, length, 0, (sockaddr*)&destination, sizeof(destination));
+    }
+    if (count > 0)
+    {
+      CEnterCriticalSection enter(m_section);
+      m_iSent+=count;
+    }
+  }
+  timeEndPeriod(1);
+}
@@ -0,0 +1,80 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+#include "..\..\shared\TSThread.h"
+#include "PcrRefClock.h"
+#include "criticalsection.h"
+#include "entercriticalsection.h"
+
+using namespace Mediaportal;
+
+#define NETWORK_PACKETS_PER_DATAGRAM  7
+#define NETWORK_RTP_HEADER_SIZE       12
+#define NETWORK_QUEUE_SIZE            2048    // datagrams, about 3 s at 8 Mbit/s
+
+// Sends the packets of a channel as udp datagrams of 7 ts packets, optionally with
+// an rtp header (RFC 2250), to a unicast or multicast address. The datagrams are
+// queued and a thread sends them at the pace of the pcrs they carry: the pcr clock
+// is recovered with a CPcrRefClock, the datagrams between two pcrs are spread
+// evenly and everything is sent NETWORK_SEND_DELAY after it arrived, which
+// smooths the bursts the tuner delivers.
+class CNetworkSink : public TSThread
+{
+public:
+  CNetworkSink(void);
+  virtual ~CNetworkSink(void);
+
+  bool  Open(const wchar_t* address, int port, bool rtp);
+  void  Close();
+  void  Write(byte* tsPacket);
+  void  GetCounters(int* datagramsSent, int* datagramsDropped);
+
+  void  ThreadProc();
+
+private:
+  typedef struct stDatagram
+  {
+    int     packets;
+    double  due;                // system time it is sent at
+    byte    data[NETWORK_RTP_HEADER_SIZE+NETWORK_PACKETS_PER_DATAGRAM*188];
+  }Datagram;
+
+  void  OnPcr(byte* tsPacket);
+
+  CCriticalSection m_section;
+  CPcrRefClock  m_clock;
+  UINT_PTR      m_socket;
+  unsigned long m_address;      // network byte order
+  unsigned short m_port;
+  bool          m_bRtp;
+  bool          m_bOpen;
+  DWORD         m_ssrc;
+
+  // positions in the queue count datagrams since Open(), the slot is position % NETWORK_QUEUE_SIZE
+  Datagram*     m_queue;
+  __int64       m_iWritten;     // complete datagrams
+  __int64       m_iScheduled;   // datagrams with a due time
+  __int64       m_iSent;
+  __int64       m_iLastPcr;     // datagram of the last pcr, -1 if none yet
+  double        m_lastPcrDue;
+  int           m_iFillPackets;   // in the datagram being filled
+  int           m_iDroppedPackets;
+};
@@ -59,6 +59,8 @@ void  CPatParser::CleanUp()
 	}
 	m_pmtParsers.clear();
   m_mapChannels.clear();
+  m_vecChannelIndex.clear();
+  m_bChannelIndexValid=false;
   m_bDumped=false;
 }
 
@@ -81,7 +83,10 @@ void  CPatParser::Reset(IChannelScanCallback* callback, bool waitForVCT)
 	
 	m_pCallback=callback;
 
+  m_patTracker.Reset();
+
   m_tickCount = GetTickCount();
+  m_startTick = m_tickCount;
 	m_finished=false;
 	LogDebug("PatParser::Reset done");
 }
@@ -89,17 +94,31 @@ void  CPatParser::Reset(IChannelScanCallback* callback, bool waitForVCT)
 //*****************************************************************************
 BOOL CPatParser::IsReady()
 {
-	if (m_nitDecoder.Ready()==false) 
+	// a table is done once every section it announces arrived at its current version,
+	// the timeouts only matter for muxes that don't carry it
+	bool timedOut=(GetTickCount()-m_startTick >= SCAN_FALLBACK_TIMEOUT);
+	if (!timedOut && (!m_patTracker.HasTable(0) || !m_patTracker.IsComplete(0)))
+	{
+		return FALSE;
+	}
+	if (m_waitForVCT)
+	{
+		if (!timedOut && !m_vctParser.IsComplete()) return FALSE;
+	}
+	else if (m_nitDecoder.Ready()==false) 
 	{
 		//LogDebug("nit not ready");
 		return FALSE;
 	}
+
+	// services missing from a complete SDT or VCT won't get a name anymore
+	bool namesComplete=m_sdtParser.IsComplete() || (m_waitForVCT && m_vctParser.IsComplete());
   
 	int x=0;
 	for (itChannels it=m_mapChannels.begin(); it !=m_mapChannels.end();++it)
   {
 		CChannelInfo& info=it->second;
-		if (!info.PmtReceived || !info.SdtReceived) 
+		if (!info.PmtReceived || (!info.SdtReceived && !namesComplete)) 
 		{
 			//LogDebug("ch:%d pmt:%d sdt:%d othermux:%d %s onid:%x tsid:%x sid:%x",
 			//	x,info.PmtReceived,info.SdtReceived,info.OtherMux,info.ServiceName,
@@ -122,37 +141,44 @@ int CPatParser::Count()
 bool CPatParser::GetChannel(int index, CChannelInfo& info)
 {
 	static CChannelInfo unknownChannel;
-  if (index < 0 || index > Count()) 
+  if (index < 0 || index >= Count()) 
 	{
 	  LogDebug("GetChannel:%d invalid", index);
 		return false;
 	}
-  if (index==0) Dump();
-
-  itChannels it=m_mapChannels.begin();
-  while (index) 
+  if (index==0) 
   {
-    it++;
-    index--;
+    Dump();
+    // the network ids come in with the sdt, pick them up again for every pass over the channels
+    m_bChannelIndexValid=false;
   }
-  info = it->second;
+  if (!m_bChannelIndexValid) BuildChannelIndex();
+
+  info = m_vecChannelIndex[index]->second;
 	info.LCN=m_nitDecoder.GetLogicialChannelNumber(info.NetworkId,info.TransportId,info.ServiceId);
 
   if (info.NetworkId==0)
   {
-      for (itChannels it2=m_mapChannels.begin();it2!=m_mapChannels.end();++it2)
-      {
-        if ( (it2->second).NetworkId!=0)
-        {
-          info.NetworkId=(it2->second).NetworkId;
-          break;
-        }
-    }
+    info.NetworkId=m_defaultNetworkId;
   }
 
 	return true;
 }
 
+//*****************************************************************************
+void CPatParser::BuildChannelIndex()
+{
+  m_vecChannelIndex.clear();
+  m_vecChannelIndex.reserve(m_mapChannels.size());
+  m_defaultNetworkId=0;
+  for (itChannels it=m_mapChannels.begin();it!=m_mapChannels.end();++it)
+  {
+    m_vecChannelIndex.push_back(it);
+    if (m_defaultNetworkId==0) m_defaultNetworkId=(it->second).NetworkId;
+  }
+  m_bChannelIndexValid=true;
+}
+
 
 //*****************************************************************************
 void CPatParser::OnChannel(const CChannelInfo& info)
@@ -257,11 +283,11 @@ bool CPatParser::PmtParserExists(int pid,int serviceId)
 }
 
 //*****************************************************************************
-void CPatParser::OnTsPacket(byte* tsPacket)
+void CPatParser::OnTsPacket(const TsPacketView& packet)
 {
 	CEnterCriticalSection enter(m_section);
 	//if (m_finished) return;
-  int pid=((tsPacket[1] & 0x1F) <<8)+tsPacket[2];
+  int pid=packet.Pid;
 
 	if (m_pCallback!=NULL)
 	{
@@ -275,30 +301,30 @@ void CPatParser::OnTsPacket(byte* tsPacket)
 	}	
   if (pid==PID_NIT) 
   {
-    m_nitDecoder.OnTsPacket(tsPacket);
+    m_nitDecoder.OnTsPacket(packet);
     return;
   }
   if (pid==PID_VCT) 
   {
-    m_vctParser.OnTsPacket(tsPacket);
+    m_vctParser.OnTsPacket(packet);
     return;
   }
 	
 	if (pid==PID_SDT)
   {
-    m_sdtParser.OnTsPacket(tsPacket);
+    m_sdtParser.OnTsPacket(packet);
     return;
   }
   if (pid==PID_PAT)
   {
-		CSectionDecoder::OnTsPacket(tsPacket);
+		CSectionDecoder::OnTsPacket(packet);
     return;
   }
 	itPmtParser it=m_pmtParsers.begin();
 	while (it!=m_pmtParsers.end())
 	{
 		CPmtParser *parser=*it;
-		parser->OnTsPacket(tsPacket);
+		parser->OnTsPacket(packet);
 		++it;
 	}
 }
@@ -308,11 +334,13 @@ void CPatParser::OnNewSection(CSection& sections)
 {
 	CEnterCriticalSection enter(m_section);
 	if (sections.table_id!=0) return;
+	m_patTracker.OnSection(sections);
 
   byte* section=sections.Data;
 	int section_length=sections.section_length;
 
   int pmtcount=0;
+  bool newService=false;
   int loop =(section_length - 9) / 4;
   for(int i=0; i < loop; i++)
   {
@@ -328,7 +356,7 @@ void CPatParser::OnNewSection(CSection& sections)
 	  {
       //invalid pmt pid
 			LogDebug("invalid sid:%x pmt:%x", serviceId,pmtPid);
-		  return ;
+		  break;
 	  }
 
 	  //some ATSC channels have transport_stream_id==0
@@ -345,6 +373,8 @@ void CPatParser::OnNewSection(CSection& sections)
 				info.PmtReceived=false;
 				info.SdtReceived=false;
 				m_mapChannels[serviceId]=info;
+				m_bChannelIndexValid=false;
+				newService=true;
 			//	LogDebug("pat: tsid:%x sid:%x pmt:%x", transport_stream_id,serviceId,pmtPid);
 			}
 			if (!PmtParserExists(pmtPid,serviceId))
@@ -358,6 +388,13 @@ void CPatParser::OnNewSection(CSection& sections)
 			m_tickCount = GetTickCount();
     }
   }
+
+  if (newService)
+  {
+    // the sdt/vct sections seen before didn't name this service, only count them from now on
+    m_sdtParser.Reset();
+    m_vctParser.Reset();
+  }
 }
 
 //*****************************************************************************
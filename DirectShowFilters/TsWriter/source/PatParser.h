@@ -26,6 +26,7 @@
 #include "NitDecoder.h"
 #include "..\..\shared\channelinfo.h"
 #include "VirtualChannelTableParser.h"
+#include "SectionTracker.h"
 #include "..\..\shared\tsheader.h"
 #include "criticalsection.h"
 #include "entercriticalsection.h"
@@ -42,13 +43,16 @@ DECLARE_INTERFACE_(IChannelScanCallback, IUnknown)
 
 #define PID_PAT 0x0
 
+// a scan gives up on the PAT or VCT after this time, the NIT decoder has its own
+#define SCAN_FALLBACK_TIMEOUT 5000
+
 class CPatParser : public CSectionDecoder, public ISdtCallBack, public IAtscCallback, public IPmtCallBack2
 {
 public:
   CPatParser(void);
   virtual ~CPatParser(void);
 
-	void	OnTsPacket(byte* tsPacket);
+	void	OnTsPacket(const TsPacketView& packet);
   void  Reset(IChannelScanCallback* callback,bool waitForVCT);
 	void  OnNewSection(CSection& section);
   int PATRequest(CSection& sections, int SID);
@@ -75,9 +79,16 @@ private:
 
   map<int,CChannelInfo> m_mapChannels;
   typedef map<int,CChannelInfo> ::iterator itChannels;
+  // m_mapChannels in GetChannel() order, rebuilt when channels were added
+  vector<itChannels> m_vecChannelIndex;
+  bool m_bChannelIndexValid;
+  int  m_defaultNetworkId;
+  void BuildChannelIndex();
   bool m_bDumped;
 	IChannelScanCallback* m_pCallback;
   DWORD                 m_tickCount;
+  DWORD                 m_startTick;
+  CSectionTracker       m_patTracker;
   CTsHeader             m_tsHeader;
 	bool									m_finished;
 	bool									m_waitForVCT;
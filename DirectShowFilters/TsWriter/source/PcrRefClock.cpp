@@ -20,31 +20,195 @@
  */
 
 #include "PcrRefClock.h"
+#include <math.h>
 
 extern void LogDebug(const char *fmt, ...) ;
 
-CPcrRefClock::CPcrRefClock()
+#define PCR_WRAP             ((double)0x200000000LL/90000.0)   // seconds
+#define PLL_DISCONTINUITY    1.0      // s, larger errors are a jump of the stream clock
+#define PLL_OUTLIER_MIN      0.005    // s
+#define PLL_OUTLIER_FACTOR   4        // times the average error
+#define PLL_OUTLIER_RELOCK   8        // consecutive outliers are a jump as well
+#define PLL_LOCK_SAMPLES     50
+#define PLL_START_BANDWIDTH  0.5      // rad/s, narrowed down to PLL_MIN_BANDWIDTH while locked
+#define PLL_MIN_BANDWIDTH    0.02
+#define PLL_MAX_OFFSET       0.0005   // 500 ppm
+
+LONGLONG CRefClockSource::Frequency()
 {
+	LONGLONG frequency;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
+	return frequency;
+}
+
+LONGLONG CRefClockSource::Ticks()
+{
+	LONGLONG ticks;
+	QueryPerformanceCounter((LARGE_INTEGER*)&ticks);
+	return ticks;
+}
+
+CPcrRefClock::CPcrRefClock(CRefClockSource* clockSource)
+{
+	source=(clockSource!=NULL ? clockSource : &defaultSource);
+	frequency=source->Frequency();
 	LogDebug("CPcrRefClock::ctor: clock frequency is %d",frequency);
 	LONGLONG dummy1,dummy2;
-	QueryPerformanceCounter((LARGE_INTEGER*)&dummy1);
-	QueryPerformanceCounter((LARGE_INTEGER*)&dummy2);
+	dummy1=source->Ticks();
+	dummy2=source->Ticks();
 	compensation=(ULONGLONG)dummy2-(ULONGLONG)dummy1;
 	startTicks=((ULONGLONG)dummy2)-compensation;
 	LogDebug("CPcrRefClock: compensation is %d",compensation);
+	Reset();
 }
 
 CPcrRefClock::~CPcrRefClock()
 {
 }
 
+void CPcrRefClock::Reset()
+{
+	hasPcr=false;
+	rate=1.0;
+	refSystem=0;
+	refStream=0;
+	averageError=0;
+	lastError=0;
+	samples=0;
+	consecutiveOutliers=0;
+	outliers=0;
+	discontinuities=0;
+}
+
+double CPcrRefClock::SystemTime()
+{
+	ULONGLONG newTicks=((ULONGLONG)source->Ticks())-startTicks-compensation;
+	return ((double)newTicks)/((double)frequency);
+}
+
 CPcr CPcrRefClock::GetAsPCR()
 {
 	CPcr pcr;
-	LONGLONG ts;
-	QueryPerformanceCounter((LARGE_INTEGER*)&ts);
-	ULONGLONG newTicks=((ULONGLONG)ts)-startTicks-compensation;
-	pcr.FromClock(((double)newTicks)/((double)frequency));
+	double now=SystemTime();
+	if (!hasPcr)
+	{
+		pcr.FromClock(now);
+		return pcr;
+	}
+	double stream=fmod(SystemToStream(now), PCR_WRAP);
+	if (stream < 0) stream+=PCR_WRAP;
+	pcr.FromClock(stream);
 	return pcr;
 }
+
+double CPcrRefClock::SystemToStream(double systemTime)
+{
+	return refStream + (systemTime-refSystem)*rate;
+}
+
+double CPcrRefClock::StreamToSystem(double streamTime)
+{
+	return refSystem + (streamTime-refStream)/rate;
+}
+
+double CPcrRefClock::LastStreamTime()
+{
+	return lastStream;
+}
+
+bool CPcrRefClock::IsLocked()
+{
+	return hasPcr && samples >= PLL_LOCK_SAMPLES;
+}
+
+double CPcrRefClock::FrequencyOffsetPpm()
+{
+	return (rate-1.0)*1000000.0;
+}
+
+double CPcrRefClock::PhaseError()
+{
+	return lastError;
+}
+
+int CPcrRefClock::Outliers()
+{
+	return outliers;
+}
+
+int CPcrRefClock::Discontinuities()
+{
+	return discontinuities;
+}
+
+void CPcrRefClock::Relock(double now, double stream)
+{
+	// the frequency offset of the broadcaster doesn't change with a jump, so the
+	// loop keeps its bandwidth and only the phase is taken over
+	refSystem=now;
+	refStream=stream;
+	averageError=0;
+	lastError=0;
+	samples=0;
+	consecutiveOutliers=0;
+}
+
+void CPcrRefClock::OnPcr(const CPcr& pcr, bool discontinuity)
+{
+	double now=SystemTime();
+	double received=pcr.ToClock();
+	if (!hasPcr)
+	{
+		hasPcr=true;
+		lastPcr=received;
+		lastStream=received;
+		lockStart=now;
+		Relock(now, received);
+		return;
+	}
+
+	double delta=received-lastPcr;
+	if (delta < -PCR_WRAP/2) delta+=PCR_WRAP;
+	else if (delta > PCR_WRAP/2) delta-=PCR_WRAP;
+	lastPcr=received;
+	lastStream+=delta;
+
+	double predicted=SystemToStream(now);
+	double error=lastStream-predicted;
+	if (discontinuity || fabs(error) > PLL_DISCONTINUITY)
+	{
+		discontinuities++;
+		LogDebug("CPcrRefClock: discontinuity, %.3f s off, relocking", error);
+		Relock(now, lastStream);
+		return;
+	}
+	if (samples >= PLL_LOCK_SAMPLES && fabs(error) > max(PLL_OUTLIER_FACTOR*averageError, PLL_OUTLIER_MIN))
+	{
+		outliers++;
+		if (++consecutiveOutliers >= PLL_OUTLIER_RELOCK)
+		{
+			discontinuities++;
+			LogDebug("CPcrRefClock: %d pcrs in a row %.3f s off, relocking", consecutiveOutliers, error);
+			Relock(now, lastStream);
+		}
+		return;
+	}
+	consecutiveOutliers=0;
+	samples++;
+	averageError+=(fabs(error)-averageError)/16;
+	lastError=error;
+
+	// second order loop, the bandwidth narrows the longer it stays locked
+	double bandwidth=max(PLL_START_BANDWIDTH/(1.0+(now-lockStart)/10.0), PLL_MIN_BANDWIDTH);
+	double dt=min(now-refSystem, 1.0);
+	// after a relock the phase comes from a single pcr, pull it in faster
+	double phaseBandwidth=(samples < PLL_LOCK_SAMPLES ? max(bandwidth, PLL_START_BANDWIDTH) : bandwidth);
+	double phaseGain=min(2*0.707*phaseBandwidth*dt, 1.0);
+	double frequencyGain=bandwidth*bandwidth*dt;
+
+	refStream=predicted+phaseGain*error;
+	refSystem=now;
+	rate+=frequencyGain*error;
+	if (rate > 1.0+PLL_MAX_OFFSET) rate=1.0+PLL_MAX_OFFSET;
+	if (rate < 1.0-PLL_MAX_OFFSET) rate=1.0-PLL_MAX_OFFSET;
+}
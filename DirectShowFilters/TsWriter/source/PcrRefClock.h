@@ -24,17 +24,68 @@
 #include "Windows.h"
 #include "..\..\shared\Pcr.h"
 
+// System time the clock is measured against. The default reads the performance
+// counter, a replacement can replay recorded pcr arrival times.
+class CRefClockSource
+{
+public:
+	virtual ~CRefClockSource() {}
+	virtual LONGLONG Frequency();
+	virtual LONGLONG Ticks();
+};
+
+// Recovers the broadcaster's clock from the pcrs of a service with a software pll.
+// The pll tracks the phase and the frequency offset of the stream clock against the
+// system clock, pcrs which arrived too late or too early are rejected and a jump
+// (discontinuity flag, splice, retune) relocks the phase but keeps the frequency.
+// Stream times are seconds of the unwrapped pcr, system times seconds since the
+// clock was created.
 class CPcrRefClock
 {
 private:
+	CRefClockSource* source;
+	CRefClockSource defaultSource;
 	LONGLONG frequency;
 	ULONGLONG startTicks;
 	// the time needed for the QueryPerformanceCounter itself
 	ULONGLONG compensation;
+
+	// stream time = refStream + (system time - refSystem) * rate
+	bool   hasPcr;
+	double refSystem;
+	double refStream;
+	double rate;
+	double lastPcr;           // last pcr as received, to unwrap the next one
+	double lastStream;
+	double lockStart;
+	double averageError;      // of the accepted pcrs
+	double lastError;
+	int    samples;
+	int    consecutiveOutliers;
+	int    outliers;
+	int    discontinuities;
+
+	void Relock(double now, double stream);
 public:
-	CPcrRefClock();
+	CPcrRefClock(CRefClockSource* clockSource=NULL);
 	~CPcrRefClock();
+	// without pcrs this is the system time since the clock was created
 	CPcr GetAsPCR();
+
+	void   Reset();
+	void   OnPcr(const CPcr& pcr, bool discontinuity);
+	double SystemTime();
+	double SystemToStream(double systemTime);
+	double StreamToSystem(double streamTime);
+	// stream time of the last pcr, unwrapped
+	double LastStreamTime();
+
+	bool   IsLocked();
+	double FrequencyOffsetPpm();
+	// seconds the last accepted pcr differed from the prediction
+	double PhaseError();
+	int    Outliers();
+	int    Discontinuities();
 };
 
 #endif
@@ -27,7 +27,6 @@ void LogDebug(const char *fmt, ...) ;
 
 CBuffer::CBuffer()
 {
-  m_pData = new byte[200];
   m_iReadPtr=0;
   m_iSize=0;
   m_bIsStart=false;
@@ -36,7 +35,6 @@ CBuffer::CBuffer()
 
 CBuffer::~CBuffer()
 {
-  delete[] m_pData;
 }
 
 void CBuffer::Reset()
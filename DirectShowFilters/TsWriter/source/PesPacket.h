@@ -38,7 +38,7 @@ class CBuffer
     CPcr& Dts();
 
   private:
-    BYTE* m_pData;
+    BYTE  m_pData[188];   // payload of one ts packet, kept inline so the buffers need no allocations
     int   m_iReadPtr;
     int   m_iSize;
     bool  m_bIsStart;
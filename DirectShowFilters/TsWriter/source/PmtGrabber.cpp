@@ -80,13 +80,12 @@ STDMETHODIMP CPmtGrabber::SetCallBack( IPMTCallback* callback)
 	return S_OK;
 }
 
-void CPmtGrabber::OnTsPacket(byte* tsPacket)
+void CPmtGrabber::OnTsPacket(const TsPacketView& packet)
 {
 	if (m_pCallback==NULL) return;
-  int pid=((tsPacket[1] & 0x1F) <<8)+tsPacket[2];
-  if (pid != GetPid()) return;
+  if (packet.Pid != GetPid()) return;
 	CEnterCriticalSection enter(m_section);
-  CSectionDecoder::OnTsPacket(tsPacket);
+  CSectionDecoder::OnTsPacket(packet);
 }
 
 void CPmtGrabber::OnNewSection(CSection& section)
@@ -56,7 +56,7 @@ public:
 	STDMETHODIMP SetCallBack( IPMTCallback* callback);
 	STDMETHODIMP GetPMTData(BYTE *pmtData);
 
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
   virtual void OnNewSection(CSection& section);
 private:
 	IPMTCallback* m_pCallback;
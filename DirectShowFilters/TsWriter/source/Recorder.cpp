@@ -165,6 +165,7 @@ STDMETHODIMP CRecorder::StopRecord()
 	CEnterCriticalSection enter(m_section);
   if (m_bRecording)
 	  LogDebug("Recorder:Stop Recording:'%s'",m_szFileName);
+	m_multiPlexer.Flush();
 	m_bRecording=false;
 	m_multiPlexer.Reset();
 	if (m_hFile!=INVALID_HANDLE_VALUE)
@@ -41,6 +41,13 @@ CSdtParser::~CSdtParser(void)
 void CSdtParser::Reset()
 {        
 	CSectionDecoder::Reset();
+	m_tracker.Reset();
+}
+
+//returns true once all sections of the actual SDT and of the other SDTs seen so far are in
+bool CSdtParser::IsComplete()
+{
+	return (m_tracker.HasTable(0x42) && m_tracker.IsComplete(0x42) && m_tracker.IsComplete(0x46));
 }
 
 void CSdtParser::SetCallback(ISdtCallBack* callback)
@@ -53,6 +60,7 @@ void  CSdtParser::OnNewSection(CSection& sections)
   byte* section=(&sections.Data)[0];
 	int sectionLen=sections.section_length;
 	if (sections.table_id!=0x42 && sections.table_id!=0x46) return;
+	m_tracker.OnSection(sections);
   
   long original_network_id = ((section[8])<<8)+section[9];
  // LogDebug("decodeSDTTable len=%d section no:%d last section no:%d cni:%d version:%d si:%d", 
@@ -23,6 +23,7 @@
 #include "..\..\shared\PidTable.h"
 #include "..\..\shared\ChannelInfo.h"
 #include "..\..\shared\tsheader.h"
+#include "SectionTracker.h"
 #include <vector>
 using namespace std;
 
@@ -43,8 +44,10 @@ public:
 	void  OnNewSection(CSection& sections);
   void  Reset();
   void SetCallback(ISdtCallBack* callback);
+  bool IsComplete();
 private:
   void DVB_GetService(BYTE *b,CChannelInfo& info);
   ISdtCallBack* m_pCallback;
   CTsHeader             m_tsHeader;
+  CSectionTracker       m_tracker;
 };
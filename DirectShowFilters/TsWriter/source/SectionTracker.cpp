@@ -0,0 +1,91 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#include <windows.h>
+#include <string.h>
+#include "SectionTracker.h"
+
+CSectionTracker::CSectionTracker(void)
+{
+}
+
+CSectionTracker::~CSectionTracker(void)
+{
+}
+
+void CSectionTracker::Reset()
+{
+  m_tables.clear();
+}
+
+bool CSectionTracker::OnSection(const CSection& section)
+{
+  // tables without the long header have no section numbers
+  if (section.section_syntax_indicator==0) return false;
+  // current_next_indicator, a table that isn't valid yet doesn't count
+  if ((section.Data[5] & 1)==0) return false;
+
+  int lastSectionNumber=section.Data[7];
+  int sectionNumber=section.section_number;
+  if (sectionNumber > lastSectionNumber) return false;
+
+  int key=(section.table_id<<16) | (section.table_id_extension & 0xffff);
+  itTables it=m_tables.find(key);
+  if (it==m_tables.end())
+  {
+    TableState state;
+    state.version=-1;
+    it=m_tables.insert(pair<int,TableState>(key,state)).first;
+  }
+
+  TableState& state=it->second;
+  if (state.version!=section.version_number || state.lastSectionNumber!=lastSectionNumber)
+  {
+    // new table or new version, start over
+    state.version=section.version_number;
+    state.lastSectionNumber=lastSectionNumber;
+    state.sectionCount=0;
+    memset(state.received,0,sizeof(state.received));
+  }
+
+  unsigned int mask=1U << (sectionNumber & 31);
+  if (state.received[sectionNumber>>5] & mask) return false;
+  state.received[sectionNumber>>5] |= mask;
+  state.sectionCount++;
+  return true;
+}
+
+bool CSectionTracker::HasTable(int tableId)
+{
+  itTables it=m_tables.lower_bound(tableId<<16);
+  return (it!=m_tables.end() && (it->first>>16)==tableId);
+}
+
+bool CSectionTracker::IsComplete(int tableId)
+{
+  itTables it=m_tables.lower_bound(tableId<<16);
+  while (it!=m_tables.end() && (it->first>>16)==tableId)
+  {
+    TableState& state=it->second;
+    if (state.sectionCount < state.lastSectionNumber+1) return false;
+    ++it;
+  }
+  return true;
+}
@@ -0,0 +1,54 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+#include "..\..\shared\section.h"
+#include <map>
+using namespace std;
+
+// Remembers which sections of each table (table_id, table_id_extension) arrived at
+// the table's current version, so a scan can stop as soon as every section a table
+// announces through its last_section_number is in, instead of waiting for a timeout.
+class CSectionTracker
+{
+public:
+  CSectionTracker(void);
+  virtual ~CSectionTracker(void);
+
+  void  Reset();
+  // returns true if the section wasn't seen before at this version
+  bool  OnSection(const CSection& section);
+  // true if any table with this table_id was seen
+  bool  HasTable(int tableId);
+  // true if every table with this table_id seen so far is complete, also when none was seen
+  bool  IsComplete(int tableId);
+
+private:
+  typedef struct stTableState
+  {
+    int version;
+    int lastSectionNumber;
+    int sectionCount;           // distinct sections seen at this version
+    unsigned int received[8];   // one bit per section_number
+  }TableState;
+
+  map<int,TableState> m_tables; // key is table_id<<16 | table_id_extension
+  typedef map<int,TableState>::iterator itTables;
+};
@@ -0,0 +1,243 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#include <windows.h>
+#include <string.h>
+#include <math.h>
+#include "StreamHealthMonitor.h"
+
+#define NULL_PID              0x1FFF
+#define CC_VALID              0x10    // a counter was seen
+#define CC_DUPLICATE          0x20    // the last packet repeated its predecessor
+#define PCR_TICKS_PER_MS      27000
+#define PCR_WRAP              (0x200000000LL*300)
+#define PCR_REPETITION_MAX    40      // ms
+#define PCR_JUMP_MAX          100     // ms
+#define TABLE_REPETITION_MAX  500     // ms
+
+CStreamHealthMonitor::CStreamHealthMonitor(void)
+{
+  m_pids=new PidState[HEALTH_MAX_PIDS];
+  m_seenPids=new int[HEALTH_MAX_PIDS];
+  Reset();
+}
+
+CStreamHealthMonitor::~CStreamHealthMonitor(void)
+{
+  delete[] m_pids;
+  delete[] m_seenPids;
+}
+
+void CStreamHealthMonitor::Reset()
+{
+  memset(m_pids, 0, HEALTH_MAX_PIDS*sizeof(PidState));
+  m_iSeenCount=0;
+  m_iPackets=0;
+  m_windowTick=GetTickCount();
+  m_iWindow=0;
+  m_iWindowCount=0;
+}
+
+void CStreamHealthMonitor::GetPids(int* pids, int maxCount, int* count)
+{
+  for (int i=0; i < m_iSeenCount && i < maxCount;++i)
+  {
+    pids[i]=m_seenPids[i];
+  }
+  *count=m_iSeenCount;
+}
+
+bool CStreamHealthMonitor::GetHealth(int pid, PidHealth* health)
+{
+  if (pid < 0 || pid >= HEALTH_MAX_PIDS || !m_pids[pid].seen) return false;
+  *health=m_pids[pid].health;
+  return true;
+}
+
+void CStreamHealthMonitor::OnTsPacket(const TsPacketView& packet)
+{
+  PidState& state=m_pids[packet.Pid];
+  if (!state.seen)
+  {
+    state.seen=true;
+    m_seenPids[m_iSeenCount++]=packet.Pid;
+  }
+  state.health.packets++;
+  m_iPackets++;
+  if ((m_iPackets & 1023)==0)
+  {
+    DWORD now=GetTickCount();
+    if (now-m_windowTick >= 1000) RollWindow(now);
+  }
+
+  if (packet.TransportError)
+  {
+    // its counter can't be trusted, the next packet starts the count again
+    state.health.transportErrors++;
+    state.continuity=0;
+    return;
+  }
+
+  state.health.scrambled=(packet.TScrambling ? 1 : 0);
+  state.health.scrambledPackets+=state.health.scrambled;
+
+  if (packet.Pid!=NULL_PID)
+  {
+    // the counter only advances with a payload, a packet may be sent twice. The
+    // whole state is one byte, so the usual packet stores it once
+    BYTE last=state.continuity;
+    BYTE expected=(last+(packet.HasPayload ? 1 : 0)) & 0xF;
+    BYTE continuity=CC_VALID | packet.ContinuityCounter;
+    if (packet.ContinuityCounter!=expected && (last & CC_VALID) && !packet.Discontinuity())
+    {
+      if (packet.HasPayload && packet.ContinuityCounter==(last & 0xF) && !(last & CC_DUPLICATE))
+        continuity|=CC_DUPLICATE;
+      else
+        state.health.continuityErrors++;
+    }
+    state.continuity=continuity;
+  }
+
+  if (packet.HasPcr()) OnPcr(state, packet);
+  if (packet.PayloadUnitStart && (packet.Pid==0 || state.isTable)) OnTableSection(state, packet);
+}
+
+void CStreamHealthMonitor::OnPcr(PidState& state, const TsPacketView& packet)
+{
+  __int64 pcr=(__int64)packet.PcrBase()*300 + (((packet.Data[10] & 1)<<8) | packet.Data[11]);
+  state.health.pcrCount++;
+
+  if (state.hasPcr && !packet.Discontinuity())
+  {
+    __int64 delta=pcr-state.lastPcr;
+    if (delta < 0) delta+=PCR_WRAP;
+    if (delta > PCR_JUMP_MAX*PCR_TICKS_PER_MS)
+    {
+      state.health.pcrDiscontinuities++;
+      state.ticksPerPacket=0;
+    }
+    else
+    {
+      int interval=(int)(delta/PCR_TICKS_PER_MS);
+      if (interval > state.health.pcrMaxInterval) state.health.pcrMaxInterval=interval;
+      if (delta > PCR_REPETITION_MAX*PCR_TICKS_PER_MS) state.health.pcrRepetitionErrors++;
+
+      __int64 packets=m_iPackets-state.lastPcrPacket;
+      if (state.ticksPerPacket > 0)
+      {
+        // 27 ticks per microsecond
+        int jitter=(int)(fabs(delta-state.ticksPerPacket*packets)*1000/27);
+        if (jitter > state.pcrJitter) state.pcrJitter=jitter;
+      }
+      double ticksPerPacket=(double)delta/packets;
+      if (state.ticksPerPacket > 0)
+        state.ticksPerPacket+=(ticksPerPacket-state.ticksPerPacket)/16;
+      else
+        state.ticksPerPacket=ticksPerPacket;
+    }
+  }
+  else
+  {
+    state.ticksPerPacket=0;
+  }
+  state.lastPcr=pcr;
+  state.lastPcrPacket=m_iPackets;
+  state.hasPcr=true;
+}
+
+void CStreamHealthMonitor::OnTableSection(PidState& state, const TsPacketView& packet)
+{
+  int start=packet.PayLoadStart();
+  const byte* section=&packet.Data[start];
+  int len=188-start;
+  if (len < 2 || 1+section[0] >= len) return;
+  len-=1+section[0];
+  section+=1+section[0];
+
+  if (packet.Pid==0)
+  {
+    if (section[0]!=0x00) return;
+    state.isTable=true;
+    OnPat(section, len);
+  }
+  else if (section[0]!=0x02)
+  {
+    return;
+  }
+
+  DWORD now=GetTickCount();
+  if (state.hasTable)
+  {
+    int interval=(int)(now-state.lastTableTick);
+    if (interval > state.health.tableMaxInterval) state.health.tableMaxInterval=interval;
+    if (interval > TABLE_REPETITION_MAX && !state.tableLate) state.health.tableRepetitionErrors++;
+  }
+  state.lastTableTick=now;
+  state.hasTable=true;
+  state.tableLate=false;
+}
+
+void CStreamHealthMonitor::OnPat(const byte* section, int len)
+{
+  // only the programs in this packet, a pat rarely spans more than one
+  if (len < 8) return;
+  int sectionLength=((section[1] & 0xF)<<8) | section[2];
+  int end=min(3+sectionLength-4, len);
+  for (int i=8; i+4 <= end; i+=4)
+  {
+    int program=(section[i]<<8) | section[i+1];
+    int pid=((section[i+2] & 0x1F)<<8) | section[i+3];
+    if (program!=0) m_pids[pid].isTable=true;
+  }
+}
+
+void CStreamHealthMonitor::RollWindow(DWORD now)
+{
+  DWORD elapsed=now-m_windowTick;
+  m_windowTick=now;
+  m_iWindow=(m_iWindow+1) % HEALTH_WINDOWS;
+  if (m_iWindowCount < HEALTH_WINDOWS) m_iWindowCount++;
+
+  for (int i=0; i < m_iSeenCount;++i)
+  {
+    PidState& state=m_pids[m_seenPids[i]];
+    int bitrate=(int)((state.health.packets-state.windowStart)*188*8*1000/elapsed);
+    state.windowStart=state.health.packets;
+    state.windowBitrate[m_iWindow]=bitrate;
+    state.health.bitrate=bitrate;
+
+    __int64 sum=0;
+    for (int w=0; w < HEALTH_WINDOWS;++w)
+    {
+      sum+=state.windowBitrate[w];
+    }
+    state.health.averageBitrate=(int)(sum/m_iWindowCount);
+
+    state.health.pcrJitter=state.pcrJitter;
+    state.pcrJitter=0;
+
+    // a table which stopped coming is an error as well, not only a late one
+    if (state.hasTable && !state.tableLate && (int)(now-state.lastTableTick) > TABLE_REPETITION_MAX)
+    {
+      state.health.tableRepetitionErrors++;
+      state.tableLate=true;
+    }
+  }
+}
@@ -0,0 +1,96 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+#include "..\..\shared\TsPacketView.h"
+
+#define HEALTH_MAX_PIDS 0x2000
+#define HEALTH_WINDOWS  8       // one second each
+
+// Snapshot of the counters of one pid, the layout is shared with TvLibrary
+typedef struct stPidHealth
+{
+  __int64 packets;
+  int     continuityErrors;
+  int     transportErrors;        // packets with the transport error indicator set
+  int     scrambled;              // 1 if the last packet was scrambled
+  int     scrambledPackets;
+  int     bitrate;                // bit/s over the last second
+  int     averageBitrate;         // bit/s over the last HEALTH_WINDOWS seconds
+  int     pcrCount;
+  int     pcrRepetitionErrors;    // more than 40 ms between two pcrs
+  int     pcrDiscontinuities;     // pcr jumped back or more than 100 ms ahead without discontinuity flag
+  int     pcrMaxInterval;         // ms
+  int     pcrJitter;              // ns, largest pcr deviation from the clock model during the last second
+  int     tableRepetitionErrors;  // pat or pmt not repeated within 500 ms
+  int     tableMaxInterval;       // ms
+}PidHealth;
+
+// ETR 290 style transport stream checks for every pid of the mux. The state of all
+// pids is allocated up front, OnTsPacket() only updates counters. Wall clock is only
+// read for table sections and once every 1024 packets to roll the bitrate windows.
+// PCR accuracy is measured against a clock model which predicts each pcr from the
+// previous one and the packets received in between.
+class CStreamHealthMonitor
+{
+public:
+  CStreamHealthMonitor(void);
+  virtual ~CStreamHealthMonitor(void);
+
+  void  Reset();
+  void  OnTsPacket(const TsPacketView& packet);
+
+  // fills pids with up to maxCount pids which were seen, count is the number of pids seen
+  void  GetPids(int* pids, int maxCount, int* count);
+  // false if the pid wasn't seen
+  bool  GetHealth(int pid, PidHealth* health);
+
+private:
+  typedef struct stPidState
+  {
+    PidHealth health;
+    bool      seen;
+    BYTE      continuity;         // the last counter in the low 4 bits, CC_VALID and CC_DUPLICATE
+    bool      isTable;            // pat or pmt pid
+    bool      hasTable;
+    bool      tableLate;          // dropout already counted
+    DWORD     lastTableTick;
+    bool      hasPcr;
+    __int64   lastPcr;            // 27 MHz
+    __int64   lastPcrPacket;
+    double    ticksPerPacket;     // clock model, 0 until two pcrs arrived
+    int       pcrJitter;          // ns, of the current window
+    __int64   windowStart;        // packets at the start of the current window
+    int       windowBitrate[HEALTH_WINDOWS];
+  }PidState;
+
+  void  OnPcr(PidState& state, const TsPacketView& packet);
+  void  OnTableSection(PidState& state, const TsPacketView& packet);
+  void  OnPat(const byte* section, int len);
+  void  RollWindow(DWORD now);
+
+  PidState* m_pids;
+  int*      m_seenPids;
+  int       m_iSeenCount;
+  __int64   m_iPackets;
+  DWORD     m_windowTick;
+  int       m_iWindow;
+  int       m_iWindowCount;
+};
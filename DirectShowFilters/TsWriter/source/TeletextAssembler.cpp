@@ -0,0 +1,283 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#include <windows.h>
+#include <string.h>
+#include "TeletextAssembler.h"
+#include "..\..\shared\DvbUtil.h"
+
+extern void LogDebug(const char *fmt, ...) ;
+
+#define DATA_UNIT_EBU_TELETEXT          0x02
+#define DATA_UNIT_EBU_TELETEXT_SUBTITLE 0x03
+#define DATA_UNIT_LENGTH                0x2C
+#define FRAMING_CODE                    0xE4
+
+// hamming 8/4 code words of the values 0..15, in transmission bit order
+static const byte HAMMING_84_ENCODE[16]={0x15,0x02,0x49,0x5E,0x64,0x73,0x38,0x2F,0xD0,0xC7,0x8C,0x9B,0xA1,0xB6,0xFD,0xEA};
+
+static byte s_hamming84[256];   // decoded value, single bit errors corrected, 0xFF if not correctable
+static byte s_reverse[256];     // the bytes arrive msb first
+static bool s_bTablesBuilt=false;
+
+static void BuildTables()
+{
+  if (s_bTablesBuilt) return;
+  for (int i=0; i < 256;++i)
+  {
+    s_hamming84[i]=0xFF;
+    for (int value=0; value < 16;++value)
+    {
+      int diff=i ^ HAMMING_84_ENCODE[value];
+      // the code words are at least 4 bits apart, so at most one is within 1 bit
+      if ((diff & (diff-1))==0)
+      {
+        s_hamming84[i]=value;
+        break;
+      }
+    }
+    byte reversed=0;
+    for (int bit=0; bit < 8;++bit)
+    {
+      if (i & (1<<bit)) reversed|=0x80>>bit;
+    }
+    s_reverse[i]=reversed;
+  }
+  s_bTablesBuilt=true;
+}
+
+CTeletextAssembler::CTeletextAssembler(void)
+{
+  BuildTables();
+  m_pCallback=NULL;
+  Reset();
+}
+
+CTeletextAssembler::~CTeletextAssembler(void)
+{
+  Reset();
+}
+
+void CTeletextAssembler::Reset()
+{
+  for (int i=0; i < 8;++i)
+  {
+    m_magazines[i].pageNumber=-1;
+  }
+  m_iLastMagazine=-1;
+  m_bSerial=false;
+  m_bInPes=false;
+  m_iContinuityCounter=-1;
+  m_iSkip=0;
+  m_iUnitLength=0;
+
+  for (itPages it=m_pages.begin(); it!=m_pages.end();++it)
+  {
+    delete it->second;
+  }
+  m_pages.clear();
+}
+
+void CTeletextAssembler::SetCallBack(ITeletextPageCallBack* callback)
+{
+  m_pCallback=callback;
+}
+
+bool CTeletextAssembler::GetPage(int pageNumber, int subPageNumber, byte* pageData)
+{
+  itPages it=m_pages.find((pageNumber<<16) | subPageNumber);
+  if (it==m_pages.end()) return false;
+  memcpy(pageData, it->second->rows, TELETEXT_PAGE_SIZE);
+  return true;
+}
+
+void CTeletextAssembler::OnTsPacket(const TsPacketView& packet)
+{
+  if (packet.TransportError || packet.TScrambling || !packet.HasPayload) return;
+
+  if (m_iContinuityCounter>=0 && packet.ContinuityCounter!=((m_iContinuityCounter+1) & 0xF))
+  {
+    if (packet.ContinuityCounter==m_iContinuityCounter) return;  // duplicate packet
+    m_bInPes=false;
+  }
+  m_iContinuityCounter=packet.ContinuityCounter;
+
+  int start=packet.PayLoadStart();
+  if (packet.HasAdaptionField && start==4) return;
+  const byte* data=&packet.Data[start];
+  int len=188-start;
+
+  if (packet.PayloadUnitStart)
+  {
+    // private_stream_1, the header is followed by the data_identifier
+    if (len < 9 || data[0]!=0 || data[1]!=0 || data[2]!=1 || data[3]!=0xBD)
+    {
+      m_bInPes=false;
+      return;
+    }
+    m_bInPes=true;
+    m_iSkip=9+data[8]+1;
+    m_iUnitLength=0;
+  }
+  if (!m_bInPes) return;
+  OnPesPayload(data, len);
+}
+
+void CTeletextAssembler::OnPesPayload(const byte* data, int len)
+{
+  // data units may span ts packets
+  while (len > 0)
+  {
+    if (m_iSkip > 0)
+    {
+      int skip=min(m_iSkip, len);
+      m_iSkip-=skip;
+      data+=skip;
+      len-=skip;
+      continue;
+    }
+    if (m_iUnitLength < 2)
+    {
+      m_unit[m_iUnitLength++]=*data++;
+      len--;
+      continue;
+    }
+    int unitSize=2+m_unit[1];
+    int copy=min(unitSize-m_iUnitLength, len);
+    memcpy(&m_unit[m_iUnitLength], data, copy);
+    m_iUnitLength+=copy;
+    data+=copy;
+    len-=copy;
+    if (m_iUnitLength==unitSize)
+    {
+      OnDataUnit(m_unit);
+      m_iUnitLength=0;
+    }
+  }
+}
+
+void CTeletextAssembler::OnDataUnit(const byte* unit)
+{
+  if (unit[0]!=DATA_UNIT_EBU_TELETEXT && unit[0]!=DATA_UNIT_EBU_TELETEXT_SUBTITLE) return;
+  if (unit[1]!=DATA_UNIT_LENGTH || unit[3]!=FRAMING_CODE) return;
+
+  byte row[42];
+  for (int i=0; i < 42;++i)
+  {
+    row[i]=s_reverse[unit[4+i]];
+  }
+  OnRow(row, unit[0]==DATA_UNIT_EBU_TELETEXT_SUBTITLE);
+}
+
+void CTeletextAssembler::OnRow(byte* row, bool isSubtitle)
+{
+  byte address1=s_hamming84[row[0]];
+  byte address2=s_hamming84[row[1]];
+  if (address1==0xFF || address2==0xFF) return;
+  // keep the corrected code words, a bit error must not make a page look changed
+  row[0]=HAMMING_84_ENCODE[address1];
+  row[1]=HAMMING_84_ENCODE[address2];
+  int magazine=address1 & 7;
+  int packetNumber=(address1>>3) | (address2<<1);
+  MagazineState& state=m_magazines[magazine];
+
+  if (packetNumber==0)
+  {
+    // in serial mode the header of any magazine ends the page in transmission
+    if (m_bSerial && m_iLastMagazine>=0) FinishPage(m_iLastMagazine);
+    FinishPage(magazine);
+
+    byte header[8];
+    for (int i=0; i < 8;++i)
+    {
+      header[i]=s_hamming84[row[2+i]];
+      if (header[i]==0xFF) return;
+      row[2+i]=HAMMING_84_ENCODE[header[i]];
+    }
+    m_bSerial=((header[7] & 1)!=0);
+    m_iLastMagazine=magazine;
+    // page ff only fills time, it has no rows
+    if (header[0]==0xF && header[1]==0xF) return;
+
+    int pageNumber=(magazine==0 ? 8 : magazine)*0x100 + header[1]*0x10 + header[0];
+    int subPageNumber=((header[5] & 3)<<12) + (header[4]<<8) + ((header[3] & 7)<<4) + header[2];
+    isSubtitle|=((header[5] & 8)!=0);
+    StartPage(state, pageNumber, subPageNumber, isSubtitle);
+    memcpy(state.rows, row, 42);
+    return;
+  }
+
+  if (state.pageNumber<0) return;
+  if (m_bSerial && m_iLastMagazine!=magazine) return;
+  if (packetNumber <= 24)
+  {
+    memcpy(&state.rows[packetNumber*42], row, 42);
+  }
+  else if (packetNumber==27 && s_hamming84[row[2]]==0)
+  {
+    // only the editorial links, the other designation codes are 24/18 coded enhancements
+    memcpy(&state.rows[27*42], row, 42);
+  }
+}
+
+void CTeletextAssembler::StartPage(MagazineState& magazine, int pageNumber, int subPageNumber, bool isSubtitle)
+{
+  magazine.pageNumber=pageNumber;
+  magazine.subPageNumber=subPageNumber;
+  magazine.isSubtitle=isSubtitle;
+  memset(magazine.rows, ' ', TELETEXT_PAGE_SIZE);
+}
+
+void CTeletextAssembler::FinishPage(int magazine)
+{
+  MagazineState& state=m_magazines[magazine];
+  if (state.pageNumber<0) return;
+  int pageNumber=state.pageNumber;
+  int subPageNumber=state.subPageNumber;
+  state.pageNumber=-1;
+
+  // the header row carries the clock, it would make every page look changed
+  DWORD crc=crc32((char*)&state.rows[42], TELETEXT_PAGE_SIZE-42);
+  int key=(pageNumber<<16) | subPageNumber;
+  CachedPage* page;
+  itPages it=m_pages.find(key);
+  if (it==m_pages.end())
+  {
+    page=new CachedPage();
+    m_pages[key]=page;
+  }
+  else
+  {
+    page=it->second;
+    if (page->crc==crc && page->isSubtitle==state.isSubtitle)
+    {
+      memcpy(page->rows, state.rows, 42);
+      return;
+    }
+  }
+  page->crc=crc;
+  page->isSubtitle=state.isSubtitle;
+  memcpy(page->rows, state.rows, TELETEXT_PAGE_SIZE);
+
+  if (m_pCallback!=NULL)
+  {
+    m_pCallback->OnTeletextPageChanged(pageNumber, subPageNumber, page->isSubtitle ? TRUE : FALSE);
+  }
+}
@@ -0,0 +1,87 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+#include "..\..\shared\TsPacketView.h"
+#include <map>
+using namespace std;
+
+// 50 rows of 42 bytes, the page layout of the TvLibrary teletext page cache. The
+// rows are bit reversed to transmission order but still hamming/parity coded.
+#define TELETEXT_PAGE_SIZE 2100
+
+DECLARE_INTERFACE_(ITeletextPageCallBack, IUnknown)
+{
+	STDMETHOD(OnTeletextPageChanged)(THIS_ int pageNumber, int subPageNumber, BOOL isSubtitle)PURE;
+};
+
+// Reassembles the EBU teletext pages (EN 300 472) carried in the PES packets of a
+// teletext pid. A page is complete when the next header of its magazine arrives,
+// it is kept per page/subpage and the callback is only raised when the content
+// of a page differs from the cached copy.
+class CTeletextAssembler
+{
+public:
+  CTeletextAssembler(void);
+  virtual ~CTeletextAssembler(void);
+
+  void  Reset();
+  void  SetCallBack(ITeletextPageCallBack* callback);
+  void  OnTsPacket(const TsPacketView& packet);
+  // copies a cached page into pageData (TELETEXT_PAGE_SIZE bytes), false if it wasn't received
+  bool  GetPage(int pageNumber, int subPageNumber, byte* pageData);
+
+private:
+  typedef struct stMagazineState
+  {
+    int   pageNumber;           // -1 while no page is being received
+    int   subPageNumber;
+    bool  isSubtitle;
+    byte  rows[TELETEXT_PAGE_SIZE];
+  }MagazineState;
+
+  typedef struct stCachedPage
+  {
+    DWORD crc;
+    bool  isSubtitle;
+    byte  rows[TELETEXT_PAGE_SIZE];
+  }CachedPage;
+
+  void  OnPesPayload(const byte* data, int len);
+  void  OnDataUnit(const byte* unit);
+  void  OnRow(byte* row, bool isSubtitle);
+  void  StartPage(MagazineState& magazine, int pageNumber, int subPageNumber, bool isSubtitle);
+  void  FinishPage(int magazine);
+
+  ITeletextPageCallBack* m_pCallback;
+  MagazineState m_magazines[8];
+  int           m_iLastMagazine;
+  bool          m_bSerial;
+
+  // pes reassembly
+  bool  m_bInPes;
+  int   m_iContinuityCounter;
+  int   m_iSkip;                // bytes of the pes header and data_identifier left to skip
+  byte  m_unit[2+255];
+  int   m_iUnitLength;
+
+  map<int,CachedPage*> m_pages;    // key is pageNumber<<16 | subPageNumber
+  typedef map<int,CachedPage*>::iterator itPages;
+};
@@ -39,6 +39,7 @@ CTeletextGrabber::CTeletextGrabber(LPUNKNOWN pUnk, HRESULT *phr)
 	m_iTeletextPid=-1;
 	m_bRunning=FALSE;
 	m_pCallback=NULL;
+	m_pPageCallback=NULL;
 	m_pBuffer = new byte[20000];
 }
 
@@ -54,6 +55,7 @@ STDMETHODIMP CTeletextGrabber::SetTeletextPid(int teletextPid)
 	{
 		LogDebug("TeletextGrabber: set pid:%x", teletextPid);
 		m_iTeletextPid=teletextPid;
+		m_assembler.Reset();
 	}
 	catch(...)
 	{
@@ -70,11 +72,28 @@ STDMETHODIMP CTeletextGrabber::SetCallBack(ITeletextCallBack* callback)
 	return S_OK;
 }
 
+STDMETHODIMP CTeletextGrabber::SetPageCallBack(ITeletextPageCallBack* callback)
+{
+	CEnterCriticalSection enter(m_section);
+	LogDebug("TeletextGrabber: set page callback:%x", callback);
+	m_pPageCallback=callback;
+	m_assembler.SetCallBack(callback);
+	return S_OK;
+}
+
+STDMETHODIMP CTeletextGrabber::GetPage(int pageNumber, int subPageNumber, BYTE* pageData)
+{
+	if (pageData==NULL) return E_POINTER;
+	CEnterCriticalSection enter(m_section);
+	return m_assembler.GetPage(pageNumber, subPageNumber, pageData) ? S_OK : S_FALSE;
+}
+
 STDMETHODIMP CTeletextGrabber::Start()
 {
 	CEnterCriticalSection enter(m_section);
 	LogDebug("TeletextGrabber: start");
 	m_iPacketCounter=0;
+	m_assembler.Reset();
 	m_bRunning=true;
 	return S_OK;
 }
@@ -87,19 +106,24 @@ STDMETHODIMP CTeletextGrabber::Stop()
 	return S_OK;
 }
 
-void CTeletextGrabber::OnTsPacket(byte* tsPacket)
+void CTeletextGrabber::OnTsPacket(const TsPacketView& packet)
 {
 	if (!m_bRunning) return;
-	if (m_pCallback==NULL) return;
+	if (m_pCallback==NULL && m_pPageCallback==NULL) return;
 	if (m_iTeletextPid<=0) return;
+	if (packet.Pid!=m_iTeletextPid) return;
 	CEnterCriticalSection enter(m_section);
-	CTsHeader header(tsPacket);
-	if (header.SyncByte!=0x47) return;
-	if (header.TransportError!=0) return;
-	if (header.Pid!=m_iTeletextPid) return;
-	if (header.AdaptionFieldOnly()) return;
+	if (packet.TransportError) return;
+	if (packet.AdaptionFieldOnly()) return;
+
+	// pages are only handed over when they changed
+	if (m_pPageCallback!=NULL)
+	{
+		m_assembler.OnTsPacket(packet);
+	}
+	if (m_pCallback==NULL) return;
 
-	memcpy(&m_pBuffer[m_iPacketCounter*188], tsPacket,188);
+	memcpy(&m_pBuffer[m_iPacketCounter*188], packet.Data,188);
 	m_iPacketCounter++;
 	if (m_iPacketCounter >= 25)
 	{
@@ -21,6 +21,8 @@
 #pragma once
 #include "criticalsection.h"
 #include "entercriticalsection.h"
+#include "..\..\shared\TsPacketView.h"
+#include "TeletextAssembler.h"
 
 using namespace Mediaportal;
 
@@ -39,6 +41,8 @@ DECLARE_INTERFACE_(ITeletextGrabber, IUnknown)
 	STDMETHOD(Stop)(THIS_ )PURE;
 	STDMETHOD(SetTeletextPid)(THIS_ int teletextPid)PURE;
 	STDMETHOD(SetCallBack)(THIS_ ITeletextCallBack* callback)PURE;
+	STDMETHOD(SetPageCallBack)(THIS_ ITeletextPageCallBack* callback)PURE;
+	STDMETHOD(GetPage)(THIS_ int pageNumber, int subPageNumber, BYTE* pageData)PURE;
 };
 
 class CTeletextGrabber: public CUnknown,  public ITeletextGrabber
@@ -52,10 +56,14 @@ public:
 	STDMETHODIMP Stop( );
 	STDMETHODIMP SetTeletextPid( int teletextPid);
 	STDMETHODIMP SetCallBack( ITeletextCallBack* callback);
+	STDMETHODIMP SetPageCallBack( ITeletextPageCallBack* callback);
+	STDMETHODIMP GetPage( int pageNumber, int subPageNumber, BYTE* pageData);
 
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
 private:
 	ITeletextCallBack* m_pCallback;
+	ITeletextPageCallBack* m_pPageCallback;
+	CTeletextAssembler m_assembler;
 	int			m_iTeletextPid;
 	bool		m_bRunning;
 	byte*   m_pBuffer;
@@ -37,12 +37,20 @@ CTsChannel::CTsChannel(LPUNKNOWN pUnk, HRESULT *phr,int id)
 	m_pPmtGrabber = new CPmtGrabber(pUnk,phr);
 	m_pRecorder = new CDiskRecorder(RecordingMode::Recording);
 	m_pTimeShifting= new CDiskRecorder(RecordingMode::TimeShift);
+	m_pNetworkSender= new CDiskRecorder(RecordingMode::Network);
 	m_pTeletextGrabber= new CTeletextGrabber(pUnk,phr);
   m_pCaGrabber= new CCaGrabber(pUnk,phr);
+  m_pWorker= new CChannelWorker(this);
 }
 
 CTsChannel::~CTsChannel(void)
 {
+	if (m_pWorker!=NULL)
+	{
+		LogDebug("del m_pWorker");
+		delete m_pWorker;
+		m_pWorker=NULL;
+	}
 	if (m_pVideoAnalyzer!=NULL)
 	{
 		LogDebug("del m_pVideoAnalyzer");
@@ -67,6 +75,12 @@ CTsChannel::~CTsChannel(void)
 		delete m_pTimeShifting;
 		m_pTimeShifting=NULL;
 	}
+	if (m_pNetworkSender!=NULL)
+	{
+		LogDebug("del m_pNetworkSender");
+		delete m_pNetworkSender;
+		m_pNetworkSender=NULL;
+	}
 	if (m_pTeletextGrabber!=NULL)
 	{
 		LogDebug("del m_pTeletextGrabber");
@@ -82,16 +96,27 @@ CTsChannel::~CTsChannel(void)
 	LogDebug("del done...");
 }
 
-void CTsChannel::OnTsPacket(byte* tsPacket)
+void CTsChannel::OnTsPacket(const TsPacketView& packet)
+{
+	m_pWorker->Write(packet.Data);
+}
+
+void CTsChannel::Flush()
+{
+	m_pWorker->Flush();
+}
+
+void CTsChannel::ProcessTsPacket(const TsPacketView& packet)
 {
 	try
 	{
-		m_pVideoAnalyzer->OnTsPacket(tsPacket);
-		m_pPmtGrabber->OnTsPacket(tsPacket);
-		m_pRecorder->OnTsPacket(tsPacket);
-		m_pTimeShifting->OnTsPacket(tsPacket);
-		m_pTeletextGrabber->OnTsPacket(tsPacket);
-    m_pCaGrabber->OnTsPacket(tsPacket);
+		m_pVideoAnalyzer->OnTsPacket(packet);
+		m_pPmtGrabber->OnTsPacket(packet);
+		m_pRecorder->OnTsPacket(packet);
+		m_pTimeShifting->OnTsPacket(packet);
+		m_pNetworkSender->OnTsPacket(packet);
+		m_pTeletextGrabber->OnTsPacket(packet);
+    m_pCaGrabber->OnTsPacket(packet);
 	}
 	catch(...)
 	{
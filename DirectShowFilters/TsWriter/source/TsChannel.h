@@ -27,6 +27,7 @@
 #include "DiskRecorder.h"
 #include "teletextgrabber.h"
 #include "cagrabber.h"
+#include "ChannelWorker.h"
 
 // {C564CEB9-FC77-4776-8CB8-96DD87624161}
 
@@ -35,14 +36,20 @@ class CTsChannel
 public:
 	CTsChannel(LPUNKNOWN pUnk, HRESULT *phr, int id);
 	virtual ~CTsChannel(void);
-  void OnTsPacket(byte* tsPacket);
+  // streaming thread, queues the packet for the worker
+  void OnTsPacket(const TsPacketView& packet);
+  void Flush();
+  // worker thread
+  void ProcessTsPacket(const TsPacketView& packet);
 	int Handle() { return m_id;}
 
 	CVideoAnalyzer* m_pVideoAnalyzer;
 	CPmtGrabber*		m_pPmtGrabber;
 	CDiskRecorder*	m_pRecorder;
 	CDiskRecorder*	m_pTimeShifting;
+	CDiskRecorder*	m_pNetworkSender;
 	CTeletextGrabber*	m_pTeletextGrabber;
   CCaGrabber*     m_pCaGrabber;
+  CChannelWorker* m_pWorker;
 	int m_id;
 };
@@ -312,6 +312,7 @@ STDMETHODIMP CMpTsFilterPin::Receive(IMediaSample *pSample)
 			if (!m_rawPaketWriter->IsFileInvalid())
 				m_rawPaketWriter->Write(pbData,sampleLen);
 		OnRawData(pbData, sampleLen);
+		m_pWriterFilter->FlushTsPackets();
 	}
 	catch(...)
 	{
@@ -383,6 +384,7 @@ CMpTs::CMpTs(LPUNKNOWN pUnk, HRESULT *phr)
   m_pChannelScanner= new CChannelScan(GetOwner(),phr,m_pFilter);
   m_pEpgScanner = new CEpgScanner(GetOwner(),phr);
   m_pChannelLinkageScanner = new CChannelLinkageScanner(GetOwner(),phr);
+  m_pHealthMonitor = new CStreamHealthMonitor();
   m_rawPaketWriter=new FileWriter();
   m_pPin->AssignRawPaketWriter(m_rawPaketWriter);
 }
@@ -395,6 +397,7 @@ CMpTs::~CMpTs()
 	delete m_pChannelScanner;
 	delete m_pEpgScanner;
 	delete m_pChannelLinkageScanner;
+	delete m_pHealthMonitor;
 	delete m_rawPaketWriter;
   CAutoLock lock(&m_Lock);
   for (int i=0; i < (int)m_vecChannels.size();++i)
@@ -504,11 +507,15 @@ void CMpTs::AnalyzeTsPacket(byte* tsPacket)
 	try
 	{
     CAutoLock lock(&m_Lock);
+    // decode the header once for all listeners
+    TsPacketView packet(tsPacket);
+    m_pHealthMonitor->OnTsPacket(packet);
+    // only queued, each channel is processed by its own worker
     for (int i=0; i < (int)m_vecChannels.size();++i)
     {
-      m_vecChannels[i]->OnTsPacket(tsPacket);
+      m_vecChannels[i]->OnTsPacket(packet);
     }
-		m_pChannelScanner->OnTsPacket(tsPacket);
+		m_pChannelScanner->OnTsPacket(packet);
 		m_pEpgScanner->OnTsPacket(tsPacket);
 		m_pChannelLinkageScanner->OnTsPacket(tsPacket);
 	}
@@ -518,6 +525,14 @@ void CMpTs::AnalyzeTsPacket(byte* tsPacket)
 	}
 }
 
+void CMpTs::FlushTsPackets()
+{
+  CAutoLock lock(&m_Lock);
+  for (int i=0; i < (int)m_vecChannels.size();++i)
+  {
+    m_vecChannels[i]->Flush();
+  }
+}
 
 STDMETHODIMP CMpTs::AddChannel( int* handle)
 {
@@ -532,21 +547,23 @@ STDMETHODIMP CMpTs::AddChannel( int* handle)
 
 STDMETHODIMP CMpTs::DeleteChannel( int handle)
 {
-  CAutoLock lock(&m_Lock);
+  // the channel is deleted outside the lock, its worker may be waiting for it in a callback
+  CTsChannel* channel=NULL;
 	try
 	{
+    CAutoLock lock(&m_Lock);
 		ivecChannels it = m_vecChannels.begin();
 		while (it != m_vecChannels.end())
 		{
 			if ((*it)->Handle()==handle)
 			{
-				delete *it;
+				channel=*it;
 				m_vecChannels.erase(it);
         if (m_vecChannels.size()==0)
         {
           m_id=0;
         }
-				return S_OK;
+				break;
 			}
 			++it;
 		}
@@ -555,6 +572,7 @@ STDMETHODIMP CMpTs::DeleteChannel( int handle)
 	{
 	  LogDebug("exception in delete channel");
 	}
+	delete channel;
   return S_OK;
 }
 
@@ -575,14 +593,17 @@ CTsChannel* CMpTs::GetTsChannel(int handle)
 
 STDMETHODIMP CMpTs::DeleteAllChannels()
 {
-  CAutoLock lock(&m_Lock);
   LogDebug("--delete all channels");
-  for (int i=0; i < (int)m_vecChannels.size();++i)
+  vector<CTsChannel*> channels;
   {
-    delete m_vecChannels[i];
+    CAutoLock lock(&m_Lock);
+    channels.swap(m_vecChannels);
+    m_id=0;
+  }
+  for (int i=0; i < (int)channels.size();++i)
+  {
+    delete channels[i];
   }
-  m_vecChannels.clear();
-	m_id=0;
   return S_OK;
 }
 
@@ -838,6 +859,95 @@ STDMETHODIMP CMpTs::TTxSetCallBack( int handle,ITeletextCallBack* callback)
 	return pChannel->m_pTeletextGrabber->SetCallBack(callback );
 }
 
+STDMETHODIMP CMpTs::TTxSetPageCallBack( int handle,ITeletextPageCallBack* callback)
+{
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+	return pChannel->m_pTeletextGrabber->SetPageCallBack(callback );
+}
+
+STDMETHODIMP CMpTs::TTxGetPage( int handle,int pageNumber,int subPageNumber,BYTE* pageData)
+{
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_FALSE;
+	return pChannel->m_pTeletextGrabber->GetPage(pageNumber,subPageNumber,pageData);
+}
+
+STDMETHODIMP CMpTs::HealthReset()
+{
+  CAutoLock lock(&m_Lock);
+  m_pHealthMonitor->Reset();
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::HealthGetPids(int* pids, int maxCount, int* count)
+{
+  if (pids==NULL || count==NULL) return E_POINTER;
+  CAutoLock lock(&m_Lock);
+  m_pHealthMonitor->GetPids(pids, maxCount, count);
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::HealthGetPid(int pid, PidHealth* health)
+{
+  if (health==NULL) return E_POINTER;
+  CAutoLock lock(&m_Lock);
+  return m_pHealthMonitor->GetHealth(pid, health) ? S_OK : S_FALSE;
+}
+
+STDMETHODIMP CMpTs::NetworkSetDestination(int handle, wchar_t* address, int port, BOOL rtp)
+{
+  if (address==NULL) return E_POINTER;
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  pChannel->m_pNetworkSender->SetDestination(address, port, rtp!=FALSE);
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::NetworkSetPmtPid(int handle, int pmtPid, int serviceId, byte* pmtData, int pmtLength)
+{
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  pChannel->m_pNetworkSender->SetPmtPid(pmtPid, serviceId, pmtData, pmtLength);
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::NetworkStart(int handle)
+{
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  if (pChannel->m_pNetworkSender->Start())
+    return S_OK;
+  else
+    return S_FALSE;
+}
+
+STDMETHODIMP CMpTs::NetworkStop(int handle)
+{
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  pChannel->m_pNetworkSender->Stop();
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::NetworkGetCounters(int handle, int* datagramsSent, int* datagramsDropped)
+{
+  if (datagramsSent==NULL || datagramsDropped==NULL) return E_POINTER;
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  pChannel->m_pNetworkSender->GetNetworkCounters(datagramsSent, datagramsDropped);
+  return S_OK;
+}
+
+STDMETHODIMP CMpTs::GetChannelQueueCounters(int handle, int* queuedPackets, int* maxQueuedPackets, int* droppedPackets, int* maxLatencyMs)
+{
+  if (queuedPackets==NULL || maxQueuedPackets==NULL || droppedPackets==NULL || maxLatencyMs==NULL) return E_POINTER;
+  CTsChannel* pChannel=GetTsChannel(handle);
+  if (pChannel==NULL) return S_OK;
+  pChannel->m_pWorker->GetCounters(queuedPackets, maxQueuedPackets, droppedPackets, maxLatencyMs);
+  return S_OK;
+}
+
 STDMETHODIMP CMpTs::CaSetCallBack(int handle,ICACallback* callback)
 {
   CTsChannel* pChannel=GetTsChannel(handle);
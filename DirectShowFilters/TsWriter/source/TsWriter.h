@@ -29,6 +29,7 @@
 #include "channellinkagescanner.h"
 #include "tschannel.h"
 #include "videoaudioobserver.h"
+#include "StreamHealthMonitor.h"
 #include <map>
 #include <vector>
 using namespace std;
@@ -92,6 +93,21 @@ DECLARE_INTERFACE_(ITSFilter, IUnknown)
       int* TsDiscontinuity, int* recordingDiscontinuity)PURE;
   
     STDMETHOD(TimeShiftSetChannelType)(THIS_ int handle, int channelType)PURE;
+
+	STDMETHOD(TTxSetPageCallBack)(THIS_ int handle,ITeletextPageCallBack* callback)PURE;
+	STDMETHOD(TTxGetPage)(THIS_ int handle,int pageNumber,int subPageNumber,BYTE* pageData)PURE;
+
+	STDMETHOD(HealthReset)(THIS_ )PURE;
+	STDMETHOD(HealthGetPids)(THIS_ int* pids, int maxCount, int* count)PURE;
+	STDMETHOD(HealthGetPid)(THIS_ int pid, PidHealth* health)PURE;
+
+	STDMETHOD(NetworkSetDestination)(THIS_ int handle, wchar_t* address, int port, BOOL rtp)PURE;
+	STDMETHOD(NetworkSetPmtPid)(THIS_ int handle, int pmtPid, int serviceId, byte* pmtData, int pmtLength)PURE;
+	STDMETHOD(NetworkStart)(THIS_ int handle)PURE;
+	STDMETHOD(NetworkStop)(THIS_ int handle)PURE;
+	STDMETHOD(NetworkGetCounters)(THIS_ int handle, int* datagramsSent, int* datagramsDropped)PURE;
+
+	STDMETHOD(GetChannelQueueCounters)(THIS_ int handle, int* queuedPackets, int* maxQueuedPackets, int* droppedPackets, int* maxLatencyMs)PURE;
 };
 
 // Main filter object
@@ -213,10 +229,26 @@ public:
 
 		STDMETHODIMP TimeShiftSetChannelType(int handle, int channelType);
 
+		STDMETHODIMP TTxSetPageCallBack( int handle,ITeletextPageCallBack* callback);
+		STDMETHODIMP TTxGetPage( int handle,int pageNumber,int subPageNumber,BYTE* pageData);
+
+		STDMETHODIMP HealthReset();
+		STDMETHODIMP HealthGetPids(int* pids, int maxCount, int* count);
+		STDMETHODIMP HealthGetPid(int pid, PidHealth* health);
+
+		STDMETHODIMP NetworkSetDestination(int handle, wchar_t* address, int port, BOOL rtp);
+		STDMETHODIMP NetworkSetPmtPid(int handle, int pmtPid, int serviceId, byte* pmtData, int pmtLength);
+		STDMETHODIMP NetworkStart(int handle);
+		STDMETHODIMP NetworkStop(int handle);
+		STDMETHODIMP NetworkGetCounters(int handle, int* datagramsSent, int* datagramsDropped);
+
+		STDMETHODIMP GetChannelQueueCounters(int handle, int* queuedPackets, int* maxQueuedPackets, int* droppedPackets, int* maxLatencyMs);
+
     CMpTs(LPUNKNOWN pUnk, HRESULT *phr);
     ~CMpTs();
     static CUnknown * WINAPI CreateInstance(LPUNKNOWN punk, HRESULT *phr);
 		void AnalyzeTsPacket(byte* tsPacket);
+		void FlushTsPackets();
 
 private:
     // Overriden to say what interfaces we support where
@@ -227,6 +259,7 @@ private:
 		FileWriter* m_rawPaketWriter;
 		bool b_dumpRawPakets;
 		CChannelLinkageScanner* m_pChannelLinkageScanner;
+		CStreamHealthMonitor* m_pHealthMonitor;
 		vector<CTsChannel*> m_vecChannels;
     typedef vector<CTsChannel*>::iterator ivecChannels;
 		int m_id;
@@ -133,7 +133,7 @@ STDMETHODIMP CVideoAnalyzer::Reset()
 	return S_OK;
 }
 
-void CVideoAnalyzer::OnTsPacket(byte* tsPacket)
+void CVideoAnalyzer::OnTsPacket(const TsPacketView& packet)
 {
-	m_videoAudioAnalyzer.OnTsPacket(tsPacket);
+	m_videoAudioAnalyzer.OnTsPacket(packet);
 }
@@ -55,7 +55,7 @@ public:
 	STDMETHODIMP IsVideoEncrypted( int* yesNo);
 	STDMETHODIMP IsAudioEncrypted( int* yesNo);
 	STDMETHODIMP Reset();
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
 protected:
 	CVideoAudioScrambledAnalyzer m_videoAudioAnalyzer;
 };
@@ -75,16 +75,13 @@ void CVideoAudioScrambledAnalyzer::Reset()
 	m_bAudioEncrypted=Unknown;
 }
 
-void CVideoAudioScrambledAnalyzer::OnTsPacket(byte* tsPacket)
+void CVideoAudioScrambledAnalyzer::OnTsPacket(const TsPacketView& packet)
 {
-  int pid=((tsPacket[1] & 0x1F) <<8)+tsPacket[2];
-  if (pid!=m_videoPid && pid!=m_audioPid) return;
+  if (packet.Pid!=m_videoPid && packet.Pid!=m_audioPid) return;
 
-	m_tsheader.Decode(tsPacket);
-	if (m_tsheader.SyncByte != TS_PACKET_SYNC) return;
-	if (m_tsheader.TransportError==true) return;
-	BOOL scrambled= (m_tsheader.TScrambling!=0);
-	if (m_tsheader.Pid==m_audioPid && m_audioPid > 0x10) 
+	if (packet.TransportError) return;
+	BOOL scrambled= (packet.TScrambling!=0);
+	if (packet.Pid==m_audioPid && m_audioPid > 0x10) 
 	{
     enum ScrambleState newState;
     if (scrambled)
@@ -98,7 +95,7 @@ void CVideoAudioScrambledAnalyzer::OnTsPacket(byte* tsPacket)
     }
 	}
 
-	if (m_tsheader.Pid==m_videoPid && m_videoPid > 0x10) 
+	if (packet.Pid==m_videoPid && m_videoPid > 0x10) 
 	{
     enum ScrambleState newState;
     if (scrambled)
@@ -20,7 +20,7 @@
  */
 #pragma once
 
-#include "..\..\shared\TsHeader.h"
+#include "..\..\shared\TsPacketView.h"
 class CVideoAudioScrambledAnalyzer
 {
 public:
@@ -43,7 +43,7 @@ public:
 	bool IsVideoScrambled();
 
 	void Reset();
-	void OnTsPacket(byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
 
 private:
   void Dump(bool audio, bool video);
@@ -51,5 +51,4 @@ private:
 	int m_audioPid;
 	enum ScrambleState m_bAudioEncrypted;
 	enum ScrambleState m_bVideoEncrypted;
-  CTsHeader  m_tsheader;
 };
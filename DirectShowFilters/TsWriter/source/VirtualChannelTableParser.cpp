@@ -57,11 +57,19 @@ void CVirtualChannelTableParser::Reset()
   m_vecChannels.clear();
   m_iVctVersionC8=-1;
   m_iVctVersionC9=-1;
+  m_tracker.Reset();
 }
 
-void CVirtualChannelTableParser::OnTsPacket(byte* tsPacket)
+//returns true once all sections of the terrestrial or the cable VCT are in
+bool CVirtualChannelTableParser::IsComplete()
 {
-	m_decoder->OnTsPacket(tsPacket);
+  return ((m_tracker.HasTable(0xC8) && m_tracker.IsComplete(0xC8)) ||
+          (m_tracker.HasTable(0xC9) && m_tracker.IsComplete(0xC9)));
+}
+
+void CVirtualChannelTableParser::OnTsPacket(const TsPacketView& packet)
+{
+	m_decoder->OnTsPacket(packet);
 }
 
 int CVirtualChannelTableParser::Count()
@@ -92,6 +100,7 @@ bool CVirtualChannelTableParser::GetChannelInfo(int serviceId,CChannelInfo& info
 void CVirtualChannelTableParser::OnNewSection(int pid, int tableId, CSection& newSection)
 {
 	if (tableId!=0xC8 && tableId!=0xC9) return;
+	m_tracker.OnSection(newSection);
 
   byte* buf=newSection.Data;
   
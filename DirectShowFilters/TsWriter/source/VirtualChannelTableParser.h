@@ -23,6 +23,7 @@
 #include "..\..\shared\channelinfo.h"
 #include "..\..\shared\pidtable.h"
 #include "..\..\shared\tsHeader.h"
+#include "SectionTracker.h"
 #include <vector>
 using namespace std;
 
@@ -46,8 +47,9 @@ public:
   int   Count();
   bool  GetChannelInfo(int serviceId,CChannelInfo& info);
 	bool  GetChannel(int index,CChannelInfo& info);
-  void  OnTsPacket(byte* tsPacket);
+  void  OnTsPacket(const TsPacketView& packet);
   void SetCallback(IAtscCallback* callback);
+  bool IsComplete();
 private:
   void DecodeServiceLocationDescriptor( byte* buf,int start,CChannelInfo& channelInfo);
   void DecodeExtendedChannelNameDescriptor( byte* buf,int start,CChannelInfo& channelInfo, int maxLen);
@@ -59,4 +61,5 @@ private:
   CSectionDecoder* m_decoder;
   IAtscCallback* m_pCallback;
   CTsHeader             m_tsHeader;
+  CSectionTracker       m_tracker;
 };
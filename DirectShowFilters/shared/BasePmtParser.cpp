@@ -69,6 +69,12 @@ void CBasePmtParser::OnTsPacket(byte* tsPacket)
 	CSectionDecoder::OnTsPacket(tsPacket);
 }
 
+void CBasePmtParser::OnTsPacket(const TsPacketView& packet)
+{
+	if (m_isFound) return;
+	CSectionDecoder::OnTsPacket(packet);
+}
+
 // implement in derived classes.
 void CBasePmtParser::PmtFoundCallback(){}
 void CBasePmtParser::PidsFoundCallback(){}
@@ -67,6 +67,7 @@ public:
   CBasePmtParser(void);
   virtual ~CBasePmtParser(void);
 	void    OnTsPacket(byte* tsPacket);
+	void    OnTsPacket(const TsPacketView& packet);
 	void		OnNewSection(CSection& sections);
   virtual void    PmtFoundCallback(); // implement in derived classes.
   virtual void    PidsFoundCallback();// implement in derived classes.
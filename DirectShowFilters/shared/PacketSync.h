@@ -23,6 +23,13 @@
 #define TS_PACKET_SYNC 0x47
 #define TS_PACKET_LEN  188
 
+#define SYNC_MAX_HYSTERESIS   8
+
+// Splits raw data into ts packets. Out of sync it searches for a position where
+// several sync bytes follow each other at packet distance (SSE2 if available), in
+// sync every packet is only passed on once the sync byte of the next one confirms
+// its length. Packets are handed over as runs of consecutive packets through
+// OnTsPackets(), which calls OnTsPacket() for each packet unless overridden.
 class CPacketSync
 {
 public:
@@ -32,9 +39,24 @@ public:
   virtual ~CPacketSync(void);
   void OnRawData(byte* pData, int nDataLen);
   virtual void OnTsPacket(byte* tsPacket);
+  virtual void OnTsPackets(byte* tsPackets, int count);
   void Reset(void);
+  // lockPackets sync bytes in a row are needed to get in sync (2..8, default 2),
+  // unlockPackets missing sync bytes in a row drop it (1..8, default 1)
+  void SetSyncHysteresis(int lockPackets, int unlockPackets);
 
 private:
-  byte  m_tempBuffer[200];
+  int   Parse(byte* pData, int pos, int nDataLen, int limit);
+  int   FindSync(byte* pData, int pos, int end);
+  void  Emit(byte* pData, int pos);
+  void  FlushRun(byte* pData);
+
+  // the unparsed end of the last call followed by the start of the current one
+  byte  m_tempBuffer[2*(SYNC_MAX_HYSTERESIS+1)*TS_PACKET_LEN];
   int   m_tempBufferPos;
+  bool  m_bLocked;
+  int   m_iLockPackets;
+  int   m_iUnlockPackets;
+  int   m_iRunStart;
+  int   m_iRunCount;
 };
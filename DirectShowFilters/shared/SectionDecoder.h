@@ -23,6 +23,7 @@
 #include "dvbutil.h"
 #include "Section.h"
 #include "TsHeader.h"
+#include "TsPacketView.h"
 
 #define MAX_SECTIONS 256
 
@@ -34,6 +35,7 @@ public:
 	void SetCallBack(ISectionCallback* callback);
 	void OnTsPacket(byte* tsPacket);
 	void OnTsPacket(CTsHeader& header,byte* tsPacket);
+	void OnTsPacket(const TsPacketView& packet);
   void SetPid(int pid);
   int  GetPid();
 	void Reset();
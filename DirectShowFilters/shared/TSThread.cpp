@@ -44,24 +44,26 @@ void TSThreadThreadProc(void *pParam)
 TSThread::TSThread()
 {
 	m_hStopEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
-	m_hDoneEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
 	m_threadHandle = INVALID_HANDLE_VALUE;
 }
 
 TSThread::~TSThread()
 {
-	StopThread();
+	StopThread(INFINITE);
 	CloseHandle(m_hStopEvent);
-	CloseHandle(m_hDoneEvent);
 }
 
 HRESULT TSThread::StartThread()
 {
+	if (m_threadHandle != INVALID_HANDLE_VALUE)
+		return S_FALSE;
+
 	ResetEvent(m_hStopEvent);
-	unsigned long m_threadHandle = _beginthread(&TSThread::thread_function, 0, (void *) this);
-	if (m_threadHandle == (unsigned long)INVALID_HANDLE_VALUE)
+	uintptr_t handle = _beginthreadex(NULL, 0, &TSThread::thread_function, (void *) this, 0, NULL);
+	if (handle == 0)
 		return E_FAIL;
 
+	m_threadHandle = (HANDLE)handle;
 	return S_OK;
 }
 
@@ -70,13 +72,16 @@ HRESULT TSThread::StopThread(DWORD dwTimeoutMilliseconds)
 	HRESULT hr = S_OK;
 
 	SetEvent(m_hStopEvent);
-	DWORD result = WaitForSingleObject(m_hDoneEvent, dwTimeoutMilliseconds);
+	if (m_threadHandle == INVALID_HANDLE_VALUE)
+		return hr;
+
+	// the thread handle is only signalled once ThreadProc() has returned, so the
+	// object can't go away while the thread is still using it
+	DWORD result = WaitForSingleObject(m_threadHandle, dwTimeoutMilliseconds);
 
-	if ((result == WAIT_TIMEOUT) && (m_threadHandle != INVALID_HANDLE_VALUE))
+	if (result == WAIT_TIMEOUT)
 	{
-		TerminateThread(m_threadHandle, -1);
-		CloseHandle(m_threadHandle);
-		hr = S_FALSE;
+		return S_FALSE;
 	}
 	else if (result != WAIT_OBJECT_0)
 	{
@@ -84,6 +89,7 @@ HRESULT TSThread::StopThread(DWORD dwTimeoutMilliseconds)
 		return HRESULT_FROM_WIN32(err);
 	}
 
+	CloseHandle(m_threadHandle);
 	m_threadHandle = INVALID_HANDLE_VALUE;
 
 	return hr;
@@ -97,7 +103,6 @@ BOOL TSThread::ThreadIsStopping(DWORD dwTimeoutMilliseconds)
 
 void TSThread::InternalThreadProc()
 {
-	ResetEvent(m_hDoneEvent);
 	try
 	{
 		ThreadProc();
@@ -106,11 +111,11 @@ void TSThread::InternalThreadProc()
 	{
 		pStr = NULL;
 	}
-	SetEvent(m_hDoneEvent);
 }
 
- void __cdecl TSThread::thread_function(void* p)
+unsigned __stdcall TSThread::thread_function(void* p)
 {
 	TSThread *thread = reinterpret_cast<TSThread *>(p);
 	thread->InternalThreadProc();
+	return 0;
 }
@@ -35,6 +35,8 @@ public:
 
 	virtual void ThreadProc() = 0;
 	HRESULT StartThread();
+	// Waits for ThreadProc() to return. A thread that doesn't stop in time keeps
+	// running and S_FALSE is returned, call StopThread() again before deleting it.
 	HRESULT StopThread(DWORD dwTimeoutMilliseconds = 1000);
 
 	BOOL ThreadIsStopping(DWORD dwTimeoutMilliseconds = 10);
@@ -43,10 +45,9 @@ protected:
 	void InternalThreadProc();
 
 private:
-	HANDLE m_hDoneEvent;
 	HANDLE m_hStopEvent;
 	HANDLE m_threadHandle;
-	static  void __cdecl thread_function(void* p);
+	static unsigned __stdcall thread_function(void* p);
 };
 
 #endif
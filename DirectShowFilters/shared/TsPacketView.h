@@ -0,0 +1,84 @@
+/* 
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+
+// The 4 byte header of a ts packet, decoded once when the packet comes in and
+// handed to every listener. Plain data, copying it is cheap. The adaption field
+// is only looked at when one of its accessors is called.
+// The fields mean the same as in CTsHeader, a packet without sync byte has
+// TransportError set.
+struct TsPacketView
+{
+	byte*          Data;
+	unsigned short Pid;
+	bool           TransportError;
+	bool           PayloadUnitStart;
+	bool           HasAdaptionField;
+	bool           HasPayload;
+	BYTE           TScrambling;
+	BYTE           ContinuityCounter;
+
+	TsPacketView(byte* tsPacket)
+	{
+		Data=tsPacket;
+		Pid=((tsPacket[1] & 0x1F) <<8)+tsPacket[2];
+		TransportError=(tsPacket[0]!=0x47) || ((tsPacket[1] & 0x80)!=0);
+		HasAdaptionField=((tsPacket[3] & 0x20)==0x20);
+		HasPayload=((tsPacket[3] & 0x10)==0x10);
+		PayloadUnitStart=((tsPacket[1] & 0x40)!=0) && HasPayload;
+		TScrambling=tsPacket[3] & 0x80;
+		ContinuityCounter=tsPacket[3] & 0x0F;
+	}
+
+	bool AdaptionFieldOnly() const
+	{
+		return HasAdaptionField && !HasPayload;
+	}
+
+	BYTE AdaptionFieldLength() const
+	{
+		return HasAdaptionField ? Data[4] : 0;
+	}
+
+	BYTE PayLoadStart() const
+	{
+		// only if the payload starts in this packet
+		if (HasAdaptionField && 5+Data[4] < 188)
+			return 5+Data[4];
+		return 4;
+	}
+
+	bool Discontinuity() const
+	{
+		return (AdaptionFieldLength()>0 && (Data[5] & 0x80)!=0);
+	}
+
+	bool HasPcr() const
+	{
+		return (AdaptionFieldLength()>=7 && (Data[5] & 0x10)!=0);
+	}
+
+	// 33 bit base of the pcr, 90 kHz
+	UINT64 PcrBase() const
+	{
+		return ((UINT64)Data[6]<<25) | ((UINT64)Data[7]<<17) | ((UINT64)Data[8]<<9) | ((UINT64)Data[9]<<1) | ((UINT64)Data[10]>>7);
+	}
+};
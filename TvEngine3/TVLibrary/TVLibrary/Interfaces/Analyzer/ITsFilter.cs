@@ -23,6 +23,28 @@ using System.Runtime.InteropServices;
 
 namespace TvLibrary.Interfaces.Analyzer
 {
+  /// <summary>
+  /// Transport stream health counters of a single pid
+  /// </summary>
+  [StructLayout(LayoutKind.Sequential)]
+  public struct PidHealth
+  {
+    public long Packets;
+    public int ContinuityErrors;
+    public int TransportErrors;
+    public int Scrambled;
+    public int ScrambledPackets;
+    public int Bitrate;
+    public int AverageBitrate;
+    public int PcrCount;
+    public int PcrRepetitionErrors;
+    public int PcrDiscontinuities;
+    public int PcrMaxInterval;
+    public int PcrJitter;
+    public int TableRepetitionErrors;
+    public int TableMaxInterval;
+  } ;
+
   /// <summary>
   /// The main TsWriter interface
   /// </summary>
@@ -365,5 +387,115 @@ namespace TvLibrary.Interfaces.Analyzer
     /// <returns></returns>
     [PreserveSig]
     int TimeShiftSetChannelType(int handle, int channelType);
+
+    /// <summary>
+    /// Sets the callback which is called when a teletext page of the given sub channel has changed
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="callback">The callback</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int TTxSetPageCallBack(int handle, ITeletextPageCallBack callback);
+
+    /// <summary>
+    /// Copies a received teletext page of the given sub channel into pageData (2100 bytes)
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="pageNumber">The page number</param>
+    /// <param name="subPageNumber">The sub page number</param>
+    /// <param name="pageData">The page data</param>
+    /// <returns>S_OK, or S_FALSE if the page hasn't been received</returns>
+    [PreserveSig]
+    int TTxGetPage(int handle, int pageNumber, int subPageNumber, IntPtr pageData);
+
+    /// <summary>
+    /// Resets the transport stream health counters of all pids
+    /// </summary>
+    /// <returns></returns>
+    [PreserveSig]
+    int HealthReset();
+
+    /// <summary>
+    /// Gets the pids seen since the last reset
+    /// </summary>
+    /// <param name="pids">Receives up to maxCount pids</param>
+    /// <param name="maxCount">Size of pids</param>
+    /// <param name="count">Number of pids seen, may exceed maxCount</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int HealthGetPids([Out, MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 1)] int[] pids, int maxCount, out int count);
+
+    /// <summary>
+    /// Gets the transport stream health counters of a pid
+    /// </summary>
+    /// <param name="pid">The pid</param>
+    /// <param name="health">The counters</param>
+    /// <returns>S_OK, or S_FALSE if the pid wasn't seen</returns>
+    [PreserveSig]
+    int HealthGetPid(int pid, out PidHealth health);
+
+    /// <summary>
+    /// Sets the udp destination the sub channel is streamed to
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="address">Unicast or multicast ip address</param>
+    /// <param name="port">Udp port</param>
+    /// <param name="rtp">true to send rtp, false for plain udp</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int NetworkSetDestination(int handle, [In, MarshalAs(UnmanagedType.LPWStr)] string address, int port,
+                              [MarshalAs(UnmanagedType.Bool)] bool rtp);
+
+    /// <summary>
+    /// Sets the pmt pid for streaming the sub channel
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="pmtPid">The PMT pid</param>
+    /// <param name="serviceId">The service id</param>
+    /// <param name="pmtData">The PMT data</param>
+    /// <param name="pmtLength">The length of the PMT</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int NetworkSetPmtPid(int handle, int pmtPid, int serviceId, [In, MarshalAs(UnmanagedType.LPArray)] byte[] pmtData,
+                         int pmtLength);
+
+    /// <summary>
+    /// Starts streaming the sub channel, paced by its pcrs
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int NetworkStart(int handle);
+
+    /// <summary>
+    /// Stops streaming the sub channel
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int NetworkStop(int handle);
+
+    /// <summary>
+    /// Gets the datagram counters of the stream
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="datagramsSent">Datagrams sent since the start</param>
+    /// <param name="datagramsDropped">Datagrams dropped because the sender couldn't keep up</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int NetworkGetCounters(int handle, out int datagramsSent, out int datagramsDropped);
+
+    /// <summary>
+    /// Gets the counters of the queue between the streaming thread and the worker of the sub channel
+    /// </summary>
+    /// <param name="handle">Handle of the sub channel</param>
+    /// <param name="queuedPackets">Packets waiting for the worker</param>
+    /// <param name="maxQueuedPackets">Most packets waiting since the last call</param>
+    /// <param name="droppedPackets">Packets dropped because the queue was full</param>
+    /// <param name="maxLatencyMs">Longest time a packet waited since the last call</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int GetChannelQueueCounters(int handle, out int queuedPackets, out int maxQueuedPackets, out int droppedPackets,
+                                out int maxLatencyMs);
   }
 }
\ No newline at end of file
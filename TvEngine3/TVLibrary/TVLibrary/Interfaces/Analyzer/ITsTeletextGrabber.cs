@@ -41,6 +41,25 @@ namespace TvLibrary.Interfaces.Analyzer
     int OnTeletextReceived(IntPtr data, short packetCount);
   } ;
 
+  /// <summary>
+  /// Interface to the Teletext page callback
+  /// </summary>
+  [ComVisible(true), ComImport,
+   Guid("1B9E218A-23B3-47e8-AEF1-B226C7B3C358"),
+   InterfaceType(ComInterfaceType.InterfaceIsIUnknown)]
+  public interface ITeletextPageCallBack
+  {
+    /// <summary>
+    /// Called when a page has been received whose content differs from the cached copy.
+    /// </summary>
+    /// <param name="pageNumber">The page number (0x100-0x8ff).</param>
+    /// <param name="subPageNumber">The sub page number.</param>
+    /// <param name="isSubtitle">true for subtitle pages.</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int OnTeletextPageChanged(int pageNumber, int subPageNumber, [MarshalAs(UnmanagedType.Bool)] bool isSubtitle);
+  } ;
+
   /// <summary>
   /// Interface to the Teletext grabber com object
   /// </summary>
@@ -78,5 +97,23 @@ namespace TvLibrary.Interfaces.Analyzer
     /// <returns></returns>
     [PreserveSig]
     int SetCallBack(ITeletextCallBack callback);
+
+    /// <summary>
+    /// Sets the call back which will be called when a teletext page has changed.
+    /// </summary>
+    /// <param name="callback">The callback.</param>
+    /// <returns></returns>
+    [PreserveSig]
+    int SetPageCallBack(ITeletextPageCallBack callback);
+
+    /// <summary>
+    /// Copies a received page into pageData, which must hold 2100 bytes (50 rows of 42 bytes).
+    /// </summary>
+    /// <param name="pageNumber">The page number.</param>
+    /// <param name="subPageNumber">The sub page number.</param>
+    /// <param name="pageData">The page data.</param>
+    /// <returns>S_OK, or S_FALSE if the page hasn't been received</returns>
+    [PreserveSig]
+    int GetPage(int pageNumber, int subPageNumber, IntPtr pageData);
   }
 }
\ No newline at end of file
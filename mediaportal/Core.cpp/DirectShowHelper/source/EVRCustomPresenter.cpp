@@ -69,15 +69,9 @@ MPEVRCustomPresenter::MPEVRCustomPresenter(IVMR9Callback* pCallback, IDirect3DDe
   m_dMaxBias(1.1),
   m_dMinBias(0.9),
   m_bBiasAdjustmentDone(false),
-  m_dVariableFreq(1.0),
   m_dPreviousVariableFreq(1.0),
-  m_iClockAdjustmentsDone(0),
-  m_nNextPhDev(0),
-  m_avPhaseDiff(0.0),
-  m_sumPhaseDiff(0.0)
+  m_iClockAdjustmentsDone(0)
 {
-  ZeroMemory((void*)&m_dPhaseDeviations, sizeof(double) * NUM_PHASE_DEVIATIONS);
-
   timeBeginPeriod(1);
   if (m_pMFCreateVideoSampleFromSurface != NULL)
   {
@@ -111,9 +105,6 @@ MPEVRCustomPresenter::MPEVRCustomPresenter(IVMR9Callback* pCallback, IDirect3DDe
     m_bSchedulerRunning        = FALSE;
     m_fRate                    = 1.0f;
     m_iFreeSamples             = 0;
-    m_nNextJitter              = 0;
-    m_llLastPerf               = 0;
-    m_fAvrFps                  = 0.0;
     m_rtTimePerFrame           = 0;
     m_llLastWorkerNotification = 0;
     m_bFrameSkipping           = true;
@@ -121,19 +112,15 @@ MPEVRCustomPresenter::MPEVRCustomPresenter(IVMR9Callback* pCallback, IDirect3DDe
     m_bScrubbing               = false;
     m_bZeroScrub               = false;
     m_fSeekRate                = m_fRate;
-    memset(m_pllJitter,           0, sizeof(m_pllJitter));
     memset(m_pllSyncOffset,       0, sizeof(m_pllSyncOffset));
-    memset(m_pllRasterSyncOffset, 0, sizeof(m_pllRasterSyncOffset));
 
     m_nNextSyncOffset       = 0;
-    m_fJitterStdDev          = 0.0;
     m_fSyncOffsetStdDev     = 0.0;
     m_fSyncOffsetAvr        = 0.0;
     m_dD3DRefreshRate       = 0.0;
     m_dD3DRefreshCycle      = 0.0;
     m_dOptimumDisplayCycle  = 0.0;
     m_dCycleDifference      = 0.0;
-    m_uSyncGlitches         = 0;
     m_rasterSyncOffset      = 0;
     m_dDetectedScanlineTime = 0.0;
     m_dEstRefreshCycle      = 0.0;
@@ -143,12 +130,6 @@ MPEVRCustomPresenter::MPEVRCustomPresenter(IVMR9Callback* pCallback, IDirect3DDe
 
     // sample time correction variables
     m_LastScheduledUncorrectedSampleTime  = -1;
-    m_DetectedFrameTimePos                = 0;
-    m_DectedSum                           = 0;
-    m_DetectedFrameTime                   = -1.0;
-    m_DetFrameTimeAve                     = -1.0;
-    m_DetectedLock                        = false;
-    m_DetectedFrameTimeStdDev             = 0;
     m_LastEndOfPaintScanline       = 0;
     m_LastStartOfPaintScanline     = 0;
     m_frameRateRatio              = 0;
@@ -1160,8 +1141,7 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
   HRESULT hr = S_OK;
   LOG_TRACE("Checking for scheduled sample (size: %d)", m_qScheduledSamples.Count());
   LONGLONG displayTime = (LONGLONG)(GetDisplayCycle() * 10000); // display cycle in hns
-  LONGLONG hystersisTime = min(50000, displayTime/4) ;
-  LONGLONG delErrLimit = displayTime ;
+  LONGLONG hystersisTime = LateFrameHysteresis(displayTime);
   LONGLONG delErr = 0;
   LONGLONG nextSampleTime = 0;
   LONGLONG systemTime = 0;
@@ -1169,9 +1149,9 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
   LONGLONG earlyLimit = hystersisTime;
 
   LONGLONG frameTime = m_rtTimePerFrame;
-  if (m_DetectedFrameTime > DFT_THRESH)
+  if (m_frameTimeDetector.m_DetectedFrameTime > DFT_THRESH)
   {
-    frameTime = (LONGLONG)(m_DetectedFrameTime * 10000000.0);
+    frameTime = (LONGLONG)(m_frameTimeDetector.m_DetectedFrameTime * 10000000.0);
   }
 
   // Allow 'hystersisTime' late or early frames to avoid synchronised judder problems. 
@@ -1184,7 +1164,7 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
       PauseThread(m_hWorker, &m_workerParams);
       Flush(FALSE);
       WakeThread(m_hWorker, &m_workerParams);
-      m_iLateFrames = 0;
+      m_lateFrames.m_iLateFrames = 0;
       *pTargetTime = 0;
       m_earliestPresentTime = 0;
       return S_OK;
@@ -1204,7 +1184,7 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
     // don't process frame in paused mode during normal playback
     if (m_state == MP_RENDER_STATE_PAUSED && !m_bDVDMenu) 
     {
-      m_iLateFrames = 0;
+      m_lateFrames.m_iLateFrames = 0;
       *pTargetTime = 0;
       m_earliestPresentTime = 0;
       break;
@@ -1242,48 +1222,15 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
     *pTargetTime = 0;      
         
     //De-sensitise frame dropping to avoid occasional delay glitches triggering frame drops
-    if ((m_frameRateRatio > 0) && !m_bDVDMenu && !m_bScrubbing)
-    {
-      if (m_iLateFrames > 0)
-      {
-        if (m_iLateFrames >= LF_THRESH)
-        {
-          lateLimit = delErrLimit; //more contiguous late frames are allowed
-          delErr = delErrLimit;
-        }
-        else
-        {
-          lateLimit = hystersisTime;
-          delErr = 0;
-        }
-      }
-      else if ( (nextSampleTime < -(hystersisTime - 5000)) || (delErr < -(hystersisTime - 5000)) )
-      {
-        m_iLateFrames = LF_THRESH_HIGH;
-        m_iFramesHeld++;
-        lateLimit = delErrLimit; // Allow this late frame
-        delErr = delErrLimit;
-      }
-      else
-      {
-        lateLimit = hystersisTime;
-        delErr = 0;
-      }
-    }
-    else
-    {
-      lateLimit = hystersisTime;
-      delErr = 0;
-      m_iLateFrames = 0;
-    }
+    lateLimit = m_lateFrames.LateLimit(nextSampleTime, &delErr, displayTime, (m_frameRateRatio > 0) && !m_bDVDMenu && !m_bScrubbing);
 
     // nextSampleTime == 0 means there is no valid presentation time, so we present it immediately without vsync correction
     // When scrubbing always display at least every eighth frame - even if it's late
     if ( (nextSampleTime >= -lateLimit) || m_bDVDMenu || !m_bFrameSkipping || (m_bScrubbing && !(m_iFramesProcessed % 8)) || m_bZeroScrub )
     {   
-      if (m_iLateFrames > 0)
+      if (m_lateFrames.m_iLateFrames > 0)
       {
-        LOG_LATEFR("Late frame (present), sampTime %.2f ms, last sleep %.2f, LFr %d",(double)nextSampleTime/10000, (double)lastSleepTime/10000, m_iLateFrames) ;
+        LOG_LATEFR("Late frame (present), sampTime %.2f ms, last sleep %.2f, LFr %d",(double)nextSampleTime/10000, (double)lastSleepTime/10000, m_lateFrames.m_iLateFrames) ;
       }
       GetFrameRateRatio(); // update video to display FPS ratio data
       // Within the time window to 'present' a sample, or it's a special play mode
@@ -1327,9 +1274,9 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
         if (nextSampleTime > (frameTime + earlyLimit))
         {      
           // It's too early to present sample, so delay for a while
-          if (m_iLateFrames > 0)
+          if (m_lateFrames.m_iLateFrames > 0)
           {
-            LOG_LATEFR("Late frame (stall), sampTime %.2f ms, last sleep %.2f, LFr %d",(double)nextSampleTime/10000, (double)lastSleepTime/10000, m_iLateFrames) ;
+            LOG_LATEFR("Late frame (stall), sampTime %.2f ms, last sleep %.2f, LFr %d",(double)nextSampleTime/10000, (double)lastSleepTime/10000, m_lateFrames.m_iLateFrames) ;
           }
           
           m_stallTime = m_earliestPresentTime - systemTime;
@@ -1365,10 +1312,7 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
         LOG_TRACE("Sample Latency: %I64d", sampleLatency);
       }
       
-      if (m_iLateFrames > 0)
-      {
-        m_iLateFrames--;
-      }
+      m_lateFrames.FrameDone();
 
       if (m_pAVSyncClock) //Update phase deviation data for MP Audio Renderer
       {
@@ -1432,17 +1376,14 @@ HRESULT MPEVRCustomPresenter::CheckForScheduledSample(LONGLONG *pTargetTime, LON
              m_qScheduledSamples.Count(),
              m_LastStartOfPaintScanline,
              m_LastEndOfPaintScanline,
-             m_iLateFrames,
+             m_lateFrames.m_iLateFrames,
              m_rawFRRatio,
              m_iFramesDropped,
              m_iFramesDrawn
              );
       }
            
-      if (m_iLateFrames > 0)
-      {
-        m_iLateFrames--;
-      }
+      m_lateFrames.FrameDone();
       Sleep(1); //Just to be friendly to other threads
     }
     
@@ -2226,14 +2167,14 @@ HRESULT MPEVRCustomPresenter::Paint(CComPtr<IDirect3DSurface9> pSurface)
     if (m_bDrawStats) // no point in wasting CPU time if we aren't displaying the stats
     {
       //update the video and display timing values
-      CalculateRealFramePeriod(startPaint); // update real frame rate average
+      m_framePeriodStats.Add(startPaint, m_frameTimeDetector.m_DetectedFrameTime, m_bDrawStats); // update real frame rate average
   
       m_PaintTimeMin = min(m_PaintTimeMin, m_PaintTime);
       m_PaintTimeMax = max(m_PaintTimeMax, m_PaintTime);
   
       OnVBlankFinished(true, startPaint, GetCurrentTimestamp());
   
-      CalculateJitter(startPaint);
+      m_jitterStats.Add(startPaint, m_rasterSyncOffset, GetDisplayCycle(), m_iFramesDrawn > NB_JITTER);
     }
 
     if (m_bResetStats)
@@ -2283,14 +2224,14 @@ HRESULT STDMETHODCALLTYPE MPEVRCustomPresenter::get_FramesDrawn(int *pcFramesDra
 
 HRESULT STDMETHODCALLTYPE MPEVRCustomPresenter::get_AvgFrameRate(int *piAvgFrameRate)
 {
-  *piAvgFrameRate = (int)(m_fAvrFps*100);
+  *piAvgFrameRate = (int)(m_jitterStats.m_fAvrFps*100);
   return S_OK;
 }
 
 
 HRESULT STDMETHODCALLTYPE MPEVRCustomPresenter::get_Jitter(int *iJitter)
 {
-  *iJitter = (int)((m_fJitterStdDev/10000.0) + 0.5);
+  *iJitter = (int)((m_jitterStats.m_fJitterStdDev/10000.0) + 0.5);
   return S_OK;
 }
 
@@ -2481,65 +2422,36 @@ HRESULT STDMETHODCALLTYPE MPEVRCustomPresenter::MapOutputCoordinateToInputStream
   return S_OK;
 }
 
-double LinearRegression(double *x, double *y, int n, double *pSlope, double *pIntercept)
+// Feeds the pacing engine with the raster status of the presenter's device
+class D3DPacingSource : public IPacingSource
 {
-  int i;
-  double sigmaXY = 0;
-  double sigmaX2 = 0;
-  double sigmaX = 0;
-  double sigmaY = 0;
-  double sigmaY2 = 0;
+public:
+  D3DPacingSource(IDirect3DDevice9* pD3DDev) : m_pD3DDev(pD3DDev) {}
 
-  for(i = 0; i < n; i++)
+  virtual long long GetTime()
   {
-    sigmaXY += (*x) * (*y);
-    sigmaX2 += (*x) * (*x);
-    sigmaY2 += (*y) * (*y);
-    sigmaX += *x++;
-    sigmaY += *y++;
+    return GetCurrentTimestamp();
   }
 
-  *pSlope = (n * sigmaXY - sigmaX * sigmaY) / (n * sigmaX2 - sigmaX * sigmaX);
-  *pIntercept = (sigmaY - *pSlope * sigmaX) / n;
-  return (n * sigmaXY - sigmaX * sigmaY) / sqrt((n * sigmaX2 - sigmaX * sigmaX) * (n * sigmaY2 - sigmaY * sigmaY));
-}
-
-int MPEVRCustomPresenter::MeasureScanLines(LONGLONG startTime, double *times, double *scanLines, int n)
-{
-  D3DRASTER_STATUS rasterStatus;
-  int line = -1;
-  for (int i = 0; i < n; i++)
+  virtual bool GetScanLine(unsigned int* pScanLine)
   {
-    do
+    D3DRASTER_STATUS rasterStatus;
+    if (FAILED(m_pD3DDev->GetRasterStatus(0, &rasterStatus)))
     {
-      times[i] = (double)(GetCurrentTimestamp() - startTime);
-      m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-      scanLines[i] = (double)rasterStatus.ScanLine;
-    } while (line == rasterStatus.ScanLine);
-
-    if (line > (int)m_maxScanLine) 
-      m_maxScanLine = (UINT)line;
-
-    if ((int)rasterStatus.ScanLine < line)
-      return i;
-      
-    line = rasterStatus.ScanLine;
+      return false;
+    }
+    *pScanLine = rasterStatus.ScanLine;
+    return true;
   }
 
-  //Looping wait until next vsync
-  Log("MeasureScanLines: wait for vsync: scanline: %d", line);
-  while ((int)rasterStatus.ScanLine >= line) 
+  virtual void Log(const char* text)
   {
-    line = rasterStatus.ScanLine;
-    
-    if (line > (int)m_maxScanLine) 
-      m_maxScanLine = (UINT)line;
-      
-    m_pD3DDev->GetRasterStatus(0, &rasterStatus);
+    ::Log("%s", text);
   }
-    
-  return n;
-}
+
+private:
+  IDirect3DDevice9* m_pD3DDev;
+};
 
 BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
 {
@@ -2551,17 +2463,6 @@ BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
 
     m_pD3DDev->GetDisplayMode(0, &m_displayMode); //update this just in case anything has changed...
     
-    D3DRASTER_STATUS rasterStatus;
-
-    LONGLONG startTime = 0;
-    LONGLONG startTimeLR = 0;
-    LONGLONG endTime = 0;
-    UINT line = 0;
-    UINT startLine = 0;
-    UINT endLine = 0;
-    double AllowedError = 0.0;
-    double currError = 0.0;
-    
     // Estimate the display refresh rate from the vsyncs
     
     int priority = GetThreadPriority(GetCurrentThread());
@@ -2570,75 +2471,9 @@ BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
       SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
     }
 
-    m_maxScanLine    = 0;
-    m_minVisScanLine = m_displayMode.Height;
-    m_maxVisScanLine = 0;
-    const int maxScanLineSamples = 1000;
-    const int maxFrameSamples = 8;
-    double times[maxScanLineSamples*2];
-    double scanLines[maxScanLineSamples*2];
-    struct {
-      double slope;
-      double intercept;
-      double fit;
-    }   coeff[maxFrameSamples];
-    int sampleCount;
-
-    double estRefreshCyc [maxFrameSamples];
-    double sumRefCyc = 0.0;
-    double aveRefCyc = 0.0;
-
-    //Wait for vsync
-    line = 0;
-    m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-    while (rasterStatus.ScanLine >= line) 
-    {
-      line = rasterStatus.ScanLine;
-      m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-      if (rasterStatus.ScanLine > m_maxScanLine) 
-      {
-        m_maxScanLine = rasterStatus.ScanLine;
-      }
-    }
-
-    Log("Starting frame loops: start scanline: %d", rasterStatus.ScanLine);
-
-    endTime = GetCurrentTimestamp();
-    startTimeLR = endTime;
-  
-    // Now we're at the start of a vsync
-    for (int i = 0; i < maxFrameSamples; i++)
-    {      
-      startTime = endTime;
-      //Skip over vertical blanking period
-      m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-      while (rasterStatus.ScanLine < 2)
-      {
-        m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-      } 
-      startLine = rasterStatus.ScanLine;
-      
-      if (startLine < m_minVisScanLine)
-        m_minVisScanLine = startLine;
-
-      // make a few measurements
-      Log("Starting Frame: %d, start scanline: %d", i, startLine);
-      sampleCount = MeasureScanLines(startTimeLR, times, scanLines, maxScanLineSamples);
-      // Now we're at the next vsync
-      m_pD3DDev->GetRasterStatus(0, &rasterStatus);
-      endLine = rasterStatus.ScanLine;
-      endTime = GetCurrentTimestamp();
-
-      Log("Ending Frame: %d, start scanline: %d, end scanline: %d, maxScanline: %d", i, startLine, endLine, m_maxScanLine);
-
-      estRefreshCyc[i] = (double)(endTime - startTime); // in hns units
-      sumRefCyc += estRefreshCyc[i];
-      
-      coeff[i].fit = LinearRegression(scanLines, times, sampleCount, &coeff[i].slope, &coeff[i].intercept);
-      Log("  samples = %d, slope = %.6f, intercept = %.6f, fit = %.6f", sampleCount, coeff[i].slope, coeff[i].intercept, coeff[i].fit);
-    }    
-
-    m_maxVisScanLine = m_maxScanLine;
+    D3DPacingSource source(m_pD3DDev);
+    RefreshTimings timings;
+    m_estRefreshLock = MeasureRefreshTimings(&source, m_displayMode.Height, &timings);
 
     // Restore thread priority
     if (priority != THREAD_PRIORITY_ERROR_RETURN)
@@ -2646,90 +2481,12 @@ BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
       SetThreadPriority(GetCurrentThread(), priority);
     }
 
-    //-----------------------------------------------------
-    // Calculate the simplistic refresh rate estimate
-    //-----------------------------------------------------
-
-    aveRefCyc = sumRefCyc / (double)maxFrameSamples;
-    
-    AllowedError = 0.0;
-    currError = 0.0;
-    int BadIdx0 = 0;
-    // Find worst match with average refresh period so it can be removed 
-    for (int i = 0; i < maxFrameSamples; ++i)
-    {
-      currError = fabs(1.0 - (aveRefCyc / estRefreshCyc[i]) );
-      if (currError > AllowedError)
-      {
-        AllowedError = currError;
-        BadIdx0 = i;
-      }
-    }
-    
-    sumRefCyc -= estRefreshCyc[BadIdx0];
-
-    aveRefCyc = sumRefCyc / (double)(maxFrameSamples - 1);
-    
-    AllowedError = 0.0;
-    currError = 0.0;
-    int BadIdx1 = 0;
-    // Find next worst match with new average refresh period so it can be removed 
-    for (int i = 0; i < maxFrameSamples; ++i)
-    {
-      currError = fabs(1.0 - (aveRefCyc / estRefreshCyc[i]) );
-      if ((currError > AllowedError) && (i != BadIdx0))
-      {
-        AllowedError = currError;
-        BadIdx1 = i;
-      }
-    }
-    sumRefCyc -= estRefreshCyc[BadIdx1];
-
-    double simpleFrameTime = sumRefCyc / (double)(maxFrameSamples - 2); // in hns units
-
-    //--------------------------------------------------------------
-    // Calculate the linear regression refresh rate estimate
-    //--------------------------------------------------------------
-    
-    // Find the best matching measurement and the minimum frame time
-    int bestFitIdx = 0;
-    double minFrameTime = DBL_MAX;
-    int frameCount = 0;
-
-    for (int i = 1; i < maxFrameSamples; i++)
-    {
-      if (coeff[i].fit > coeff[bestFitIdx].fit)
-        bestFitIdx = i;
-      if (minFrameTime > coeff[i].intercept - coeff[i-1].intercept)
-        minFrameTime = coeff[i].intercept - coeff[i-1].intercept;
-    }
-
-    // Find the number of frames measured
-    for (int i = 1; i < maxFrameSamples; i++)
-    {
-      frameCount += (int)floor((coeff[i].intercept - coeff[i-1].intercept)/minFrameTime + 0.5);
-    }
-    
-    Log("  frame count = %d", frameCount);
-    double scanLineTime = coeff[bestFitIdx].slope;
-    double frameTime = (coeff[maxFrameSamples-1].intercept - coeff[0].intercept)/frameCount;
-
-    //--------------------------------------------------------------
-    // Compare the two methods
-    //--------------------------------------------------------------
-
-    AllowedError = 0.05; //Allow 5.0% error
-
-    currError = fabs(1.0 - (simpleFrameTime / frameTime));
-    if (currError < AllowedError)
-    {
-      m_estRefreshLock = true;
-    }
-    m_dEstRefCycDiff = currError;
-
-    m_maxScanLine = ((UINT)(frameTime / scanLineTime)) - 1;    
-    m_dEstRefreshCycle = frameTime / 10000.0; // in milliseconds
-    m_dDetectedScanlineTime = scanLineTime / 10000.0; 
+    m_dEstRefCycDiff        = timings.cycleDiff;
+    m_maxScanLine           = timings.maxScanLine;
+    m_minVisScanLine        = timings.minVisScanLine;
+    m_maxVisScanLine        = timings.maxVisScanLine;
+    m_dEstRefreshCycle      = timings.refreshCycle; // in milliseconds
+    m_dDetectedScanlineTime = timings.scanlineTime;
 
     m_pD3DDev->GetDisplayMode(0, &m_displayMode); //update this just in case anything has changed...
     GetRealRefreshRate(); // update m_dD3DRefreshCycle and m_dD3DRefreshRate values
@@ -2745,7 +2502,6 @@ BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
       m_estRefreshLock = false;
     }
 
-    Log("Raw est display cycle, linReg: %.6f ms, simple: %.6f ms, diff: %.6f ", frameTime/10000.0, simpleFrameTime/10000.0, currError);
     Log("Measured display cycle: %.6f ms, locked: %d ", m_dEstRefreshCycle, m_estRefreshLock);
     Log("Measured scanline time: %.6f us", (m_dDetectedScanlineTime * 1000.0));
     Log("Display (from windows): %d x %d @ %.6f Hz | Measured refresh rate: %.6f Hz", m_displayMode.Width, m_displayMode.Height, m_dD3DRefreshRate, 1000.0/m_dEstRefreshCycle);
@@ -2754,69 +2510,15 @@ BOOL MPEVRCustomPresenter::EstimateRefreshTimings()
   }
   
   //Initialise vsync correction control values
-  m_rasterLimitLow   = (((m_maxVisScanLine - m_minVisScanLine) * 1)/8) + m_minVisScanLine; 
-  m_rasterTargetPosn = m_rasterLimitLow;
-  m_rasterLimitHigh  = (((m_maxVisScanLine - m_minVisScanLine) * 4)/8) + m_minVisScanLine;
-  m_rasterLimitTop   = (((m_maxVisScanLine - m_minVisScanLine) * 5)/8) + m_minVisScanLine;   
-  m_rasterLimitNP    = m_maxVisScanLine;   
+  m_rasterWindow.Init(m_minVisScanLine, m_maxVisScanLine);
 
-  Log("Vsync correction : rasterLimitHigh: %d, rasterLimitLow: %d, rasterTargetPosn: %d", m_rasterLimitHigh, m_rasterLimitLow, m_rasterTargetPosn);
+  Log("Vsync correction : rasterLimitHigh: %d, rasterLimitLow: %d, rasterTargetPosn: %d", m_rasterWindow.m_limitHigh, m_rasterWindow.m_limitLow, m_rasterWindow.m_targetPosn);
 
   return m_estRefreshLock;
 }
 
 
 
-// Update the array m_pllJitter with a new vsync period. Calculate min, max and stddev.
-void MPEVRCustomPresenter::CalculateJitter(LONGLONG PerfCounter)
-{
-  m_nNextJitter = (m_nNextJitter+1) % NB_JITTER;
-  m_pllJitter[m_nNextJitter] = PerfCounter - m_llLastPerf;
-  
-  m_pllRasterSyncOffset[m_nNextJitter] = m_rasterSyncOffset;
-
-  double syncDeviation = ((double)m_pllJitter[m_nNextJitter] - m_fJitterMean) / 10000.0;
-  
-  if (abs(syncDeviation) > (GetDisplayCycle() / 2))
-  {
-    // ignore glitches until enough data has been collected
-    if (m_iFramesDrawn > NB_JITTER)
-    {
-      m_uSyncGlitches++;
-    }
-  }
-
-  LONGLONG llJitterSum = 0;
-  LONGLONG llJitterSumAvg = 0;
-  for (int i = 0; i < NB_JITTER; i++)
-  {
-    LONGLONG Jitter = m_pllJitter[i];
-    llJitterSum += Jitter;
-    llJitterSumAvg += Jitter;
-  }
-  m_fJitterMean = double(llJitterSumAvg) / NB_JITTER;
-  double DeviationSum = 0;
-
-  for (int i = 0; i < NB_JITTER; i++)
-  {
-    LONGLONG DevInt = m_pllJitter[i] - (LONGLONG)m_fJitterMean;
-    double Deviation = (double)DevInt;
-
-    DeviationSum += Deviation*Deviation;
-    
-    if (m_iFramesDrawn > NB_JITTER)
-    {
-      m_MaxJitter = max(m_MaxJitter, DevInt);
-      m_MinJitter = min(m_MinJitter, DevInt);
-    }
-  }
-
-  m_fJitterStdDev = sqrt(DeviationSum/NB_JITTER);
-  m_fAvrFps = 10000000.0/(double(llJitterSum)/NB_JITTER);
-  m_llLastPerf = PerfCounter;
-}
-
-
 // Collect the difference between periodEnd and periodStart in an array, calculate mean and stddev.
 void MPEVRCustomPresenter::OnVBlankFinished(bool fAll, LONGLONG periodStart, LONGLONG periodEnd)
 {
@@ -2844,65 +2546,11 @@ void MPEVRCustomPresenter::OnVBlankFinished(bool fAll, LONGLONG periodStart, LON
   m_fSyncOffsetStdDev = StdDev;
 }
 
-// Update the array m_pllRFP with a new frame time stamp. Calculate mean and stddev.
-void MPEVRCustomPresenter::CalculateRealFramePeriod(LONGLONG timeStamp)
-{
-  LONGLONG rfpDiff = timeStamp - m_llLastRFPts;
-  if (rfpDiff < 0) rfpDiff = -rfpDiff;
-  m_llLastRFPts = timeStamp;
-  
-  if ( (rfpDiff <= (m_DetectedFrameTime * 11000000)) && 
-       (rfpDiff >= (m_DetectedFrameTime *  9000000)) && 
-       (m_DetectedFrameTime > DFT_THRESH) )   //ignore out-of-usable-range values
-  {
-    m_pllRFP[(m_nNextRFP % NB_RFPSIZE)] = rfpDiff;
-    m_nNextRFP++;
-  }
-  
-  LONGLONG llRFPSumAvg = 0;
-  int rfpFrames = NB_RFPSIZE;
-  if ((m_nNextRFP >= 10) && (m_nNextRFP < NB_RFPSIZE))
-  {
-    rfpFrames = m_nNextRFP;
-  }
-  
-  if (m_nNextRFP >= rfpFrames)
-  {
-    for (int i = 0; i < rfpFrames; i++)
-    {
-      llRFPSumAvg += m_pllRFP[i];
-    }
-  }
-  else
-  {
-    m_fRFPMean = (m_DetectedFrameTime * 10000000);
-    m_fRFPStdDev = 0.0;
-    return;
-  }
-  m_fRFPMean = double(llRFPSumAvg) / rfpFrames;
-
-  if (m_bDrawStats)
-  {
-    double DeviationSum = 0;
-    double Deviation    = 0;
-    for (int i = 0; i < rfpFrames; i++)
-    {
-      Deviation = (double) (m_pllRFP[i] - (LONGLONG)m_fRFPMean);
-      DeviationSum += Deviation*Deviation;  
-    }
-    m_fRFPStdDev = sqrt(DeviationSum/rfpFrames);
-  }
-  
-}
-
-
 void MPEVRCustomPresenter::ResetTraceStats()
 {
-  m_uSyncGlitches   = 0;
+  m_jitterStats.ResetTrace();
   m_PaintTimeMin    = MAXLONG64;
   m_PaintTimeMax    = 0;
-  m_MinJitter       = MAXLONG64;
-  m_MaxJitter       = MINLONG64;
   m_MinSyncOffset   = MAXLONG64;
   m_MaxSyncOffset   = MINLONG64;
   m_bResetStats     = false;
@@ -2912,8 +2560,7 @@ void MPEVRCustomPresenter::ResetFrameStats()
 {
   m_iFramesDrawn    = 0;
   m_iFramesDropped  = 0;
-  m_iFramesHeld     = 0;
-  m_iLateFrames     = 0;
+  m_lateFrames.Reset();
   m_iFramesProcessed = 0;
   
   m_nNextCFP = 0;
@@ -2926,11 +2573,7 @@ void MPEVRCustomPresenter::ResetFrameStats()
   m_fPCDSumAvg = 0.0;
   ZeroMemory((void*)&m_pllPCD, sizeof(double) * NB_PCDSIZE);
   
-  m_DetectedFrameTimePos  = 0;
-  m_DetectedLock          = false;
-  m_DetectedFrameTime     = -1.0;  
-  m_DectedSum             = 0;
-  ZeroMemory((void*)&m_DetectedFrameTimeHistory, sizeof(LONGLONG) * NB_DFTHSIZE);
+  m_frameTimeDetector.Reset();
   
   m_LastScheduledUncorrectedSampleTime = -1;
   m_frameRateRatio = 0;
@@ -2940,7 +2583,7 @@ void MPEVRCustomPresenter::ResetFrameStats()
   m_earliestPresentTime = 0;
   m_lastPresentTime = 0;
   
-  m_nNextRFP = 0;
+  m_framePeriodStats.Reset();
     
   m_PaintTime = 0;
 
@@ -2963,9 +2606,9 @@ REFERENCE_TIME MPEVRCustomPresenter::GetFrameDuration()
     m_dCycleDifference = GetCycleDifference();
   }
 
-  if (m_DetectedFrameTime > DFT_THRESH) 
+  if (m_frameTimeDetector.m_DetectedFrameTime > DFT_THRESH) 
   {
-    return (REFERENCE_TIME)(m_DetectedFrameTime * 10000000.0);
+    return (REFERENCE_TIME)(m_frameTimeDetector.m_DetectedFrameTime * 10000000.0);
   }
   else
   {
@@ -2991,7 +2634,7 @@ double MPEVRCustomPresenter::GetDisplayCycle()
 // Get detected frame duration in seconds
 double MPEVRCustomPresenter::GetDetectedFrameTime()
 {
-  return m_DetectedFrameTime;
+  return m_frameTimeDetector.m_DetectedFrameTime;
 }
 
 // Get best estimate of actual frame duration in seconds
@@ -3000,9 +2643,9 @@ double MPEVRCustomPresenter::GetRealFramePeriod()
   double rtimePerFrame ;
   double currentDispCycle = GetDisplayCycle(); // in ms
   
-  if (m_DetectedFrameTime > DFT_THRESH) 
+  if (m_frameTimeDetector.m_DetectedFrameTime > DFT_THRESH) 
   {
-    rtimePerFrame = m_DetectedFrameTime; // in seconds
+    rtimePerFrame = m_frameTimeDetector.m_DetectedFrameTime; // in seconds
   }
   else
   {
@@ -3014,43 +2657,9 @@ double MPEVRCustomPresenter::GetRealFramePeriod()
 
 void MPEVRCustomPresenter::GetFrameRateRatio()
 {
-  double rtimePerFrameMs; // in ms
-  double currentDispCycle = GetDisplayCycle(); // in ms
-  
-  if (m_DetectedFrameTime > DFT_THRESH) 
-  {
-    rtimePerFrameMs = m_DetectedFrameTime * 1000.0; // in ms
-  }
-  else
-  {
-    rtimePerFrameMs = ((double) m_rtTimePerFrame)/10000.0; // in ms
-  }
-  
-  // Compensate to get actual time per frame after ReClock speed up/down
-  rtimePerFrameMs = rtimePerFrameMs/m_fPCDMean;
-  
-  int F2DRatioP6 = (int)((rtimePerFrameMs * 1.015)/currentDispCycle); // Allow +1.5% tolerance
-  int F2DRatioN6 = (int)((rtimePerFrameMs * 0.985)/currentDispCycle); // Allow -1.5% tolerance
-
-  m_rawFRRatio = F2DRatioP6;
- 
-  if (!(m_DetectedFrameTime > DFT_THRESH) || (m_iFramesProcessed < FRAME_PROC_THRESH))
-  {
-    m_frameRateRatio = 0;
-  }
-  else if (m_iFramesDrawn < FRAME_PROC_THRSH2)
-  {
-    m_frameRateRatio = F2DRatioP6;
-  }
-  else if (F2DRatioP6 == 0 || (F2DRatioP6 == F2DRatioN6)) 
-  {
-    m_frameRateRatio = 0;
-  }
-  else
-  {
-    m_frameRateRatio = F2DRatioP6;
-  }
- 
+  // m_fPCDMean compensates for ReClock speed up/down
+  m_frameRateRatio = FrameRateRatio(m_frameTimeDetector.m_DetectedFrameTime, m_rtTimePerFrame, m_fPCDMean, GetDisplayCycle(),
+                                    m_iFramesProcessed, m_iFramesDrawn, &m_rawFRRatio);
 }
 
 // Get the difference in video and display cycle times.
@@ -3149,99 +2758,15 @@ void MPEVRCustomPresenter::CorrectSampleTime(IMFSample* pSample)
   if ((Diff < m_rtTimePerFrame*8 && m_rtTimePerFrame && 
       m_fRate == 1.0f && !m_bDVDMenu) || m_bScrubbing)
   {
-    int iPos = (m_DetectedFrameTimePos % NB_DFTHSIZE);
-    m_DectedSum -= m_DetectedFrameTimeHistory[iPos];
-    m_DetectedFrameTimeHistory[iPos] = Diff;
-    m_DectedSum += Diff;
-    m_DetectedFrameTimePos++;
-    
-    double Average = (double)Diff;
-    
-    if (m_DetectedFrameTimePos >= NB_DFTHSIZE)
-    {
-      Average = (double)m_DectedSum / (double)NB_DFTHSIZE;
-    }
-    else if (m_DetectedFrameTimePos >= 4)
-    {
-      Average = (double)m_DectedSum / (double)m_DetectedFrameTimePos;
-    }
-
-    if (m_DetectedFrameTimePos >= 4)
-    {     
-      if (m_bDrawStats)
-      {
-        int nFrames = min(m_DetectedFrameTimePos, NB_DFTHSIZE);
-        double DeviationSum = 0.0;
-        for (int i = 0; i < nFrames; ++i)
-        {
-          double Deviation = m_DetectedFrameTimeHistory[i] - Average;
-          DeviationSum += Deviation*Deviation;
-        }
-  
-        double StdDev = sqrt(DeviationSum/double(nFrames));
-  
-        m_DetectedFrameTimeStdDev = StdDev;
-      }
-
-      double DetectedTime = Average / 10000000.0;
-      
-      m_DetFrameTimeAve = DetectedTime;
-      
-      bool bFTdiff = false;      
-      if (m_DetectedFrameTime && DetectedTime)
-      {
-        bFTdiff = fabs(1.0 - (DetectedTime / m_DetectedFrameTime)) > 0.01; //allow 1% drift before re-calculating
-      }
-      
-      if (bFTdiff || (m_DetectedFrameTimePos < NB_DFTHSIZE))
-			{
-	      double AllowedError = 0.025; //Allow 2.5% error to cover (ReClock ?) sample timing jitter
-	      static double AllowedValues[] = {1000.5/30000.0, 1000.0/25000.0, 1000.5/24000.0};  //30Hz and 24Hz are compromise values
-	      static double AllowedDivs[] = {4.0, 2.0, 1.0, 0.5};
-	
-	      double BestVal = 0.0;
-	      double currError = AllowedError;
-	      int nAllowed = sizeof(AllowedValues) / sizeof(AllowedValues[0]);
-	      int nAllDivs = sizeof(AllowedDivs) / sizeof(AllowedDivs[0]);
-	      
-	      // Find best match with allowed frame periods
-	      for (int i = 0; i < nAllowed; ++i)
-	      {
-	        for (int j = 1; j < nAllDivs; j++)
-	        {
-	          currError = fabs(1.0 - (DetectedTime / (AllowedValues[i] / AllowedDivs[j]) ));
-	          if (currError < AllowedError)
-	          {
-	            AllowedError = currError;
-	            BestVal = (AllowedValues[i] / AllowedDivs[j]);
-	          }
-	        }
-	      }
-	
-	      if (BestVal != 0.0)
-	      {
-	        m_DetectedLock = true;
-	        m_DetectedFrameTime = BestVal;
-	      }
-	      else
-	      {
-	        m_DetectedLock = false;
-	        m_DetectedFrameTime = DetectedTime;
-	      }
-	    }
-    }
-
+    m_frameTimeDetector.Add(Diff, m_bDrawStats);
   }
   else if ((Diff >= m_rtTimePerFrame*8) && m_rtTimePerFrame)
   {
     // Seek, so reset the averaging logic
-    m_DetectedFrameTimePos = 0;
-    m_DetectedLock = false;
-    m_DectedSum = 0;
-    ZeroMemory((void*)&m_DetectedFrameTimeHistory, sizeof(LONGLONG) * NB_DFTHSIZE);
+    m_frameTimeDetector.Restart();
   }
     
-  LOG_TRACE("EVR: Time: %f %f %f\n", Time / 10000000.0, SetDuration / 10000000.0, m_DetectedFrameTime);
+  LOG_TRACE("EVR: Time: %f %f %f\n", Time / 10000000.0, SetDuration / 10000000.0, m_frameTimeDetector.m_DetectedFrameTime);
 }
 
 
@@ -3270,72 +2795,18 @@ void MPEVRCustomPresenter::GetRealRefreshRate()
 LONGLONG MPEVRCustomPresenter::GetDelayToRasterTarget(LONGLONG *targetTime, LONGLONG *offsetTime)
 {
     D3DRASTER_STATUS rasterStatus;
-    LONGLONG targetDelay = 0;
     *targetTime = 0;
-    LONGLONG scanlineTime = (LONGLONG) (m_dDetectedScanlineTime * 10000.0);
-    UINT limitHigh  = m_rasterLimitHigh;
-    
-    if (*offsetTime < 0)
-    {
-      *offsetTime = 0;
-    }
-    
-    UINT errOffset = (UINT)(*offsetTime / scanlineTime); //error offset in scanlines
-    limitHigh  = limitHigh + errOffset;
-    if (limitHigh > m_rasterLimitTop)
-    {
-      limitHigh = m_rasterLimitTop;
-    }
-    
-    *offsetTime = 0;
 
     LONGLONG now = GetCurrentTimestamp();
-    // Calculate raster offset
-    if (SUCCEEDED(m_pD3DDev->GetRasterStatus(0, &rasterStatus)))
+    if (FAILED(m_pD3DDev->GetRasterStatus(0, &rasterStatus)))
     {
-      UINT currScanline = rasterStatus.ScanLine;
-      
-      if ( currScanline < m_rasterLimitLow )
-      {
-        targetDelay = (LONGLONG)(m_rasterTargetPosn - currScanline) * scanlineTime ;       
-      }
-      else if ( currScanline > limitHigh )
-      {
-        if (currScanline > m_maxScanLine) 
-        {
-          targetDelay = (LONGLONG)m_rasterTargetPosn * scanlineTime ;  
-        }
-        else
-        {
-          targetDelay = (LONGLONG)(m_rasterTargetPosn + m_maxScanLine - currScanline) * scanlineTime ;  
-        }      
-      }   
-      
-      if (targetDelay > (LONGLONG)(GetDisplayCycle() * (70000.0/8.0))) //sanity check the delay value
-      {
-        targetDelay = (LONGLONG)(GetDisplayCycle() * (70000.0/8.0));
-      }
-      
-      if ( (currScanline < m_rasterLimitNP) )
-      {
-        *offsetTime = (LONGLONG)(m_rasterLimitNP - currScanline) * scanlineTime ;
-      }
-      
-      //currScanline value is reported as zero all through vertical blanking
-      //so limit delay to avoid overshooting the target position
-      if ( currScanline < 2 )
-      {
-        targetDelay = 15000 ; //Limit to 1.5ms
-        *offsetTime = 0 ;
-      }
-      else
-      {
-        targetDelay = targetDelay / 2; //delay in chunks
-      }
-      
-      *targetTime = now + targetDelay;      
+      *offsetTime = 0;
+      return 0;
     }
-    
+
+    LONGLONG targetDelay = m_rasterWindow.GetDelay(rasterStatus.ScanLine, m_maxScanLine, m_dDetectedScanlineTime, GetDisplayCycle(), offsetTime);
+    *targetTime = now + targetDelay;
+
     return targetDelay;
 }
 
@@ -3576,59 +3047,20 @@ void MPEVRCustomPresenter::SetupAudioRenderer()
 
 void MPEVRCustomPresenter::AdjustAVSync(double currentPhaseDiff)
 {
-  // Keep a rolling average of last X deviations from target phase. 
-  // These numbers have values between -0.5 and 0.5
-  int tempNextPhDev = (m_nNextPhDev % NUM_PHASE_DEVIATIONS);
-  m_sumPhaseDiff -= m_dPhaseDeviations[tempNextPhDev];
-  m_dPhaseDeviations[tempNextPhDev] = currentPhaseDiff;
-  m_sumPhaseDiff += currentPhaseDiff;
-  m_nNextPhDev++;
-
-  double averagePhaseDifference = m_sumPhaseDiff / NUM_PHASE_DEVIATIONS;
-  
-  m_avPhaseDiff = averagePhaseDifference;
-
-  // If we are getting close to target then stop correcting.
-  // Since it is a rolling average we will overshoot the target, so we plan to stop early.
-  // If we are speeding up, we should stop when above the "green" limit
-  if (m_dVariableFreq > 1.0)
-  {
-    if (averagePhaseDifference > -0.05 )
-    {
-      m_dVariableFreq = 1.0;
-    }
-  }
-  // If we are slowing down, we should stop when below the "green" limit
-  if (m_dVariableFreq < 1.0)
-  {
-    if (averagePhaseDifference < 0.05 )
-    {
-      m_dVariableFreq = 1.0;
-    }
-  }
-
-  // If we have drifted significantly away from target, let us speed up or slow down until we are within above limits again
-  if (averagePhaseDifference > 0.1)
-  {
-    m_dVariableFreq = 1.003;
-  }
-  if (averagePhaseDifference < -0.1)
-  {
-    m_dVariableFreq = 0.997;
-  }
+  m_phaseControl.Update(currentPhaseDiff);
 
-  //Log("VF: %f averagePhaseDif: %f CP: %f ", m_dVariableFreq, averagePhaseDifference, currentPhase);
+  //Log("VF: %f averagePhaseDif: %f CP: %f ", m_phaseControl.m_dVariableFreq, m_phaseControl.m_avPhaseDiff, currentPhaseDiff);
 
-  if (m_pAVSyncClock && m_dVariableFreq != m_dPreviousVariableFreq)
+  if (m_pAVSyncClock && m_phaseControl.m_dVariableFreq != m_dPreviousVariableFreq)
   {
-    HRESULT hr = m_pAVSyncClock->AdjustClock(1.0/m_dVariableFreq);
+    HRESULT hr = m_pAVSyncClock->AdjustClock(1.0/m_phaseControl.m_dVariableFreq);
     if (hr == S_OK && m_dPreviousVariableFreq == 1.0)
     {
       m_iClockAdjustmentsDone++;
     }
   }
 
-  m_dPreviousVariableFreq = m_dVariableFreq;
+  m_dPreviousVariableFreq = m_phaseControl.m_dVariableFreq;
 }
 
 
@@ -21,6 +21,7 @@
 #include "IAVSyncClock.h"
 #include "callback.h"
 #include "myqueue.h"
+#include "FramePacing.h"
 
 using namespace std;
 #define CHECK_HR(hr, msg) if (FAILED(hr)) Log(msg);
@@ -30,18 +31,8 @@ using namespace std;
 #define NO_MP_AUD_REND true
 
 #define NUM_SURFACES 5
-#define NB_JITTER 125
-#define NB_RFPSIZE 64
-#define NB_DFTHSIZE 64
 #define NB_CFPSIZE 16
 #define NB_PCDSIZE 32
-#define LF_THRESH_LOW 3
-#define LF_THRESH (LF_THRESH_LOW + 1)
-#define LF_THRESH_HIGH (LF_THRESH + 3)
-#define FRAME_PROC_THRESH 30
-#define FRAME_PROC_THRSH2 60
-#define DFT_THRESH 0.007
-#define NUM_PHASE_DEVIATIONS 32
 #define FILTER_LIST_SIZE 9
 
 // magic numbers
@@ -209,7 +200,6 @@ protected:
   void           GetAVSyncClockInterface();
   void           SetupAudioRenderer();
   void           AdjustAVSync(double currentPhaseDiff);
-  int            MeasureScanLines(LONGLONG startTime, double *times, double *scanLines, int n);
   BOOL           EstimateRefreshTimings();
   void           ReleaseSurfaces();
   HRESULT        Paint(CComPtr<IDirect3DSurface9> pSurface);
@@ -294,18 +284,11 @@ protected:
   bool                              m_bFirstFrame;
   bool                              m_bDVDMenu;
   MP_RENDER_STATE                   m_state;
-  double                            m_fAvrFps;						            // Estimate the real FPS
-  LONGLONG                          m_pllJitter [NB_JITTER];		      // Jitter buffer for stats
-  LONGLONG                          m_llLastPerf;
-  int                               m_nNextJitter;
   REFERENCE_TIME                    m_rtTimePerFrame;
   LONGLONG                          m_llLastWorkerNotification;
 
-  LONGLONG                          m_pllRFP [NB_RFPSIZE];   // timestamp buffer for estimating real frame period
-  LONGLONG                          m_llLastRFPts;
-  int                               m_nNextRFP;
- 	double                            m_fRFPStdDev;				// Estimate the real frame period std dev
-	double                            m_fRFPMean;
+  CJitterStats                      m_jitterStats;        // vsync periods for stats
+  CFramePeriodStats                 m_framePeriodStats;   // paint time stamps for estimating real frame period
 
   LONGLONG                          m_pllCFP [NB_CFPSIZE];   // timestamp buffer for estimating real frame period
   LONGLONG                          m_llLastCFPts;
@@ -321,26 +304,20 @@ protected:
   double                            m_fPCDSumAvg;
 	
 	
-  int                               m_iFramesHeld;
-  int                               m_iLateFrames;
+  CLateFrameControl                 m_lateFrames;
   int                               m_iFramesProcessed;
  
 
   int       m_nNextSyncOffset;
   LONGLONG  nsSampleTime;
 
-	double    m_fJitterStdDev;				// Estimate the Jitter std dev
-	double    m_fJitterMean;
 	double    m_fSyncOffsetStdDev;
 	double    m_fSyncOffsetAvr;
 	double    m_DetectedRefreshRate;
 
-  LONGLONG  m_MaxJitter;
-  LONGLONG  m_MinJitter;
   LONGLONG  m_MaxSyncOffset;
   LONGLONG  m_MinSyncOffset;
   LONGLONG  m_pllSyncOffset [NB_JITTER];		// Jitter buffer for stats
-  unsigned long m_uSyncGlitches;
 
 	LONGLONG  m_PaintTimeMin;
 	LONGLONG  m_PaintTimeMax;
@@ -355,8 +332,6 @@ protected:
 
   // Functions to trace timing performance
   void OnVBlankFinished(bool fAll, LONGLONG periodStart, LONGLONG periodEnd);
-  void CalculateJitter(LONGLONG PerfCounter);
-  void CalculateRealFramePeriod(LONGLONG timeStamp);
   void CalculateNSTStats(LONGLONG timeStamp);
   void CalculatePresClockDelta(LONGLONG presTime, LONGLONG sysTime);
 
@@ -370,18 +345,13 @@ protected:
   double m_dFrameCycle;
   double m_dCycleDifference;
   double m_rasterSyncOffset;
-  double m_pllRasterSyncOffset[NB_JITTER];
   UINT   m_LastStartOfPaintScanline;
   UINT   m_LastEndOfPaintScanline;
   UINT   m_maxScanLine;
   UINT   m_minVisScanLine;
   UINT   m_maxVisScanLine;
 
-  UINT   m_rasterLimitLow; 
-  UINT   m_rasterTargetPosn;
-  UINT   m_rasterLimitHigh;
-  UINT   m_rasterLimitTop;    
-  UINT   m_rasterLimitNP;    
+  CRasterWindow m_rasterWindow;
 
   double m_dEstRefCycDiff; 
   
@@ -395,13 +365,7 @@ protected:
 
   // Used for detecting the real frame duration
   LONGLONG      m_LastScheduledUncorrectedSampleTime;
-  LONGLONG      m_DetectedFrameTimeHistory[NB_DFTHSIZE];
-  LONGLONG      m_DectedSum;
-  int           m_DetectedFrameTimePos;
-  double        m_DetectedFrameTime;
-  double        m_DetectedFrameTimeStdDev;
-  bool          m_DetectedLock;
-  double        m_DetFrameTimeAve;
+  CFrameTimeDetector m_frameTimeDetector;
 
   int           m_frameRateRatio;
   int           m_rawFRRatio;
@@ -429,11 +393,7 @@ protected:
   double        m_dMaxBias;
   double        m_dMinBias;
   bool          m_bBiasAdjustmentDone;
-  double        m_dPhaseDeviations[NUM_PHASE_DEVIATIONS];
-  int           m_nNextPhDev;
-  double        m_sumPhaseDiff;
-  double        m_dVariableFreq;
+  CPhaseControl m_phaseControl;
   double        m_dPreviousVariableFreq;
   unsigned int  m_iClockAdjustmentsDone;
-  double        m_avPhaseDiff;
 };
@@ -0,0 +1,731 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "FramePacing.h"
+
+static void PacingLog(IPacingSource* pSource, const char *fmt, ...)
+{
+  char buffer[512];
+  va_list ap;
+  va_start(ap, fmt);
+  vsprintf(buffer, fmt, ap);
+  va_end(ap);
+  pSource->Log(buffer);
+}
+
+double LinearRegression(double *x, double *y, int n, double *pSlope, double *pIntercept)
+{
+  int i;
+  double sigmaXY = 0;
+  double sigmaX2 = 0;
+  double sigmaX = 0;
+  double sigmaY = 0;
+  double sigmaY2 = 0;
+
+  for(i = 0; i < n; i++)
+  {
+    sigmaXY += (*x) * (*y);
+    sigmaX2 += (*x) * (*x);
+    sigmaY2 += (*y) * (*y);
+    sigmaX += *x++;
+    sigmaY += *y++;
+  }
+
+  *pSlope = (n * sigmaXY - sigmaX * sigmaY) / (n * sigmaX2 - sigmaX * sigmaX);
+  *pIntercept = (sigmaY - *pSlope * sigmaX) / n;
+  return (n * sigmaXY - sigmaX * sigmaY) / sqrt((n * sigmaX2 - sigmaX * sigmaX) * (n * sigmaY2 - sigmaY * sigmaY));
+}
+
+static unsigned int ReadScanLine(IPacingSource* pSource)
+{
+  unsigned int scanLine = 0;
+  pSource->GetScanLine(&scanLine);
+  return scanLine;
+}
+
+static int MeasureScanLines(IPacingSource* pSource, long long startTime, double *times, double *scanLines, int n, unsigned int* pMaxScanLine)
+{
+  unsigned int scanLine = 0;
+  int line = -1;
+  for (int i = 0; i < n; i++)
+  {
+    do
+    {
+      times[i] = (double)(pSource->GetTime() - startTime);
+      scanLine = ReadScanLine(pSource);
+      scanLines[i] = (double)scanLine;
+    } while (line == (int)scanLine);
+
+    if (line > (int)*pMaxScanLine)
+      *pMaxScanLine = (unsigned int)line;
+
+    if ((int)scanLine < line)
+      return i;
+
+    line = scanLine;
+  }
+
+  //Looping wait until next vsync
+  PacingLog(pSource, "MeasureScanLines: wait for vsync: scanline: %d", line);
+  while ((int)scanLine >= line)
+  {
+    line = scanLine;
+
+    if (line > (int)*pMaxScanLine)
+      *pMaxScanLine = (unsigned int)line;
+
+    scanLine = ReadScanLine(pSource);
+  }
+
+  return n;
+}
+
+bool MeasureRefreshTimings(IPacingSource* pSource, unsigned int displayHeight, RefreshTimings* pTimings)
+{
+  long long startTime = 0;
+  long long startTimeLR = 0;
+  long long endTime = 0;
+  unsigned int scanLine = 0;
+  unsigned int line = 0;
+  unsigned int startLine = 0;
+  unsigned int endLine = 0;
+  double AllowedError = 0.0;
+  double currError = 0.0;
+
+  unsigned int maxScanLine    = 0;
+  unsigned int minVisScanLine = displayHeight;
+  const int maxScanLineSamples = 1000;
+  const int maxFrameSamples = 8;
+  double times[maxScanLineSamples*2];
+  double scanLines[maxScanLineSamples*2];
+  struct {
+    double slope;
+    double intercept;
+    double fit;
+  }   coeff[maxFrameSamples];
+  int sampleCount;
+
+  double estRefreshCyc [maxFrameSamples];
+  double sumRefCyc = 0.0;
+  double aveRefCyc = 0.0;
+
+  //Wait for vsync
+  scanLine = ReadScanLine(pSource);
+  while (scanLine >= line)
+  {
+    line = scanLine;
+    scanLine = ReadScanLine(pSource);
+    if (scanLine > maxScanLine)
+    {
+      maxScanLine = scanLine;
+    }
+  }
+
+  PacingLog(pSource, "Starting frame loops: start scanline: %d", scanLine);
+
+  endTime = pSource->GetTime();
+  startTimeLR = endTime;
+
+  // Now we're at the start of a vsync
+  for (int i = 0; i < maxFrameSamples; i++)
+  {
+    startTime = endTime;
+    //Skip over vertical blanking period
+    scanLine = ReadScanLine(pSource);
+    while (scanLine < 2)
+    {
+      scanLine = ReadScanLine(pSource);
+    }
+    startLine = scanLine;
+
+    if (startLine < minVisScanLine)
+      minVisScanLine = startLine;
+
+    // make a few measurements
+    PacingLog(pSource, "Starting Frame: %d, start scanline: %d", i, startLine);
+    sampleCount = MeasureScanLines(pSource, startTimeLR, times, scanLines, maxScanLineSamples, &maxScanLine);
+    // Now we're at the next vsync
+    endLine = ReadScanLine(pSource);
+    endTime = pSource->GetTime();
+
+    PacingLog(pSource, "Ending Frame: %d, start scanline: %d, end scanline: %d, maxScanline: %d", i, startLine, endLine, maxScanLine);
+
+    estRefreshCyc[i] = (double)(endTime - startTime); // in hns units
+    sumRefCyc += estRefreshCyc[i];
+
+    coeff[i].fit = LinearRegression(scanLines, times, sampleCount, &coeff[i].slope, &coeff[i].intercept);
+    PacingLog(pSource, "  samples = %d, slope = %.6f, intercept = %.6f, fit = %.6f", sampleCount, coeff[i].slope, coeff[i].intercept, coeff[i].fit);
+  }
+
+  //-----------------------------------------------------
+  // Calculate the simplistic refresh rate estimate
+  //-----------------------------------------------------
+
+  aveRefCyc = sumRefCyc / (double)maxFrameSamples;
+
+  AllowedError = 0.0;
+  currError = 0.0;
+  int BadIdx0 = 0;
+  // Find worst match with average refresh period so it can be removed
+  for (int i = 0; i < maxFrameSamples; ++i)
+  {
+    currError = fabs(1.0 - (aveRefCyc / estRefreshCyc[i]) );
+    if (currError > AllowedError)
+    {
+      AllowedError = currError;
+      BadIdx0 = i;
+    }
+  }
+
+  sumRefCyc -= estRefreshCyc[BadIdx0];
+
+  aveRefCyc = sumRefCyc / (double)(maxFrameSamples - 1);
+
+  AllowedError = 0.0;
+  currError = 0.0;
+  int BadIdx1 = 0;
+  // Find next worst match with new average refresh period so it can be removed
+  for (int i = 0; i < maxFrameSamples; ++i)
+  {
+    currError = fabs(1.0 - (aveRefCyc / estRefreshCyc[i]) );
+    if ((currError > AllowedError) && (i != BadIdx0))
+    {
+      AllowedError = currError;
+      BadIdx1 = i;
+    }
+  }
+  sumRefCyc -= estRefreshCyc[BadIdx1];
+
+  double simpleFrameTime = sumRefCyc / (double)(maxFrameSamples - 2); // in hns units
+
+  //--------------------------------------------------------------
+  // Calculate the linear regression refresh rate estimate
+  //--------------------------------------------------------------
+
+  // Find the best matching measurement and the minimum frame time
+  int bestFitIdx = 0;
+  double minFrameTime = DBL_MAX;
+  int frameCount = 0;
+
+  for (int i = 1; i < maxFrameSamples; i++)
+  {
+    if (coeff[i].fit > coeff[bestFitIdx].fit)
+      bestFitIdx = i;
+    if (minFrameTime > coeff[i].intercept - coeff[i-1].intercept)
+      minFrameTime = coeff[i].intercept - coeff[i-1].intercept;
+  }
+
+  // Find the number of frames measured
+  for (int i = 1; i < maxFrameSamples; i++)
+  {
+    frameCount += (int)floor((coeff[i].intercept - coeff[i-1].intercept)/minFrameTime + 0.5);
+  }
+
+  PacingLog(pSource, "  frame count = %d", frameCount);
+  double scanLineTime = coeff[bestFitIdx].slope;
+  double frameTime = (coeff[maxFrameSamples-1].intercept - coeff[0].intercept)/frameCount;
+
+  //--------------------------------------------------------------
+  // Compare the two methods
+  //--------------------------------------------------------------
+
+  AllowedError = 0.05; //Allow 5.0% error
+
+  currError = fabs(1.0 - (simpleFrameTime / frameTime));
+
+  pTimings->locked         = currError < AllowedError;
+  pTimings->cycleDiff      = currError;
+  pTimings->maxVisScanLine = maxScanLine;
+  pTimings->minVisScanLine = minVisScanLine;
+  pTimings->maxScanLine    = ((unsigned int)(frameTime / scanLineTime)) - 1;
+  pTimings->refreshCycle   = frameTime / 10000.0; // in milliseconds
+  pTimings->scanlineTime   = scanLineTime / 10000.0;
+
+  PacingLog(pSource, "Raw est display cycle, linReg: %.6f ms, simple: %.6f ms, diff: %.6f ", frameTime/10000.0, simpleFrameTime/10000.0, currError);
+
+  return pTimings->locked;
+}
+
+
+CRasterWindow::CRasterWindow()
+{
+  Init(0, 0);
+}
+
+void CRasterWindow::Init(unsigned int minVisScanLine, unsigned int maxVisScanLine)
+{
+  m_limitLow   = (((maxVisScanLine - minVisScanLine) * 1)/8) + minVisScanLine;
+  m_targetPosn = m_limitLow;
+  m_limitHigh  = (((maxVisScanLine - minVisScanLine) * 4)/8) + minVisScanLine;
+  m_limitTop   = (((maxVisScanLine - minVisScanLine) * 5)/8) + minVisScanLine;
+  m_limitNP    = maxVisScanLine;
+}
+
+long long CRasterWindow::GetDelay(unsigned int currScanline, unsigned int maxScanLine, double scanlineTime, double displayCycle, long long* offsetTime)
+{
+  long long targetDelay = 0;
+  long long scanlineHns = (long long)(scanlineTime * 10000.0);
+  unsigned int limitHigh = m_limitHigh;
+
+  if (*offsetTime < 0)
+  {
+    *offsetTime = 0;
+  }
+
+  unsigned int errOffset = (unsigned int)(*offsetTime / scanlineHns); //error offset in scanlines
+  limitHigh = limitHigh + errOffset;
+  if (limitHigh > m_limitTop)
+  {
+    limitHigh = m_limitTop;
+  }
+
+  *offsetTime = 0;
+
+  if ( currScanline < m_limitLow )
+  {
+    targetDelay = (long long)(m_targetPosn - currScanline) * scanlineHns ;
+  }
+  else if ( currScanline > limitHigh )
+  {
+    if (currScanline > maxScanLine)
+    {
+      targetDelay = (long long)m_targetPosn * scanlineHns ;
+    }
+    else
+    {
+      targetDelay = (long long)(m_targetPosn + maxScanLine - currScanline) * scanlineHns ;
+    }
+  }
+
+  if (targetDelay > (long long)(displayCycle * (70000.0/8.0))) //sanity check the delay value
+  {
+    targetDelay = (long long)(displayCycle * (70000.0/8.0));
+  }
+
+  if ( (currScanline < m_limitNP) )
+  {
+    *offsetTime = (long long)(m_limitNP - currScanline) * scanlineHns ;
+  }
+
+  //currScanline value is reported as zero all through vertical blanking
+  //so limit delay to avoid overshooting the target position
+  if ( currScanline < 2 )
+  {
+    targetDelay = 15000 ; //Limit to 1.5ms
+    *offsetTime = 0 ;
+  }
+  else
+  {
+    targetDelay = targetDelay / 2; //delay in chunks
+  }
+
+  return targetDelay;
+}
+
+
+CJitterStats::CJitterStats()
+{
+  Reset();
+  ResetTrace();
+}
+
+void CJitterStats::Reset()
+{
+  memset(m_pllJitter,           0, sizeof(m_pllJitter));
+  memset(m_pllRasterSyncOffset, 0, sizeof(m_pllRasterSyncOffset));
+  m_nNextJitter   = 0;
+  m_llLastPerf    = 0;
+  m_fJitterMean   = 0.0;
+  m_fJitterStdDev = 0.0;
+  m_fAvrFps       = 0.0;
+}
+
+void CJitterStats::ResetTrace()
+{
+  m_uSyncGlitches = 0;
+  m_MinJitter     = LLONG_MAX;
+  m_MaxJitter     = LLONG_MIN;
+}
+
+// Update the array m_pllJitter with a new vsync period. Calculate min, max and stddev.
+void CJitterStats::Add(long long now, double rasterSyncOffset, double displayCycle, bool bSettled)
+{
+  m_nNextJitter = (m_nNextJitter+1) % NB_JITTER;
+  m_pllJitter[m_nNextJitter] = now - m_llLastPerf;
+
+  m_pllRasterSyncOffset[m_nNextJitter] = rasterSyncOffset;
+
+  double syncDeviation = ((double)m_pllJitter[m_nNextJitter] - m_fJitterMean) / 10000.0;
+
+  if (fabs(syncDeviation) > (displayCycle / 2))
+  {
+    // ignore glitches until enough data has been collected
+    if (bSettled)
+    {
+      m_uSyncGlitches++;
+    }
+  }
+
+  long long llJitterSum = 0;
+  for (int i = 0; i < NB_JITTER; i++)
+  {
+    llJitterSum += m_pllJitter[i];
+  }
+  m_fJitterMean = double(llJitterSum) / NB_JITTER;
+  double DeviationSum = 0;
+
+  for (int i = 0; i < NB_JITTER; i++)
+  {
+    long long DevInt = m_pllJitter[i] - (long long)m_fJitterMean;
+    double Deviation = (double)DevInt;
+
+    DeviationSum += Deviation*Deviation;
+
+    if (bSettled)
+    {
+      if (DevInt > m_MaxJitter) m_MaxJitter = DevInt;
+      if (DevInt < m_MinJitter) m_MinJitter = DevInt;
+    }
+  }
+
+  m_fJitterStdDev = sqrt(DeviationSum/NB_JITTER);
+  m_fAvrFps = 10000000.0/(double(llJitterSum)/NB_JITTER);
+  m_llLastPerf = now;
+}
+
+
+CFramePeriodStats::CFramePeriodStats()
+{
+  memset(m_pllRFP, 0, sizeof(m_pllRFP));
+  m_llLastRFPts = 0;
+  m_fRFPStdDev  = 0.0;
+  m_fRFPMean    = 0.0;
+  Reset();
+}
+
+void CFramePeriodStats::Reset()
+{
+  m_nNextRFP = 0;
+}
+
+// Update the array m_pllRFP with a new frame time stamp. Calculate mean and stddev.
+void CFramePeriodStats::Add(long long timeStamp, double detectedFrameTime, bool bStdDev)
+{
+  long long rfpDiff = timeStamp - m_llLastRFPts;
+  if (rfpDiff < 0) rfpDiff = -rfpDiff;
+  m_llLastRFPts = timeStamp;
+
+  if ( (rfpDiff <= (detectedFrameTime * 11000000)) &&
+       (rfpDiff >= (detectedFrameTime *  9000000)) &&
+       (detectedFrameTime > DFT_THRESH) )   //ignore out-of-usable-range values
+  {
+    m_pllRFP[(m_nNextRFP % NB_RFPSIZE)] = rfpDiff;
+    m_nNextRFP++;
+  }
+
+  long long llRFPSumAvg = 0;
+  int rfpFrames = NB_RFPSIZE;
+  if ((m_nNextRFP >= 10) && (m_nNextRFP < NB_RFPSIZE))
+  {
+    rfpFrames = m_nNextRFP;
+  }
+
+  if (m_nNextRFP >= rfpFrames)
+  {
+    for (int i = 0; i < rfpFrames; i++)
+    {
+      llRFPSumAvg += m_pllRFP[i];
+    }
+  }
+  else
+  {
+    m_fRFPMean = (detectedFrameTime * 10000000);
+    m_fRFPStdDev = 0.0;
+    return;
+  }
+  m_fRFPMean = double(llRFPSumAvg) / rfpFrames;
+
+  if (bStdDev)
+  {
+    double DeviationSum = 0;
+    double Deviation    = 0;
+    for (int i = 0; i < rfpFrames; i++)
+    {
+      Deviation = (double) (m_pllRFP[i] - (long long)m_fRFPMean);
+      DeviationSum += Deviation*Deviation;
+    }
+    m_fRFPStdDev = sqrt(DeviationSum/rfpFrames);
+  }
+}
+
+
+CFrameTimeDetector::CFrameTimeDetector()
+{
+  Reset();
+  m_DetFrameTimeAve        = -1.0;
+  m_DetectedFrameTimeStdDev = 0;
+}
+
+void CFrameTimeDetector::Reset()
+{
+  Restart();
+  m_DetectedFrameTime = -1.0;
+}
+
+void CFrameTimeDetector::Restart()
+{
+  m_DetectedFrameTimePos = 0;
+  m_DetectedLock = false;
+  m_DectedSum = 0;
+  memset(m_DetectedFrameTimeHistory, 0, sizeof(m_DetectedFrameTimeHistory));
+}
+
+void CFrameTimeDetector::Add(long long diff, bool bStdDev)
+{
+  int iPos = (m_DetectedFrameTimePos % NB_DFTHSIZE);
+  m_DectedSum -= m_DetectedFrameTimeHistory[iPos];
+  m_DetectedFrameTimeHistory[iPos] = diff;
+  m_DectedSum += diff;
+  m_DetectedFrameTimePos++;
+
+  double Average = (double)diff;
+
+  if (m_DetectedFrameTimePos >= NB_DFTHSIZE)
+  {
+    Average = (double)m_DectedSum / (double)NB_DFTHSIZE;
+  }
+  else if (m_DetectedFrameTimePos >= 4)
+  {
+    Average = (double)m_DectedSum / (double)m_DetectedFrameTimePos;
+  }
+
+  if (m_DetectedFrameTimePos < 4)
+  {
+    return;
+  }
+
+  if (bStdDev)
+  {
+    int nFrames = m_DetectedFrameTimePos < NB_DFTHSIZE ? m_DetectedFrameTimePos : NB_DFTHSIZE;
+    double DeviationSum = 0.0;
+    for (int i = 0; i < nFrames; ++i)
+    {
+      double Deviation = m_DetectedFrameTimeHistory[i] - Average;
+      DeviationSum += Deviation*Deviation;
+    }
+
+    m_DetectedFrameTimeStdDev = sqrt(DeviationSum/double(nFrames));
+  }
+
+  double DetectedTime = Average / 10000000.0;
+
+  m_DetFrameTimeAve = DetectedTime;
+
+  bool bFTdiff = false;
+  if (m_DetectedFrameTime && DetectedTime)
+  {
+    bFTdiff = fabs(1.0 - (DetectedTime / m_DetectedFrameTime)) > 0.01; //allow 1% drift before re-calculating
+  }
+
+  if (bFTdiff || (m_DetectedFrameTimePos < NB_DFTHSIZE))
+  {
+    double AllowedError = 0.025; //Allow 2.5% error to cover (ReClock ?) sample timing jitter
+    static double AllowedValues[] = {1000.5/30000.0, 1000.0/25000.0, 1000.5/24000.0};  //30Hz and 24Hz are compromise values
+    static double AllowedDivs[] = {4.0, 2.0, 1.0, 0.5};
+
+    double BestVal = 0.0;
+    double currError = AllowedError;
+    int nAllowed = sizeof(AllowedValues) / sizeof(AllowedValues[0]);
+    int nAllDivs = sizeof(AllowedDivs) / sizeof(AllowedDivs[0]);
+
+    // Find best match with allowed frame periods
+    for (int i = 0; i < nAllowed; ++i)
+    {
+      for (int j = 1; j < nAllDivs; j++)
+      {
+        currError = fabs(1.0 - (DetectedTime / (AllowedValues[i] / AllowedDivs[j]) ));
+        if (currError < AllowedError)
+        {
+          AllowedError = currError;
+          BestVal = (AllowedValues[i] / AllowedDivs[j]);
+        }
+      }
+    }
+
+    if (BestVal != 0.0)
+    {
+      m_DetectedLock = true;
+      m_DetectedFrameTime = BestVal;
+    }
+    else
+    {
+      m_DetectedLock = false;
+      m_DetectedFrameTime = DetectedTime;
+    }
+  }
+}
+
+
+int FrameRateRatio(double frameTime, long long timePerFrame, double clockRatio, double displayCycle,
+                   int framesProcessed, int framesDrawn, int* pRawRatio)
+{
+  double rtimePerFrameMs; // in ms
+
+  if (frameTime > DFT_THRESH)
+  {
+    rtimePerFrameMs = frameTime * 1000.0; // in ms
+  }
+  else
+  {
+    rtimePerFrameMs = ((double) timePerFrame)/10000.0; // in ms
+  }
+
+  // Compensate to get actual time per frame after ReClock speed up/down
+  rtimePerFrameMs = rtimePerFrameMs/clockRatio;
+
+  int F2DRatioP6 = (int)((rtimePerFrameMs * 1.015)/displayCycle); // Allow +1.5% tolerance
+  int F2DRatioN6 = (int)((rtimePerFrameMs * 0.985)/displayCycle); // Allow -1.5% tolerance
+
+  *pRawRatio = F2DRatioP6;
+
+  if (!(frameTime > DFT_THRESH) || (framesProcessed < FRAME_PROC_THRESH))
+  {
+    return 0;
+  }
+  else if (framesDrawn < FRAME_PROC_THRSH2)
+  {
+    return F2DRatioP6;
+  }
+  else if (F2DRatioP6 == 0 || (F2DRatioP6 == F2DRatioN6))
+  {
+    return 0;
+  }
+
+  return F2DRatioP6;
+}
+
+
+CLateFrameControl::CLateFrameControl()
+{
+  Reset();
+}
+
+void CLateFrameControl::Reset()
+{
+  m_iLateFrames = 0;
+  m_iFramesHeld = 0;
+}
+
+long long CLateFrameControl::LateLimit(long long nextSampleTime, long long* pDelErr, long long displayTime, bool bHysteresis)
+{
+  long long hystersisTime = LateFrameHysteresis(displayTime);
+  long long delErrLimit = displayTime;
+
+  if (!bHysteresis)
+  {
+    m_iLateFrames = 0;
+  }
+  else if (m_iLateFrames >= LF_THRESH)
+  {
+    *pDelErr = delErrLimit;
+    return delErrLimit; //more contiguous late frames are allowed
+  }
+  else if (m_iLateFrames == 0 && (nextSampleTime < -(hystersisTime - 5000) || *pDelErr < -(hystersisTime - 5000)))
+  {
+    m_iLateFrames = LF_THRESH_HIGH;
+    m_iFramesHeld++;
+    *pDelErr = delErrLimit;
+    return delErrLimit; // Allow this late frame
+  }
+
+  *pDelErr = 0;
+  return hystersisTime;
+}
+
+void CLateFrameControl::FrameDone()
+{
+  if (m_iLateFrames > 0)
+  {
+    m_iLateFrames--;
+  }
+}
+
+CPhaseControl::CPhaseControl()
+{
+  Reset();
+}
+
+void CPhaseControl::Reset()
+{
+  memset(m_dPhaseDeviations, 0, sizeof(m_dPhaseDeviations));
+  m_nNextPhDev    = 0;
+  m_sumPhaseDiff  = 0.0;
+  m_avPhaseDiff   = 0.0;
+  m_dVariableFreq = 1.0;
+}
+
+double CPhaseControl::Update(double phaseDiff)
+{
+  // Keep a rolling average of last X deviations from target phase.
+  // These numbers have values between -0.5 and 0.5
+  int tempNextPhDev = (m_nNextPhDev % NUM_PHASE_DEVIATIONS);
+  m_sumPhaseDiff -= m_dPhaseDeviations[tempNextPhDev];
+  m_dPhaseDeviations[tempNextPhDev] = phaseDiff;
+  m_sumPhaseDiff += phaseDiff;
+  m_nNextPhDev++;
+
+  double averagePhaseDifference = m_sumPhaseDiff / NUM_PHASE_DEVIATIONS;
+
+  m_avPhaseDiff = averagePhaseDifference;
+
+  // If we are getting close to target then stop correcting.
+  // Since it is a rolling average we will overshoot the target, so we plan to stop early.
+  // If we are speeding up, we should stop when above the "green" limit
+  if (m_dVariableFreq > 1.0)
+  {
+    if (averagePhaseDifference > -0.05 )
+    {
+      m_dVariableFreq = 1.0;
+    }
+  }
+  // If we are slowing down, we should stop when below the "green" limit
+  if (m_dVariableFreq < 1.0)
+  {
+    if (averagePhaseDifference < 0.05 )
+    {
+      m_dVariableFreq = 1.0;
+    }
+  }
+
+  // If we have drifted significantly away from target, let us speed up or slow down until we are within above limits again
+  if (averagePhaseDifference > 0.1)
+  {
+    m_dVariableFreq = 1.003;
+  }
+  if (averagePhaseDifference < -0.1)
+  {
+    m_dVariableFreq = 0.997;
+  }
+
+  return m_dVariableFreq;
+}
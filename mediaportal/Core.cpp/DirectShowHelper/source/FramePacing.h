@@ -0,0 +1,188 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Frame pacing math of the EVR presenter. Nothing in here knows about D3D9 or
+// Media Foundation, the display is only seen through IPacingSource, so the same
+// code can be driven by a synthetic display and clock.
+// All times are in 100ns units unless the name says otherwise.
+
+#pragma once
+
+#define NB_JITTER 125
+#define NB_RFPSIZE 64
+#define NB_DFTHSIZE 64
+#define FRAME_PROC_THRESH 30
+#define FRAME_PROC_THRSH2 60
+#define DFT_THRESH 0.007
+#define NUM_PHASE_DEVIATIONS 32
+#define LF_THRESH_LOW 3
+#define LF_THRESH (LF_THRESH_LOW + 1)
+#define LF_THRESH_HIGH (LF_THRESH + 3)
+
+// Time and raster position of the display, and where the engine's log lines go
+class IPacingSource
+{
+public:
+  virtual ~IPacingSource() {}
+  virtual long long GetTime() = 0;
+  // returns false if the raster position is not available
+  virtual bool GetScanLine(unsigned int* pScanLine) = 0;
+  virtual void Log(const char* text) = 0;
+};
+
+double LinearRegression(double *x, double *y, int n, double *pSlope, double *pIntercept);
+
+struct RefreshTimings
+{
+  double       refreshCycle;   // in ms
+  double       scanlineTime;   // in ms
+  double       cycleDiff;      // disagreement between the vsync and the scanline estimates
+  bool         locked;         // both estimates agree within 5%
+  unsigned int maxScanLine;
+  unsigned int minVisScanLine;
+  unsigned int maxVisScanLine;
+};
+
+// Measures the display cycle and scanline time over a few frames. Busy waits on the
+// source, so the caller should raise the thread priority around it.
+bool MeasureRefreshTimings(IPacingSource* pSource, unsigned int displayHeight, RefreshTimings* pTimings);
+
+// Raster window where presenting a frame won't tear
+class CRasterWindow
+{
+public:
+  CRasterWindow();
+  void Init(unsigned int minVisScanLine, unsigned int maxVisScanLine);
+
+  // Delay until the raster reaches the target paint position, zero if currScanline
+  // is inside the limitLow/limitHigh window. offsetTime widens the window on input
+  // and returns the time left until the raster reaches limitNP.
+  long long GetDelay(unsigned int currScanline, unsigned int maxScanLine, double scanlineTime, double displayCycle, long long* offsetTime);
+
+  unsigned int m_limitLow;
+  unsigned int m_targetPosn;
+  unsigned int m_limitHigh;
+  unsigned int m_limitTop;
+  unsigned int m_limitNP;
+};
+
+// Statistics of the vsync periods seen by Paint()
+class CJitterStats
+{
+public:
+  CJitterStats();
+  void Reset();
+  void ResetTrace();
+  // bSettled enables the glitch counter and min/max once the buffer holds real data
+  void Add(long long now, double rasterSyncOffset, double displayCycle, bool bSettled);
+
+  long long     m_pllJitter[NB_JITTER];
+  double        m_pllRasterSyncOffset[NB_JITTER];
+  int           m_nNextJitter;
+  long long     m_llLastPerf;
+  double        m_fJitterMean;
+  double        m_fJitterStdDev;
+  long long     m_MaxJitter;
+  long long     m_MinJitter;
+  unsigned long m_uSyncGlitches;
+  double        m_fAvrFps;
+};
+
+// Real frame period from the paint time stamps
+class CFramePeriodStats
+{
+public:
+  CFramePeriodStats();
+  void Reset();
+  void Add(long long timeStamp, double detectedFrameTime, bool bStdDev);
+
+  long long m_pllRFP[NB_RFPSIZE];
+  long long m_llLastRFPts;
+  int       m_nNextRFP;
+  double    m_fRFPStdDev;
+  double    m_fRFPMean;
+};
+
+// Detects the frame duration from the sample time stamps and snaps it to the
+// standard 24/25/30 fps families when close enough
+class CFrameTimeDetector
+{
+public:
+  CFrameTimeDetector();
+  void Reset();
+  // forget the history but keep the last detected value, used after seeks
+  void Restart();
+  void Add(long long diff, bool bStdDev);
+
+  long long m_DetectedFrameTimeHistory[NB_DFTHSIZE];
+  long long m_DectedSum;
+  int       m_DetectedFrameTimePos;
+  double    m_DetectedFrameTime;      // in seconds
+  double    m_DetectedFrameTimeStdDev;
+  bool      m_DetectedLock;
+  double    m_DetFrameTimeAve;        // in seconds
+};
+
+// Number of display cycles per video frame, zero when it isn't stable yet or the
+// frame period is not close to a multiple of the display cycle. frameTime is the
+// detected frame duration in seconds, timePerFrame the one from the media type.
+int FrameRateRatio(double frameTime, long long timePerFrame, double clockRatio, double displayCycle,
+                   int framesProcessed, int framesDrawn, int* pRawRatio);
+
+// How early or late a sample may be presented, a quarter of the display cycle
+// but at most 5 ms
+inline long long LateFrameHysteresis(long long displayTime)
+{
+  return displayTime / 4 < 50000 ? displayTime / 4 : 50000;
+}
+
+// De-sensitises frame dropping: a single late sample, or a late wake up of the
+// scheduler, lets the next few samples be up to a display cycle late before
+// they are dropped
+class CLateFrameControl
+{
+public:
+  CLateFrameControl();
+  void Reset();
+  // Returns how late the sample at the head of the queue may be before it is dropped.
+  // nextSampleTime is negative when the sample is late, delErr is how early the
+  // scheduler woke up on input and the error to widen the vsync window with on
+  // output. bHysteresis is false while the frame rate ratio is unknown or in DVD
+  // menus and scrubbing.
+  long long LateLimit(long long nextSampleTime, long long* pDelErr, long long displayTime, bool bHysteresis);
+  // a sample was presented or dropped
+  void FrameDone();
+
+  int m_iLateFrames;
+  int m_iFramesHeld;  // late samples that were presented anyway
+};
+
+// Keeps the presentation phase of the frames around the middle of the display cycle
+// by speeding up or slowing down the audio renderer clock
+class CPhaseControl
+{
+public:
+  CPhaseControl();
+  void Reset();
+  // phaseDiff is in the -0.5 to 0.5 range, returns the new clock frequency factor
+  double Update(double phaseDiff);
+
+  double m_dPhaseDeviations[NUM_PHASE_DEVIATIONS];
+  int    m_nNextPhDev;
+  double m_sumPhaseDiff;
+  double m_avPhaseDiff;
+  double m_dVariableFreq;
+};
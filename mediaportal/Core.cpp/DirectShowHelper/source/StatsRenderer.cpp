@@ -177,8 +177,8 @@ void StatsRenderer::DrawStats()
                       &m_pFont);
   }
 
-  LONGLONG llMaxJitter = m_pPresenter->m_MaxJitter;
-  LONGLONG llMinJitter = m_pPresenter->m_MinJitter;
+  LONGLONG llMaxJitter = m_pPresenter->m_jitterStats.m_MaxJitter;
+  LONGLONG llMinJitter = m_pPresenter->m_jitterStats.m_MinJitter;
   LONGLONG llMaxSyncOffset = m_pPresenter->m_MaxSyncOffset;
   LONGLONG llMinSyncOffset = m_pPresenter->m_MinSyncOffset;
 
@@ -200,7 +200,7 @@ void StatsRenderer::DrawStats()
     strText.Format("Video: %d x %d %d:%d | Act FPS: %.4f (red)| Drawn: %d | Drop: %d", 
       m_pPresenter->m_iVideoWidth, m_pPresenter->m_iVideoHeight, 
       m_pPresenter->m_iARX, m_pPresenter->m_iARY, 
-      10000000.0 / m_pPresenter->m_fJitterMean, m_pPresenter->m_iFramesDrawn, m_pPresenter->m_iFramesDropped);
+      10000000.0 / m_pPresenter->m_jitterStats.m_fJitterMean, m_pPresenter->m_iFramesDrawn, m_pPresenter->m_iFramesDropped);
     DrawText(rc, strText);
     OffsetRect(&rc, 0, TextHeight);
 
@@ -214,14 +214,14 @@ void StatsRenderer::DrawStats()
 
     strText.Format("Raster offset (ylw): %5.2f ms | SOP: %4d | EOP: %4d | Locked: %d | Derr: %5.2f ms | Q: %d",
       m_pPresenter->m_rasterSyncOffset, m_pPresenter->m_LastStartOfPaintScanline, m_pPresenter->m_LastEndOfPaintScanline, 
-      (int)m_pPresenter->m_DetectedLock, m_pPresenter->m_lastDelayErr/10000.0, (m_pPresenter->m_qScheduledSamples.Count()));
+      (int)m_pPresenter->m_frameTimeDetector.m_DetectedLock, m_pPresenter->m_lastDelayErr/10000.0, (m_pPresenter->m_qScheduledSamples.Count()));
     DrawText(rc, strText);
     OffsetRect(&rc, 0, TextHeight);
 
     strText.Format("Rptd FPS: %.3f | Detd FPS: %.3f | DetFrT_SD: %+5.3f ms | DetSDur: %+5.3f ms",  
       ((m_pPresenter->m_rtTimePerFrame > 0) ? (10000000.0/m_pPresenter->m_rtTimePerFrame) : 0), 
-      ((m_pPresenter->m_DetFrameTimeAve > 0) ? (1.0/(m_pPresenter->m_DetFrameTimeAve)) : 0),
-      (m_pPresenter->m_DetectedFrameTimeStdDev/10000.0), (m_pPresenter->m_SampDuration/10000.0) );
+      ((m_pPresenter->m_frameTimeDetector.m_DetFrameTimeAve > 0) ? (1.0/(m_pPresenter->m_frameTimeDetector.m_DetFrameTimeAve)) : 0),
+      (m_pPresenter->m_frameTimeDetector.m_DetectedFrameTimeStdDev/10000.0), (m_pPresenter->m_SampDuration/10000.0) );
     DrawText(rc, strText);
     OffsetRect(&rc, 0, TextHeight);
 
@@ -230,8 +230,8 @@ void StatsRenderer::DrawStats()
       OffsetRect(&rc, 0, BlankHeight); // Extra "line feed"
   
       strText.Format("Detd bias: %.7f | BiasAdj: %d | AudAdj: %.6f | AvePhDiff: %.6f | NumAdj: %d", 
-        m_pPresenter->m_dBias, m_pPresenter->m_bBiasAdjustmentDone, m_pPresenter->m_dVariableFreq, 
-        m_pPresenter->m_avPhaseDiff, m_pPresenter->m_iClockAdjustmentsDone);
+        m_pPresenter->m_dBias, m_pPresenter->m_bBiasAdjustmentDone, m_pPresenter->m_phaseControl.m_dVariableFreq, 
+        m_pPresenter->m_phaseControl.m_avPhaseDiff, m_pPresenter->m_iClockAdjustmentsDone);
       DrawText(rc, strText);
       OffsetRect(&rc, 0, TextHeight);
 
@@ -329,12 +329,12 @@ void StatsRenderer::DrawStats()
     // jitter curve
     for (int i = 0; i < NB_JITTER; i++)
     {
-      nIndex = (m_pPresenter->m_nNextJitter + 1 + i) % NB_JITTER;
+      nIndex = (m_pPresenter->m_jitterStats.m_nNextJitter + 1 + i) % NB_JITTER;
       if (nIndex < 0)
       {
         nIndex += NB_JITTER;
       }
-      double Jitter = m_pPresenter->m_pllJitter[nIndex] - m_pPresenter->m_fJitterMean;
+      double Jitter = m_pPresenter->m_jitterStats.m_pllJitter[nIndex] - m_pPresenter->m_jitterStats.m_fJitterMean;
       Points[i].x  = (FLOAT)(StartX + (i * 5));
       double offsetY = StartY + Jitter / 3000 + 125;
       if (offsetY < StartY) offsetY = StartY;
@@ -369,7 +369,7 @@ void StatsRenderer::DrawStats()
         nIndex += NB_JITTER;
       }
       Points[i].x = (FLOAT)(StartX + (i * 5));
-      double offsetY = StartY - m_pPresenter->m_pllRasterSyncOffset[nIndex] * 5 + DrawHeight;
+      double offsetY = StartY - m_pPresenter->m_jitterStats.m_pllRasterSyncOffset[nIndex] * 5 + DrawHeight;
       if (offsetY < StartY) offsetY = StartY;
       if (offsetY > StartY+DrawHeight) offsetY = StartY + DrawHeight;
       Points[i].y = (FLOAT)(offsetY);
@@ -0,0 +1,538 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Replays the FontEngineDrawText3D() calls of a TV guide screen through
+// CTextRunCache.
+//
+//   textrunbench [frames]   exits with 1 if a check fails, 3000 frames (a minute) by default
+//
+// Every frame at 50 fps draws the guide of the default skin: 20 channel rows with
+// the channel name and 8 programme titles with their start times, the date and
+// clock in the header, and title, times, genre and a 5 line description of the
+// focused programme. The focus moves every half second, the clock changes every
+// second, the guide pages to the next hour every 10 seconds and a scrolling label
+// moves every frame. Every 20 seconds a font is reloaded with new glyph
+// coordinates, like on a skin or resolution change.
+//
+// Layout() below is the part of FontEngineDrawText3D() that runs on a cache miss,
+// without the Direct3D calls; the viewport and clip rectangle are passed in.
+//
+// Cases:
+//   verify  Every call is laid out afresh and looked up in the cache; a hit has to
+//           return the same vertices bit for bit, also right after a font reload.
+//   replay  Per frame: the time to produce the vertices of all calls laying every
+//           string out as before, and with the cache, and the hit rate.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "TextRunCache.h"
+
+#define MAX_FONTS             20
+#define MAX_TEXTURE_COORDS    8000
+#define MAX_TEXT_LINES        200
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The fields of FONT_DATA_T the layout reads
+struct Font
+{
+  int   iFirstChar;
+  int   iEndChar;
+  float fTextureScale;
+  float fTextureWidth;
+  float fTextureHeight;
+  float fSpacingPerChar;
+  float textureCoord[MAX_TEXTURE_COORDS][4];
+};
+
+// Glyphs of a proportional font on a 512x512 texture, 16 per row
+static void LoadFont(Font& font, float size, int generation)
+{
+  font.iFirstChar = 32;
+  font.iEndChar = 0x17f;
+  font.fTextureScale = 1.0f;
+  font.fTextureWidth = 512.0f;
+  font.fTextureHeight = 512.0f;
+  font.fSpacingPerChar = size / 16.0f;
+  for (int i = 0; i < font.iEndChar - font.iFirstChar; i++)
+  {
+    float w = size * (0.35f + 0.04f * ((i * 7 + generation) % 11));
+    float x = (i % 16) * 32.0f;
+    float y = (i / 16) * (size + 2.0f);
+    font.textureCoord[i][0] = x / 512.0f;
+    font.textureCoord[i][1] = y / 512.0f;
+    font.textureCoord[i][2] = (x + w) / 512.0f;
+    font.textureCoord[i][3] = (y + size) / 512.0f;
+  }
+}
+
+struct Viewport
+{
+  int X, Y, Width, Height;
+};
+
+struct ClipRect
+{
+  int left, top, right, bottom;
+};
+
+// FontEngineDrawText3D() after the cache lookup
+static void Layout(const Font* font, const wchar_t* text, int length, int xposStart, int yposStart, unsigned int intColor,
+                   int maxWidth, const float m[3][4], const Viewport& viewport, const ClipRect* clip,
+                   std::vector<BATCH_VERTEX>& textRunVertices)
+{
+  textRunVertices.clear();
+  float xpos = (float)xposStart;
+  float ypos = (float)yposStart;
+  xpos -= font->fSpacingPerChar;
+  xpos-=0.5f;
+  float fStartX = xpos;
+  ypos -=0.5f;
+  float fStartY = ypos;
+
+  float yoff    = (font->textureCoord[0][3]-font->textureCoord[0][1])*font->fTextureHeight;
+  float fScaleX = font->fTextureWidth  / font->fTextureScale;
+  float fScaleY = font->fTextureHeight / font->fTextureScale;
+  float fSpacing= 2 * font->fSpacingPerChar;
+
+  if (maxWidth <=0)
+  {
+    maxWidth=2000;
+  }
+
+  float totalWidth = 0;
+  float lineWidths[MAX_TEXT_LINES];
+  int lineNr=0;
+  for (int i=0; i < length;++i)
+  {
+    wchar_t c=text[i];
+    if (c == '\n')
+    {
+      if (lineNr >= MAX_TEXT_LINES-1)
+        continue;
+
+      lineWidths[lineNr]=totalWidth;
+      totalWidth=0;
+      xpos = fStartX;
+      ypos += yoff;
+      lineNr++;
+      continue;
+    }
+    else if (c < font->iFirstChar || c >= font->iEndChar)
+      continue;
+    else if (totalWidth >= maxWidth)
+      continue;
+
+    int index=c-font->iFirstChar;
+    float tx1 = font->textureCoord[index][0];
+    float tx2 = font->textureCoord[index][2];
+
+    float w = (tx2-tx1) * fScaleX;
+    totalWidth += (w - fSpacing);
+    xpos += (w - fSpacing);
+    lineWidths[lineNr]=totalWidth;
+  }
+
+  totalWidth=0;
+  xpos = fStartX;
+  ypos = fStartY;
+  lineNr=0;
+
+  for (int i=0; i < length;++i)
+  {
+    wchar_t c=text[i];
+    if (c == '\n')
+    {
+      totalWidth=0;
+      xpos = fStartX;
+      ypos += yoff;
+      lineNr++;
+      continue;
+    }
+    else if (c < font->iFirstChar || c >= font->iEndChar)
+      continue;
+    else if (totalWidth >= maxWidth)
+      continue;
+
+    int index=c-font->iFirstChar;
+    float tx1 = font->textureCoord[index][0];
+    float ty1 = font->textureCoord[index][1];
+    float tx2 = font->textureCoord[index][2];
+    float ty2 = font->textureCoord[index][3];
+
+    float w = (tx2-tx1) * fScaleX;
+    float h = (ty2-ty1) * fScaleY;
+
+    float xpos1 = xpos;
+    float ypos1 = ypos;
+    float xpos2 = xpos + w;
+    float ypos2 = ypos + h;
+
+    if(xpos1 < (viewport.X + viewport.Width) && xpos2 >= viewport.X &&
+      ypos1 < (viewport.Y + viewport.Height) && ypos2 >= viewport.Y)
+    {
+      if (clip != NULL)
+      {
+        float minX = clip->left;
+        float minY = clip->top;
+        float maxX = clip->right;
+        float maxY = clip->bottom;
+
+        if (xpos1 < maxX && xpos2 >= minX &&
+          ypos1 < maxY && ypos2 >= minY)
+        {
+          if(xpos1 < minX)
+          {
+            tx1 += (minX - xpos1) / fScaleX;
+            xpos1 += minX - xpos1;
+          }
+          if(xpos2 > maxX)
+          {
+            tx2 -= (xpos2 - maxX) / fScaleX;
+            xpos2 -= xpos2 - maxX;
+          }
+          if(ypos1 < minY)
+          {
+            ty1 += (minY - ypos1) / fScaleY;
+            ypos1 += minY - ypos1;
+          }
+          if(ypos2 > maxY)
+          {
+            ty2 -= (ypos2 - maxY) / fScaleY;
+            ypos2 -= ypos2 - maxY;
+          }
+        }
+        else
+        {
+          continue;
+        }
+      }
+
+      int alpha1=intColor;
+      int alpha2=intColor;
+      if ((lineNr >= MAX_TEXT_LINES || lineWidths[lineNr] >= maxWidth) && totalWidth+50 >= maxWidth && maxWidth > 0 && maxWidth < 2000)
+      {
+        int maxAlpha=intColor>>24;
+        float diff=(float)(maxWidth-totalWidth);
+        diff/=50.0f;
+        if (diff>1) diff = 1;
+        alpha1=(int)(maxAlpha * diff);
+
+        diff=(float)(maxWidth-totalWidth);
+        diff+=(w - fSpacing);
+        diff/=50.0f;
+        if (diff>1) diff = 1;
+        alpha2=(int)(maxAlpha * diff);
+
+        if (alpha1<0) alpha1=0;
+        if (alpha1>0xff) alpha1=maxAlpha;
+        if (alpha2<0) alpha2=0;
+        if (alpha2>0xff) alpha2=maxAlpha;
+
+        alpha1 <<=24;
+        alpha2 <<=24;
+        alpha1|= (intColor & 0xffffff);
+        alpha2|= (intColor & 0xffffff);
+      }
+      float vx[4], vy[4], vz[4];
+      TransformQuad(m, xpos1, ypos1, xpos2, ypos2, vx, vy, vz);
+
+      const float tu[4]={tx1, tx1, tx2, tx2};
+      const float tv[4]={ty1, ty2, ty2, ty1};
+      const unsigned int color[4]={(unsigned int)alpha2, (unsigned int)alpha2, (unsigned int)alpha1, (unsigned int)alpha1};
+      for (int v=0; v < 4; ++v)
+      {
+        BATCH_VERTEX vertex;
+        vertex.x = vx[v];
+        vertex.y = vy[v];
+        vertex.z = vz[v];
+        vertex.color = color[v];
+        vertex.tu = tu[v];
+        vertex.tv = tv[v];
+        textRunVertices.push_back(vertex);
+      }
+    }
+    totalWidth += (w - fSpacing);
+    xpos += (w - fSpacing);
+  }
+}
+
+// One FontEngineDrawText3D() call
+struct TextCall
+{
+  int          font;
+  std::wstring text;
+  int          x, y;
+  unsigned int color;
+  int          maxWidth;
+  bool         clip;
+};
+
+static const wchar_t* s_titles[] = {
+  L"Tagesschau", L"Wetter", L"Tatort: Das Muli", L"Anne Will", L"Nachtmagazin", L"Sportschau",
+  L"Die Sendung mit der Maus", L"Börse vor acht", L"Formel 1: Großer Preis von Belgien", L"heute-journal",
+  L"Markus Lanz", L"Der Bergdoktor", L"Terra X: Faszination Erde", L"Löwenzahn", L"ZDF SPORTextra",
+  L"Inspector Barnaby", L"Rote Rosen", L"Sturm der Liebe", L"Brisant", L"Quizduell", L"Gefragt - Gejagt",
+  L"Wer weiß denn sowas?", L"In aller Freundschaft", L"Tagesthemen", L"Polizeiruf 110", L"Die Anstalt",
+};
+
+static const wchar_t* s_channels[] = {
+  L"Das Erste HD", L"ZDF HD", L"3sat HD", L"arte HD", L"WDR HD Köln", L"NDR FS NDS HD", L"BR Fernsehen Süd HD",
+  L"hr-fernsehen HD", L"SWR BW HD", L"MDR Sachsen HD", L"rbb Berlin HD", L"phoenix HD", L"KiKA HD", L"ONE HD",
+  L"ZDFneo HD", L"ZDFinfo HD", L"tagesschau24 HD", L"ARD-alpha HD", L"RTL", L"SAT.1",
+};
+
+class CGuideScreen
+{
+public:
+  CGuideScreen() : m_frame(0) {}
+
+  void Next(std::vector<TextCall>& calls)
+  {
+    calls.clear();
+    int second = m_frame / 50;
+    int page = m_frame / 500;
+    int focus = (m_frame / 25) % 160;
+    wchar_t buf[512];
+
+    swprintf(buf, 512, L"Sonntag, %d. August", 1 + page % 31);
+    Add(calls, 2, buf, 40, 20, 0xffffffff, 0, false);
+    swprintf(buf, 512, L"%02d:%02d", (20 + second / 3600) % 24, (second / 60) % 60);
+    Add(calls, 2, buf, 1780, 20, 0xffffffff, 0, false);
+    swprintf(buf, 512, L"%02d:%02d:%02d", (20 + second / 3600) % 24, (second / 60) % 60, second % 60);
+    Add(calls, 1, buf, 1780, 60, 0xffa0a0a0, 0, false);
+
+    for (int col = 0; col < 8; col++)
+    {
+      swprintf(buf, 512, L"%02d:%02d", (20 + page + col / 2) % 24, (col % 2) * 30);
+      Add(calls, 1, buf, 180 + col * 150, 110, 0xffffffff, 0, false);
+    }
+    for (int row = 0; row < 20; row++)
+    {
+      int y = 150 + row * 42;
+      Add(calls, 0, s_channels[row], 20, y, 0xffffffff, 150, false);
+      for (int col = 0; col < 8; col++)
+      {
+        const wchar_t* title = s_titles[(row * 5 + col * 3 + page * 7) % (sizeof(s_titles) / sizeof(s_titles[0]))];
+        unsigned int color = (row * 8 + col == focus) ? 0xff000000 : 0xffffffff;
+        // the last column is cut at the right edge of the grid
+        Add(calls, 0, title, 186 + col * 150, y + 6, color, 136, col == 7);
+      }
+    }
+
+    const wchar_t* title = s_titles[(focus * 7 + page) % (sizeof(s_titles) / sizeof(s_titles[0]))];
+    Add(calls, 2, title, 40, 1000, 0xffffffff, 900, false);
+    swprintf(buf, 512, L"%02d:%02d - %02d:%02d  (%d min)", 20 + focus % 4, 15, 21 + focus % 4, 0, 45);
+    Add(calls, 1, buf, 40, 1040, 0xffa0a0a0, 0, false);
+    Add(calls, 1, L"Krimi, Deutschland 2019", 600, 1040, 0xffa0a0a0, 0, false);
+    swprintf(buf, 512, L"Ein Toter im Wald gibt den Ermittlern Rätsel auf. Folge %d der Reihe.\n"
+                       L"Die Spur führt zu einem Hof, auf dem seit Jahren niemand mehr lebt.\n"
+                       L"Während die Kommissarin die Nachbarn befragt, verschwindet ein Zeuge.\n"
+                       L"Mit Ulrike Folkerts, Andreas Hoppe und Lisa Bitter.\n"
+                       L"Regie: Tom Bohn, Buch: Stefan Dähnert", 100 + focus);
+    Add(calls, 1, buf, 1000, 1000, 0xffffffff, 880, false);
+
+    // scrolling label, the text moves through the clip rectangle
+    Add(calls, 1, L"+++ Eilmeldung: Unwetterwarnung für Teile Norddeutschlands +++", 1900 - (m_frame * 2) % 2400, 1070,
+        0xffffff00, 0, true);
+    m_frame++;
+  }
+
+private:
+  static void Add(std::vector<TextCall>& calls, int font, const wchar_t* text, int x, int y, unsigned int color,
+                  int maxWidth, bool clip)
+  {
+    TextCall call;
+    call.font = font;
+    call.text = text;
+    call.x = x;
+    call.y = y;
+    call.color = color;
+    call.maxWidth = maxWidth;
+    call.clip = clip;
+    calls.push_back(call);
+  }
+
+  int m_frame;
+};
+
+// GUI transform of a skin designed for 1280x720 on a 1920x1080 display
+static void SkinMatrix(float m[3][4])
+{
+  memset(m, 0, sizeof(float) * 12);
+  m[0][0] = 1.5f;
+  m[1][1] = 1.5f;
+  m[2][2] = 1.0f;
+}
+
+static const Viewport s_viewport = { 0, 0, 1920, 1080 };
+static const ClipRect s_clip = { 180, 0, 1380, 1080 };
+
+static void MakeKey(const TextCall& call, const float m[3][4], TEXT_RUN_KEY& key)
+{
+  memset(&key, 0, sizeof(key));
+  key.font = call.font;
+  key.x = call.x;
+  key.y = call.y;
+  key.color = call.color;
+  key.maxWidth = call.maxWidth;
+  memcpy(key.matrix, m, sizeof(key.matrix));
+  key.viewport[0] = s_viewport.X;
+  key.viewport[1] = s_viewport.Y;
+  key.viewport[2] = s_viewport.Width;
+  key.viewport[3] = s_viewport.Height;
+  if (call.clip)
+  {
+    key.clip[0] = s_clip.left;
+    key.clip[1] = s_clip.top;
+    key.clip[2] = s_clip.right;
+    key.clip[3] = s_clip.bottom;
+  }
+}
+
+struct ReplayResult
+{
+  long   calls;
+  long   hits;
+  long   vertices;
+  long   mismatches;
+  double seconds;
+};
+
+// Plays the guide with the fonts reloaded every reloadFrames frames. cached uses
+// the cache like FontEngineDrawText3D(), verify lays out every call and compares
+// it with what the cache returned.
+static ReplayResult Replay(int frames, bool cached, bool verify)
+{
+  static Font fonts[3];
+  const float sizes[3] = { 22.0f, 18.0f, 28.0f };
+  int generation = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    LoadFont(fonts[i], sizes[i], generation);
+  }
+  const int reloadFrames = 1000;
+
+  float m[3][4];
+  SkinMatrix(m);
+  EnableTransformSSE(true);
+
+  // same size as the engine's
+  CTextRunCache cache(MAX_FONTS, 1024);
+  CGuideScreen screen;
+  std::vector<TextCall> calls;
+  std::vector<BATCH_VERTEX> vertices, fresh;
+  ReplayResult r = { 0, 0, 0, 0, 0.0 };
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    if (frame > 0 && frame % reloadFrames == 0)
+    {
+      int font = (frame / reloadFrames) % 3;
+      LoadFont(fonts[font], sizes[font], ++generation);
+      cache.InvalidateFont(font);
+    }
+    screen.Next(calls);
+
+    double start = Now();
+    for (size_t i = 0; i < calls.size(); i++)
+    {
+      const TextCall& call = calls[i];
+      const wchar_t* text = call.text.c_str();
+      int length = (int)call.text.length();
+      const ClipRect* clip = call.clip ? &s_clip : NULL;
+
+      if (!cached)
+      {
+        Layout(&fonts[call.font], text, length, call.x, call.y, call.color, call.maxWidth, m, s_viewport, clip, vertices);
+        r.vertices += (long)vertices.size();
+        continue;
+      }
+
+      TEXT_RUN_KEY key;
+      MakeKey(call, m, key);
+      int numVertices;
+      const BATCH_VERTEX* hit = cache.Find(key, text, length, &numVertices);
+      if (hit != NULL)
+      {
+        r.hits++;
+        r.vertices += numVertices;
+        if (verify)
+        {
+          Layout(&fonts[call.font], text, length, call.x, call.y, call.color, call.maxWidth, m, s_viewport, clip, fresh);
+          if (numVertices != (int)fresh.size() ||
+              (numVertices > 0 && memcmp(hit, &fresh[0], numVertices * sizeof(BATCH_VERTEX)) != 0))
+          {
+            r.mismatches++;
+          }
+        }
+        continue;
+      }
+      Layout(&fonts[call.font], text, length, call.x, call.y, call.color, call.maxWidth, m, s_viewport, clip, vertices);
+      cache.Store(key, text, length, vertices.empty() ? NULL : &vertices[0], (int)vertices.size());
+      r.vertices += (long)vertices.size();
+    }
+    r.seconds += Now() - start;
+    r.calls += (long)calls.size();
+  }
+  return r;
+}
+
+static int CheckVerify(int frames)
+{
+  ReplayResult r = Replay(frames, true, true);
+  bool ok = r.mismatches == 0 && r.hits > 0;
+  printf("verify  %ld calls, %ld hits, %ld differ from a fresh layout: %s\n", r.calls, r.hits, r.mismatches, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+static int CheckReplay(int frames)
+{
+  ReplayResult before = Replay(frames, false, false);
+  ReplayResult after = Replay(frames, true, false);
+  printf("replay  %ld calls, %ld vertices per frame\n", before.calls / frames, before.vertices / frames);
+  printf("replay  before: %6.1f us per frame\n", before.seconds * 1e6 / frames);
+  bool ok = after.vertices == before.vertices;
+  printf("replay  after:  %6.1f us per frame, %.1f%% hits: %s\n", after.seconds * 1e6 / frames,
+    100.0 * after.hits / after.calls, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+  int frames = argc > 1 ? atoi(argv[1]) : 3000;
+  if (frames <= 0)
+  {
+    printf("usage: textrunbench [frames]\n");
+    return 1;
+  }
+
+  int failed = CheckVerify(frames) + CheckReplay(frames);
+  if (failed)
+  {
+    printf("%d case(s) FAILED\n", failed);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,572 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Replays a skin frame through the CPU side of FontEngineDrawTexture() and
+// FontEnginePresentTextures(), once the way fontEngine.cpp did it before the quads
+// were batched and once through TextureBatch.cpp.
+//
+//   texturebatchbench [frames]   exits with 1 if a check fails, 2000 frames by default
+//
+// The frame is laid out like the TV guide of the default skin over a fanart
+// backdrop: 20 channel rows of 8 programme buttons (3 quads each) with a genre
+// strip, a logo texture per channel, a wall of 40 thumbnails with bordered frames
+// (9 quads each) and 600 rating stars, about 1650 quads on 65 textures. Buttons,
+// strips, frames and stars come from packed skin textures. Every frame the focus
+// and the progress bar move, so the textures holding them change like they do
+// while the guide is shown.
+//
+// Cases:
+//   slots      FontEngineAddTexture() of 1500 textures: the linear scan of all 2000
+//              slots against CTextureSlotMap. Every hash code has to keep a slot
+//              of its own.
+//   transform  TransformQuad() with SSE against the scalar TransformMatrix code the
+//              engine used before, on every quad of the frame. The corners have to
+//              be the same bit for bit, with and without SSE.
+//   present    Per frame: the vertex buffer locks and draw calls, and the time to
+//              build the vertices and copy them to the (emulated) vertex buffers.
+//              The batch has to hold the vertices of all textures in queue order,
+//              and without a discard the ring must never hand out a range again.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "TextureBatch.h"
+#include "TransformMatrix.h"
+
+#define MAX_TEXTURES           2000
+#define MaxNumTextureVertices  3000
+#define MaxNumBatchVertices    32768
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int s_seed = 20110301;
+
+static int Random(int range)
+{
+  s_seed = s_seed * 1103515245 + 12345;
+  return (int)((s_seed >> 8) % (unsigned int)range);
+}
+
+// One FontEngineDrawTexture() call
+struct Quad
+{
+  int          texture;
+  float        x, y, w, h;
+  float        u, v, du, dv;
+  unsigned int color;
+};
+
+struct Texture
+{
+  int  hashCode;
+  bool alphaBlend;
+};
+
+class CSkinFrame
+{
+public:
+  CSkinFrame()
+  {
+    // backdrop, the packed skin textures and the logos, thumbnails and the star
+    // texture, in the order the guide window draws them first
+    m_backdrop = AddTexture(false);
+    m_buttons = AddTexture(true);
+    m_strips = AddTexture(true);
+    for (int i = 0; i < 20; i++)
+    {
+      m_logos[i] = AddTexture(true);
+    }
+    for (int i = 0; i < 40; i++)
+    {
+      m_thumbs[i] = AddTexture(false);
+    }
+    m_frames = AddTexture(true);
+    m_stars = AddTexture(true);
+    m_frame = 0;
+  }
+
+  const std::vector<Texture>& Textures() const { return m_textures; }
+
+  // Builds the draw calls of the next frame
+  void Next(std::vector<Quad>& quads)
+  {
+    quads.clear();
+    Add(quads, m_backdrop, 0, 0, 1920, 1080, 0, 0, 1, 1);
+
+    int focus = m_frame % 160;
+    for (int row = 0; row < 20; row++)
+    {
+      float y = 150.0f + row * 42.0f;
+      Add(quads, m_logos[row], 40, y, 120, 38, 0, 0, 1, 1);
+      for (int col = 0; col < 8; col++)
+      {
+        float x = 180.0f + col * 150.0f;
+        float v = (row * 8 + col == focus) ? 0.5f : 0.0f;
+        AddButton(quads, m_buttons, x, y, 146, 38, v);
+        Add(quads, m_strips, x + 4, y + 34, 138, 4, (row * 3 + col) % 8 * 0.125f, 0, 0.125f, 1);
+      }
+    }
+    // progress bar of the programme on now
+    Add(quads, m_strips, 180, 130, 1200.0f * (m_frame % 500) / 500.0f, 8, 0, 0.5f, 1, 0.5f);
+
+    for (int i = 0; i < 40; i++)
+    {
+      float x = 1400.0f + (i % 4) * 125.0f;
+      float y = 150.0f + (i / 4) * 90.0f;
+      Add(quads, m_thumbs[i], x, y, 120, 80, 0, 0, 1, 1);
+      AddBordered(quads, m_frames, x - 2, y - 2, 124, 84);
+    }
+    for (int i = 0; i < 600; i++)
+    {
+      Add(quads, m_stars, 1400.0f + (i % 40) * 12.0f, 1000.0f + (i / 40) * 5.0f, 10, 4, 0, 0, 1, 1);
+    }
+    m_frame++;
+  }
+
+private:
+  int AddTexture(bool alphaBlend)
+  {
+    Texture texture;
+    texture.hashCode = Random(0x7fffffff);
+    texture.alphaBlend = alphaBlend;
+    m_textures.push_back(texture);
+    return (int)m_textures.size() - 1;
+  }
+
+  static void Add(std::vector<Quad>& quads, int texture, float x, float y, float w, float h,
+                  float u, float v, float du, float dv)
+  {
+    Quad quad = { texture, x, y, w, h, u, v, du, dv, 0xffffffff };
+    quads.push_back(quad);
+  }
+
+  // left end, middle and right end of a button
+  static void AddButton(std::vector<Quad>& quads, int texture, float x, float y, float w, float h, float v)
+  {
+    const float xs[4] = { x, x + 12, x + w - 12, x + w };
+    const float us[4] = { 0.0f, 0.0625f, 0.1875f, 0.25f };
+    for (int i = 0; i < 3; i++)
+    {
+      Add(quads, texture, xs[i], y, xs[i + 1] - xs[i], h, us[i], v, us[i + 1] - us[i], 0.25f);
+    }
+  }
+
+  // corners, edges and center of a frame with an 8 pixel border
+  static void AddBordered(std::vector<Quad>& quads, int texture, float x, float y, float w, float h)
+  {
+    const float xs[4] = { x, x + 8, x + w - 8, x + w };
+    const float ys[4] = { y, y + 8, y + h - 8, y + h };
+    const float us[4] = { 0.0f, 0.0625f, 0.1875f, 0.25f };
+    const float vs[4] = { 0.0f, 0.0625f, 0.1875f, 0.25f };
+    for (int j = 0; j < 3; j++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        Add(quads, texture, xs[i], ys[j], xs[i + 1] - xs[i], ys[j + 1] - ys[j], us[i], vs[j], us[i + 1] - us[i], vs[j + 1] - vs[j]);
+      }
+    }
+  }
+
+  std::vector<Texture> m_textures;
+  int                  m_backdrop;
+  int                  m_buttons;
+  int                  m_strips;
+  int                  m_logos[20];
+  int                  m_thumbs[40];
+  int                  m_frames;
+  int                  m_stars;
+  int                  m_frame;
+};
+
+// GUI transform of a skin designed for 1280x720 on a 1920x1080 display
+static void SkinMatrix(float m[3][4])
+{
+  memset(m, 0, sizeof(float) * 12);
+  m[0][0] = 1.5f;
+  m[1][1] = 1.5f;
+  m[0][3] = 0.25f;
+  m[1][3] = -0.75f;
+  m[2][2] = 1.0f;
+}
+
+// Vertices and change flag of a texture slot, like TEXTURE_DATA_T
+struct Slot
+{
+  BATCH_VERTEX vertices[MaxNumTextureVertices];
+  int          iv;
+  bool         updateVertexBuffer;
+  BATCH_VERTEX uploaded[MaxNumTextureVertices];  // the texture's own vertex buffer
+};
+
+//*******************************************************************************************************************
+static int CheckSlots()
+{
+  const int count = 1500;
+  std::vector<int> hashCodes(count);
+  for (int i = 0; i < count; i++)
+  {
+    hashCodes[i] = Random(0x7fffffff);
+  }
+
+  // FontEngineAddTexture() before: the first slot with the hash code, else the last free one
+  std::vector<int> linear(MAX_TEXTURES, -1);
+  std::vector<int> linearSlots(count);
+  double start = Now();
+  for (int n = 0; n < count; n++)
+  {
+    int selected = -1;
+    for (int i = 0; i < MAX_TEXTURES; ++i)
+    {
+      if (linear[i] == hashCodes[n])
+      {
+        selected = i;
+        break;
+      }
+      if (linear[i] == -1)
+      {
+        selected = i;
+      }
+    }
+    linear[selected] = hashCodes[n];
+    linearSlots[n] = selected;
+  }
+  double linearTime = Now() - start;
+
+  CTextureSlotMap map(MAX_TEXTURES);
+  std::vector<int> mapSlots(count);
+  start = Now();
+  for (int n = 0; n < count; n++)
+  {
+    mapSlots[n] = map.Add(hashCodes[n]);
+  }
+  double mapTime = Now() - start;
+
+  // both fill the slots from one end, the scan from the top and the map from the
+  // bottom; what matters is that every hash code keeps its slot and none is shared
+  bool ok = true;
+  std::vector<bool> used(MAX_TEXTURES, false);
+  for (int n = 0; n < count; n++)
+  {
+    ok = ok && linearSlots[n] == MAX_TEXTURES - 1 - n && mapSlots[n] >= 0 && !used[mapSlots[n]];
+    if (mapSlots[n] >= 0)
+    {
+      used[mapSlots[n]] = true;
+    }
+    ok = ok && map.Find(hashCodes[n]) == mapSlots[n] && map.Add(hashCodes[n]) == mapSlots[n];
+  }
+  printf("slots      %d textures: linear scan %.2f us, slot map %.3f us per add: %s\n",
+    count, linearTime * 1e6 / count, mapTime * 1e6 / count, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+//*******************************************************************************************************************
+static void ScalarQuad(const TransformMatrix& matrix, float x1, float y1, float x2, float y2, float* px, float* py, float* pz)
+{
+  const float xs[4] = { x1, x1, x2, x2 };
+  const float ys[4] = { y1, y2, y2, y1 };
+  for (int i = 0; i < 4; i++)
+  {
+    px[i] = matrix.ScaleFinalXCoord(xs[i], ys[i]);
+    py[i] = matrix.ScaleFinalYCoord(xs[i], ys[i]);
+    pz[i] = matrix.ScaleFinalZCoord(xs[i], ys[i]);
+  }
+}
+
+static int CheckTransform(const std::vector<Quad>& quads)
+{
+  float m[3][4];
+  SkinMatrix(m);
+  // a rotated and scaled matrix as well, for the animations
+  float r[3][4] = { { 1.2f, -0.3f, 0.0f, 17.5f }, { 0.28f, 1.17f, 0.0f, -3.25f }, { 0.001f, 0.002f, 1.0f, 0.5f } };
+  const float (*matrices[2])[4] = { m, r };
+  TransformMatrix skinTransform(m), rotateTransform(r);
+  const TransformMatrix* transforms[2] = { &skinTransform, &rotateTransform };
+
+  int failed = 0;
+  for (int sse = 0; sse < 2; sse++)
+  {
+    EnableTransformSSE(sse != 0);
+    int mismatches = 0;
+    for (int t = 0; t < 2; t++)
+    {
+      for (size_t i = 0; i < quads.size(); i++)
+      {
+        const Quad& q = quads[i];
+        float ax[4], ay[4], az[4], bx[4], by[4], bz[4];
+        TransformQuad(matrices[t], q.x - 0.5f, q.y - 0.5f, q.x + q.w - 0.5f, q.y + q.h - 0.5f, ax, ay, az);
+        ScalarQuad(*transforms[t], q.x - 0.5f, q.y - 0.5f, q.x + q.w - 0.5f, q.y + q.h - 0.5f, bx, by, bz);
+        mismatches += memcmp(ax, bx, sizeof(ax)) != 0 || memcmp(ay, by, sizeof(ay)) != 0 || memcmp(az, bz, sizeof(az)) != 0;
+      }
+    }
+    bool ok = mismatches == 0;
+    printf("transform  %s: %d of %d quads differ from TransformMatrix: %s\n",
+      sse ? "sse   " : "scalar", mismatches, (int)quads.size() * 2, ok ? "ok" : "FAILED");
+    failed += ok ? 0 : 1;
+  }
+  return failed;
+}
+
+//*******************************************************************************************************************
+struct PresentResult
+{
+  int    frames;
+  long   quads;
+  long   locks;
+  long   draws;
+  double seconds;
+  bool   ok;
+};
+
+// Fills the vertices of a slot like FontEngineDrawTexture() without the clipping
+static void DrawQuad(Slot& slot, const float m[3][4], const TransformMatrix& matrix, const Quad& q, bool batched)
+{
+  if (slot.iv + 6 >= MaxNumTextureVertices)
+  {
+    return;
+  }
+  float vx[4], vy[4], vz[4];
+  float x1 = q.x - 0.5f, y1 = q.y - 0.5f, x2 = q.x + q.w - 0.5f, y2 = q.y + q.h - 0.5f;
+  if (batched)
+  {
+    TransformQuad(m, x1, y1, x2, y2, vx, vy, vz);
+  }
+  else
+  {
+    ScalarQuad(matrix, x1, y1, x2, y2, vx, vy, vz);
+  }
+  const float tu[4] = { q.u, q.u, q.u + q.du, q.u + q.du };
+  const float tv[4] = { q.v, q.v + q.dv, q.v + q.dv, q.v };
+  for (int i = 0; i < 4; i++)
+  {
+    BATCH_VERTEX& vertex = slot.vertices[slot.iv + i];
+    if (!batched && (vertex.x != vx[i] || vertex.y != vy[i] || vertex.z != vz[i] ||
+                     vertex.color != q.color || vertex.tu != tu[i] || vertex.tv != tv[i]))
+    {
+      // only the per texture vertex buffers needed to know what changed
+      slot.updateVertexBuffer = true;
+    }
+    vertex.x = vx[i];
+    vertex.y = vy[i];
+    vertex.z = vz[i];
+    vertex.color = q.color;
+    vertex.tu = tu[i];
+    vertex.tv = tv[i];
+  }
+  slot.iv += 4;
+}
+
+static PresentResult Present(CSkinFrame& skin, int frames, bool batched)
+{
+  const std::vector<Texture>& textures = skin.Textures();
+  std::vector<Slot> slots(textures.size());
+  for (size_t i = 0; i < slots.size(); i++)
+  {
+    memset(&slots[i], 0, sizeof(Slot));
+  }
+  std::vector<int> textureZ;
+  std::vector<bool> queued(textures.size());
+
+  float m[3][4];
+  SkinMatrix(m);
+  TransformMatrix matrix(m);
+  EnableTransformSSE(true);
+
+  CTextureBatch batch(MaxNumBatchVertices, MaxNumTextureVertices);
+  CVertexRing ring(MaxNumBatchVertices);
+  std::vector<BATCH_VERTEX> buffer(MaxNumBatchVertices);
+  int inUse = 0;   // end of the ranges handed out since the last discard
+
+  PresentResult r = { frames, 0, 0, 0, 0.0, true };
+  std::vector<Quad> quads;
+  for (int frame = 0; frame < frames; frame++)
+  {
+    skin.Next(quads);
+    double start = Now();
+
+    textureZ.clear();
+    for (size_t i = 0; i < queued.size(); i++)
+    {
+      queued[i] = false;
+    }
+    for (size_t i = 0; i < quads.size(); i++)
+    {
+      int t = quads[i].texture;
+      if (!queued[t])
+      {
+        queued[t] = true;
+        textureZ.push_back(t);
+      }
+      DrawQuad(slots[t], m, matrix, quads[i], batched);
+    }
+
+    if (!batched)
+    {
+      // one lock per changed texture and one draw call per texture
+      for (size_t z = 0; z < textureZ.size(); z++)
+      {
+        Slot& slot = slots[textureZ[z]];
+        if (slot.updateVertexBuffer)
+        {
+          memcpy(slot.uploaded, slot.vertices, slot.iv * sizeof(BATCH_VERTEX));
+          slot.updateVertexBuffer = false;
+          r.locks++;
+        }
+        r.draws++;
+        slot.iv = 0;
+      }
+    }
+    else
+    {
+      // FontEnginePresentTextures() and DrawTextureBatch(), a full batch is drawn
+      // and the rest goes into the next one
+      for (size_t z = 0; z <= textureZ.size(); z++)
+      {
+        Slot* slot = z < textureZ.size() ? &slots[textureZ[z]] : NULL;
+        if (slot != NULL && batch.Add(slot, textures[textureZ[z]].alphaBlend, slot->vertices, slot->iv))
+        {
+          slot->iv = 0;
+          continue;
+        }
+        if (batch.VertexCount() > 0)
+        {
+          bool discard;
+          int first = ring.Reserve(batch.VertexCount(), &discard);
+          // without DISCARD the gpu may still read everything handed out before
+          if (discard)
+          {
+            inUse = 0;
+          }
+          if (first < 0 || first < inUse)
+          {
+            r.ok = false;
+          }
+          else
+          {
+            inUse = first + batch.VertexCount();
+            memcpy(&buffer[first], batch.Vertices(), batch.VertexCount() * sizeof(BATCH_VERTEX));
+          }
+          r.locks++;
+          r.draws += batch.RunCount();
+          batch.Clear();
+        }
+        if (slot != NULL)
+        {
+          batch.Add(slot, textures[textureZ[z]].alphaBlend, slot->vertices, slot->iv);
+          slot->iv = 0;
+        }
+      }
+    }
+    r.seconds += Now() - start;
+    r.quads += (long)quads.size();
+  }
+  return r;
+}
+
+// The vertices of the batch have to be those of the textures in queue order, the
+// runs have to cover them back to back
+static bool CheckBatchOrder(CSkinFrame& skin)
+{
+  const std::vector<Texture>& textures = skin.Textures();
+  std::vector<Quad> quads;
+  skin.Next(quads);
+
+  float m[3][4];
+  SkinMatrix(m);
+  TransformMatrix matrix(m);
+  std::vector<Slot> slots(textures.size());
+  std::vector<int> textureZ;
+  std::vector<bool> queued(textures.size(), false);
+  for (size_t i = 0; i < slots.size(); i++)
+  {
+    memset(&slots[i], 0, sizeof(Slot));
+  }
+  for (size_t i = 0; i < quads.size(); i++)
+  {
+    int t = quads[i].texture;
+    if (!queued[t])
+    {
+      queued[t] = true;
+      textureZ.push_back(t);
+    }
+    DrawQuad(slots[t], m, matrix, quads[i], true);
+  }
+
+  CTextureBatch batch(MaxNumBatchVertices, MaxNumTextureVertices);
+  std::vector<BATCH_VERTEX> expected;
+  for (size_t z = 0; z < textureZ.size(); z++)
+  {
+    Slot& slot = slots[textureZ[z]];
+    if (!batch.Add(&slot, textures[textureZ[z]].alphaBlend, slot.vertices, slot.iv))
+    {
+      return false;
+    }
+    expected.insert(expected.end(), slot.vertices, slot.vertices + slot.iv);
+  }
+
+  bool ok = batch.VertexCount() == (int)expected.size() &&
+            memcmp(batch.Vertices(), &expected[0], expected.size() * sizeof(BATCH_VERTEX)) == 0;
+  int next = 0;
+  for (int i = 0; i < batch.RunCount(); i++)
+  {
+    const BATCH_RUN& run = batch.Run(i);
+    ok = ok && run.firstVertex == next && run.numVertices <= MaxNumTextureVertices && run.numVertices % 4 == 0;
+    next += run.numVertices;
+  }
+  return ok && next == batch.VertexCount();
+}
+
+static int CheckPresent(int frames)
+{
+  CSkinFrame before, after, order;
+  PresentResult b = Present(before, frames, false);
+  PresentResult a = Present(after, frames, true);
+  bool ordered = CheckBatchOrder(order);
+
+  printf("present    %ld quads on %d textures per frame\n", a.quads / frames, (int)after.Textures().size());
+  printf("present    before: %5.1f locks, %5.1f draw calls, %6.1f us per frame\n",
+    (double)b.locks / frames, (double)b.draws / frames, b.seconds * 1e6 / frames);
+  bool ok = a.ok && ordered;
+  printf("present    after:  %5.1f locks, %5.1f draw calls, %6.1f us per frame: %s\n",
+    (double)a.locks / frames, (double)a.draws / frames, a.seconds * 1e6 / frames, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+  int frames = argc > 1 ? atoi(argv[1]) : 2000;
+  if (frames <= 0)
+  {
+    printf("usage: texturebatchbench [frames]\n");
+    return 1;
+  }
+
+  std::vector<Quad> quads;
+  CSkinFrame skin;
+  skin.Next(quads);
+
+  int failed = CheckSlots() + CheckTransform(quads) + CheckPresent(frames);
+  if (failed)
+  {
+    printf("%d case(s) FAILED\n", failed);
+    return 1;
+  }
+  return 0;
+}
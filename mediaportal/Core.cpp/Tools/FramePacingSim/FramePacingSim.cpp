@@ -0,0 +1,575 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Drives the frame pacing engine with a synthetic display and content.
+//
+//   framepacingsim       runs every case, exits with 1 if one fails
+//   framepacingsim -v    also prints the engine's log lines
+//
+// Cases:
+//   refresh    MeasureRefreshTimings on 23.976 to 60 Hz displays, with the polling
+//              thread stalled now and then. The cycle has to be within 0.1% and
+//              the scanline time within 1% of the display's.
+//   frametime  CFrameTimeDetector on sample times with +/-2 ms jitter. Standard
+//              rates have to snap to their family, 20 fps must stay unlocked.
+//   ratio      FrameRateRatio for content and display rate pairs.
+//   phase      CPhaseControl steering an audio clock that is off by up to
+//              +/-0.1%. After settling the phase must stay within +/-0.25 of a
+//              display cycle, i.e. no frame is dropped or repeated.
+//   playback   10 minutes of 23.976 to 59.94 fps content on 50, 59.94, 60 and
+//              120 Hz displays, scheduled like CheckForScheduledSample does with
+//              CRasterWindow, CLateFrameControl, FrameRateRatio and CPhaseControl.
+//              The audio clock runs 150 ppm fast and the display 40 ppm slow
+//              against the system clock, readings, vsyncs, time stamps and wake
+//              ups jitter. Every pair runs once as is and once with the scheduler
+//              stalling for 5 to 25 ms about every 2 s. Reports the dropped and
+//              repeated frames and the A/V phase after the first 10 s. Only content
+//              faster than the display may drop frames, as many as the rate
+//              difference, and a stall may cost one dropped and one repeated frame.
+//              Where the frame rate is locked to the display the phase control has
+//              to hold the A/V phase within a display cycle.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "FramePacing.h"
+
+static bool s_verbose = false;
+
+// Display with a fixed refresh rate. Every call into the source advances the time
+// by a few us like a busy polling thread does, and every few thousand calls the
+// thread loses its time slice for a while.
+class CSimDisplay : public IPacingSource
+{
+public:
+  CSimDisplay(double refreshRate, unsigned int visibleLines, unsigned int totalLines)
+  {
+    m_cycle        = 1e7 / refreshRate;
+    m_visibleLines = visibleLines;
+    m_totalLines   = totalLines;
+    m_time         = 1234567.0;
+    m_calls        = 0;
+  }
+
+  virtual long long GetTime()
+  {
+    Advance();
+    return (long long)m_time;
+  }
+
+  // the raster reads 0 during the vertical blank, like GetRasterStatus
+  virtual bool GetScanLine(unsigned int* pScanLine)
+  {
+    Advance();
+    unsigned int line = (unsigned int)(fmod(m_time, m_cycle) / m_cycle * m_totalLines);
+    *pScanLine = line < m_visibleLines ? line : 0;
+    return true;
+  }
+
+  virtual void Log(const char* text)
+  {
+    if (s_verbose)
+    {
+      printf("    %s\n", text);
+    }
+  }
+
+  double ScanlineTime() { return m_cycle / m_totalLines; }
+
+private:
+  void Advance()
+  {
+    m_calls++;
+    m_time += 20.0 + rand() % 30;
+    if (m_calls % 5000 == 0)
+    {
+      m_time += 5000.0 + rand() % 10000; // 0.5 to 1.5 ms
+    }
+  }
+
+  double       m_cycle;
+  unsigned int m_visibleLines;
+  unsigned int m_totalLines;
+  double       m_time;
+  long long    m_calls;
+};
+
+static int CheckRefresh()
+{
+  static const struct { double rate; unsigned int visible; unsigned int total; } displays[] = {
+    { 23.976, 1080, 1125 }, { 24.0, 1080, 1125 }, { 50.0, 1080, 1125 },
+    { 59.94, 1080, 1125 }, { 60.0, 720, 750 }, { 50.0, 576, 625 },
+  };
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(displays) / sizeof(displays[0]); i++)
+  {
+    CSimDisplay display(displays[i].rate, displays[i].visible, displays[i].total);
+    RefreshTimings timings;
+    MeasureRefreshTimings(&display, displays[i].visible, &timings);
+
+    double cycle = 1000.0 / displays[i].rate;
+    double cycleError = fabs(timings.refreshCycle / cycle - 1.0);
+    double lineError = fabs(timings.scanlineTime * 10000.0 / display.ScanlineTime() - 1.0);
+    bool ok = timings.locked && cycleError < 0.001 && lineError < 0.01;
+    printf("refresh   %7.3f Hz: cycle %.4f ms (%.4f), line %.5f ms, max line %u, %s: %s\n",
+      displays[i].rate, timings.refreshCycle, cycle, timings.scanlineTime, timings.maxScanLine,
+      timings.locked ? "locked" : "not locked", ok ? "ok" : "FAILED");
+    failed += ok ? 0 : 1;
+  }
+  return failed;
+}
+
+static int CheckFrameTime()
+{
+  static const struct { double fps; double expected; bool lock; } contents[] = {
+    { 23.976, 1000.5 / 24000.0, true }, { 24.0, 1000.5 / 24000.0, true },
+    { 25.0, 1000.0 / 25000.0, true }, { 29.97, 1000.5 / 30000.0, true },
+    { 50.0, 1000.0 / 50000.0, true }, { 59.94, 1000.5 / 60000.0, true },
+    { 20.0, 1.0 / 20.0, false },
+  };
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(contents) / sizeof(contents[0]); i++)
+  {
+    CFrameTimeDetector detector;
+    long long last = 0;
+    for (int n = 1; n <= 300; n++)
+    {
+      long long stamp = (long long)(n * 1e7 / contents[i].fps) + (rand() % 40001) - 20000;
+      if (n > 1)
+      {
+        detector.Add(stamp - last, true);
+      }
+      last = stamp;
+    }
+
+    double error = fabs(detector.m_DetectedFrameTime / contents[i].expected - 1.0);
+    bool ok = detector.m_DetectedLock == contents[i].lock && error < (contents[i].lock ? 1e-9 : 0.01);
+    printf("frametime %7.3f fps: %.6f s (%.6f), std dev %.0f, %s: %s\n",
+      contents[i].fps, detector.m_DetectedFrameTime, contents[i].expected, detector.m_DetectedFrameTimeStdDev,
+      detector.m_DetectedLock ? "locked" : "not locked", ok ? "ok" : "FAILED");
+    failed += ok ? 0 : 1;
+  }
+  return failed;
+}
+
+static int CheckRatio()
+{
+  static const struct { double fps; double hz; int ratio; } pairs[] = {
+    { 25.0, 50.0, 2 }, { 50.0, 50.0, 1 }, { 24.0, 24.0, 1 }, { 23.976, 23.976, 1 },
+    { 29.97, 59.94, 2 }, { 23.976, 59.94, 0 }, { 25.0, 60.0, 0 },
+  };
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+  {
+    int raw = 0;
+    int early = FrameRateRatio(1.0 / pairs[i].fps, 0, 1.0, 1000.0 / pairs[i].hz, 10, 10, &raw);
+    int ratio = FrameRateRatio(1.0 / pairs[i].fps, 0, 1.0, 1000.0 / pairs[i].hz, 100, 100, &raw);
+    // nothing is reported before FRAME_PROC_THRESH frames
+    bool ok = early == 0 && ratio == pairs[i].ratio;
+    printf("ratio     %7.3f fps on %7.3f Hz: %d (raw %d): %s\n", pairs[i].fps, pairs[i].hz, ratio, raw, ok ? "ok" : "FAILED");
+    failed += ok ? 0 : 1;
+  }
+  return failed;
+}
+
+// The presentation phase moves by the clock error times the frame period in display
+// cycles each frame. A factor above 1 from the phase control speeds up the audio
+// clock and moves the phase back down.
+static int CheckPhase()
+{
+  static const double offsets[] = { 0.001, 0.0003, -0.0003, -0.001 };
+  const int frames = 20000;
+  const int settle = 1000;
+  const double framesPerCycle = 2.0; // 25 fps on 50 Hz
+  int failed = 0;
+
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+  {
+    CPhaseControl control;
+    double phase = offsets[i] > 0 ? -0.4 : 0.4;
+    double freq = 1.0;
+    double maxPhase = 0.0;
+    int corrections = 0;
+    for (int n = 0; n < frames; n++)
+    {
+      phase += (offsets[i] - (freq - 1.0)) * framesPerCycle;
+      double newFreq = control.Update(phase);
+      if (newFreq != freq && newFreq != 1.0)
+      {
+        corrections++;
+      }
+      freq = newFreq;
+      if (n >= settle && fabs(phase) > maxPhase)
+      {
+        maxPhase = fabs(phase);
+      }
+    }
+
+    bool ok = maxPhase < 0.25;
+    printf("phase     %+.2f%% clock: max phase %.3f after %d frames, %d corrections: %s\n",
+      offsets[i] * 100.0, maxPhase, settle, corrections, ok ? "ok" : "FAILED");
+    failed += ok ? 0 : 1;
+  }
+  return failed;
+}
+
+// Uniform random number in [-1, 1)
+static double Noise()
+{
+  return (rand() % 20001) / 10000.0 - 1.0;
+}
+
+// Audio renderer clock, drifting against the system clock and slowed down or
+// sped up by AdjustClock. Every reading is off by up to +/-0.2 ms.
+class CSimAudioClock
+{
+public:
+  CSimAudioClock(double ppm)
+  {
+    m_drift = 1.0 + ppm * 1e-6;
+    m_rate  = m_drift;
+    m_base  = 0.0;
+    m_start = 0.0;
+  }
+
+  double Exact(double now) const
+  {
+    return m_base + (now - m_start) * m_rate;
+  }
+
+  long long Read(double now) const
+  {
+    return (long long)(Exact(now) + Noise() * 2000.0);
+  }
+
+  void Adjust(double now, double adjustment)
+  {
+    m_base  = Exact(now);
+    m_start = now;
+    m_rate  = m_drift * adjustment;
+  }
+
+private:
+  double m_drift;
+  double m_rate;
+  double m_base;
+  double m_start;
+};
+
+// The decoder hands out time stamps with +/-1 ms of jitter
+static void Decoded(CFrameTimeDetector& detector, long long sample, long long frameTime, long long* pLastStamp)
+{
+  long long stamp = sample * frameTime + (long long)(Noise() * 10000.0);
+  if (sample > 1)
+  {
+    detector.Add(stamp - *pLastStamp, false);
+  }
+  *pLastStamp = stamp;
+}
+
+struct PlaybackResult
+{
+  int    frames;      // frames due after settling
+  int    dropped;     // never on screen
+  int    repeated;    // on screen for more vsyncs than their cadence gives them
+  int    held;        // late frames the hysteresis presented anyway
+  int    stalls;      // scheduler wake ups 5 to 25 ms late
+  double avMean;      // how much later than its time stamp a frame appears, in ms
+  double avMin;
+  double avMax;
+  double clockAdjust; // average AdjustClock value
+  int    ratio;       // FrameRateRatio at the end
+};
+
+// Plays 'seconds' of fps content on a hz display. The scheduler thread is modelled
+// after SchedulerThread: it sleeps until the target time CheckForScheduledSample
+// returns with 1 ms timer granularity and, with bStalls, about every 2 s 5 to 25 ms
+// longer. The raster
+// runs 'displayPpm' fast against the system clock with +/-50 us of jitter on every
+// vsync, on 1125 lines of which 1080 are visible. A presented frame is shown from
+// the next vertical blank on.
+static PlaybackResult Playback(double fps, double hz, double audioPpm, double displayPpm, double seconds, bool bStalls)
+{
+  const long long frameTime   = (long long)(1e7 / fps);
+  const long long displayTime = (long long)(1e7 / hz);   // what the presenter measured
+  const double    vsyncPeriod = 1e7 / hz / (1.0 + displayPpm * 1e-6);
+  const unsigned int visibleLines = 1080;
+  const unsigned int maxScanLine  = 1124;
+  const double    scanlineTime = displayTime / 10000.0 / (maxScanLine + 1);
+  const double    settle       = 10e7;
+  const double    end          = seconds * 1e7;
+
+  // a frame is repeated when it stays on screen longer than the nearest whole number
+  // of vsyncs above its duration, for cadences within 1% of a whole number that
+  // number itself
+  const double vsyncsPerFrame = (double)frameTime / vsyncPeriod;
+  const int    cadence        = (int)ceil(vsyncsPerFrame - 0.01);
+
+  CFrameTimeDetector detector;
+  CLateFrameControl  lateFrames;
+  CPhaseControl      phase;
+  CRasterWindow      raster;
+  CSimAudioClock     clock(audioPpm);
+  raster.Init(0, visibleLines - 1);
+
+  PlaybackResult r;
+  memset(&r, 0, sizeof(r));
+  r.avMin = 1e9;
+  r.avMax = -1e9;
+
+  double now            = 0.0;
+  long long targetTime  = 0;
+  long long earliest    = 0;
+  long long next        = 1;      // sample at the head of the queue
+  long long lastStamp   = 0;
+  long long latest      = 0;      // last presented sample, shown from the next vblank
+  long long shown       = 0;      // sample on screen
+  int    shownFor       = 0;
+  long long vblank      = 1;      // index of the next vertical blank
+  double vblankJitter   = Noise() * 500.0;
+  int    processed      = 0;
+  int    drawn          = 0;
+  int    ratio          = 0;
+  int    rawRatio       = 0;
+  double previousFreq   = 1.0;
+  double adjustSum      = 0.0;
+  double adjustTime     = 0.0;
+  double avSum          = 0.0;
+  int    avCount        = 0;
+
+  while (now < end)
+  {
+    // SchedulerThread: sleep when the target is at least 1 ms away
+    long long delay = targetTime - (long long)now;
+    if (targetTime > 0 && delay >= 10000)
+    {
+      now = targetTime + (Noise() + 1.0) * 5000.0;
+      if (bStalls && rand() % 20000 < delay / 1000)
+      {
+        now += 50000.0 + (Noise() + 1.0) * 100000.0; // lost the time slice, about every 2 s
+        r.stalls++;
+      }
+    }
+    else
+    {
+      now += 200.0;
+    }
+
+    // vertical blanks up to now put the latest presented frame on screen
+    while (vblank * vsyncPeriod + vblankJitter <= now)
+    {
+      double time = vblank * vsyncPeriod + vblankJitter;
+      if (latest != shown)
+      {
+        if (shown > 0 && time > settle)
+        {
+          r.repeated += shownFor > cadence ? 1 : 0;
+        }
+        if (time > settle)
+        {
+          double av = (clock.Exact(time) - latest * frameTime) / 10000.0;
+          avSum += av;
+          avCount++;
+          r.avMin = av < r.avMin ? av : r.avMin;
+          r.avMax = av > r.avMax ? av : r.avMax;
+        }
+        shown = latest;
+        shownFor = 0;
+      }
+      shownFor++;
+      vblank++;
+      vblankJitter = Noise() * 500.0;
+    }
+
+    if (now > settle)
+    {
+      adjustSum += (1.0 / phase.m_dVariableFreq) * (now - adjustTime);
+      adjustTime = now;
+    }
+    else
+    {
+      adjustTime = now;
+    }
+
+    // CheckForScheduledSample, the decoder always keeps the queue filled
+    long long systemTime = (long long)now;
+    long long delErr = targetTime > 0 ? targetTime - systemTime : 0;
+    long long hystersisTime = LateFrameHysteresis(displayTime);
+    long long frameDuration = frameTime;
+    if (detector.m_DetectedFrameTime > DFT_THRESH)
+    {
+      frameDuration = (long long)(detector.m_DetectedFrameTime * 10000000.0);
+    }
+    targetTime = 0;
+
+    for (;;)
+    {
+      long long nextSampleTime = next * frameTime - clock.Read(now);
+      long long lateLimit = lateFrames.LateLimit(nextSampleTime, &delErr, displayTime, ratio > 0);
+
+      if (nextSampleTime < -lateLimit)
+      {
+        // too late, dropped and the thread sleeps for a ms
+        earliest = 0;
+        lateFrames.FrameDone();
+        processed++;
+        Decoded(detector, next++, frameTime, &lastStamp);
+        now += 10000.0 + (Noise() + 1.0) * 5000.0;
+        systemTime = (long long)now;
+        continue;
+      }
+
+      ratio = FrameRateRatio(detector.m_DetectedFrameTime, frameTime, 1.0, displayTime / 10000.0,
+                             processed, drawn, &rawRatio);
+
+      if (earliest - systemTime > displayTime / 2)
+      {
+        targetTime = systemTime + displayTime / 4;
+        break;
+      }
+      else if (earliest - systemTime > 20000)
+      {
+        targetTime = systemTime + 15000;
+        break;
+      }
+
+      double position = fmod(now - vblankJitter, vsyncPeriod) / vsyncPeriod * (maxScanLine + 1);
+      unsigned int scanline = position >= visibleLines ? 0 : (unsigned int)position;
+      long long offsetTime = -delErr;
+      long long rasterDelay = raster.GetDelay(scanline, maxScanLine, scanlineTime, displayTime / 10000.0, &offsetTime);
+      if (rasterDelay > 0)
+      {
+        targetTime = systemTime + rasterDelay;
+        earliest = 0;
+        break;
+      }
+
+      if (ratio <= 1)
+      {
+        earliest = systemTime + offsetTime;
+      }
+      else
+      {
+        earliest = systemTime + displayTime * (rawRatio - 1) + offsetTime;
+      }
+
+      if (nextSampleTime > frameDuration + hystersisTime)
+      {
+        targetTime = systemTime + (earliest - systemTime) / 2;
+        break;
+      }
+
+      // presented, a frame that was replaced before a vblank never made it to the screen
+      if (latest != shown && now > settle)
+      {
+        r.dropped++;
+      }
+      latest = next;
+      lateFrames.FrameDone();
+      processed++;
+      drawn++;
+      Decoded(detector, next++, frameTime, &lastStamp);
+
+      double nstPhaseDiff = -((double)nextSampleTime / (double)frameTime - 0.5);
+      if (drawn <= FRAME_PROC_THRSH2 || ratio == 0)
+      {
+        nstPhaseDiff = 0.0;
+      }
+      else if (nstPhaseDiff < -0.499)
+      {
+        nstPhaseDiff = -0.499;
+      }
+      else if (nstPhaseDiff > 0.499)
+      {
+        nstPhaseDiff = 0.499;
+      }
+      phase.Update(nstPhaseDiff);
+      if (phase.m_dVariableFreq != previousFreq)
+      {
+        clock.Adjust(now, 1.0 / phase.m_dVariableFreq);
+        previousFreq = phase.m_dVariableFreq;
+      }
+      break;
+    }
+  }
+
+  // the frames dropped as too late are the ones that were due but never presented
+  r.frames      = (int)((end - settle) / frameTime);
+  r.dropped    += (int)(next - 1) - drawn;
+  r.held        = lateFrames.m_iFramesHeld;
+  r.avMean      = avCount ? avSum / avCount : 0.0;
+  r.clockAdjust = adjustSum / (end - settle);
+  r.ratio       = ratio;
+  return r;
+}
+
+static int CheckPlayback()
+{
+  static const double contents[] = { 23.976, 25.0, 29.97, 50.0, 59.94 };
+  static const double displays[] = { 50.0, 59.94, 60.0, 120.0 };
+  const double seconds = 600.0;
+  int failed = 0;
+
+  srand(20110301);
+  for (size_t d = 0; d < sizeof(displays) / sizeof(displays[0]); d++)
+  {
+    for (size_t c = 0; c < sizeof(contents) / sizeof(contents[0]); c++)
+    {
+      for (int stalls = 0; stalls < 2; stalls++)
+      {
+        double fps = contents[c];
+        double hz = displays[d];
+        PlaybackResult r = Playback(fps, hz, 150.0, -40.0, seconds, stalls != 0);
+
+        // the display can't show the frames above its rate, and a stall costs at
+        // most one repeated and one dropped frame
+        double expected = fps > hz ? r.frames * (1.0 - hz / fps) : 0.0;
+        double tolerance = r.frames * 0.005 + r.stalls;
+        bool ok = fabs(r.dropped - expected) <= tolerance && r.repeated <= r.stalls;
+        if (r.ratio > 0)
+        {
+          // locked, the phase control absorbs the clock drift
+          ok = ok && r.dropped <= r.stalls && (stalls || r.avMax - r.avMin < 1000.0 / hz);
+        }
+
+        printf("playback  %6.3f fps on %6.2f Hz: ratio %d, %5d frames, %4d dropped, %3d repeated, %3d held, %3d stalls, "
+               "A/V %5.1f ms (%5.1f to %5.1f), clock x%.4f: %s\n",
+          fps, hz, r.ratio, r.frames, r.dropped, r.repeated, r.held, r.stalls, r.avMean, r.avMin, r.avMax,
+          r.clockAdjust, ok ? "ok" : "FAILED");
+        failed += ok ? 0 : 1;
+      }
+    }
+  }
+  return failed;
+}
+
+int main(int argc, char* argv[])
+{
+  s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  srand(1);
+
+  int failed = CheckRefresh() + CheckFrameTime() + CheckRatio() + CheckPhase() + CheckPlayback();
+  if (failed)
+  {
+    printf("%d case(s) FAILED\n", failed);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+Checks the SSE2 luma kernels of mtn against their scalar loops.
+
+  lumacheck
+
+The Makefile cuts blank_frame(), uint8_cmp() and luma_edge_count() out of mtn.c;
+they are compiled twice here, once as they are and once with __SSE2__
+undefined, which leaves only the scalar loops. Cases:
+  cmp      uint8_cmp() on random, near and far pixels, every length up to 100
+           and unaligned starts, so the 16 pixel steps and the tail both run
+  edge     luma_edge_count() on noise, gradients, steps and flat pictures with
+           the thresholds of -D 1..12 and random ones up to 320, on random
+           rectangles up to 40 wide so the 8 pixel steps and the tail both run
+  blank    blank_frame() on whole pictures of odd and even sizes
+Every result has to be bit-exact. The time a shot of 720x576 takes to be
+checked (blank_frame and the 6 edge parts detect_edge looks at) is printed for
+both builds.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef MIN
+#define MIN(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef MAX
+#define MAX(a,b) ((a)<(b)?(b):(a))
+#endif
+
+#define luma_edge_count luma_edge_count_sse2
+#define uint8_cmp uint8_cmp_sse2
+#define blank_frame blank_frame_sse2
+#include "luma.inc"
+#undef luma_edge_count
+#undef uint8_cmp
+#undef blank_frame
+
+#undef __SSE2__
+#define luma_edge_count luma_edge_count_c
+#define uint8_cmp uint8_cmp_c
+#define blank_frame blank_frame_c
+#include "luma.inc"
+#undef luma_edge_count
+#undef uint8_cmp
+#undef blank_frame
+
+#define SHOT_WIDTH 720
+#define SHOT_HEIGHT 576
+#define EDGE_PARTS 6
+
+// CPU time of the process in seconds
+static double cpu_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static unsigned int seed = 1;
+
+static int random_int(int n)
+{
+    seed = seed*1103515245 + 12345;
+    return (int) ((seed >> 8) % (unsigned int) n);
+}
+
+/*
+kind 0 noise, 1 noise around a level, 2 gradient, 3 vertical steps, 4 flat, 5 checkerboard
+*/
+static void make_picture(uint8_t *p, int width, int height, int kind)
+{
+    int level = random_int(256);
+    int x, y;
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int v;
+            switch (kind) {
+            case 0: v = random_int(256); break;
+            case 1: v = level + random_int(41) - 20; break;
+            case 2: v = (x*3 + y*2) & 255; break;
+            case 3: v = (x/7 & 1) ? 255 : 0; break;
+            case 4: v = level; break;
+            default: v = ((x ^ y) & 1) ? 250 : 5; break;
+            }
+            p[y*width + x] = (uint8_t) MIN(MAX(v, 0), 255);
+        }
+    }
+}
+
+static int check_cmp()
+{
+    uint8_t buf[3][128];
+    int failed = 0, runs = 0;
+    int kind, n, off, i;
+    for (kind = 0; kind < 3; kind++) {
+        for (n = 1; n <= 100; n++) {
+            for (off = 0; off < 4; off++) {
+                for (i = 0; i < 128; i++) {
+                    int a = random_int(256);
+                    // 0: anything, 1: mostly within 20, 2: right around the limit
+                    int d = 0 == kind ? random_int(256) - a : 1 == kind ? random_int(41) - 20 : 19 + random_int(3);
+                    buf[0][i] = (uint8_t) a;
+                    buf[1][i] = (uint8_t) MIN(MAX(a + d, 0), 255);
+                    buf[2][i] = (uint8_t) MIN(MAX(a - d, 0), 255);
+                }
+                if (uint8_cmp_sse2(buf[0] + off, buf[1] + off, buf[2] + off, n)
+                    != uint8_cmp_c(buf[0] + off, buf[1] + off, buf[2] + off, n)) {
+                    failed++;
+                }
+                runs++;
+            }
+        }
+    }
+    printf("cmp    %5d runs, %d differ  %s\n", runs, failed, 0 == failed ? "ok" : "FAILED");
+    return 0 == failed;
+}
+
+static int check_edge()
+{
+    const int width = 67, height = 45;
+    uint8_t pic[67*45];
+    int failed = 0, runs = 0;
+    int kind, i;
+    for (kind = 0; kind < 6; kind++) {
+        make_picture(pic, width, height, kind);
+        for (i = 0; i < 2000; i++) {
+            int d = 1 + random_int(12);
+            int thresh = (320 + d - 1) / d; // as detect_edge
+            int xbegin = 1 + random_int(width - 2);
+            int ybegin = 1 + random_int(height - 2);
+            int xend = MIN(xbegin + random_int(40), width - 2);
+            int yend = MIN(ybegin + random_int(10), height - 2);
+            if (i % 7 == 0) {
+                thresh = 1 + random_int(320);
+            }
+            if (luma_edge_count_sse2(pic, width, xbegin, ybegin, xend, yend, thresh)
+                != luma_edge_count_c(pic, width, xbegin, ybegin, xend, yend, thresh)) {
+                failed++;
+            }
+            runs++;
+        }
+    }
+    printf("edge   %5d runs, %d differ  %s\n", runs, failed, 0 == failed ? "ok" : "FAILED");
+    return 0 == failed;
+}
+
+static int check_blank()
+{
+    static const int sizes[][2] = {{720, 576}, {360, 288}, {213, 120}, {97, 55}, {33, 22}};
+    uint8_t *pic = malloc(720*576);
+    int failed = 0, runs = 0;
+    size_t s;
+    int kind;
+    for (s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        for (kind = 0; kind < 6; kind++) {
+            make_picture(pic, sizes[s][0], sizes[s][1], kind);
+            if (blank_frame_sse2(pic, sizes[s][0], sizes[s][1]) != blank_frame_c(pic, sizes[s][0], sizes[s][1])) {
+                failed++;
+            }
+            runs++;
+        }
+    }
+    free(pic);
+    printf("blank  %5d runs, %d differ  %s\n", runs, failed, 0 == failed ? "ok" : "FAILED");
+    return 0 == failed;
+}
+
+/*
+what a shot costs in make_thumbnail: blank_frame, then the edge parts of detect_edge
+*/
+static double time_shot(double (*blank)(uint8_t *, int, int),
+    int (*edge_count)(uint8_t *, int, int, int, int, int, int), uint8_t *pic, int shots, int *result)
+{
+    const int width = SHOT_WIDTH, height = SHOT_HEIGHT;
+    int y_size = height/10, x_crop = width/8;
+    int i, j;
+    double t0 = cpu_time();
+    for (i = 0; i < shots; i++) {
+        *result += blank(pic, width, height) > 0.8;
+        for (j = 0; j < EDGE_PARTS; j++) {
+            int y = y_size*(2 + j/2*2) + (j & 1)*y_size;
+            int xbegin = (j & 1) ? width/2 + 1 : x_crop;
+            int xend = (j & 1) ? width - x_crop : width/2;
+            *result += edge_count(pic, width, xbegin, y, xend, y + y_size, 27);
+        }
+    }
+    return (cpu_time() - t0) / shots;
+}
+
+int main()
+{
+    int ok = check_cmp();
+    ok &= check_edge();
+    ok &= check_blank();
+
+    uint8_t *pic = malloc(SHOT_WIDTH*SHOT_HEIGHT);
+    make_picture(pic, SHOT_WIDTH, SHOT_HEIGHT, 1);
+    int sse2 = 0, c = 0;
+    double t_sse2 = time_shot(blank_frame_sse2, luma_edge_count_sse2, pic, 500, &sse2);
+    double t_c = time_shot(blank_frame_c, luma_edge_count_c, pic, 500, &c);
+    free(pic);
+    printf("shot   %dx%d, scalar %.1f us, sse2 %.1f us per shot  %s\n",
+        SHOT_WIDTH, SHOT_HEIGHT, t_c*1e6, t_sse2*1e6, sse2 == c ? "ok" : "FAILED");
+    ok &= sse2 == c;
+
+    if (!ok) {
+        printf("luma kernels FAILED\n");
+        return 1;
+    }
+    return 0;
+}
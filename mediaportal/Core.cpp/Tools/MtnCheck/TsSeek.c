@@ -0,0 +1,344 @@
+/*
+ *	Copyright (C) 2006-2010 Team MediaPortal
+ *	http://www.team-mediaportal.com
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+Seeks synthetic 15 minute transport streams through the keyframe index of mtn.
+
+  tsseek
+
+The Makefile cuts the index, from TS_PACKET_SIZE to ts_index_seek(), out of
+mtn.c; compat/avformat.h gives it the file as a memory buffer. Each stream
+has the video pid, audio, a PAT and null packets, gops of 6, 12 or 15 frames
+with 2 b-frames between the references (so pts aren't in file order) and its
+pts wrap at 2^33 five minutes in. The streams:
+  mpeg2      188 byte packets, 77 bytes of junk in front, a second service
+             with its own video pid; i-frames found by sequence and gop
+             headers and the picture coding type
+  h264-m2ts  192 byte packets; idr frames found by their aud, sps and idr nals
+  h264-rai   188 byte packets; only random_access_indicator marks the idr
+             frames, the aud says nothing
+For 500 random targets and for the pts of 100 random i-frames, a forward seek
+has to land on the first i-frame at or after the target and a backward one on
+the last at or before it; before the first or after the last i-frame it's
+that one. The index has to find the packet size, the start of the packets and
+the last video pts. Prints how much of the file building the index and a seek
+read.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "avformat.h"
+
+#include "tsindex.inc"
+
+#define MINUTES 15
+#define FRAME_PTS 3600 // 25 fps
+#define VIDEO_PID 0x1011
+#define OTHER_VIDEO_PID 0x1021
+#define AUDIO_PID 0x1100
+#define NB_TARGETS 500
+#define NB_EXACT 100
+
+enum {MODE_MPEG2, MODE_H264, MODE_H264_RAI};
+
+typedef struct mux
+{
+    uint8_t *data;
+    int64_t size, cap;
+    int packet_size;
+    int mode;
+    int cc[0x2000];
+    int64_t first_pts; // unwrapped
+    int64_t *rap_pts; // unwrapped pts & position of every i-frame of VIDEO_PID
+    int64_t *rap_pos;
+    int nb_rap, rap_cap;
+    int64_t last_pts;
+} mux;
+
+// CPU time of the process in seconds
+static double cpu_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static unsigned int seed = 7;
+
+static int random_int(int n)
+{
+    seed = seed*1103515245 + 12345;
+    return (int) ((seed >> 8) % (unsigned int) n);
+}
+
+static void mux_bytes(mux *m, const uint8_t *p, int n)
+{
+    if (m->size + n > m->cap) {
+        m->cap = MAX(m->cap*2, m->size + n + 1024*1024);
+        m->data = realloc(m->data, m->cap);
+    }
+    memcpy(m->data + m->size, p, n);
+    m->size += n;
+}
+
+/*
+start a packet; return its 188 bytes, filled with stuffing after the header
+*/
+static uint8_t *mux_packet(mux *m, int pid, int pusi, int rai)
+{
+    uint8_t head[4] = {0, 0, 0, 0};
+    if (192 == m->packet_size) { // arrival time stamp
+        mux_bytes(m, head, 4);
+    }
+    uint8_t packet[188];
+    memset(packet, 0xaa, sizeof(packet));
+    packet[0] = 0x47;
+    packet[1] = (pusi ? 0x40 : 0) | (pid >> 8);
+    packet[2] = pid & 0xff;
+    packet[3] = ((rai ? 3 : 1) << 4) | (m->cc[pid]++ & 15);
+    if (rai) {
+        packet[4] = 1; // adaptation_field_length
+        packet[5] = 0x40; // random_access_indicator
+    }
+    mux_bytes(m, packet, sizeof(packet));
+    return m->data + m->size - 188;
+}
+
+static void put_pts(uint8_t *p, int64_t pts)
+{
+    pts &= TS_PTS_WRAP - 1;
+    p[0] = 0x21 | ((pts >> 29) & 0x0e);
+    p[1] = (pts >> 22) & 0xff;
+    p[2] = ((pts >> 14) & 0xfe) | 1;
+    p[3] = (pts >> 7) & 0xff;
+    p[4] = ((pts << 1) & 0xfe) | 1;
+}
+
+/*
+a pes of nb_packets packets; es is the start of its payload
+*/
+static int64_t mux_pes(mux *m, int pid, int stream_id, int64_t pts, const uint8_t *es, int es_len, int nb_packets, int rai)
+{
+    int64_t pos = m->size;
+    uint8_t *p = mux_packet(m, pid, 1, rai);
+    uint8_t *pes = p + (rai ? 6 : 4);
+    uint8_t head[9] = {0, 0, 1, stream_id, 0, 0, 0x80, 0x80, 5};
+    memcpy(pes, head, 9);
+    put_pts(pes + 9, pts);
+    memcpy(pes + 14, es, es_len);
+    int i;
+    for (i = 1; i < nb_packets; i++) {
+        mux_packet(m, pid, 0, 0);
+    }
+    return pos;
+}
+
+/*
+type 1 i, 2 p, 3 b
+*/
+static void mux_video(mux *m, int pid, int64_t pts, int type)
+{
+    static const uint8_t mpeg2_i[] = {0, 0, 1, 0xb3, 0x2d, 0x02, 0x40, 0x33, 0xff, 0xff, 0xe0, 0x18,
+        0, 0, 1, 0xb8, 0x00, 0x08, 0x00, 0x40, 0, 0, 1, 0x00, 0x00, 1 << 3};
+    static const uint8_t h264_i[] = {0, 0, 1, 0x09, 0x10, 0, 0, 1, 0x67, 0x4d, 0x40, 0x1e, 0, 0, 1, 0x65, 0x88};
+    static const uint8_t h264_any[] = {0, 0, 1, 0x09, 0xf0, 0, 0, 1, 0x41, 0x9a};
+    uint8_t es[32];
+    int es_len;
+    if (MODE_MPEG2 == m->mode) {
+        if (1 == type) {
+            memcpy(es, mpeg2_i, es_len = sizeof(mpeg2_i));
+        } else {
+            uint8_t picture[] = {0, 0, 1, 0x00, 0x40, type << 3};
+            memcpy(es, picture, es_len = sizeof(picture));
+        }
+    } else if (MODE_H264 == m->mode) {
+        if (1 == type) {
+            memcpy(es, h264_i, es_len = sizeof(h264_i));
+        } else {
+            uint8_t aud[] = {0, 0, 1, 0x09, ((type - 1) << 5) | 0x10, 0, 0, 1, 3 == type ? 0x01 : 0x41, 0x9a};
+            memcpy(es, aud, es_len = sizeof(aud));
+        }
+    } else {
+        memcpy(es, h264_any, es_len = sizeof(h264_any));
+    }
+
+    int nb_packets = 1 == type ? 36 + random_int(10) : 2 == type ? 10 + random_int(5) : 4 + random_int(3);
+    int rai = MODE_H264_RAI == m->mode && 1 == type;
+    int64_t pos = mux_pes(m, pid, 0xe0, pts, es, es_len, nb_packets, rai);
+    if (VIDEO_PID != pid) {
+        return;
+    }
+    if (1 == type) {
+        if (m->nb_rap == m->rap_cap) {
+            m->rap_cap = MAX(m->rap_cap*2, 1024);
+            m->rap_pts = realloc(m->rap_pts, m->rap_cap*sizeof(int64_t));
+            m->rap_pos = realloc(m->rap_pos, m->rap_cap*sizeof(int64_t));
+        }
+        m->rap_pts[m->nb_rap] = pts;
+        m->rap_pos[m->nb_rap++] = pos;
+    }
+    m->last_pts = MAX(m->last_pts, pts);
+}
+
+static void mux_stream(mux *m, int mode, int packet_size)
+{
+    memset(m, 0, sizeof(*m));
+    m->mode = mode;
+    m->packet_size = packet_size;
+    m->first_pts = TS_PTS_WRAP - 5*60*90000LL;
+    m->last_pts = INT64_MIN;
+    if (MODE_MPEG2 == mode) { // a recording starting in the middle of a packet
+        uint8_t junk[77];
+        memset(junk, 0, sizeof(junk));
+        mux_bytes(m, junk, sizeof(junk));
+    }
+
+    static const uint8_t audio[] = {0xff, 0xfd};
+    int64_t frames = MINUTES*60*25;
+    int64_t frame = 0;
+    int pending_b = 0; // the 2 b-frames ending the last gop, sent after the next i-frame
+    while (frame < frames) {
+        int gop = 3 * (2 + random_int(4)); // 6 .. 15
+        if (9 == gop) {
+            gop = 12;
+        }
+        gop = MIN(gop, (int) (frames - frame));
+        int64_t base = m->first_pts + (frame + 2)*FRAME_PTS;
+        int k;
+        for (k = 0; k < gop; k += 3) {
+            if (0 == k) {
+                mux_video(m, VIDEO_PID, base, 1);
+                if (MODE_MPEG2 == mode) {
+                    mux_video(m, OTHER_VIDEO_PID, base + 45000, 1);
+                }
+            } else {
+                mux_video(m, VIDEO_PID, base + k*FRAME_PTS, 2);
+            }
+            int b;
+            for (b = pending_b ? 2 : 0; b > 0; b--) { // last gop's
+                mux_video(m, VIDEO_PID, base - b*FRAME_PTS, 3);
+            }
+            pending_b = 0;
+            if (k > 0) {
+                mux_video(m, VIDEO_PID, base + (k - 2)*FRAME_PTS, 3);
+                mux_video(m, VIDEO_PID, base + (k - 1)*FRAME_PTS, 3);
+            }
+            mux_pes(m, AUDIO_PID, 0xc0, base + k*FRAME_PTS, audio, sizeof(audio), 2, 0);
+            if (MODE_MPEG2 == mode && k > 0) {
+                mux_video(m, OTHER_VIDEO_PID, base + k*FRAME_PTS + 45000, 2);
+            }
+            if (0 == random_int(4)) {
+                uint8_t *pat = mux_packet(m, 0, 1, 0);
+                pat[4] = 0;
+            }
+            for (b = random_int(3); b > 0; b--) {
+                mux_packet(m, 0x1fff, 0, 0);
+            }
+        }
+        pending_b = 1;
+        frame += gop;
+    }
+}
+
+/*
+the i-frame a seek to target has to land on
+*/
+static int64_t expected_pos(mux *m, int64_t target, int flags)
+{
+    int i;
+    if (AVSEEK_FLAG_BACKWARD == flags) {
+        for (i = m->nb_rap - 1; i > 0 && m->rap_pts[i] > target; i--)
+            ;
+        return m->rap_pos[i];
+    }
+    for (i = 0; i < m->nb_rap - 1 && m->rap_pts[i] < target; i++)
+        ;
+    return m->rap_pts[i] >= target ? m->rap_pos[i] : m->rap_pos[m->nb_rap - 1];
+}
+
+static int check_stream(const char *name, int mode, int packet_size)
+{
+    mux m;
+    mux_stream(&m, mode, packet_size);
+
+    ByteIOContext pb = {m.data, m.size, 0, 0, 0};
+    AVCodecContext codec = {MODE_MPEG2 == mode ? CODEC_ID_MPEG2VIDEO : CODEC_ID_H264};
+    AVStream stream = {VIDEO_PID, {1, 90000}, &codec};
+    AVInputFormat format = {"mpegts"};
+    AVFormatContext ctx = {&format, &pb, {&stream}, -1};
+    ts_index ti;
+
+    ts_index_build(&ctx, 0, &ti);
+    int64_t build_read = pb.nb_read;
+    int ok = ti.nb_rap > 0 && ti.packet_size == packet_size && ti.last_pts == m.last_pts
+        && ti.sync_offset == (MODE_MPEG2 == mode ? 77 : 0) && 0 == pb.pos;
+    printf("%-10s %5.1f MB, %d i-frames; index %d points, read %.1f MB  %s\n", name, m.size/1048576.0,
+        m.nb_rap, ti.nb_rap, build_read/1048576.0, ok ? "ok" : "FAILED");
+
+    int missed = 0, seeks = 0;
+    int64_t reads = 0;
+    double cpu = 0;
+    pb.nb_read = pb.nb_seeks = 0;
+    int i, backward;
+    for (i = 0; i < NB_TARGETS + NB_EXACT; i++) {
+        int64_t target = i < NB_TARGETS
+            ? m.first_pts - 2*90000 + ((int64_t) random_int(1 << 24) << 24 | random_int(1 << 24)) % (m.last_pts - m.first_pts + 3*90000)
+            : m.rap_pts[random_int(m.nb_rap)];
+        for (backward = 0; backward < 2; backward++) {
+            int flags = backward ? AVSEEK_FLAG_BACKWARD : 0;
+            int64_t calls = pb.nb_seeks;
+            ctx.seek_pos = -1;
+            double t0 = cpu_time();
+            int ret = ts_index_seek(&ctx, 0, &ti, target, flags);
+            cpu += cpu_time() - t0;
+            reads += pb.nb_seeks - calls;
+            if (ret < 0 || ctx.seek_pos != expected_pos(&m, target, flags)) {
+                if (missed < 5) {
+                    printf("  %s seek to %"PRId64" landed on %"PRId64", not %"PRId64"\n", backward ? "backward" : "forward",
+                        target - m.first_pts, ctx.seek_pos, expected_pos(&m, target, flags));
+                }
+                missed++;
+            }
+            seeks++;
+        }
+    }
+    printf("%-10s %d seeks, %d missed; %.0f kB in %.1f reads, %.0f us per seek  %s\n", name, seeks, missed,
+        pb.nb_read/1024.0/seeks, (double) reads/seeks, cpu*1e6/seeks, 0 == missed ? "ok" : "FAILED");
+
+    free(m.data);
+    free(m.rap_pts);
+    free(m.rap_pos);
+    return ok && 0 == missed;
+}
+
+int main()
+{
+    int ok = check_stream("mpeg2", MODE_MPEG2, 188);
+    ok &= check_stream("h264-m2ts", MODE_H264, 192);
+    ok &= check_stream("h264-rai", MODE_H264_RAI, 188);
+    if (!ok) {
+        printf("ts index FAILED\n");
+        return 1;
+    }
+    return 0;
+}
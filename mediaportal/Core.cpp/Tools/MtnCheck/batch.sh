@@ -0,0 +1,73 @@
+#!/bin/sh
+# Compares thumbnailing many short recordings with one mtn process per file, the
+# way MediaPortal starts it, against one batch process with file workers (-J).
+#
+#   MTN=/path/to/mtn ./batch.sh [work dir] [# of clips] [# of file workers]
+#
+# Needs an mtn build, an ffmpeg with lavfi to make the input and GNU time for
+# the peak RSS. Ten 20 s mpeg-2 transport streams are made and copied to the
+# given number of clips (500 by default). The batch run reads the names from
+# stdin with -X, so a second batch run has to skip every clip. Prints files/s
+# and the peak RSS of each run; the contact sheets of the two modes have to be
+# byte identical. Exits with 1 if they differ or a clip isn't skipped.
+
+MTN=${MTN:-mtn}
+FFMPEG=${FFMPEG:-ffmpeg}
+TIME=${TIME:-/usr/bin/time}
+WORK=${1:-build/batch}
+CLIPS=${2:-500}
+JOBS=${3:-4}
+OPTS="-P -i -t -c 3 -r 2"
+
+mkdir -p "$WORK/src" "$WORK/clips" || exit 1
+
+for n in 0 1 2 3 4 5 6 7 8 9; do
+  [ -f "$WORK/src/$n.ts" ] && continue
+  "$FFMPEG" -loglevel error -y \
+    -f lavfi -i "testsrc2=size=720x576:rate=25:duration=20,hue=h=$((n * 36)),noise=alls=$n:allf=t" \
+    -f lavfi -i "sine=frequency=$((400 + n * 50)):duration=20" \
+    -c:v mpeg2video -b:v 3M -g 12 -bf 2 -c:a mp2 -f mpegts "$WORK/src/$n.ts" || exit 1
+done
+i=0
+while [ $i -lt $CLIPS ]; do
+  name=`printf "clip%04d.ts" $i`
+  [ -f "$WORK/clips/$name" ] || cp "$WORK/src/$((i % 10)).ts" "$WORK/clips/$name" || exit 1
+  i=$((i + 1))
+done
+
+# prints files/s and the peak RSS of the biggest process of the run
+report()
+{
+  awk -v mode="$1" -v clips=$CLIPS '{ printf "%-24s %4d clips in %7.2f s, %6.1f files/s, peak rss %6.1f MB\n", mode, clips, $1, clips / $1, $2 / 1024 }' "$2"
+}
+
+rm -rf "$WORK/single" "$WORK/batch" "$WORK/index" && mkdir -p "$WORK/single" "$WORK/batch"
+
+$TIME -f "%e %M" -o "$WORK/single.time" sh -c "for f in '$WORK'/clips/*.ts; do '$MTN' $OPTS -O '$WORK/single' \"\$f\" || exit 1; done" \
+  > "$WORK/single.log" 2>&1
+report "one process per file" "$WORK/single.time"
+
+ls "$WORK"/clips/*.ts | $TIME -f "%e %M" -o "$WORK/batch.time" "$MTN" $OPTS -J $JOBS -X "$WORK/index" -O "$WORK/batch" - \
+  > "$WORK/batch.log" 2>&1
+report "batch -J $JOBS" "$WORK/batch.time"
+
+sheets=`ls "$WORK/batch" | wc -l`
+ls "$WORK"/clips/*.ts | $TIME -f "%e %M" -o "$WORK/again.time" "$MTN" $OPTS -J $JOBS -X "$WORK/index" -O "$WORK/batch" - \
+  > "$WORK/again.log" 2>&1
+report "batch again, unchanged" "$WORK/again.time"
+
+status=0
+if diff -r "$WORK/single" "$WORK/batch" > /dev/null; then
+  echo "$sheets sheets same as one process per file  ok"
+else
+  echo "sheets differ from one process per file  FAILED"
+  status=1
+fi
+done_again=$((`ls "$WORK/batch" | wc -l` - sheets))
+if [ "$done_again" -eq 0 ]; then
+  echo "second batch skipped every clip  ok"
+else
+  echo "second batch redid $done_again clips  FAILED"
+  status=1
+fi
+exit $status
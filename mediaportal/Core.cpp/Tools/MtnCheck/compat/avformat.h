@@ -0,0 +1,111 @@
+/*
+Just enough of libavformat for the mpeg-ts keyframe index of mtn. The file is
+a memory buffer; every seek and read is counted, and av_seek_frame only keeps
+the byte position it is asked for, so tsseek can see where a seek lands.
+*/
+#ifndef MTNCHECK_AVFORMAT_H
+#define MTNCHECK_AVFORMAT_H
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AV_NOPTS_VALUE ((int64_t) UINT64_C(0x8000000000000000))
+#define AV_LOG_VERBOSE 40
+#define AVSEEK_FLAG_BACKWARD 1
+#define AVSEEK_FLAG_BYTE 2
+
+#ifndef MIN
+#define MIN(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef MAX
+#define MAX(a,b) ((a)<(b)?(b):(a))
+#endif
+
+enum CodecID {CODEC_ID_NONE, CODEC_ID_MPEG1VIDEO, CODEC_ID_MPEG2VIDEO, CODEC_ID_H264};
+
+typedef struct AVRational
+{
+    int num, den;
+} AVRational;
+
+typedef struct ByteIOContext
+{
+    const uint8_t *data;
+    int64_t size;
+    int64_t pos;
+    int64_t nb_seeks; // url_fseek calls
+    int64_t nb_read; // bytes read
+} ByteIOContext;
+
+typedef struct AVCodecContext
+{
+    enum CodecID codec_id;
+} AVCodecContext;
+
+typedef struct AVStream
+{
+    int id;
+    AVRational time_base;
+    AVCodecContext *codec;
+} AVStream;
+
+typedef struct AVInputFormat
+{
+    const char *name;
+} AVInputFormat;
+
+typedef struct AVFormatContext
+{
+    AVInputFormat *iformat;
+    ByteIOContext *pb;
+    AVStream *streams[1];
+    int64_t seek_pos; // where the last av_seek_frame went, -1 if none
+} AVFormatContext;
+
+static inline void *av_malloc(size_t size) { return malloc(size); }
+static inline void av_free(void *p) { free(p); }
+static inline void av_log(void *avcl, int level, const char *fmt, ...) { (void) avcl; (void) level; (void) fmt; }
+
+// a * b / c rounded to nearest, like av_rescale
+static inline int64_t av_rescale(int64_t a, int64_t b, int64_t c)
+{
+    __int128 r = (__int128) a * b;
+    return (int64_t) ((r + (r < 0 ? -c/2 : c/2)) / c);
+}
+
+static inline int64_t url_fsize(ByteIOContext *pb) { return pb->size; }
+static inline int64_t url_ftell(ByteIOContext *pb) { return pb->pos; }
+
+static inline int64_t url_fseek(ByteIOContext *pb, int64_t offset, int whence)
+{
+    if (SEEK_SET != whence || offset < 0 || offset > pb->size) {
+        return -1;
+    }
+    pb->nb_seeks++;
+    pb->pos = offset;
+    return offset;
+}
+
+static inline int get_buffer(ByteIOContext *pb, unsigned char *buf, int size)
+{
+    int n = (int) MIN((int64_t) size, pb->size - pb->pos);
+    memcpy(buf, pb->data + pb->pos, n);
+    pb->pos += n;
+    pb->nb_read += n;
+    return n;
+}
+
+static inline int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int flags)
+{
+    (void) stream_index;
+    if (AVSEEK_FLAG_BYTE != flags) {
+        return -1;
+    }
+    s->seek_pos = timestamp;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Checks that mtn makes the same contact sheets with -m workers as without.
+#
+#   MTN=/path/to/mtn ./workers.sh [work dir]
+#
+# Needs an mtn build and an ffmpeg with lavfi and libx264 to make the input:
+# mpeg-2 and h.264 transport streams like DVB recordings (the mpeg-2 one with
+# a second service so the keyframe index has to pick the video pid) and an
+# mpeg-ps file, whose demuxer adds to its index while bisecting. Each file is
+# thumbnailed in seek mode with evasion on (-D 6 and the default -b), once with
+# -m 1 and once with -m 2 and -m 4; the sheets and the individual shots (-I)
+# have to be byte identical. Exits with 1 if one differs.
+
+MTN=${MTN:-mtn}
+FFMPEG=${FFMPEG:-ffmpeg}
+WORK=${1:-build/workers}
+
+mkdir -p "$WORK" || exit 1
+
+# 10 minutes with cuts to black every 97 s, so some shots are evaded
+make_input()
+{
+  out=$1
+  shift
+  [ -f "$WORK/$out" ] && return 0
+  "$FFMPEG" -loglevel error -y \
+    -f lavfi -i "testsrc2=size=720x576:rate=25:duration=600,noise=alls=12:allf=t,drawbox=enable='lt(mod(t,97),3)':color=black:t=fill" \
+    -f lavfi -i "sine=frequency=440:duration=600" \
+    "$@" "$WORK/$out"
+}
+
+make_input mpeg2.ts -c:v mpeg2video -b:v 3M -g 12 -bf 2 -c:a mp2 -f mpegts \
+  -program title=one:st=0:st=1 -program title=two:st=1 || exit 1
+make_input h264.ts -c:v libx264 -preset veryfast -g 50 -bf 3 -c:a mp2 -f mpegts || exit 1
+make_input mpeg2.mpg -c:v mpeg2video -b:v 3M -g 15 -bf 2 -c:a mp2 -f vob || exit 1
+
+status=0
+for input in mpeg2.ts h264.ts mpeg2.mpg; do
+  for m in 1 2 4; do
+    rm -rf "$WORK/m$m" && mkdir -p "$WORK/m$m"
+    "$MTN" -P -z -i -t -I -D 6 -c 4 -r 8 -m $m -O "$WORK/m$m" "$WORK/$input" > "$WORK/m$m.log" 2>&1
+  done
+  for m in 2 4; do
+    if diff -r "$WORK/m1" "$WORK/m$m" > /dev/null; then
+      echo "$input -m $m: `ls "$WORK/m1" | wc -l` files same as -m 1  ok"
+    else
+      echo "$input -m $m: differs from -m 1  FAILED"
+      status=1
+    fi
+  done
+done
+exit $status
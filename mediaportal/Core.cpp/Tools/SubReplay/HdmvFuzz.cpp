@@ -0,0 +1,121 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Decodes and renders corrupt PGS objects. Built with AddressSanitizer, which
+// aborts on the first write outside a bitmap or picture.
+//
+//   hdmvfuzz [iterations]
+//
+// The run length data mixes random bytes with the longest runs the coding
+// allows (16383 pixels) and lines that never end, so the column counter goes far
+// past the object width. The same seed is used on every run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "stdafx.h"
+#include "compositionobject.h"
+
+static unsigned int s_seed = 20101217;
+
+static unsigned int Random(unsigned int range)
+{
+  s_seed=s_seed*1103515245+12345;
+  return (s_seed>>8) % range;
+}
+
+static void MakeRle(std::vector<BYTE>& rle)
+{
+  rle.clear();
+  int codes=1+Random(400);
+  for (int i=0; i<codes; i++)
+  {
+    switch (Random(6))
+    {
+      case 0:     // a long run of color 0
+        rle.push_back(0);
+        rle.push_back(0x7f);
+        rle.push_back(0xff);
+        break;
+      case 1:     // a long run of another color
+        rle.push_back(0);
+        rle.push_back(0xc0 | Random(0x40));
+        rle.push_back((BYTE)Random(256));
+        rle.push_back((BYTE)Random(256));
+        break;
+      case 2:     // end of line
+        rle.push_back(0);
+        rle.push_back(0);
+        break;
+      default:
+        rle.push_back((BYTE)Random(256));
+        break;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int iterations=argc > 1 ? atoi(argv[1]) : 20000;
+  std::vector<BYTE> rle;
+  std::vector<DWORD> picture;
+  HDMV_PALETTE palette[256];
+  int decoded=0;
+
+  for (int i=0; i<256; i++)
+  {
+    palette[i].entry_id=(BYTE)i;
+    palette[i].Y=(BYTE)(16+i*7);
+    palette[i].Cr=(BYTE)(128+i%13);
+    palette[i].Cb=(BYTE)(128-i%11);
+    palette[i].T=(BYTE)(i*3);
+  }
+
+  for (int i=0; i<iterations; i++)
+  {
+    MakeRle(rle);
+
+    CompositionObject* object=new CompositionObject();
+    object->m_object_id_ref=(SHORT)Random(2);
+    object->m_width=(SHORT)(1+Random(Random(8)==0 ? 4096 : 64));
+    object->m_height=(SHORT)(1+Random(64));
+    object->SetRLEData(&rle[0], (int)rle.size(), (int)rle.size());
+    object->SetPalette(256, palette, (i & 1)!=0);
+
+    CompositionObjectBitmap* bitmap=object->DecodeHdmv(object->m_object_id_ref);
+    if (bitmap)
+    {
+      decoded++;
+      object->SetBitmap(bitmap);
+      bitmap->Release();
+    }
+
+    SubPicDesc spd;
+    spd.w=object->m_width;
+    spd.h=object->m_height;
+    spd.bpp=32;
+    spd.pitch=spd.w*4;
+    picture.assign(spd.w*spd.h, 0xff000000);
+    spd.bits=&picture[0];
+    object->RenderHdmv(spd);
+
+    delete object;
+  }
+
+  printf("%d corrupt objects, %d decoded  ok\n", iterations, decoded);
+  return 0;
+}
@@ -0,0 +1,463 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Replays synthetic Blu-ray PGS streams through CHdmvSub and hashes what it
+// renders.
+//
+//   hdmvreplay [-full] [expected hash]
+//
+// Each epoch shows one object of text lines: it fades in over 8 compositions,
+// moves 4 times and fades out over 8 compositions. The stream is made twice:
+//   full     every composition carries the palette and the object again, like
+//            the decoder before the object cache needed
+//   update   the object is sent once per epoch, fades only send a palette
+//            and moves only a presentation segment
+// Both have to render the same pictures. The hash is taken over the full stream,
+// "make check" passes the one of the decoder before the object cache, see the
+// hdmv-reference target of the Makefile. -full only plays the full stream, the
+// old decoder can't draw the update one. The CPU time the decoder takes to
+// parse and render a composition is printed so builds can be compared.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "stdafx.h"
+#include "hdmvsub.h"
+
+#define SD_EPOCHS       150
+#define HD_EPOCHS       100
+#define FADE_STEPS      8
+#define MOVE_STEPS      4
+#define STEP_TIME       400000      // 40 ms between compositions
+
+// CPU time of the process in seconds
+static double CpuTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+// PES payload of one segment
+class CSample : public IMediaSample
+{
+public:
+  CSample(std::vector<BYTE>& data, REFERENCE_TIME time) : m_data(data), m_time(time) {}
+
+  virtual HRESULT GetPointer(BYTE** ppBuffer)     { *ppBuffer=&m_data[0]; return S_OK; }
+  virtual long    GetActualDataLength()           { return (long)m_data.size(); }
+  virtual HRESULT GetTime(REFERENCE_TIME* pTimeStart, REFERENCE_TIME* pTimeEnd)
+  {
+    *pTimeStart=m_time;
+    *pTimeEnd=m_time;
+    return S_OK;
+  }
+
+private:
+  std::vector<BYTE>& m_data;
+  REFERENCE_TIME     m_time;
+};
+
+// Writes the segments of a stream and hands each one to the decoder
+class CSegmentWriter
+{
+public:
+  CSegmentWriter(CHdmvSub* sub) : m_sub(sub) { cpu=0; }
+
+  // time spent in the decoder
+  double cpu;
+
+  void Begin(BYTE type)
+  {
+    m_data.clear();
+    m_data.push_back(type);
+    m_data.push_back(0);
+    m_data.push_back(0);
+  }
+
+  void Byte(int value)  { m_data.push_back((BYTE)value); }
+  void Short(int value) { Byte(value>>8); Byte(value); }
+
+  void Bytes(const BYTE* data, size_t len)
+  {
+    m_data.insert(m_data.end(), data, data+len);
+  }
+
+  void End(REFERENCE_TIME time)
+  {
+    size_t size=m_data.size()-3;
+    m_data[1]=(BYTE)(size>>8);
+    m_data[2]=(BYTE)size;
+    CSample sample(m_data, time);
+    double start=CpuTime();
+    m_sub->ParseSample(&sample);
+    cpu+=CpuTime()-start;
+  }
+
+private:
+  CHdmvSub*         m_sub;
+  std::vector<BYTE> m_data;
+};
+
+// An object of text lines as palette indices: 0xff around the text, 2 outline,
+// 1 fill and 3 to 6 for the anti aliased edge of the outline
+struct CTextObject
+{
+  int               width;
+  int               height;
+  std::vector<BYTE> index;
+  std::vector<BYTE> rle;
+
+  void Make(int w, int h, int cell, unsigned int seed)
+  {
+    width=w;
+    height=h;
+    index.assign(w*h, 0xff);
+    for (int line=0; line+cell <= h; line+=cell)
+    {
+      for (int x=cell/4; x+cell/2 <= w-cell/4; x+=cell/2)
+      {
+        seed=seed*1103515245+12345;
+        if (((seed>>16) & 7)==0) continue;   // a space
+        int stroke=cell/8;
+        int left=x+(int)((seed>>8) & 3);
+        int top=line+cell/6+(int)((seed>>12) & 3);
+        int right=left+cell/3;
+        int bottom=line+cell-cell/6;
+        for (int y=top-2; y<bottom+2; y++)
+        {
+          for (int px=left-2; px<right+2; px++)
+          {
+            bool inside=(y >= top && y < bottom && px >= left && px < right);
+            bool fill=inside && (px < left+stroke || y < top+stroke || ((seed>>20) & 1 ? y >= bottom-stroke : px >= right-stroke));
+            BYTE& p=index[y*w+px];
+            if (fill)
+              p=1;
+            else if (inside || y==top-1 || y==bottom || px==left-1 || px==right)
+              p=p==1 ? 1 : 2;
+            else if (p==0xff)
+              p=(BYTE)(3+((px+y) & 3));
+          }
+        }
+      }
+    }
+    Encode();
+  }
+
+  void Encode()
+  {
+    rle.clear();
+    for (int y=0; y<height; y++)
+    {
+      const BYTE* row=&index[y*width];
+      for (int x=0; x<width;)
+      {
+        int count=1;
+        while (x+count < width && row[x+count]==row[x] && count < 0x3fff) count++;
+        Run(row[x], count);
+        x+=count;
+      }
+      rle.push_back(0);
+      rle.push_back(0);
+    }
+  }
+
+  void Run(BYTE color, int count)
+  {
+    if (color!=0 && count <= 2)
+    {
+      for (int i=0; i<count; i++) rle.push_back(color);
+      return;
+    }
+    rle.push_back(0);
+    int flags=(color!=0 ? 0x80 : 0) | (count >= 64 ? 0x40 : 0);
+    if (count >= 64)
+    {
+      rle.push_back((BYTE)(flags | (count>>8)));
+      rle.push_back((BYTE)count);
+    }
+    else
+      rle.push_back((BYTE)(flags | count));
+    if (color!=0) rle.push_back(color);
+  }
+};
+
+struct ReplayResult
+{
+  int    compositions;
+  int    rendered;
+  UINT64 hash;
+  double cpu;
+};
+
+static void Hash(UINT64& hash, const void* data, size_t len)
+{
+  const BYTE* p=(const BYTE*)data;
+  for (size_t i=0; i<len; i++)
+    hash=(hash ^ p[i])*1099511628211ULL;
+}
+
+class CReplay
+{
+public:
+  CReplay(int videoWidth, int videoHeight, bool full, ReplayResult& result)
+    : m_writer(&m_sub), m_result(result)
+  {
+    m_videoWidth=videoWidth;
+    m_videoHeight=videoHeight;
+    m_full=full;
+    m_number=0;
+    m_time=10000000;
+    m_pending=-1;
+    m_picture.resize(videoWidth*videoHeight);
+  }
+
+  void Epoch(CTextObject& object, int objectId, int version, unsigned int seed)
+  {
+    int x=(m_videoWidth-object.width)/2;
+    int y=m_videoHeight-object.height-m_videoHeight/12;
+    int paletteVersion=0;
+
+    for (int step=1; step <= FADE_STEPS; step++)
+      Composition(object, objectId, version, x, y, step==1, true, paletteVersion++, step*255/FADE_STEPS, seed);
+    for (int step=1; step <= MOVE_STEPS; step++)
+    {
+      y-=m_videoHeight/40;
+      x+=(step & 1) ? 7 : -3;
+      Composition(object, objectId, version, x, y, false, false, paletteVersion, 255, seed);
+    }
+    for (int step=FADE_STEPS-1; step >= 0; step--)
+      Composition(object, objectId, version, x, y, false, true, paletteVersion++, step*255/FADE_STEPS, seed);
+  }
+
+  void Finish()
+  {
+    // an empty composition ends the last one
+    REFERENCE_TIME time=m_time;
+    Presentation(0, 0, 0, false, false, 0, 0, 0);
+    m_writer.Begin(CHdmvSub::END_OF_DISPLAY);
+    m_writer.End(time);
+    Render();
+    m_sub.Reset();
+    m_result.cpu+=m_writer.cpu;
+  }
+
+private:
+  CHdmvSub       m_sub;
+  CSegmentWriter m_writer;
+  ReplayResult&  m_result;
+  int            m_videoWidth;
+  int            m_videoHeight;
+  bool           m_full;
+  int            m_number;
+  REFERENCE_TIME m_time;
+  REFERENCE_TIME m_pending;
+  std::vector<DWORD> m_picture;
+
+  void Composition(CTextObject& object, int objectId, int version, int x, int y, bool epochStart,
+                   bool paletteUpdate, int paletteVersion, int alpha, unsigned int seed)
+  {
+    REFERENCE_TIME time=m_time;
+
+    bool sendObject=epochStart || m_full;
+    bool sendPalette=sendObject || paletteUpdate;
+    Presentation(objectId, x, y, epochStart, !sendObject && paletteUpdate, 1, object.width, object.height);
+    if (sendPalette) Palette(paletteVersion, alpha, seed);
+    if (sendObject) Object(object, objectId, version);
+    m_writer.Begin(CHdmvSub::END_OF_DISPLAY);
+    m_writer.End(time);
+
+    // a composition is complete when the next one starts
+    Render();
+    m_result.compositions++;
+    m_pending=time;
+    m_time+=STEP_TIME;
+  }
+
+  void Presentation(int objectId, int x, int y, bool epochStart, bool paletteUpdate, int objects, int width, int height)
+  {
+    m_writer.Begin(CHdmvSub::PRESENTATION_SEG);
+    m_writer.Short(m_videoWidth);
+    m_writer.Short(m_videoHeight);
+    m_writer.Byte(0x10);
+    m_writer.Short(m_number++);
+    m_writer.Byte(epochStart ? 0x80 : 0x00);
+    m_writer.Byte(paletteUpdate ? 0x80 : 0x00);
+    m_writer.Byte(0);
+    m_writer.Byte(objects);
+    if (objects > 0)
+    {
+      m_writer.Short(objectId);
+      m_writer.Byte(0);
+      m_writer.Byte(0);
+      m_writer.Short(x);
+      m_writer.Short(y);
+    }
+    m_writer.End(m_time);
+
+    if (objects > 0)
+    {
+      m_writer.Begin(CHdmvSub::WINDOW_DEF);
+      m_writer.Byte(1);
+      m_writer.Byte(0);
+      m_writer.Short(x);
+      m_writer.Short(y);
+      m_writer.Short(width);
+      m_writer.Short(height);
+      m_writer.End(m_time);
+    }
+  }
+
+  void Palette(int version, int alpha, unsigned int seed)
+  {
+    m_writer.Begin(CHdmvSub::PALETTE);
+    m_writer.Byte(0);
+    m_writer.Byte(version);
+    for (int id=1; id <= 6; id++)
+    {
+      int t=id==1 ? alpha : id==2 ? alpha*7/8 : alpha*(7-id)/5;
+      m_writer.Byte(id);
+      m_writer.Byte(id==1 ? 200+(seed & 31) : 16+id*8);
+      m_writer.Byte(id==1 ? 128 : 120+id*3+(seed>>5 & 7));
+      m_writer.Byte(id==1 ? 128 : 136-id*2);
+      m_writer.Byte(t);
+    }
+    m_writer.End(m_time);
+  }
+
+  void Object(CTextObject& object, int objectId, int version)
+  {
+    const size_t firstPart=0xffff-11;
+    const size_t nextPart=0xffff-4;
+    size_t len=object.rle.size();
+    size_t pos=0;
+
+    while (pos==0 || pos < len)
+    {
+      size_t part=min(len-pos, pos==0 ? firstPart : nextPart);
+      bool last=(pos+part==len);
+      m_writer.Begin(CHdmvSub::OBJECT);
+      m_writer.Short(objectId);
+      m_writer.Byte(version);
+      m_writer.Byte((pos==0 ? 0x80 : 0) | (last ? 0x40 : 0));
+      if (pos==0)
+      {
+        m_writer.Byte((int)((len+4)>>16));
+        m_writer.Short((int)(len+4));
+        m_writer.Short(object.width);
+        m_writer.Short(object.height);
+      }
+      m_writer.Bytes(&object.rle[pos], part);
+      m_writer.End(m_time);
+      pos+=part;
+    }
+  }
+
+  // Renders the composition shown at m_pending like the subpicture allocator
+  // does: into a cleared picture of the video size, drawn at its position
+  void Render()
+  {
+    if (m_pending < 0) return;
+
+    for (POSITION pos=m_sub.GetStartPosition(m_pending, 25.0); pos; pos=m_sub.GetNext(pos))
+    {
+      if (m_sub.GetStart(pos)!=m_pending) continue;
+
+      SIZE maxTextureSize, videoSize;
+      POINT topLeft;
+      m_sub.GetTextureSize(pos, maxTextureSize, videoSize, topLeft);
+
+      SubPicDesc spd;
+      spd.w=m_videoWidth;
+      spd.h=m_videoHeight;
+      spd.bpp=32;
+      spd.pitch=m_videoWidth*4;
+      spd.bits=&m_picture[0];
+      memsetd(spd.bits, 0xff000000, m_picture.size()*4);
+
+      RECT bbox={ 0, 0, 0, 0 };
+      double start=CpuTime();
+      m_sub.Render(spd, m_pending, bbox);
+      m_result.cpu+=CpuTime()-start;
+      if (bbox.right > bbox.left)
+        m_result.rendered++;
+
+      Hash(m_result.hash, &topLeft, sizeof(topLeft));
+      Hash(m_result.hash, &bbox, sizeof(bbox));
+      for (LONG y=bbox.top; y<bbox.bottom; y++)
+        Hash(m_result.hash, &m_picture[y*m_videoWidth+bbox.left], (bbox.right-bbox.left)*4);
+    }
+    m_pending=-1;
+  }
+};
+
+static void Replay(int videoWidth, int videoHeight, int epochs, bool full, ReplayResult& result)
+{
+  CReplay replay(videoWidth, videoHeight, full, result);
+  CTextObject object;
+  bool hd=videoWidth > 720;
+
+  for (int epoch=0; epoch<epochs; epoch++)
+  {
+    unsigned int seed=epoch*2654435761u+videoWidth;
+    // one or two lines, every third epoch a narrow one
+    int lines=1+(epoch & 1);
+    int cell=hd ? 64 : 36;
+    int width=(epoch%3==2 ? videoWidth/3 : videoWidth*3/4) & ~1;
+    object.Make(width, lines*cell, cell, seed);
+    replay.Epoch(object, epoch & 1, epoch & 0xff, seed);
+  }
+  replay.Finish();
+}
+
+static bool Check(const char* name, const ReplayResult& result, UINT64 expected, bool compare)
+{
+  bool ok=!compare || result.hash==expected;
+  printf("%-11s %5d compositions, %5d rendered, %7.1f us cpu per composition, hash %016llx  %s\n",
+         name, result.compositions, result.rendered, result.cpu*1e6/result.compositions,
+         (unsigned long long)result.hash, !compare ? "" : ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  bool fullOnly=(argc > 1 && strcmp(argv[1], "-full")==0);
+  const char* expected=argc > (fullOnly ? 2 : 1) ? argv[fullOnly ? 2 : 1] : NULL;
+
+  ReplayResult sdFull={ 0, 0, 1469598103934665603ULL, 0 };
+  ReplayResult hdFull=sdFull, sdUpdate=sdFull, hdUpdate=sdFull;
+
+  Replay(720, 576, SD_EPOCHS, true, sdFull);
+  Replay(1920, 1080, HD_EPOCHS, true, hdFull);
+
+  char hash[17];
+  sprintf(hash, "%016llx", (unsigned long long)hdFull.hash ^ sdFull.hash);
+  bool match=(expected==NULL || strcmp(expected, hash)==0);
+  bool ok=match;
+  Check("sd full", sdFull, 0, false);
+  Check("hd full", hdFull, 0, false);
+  if (!fullOnly)
+  {
+    Replay(720, 576, SD_EPOCHS, false, sdUpdate);
+    Replay(1920, 1080, HD_EPOCHS, false, hdUpdate);
+    ok&=Check("sd update", sdUpdate, sdFull.hash, true);
+    ok&=Check("hd update", hdUpdate, hdFull.hash, true);
+  }
+  printf("picture hash %s  %s\n", hash, expected==NULL ? "" : match ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// The part of CRenderedTextSubtitle the tag parsing taken by ssatags.awk uses.
+// No include guard: ssatags.cpp includes it once per namespace, each time
+// followed by the functions taken from one version of RTS.cpp. Only one of the
+// ParseSSATag() overloads is defined in each.
+
+class CRenderedTextSubtitle
+{
+public:
+  CRenderedTextSubtitle() : m_animStart(0), m_animEnd(0), m_animAccel(1), m_log(NULL), m_count(0) {}
+
+  int m_animStart, m_animEnd;
+  double m_animAccel;
+
+  // with a log every command is written to it, else only counted
+  std::vector<std::wstring>* m_log;
+  size_t m_count;
+
+  void Record(const CStringW& cmd, const CAtlArray<CStringW>& params, bool fAnimate)
+  {
+    m_count+=1+params.GetCount();
+    if (m_log==NULL) return;
+
+    std::wstring s=(const wchar_t*)cmd;
+    for (size_t i=0; i<params.GetCount(); i++)
+    {
+      s+=i==0 ? L"(" : L",";
+      s+=(const wchar_t*)params[i];
+    }
+    if (fAnimate)
+    {
+      wchar_t anim[64];
+      swprintf(anim, 64, L" animated %d %d %g", m_animStart, m_animEnd, m_animAccel);
+      s+=anim;
+    }
+    m_log->push_back(s);
+  }
+
+  bool ParseSSATag(CSubtitle* sub, CStringW str, STSStyle& style, STSStyle& org, bool fAnimate = false);
+  bool ParseSSATag(CSubtitle* sub, CSSATag* tags, size_t nTags, STSStyle& style, STSStyle& org, bool fAnimate = false);
+};
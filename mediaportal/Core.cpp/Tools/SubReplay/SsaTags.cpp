@@ -0,0 +1,353 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Plays a generated tag heavy ssa script through the override tag parsing of
+// RTS.cpp as it is, with the tags of an entry tokenized once and cached, and as
+// it was before, splitting every {} block again for every frame.
+//
+//   ssatags
+//
+// ssatags.awk takes the tokenizing and the \t handling from both versions of
+// RTS.cpp, ParseSSATag() records each command it would apply. The {} walk of
+// GetSubtitle() and the cache handling around it are copied below. The script
+// has karaoke lines with \k and nested \t per syllable, signs with \move,
+// \clip and \fade, odd spacing, broken brackets and random tag soup; now and
+// then a visible entry gets a new text, which has to drop its cached tags.
+//   equal   every frame, every visible entry records the same commands with
+//           the same parameters and \t timing in both versions
+//   frame   CPU time of the tag parsing per frame, each version; rasterizing
+//           and the rest of GetSubtitle() is not part of it
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "stdafx.h"
+#include <atlstr.h>
+
+struct CSubtitle
+{
+  bool m_fAnimated;
+
+  CSubtitle() : m_fAnimated(false) {}
+};
+
+struct STSStyle {};
+
+#include "ssatags.h"
+
+namespace Before
+{
+#include "SsaTagParser.h"
+#include "before.inc"
+}
+
+namespace After
+{
+#include "SsaTagParser.h"
+#include "after.inc"
+}
+
+#define SCRIPT_MINUTES 2
+#define FRAME_TIME     40
+
+// CPU time of the process in seconds
+static double CpuTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+static unsigned int s_seed=4711;
+
+static int Random(int n)
+{
+  s_seed=s_seed*1103515245+12345;
+  return (int)((s_seed>>8)%(unsigned int)n);
+}
+
+static const wchar_t* s_tags[]=
+{
+  L"\\an8", L"\\pos(640,50)", L"\\pos( 320 , 40 )", L"\\fad(200,200)", L"\\fade(255,0,255,0,100,200,300)",
+  L"\\move(10,20,300,400,0,500)", L"\\org(320,240)", L"\\clip(m 0 0 l 100 0 100 100 l 0 100)",
+  L"\\iclip(10,10,200,200)", L"\\clip(2,m 0 0 l 50 50)",
+  L"\\t(0,500,\\fscx120\\fscy120)", L"\\t(\\frz10\\t(\\blur2))", L"\\t(100,300,0.5,\\1c&H00FFFF&\\3c&H0000FF&)",
+  L"\\t(2,\\alpha&HFF&)", L"\\t(1,2,3,4,5,\\b1)", L"\\t()", L"\\t(", L"\\t(0,200,\\t(50,100,\\t(\\fs20)))",
+  L"\\t( 0 , 250 , \\bord4 \\shad0 )", L"\\t(\\clip(0,0,10,10))",
+  L"\\k25", L"\\K20", L"\\kf30", L"\\ko40", L"\\kt50", L"\\k",
+  L"\\1c&H00FF00&", L"\\c&HFFFFFF&", L"\\2c&HFF&", L"\\3a&H80&", L"\\4a&HFF", L"\\alpha&H40&", L"\\a6", L"\\an",
+  L"\\b1", L"\\b700", L"\\i1", L"\\u0", L"\\s1", L"\\bord2.5", L"\\xbord3", L"\\ybord1", L"\\xshad-2", L"\\yshad1",
+  L"\\shad2", L"\\be1", L"\\blur0.8", L"\\fnArial Black", L"\\fn Times", L"\\fs40", L"\\fsp2", L"\\fscx90",
+  L"\\fscy110", L"\\fsc", L"\\frx10", L"\\fry-5", L"\\frz45", L"\\fr30", L"\\fax0.1", L"\\fay-0.2", L"\\fe1",
+  L"\\q2", L"\\r", L"\\rDefault", L"\\p1", L"\\p0", L"\\pbo-5", L"\\N", L" \\ ", L"\\", L"\\\\", L"\\unknown(1,2)",
+  L"comment", L"\\b1 \\i1 ", L"\\pos(1,2", L"\\move((1,2),(3,4))", L"\\fad(,,)", L"\\pos(,5,,6,)"
+};
+
+static const wchar_t* s_syllables[]={L"ka", L"ra", L"o", L"ke", L" ", L"shi", L"n", L"x}y", L"{unclosed", L""};
+
+static std::wstring TagSoup()
+{
+  static const wchar_t chars[]=L"\\\\\\(),&H 0123456789abcfiknprstxy.-";
+  std::wstring s;
+  for (int i=1+Random(12); i>0; i--)
+  {
+    s+=chars[Random((int)wcslen(chars))];
+  }
+  return s;
+}
+
+static std::wstring Block(int tags)
+{
+  std::wstring s=L"{";
+  for (int i=0; i<tags; i++)
+  {
+    s+=Random(10)==0 ? TagSoup() : s_tags[Random(sizeof(s_tags)/sizeof(s_tags[0]))];
+  }
+  return s+L"}";
+}
+
+struct Entry
+{
+  int start, end;
+  std::wstring text;
+};
+
+static std::wstring MakeText()
+{
+  std::wstring s;
+  if (Random(4)==0)
+  {
+    // a sign
+    s=Block(5+Random(6))+L"Sign text"+Block(1+Random(3))+L"more";
+  }
+  else
+  {
+    // a karaoke line
+    s=Block(3+Random(4));
+    for (int i=8+Random(13); i>0; i--)
+    {
+      s+=Block(1+Random(3))+s_syllables[Random(sizeof(s_syllables)/sizeof(s_syllables[0]))];
+    }
+  }
+  return s;
+}
+
+static void MakeScript(std::vector<Entry>& script)
+{
+  for (int start=0; start<SCRIPT_MINUTES*60000; start+=100+Random(200))
+  {
+    Entry entry={start, start+2000+Random(6000), MakeText()};
+    script.push_back(entry);
+  }
+}
+
+// GetSubtitle() before the tag cache, the text between the blocks is skipped
+static void ParseBefore(Before::CRenderedTextSubtitle& rts, CStringW str)
+{
+  CSubtitle sub;
+  STSStyle stss, orgstss;
+
+  while(!str.IsEmpty()) {
+    bool fParsed = false;
+
+    int i;
+
+    if(str[0] == '{' && (i = str.Find(L'}')) > 0) {
+      fParsed = rts.ParseSSATag(&sub, str.Mid(1, i-1), stss, orgstss);
+      if(fParsed) {
+        str = str.Mid(i+1);
+      }
+    }
+
+    if(fParsed) {
+      i = str.Find(L'{');
+      if(i < 0) {
+        i = str.GetLength();
+      }
+      if(i == 0) {
+        continue;
+      }
+    } else {
+      i = str.Mid(1).Find(L'{');
+      if(i < 0) {
+        i = str.GetLength()-1;
+      }
+      i++;
+    }
+
+    str = str.Mid(i);
+  }
+}
+
+// GetSubtitle() with the tag cache, a std::map in place of the CAtlMap
+static void ParseAfter(After::CRenderedTextSubtitle& rts, std::map<int, CSSATags*>& tagCache, int entry, CStringW str)
+{
+  CSubtitle sub;
+  STSStyle stss, orgstss;
+
+  CSSATags*& tags = tagCache[entry];
+  if(tags == NULL || tags->str != str) {
+    delete tags;
+    tags = new CSSATags();
+    tags->str = str;
+    tags->blocks.Add(0);
+  }
+  size_t iBlock = 0;
+
+  while(!str.IsEmpty()) {
+    bool fParsed = false;
+
+    int i;
+
+    if(str[0] == '{' && (i = str.Find(L'}')) > 0) {
+      if(iBlock + 1 >= tags->blocks.GetCount()) {
+        After::TokenizeSSATag(str.Mid(1, i-1), tags->tags);
+        tags->blocks.Add(tags->tags.GetCount());
+      }
+      size_t first = tags->blocks[iBlock], last = tags->blocks[iBlock+1];
+      iBlock++;
+      fParsed = rts.ParseSSATag(&sub, tags->tags.GetData() + first, last - first, stss, orgstss);
+      if(fParsed) {
+        str = str.Mid(i+1);
+      }
+    }
+
+    if(fParsed) {
+      i = str.Find(L'{');
+      if(i < 0) {
+        i = str.GetLength();
+      }
+      if(i == 0) {
+        continue;
+      }
+    } else {
+      i = str.Mid(1).Find(L'{');
+      if(i < 0) {
+        i = str.GetLength()-1;
+      }
+      i++;
+    }
+
+    str = str.Mid(i);
+  }
+}
+
+// what Render() drops from the cache, the entries more than 30s away
+static void TrimCache(std::map<int, CSSATags*>& tagCache, const std::vector<Entry>& script, int t)
+{
+  for (std::map<int, CSSATags*>::iterator it=tagCache.begin(); it!=tagCache.end(); )
+  {
+    const Entry& entry=script[it->first];
+    if (entry.end<=t-30000 || entry.start>t+30000)
+    {
+      delete it->second;
+      tagCache.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+// Plays every frame of the script through one version; with logs for each
+// visible entry, else only timed
+static double Play(std::vector<Entry> script, bool after, std::vector<std::vector<std::wstring> >* logs, size_t& count)
+{
+  Before::CRenderedTextSubtitle before;
+  After::CRenderedTextSubtitle rts;
+  std::map<int, CSSATags*> tagCache;
+  std::vector<std::wstring> log;
+  before.m_log=rts.m_log=logs!=NULL ? &log : NULL;
+  s_seed=99;
+
+  double cpu=0;
+  int first=0, frame=0;
+  for (int t=0; t<SCRIPT_MINUTES*60000+8000; t+=FRAME_TIME, frame++)
+  {
+    while (first<(int)script.size() && script[first].end<=t) first++;
+    // now and then an entry on screen gets edited
+    if (frame%250==100 && first<(int)script.size())
+    {
+      int i=first+Random(5);
+      if (i<(int)script.size()) script[i].text=MakeText();
+    }
+
+    double t0=CpuTime();
+    for (int i=first; i<(int)script.size() && script[i].start<=t; i++)
+    {
+      if (script[i].end<=t) continue;
+      CStringW str(script[i].text.c_str());
+      if (after)
+      {
+        ParseAfter(rts, tagCache, i, str);
+      }
+      else
+      {
+        ParseBefore(before, str);
+      }
+      if (logs!=NULL)
+      {
+        logs->push_back(log);
+        log.clear();
+      }
+    }
+    if (after) TrimCache(tagCache, script, t);
+    cpu+=CpuTime()-t0;
+  }
+
+  TrimCache(tagCache, script, INT32_MIN/2);
+  count=after ? rts.m_count : before.m_count;
+  return cpu/frame;
+}
+
+int main()
+{
+  std::vector<Entry> script;
+  MakeScript(script);
+
+  std::vector<std::vector<std::wstring> > beforeLogs, afterLogs;
+  size_t beforeCount, afterCount;
+  Play(script, false, &beforeLogs, beforeCount);
+  Play(script, true, &afterLogs, afterCount);
+  size_t commands=0, mismatch=0;
+  for (size_t i=0; i<beforeLogs.size() && i<afterLogs.size(); i++)
+  {
+    commands+=beforeLogs[i].size();
+    if (beforeLogs[i]!=afterLogs[i]) mismatch++;
+  }
+  bool equal=beforeLogs.size()==afterLogs.size() && mismatch==0;
+  printf("equal  %d entries, %d entry frames, %d commands, %d differ  %s\n",
+         (int)script.size(), (int)beforeLogs.size(), (int)commands, (int)mismatch, equal ? "ok" : "FAILED");
+
+  double beforeFrame=Play(script, false, NULL, beforeCount);
+  double afterFrame=Play(script, true, NULL, afterCount);
+  bool same=beforeCount==afterCount;
+  printf("frame  %d frames, tag parsing before %.1f us, after %.1f us per frame  %s\n",
+         SCRIPT_MINUTES*60000/FRAME_TIME, beforeFrame*1e6, afterFrame*1e6, same ? "ok" : "FAILED");
+
+  if (!equal || !same)
+  {
+    printf("ssa tags FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,264 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Checks the segment functions of STS.cpp against the ones from before the
+// segments were built in one sweep, on generated scripts of up to 20000 lines.
+//
+//   stssegments
+//
+// The functions are taken from both versions of STS.cpp by the Makefile and
+// compiled into the namespaces Before and After. Per script:
+//   segments    After::CreateSegments() makes the same segments as
+//               Before::CreateSegments(), and the same non empty ones as adding
+//               the lines one by one did before Open() deferred the segments
+//   searchsubs  SearchSubs() finds the same segment for every 40 ms of the
+//               script and for random times, by time and by frame
+//   searchsub   SearchSub() returns the first line starting at t, else the last
+//               one starting before it. The old bisection sometimes gives -1
+//               between two lines, those times are counted, not failed
+// The CPU time of each way of building the segments and of a lookup is printed
+// so builds can be compared; the old ones grow with lines * segments.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "stdafx.h"
+#include <atlstr.h>
+#include "ststypes.h"
+
+namespace Before
+{
+#include "StsSubtitle.h"
+#include "before.inc"
+}
+
+namespace After
+{
+#include "StsSubtitle.h"
+#include "after.inc"
+}
+
+// CPU time of the process in seconds
+static double CpuTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+static unsigned int s_seed=12345;
+
+static int Random(int n)
+{
+  s_seed=s_seed*1103515245+12345;
+  return (int)((s_seed>>8)%(unsigned int)n);
+}
+
+struct Line
+{
+  int start, end;
+};
+
+// Dialogue with overlapping speakers, karaoke blocks of syllables sharing a start
+// or an end, long signs over the dialogue and now and then a line twice. Sorted
+// by start like Sort() leaves a script.
+static void MakeScript(int lines, std::vector<Line>& script)
+{
+  script.clear();
+  int time=1000;
+  while ((int)script.size()<lines)
+  {
+    int kind=Random(20);
+    if (kind<14)
+    {
+      Line line={time, time+800+Random(4000)};
+      script.push_back(line);
+      if (Random(8)==0) script.push_back(line);
+      time+=300+Random(2500);
+    }
+    else if (kind<18)
+    {
+      int syllables=4+Random(10), end=time+syllables*250+Random(500);
+      for (int i=0; i<syllables; i++)
+      {
+        Line line={kind<16 ? time : time+i*250, kind<16 ? time+(i+1)*250 : end};
+        script.push_back(line);
+      }
+      time+=syllables*250;
+    }
+    else
+    {
+      Line line={time-Random(1000), time+20000+Random(40000)};
+      script.push_back(line);
+    }
+  }
+  std::stable_sort(script.begin(), script.end(), [](const Line& a, const Line& b) { return a.start<b.start; });
+}
+
+template <class T>
+static void Load(T& sts, const std::vector<Line>& script, bool deferSegments)
+{
+  sts.m_fDeferSegments=deferSegments;
+  for (size_t i=0; i<script.size(); i++)
+  {
+    sts.Add(L"line", true, script[i].start, script[i].end);
+  }
+  sts.m_fDeferSegments=false;
+}
+
+template <class A, class B>
+static bool SameSegments(A& a, B& b, bool skipEmpty)
+{
+  size_t i=0, j=0;
+  for (;;)
+  {
+    while (skipEmpty && i<a.m_segments.GetCount() && a.m_segments[i].subs.IsEmpty()) i++;
+    while (skipEmpty && j<b.m_segments.GetCount() && b.m_segments[j].subs.IsEmpty()) j++;
+    if (i==a.m_segments.GetCount() || j==b.m_segments.GetCount()) break;
+    const STSSegment& sa=a.m_segments[i++];
+    const STSSegment& sb=b.m_segments[j++];
+    if (sa.start!=sb.start || sa.end!=sb.end || sa.subs.GetCount()!=sb.subs.GetCount()) return false;
+    for (size_t k=0; k<sa.subs.GetCount(); k++)
+    {
+      if (sa.subs[k]!=sb.subs[k]) return false;
+    }
+  }
+  return i==a.m_segments.GetCount() && j==b.m_segments.GetCount();
+}
+
+static bool SameLookup(Before::CSimpleTextSubtitle& before, After::CSimpleTextSubtitle& after, int t, double fps)
+{
+  int beforeSegment=-2, afterSegment=-2, beforeCount=-2, afterCount=-2;
+  const STSSegment* a=before.SearchSubs(t, fps, &beforeSegment, &beforeCount);
+  const STSSegment* b=after.SearchSubs(t, fps, &afterSegment, &afterCount);
+  if (beforeSegment!=afterSegment || beforeCount!=afterCount) return false;
+  if (a==NULL || b==NULL) return a==NULL && b==NULL;
+  return a==&before.m_segments[beforeSegment] && b==&after.m_segments[afterSegment];
+}
+
+// what SearchSub() is documented to return, from the sorted start times
+static int SearchSubReference(const std::vector<int>& starts, int t)
+{
+  int n=(int)starts.size();
+  if (n>0 && t>=starts[n-1]) return n-1;
+  int i=(int)(std::lower_bound(starts.begin(), starts.end(), t)-starts.begin());
+  return i<n && starts[i]==t ? i : i-1;
+}
+
+static bool CheckScript(int lines)
+{
+  std::vector<Line> script;
+  MakeScript(lines, script);
+  int duration=script.back().start+60000;
+
+  Before::CSimpleTextSubtitle incremental, before;
+  After::CSimpleTextSubtitle after;
+
+  double t0=CpuTime();
+  Load(incremental, script, false);
+  double t1=CpuTime();
+  Load(before, script, false);
+  Load(after, script, true);
+  double t2=CpuTime();
+  before.CreateSegments();
+  double t3=CpuTime();
+  after.CreateSegments();
+  double t4=CpuTime();
+
+  bool segmentsOk=SameSegments(before, after, false) && SameSegments(incremental, after, true);
+  printf("%5d lines %6d segments  add one by one %8.1f ms, CreateSegments before %8.1f ms, after %6.2f ms  %s\n",
+         lines, (int)after.m_segments.GetCount(), (t1-t0)*1000, (t3-t2)*1000, (t4-t3)*1000,
+         segmentsOk ? "ok" : "FAILED");
+
+  bool searchSubsOk=true, searchSubOk=true;
+  int oldMisses=0, lookups=0;
+  double searchBefore=0, searchAfter=0;
+  const double fpsList[]={25, 23.976};
+  for (int mode=0; mode<2; mode++)
+  {
+    double fps=fpsList[mode];
+    before.m_mode=after.m_mode=mode==0 ? TIME : FRAME;
+    std::vector<int> starts;
+    for (size_t i=0; i<script.size(); i++)
+    {
+      starts.push_back(after.TranslateStart((int)i, fps));
+    }
+    // by frame the start and end are frame numbers, times go over the same lines
+    int scale=mode==0 ? 1 : (int)(1000/fps);
+    for (int pass=0; pass<2; pass++)
+    {
+      before.m_iLastSegment=after.m_iLastSegment=-1;
+      after.m_iLastSub=-1;
+      std::vector<int> times;
+      for (int i=0; i<duration/40; i++)
+      {
+        times.push_back((pass==0 ? i*40-500 : Random(duration+2000)-1000)*scale);
+      }
+
+      // the segments found are counted so the lookups can't be left out
+      int found=0;
+      double s0=CpuTime();
+      for (size_t i=0; i<times.size(); i++) found+=before.SearchSubs(times[i], fps)!=NULL;
+      double s1=CpuTime();
+      for (size_t i=0; i<times.size(); i++) found-=after.SearchSubs(times[i], fps)!=NULL;
+      double s2=CpuTime();
+      if (found!=0) searchSubsOk=false;
+      searchBefore+=s1-s0;
+      searchAfter+=s2-s1;
+      before.m_iLastSegment=after.m_iLastSegment=-1;
+
+      for (size_t i=0; i<times.size(); i++)
+      {
+        int t=times[i];
+        if (!SameLookup(before, after, t, fps)) searchSubsOk=false;
+        int expected=SearchSubReference(starts, t);
+        if (after.SearchSub(t, fps)!=expected) searchSubOk=false;
+        if (before.SearchSub(t, fps)!=expected) oldMisses++;
+        // right on a start, where the first of the lines starting there counts
+        int line=Random((int)script.size());
+        int start=starts[line];
+        expected=SearchSubReference(starts, start);
+        if (after.SearchSub(start, fps)!=expected) searchSubOk=false;
+        if (before.SearchSub(start, fps)!=expected) oldMisses++;
+        lookups+=2;
+      }
+    }
+  }
+  printf("%5d lines  SearchSubs before %6.3f us, after %6.3f us per lookup  %s\n",
+         lines, searchBefore*1e6/(lookups/2), searchAfter*1e6/(lookups/2), searchSubsOk ? "ok" : "FAILED");
+  printf("%5d lines  SearchSub %d lookups, the old one off on %d  %s\n",
+         lines, lookups, oldMisses, searchSubOk ? "ok" : "FAILED");
+  return segmentsOk && searchSubsOk && searchSubOk;
+}
+
+int main()
+{
+  const int sizes[]={200, 1000, 5000, 20000};
+  int failed=0;
+  for (size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+  {
+    if (!CheckScript(sizes[i])) failed++;
+  }
+  if (failed>0)
+  {
+    printf("%d script(s) FAILED\n", failed);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// The part of CSimpleTextSubtitle the segment functions of STS.cpp use. No include
+// guard: stssegments.cpp includes it once per namespace, each time followed by the
+// functions taken from one version of STS.cpp.
+
+class CSimpleTextSubtitle : public CAtlArray<STSEntry>
+{
+public:
+  CSimpleTextSubtitle() : m_fDeferSegments(false), m_iLastSegment(-1), m_iLastSub(-1), m_mode(TIME) {}
+
+  CAtlArray<STSSegment> m_segments;
+  bool m_fDeferSegments;
+  int m_iLastSegment;
+  int m_iLastSub;
+  tmode m_mode;
+
+  void OnChanged() {}
+
+  void Add(CStringW str, bool fUnicode, int start, int end, CString style = _T("Default"), CString actor = _T(""),
+           CString effect = _T(""), CRect marginRect = CRect(0, 0, 0, 0), int layer = 0, int readorder = -1);
+  void CreateSegments();
+  int SearchSub(int t, double fps);
+  const STSSegment* SearchSubs(int t, double fps, int* iSegment = NULL, int* nSegments = NULL);
+  int TranslateStart(int i, double fps);
+  int TranslateEnd(int i, double fps);
+  int TranslateSegmentStart(int i, double fps);
+  int TranslateSegmentEnd(int i, double fps);
+};
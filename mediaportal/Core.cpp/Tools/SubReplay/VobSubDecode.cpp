@@ -0,0 +1,161 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Checks the VobSub decoder of VobSubImage.cpp against the one from before it
+// decoded a word at a time into a palette index plane, and times both.
+//
+//   vobsubdecode
+//
+// The decoding part of both versions of VobSubImage.cpp is taken by the Makefile
+// and compiled into the namespaces Before and After. Per picture (text, noise and
+// empty ones of a few sizes, with and without "fill the line" codes):
+//   pixels   After::CVobSubImage::Decode() gives the colors of the picture
+//   same     After and Before give the same rectangle and pixels, untrimmed
+//            and trimmed, with the packet palette and with a custom one
+// The CPU time of a decode with trimming, as CVobSubFile does it, is printed for
+// both.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "stdafx.h"
+#include <atlstr.h>
+#include "VobSubPacket.h"
+
+namespace Before
+{
+#include "before.inc"
+}
+
+namespace After
+{
+#include "after.inc"
+}
+
+// CPU time of the process in seconds
+static double CpuTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+static bool SamePixels(const RGBQUAD* a, const RGBQUAD* b, int count)
+{
+  return count<=0 || memcmp(a, b, count*sizeof(RGBQUAD))==0;
+}
+
+template <class A, class B>
+static bool SameImage(A& a, B& b)
+{
+  return a.rect.left==b.rect.left && a.rect.top==b.rect.top && a.rect.right==b.rect.right && a.rect.bottom==b.rect.bottom
+         && SamePixels(a.lpPixels, b.lpPixels, a.rect.Width()*a.rect.Height());
+}
+
+static bool CheckPicture(const char* name, int w, int h, int kind, int iterations)
+{
+  VobSubPicture pic;
+  MakePicture(pic, w, h, kind);
+  RGBQUAD orgpal[16], cuspal[4];
+  MakePalette(orgpal, cuspal);
+
+  bool pixelsOk=true, sameOk=true;
+  double timeBefore=0, timeAfter=0;
+  int bytes=0;
+  for (int fillEnd=0; fillEnd<2; fillEnd++)
+  {
+    VobSubPacket packet;
+    EncodePicture(pic, fillEnd!=0, packet);
+    FinishPacket(packet, (720-w)/2, 560-h, w, h);
+    bytes=(int)packet.data.size();
+    BYTE* data=&packet.data[0];
+    int packetsize=(int)packet.data.size();
+
+    Before::CVobSubImage before;
+    After::CVobSubImage after;
+
+    after.Decode(data, packetsize, packet.datasize, false, 0, orgpal, cuspal, false);
+    if (after.rect.Width()!=w || after.rect.Height()!=h) pixelsOk=false;
+    for (int i=0; pixelsOk && i<w*h; i++)
+    {
+      RGBQUAD c=orgpal[pic.idx[i]];
+      c.rgbReserved=pic.idx[i]==0 ? 0 : 0xff;
+      if (memcmp(&after.lpPixels[i], &c, sizeof(c))!=0) pixelsOk=false;
+    }
+
+    for (int custom=0; custom<2; custom++)
+    {
+      for (int trim=0; trim<2; trim++)
+      {
+        before.Decode(data, packetsize, packet.datasize, custom!=0, 0, orgpal, cuspal, trim!=0);
+        after.Decode(data, packetsize, packet.datasize, custom!=0, 0, orgpal, cuspal, trim!=0);
+        if (!SameImage(before, after)) sameOk=false;
+      }
+    }
+
+    // the trimmed sizes are summed so the decodes can't be left out
+    int size=0;
+    double t0=CpuTime();
+    for (int i=0; i<iterations; i++)
+    {
+      before.Decode(data, packetsize, packet.datasize, false, 0, orgpal, cuspal, true);
+      size+=before.rect.Width()*before.rect.Height();
+    }
+    double t1=CpuTime();
+    for (int i=0; i<iterations; i++)
+    {
+      after.Decode(data, packetsize, packet.datasize, false, 0, orgpal, cuspal, true);
+      size-=after.rect.Width()*after.rect.Height();
+    }
+    double t2=CpuTime();
+    if (size!=0) sameOk=false;
+    timeBefore+=t1-t0;
+    timeAfter+=t2-t1;
+  }
+
+  printf("%-6s %4dx%-4d %7d bytes  decode before %8.1f us, after %7.1f us  %s\n",
+         name, w, h, bytes, timeBefore*1e6/(2*iterations), timeAfter*1e6/(2*iterations),
+         pixelsOk && sameOk ? "ok" : "FAILED");
+  return pixelsOk && sameOk;
+}
+
+int main()
+{
+  struct { const char* name; int w, h, kind, iterations; } pictures[]=
+  {
+    {"text",  720, 120, 0,  500},
+    {"text",  720, 560, 0,  100},
+    {"text",  333,  61, 0, 1000},
+    {"noise", 720, 100, 1,  100},
+    {"noise",  17,   9, 1, 4000},
+    {"empty", 720, 560, 2,  100},
+    {"empty",   1,   1, 2, 4000},
+  };
+  int failed=0;
+  for (size_t i=0; i<sizeof(pictures)/sizeof(pictures[0]); i++)
+  {
+    if (!CheckPicture(pictures[i].name, pictures[i].w, pictures[i].h, pictures[i].kind, pictures[i].iterations)) failed++;
+  }
+  if (failed>0)
+  {
+    printf("%d picture(s) FAILED\n", failed);
+    return 1;
+  }
+  return 0;
+}
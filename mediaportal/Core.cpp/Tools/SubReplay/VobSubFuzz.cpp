@@ -0,0 +1,124 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Decodes cut and corrupt VobSub packets. Built with AddressSanitizer, which
+// aborts on the first read past a packet or write outside the image.
+//
+//   vobsubfuzz [iterations]
+//
+// Each packet is cut to exactly its size in its own allocation. The run length
+// data of a valid picture is cut short, filled with random bytes or zeros, or
+// given field offsets before, inside or past it, and the rectangle may be larger
+// than the coded picture. The control block stays valid, GetPacketInfo() is not
+// what is tested here. A decoded image may have fewer lines than its rectangle
+// said, never more. The control block follows the run length data in the same
+// allocation, so reading into it is not caught by AddressSanitizer; the packet
+// is decoded again with another delay in its first word and has to give the
+// same image. The same seed is used on every run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "stdafx.h"
+#include <atlstr.h>
+#include "VobSubPacket.h"
+#include "after.inc"
+
+struct Decoded
+{
+  CRect rect;
+  std::vector<RGBQUAD> pixels;
+};
+
+static void Decode(CVobSubImage& img, const VobSubPacket& packet, RGBQUAD* orgpal, RGBQUAD* cuspal, bool custom, bool trim, Decoded& out)
+{
+  BYTE* data=new BYTE[packet.data.size()];
+  memcpy(data, &packet.data[0], packet.data.size());
+  img.Decode(data, (int)packet.data.size(), packet.datasize, custom, 0, orgpal, cuspal, trim);
+  delete [] data;
+  out.rect=img.rect;
+  out.pixels.assign(img.lpPixels, img.lpPixels+std::max(img.rect.Width()*img.rect.Height(), 0));
+}
+
+static void Spoil(VobSubPacket& packet)
+{
+  std::vector<BYTE>& d=packet.data;
+  switch (Random(6))
+  {
+    case 0:     // cut short, the second field or both
+      d.resize(4+Random((int)d.size()-4+1));
+      break;
+    case 1:     // random bytes
+      for (int n=1+Random(20), i=0; i<n && d.size()>4; i++) d[4+Random((int)d.size()-4)]=(BYTE)Random(256);
+      break;
+    case 2:     // all zero, lines that are only "fill the line" codes
+      std::fill(d.begin()+4, d.end(), 0);
+      break;
+    case 3:     // runs that never reach the end of a line
+      for (size_t i=4; i<d.size(); i++) d[i]=0x04;
+      break;
+    case 4:     // offsets anywhere
+      packet.offset[0]=Random((int)d.size()+16);
+      packet.offset[1]=Random((int)d.size()+16);
+      break;
+    default:    // the fields swapped
+      std::swap(packet.offset[0], packet.offset[1]);
+      break;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int iterations=argc > 1 ? atoi(argv[1]) : 20000;
+  RGBQUAD orgpal[16], cuspal[4];
+  MakePalette(orgpal, cuspal);
+  CVobSubImage img;
+  VobSubPicture pic;
+  VobSubPacket packet;
+  Decoded a, b;
+  int lines=0, failed=0;
+
+  for (int i=0; i<iterations; i++)
+  {
+    int w=1+Random(Random(8)==0 ? 720 : 64), h=1+Random(64);
+    MakePicture(pic, w, h, Random(3));
+    EncodePicture(pic, Random(2)==0, packet);
+    Spoil(packet);
+    if (Random(4)==0)
+    {
+      w+=Random(100);
+      h+=Random(100);
+    }
+    int left=Random(200), top=Random(200);
+    bool custom=(i & 2)!=0, trim=(i & 1)!=0;
+    VobSubPacket other=packet;
+    FinishPacket(packet, left, top, w, h);
+    FinishPacket(other, left, top, w, h, 0xffff);
+    Decode(img, packet, orgpal, cuspal, custom, trim, a);
+    Decode(img, other, orgpal, cuspal, custom, trim, b);
+
+    // trimming may add a border of one pixel
+    if (a.rect.Width()>w+2*trim || a.rect.Height()>h+2*trim) failed++;
+    if (memcmp(&a.rect, &b.rect, sizeof(RECT))!=0 || a.pixels.size()!=b.pixels.size()
+        || (!a.pixels.empty() && memcmp(&a.pixels[0], &b.pixels[0], a.pixels.size()*sizeof(RGBQUAD))!=0)) failed++;
+    lines+=a.rect.Height();
+  }
+
+  printf("%d corrupt packets, %d lines decoded, %d failed  %s\n", iterations, lines, failed, failed==0 ? "ok" : "FAILED");
+  return failed==0 ? 0 : 1;
+}
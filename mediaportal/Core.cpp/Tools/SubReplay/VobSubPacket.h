@@ -0,0 +1,183 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Builds VobSub subpicture packets for vobsubdecode and vobsubfuzz: a picture of
+// color ids 0-3 is run length coded the way DVD authoring tools do it, even lines
+// first, and followed by a control block that sets the palette, the contrast,
+// the rectangle and the offsets of the two fields.
+#pragma once
+
+#include <vector>
+#include "stdafx.h"
+
+static unsigned int s_seed=20101217;
+
+static int Random(int n)
+{
+  s_seed=s_seed*1103515245+12345;
+  return (int)((s_seed>>8)%(unsigned int)n);
+}
+
+struct VobSubPicture
+{
+  int w, h;
+  std::vector<BYTE> idx;
+};
+
+// kind 0 text: lines of glyphs on a transparent background, 1 color 1 filled and
+// 2 outlined, with 3 for the antialiasing; 1 noise: runs of 1 to 3 pixels;
+// 2 empty
+static void MakePicture(VobSubPicture& pic, int w, int h, int kind)
+{
+  pic.w=w;
+  pic.h=h;
+  pic.idx.assign(w*h, 0);
+  for (int y=0; y<h; y++)
+  {
+    BYTE* line=&pic.idx[w*y];
+    if (kind==1)
+    {
+      for (int x=0; x<w; )
+      {
+        int length=std::min(1+Random(3), w-x);
+        memset(&line[x], Random(4), length);
+        x+=length;
+      }
+    }
+    else if (kind==0 && y%60>=12 && y%60<48)
+    {
+      for (int x=8+Random(40); x+12<w; x+=4+Random(30))
+      {
+        int length=2+Random(8);
+        line[x]=3;
+        line[x+1]=2;
+        memset(&line[x+2], 1, length);
+        line[x+2+length]=2;
+        x+=3+length;
+      }
+    }
+  }
+}
+
+class CNibbleWriter
+{
+  std::vector<BYTE>& m_out;
+  bool m_half;
+
+public:
+  CNibbleWriter(std::vector<BYTE>& out) : m_out(out), m_half(false) {}
+
+  void Put(DWORD code, int nibbles)
+  {
+    for (int i=nibbles-1; i>=0; i--)
+    {
+      BYTE n=(BYTE)((code>>(i*4))&15);
+      if (m_half) m_out.back()|=n;
+      else m_out.push_back((BYTE)(n<<4));
+      m_half=!m_half;
+    }
+  }
+
+  void Align() { m_half=false; }
+};
+
+// a run reaching the end of the line is coded as "fill the line" if fillEnd
+static void EncodeLine(const BYTE* line, int w, bool fillEnd, std::vector<BYTE>& out)
+{
+  CNibbleWriter nw(out);
+  for (int x=0; x<w; )
+  {
+    int color=line[x], length=1;
+    while (x+length<w && line[x+length]==color) length++;
+    if (fillEnd && x+length==w)
+    {
+      nw.Put(color, 4);
+      break;
+    }
+    x+=length;
+    for (; length>0; length-=std::min(length, 255))
+    {
+      DWORD n=std::min(length, 255);
+      DWORD code=(n<<2)|color;
+      nw.Put(code, n>=64 ? 4 : n>=16 ? 3 : n>=4 ? 2 : 1);
+    }
+  }
+  nw.Align();
+}
+
+struct VobSubPacket
+{
+  std::vector<BYTE> data;
+  int datasize;
+  int offset[2];
+};
+
+// rle is left with the two fields, the control block is added by FinishPacket so
+// the fields can be cut or spoiled in between
+static void EncodePicture(const VobSubPicture& pic, bool fillEnd, VobSubPacket& packet)
+{
+  packet.data.assign(4, 0);
+  for (int field=0; field<2; field++)
+  {
+    packet.offset[field]=(int)packet.data.size();
+    for (int y=field; y<pic.h; y+=2)
+    {
+      EncodeLine(&pic.idx[pic.w*y], pic.w, fillEnd, packet.data);
+    }
+  }
+}
+
+// delay is the first word after the run length data, the start of the control block
+static void FinishPacket(VobSubPacket& packet, int left, int top, int w, int h, int delay=0)
+{
+  std::vector<BYTE>& d=packet.data;
+  int right=left+w-1, bottom=top+h-1;
+  packet.datasize=(int)d.size();
+  const BYTE control[]=
+  {
+    (BYTE)(delay>>8), (BYTE)delay, (BYTE)(packet.datasize>>8), (BYTE)packet.datasize,
+    0x01,
+    0x03, 0x32, 0x10,
+    0x04, 0xff, 0xf0,
+    0x05, (BYTE)(left>>4), (BYTE)((left<<4)|(right>>8)), (BYTE)right,
+          (BYTE)(top>>4), (BYTE)((top<<4)|(bottom>>8)), (BYTE)bottom,
+    0x06, (BYTE)(packet.offset[0]>>8), (BYTE)packet.offset[0], (BYTE)(packet.offset[1]>>8), (BYTE)packet.offset[1],
+    0xff
+  };
+  d.insert(d.end(), control, control+sizeof(control));
+  // the sizes and offsets are 16 bits, DVD players take no more than 53220 bytes
+  assert(d.size()<0x10000);
+  d[0]=(BYTE)(d.size()>>8);
+  d[1]=(BYTE)d.size();
+  d[2]=(BYTE)(packet.datasize>>8);
+  d[3]=(BYTE)packet.datasize;
+}
+
+static void MakePalette(RGBQUAD* orgpal, RGBQUAD* cuspal)
+{
+  for (int i=0; i<16; i++)
+  {
+    orgpal[i].rgbRed=(BYTE)(i*16);
+    orgpal[i].rgbGreen=(BYTE)(255-i*16);
+    orgpal[i].rgbBlue=(BYTE)(i*40);
+    orgpal[i].rgbReserved=0;
+  }
+  for (int i=0; i<4; i++)
+  {
+    cuspal[i]=orgpal[15-i];
+    cuspal[i].rgbReserved=i==0 ? 0 : 255;
+  }
+}
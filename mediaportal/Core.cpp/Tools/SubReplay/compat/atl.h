@@ -0,0 +1,148 @@
+// CAtlArray, CAtlList and CAtlMap with the members the subtitle decoders and
+// the STS segment code use. A POSITION is a list node, or one past the index of
+// a map entry.
+#pragma once
+
+#include <vector>
+#include <utility>
+
+typedef struct __POSITION {}* POSITION;
+
+template <typename E>
+class CAtlArray
+{
+public:
+  size_t   GetCount() const           { return m_elements.size(); }
+  bool     IsEmpty() const            { return m_elements.empty(); }
+  E*       GetData()                  { return m_elements.empty() ? NULL : &m_elements[0]; }
+  E&       GetAt(size_t i)            { return m_elements[i]; }
+  E&       operator[](size_t i)       { return m_elements[i]; }
+  const E& operator[](size_t i) const { return m_elements[i]; }
+
+  size_t Add()                  { m_elements.push_back(E()); return m_elements.size()-1; }
+  size_t Add(const E& element)  { m_elements.push_back(element); return m_elements.size()-1; }
+  void   InsertAt(size_t i, const E& element) { m_elements.insert(m_elements.begin()+i, element); }
+  void   SetCount(size_t count) { m_elements.resize(count); }
+  void   Copy(const CAtlArray& other) { m_elements=other.m_elements; }
+  void   RemoveAll()            { m_elements.clear(); }
+
+private:
+  std::vector<E> m_elements;
+};
+
+template <typename E>
+class CAtlList
+{
+  struct CNode
+  {
+    CNode* pNext;
+    CNode* pPrev;
+    E      element;
+  };
+
+public:
+  CAtlList() { m_pHead=m_pTail=NULL; m_nCount=0; }
+  ~CAtlList() { RemoveAll(); }
+
+  size_t   GetCount() const        { return m_nCount; }
+  bool     IsEmpty() const         { return m_nCount==0; }
+  POSITION GetHeadPosition() const { return (POSITION)m_pHead; }
+  POSITION GetTailPosition() const { return (POSITION)m_pTail; }
+  E&       GetHead()               { return m_pHead->element; }
+  E&       GetTail()               { return m_pTail->element; }
+  E&       GetAt(POSITION pos)     { return ((CNode*)pos)->element; }
+
+  E& GetNext(POSITION& pos)
+  {
+    CNode* node=(CNode*)pos;
+    pos=(POSITION)node->pNext;
+    return node->element;
+  }
+
+  E& GetPrev(POSITION& pos)
+  {
+    CNode* node=(CNode*)pos;
+    pos=(POSITION)node->pPrev;
+    return node->element;
+  }
+
+  POSITION AddTail(const E& element)
+  {
+    CNode* node=new CNode;
+    node->element=element;
+    node->pNext=NULL;
+    node->pPrev=m_pTail;
+    if (m_pTail) m_pTail->pNext=node; else m_pHead=node;
+    m_pTail=node;
+    m_nCount++;
+    return (POSITION)node;
+  }
+
+  E RemoveHead()
+  {
+    CNode* node=m_pHead;
+    E element=node->element;
+    m_pHead=node->pNext;
+    if (m_pHead) m_pHead->pPrev=NULL; else m_pTail=NULL;
+    delete node;
+    m_nCount--;
+    return element;
+  }
+
+  void RemoveAll()
+  {
+    while (m_pHead) RemoveHead();
+  }
+
+private:
+  CNode* m_pHead;
+  CNode* m_pTail;
+  size_t m_nCount;
+};
+
+template <typename K, typename V>
+class CAtlMap
+{
+public:
+  size_t GetCount() const { return m_entries.size(); }
+
+  bool Lookup(const K& key, V& value) const
+  {
+    for (size_t i=0; i<m_entries.size(); i++)
+    {
+      if (m_entries[i].first==key)
+      {
+        value=m_entries[i].second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  V& operator[](const K& key)
+  {
+    for (size_t i=0; i<m_entries.size(); i++)
+    {
+      if (m_entries[i].first==key) return m_entries[i].second;
+    }
+    m_entries.push_back(std::make_pair(key, V()));
+    return m_entries.back().second;
+  }
+
+  POSITION GetStartPosition() const
+  {
+    return m_entries.empty() ? NULL : (POSITION)(uintptr_t)1;
+  }
+
+  V& GetNextValue(POSITION& pos)
+  {
+    size_t i=(size_t)(uintptr_t)pos-1;
+    pos=i+1<m_entries.size() ? (POSITION)(uintptr_t)(i+2) : NULL;
+    return m_entries[i].second;
+  }
+
+  void RemoveAll() { m_entries.clear(); }
+
+private:
+  std::vector<std::pair<K, V> > m_entries;
+};
@@ -0,0 +1,131 @@
+// Just enough of CStringW and CRect for the STS segment code and the ssa tag
+// tokenizer of RTS.cpp, and of CPoint, CSize and CRect for the VobSub decoder.
+// Unicode build, so CString is CStringW. Like ATL, [] at the length gives the
+// terminating 0 and Mid/Left clamp to the string.
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <wchar.h>
+#include <windows.h>
+
+#define _T(x) L##x
+
+class CStringW
+{
+public:
+  CStringW() {}
+  CStringW(const wchar_t* s) : m_s(s) {}
+
+  operator const wchar_t*() const  { return m_s.c_str(); }
+  wchar_t operator[](int i) const  { return m_s.c_str()[i]; }
+  bool operator==(const CStringW& other) const { return m_s==other.m_s; }
+  bool operator!=(const CStringW& other) const { return m_s!=other.m_s; }
+  bool operator==(const wchar_t* other) const  { return m_s==other; }
+  CStringW& operator+=(wchar_t c)  { m_s+=c; return *this; }
+
+  bool IsEmpty() const   { return m_s.empty(); }
+  int  GetLength() const { return (int)m_s.size(); }
+  void Empty()           { m_s.clear(); }
+
+  int Find(wchar_t c, int start = 0) const
+  {
+    size_t i=m_s.find(c, start);
+    return i==std::wstring::npos ? -1 : (int)i;
+  }
+
+  int Find(const wchar_t* s, int start = 0) const
+  {
+    size_t i=m_s.find(s, start);
+    return i==std::wstring::npos ? -1 : (int)i;
+  }
+
+  CStringW Mid(int first, int count = INT32_MAX) const
+  {
+    first=std::min(std::max(first, 0), GetLength());
+    return CStringW(m_s.substr(first, std::max(count, 0)));
+  }
+
+  CStringW Left(int count) const { return Mid(0, count); }
+
+  CStringW& Trim(const wchar_t* chars = L" \t\r\n")
+  {
+    size_t first=m_s.find_first_not_of(chars);
+    if (first==std::wstring::npos)
+    {
+      m_s.clear();
+      return *this;
+    }
+    m_s=m_s.substr(first, m_s.find_last_not_of(chars)-first+1);
+    return *this;
+  }
+
+  CStringW& TrimLeft(wchar_t c)
+  {
+    m_s.erase(0, m_s.find_first_not_of(c)==std::wstring::npos ? m_s.size() : m_s.find_first_not_of(c));
+    return *this;
+  }
+
+  int Remove(wchar_t c)
+  {
+    size_t before=m_s.size();
+    m_s.erase(std::remove(m_s.begin(), m_s.end(), c), m_s.end());
+    return (int)(before-m_s.size());
+  }
+
+  int Replace(const wchar_t* from, const wchar_t* to)
+  {
+    int count=0;
+    size_t fromLength=wcslen(from), toLength=wcslen(to);
+    for (size_t i=m_s.find(from); fromLength>0 && i!=std::wstring::npos; i=m_s.find(from, i+toLength), count++)
+    {
+      m_s.replace(i, fromLength, to);
+    }
+    return count;
+  }
+
+private:
+  CStringW(const std::wstring& s) : m_s(s) {}
+
+  std::wstring m_s;
+};
+
+typedef CStringW CString;
+
+class CPoint : public POINT
+{
+public:
+  CPoint() { x=y=0; }
+  CPoint(LONG px, LONG py) { x=px; y=py; }
+};
+
+class CSize : public SIZE
+{
+public:
+  CSize() { cx=cy=0; }
+  CSize(LONG w, LONG h) { cx=w; cy=h; }
+};
+
+class CRect : public RECT
+{
+public:
+  CRect() { left=top=right=bottom=0; }
+  CRect(LONG l, LONG t, LONG r, LONG b) { left=l; top=t; right=r; bottom=b; }
+  CRect(POINT p, SIZE s) { left=p.x; top=p.y; right=p.x+s.cx; bottom=p.y+s.cy; }
+
+  LONG   Width() const   { return right-left; }
+  LONG   Height() const  { return bottom-top; }
+  CPoint TopLeft() const { return CPoint(left, top); }
+  CSize  Size() const    { return CSize(Width(), Height()); }
+
+  // like MFC, adding a rectangle inflates by its sides and & leaves an empty
+  // intersection all zero
+  void operator+=(const RECT& r) { left-=r.left; top-=r.top; right+=r.right; bottom+=r.bottom; }
+  void operator&=(const RECT& r)
+  {
+    left=std::max(left, r.left); top=std::max(top, r.top);
+    right=std::min(right, r.right); bottom=std::min(bottom, r.bottom);
+    if (left>=right || top>=bottom) left=top=right=bottom=0;
+  }
+  CRect operator+(POINT p) const { return CRect(left+p.x, top+p.y, right+p.x, bottom+p.y); }
+};
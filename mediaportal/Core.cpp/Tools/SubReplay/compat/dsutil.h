@@ -0,0 +1,53 @@
+// The DSUtil helpers the subtitle decoders use. The color conversions are copies
+// of the ones in DSUtil.cpp, so rendered bitmaps hash as they do on Windows.
+#pragma once
+
+#include <windows.h>
+#include <emmintrin.h>
+
+#define DNew new
+
+// the replay drivers can force the scalar code paths with NO_SSE2=1
+class CCpuID
+{
+public:
+  CCpuID() { m_flags=getenv("NO_SSE2")==NULL ? (flag_t)(mmx | ssemmx | ssefpu | sse2) : (flag_t)0; }
+  enum flag_t {mmx=1, ssemmx=2, ssefpu=4, sse2=8, _3dnow=16} m_flags;
+};
+
+static CCpuID g_cpuid;
+
+inline void memsetd(void* dst, unsigned int c, size_t nbytes)
+{
+  for (size_t i=0; i<nbytes/4; i++)
+    ((DWORD*)dst)[i]=c;
+}
+
+const double Rec601_Kr = 0.299;
+const double Rec601_Kb = 0.114;
+const double Rec601_Kg = 0.587;
+
+inline DWORD YCrCbToRGB_Rec601(BYTE A, BYTE Y, BYTE Cr, BYTE Cb)
+{
+  double rp = Y + 2*(Cr-128)*(1.0-Rec601_Kr);
+  double gp = Y - 2*(Cb-128)*(1.0-Rec601_Kb)*Rec601_Kb/Rec601_Kg - 2*(Cr-128)*(1.0-Rec601_Kr)*Rec601_Kr/Rec601_Kg;
+  double bp = Y + 2*(Cb-128)*(1.0-Rec601_Kb);
+
+  return D3DCOLOR_ARGB(A, (BYTE)fabs(rp), (BYTE)fabs(gp), (BYTE)fabs(bp));
+}
+
+const double Rec709_Kr = 0.2125;
+const double Rec709_Kb = 0.0721;
+const double Rec709_Kg = 0.7154;
+
+inline DWORD YCrCbToRGB_Rec709(BYTE A, BYTE Y, BYTE Cr, BYTE Cb)
+{
+  double rp = Y + 2*(Cr-128)*(1.0-Rec709_Kr);
+  double gp = Y - 2*(Cb-128)*(1.0-Rec709_Kb)*Rec709_Kb/Rec709_Kg - 2*(Cr-128)*(1.0-Rec709_Kr)*Rec709_Kr/Rec709_Kg;
+  double bp = Y + 2*(Cb-128)*(1.0-Rec709_Kb);
+
+  return D3DCOLOR_ARGB(A, (BYTE)fabs(rp), (BYTE)fabs(gp), (BYTE)fabs(bp));
+}
+
+// only used in traces
+inline const wchar_t* ReftimeToString(REFERENCE_TIME) { return L""; }
@@ -0,0 +1,55 @@
+// Only FillSolidRect of the Rasterizer, with the pixmix and pixmix_sse2 of
+// Rasterizer.cpp; the PGS and DVB objects derive from it to draw their runs.
+#pragma once
+
+#include "stdafx.h"
+
+class Rasterizer
+{
+  static void pixmix(DWORD *dst, DWORD color, DWORD alpha)
+  {
+    DWORD a = (((alpha)*(color>>24))>>6)&0xff;
+    DWORD ia = 256-a;
+    a+=1;
+
+    *dst = ((((*dst&0x00ff00ff)*ia + (color&0x00ff00ff)*a)&0xff00ff00)>>8)
+           | ((((*dst&0x0000ff00)*ia + (color&0x0000ff00)*a)&0x00ff0000)>>8)
+           | ((((*dst>>8)&0x00ff0000)*ia)&0xff000000);
+  }
+
+  static void pixmix_sse2(DWORD* dst, DWORD color, DWORD alpha)
+  {
+    alpha = (((alpha) * (color>>24)) >> 6) & 0xff;
+    color &= 0xffffff;
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_set1_epi32(((alpha+1) << 16) | (0x100 - alpha));
+    __m128i d = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*dst), zero);
+    __m128i s = _mm_unpacklo_epi8(_mm_cvtsi32_si128(color), zero);
+    __m128i r = _mm_unpacklo_epi16(d, s);
+
+    r = _mm_madd_epi16(r, a);
+    r = _mm_srli_epi32(r, 8);
+    r = _mm_packs_epi32(r, r);
+    r = _mm_packus_epi16(r, r);
+
+    *dst = (DWORD)_mm_cvtsi128_si32(r);
+  }
+
+public:
+  void FillSolidRect(SubPicDesc& spd, int x, int y, int nWidth, int nHeight, DWORD lColor)
+  {
+    bool fSSE2 = !!(g_cpuid.m_flags & CCpuID::sse2);
+
+    for (int wy=y; wy<y+nHeight; wy++) {
+      DWORD* dst = (DWORD*)((BYTE*)spd.bits + spd.pitch * wy) + x;
+      for (int wt=0; wt<nWidth; ++wt) {
+        if (fSSE2) {
+          pixmix_sse2(&dst[wt], lColor, 0x40);
+        } else {
+          pixmix(&dst[wt], lColor, 0x40);
+        }
+      }
+    }
+  }
+};
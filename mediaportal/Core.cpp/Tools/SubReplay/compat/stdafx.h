@@ -0,0 +1,24 @@
+// Stands in for the precompiled header of the subtitle library.
+#pragma once
+
+#include <windows.h>
+#include "atl.h"
+#include "dsutil.h"
+
+#pragma pack(push, 1)
+struct SubPicDesc {
+  int type;
+  int w, h, bpp, pitch, pitchUV;
+  void* bits;
+  BYTE* bitsU;
+  BYTE* bitsV;
+  RECT vidrect; // video rectangle
+
+  SubPicDesc() {
+    type = 0;
+    w = h = bpp = pitch = pitchUV = 0;
+    bits = NULL;
+    bitsU = bitsV = NULL;
+  }
+};
+#pragma pack(pop)
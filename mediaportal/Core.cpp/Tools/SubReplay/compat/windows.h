@@ -0,0 +1,84 @@
+// Just enough of windows.h and the DirectShow base classes for the subtitle
+// decoders, so the replay drivers build with g++ on Linux.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <type_traits>
+
+typedef unsigned char  BYTE;
+typedef int            BOOL;
+typedef short          SHORT;
+typedef unsigned short USHORT;
+typedef unsigned short WORD;
+typedef wchar_t        WCHAR;
+typedef uint32_t       DWORD;
+typedef int32_t        LONG;
+typedef int            INT;
+typedef unsigned int   UINT;
+typedef int64_t        INT64;
+typedef uint64_t       UINT64;
+typedef int64_t        LONGLONG;
+typedef long           HRESULT;
+typedef DWORD          COLORREF;
+typedef LONGLONG       REFERENCE_TIME;
+
+// a define rather than a typedef, the sources also write "unsigned __int64"
+#define __int64 long
+
+#define TRUE  1
+#define FALSE 0
+
+#define S_OK          ((HRESULT)0)
+#define S_FALSE       ((HRESULT)1)
+#define E_POINTER     ((HRESULT)0x80004003L)
+#define E_INVALIDARG  ((HRESULT)0x80070057L)
+#define E_FAIL        ((HRESULT)0x80004005L)
+#define VFW_E_SAMPLE_REJECTED ((HRESULT)0x8004022BL)
+#define FAILED(hr)    ((HRESULT)(hr) < 0)
+#define SUCCEEDED(hr) ((HRESULT)(hr) >= 0)
+
+#define _I64_MIN INT64_MIN
+#define _I64_MAX INT64_MAX
+
+#define __forceinline inline
+
+#define ASSERT(x)         assert(x)
+#define TRACE(...)        ((void)0)
+#define UNUSED_ALWAYS(x)  ((void)(x))
+#define CheckPointer(p, ret) { if ((p) == NULL) return (ret); }
+
+#define D3DCOLOR_ARGB(a, r, g, b) \
+  ((DWORD)((((a) & 0xff) << 24) | (((r) & 0xff) << 16) | (((g) & 0xff) << 8) | ((b) & 0xff)))
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+
+typedef struct { LONG left; LONG top; LONG right; LONG bottom; } RECT;
+typedef struct { LONG cx; LONG cy; } SIZE;
+typedef struct { LONG x; LONG y; } POINT;
+typedef struct { BYTE rgbBlue; BYTE rgbGreen; BYTE rgbRed; BYTE rgbReserved; } RGBQUAD;
+
+// the windows.h macros take mixed types, like min(SHORT, int)
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+inline unsigned __int64 _byteswap_uint64(unsigned __int64 v) { return __builtin_bswap64(v); }
+
+inline LONG InterlockedIncrement(volatile LONG* p) { return __sync_add_and_fetch(p, 1); }
+inline LONG InterlockedDecrement(volatile LONG* p) { return __sync_sub_and_fetch(p, 1); }
+
+// only what the decoders call on the samples they parse
+class IMediaSample
+{
+public:
+  virtual ~IMediaSample() {}
+  virtual HRESULT GetPointer(BYTE** ppBuffer) = 0;
+  virtual long    GetActualDataLength() = 0;
+  virtual HRESULT GetTime(REFERENCE_TIME* pTimeStart, REFERENCE_TIME* pTimeEnd) = 0;
+};
@@ -0,0 +1,30 @@
+# Takes from RTS.cpp, after flatten.sed, what splits the ssa override tags into
+# commands and parameters: TokenizeSSATag() where there is one, the head of
+# ParseSSATag() and its \t branch, which goes into the style modifiers. The
+# commands themselves are not applied, ParseSSATag() hands each one to
+# Record() instead. ssatags.cpp builds this once from RTS.cpp as it is and once
+# from before the tag cache.
+/^static void TokenizeSSATag\(/ { tokenize=1 }
+tokenize { print; if (/^}/) tokenize=0; next }
+
+/^bool CRenderedTextSubtitle::ParseSSATag\(/ { head=1 }
+head {
+  print
+  if (/CStringW p = /) {
+    head=0
+    print "\t\tRecord(cmd, params, fAnimate);"
+    print "\t\tif(false) {"
+  }
+  next
+}
+
+/^\t\t} else if\(cmd == L"t"\) \{/ { anim=1 }
+anim && /^\t\t} else if\(cmd == L"u"\) \{/ {
+  anim=0
+  print "\t\t}"
+  print "\t}"
+  print ""
+  print "\treturn(true);"
+  print "}"
+}
+anim { print }
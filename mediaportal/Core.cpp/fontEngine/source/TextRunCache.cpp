@@ -0,0 +1,192 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+#include <string.h>
+#include "TextRunCache.h"
+
+CTextRunCache::CTextRunCache(int maxFonts, int maxEntries)
+{
+  m_maxFonts=maxFonts;
+  m_fontGeneration=new unsigned int[maxFonts];
+  for (int i=0; i < maxFonts;++i)
+  {
+    m_fontGeneration[i]=0;
+  }
+
+  m_maxEntries=maxEntries;
+  m_entries=new ENTRY[maxEntries];
+  for (int i=0; i < maxEntries;++i)
+  {
+    m_entries[i].text=NULL;
+    m_entries[i].textCapacity=0;
+    m_entries[i].vertices=NULL;
+    m_entries[i].vertexCapacity=0;
+  }
+
+  int numBuckets=1;
+  while (numBuckets < maxEntries*2)
+  {
+    numBuckets<<=1;
+  }
+  m_bucketMask=numBuckets-1;
+  m_buckets=new int[numBuckets];
+  Clear();
+}
+
+CTextRunCache::~CTextRunCache()
+{
+  for (int i=0; i < m_maxEntries;++i)
+  {
+    delete[] m_entries[i].text;
+    delete[] m_entries[i].vertices;
+  }
+  delete[] m_entries;
+  delete[] m_buckets;
+  delete[] m_fontGeneration;
+}
+
+void CTextRunCache::Clear()
+{
+  for (int i=0; i <= m_bucketMask;++i)
+  {
+    m_buckets[i]=-1;
+  }
+  m_numEntries=0;
+  m_hand=0;
+}
+
+void CTextRunCache::InvalidateFont(int font)
+{
+  // the stale runs are not searched for, they miss from now on and get replaced or evicted
+  if (font >= 0 && font < m_maxFonts)
+  {
+    m_fontGeneration[font]++;
+  }
+}
+
+unsigned int CTextRunCache::Hash(const TEXT_RUN_KEY& key, const wchar_t* text, int length) const
+{
+  // FNV-1a
+  unsigned int hash=2166136261U;
+  const unsigned char* p=(const unsigned char*)&key;
+  for (int i=0; i < (int)sizeof(key);++i)
+  {
+    hash=(hash ^ p[i]) * 16777619U;
+  }
+  for (int i=0; i < length;++i)
+  {
+    hash=(hash ^ (unsigned int)text[i]) * 16777619U;
+  }
+  return hash;
+}
+
+int CTextRunCache::Lookup(unsigned int hash, const TEXT_RUN_KEY& key, const wchar_t* text, int length) const
+{
+  for (int i=m_buckets[hash & m_bucketMask]; i >= 0; i=m_entries[i].next)
+  {
+    const ENTRY& entry=m_entries[i];
+    if (entry.hash==hash && entry.length==length &&
+        memcmp(&entry.key,&key,sizeof(key))==0 &&
+        memcmp(entry.text,text,length*sizeof(wchar_t))==0)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const BATCH_VERTEX* CTextRunCache::Find(const TEXT_RUN_KEY& key, const wchar_t* text, int length, int* pNumVertices)
+{
+  if (key.font < 0 || key.font >= m_maxFonts)
+  {
+    return NULL;
+  }
+  int i=Lookup(Hash(key,text,length),key,text,length);
+  if (i < 0 || m_entries[i].generation!=m_fontGeneration[key.font])
+  {
+    return NULL;
+  }
+  m_entries[i].referenced=true;
+  *pNumVertices=m_entries[i].numVertices;
+  return m_entries[i].vertices;
+}
+
+void CTextRunCache::Unlink(int entry)
+{
+  int* link=&m_buckets[m_entries[entry].hash & m_bucketMask];
+  while (*link != entry)
+  {
+    link=&m_entries[*link].next;
+  }
+  *link=m_entries[entry].next;
+}
+
+int CTextRunCache::Evict()
+{
+  // clock: skip the entries hit since the last pass
+  while (m_entries[m_hand].referenced)
+  {
+    m_entries[m_hand].referenced=false;
+    m_hand=(m_hand+1) % m_maxEntries;
+  }
+  int entry=m_hand;
+  m_hand=(m_hand+1) % m_maxEntries;
+  Unlink(entry);
+  return entry;
+}
+
+void CTextRunCache::Store(const TEXT_RUN_KEY& key, const wchar_t* text, int length, const BATCH_VERTEX* vertices, int numVertices)
+{
+  if (key.font < 0 || key.font >= m_maxFonts)
+  {
+    return;
+  }
+  unsigned int hash=Hash(key,text,length);
+  int i=Lookup(hash,key,text,length);
+  if (i < 0)
+  {
+    i=(m_numEntries < m_maxEntries) ? m_numEntries++ : Evict();
+
+    ENTRY& entry=m_entries[i];
+    if (entry.textCapacity < length)
+    {
+      delete[] entry.text;
+      entry.textCapacity=length;
+      entry.text=new wchar_t[length];
+    }
+    memcpy(entry.text,text,length*sizeof(wchar_t));
+    entry.length=length;
+    entry.key=key;
+    entry.hash=hash;
+    entry.next=m_buckets[hash & m_bucketMask];
+    m_buckets[hash & m_bucketMask]=i;
+  }
+
+  ENTRY& entry=m_entries[i];
+  if (entry.vertexCapacity < numVertices)
+  {
+    delete[] entry.vertices;
+    entry.vertexCapacity=numVertices;
+    entry.vertices=new BATCH_VERTEX[numVertices];
+  }
+  if (numVertices > 0)
+  {
+    memcpy(entry.vertices,vertices,numVertices*sizeof(BATCH_VERTEX));
+  }
+  entry.numVertices=numVertices;
+  entry.generation=m_fontGeneration[key.font];
+  entry.referenced=false;
+}
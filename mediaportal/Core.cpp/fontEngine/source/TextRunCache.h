@@ -0,0 +1,82 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// Cache of the finished vertices of FontEngineDrawText3D() calls. Most labels of a
+// screen are drawn with the same text, position, color and transform every frame,
+// so the layout, clipping and transform of their characters only has to be done
+// when one of them changes. Does not depend on Direct3D.
+
+#pragma once
+
+#include "TextureBatch.h"
+
+// Everything besides the text that the vertices of a call depend on. Fill it
+// completely, keys are compared and hashed as raw memory.
+struct TEXT_RUN_KEY
+{
+  int          font;
+  int          x, y;
+  unsigned int color;
+  int          maxWidth;
+  float        matrix[3][4];
+  int          viewport[4];   // x, y, width, height
+  int          clip[4];       // left, top, right, bottom, all 0 when clipping is disabled
+};
+
+class CTextRunCache
+{
+public:
+  CTextRunCache(int maxFonts, int maxEntries);
+  ~CTextRunCache();
+
+  // returns NULL on a miss
+  const BATCH_VERTEX* Find(const TEXT_RUN_KEY& key, const wchar_t* text, int length, int* pNumVertices);
+  void Store(const TEXT_RUN_KEY& key, const wchar_t* text, int length, const BATCH_VERTEX* vertices, int numVertices);
+
+  // drops the runs of a font whose texture or glyph coordinates changed
+  void InvalidateFont(int font);
+  void Clear();
+
+private:
+  struct ENTRY
+  {
+    TEXT_RUN_KEY  key;
+    unsigned int  hash;
+    unsigned int  generation;   // of the font when the entry was stored
+    wchar_t*      text;
+    int           length;
+    int           textCapacity;
+    BATCH_VERTEX* vertices;
+    int           numVertices;
+    int           vertexCapacity;
+    int           next;         // next entry in the same bucket
+    bool          referenced;   // hit since the clock hand passed
+  };
+
+  unsigned int Hash(const TEXT_RUN_KEY& key, const wchar_t* text, int length) const;
+  int          Lookup(unsigned int hash, const TEXT_RUN_KEY& key, const wchar_t* text, int length) const;
+  void         Unlink(int entry);
+  int          Evict();
+
+  int           m_maxFonts;
+  unsigned int* m_fontGeneration;
+  ENTRY*        m_entries;
+  int           m_maxEntries;
+  int           m_numEntries;
+  int*          m_buckets;
+  int           m_bucketMask;
+  int           m_hand;
+};
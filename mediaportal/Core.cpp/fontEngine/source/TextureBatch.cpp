@@ -0,0 +1,233 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+#include <string.h>
+#include <xmmintrin.h>
+#include "TextureBatch.h"
+
+//*******************************************************************************************************************
+static bool s_useSSE=false;
+
+void EnableTransformSSE(bool enable)
+{
+  s_useSSE=enable;
+}
+
+void TransformQuad(const float m[3][4], float x1, float y1, float x2, float y2,
+                   float* px, float* py, float* pz)
+{
+  if (!s_useSSE)
+  {
+    const float xs[4]={x1,x1,x2,x2};
+    const float ys[4]={y1,y2,y2,y1};
+    for (int i=0; i < 4; ++i)
+    {
+      px[i]=m[0][0]*xs[i] + m[0][1]*ys[i] + m[0][3];
+      py[i]=m[1][0]*xs[i] + m[1][1]*ys[i] + m[1][3];
+      pz[i]=m[2][0]*xs[i] + m[2][1]*ys[i] + m[2][3];
+    }
+    return;
+  }
+
+  // one lane per corner
+  __m128 xs=_mm_setr_ps(x1,x1,x2,x2);
+  __m128 ys=_mm_setr_ps(y1,y2,y2,y1);
+
+  __m128 r=_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][0]),xs), _mm_mul_ps(_mm_set1_ps(m[0][1]),ys)), _mm_set1_ps(m[0][3]));
+  _mm_storeu_ps(px,r);
+  r=_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1][0]),xs), _mm_mul_ps(_mm_set1_ps(m[1][1]),ys)), _mm_set1_ps(m[1][3]));
+  _mm_storeu_ps(py,r);
+  r=_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][0]),xs), _mm_mul_ps(_mm_set1_ps(m[2][1]),ys)), _mm_set1_ps(m[2][3]));
+  _mm_storeu_ps(pz,r);
+}
+
+//*******************************************************************************************************************
+CTextureSlotMap::CTextureSlotMap(int maxSlots)
+{
+  m_maxSlots=maxSlots;
+  int numBuckets=1;
+  while (numBuckets < maxSlots*2)
+  {
+    numBuckets<<=1;
+  }
+  m_bucketMask=numBuckets-1;
+  m_buckets=new int[numBuckets];
+  m_next=new int[maxSlots];
+  m_hashCodes=new int[maxSlots];
+  m_freeSlots=new int[maxSlots];
+  for (int i=0; i < numBuckets;++i)
+  {
+    m_buckets[i]=-1;
+  }
+  // hand out the low slots first
+  m_numFree=0;
+  for (int i=maxSlots-1; i >= 0;--i)
+  {
+    m_next[i]=-1;
+    m_hashCodes[i]=-1;
+    m_freeSlots[m_numFree++]=i;
+  }
+}
+
+CTextureSlotMap::~CTextureSlotMap()
+{
+  delete[] m_buckets;
+  delete[] m_next;
+  delete[] m_hashCodes;
+  delete[] m_freeSlots;
+}
+
+int CTextureSlotMap::Bucket(int hashCode) const
+{
+  // the hash codes come from .NET GetHashCode(), spread them before masking
+  unsigned int h=(unsigned int)hashCode * 2654435761U;
+  return (int)(h >> 16) & m_bucketMask;
+}
+
+int CTextureSlotMap::Find(int hashCode) const
+{
+  for (int slot=m_buckets[Bucket(hashCode)]; slot >= 0; slot=m_next[slot])
+  {
+    if (m_hashCodes[slot]==hashCode)
+    {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+int CTextureSlotMap::Add(int hashCode)
+{
+  int slot=Find(hashCode);
+  if (slot >= 0)
+  {
+    return slot;
+  }
+  if (m_numFree==0)
+  {
+    return -1;
+  }
+  slot=m_freeSlots[--m_numFree];
+  int bucket=Bucket(hashCode);
+  m_hashCodes[slot]=hashCode;
+  m_next[slot]=m_buckets[bucket];
+  m_buckets[bucket]=slot;
+  return slot;
+}
+
+void CTextureSlotMap::Remove(int slot)
+{
+  if (slot < 0 || slot >= m_maxSlots || m_hashCodes[slot]==-1)
+  {
+    return;
+  }
+  int* link=&m_buckets[Bucket(m_hashCodes[slot])];
+  while (*link != slot)
+  {
+    link=&m_next[*link];
+  }
+  *link=m_next[slot];
+  m_next[slot]=-1;
+  m_hashCodes[slot]=-1;
+  m_freeSlots[m_numFree++]=slot;
+}
+
+//*******************************************************************************************************************
+CTextureBatch::CTextureBatch(int maxVertices, int maxRunVertices)
+{
+  m_maxVertices=maxVertices;
+  m_maxRunVertices=maxRunVertices;
+  m_vertices=new BATCH_VERTEX[maxVertices];
+  // every run holds at least one quad
+  m_maxRuns=maxVertices/4;
+  m_runs=new BATCH_RUN[m_maxRuns];
+  Clear();
+}
+
+CTextureBatch::~CTextureBatch()
+{
+  delete[] m_vertices;
+  delete[] m_runs;
+}
+
+void CTextureBatch::Clear()
+{
+  m_numVertices=0;
+  m_numRuns=0;
+}
+
+bool CTextureBatch::Add(void* texture, bool alphaBlend, const BATCH_VERTEX* vertices, int numVertices)
+{
+  if (numVertices <= 0)
+  {
+    return true;
+  }
+  if (m_numVertices+numVertices > m_maxVertices)
+  {
+    return false;
+  }
+
+  BATCH_RUN* run=(m_numRuns > 0) ? &m_runs[m_numRuns-1] : NULL;
+  if (run==NULL || run->texture!=texture || run->alphaBlend!=alphaBlend ||
+      run->numVertices+numVertices > m_maxRunVertices)
+  {
+    if (m_numRuns==m_maxRuns)
+    {
+      return false;
+    }
+    run=&m_runs[m_numRuns++];
+    run->texture=texture;
+    run->alphaBlend=alphaBlend;
+    run->firstVertex=m_numVertices;
+    run->numVertices=0;
+  }
+
+  memcpy(&m_vertices[m_numVertices],vertices,numVertices*sizeof(BATCH_VERTEX));
+  m_numVertices+=numVertices;
+  run->numVertices+=numVertices;
+  return true;
+}
+
+//*******************************************************************************************************************
+CVertexRing::CVertexRing(int capacity)
+{
+  m_capacity=capacity;
+  Reset();
+}
+
+void CVertexRing::Reset()
+{
+  m_pos=0;
+  m_discard=true;
+}
+
+int CVertexRing::Reserve(int numVertices, bool* pDiscard)
+{
+  if (numVertices > m_capacity)
+  {
+    return -1;
+  }
+  *pDiscard=false;
+  if (m_discard || m_pos+numVertices > m_capacity)
+  {
+    m_pos=0;
+    m_discard=false;
+    *pDiscard=true;
+  }
+  int first=m_pos;
+  m_pos+=numVertices;
+  return first;
+}
@@ -0,0 +1,123 @@
+// Copyright (C) 2005-2010 Team MediaPortal
+// http://www.team-mediaportal.com
+//
+// MediaPortal is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// MediaPortal is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with MediaPortal. If not, see <http://www.gnu.org/licenses/>.
+
+// CPU side of FontEnginePresentTextures(). Nothing in here calls Direct3D, the
+// renderer copies a finished batch into its vertex buffer with a single lock and
+// issues one draw call per run.
+
+#pragma once
+
+// Same layout as CUSTOMVERTEX (D3DFVF_XYZ|D3DFVF_DIFFUSE|D3DFVF_TEX1)
+struct BATCH_VERTEX
+{
+  float        x, y, z;
+  unsigned int color;
+  float        tu, tv;
+};
+
+// Transforms the corners of the rectangle (x1,y1)-(x2,y2) with the GUI transform
+// matrix (z=0 in), all four at once. The corners come out in vertex order: upper
+// left, bottom left, bottom right, upper right.
+void TransformQuad(const float m[3][4], float x1, float y1, float x2, float y2,
+                   float* px, float* py, float* pz);
+
+// TransformQuad() stays scalar until the caller has checked the cpu for SSE
+void EnableTransformSSE(bool enable);
+
+// Maps the hash codes of the textures added by the GUI to texture slots
+class CTextureSlotMap
+{
+public:
+  CTextureSlotMap(int maxSlots);
+  ~CTextureSlotMap();
+
+  // returns -1 if hashCode isn't mapped
+  int  Find(int hashCode) const;
+  // returns the slot already used by hashCode or a free one, -1 if all slots are in use
+  int  Add(int hashCode);
+  void Remove(int slot);
+
+private:
+  int  Bucket(int hashCode) const;
+
+  int  m_maxSlots;
+  int  m_bucketMask;
+  int* m_buckets;     // first slot of each chain, -1 if empty
+  int* m_next;        // next slot in the same chain
+  int* m_hashCodes;   // -1 for free slots
+  int* m_freeSlots;
+  int  m_numFree;
+};
+
+// Consecutive quads drawn with the same texture and blend state
+struct BATCH_RUN
+{
+  void* texture;      // only compared, never dereferenced
+  bool  alphaBlend;
+  int   firstVertex;  // relative to the start of the batch
+  int   numVertices;
+};
+
+// Collects the quads of all textures queued since the last present. The textures
+// must be drawn in the order they were queued (FontEngineDrawTexture() flushes when
+// a later texture overlaps an earlier one), so runs are never reordered, only
+// adjacent runs sharing texture and state are merged.
+class CTextureBatch
+{
+public:
+  // maxRunVertices is limited by the quad index buffer used to draw a run
+  CTextureBatch(int maxVertices, int maxRunVertices);
+  ~CTextureBatch();
+
+  void Clear();
+  // returns false if the batch is full, the caller draws it and starts over
+  bool Add(void* texture, bool alphaBlend, const BATCH_VERTEX* vertices, int numVertices);
+
+  int                 VertexCount() const { return m_numVertices; }
+  const BATCH_VERTEX* Vertices() const    { return m_vertices; }
+  int                 RunCount() const    { return m_numRuns; }
+  const BATCH_RUN&    Run(int i) const    { return m_runs[i]; }
+
+private:
+  BATCH_VERTEX* m_vertices;
+  int           m_numVertices;
+  int           m_maxVertices;
+  int           m_maxRunVertices;
+  BATCH_RUN*    m_runs;
+  int           m_numRuns;
+  int           m_maxRuns;
+};
+
+// Write position in the batch vertex buffer. Batches are appended behind each other,
+// a dynamic buffer is locked with NOOVERWRITE and only discarded when the next batch
+// doesn't fit anymore, so the driver never has to wait for the GPU.
+class CVertexRing
+{
+public:
+  CVertexRing(int capacity);
+
+  // call after (re)creating the vertex buffer
+  void Reset();
+  // returns the first vertex of the reserved range, -1 if numVertices exceeds the
+  // capacity. *pDiscard tells to lock with DISCARD instead of NOOVERWRITE.
+  int  Reserve(int numVertices, bool* pDiscard);
+  int  Capacity() const { return m_capacity; }
+
+private:
+  int  m_capacity;
+  int  m_pos;
+  bool m_discard;
+};
@@ -17,6 +17,8 @@
 #include "stdafx.h"
 #include "fontEngine.h"
 #include "transformmatrix.h"
+#include "TextureBatch.h"
+#include "TextRunCache.h"
 
 using namespace std;
 #include <vector>
@@ -52,6 +54,7 @@ BOOL APIENTRY DllMain( HANDLE hModule,
 #define MAX_FONTS				      20
 #define MaxNumTextureVertices	3000
 #define MAX_TEXT_LINES        200
+#define MaxNumBatchVertices   32768
 
 // A structure for our custom vertex type
 struct CUSTOMVERTEX
@@ -83,6 +86,9 @@ struct CUSTOMVERTEX3
 #define D3DFVF_CUSTOMVERTEX2 (D3DFVF_XYZ|D3DFVF_DIFFUSE|D3DFVF_TEX2)
 #define D3DFVF_CUSTOMVERTEX3 (D3DFVF_XYZ|D3DFVF_DIFFUSE|D3DFVF_TEX3)
 
+// the texture batch is copied into the vertex buffer as is
+C_ASSERT(sizeof(CUSTOMVERTEX)==sizeof(BATCH_VERTEX));
+
 struct FONT_DATA_T
 {
   int                     iFirstChar;
@@ -105,13 +111,10 @@ struct TEXTURE_DATA_T
 {	
   int                     hashCode;
   LPDIRECT3DTEXTURE9      pTexture;
-  LPDIRECT3DVERTEXBUFFER9 pVertexBuffer;
-  LPDIRECT3DINDEXBUFFER9  pIndexBuffer;
   CUSTOMVERTEX*           vertices;
   int                     iv;
   int                     dwNumTriangles;
   D3DSURFACE_DESC         desc;
-  bool                    updateVertexBuffer;
   bool                    useAlphaBlend;
   bool                    delayedRemove;
 };
@@ -130,6 +133,17 @@ static TEXTURE_PLACE*       texturePlace[MAX_TEXTURES];
 static D3DTEXTUREFILTERTYPE m_Filter;
 int                         textureCount;
 
+// All textures are drawn from one dynamic vertex buffer, the runs share one quad index buffer
+static CTextureSlotMap         textureSlots(MAX_TEXTURES);
+static CTextureBatch           textureBatch(MaxNumBatchVertices, MaxNumTextureVertices);
+static CVertexRing             textureRing(MaxNumBatchVertices);
+static LPDIRECT3DVERTEXBUFFER9 m_pBatchVertexBuffer=NULL;
+static LPDIRECT3DINDEXBUFFER9  m_pQuadIndexBuffer=NULL;
+
+// Finished vertices of the strings drawn by FontEngineDrawText3D()
+static CTextRunCache           textRuns(MAX_FONTS, 1024);
+static vector<BATCH_VERTEX>    textRunVertices;
+
 static bool inPresentTextures=false; 
 static vector<int> texturesToBeRemoved;
 bool clipEnabled = false;
@@ -193,6 +207,65 @@ void Cleanup()
   return;
 }
 
+//*******************************************************************************************************************
+static void ReleaseBatchBuffers()
+{
+  if (m_pBatchVertexBuffer!=NULL)
+  {
+    m_pBatchVertexBuffer->Release();
+    m_pBatchVertexBuffer=NULL;
+  }
+  if (m_pQuadIndexBuffer!=NULL)
+  {
+    m_pQuadIndexBuffer->Release();
+    m_pQuadIndexBuffer=NULL;
+  }
+}
+
+static bool CreateBatchBuffers()
+{
+  // same pool and usage as the font buffers, a default pool buffer would have to be
+  // released before every device reset
+  if (FAILED(m_pDevice->CreateVertexBuffer(MaxNumBatchVertices*sizeof(CUSTOMVERTEX),
+                                           m_usage,
+                                           D3DFVF_CUSTOMVERTEX,
+                                           m_ipoolFormat,
+                                           &m_pBatchVertexBuffer,
+                                           NULL)))
+  {
+    Log("ERROR Fontengine:failed to create the texture vertex buffer\n");
+    m_pBatchVertexBuffer=NULL;
+    return false;
+  }
+  textureRing.Reset();
+
+  int numIndices=(MaxNumTextureVertices/4)*6;
+  if (FAILED(m_pDevice->CreateIndexBuffer(numIndices*sizeof(WORD),
+                                          D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, m_ipoolFormat,
+                                          &m_pQuadIndexBuffer, NULL)))
+  {
+    Log("ERROR Fontengine:failed to create the texture index buffer\n");
+    m_pQuadIndexBuffer=NULL;
+    ReleaseBatchBuffers();
+    return false;
+  }
+  WORD* pIndices;
+  int triangle=0;
+  m_pQuadIndexBuffer->Lock(0,0,(VOID**)&pIndices,0);
+  for (int i=0; i < numIndices;i+=6)
+  {
+    pIndices[i+0]=triangle*4+1;
+    pIndices[i+1]=triangle*4+0;
+    pIndices[i+2]=triangle*4+3;
+    pIndices[i+3]=triangle*4+2;
+    pIndices[i+4]=triangle*4+1;
+    pIndices[i+5]=triangle*4+3;
+    triangle++;
+  }
+  m_pQuadIndexBuffer->Unlock();
+  return true;
+}
+
 //*******************************************************************************************************************
 void FontEngineInitialize(int screenWidth, int screenHeight, int poolFormat)
 {
@@ -216,17 +289,15 @@ void FontEngineInitialize(int screenWidth, int screenHeight, int poolFormat)
       textureData[i].hashCode=-1;
       textureData[i].dwNumTriangles=0;
       textureData[i].iv=0;
-      textureData[i].pVertexBuffer=NULL;
-      textureData[i].pIndexBuffer=NULL;
       textureData[i].pTexture=NULL;
       textureData[i].vertices = NULL;
-      textureData[i].updateVertexBuffer=false;
       textureData[i].useAlphaBlend=true;
       textureData[i].delayedRemove=false;
       textureZ[i]=-1;
       texturePlace[i]=new TEXTURE_PLACE();
       texturePlace[i]->numRect = 0;
     }
+    EnableTransformSSE(IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE)!=FALSE);
     initialized=true;
     textureCount=0;
 	}
@@ -248,6 +319,9 @@ void FontEngineInitialize(int screenWidth, int screenHeight, int poolFormat)
 //*******************************************************************************************************************
 void FontEngineSetDevice(void* device)
 {
+  // the batch buffers belong to the old device, they are created again on the next present
+  ReleaseBatchBuffers();
+
   if(!device)
   {
     m_pDevice = NULL;
@@ -323,19 +397,10 @@ void FontEngineRemoveTexture(int textureNo)
   m_pDevice->SetStreamSource(0, NULL, 0, 0 );
 
   if (textureNo < 0 || textureNo>=MAX_TEXTURES) return;
+  textureSlots.Remove(textureNo);
   textureData[textureNo].hashCode=-1;
   textureData[textureNo].dwNumTriangles=0;
   textureData[textureNo].iv=0;
-  if (textureData[textureNo].pVertexBuffer!=NULL)
-  {
-    textureData[textureNo].pVertexBuffer->Release();
-  }
-  textureData[textureNo].pVertexBuffer=NULL;
-  if (textureData[textureNo].pIndexBuffer!=NULL)
-  {
-    textureData[textureNo].pIndexBuffer->Release();
-  }
-  textureData[textureNo].pIndexBuffer=NULL;
 
   if (textureData[textureNo].vertices!=NULL)
   {
@@ -347,7 +412,6 @@ void FontEngineRemoveTexture(int textureNo)
     textureData[textureNo].pTexture->Release();
   }
   textureData[textureNo].pTexture=NULL;
-  textureData[textureNo].updateVertexBuffer=true;
   textureData[textureNo].useAlphaBlend=true;
   textureData[textureNo].delayedRemove=false;
 }
@@ -355,19 +419,7 @@ void FontEngineRemoveTexture(int textureNo)
 //*******************************************************************************************************************
 int FontEngineAddTexture(int hashCode, bool useAlphaBlend, void* texture)
 {
-  int selected=-1;
-  for (int i=0; i < MAX_TEXTURES;++i)
-  {
-    if (textureData[i].hashCode==hashCode)
-    {
-      selected=i;
-      break;
-    }
-    if (textureData[i].hashCode==-1)
-    {
-      selected=i;
-    }
-  }
+  int selected=textureSlots.Add(hashCode);
   if (selected==-1)
   {
     Log("ERROR FontEngine:Ran out of textures!\n");
@@ -377,17 +429,7 @@ int FontEngineAddTexture(int hashCode, bool useAlphaBlend, void* texture)
   textureData[selected].hashCode=hashCode;
   textureData[selected].pTexture=(LPDIRECT3DTEXTURE9)texture;
   textureData[selected].pTexture->AddRef();
-  textureData[selected].updateVertexBuffer=true;
 
-  if (textureData[selected].pVertexBuffer==NULL)
-  {
-    m_pDevice->CreateVertexBuffer(MaxNumTextureVertices*sizeof(CUSTOMVERTEX),
-                                  m_usage, 
-                                  D3DFVF_CUSTOMVERTEX,
-                                  m_ipoolFormat, 
-                                  &textureData[selected].pVertexBuffer, 
-                                  NULL);  
-  }
   if (textureData[selected].vertices==NULL)
   {
     textureData[selected].vertices = new CUSTOMVERTEX[MaxNumTextureVertices];
@@ -399,27 +441,6 @@ int FontEngineAddTexture(int hashCode, bool useAlphaBlend, void* texture)
   }
   textureData[selected].pTexture->GetLevelDesc(0,&textureData[selected].desc);
 
-  m_pDevice->CreateIndexBuffer(	MaxNumTextureVertices *sizeof(WORD),
-                                D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, m_ipoolFormat, 
-                                &textureData[selected].pIndexBuffer, NULL ) ;
-  WORD* pIndices;
-  int triangle=0;
-  textureData[selected].pIndexBuffer->Lock(0,0,(VOID**)&pIndices,0);
-  for (int i=0; i < MaxNumTextureVertices;i+=6)
-  {
-    if (i+5 < MaxNumTextureVertices)
-    {
-      pIndices[i+0]=triangle*4+1;
-      pIndices[i+1]=triangle*4+0;
-      pIndices[i+2]=triangle*4+3;
-      pIndices[i+3]=triangle*4+2;
-      pIndices[i+4]=triangle*4+1;
-      pIndices[i+5]=triangle*4+3;
-    }
-    triangle++;
-  }
-  textureData[selected].pIndexBuffer->Unlock();
-
   return selected;
 }
 
@@ -429,19 +450,7 @@ int FontEngineAddSurface(int hashCode, bool useAlphaBlend,void* surface)
   //char log[128];
   //sprintf(log,"FontEngineAddSurface(%x)\n", hashCode);
   //Log(log);
-  int selected=-1;
-  for (int i=0; i < MAX_TEXTURES;++i)
-  {
-    if (textureData[i].hashCode==hashCode)
-    {
-      selected=i;
-      break;
-    }
-    if (textureData[i].hashCode==-1)
-    {
-      selected=i;
-    }
-  }
+  int selected=textureSlots.Add(hashCode);
   if (selected==-1)
   {
     Log("ERROR Fontengine:Ran out of textures!\n");
@@ -455,15 +464,6 @@ int FontEngineAddSurface(int hashCode, bool useAlphaBlend,void* surface)
   textureData[selected].hashCode=hashCode;
   textureData[selected].pTexture=(LPDIRECT3DTEXTURE9)pContainer;
 
-  if (textureData[selected].pVertexBuffer==NULL)
-  {
-    m_pDevice->CreateVertexBuffer(MaxNumTextureVertices*sizeof(CUSTOMVERTEX),
-                                  m_usage, 
-                                  D3DFVF_CUSTOMVERTEX,
-                                  m_ipoolFormat, 
-                                  &textureData[selected].pVertexBuffer, 
-                                  NULL) ;  
-  }
   if (textureData[selected].vertices==NULL)
   {
     textureData[selected].vertices = new CUSTOMVERTEX[MaxNumTextureVertices];
@@ -475,27 +475,6 @@ int FontEngineAddSurface(int hashCode, bool useAlphaBlend,void* surface)
   }
   textureData[selected].pTexture->GetLevelDesc(0,&textureData[selected].desc);
 
-  m_pDevice->CreateIndexBuffer( MaxNumTextureVertices *sizeof(WORD),
-                                D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, m_ipoolFormat, 
-                                &textureData[selected].pIndexBuffer, NULL ) ;
-  WORD* pIndices;
-  int triangle=0;
-  textureData[selected].pIndexBuffer->Lock(0,0,(VOID**)&pIndices,0);
-  for (int i=0; i < MaxNumTextureVertices;i+=6)
-  {
-    if (i+5 < MaxNumTextureVertices)
-    {
-      pIndices[i+0]=triangle*4+1;
-      pIndices[i+1]=triangle*4+0;
-      pIndices[i+2]=triangle*4+3;
-      pIndices[i+3]=triangle*4+2;
-      pIndices[i+4]=triangle*4+1;
-      pIndices[i+5]=triangle*4+3;
-    }
-    triangle++;
-  }
-  textureData[selected].pIndexBuffer->Unlock();
-
   return selected;
 }
 
@@ -533,7 +512,6 @@ void FontEngineDrawTexture(int textureNo,float x, float y, float nw, float nh, f
   }
 
   TEXTURE_DATA_T* texture;
-  TransformMatrix matrix(m);
   //1-2-1
   bool needRedraw=false;
   bool textureAlreadyDrawn=false;
@@ -664,80 +642,21 @@ void FontEngineDrawTexture(int textureNo,float x, float y, float nw, float nh, f
   xpos2-=0.5f;
   ypos2-=0.5f;
 
-  //upper left
-  float x1=matrix.ScaleFinalXCoord(xpos,ypos);
-  float y1=matrix.ScaleFinalYCoord(xpos,ypos);
-  float z1 = matrix.ScaleFinalZCoord(xpos,ypos);
-
-  //bottom left
-  float x2=matrix.ScaleFinalXCoord(xpos,ypos2);
-  float y2=matrix.ScaleFinalYCoord(xpos,ypos2);
-  float z2=matrix.ScaleFinalZCoord(xpos,ypos2);
-
-  //bottom right
-  float x3=matrix.ScaleFinalXCoord(xpos2,ypos2);
-  float y3=matrix.ScaleFinalYCoord(xpos2,ypos2);
-  float z3=matrix.ScaleFinalZCoord(xpos2,ypos2);
-
-  //upper right
-  float x4=matrix.ScaleFinalXCoord(xpos2,ypos);
-  float y4=matrix.ScaleFinalYCoord(xpos2,ypos);
-  float z4=matrix.ScaleFinalZCoord(xpos2,ypos);
-
-  //upper left
-  if (texture->vertices[iv].tu != tx1 || texture->vertices[iv].tv !=ty1 || texture->vertices[iv].color!=color ||
-      texture->vertices[iv].x != x1 || texture->vertices[iv].y !=y1 || texture->vertices[iv].z!=z1)
-  {
-    texture->updateVertexBuffer=true;
-  }
-  texture->vertices[iv].x=x1 ;  
-  texture->vertices[iv].y=y1 ; 
-  texture->vertices[iv].z=z1;
-  texture->vertices[iv].color=color;
-  texture->vertices[iv].tu=tx1; 
-  texture->vertices[iv].tv=ty1; 
-  iv++;
+  float vx[4], vy[4], vz[4];
+  TransformQuad(m, xpos, ypos, xpos2, ypos2, vx, vy, vz);
 
-  //bottom left
-  if (texture->vertices[iv].tu != tx1 || texture->vertices[iv].tv !=ty2 || texture->vertices[iv].color!=color ||
-      texture->vertices[iv].x != x2 || texture->vertices[iv].y !=y2 || texture->vertices[iv].z!=z2)
-  {
-    texture->updateVertexBuffer=true;
-  }
-  texture->vertices[iv].x=x2;  
-  texture->vertices[iv].y=y2;
-  texture->vertices[iv].z=z2; 
-  texture->vertices[iv].color=color;
-  texture->vertices[iv].tu=tx1; 
-  texture->vertices[iv].tv=ty2;
-  iv++;
-
-  //bottom right
-  if (texture->vertices[iv].tu != tx2 || texture->vertices[iv].tv !=ty2 || texture->vertices[iv].color!=color ||
-      texture->vertices[iv].x != x3 || texture->vertices[iv].y !=y3 || texture->vertices[iv].z!=z3)
+  // upper left, bottom left, bottom right, upper right
+  const float tu[4]={tx1, tx1, tx2, tx2};
+  const float tv[4]={ty1, ty2, ty2, ty1};
+  for (int i=0; i < 4; ++i, ++iv)
   {
-    texture->updateVertexBuffer=true;
+    texture->vertices[iv].x=vx[i];
+    texture->vertices[iv].y=vy[i];
+    texture->vertices[iv].z=vz[i];
+    texture->vertices[iv].color=color;
+    texture->vertices[iv].tu=tu[i];
+    texture->vertices[iv].tv=tv[i];
   }
-  texture->vertices[iv].x=x3;  
-  texture->vertices[iv].y=y3; 
-  texture->vertices[iv].z=z3;
-  texture->vertices[iv].color=color;
-  texture->vertices[iv].tu=tx2; 
-  texture->vertices[iv].tv=ty2;iv++;
-
-  //upper right
-  if (texture->vertices[iv].tu != tx2 || texture->vertices[iv].tv !=ty1 || texture->vertices[iv].color!=color ||
-      texture->vertices[iv].x != x4 || texture->vertices[iv].y !=y4 || texture->vertices[iv].z!=z4)
-  {
-    texture->updateVertexBuffer=true;
-  }
-  texture->vertices[iv].x=x4;  
-  texture->vertices[iv].y=y4;
-  texture->vertices[iv].z=z4; 
-  texture->vertices[iv].color=color;
-  texture->vertices[iv].tu=tx2; 
-  texture->vertices[iv].tv=ty1;
-  iv++;
 
   texture->iv=texture->iv+4;
   texture->dwNumTriangles=texture->dwNumTriangles+2;
@@ -1565,6 +1484,61 @@ void FontEngineDrawMaskedTexture2(int textureNo1,float x, float y, float nw, flo
   m_pDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
 }
 
+//*******************************************************************************************************************
+// Copies the batch into the ring vertex buffer with one lock and draws it, one
+// draw call per run
+static void DrawTextureBatch()
+{
+  int numVertices=textureBatch.VertexCount();
+  if (numVertices==0)
+  {
+    return;
+  }
+  if (m_pBatchVertexBuffer==NULL && !CreateBatchBuffers())
+  {
+    textureBatch.Clear();
+    return;
+  }
+
+  bool discard;
+  int first=textureRing.Reserve(numVertices,&discard);
+  CUSTOMVERTEX* pVertices;
+  // DISCARD and NOOVERWRITE are only allowed on dynamic buffers
+  DWORD lockFlags=0;
+  if (m_usage & D3DUSAGE_DYNAMIC)
+  {
+    lockFlags=discard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE;
+  }
+  if (first < 0 ||
+      FAILED(m_pBatchVertexBuffer->Lock(first*sizeof(CUSTOMVERTEX), numVertices*sizeof(CUSTOMVERTEX), (void**)&pVertices,
+                                        lockFlags)))
+  {
+    Log("ERROR Fontengine:failed to lock the texture vertex buffer\n");
+    textureBatch.Clear();
+    return;
+  }
+  memcpy(pVertices,textureBatch.Vertices(),numVertices*sizeof(CUSTOMVERTEX));
+  m_pBatchVertexBuffer->Unlock();
+  m_iVertexBuffersUpdated++;
+
+  m_pDevice->SetStreamSource(0, m_pBatchVertexBuffer, 0, sizeof(CUSTOMVERTEX) );
+  m_pDevice->SetIndices( m_pQuadIndexBuffer );
+  for (int i=0; i < textureBatch.RunCount(); ++i)
+  {
+    const BATCH_RUN& run=textureBatch.Run(i);
+    FontEngineSetAlphaBlend(run.alphaBlend ? TRUE : FALSE);
+    m_pDevice->SetTexture(0, (LPDIRECT3DTEXTURE9)run.texture);
+    m_pDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 
+                                    first+run.firstVertex,  //baseVertexIndex,
+                                    0,                      //minVertexIndex,
+                                    run.numVertices,        //NumVertices
+                                    0,                      //StartIndex,
+                                    run.numVertices/2       //MaxPrimitives
+                                    );
+  }
+  textureBatch.Clear();
+}
+
 //*******************************************************************************************************************
 void FontEnginePresentTextures()
 {
@@ -1610,34 +1584,12 @@ void FontEnginePresentTextures()
           if (texture->dwNumTriangles!=0)
           {
             m_iTexturesInUse++;
-            if (texture->updateVertexBuffer)
-            {
-              m_iVertexBuffersUpdated++;
-              CUSTOMVERTEX* pVertices;
-              texture->pVertexBuffer->Lock( 0, 0, (void**)&pVertices, m_lock) ;
-              memcpy(pVertices,texture->vertices, (texture->iv)*sizeof(CUSTOMVERTEX));
-              texture->pVertexBuffer->Unlock();
-            }
-
-            if(texture->useAlphaBlend)
-            {
-              FontEngineSetAlphaBlend(TRUE);
-            }
-            else
+            BATCH_VERTEX* vertices=(BATCH_VERTEX*)texture->vertices;
+            if (!textureBatch.Add(texture->pTexture, texture->useAlphaBlend, vertices, texture->iv))
             {
-              FontEngineSetAlphaBlend(FALSE);
+              DrawTextureBatch();
+              textureBatch.Add(texture->pTexture, texture->useAlphaBlend, vertices, texture->iv);
             }
-
-            m_pDevice->SetTexture(0, texture->pTexture);
-            m_pDevice->SetStreamSource(0, texture->pVertexBuffer, 0, sizeof(CUSTOMVERTEX) );
-            m_pDevice->SetIndices( texture->pIndexBuffer );
-            m_pDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 
-                                            0,                      //baseVertexIndex,
-                                            0,                      //minVertexIndex,
-                                            texture->iv,            //NumVertices
-                                            0,                      //StartIndex,
-                                            texture->dwNumTriangles //MaxPrimitives
-                                            );
           }
         }
         catch(...)
@@ -1648,11 +1600,11 @@ void FontEnginePresentTextures()
         }
         texture->dwNumTriangles = 0;
         texture->iv = 0;
-        texture->updateVertexBuffer=false;
         textureZ[i]=0;
         texturePlace[index]->numRect = 0;
       }
     }
+    DrawTextureBatch();
     textureCount=0;
 
     //#ifdef _DEBUG
@@ -1695,6 +1647,7 @@ void FontEngineAddFont( int fontNumber,void* fontTexture, int firstChar, int end
   if (fontTexture==NULL) return;
   if (firstChar<0 || firstChar>endChar) return;
 
+  textRuns.InvalidateFont(fontNumber);
   fontData[fontNumber].vertices = new CUSTOMVERTEX[MaxNumfontVertices];
   for (int i=0; i < MaxNumfontVertices;++i)
   {
@@ -1747,41 +1700,88 @@ void FontEngineSetCoordinate(int fontNumber, int index, int subindex, float fVal
   if (fontNumber< 0 || fontNumber>=MAX_FONTS) return;
   if (index < 0     || index > MAX_TEXTURE_COORDS) return;
   if (subindex < 0  || subindex > 3) return;
+  textRuns.InvalidateFont(fontNumber);
   fontData[fontNumber].textureCoord[index][0]=fValue1;
   fontData[fontNumber].textureCoord[index][1]=fValue2;
   fontData[fontNumber].textureCoord[index][2]=fValue3;
   fontData[fontNumber].textureCoord[index][3]=fValue4;
 }
 
-// Updates a vertex in the memory buffer if needed
-void UpdateVertex(TransformMatrix& matrix, FONT_DATA_T* pFont, CUSTOMVERTEX* pVertex, float x, float y, float tu, float tv, DWORD color)
+// Appends the quads of a text run to the font. The vertex buffer only needs an
+// update when they differ from what was drawn at the same place last time.
+static void AppendTextVertices(int fontNumber, const BATCH_VERTEX* vertices, int numVertices)
 {
-  float x1 = matrix.ScaleFinalXCoord(x,y);
-  float y1 = matrix.ScaleFinalYCoord(x,y);
-  float z = matrix.ScaleFinalZCoord(x,y);
-  if(pVertex->x != x1 || pVertex->y != y1 || pVertex->z != z || pVertex->tu != tu || pVertex->tv != tv || pVertex->color != color)
+  FONT_DATA_T* font = &(fontData[fontNumber]);
+  for (int i=0; i < numVertices; i+=4)
   {
-	  pVertex->x = x1;
-	  pVertex->y = y1;
-	  pVertex->z = z;
-	  pVertex->tu = tu;
-	  pVertex->tv = tv;
-	  pVertex->color = color;
-	  pFont->updateVertexBuffer = true;		// We need to update gfx card vertex buffer
-  }
+    CUSTOMVERTEX* pVertex=&font->vertices[font->iv];
+    if (memcmp(pVertex, &vertices[i], 4*sizeof(CUSTOMVERTEX)) != 0)
+    {
+      memcpy(pVertex, &vertices[i], 4*sizeof(CUSTOMVERTEX));
+      font->updateVertexBuffer = true;		// We need to update gfx card vertex buffer
+    }
+    font->iv += 4;
+    font->dwNumTriangles += 2;
+    if (font->iv > (MaxNumfontVertices-12))
+    {
+      FontEnginePresentTextures();
+      FontEnginePresent3D(fontNumber);
+      font->dwNumTriangles = 0;
+      font->iv = 0;
+    }
   }
+}
 
-  //*******************************************************************************************************************
-  void FontEngineDrawText3D(int fontNumber, void* textVoid, int xposStart, int yposStart, DWORD intColor, int maxWidth, float m[3][4])
-  {
+//*******************************************************************************************************************
+void FontEngineDrawText3D(int fontNumber, void* textVoid, int xposStart, int yposStart, DWORD intColor, int maxWidth, float m[3][4])
+{
   if (fontNumber< 0 || fontNumber>=MAX_FONTS) return;
   if (m_pDevice==NULL) return;
   if (fontData[fontNumber].pVertexBuffer==NULL) return;
   if (textVoid==NULL) return;
 
-  TransformMatrix matrix(m);
-
   WCHAR* text = (WCHAR*)textVoid;
+  int length = (int)wcslen(text);
+  if (length==0) return;
+
+  // Avoid drawing text that is not inside the viewport.
+  D3DVIEWPORT9 viewport;
+  m_pDevice->GetViewport(&viewport);
+  RECT clipRect;
+  if (clipEnabled)
+  {
+    m_pDevice->GetScissorRect(&clipRect);
+  }
+
+  // Reuse the vertices of the last call drawing the same text the same way
+  TEXT_RUN_KEY key;
+  memset(&key, 0, sizeof(key));
+  key.font = fontNumber;
+  key.x = xposStart;
+  key.y = yposStart;
+  key.color = intColor;
+  key.maxWidth = maxWidth;
+  memcpy(key.matrix, m, sizeof(key.matrix));
+  key.viewport[0] = viewport.X;
+  key.viewport[1] = viewport.Y;
+  key.viewport[2] = viewport.Width;
+  key.viewport[3] = viewport.Height;
+  if (clipEnabled)
+  {
+    key.clip[0] = clipRect.left;
+    key.clip[1] = clipRect.top;
+    key.clip[2] = clipRect.right;
+    key.clip[3] = clipRect.bottom;
+  }
+
+  int numVertices;
+  const BATCH_VERTEX* cached = textRuns.Find(key, text, length, &numVertices);
+  if (cached != NULL)
+  {
+    AppendTextVertices(fontNumber, cached, numVertices);
+    return;
+  }
+  textRunVertices.clear();
 
   FONT_DATA_T* font = &(fontData[fontNumber]);
   float xpos = (float)xposStart;
@@ -1807,7 +1807,7 @@ void UpdateVertex(TransformMatrix& matrix, FONT_DATA_T* pFont, CUSTOMVERTEX* pVe
   float totalWidth = 0;
   float lineWidths[MAX_TEXT_LINES];
   int lineNr=0;
-  for (int i=0; i < (int)wcslen(text);++i)
+  for (int i=0; i < length;++i)
   {
     WCHAR c=text[i];
     if (c == '\n')
@@ -1843,7 +1843,7 @@ void UpdateVertex(TransformMatrix& matrix, FONT_DATA_T* pFont, CUSTOMVERTEX* pVe
   ypos = fStartY;
   lineNr=0;
 
-  for (int i=0; i < (int)wcslen(text);++i)
+  for (int i=0; i < length;++i)
   {
     WCHAR c=text[i];
     if (c == '\n')
@@ -1875,18 +1875,11 @@ void UpdateVertex(TransformMatrix& matrix, FONT_DATA_T* pFont, CUSTOMVERTEX* pVe
     float ypos2 = ypos + h;
 
     // Check if inside viewport.
-    // Avoid drawing text that is not inside the viewport.
-    D3DVIEWPORT9 viewport;
-    m_pDevice->GetViewport(&viewport);
-
     if(xpos1 < (viewport.X + viewport.Width) && xpos2 >= viewport.X &&
       ypos1 < (viewport.Y + viewport.Height) && ypos2 >= viewport.Y)
     {
       if (clipEnabled)
       {
-        // Get the clip rectangle.
-        RECT clipRect;
-        m_pDevice->GetScissorRect(&clipRect);
         float minX = clipRect.left;
         float minY = clipRect.top;
         float maxX = clipRect.right;
@@ -1952,26 +1945,33 @@ void UpdateVertex(TransformMatrix& matrix, FONT_DATA_T* pFont, CUSTOMVERTEX* pVe
         alpha1|= (intColor & 0xffffff);
         alpha2|= (intColor & 0xffffff);
       }
-      int vertices=font->iv;
-      UpdateVertex(matrix,font, &font->vertices[font->iv++], xpos1, ypos1, tx1, ty1, alpha2);
-      UpdateVertex(matrix,font, &font->vertices[font->iv++], xpos1, ypos2, tx1, ty2, alpha2);
-      UpdateVertex(matrix,font, &font->vertices[font->iv++], xpos2, ypos2, tx2, ty2, alpha1);
-      UpdateVertex(matrix,font, &font->vertices[font->iv++], xpos2, ypos1, tx2, ty1, alpha1);
-      //UpdateVertex(font, &font->vertices[font->iv++], xpos1, ypos2, tx1, ty2, alpha2);
-      //UpdateVertex(font, &font->vertices[font->iv++], xpos2, ypos1, tx2, ty1, alpha1);
-
-      font->dwNumTriangles += 2;
-      if (font->iv > (MaxNumfontVertices-12))
+      float vx[4], vy[4], vz[4];
+      TransformQuad(m, xpos1, ypos1, xpos2, ypos2, vx, vy, vz);
+
+      // upper left, bottom left, bottom right, upper right
+      const float tu[4]={tx1, tx1, tx2, tx2};
+      const float tv[4]={ty1, ty2, ty2, ty1};
+      const DWORD color[4]={(DWORD)alpha2, (DWORD)alpha2, (DWORD)alpha1, (DWORD)alpha1};
+      for (int v=0; v < 4; ++v)
       {
-        FontEnginePresentTextures();
-        FontEnginePresent3D(fontNumber);
-        font->dwNumTriangles = 0;
-        font->iv = 0;
+        BATCH_VERTEX vertex;
+        vertex.x = vx[v];
+        vertex.y = vy[v];
+        vertex.z = vz[v];
+        vertex.color = color[v];
+        vertex.tu = tu[v];
+        vertex.tv = tv[v];
+        textRunVertices.push_back(vertex);
       }
     }
     totalWidth += (w - fSpacing);
     xpos += (w - fSpacing);
   }
+
+  numVertices = (int)textRunVertices.size();
+  const BATCH_VERTEX* vertices = numVertices > 0 ? &textRunVertices[0] : NULL;
+  textRuns.Store(key, text, length, vertices, numVertices);
+  AppendTextVertices(fontNumber, vertices, numVertices);
 }
 
 //*******************************************************************************************************************
@@ -2048,6 +2048,7 @@ void FontEngineRemoveFont(int fontNumber)
   // Important to set it to NULL  otherwise the textures, etc. will not be freed on release
   m_pDevice->SetStreamSource(0, NULL, 0, 0 );
   if (fontNumber< 0 || fontNumber>=MAX_FONTS) return;
+  textRuns.InvalidateFont(fontNumber);
   if (fontData[fontNumber].pVertexBuffer!=NULL) 
   {
     fontData[fontNumber].pVertexBuffer->Release();
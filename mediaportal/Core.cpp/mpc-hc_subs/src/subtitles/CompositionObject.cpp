@@ -21,10 +21,27 @@
  */
 
 #include "stdafx.h"
+#include <emmintrin.h>
 #include "CompositionObject.h"
 #include "../DSUtil/GolombBuffer.h"
 
 
+CompositionObjectBitmap::CompositionObjectBitmap(SHORT object_id, BYTE version_number, SHORT width, SHORT height)
+{
+	m_cRef				= 1;
+	m_object_id			= object_id;
+	m_version_number	= version_number;
+	m_width				= width;
+	m_height			= height;
+	m_pIndex			= DNew BYTE[max(width, 0) * max(height, 0)];
+	memset (m_pIndex, 0xFF, max(width, 0) * max(height, 0));		// Fully transparent
+}
+
+CompositionObjectBitmap::~CompositionObjectBitmap()
+{
+	delete[] m_pIndex;
+}
+
 
 CompositionObject::CompositionObject()
 {
@@ -34,12 +51,29 @@ CompositionObject::CompositionObject()
 	m_nRLEDataSize	= 0;
 	m_nRLEPos		= 0;
 	m_nColorNumber	= 0;
+	m_pBitmap		= NULL;
 	memsetd (m_Colors, 0xFF000000, sizeof(m_Colors));
 }
 
 CompositionObject::~CompositionObject()
 {
 	delete[] m_pRLEData;
+	if (m_pBitmap) {
+		m_pBitmap->Release();
+	}
+}
+
+void CompositionObject::SetBitmap(CompositionObjectBitmap* pBitmap)
+{
+	if (pBitmap) {
+		pBitmap->AddRef();
+		m_width		= pBitmap->m_width;
+		m_height	= pBitmap->m_height;
+	}
+	if (m_pBitmap) {
+		m_pBitmap->Release();
+	}
+	m_pBitmap = pBitmap;
 }
 
 void CompositionObject::SetPalette (int nNbEntry, HDMV_PALETTE* pPalette, bool bIsHD)
@@ -80,20 +114,96 @@ void CompositionObject::AppendRLEData(BYTE* pBuffer, int nSize)
 }
 
 
+// Blends a line of palette indices over dst, same arithmetic as Rasterizer's pixmix
+// with an alpha of 0x40. Fully transparent entries leave dst unchanged.
+static void BlendPaletteLine(DWORD* dst, const BYTE* pIndex, const DWORD* pColors, const DWORD* pWeights, int nCount)
+{
+	int		i = 0;
+
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		__m128i	zero = _mm_setzero_si128();
+
+		for (; i+4 <= nCount; i+=4) {
+			BYTE	i0 = pIndex[i], i1 = pIndex[i+1], i2 = pIndex[i+2], i3 = pIndex[i+3];
+			DWORD	w0 = pWeights[i0], w1 = pWeights[i1], w2 = pWeights[i2], w3 = pWeights[i3];
+
+			if (((w0 | w1 | w2 | w3) >> 16) == 1) {
+				continue;	// 4 transparent pixels
+			}
+
+			__m128i	d  = _mm_loadu_si128((__m128i*)&dst[i]);
+			__m128i	s  = _mm_set_epi32(pColors[i3], pColors[i2], pColors[i1], pColors[i0]);
+
+			__m128i	dl = _mm_unpacklo_epi8(d, zero);
+			__m128i	sl = _mm_unpacklo_epi8(s, zero);
+			__m128i	dh = _mm_unpackhi_epi8(d, zero);
+			__m128i	sh = _mm_unpackhi_epi8(s, zero);
+
+			__m128i	r0 = _mm_srli_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(dl, sl), _mm_set1_epi32(w0)), 8);
+			__m128i	r1 = _mm_srli_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(dl, sl), _mm_set1_epi32(w1)), 8);
+			__m128i	r2 = _mm_srli_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(dh, sh), _mm_set1_epi32(w2)), 8);
+			__m128i	r3 = _mm_srli_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(dh, sh), _mm_set1_epi32(w3)), 8);
+
+			_mm_storeu_si128((__m128i*)&dst[i], _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+		}
+	}
+
+	for (; i<nCount; i++) {
+		DWORD	w  = pWeights[pIndex[i]];
+		DWORD	c  = pColors[pIndex[i]];
+		DWORD	ia = w & 0xffff;
+		DWORD	a  = w >> 16;
+
+		dst[i] = ((((dst[i]&0x00ff00ff)*ia + (c&0x00ff00ff)*a)&0xff00ff00)>>8)
+				 | ((((dst[i]&0x0000ff00)*ia + (c&0x0000ff00)*a)&0x00ff0000)>>8)
+				 | ((((dst[i]>>8)&0x00ff0000)*ia)&0xff000000);
+	}
+}
+
 void CompositionObject::RenderHdmv(SubPicDesc& spd)
 {
-	if (!m_pRLEData) {
-		return;
+	if (!m_pBitmap) {
+		SetBitmap (DecodeHdmv (m_object_id_ref));
+		if (m_pBitmap) {
+			m_pBitmap->Release();
+		} else {
+			return;
+		}
+	}
+
+	// Remap the palette only, the decoded indices are reused as is
+	DWORD	Colors[256];
+	DWORD	Weights[256];
+	for (int i=0; i<256; i++) {
+		DWORD	a = (i == 0xFF) ? 0 : (m_Colors[i] >> 24);	// Fully transparent (9.14.4.2.2.1.1)
+		Colors[i]	= m_Colors[i] & 0xffffff;
+		Weights[i]	= ((a+1) << 16) | (0x100 - a);
+	}
+
+	int		nWidth	= min ((int)m_pBitmap->m_width, spd.w);
+	int		nHeight	= min ((int)m_pBitmap->m_height, spd.h);
+
+	for (int y=0; y<nHeight; y++) {
+		DWORD*	dst = (DWORD*)((BYTE*)spd.bits + spd.pitch * y);
+		BlendPaletteLine (dst, m_pBitmap->m_pIndex + y*m_pBitmap->m_width, Colors, Weights, nWidth);
 	}
+}
 
+CompositionObjectBitmap* CompositionObject::DecodeHdmv(SHORT object_id)
+{
+	if (!m_pRLEData || !IsRLEComplete() || m_width <= 0 || m_height <= 0) {
+		return NULL;
+	}
+
+	CompositionObjectBitmap*	pBitmap = DNew CompositionObjectBitmap(object_id, m_version_number, m_width, m_height);
 	CGolombBuffer	GBuffer (m_pRLEData, m_nRLEDataSize);
 	BYTE			bTemp;
 	BYTE			bSwitch;
 
 	BYTE			nPaletteIndex = 0;
-	SHORT			nCount;
-	SHORT			nX	= 0;
-	SHORT			nY	= 0;
+	int				nCount;
+	int				nX	= 0;
+	int				nY	= 0;
 
 	while ((nY < m_height) && !GBuffer.IsEOF()) {
 		bTemp = GBuffer.ReadByte();
@@ -109,7 +219,7 @@ void CompositionObject::RenderHdmv(SubPicDesc& spd)
 						nPaletteIndex = 0;
 					}
 				} else {
-					nCount			= (bSwitch&0x3F) <<8 | (SHORT)GBuffer.ReadByte();
+					nCount			= (bSwitch&0x3F) <<8 | GBuffer.ReadByte();
 					nPaletteIndex	= 0;
 				}
 			} else {
@@ -117,22 +227,26 @@ void CompositionObject::RenderHdmv(SubPicDesc& spd)
 					nCount			= bSwitch & 0x3F;
 					nPaletteIndex	= GBuffer.ReadByte();
 				} else {
-					nCount			= (bSwitch&0x3F) <<8 | (SHORT)GBuffer.ReadByte();
+					nCount			= (bSwitch&0x3F) <<8 | GBuffer.ReadByte();
 					nPaletteIndex	= GBuffer.ReadByte();
 				}
 			}
 		}
 
 		if (nCount>0) {
-			if (nPaletteIndex != 0xFF) {	// Fully transparent (9.14.4.2.2.1.1)
-				FillSolidRect (spd, nX, nY, nCount, 1, m_Colors[nPaletteIndex]);
+			// Runs past the end of the line are clipped, corrupt lines must not
+			// write outside the bitmap
+			if (nX >= 0 && nX < m_width) {
+				memset (pBitmap->m_pIndex + nY*m_width + nX, nPaletteIndex, min (nCount, m_width-nX));
 			}
-			nX += nCount;
+			nX = min (nX + nCount, (int)m_width);
 		} else {
 			nY++;
 			nX = 0;
 		}
 	}
+
+	return pBitmap;
 }
 
 
@@ -36,6 +36,35 @@ struct HDMV_PALETTE {
 
 class CGolombBuffer;
 
+// Object bitmap decoded once to 8-bit palette indices. It is shared by every
+// composition of the epoch showing the same object version, palette updates
+// only change the colors used to blend it.
+class CompositionObjectBitmap
+{
+public :
+	SHORT				m_object_id;
+	BYTE				m_version_number;
+	SHORT				m_width;
+	SHORT				m_height;
+	BYTE*				m_pIndex;
+
+	CompositionObjectBitmap(SHORT object_id, BYTE version_number, SHORT width, SHORT height);
+
+	void				AddRef() {
+		InterlockedIncrement(&m_cRef);
+	};
+	void				Release() {
+		if (InterlockedDecrement(&m_cRef) == 0) {
+			delete this;
+		}
+	};
+
+private :
+	LONG		m_cRef;
+
+	~CompositionObjectBitmap();
+};
+
 class CompositionObject : Rasterizer
 {
 public :
@@ -70,6 +99,11 @@ public :
 		return m_nRLEPos >= m_nRLEDataSize;
 	};
 	void				RenderHdmv(SubPicDesc& spd);
+	CompositionObjectBitmap*	DecodeHdmv(SHORT object_id);
+	void				SetBitmap(CompositionObjectBitmap* pBitmap);
+	CompositionObjectBitmap*	GetBitmap() {
+		return m_pBitmap;
+	};
 	void				RenderDvb(SubPicDesc& spd, SHORT nX, SHORT nY);
 	void				WriteSeg (SubPicDesc& spd, SHORT nX, SHORT nY, SHORT nCount, SHORT nPaletteIndex);
 	void				SetPalette (int nNbEntry, HDMV_PALETTE* pPalette, bool bIsHD);
@@ -84,6 +118,7 @@ private :
 	int			m_nRLEPos;
 	int			m_nColorNumber;
 	DWORD		m_Colors[256];
+	CompositionObjectBitmap*	m_pBitmap;
 
 	void		DvbRenderField(SubPicDesc& spd, CGolombBuffer& gb, SHORT nXStart, SHORT nYStart, SHORT nLength);
 	void		Dvb2PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
@@ -157,6 +157,11 @@ HRESULT CHdmvSub::ParseSample(IMediaSample* pSample)
 							TRACE_HDMVSUB ("CHdmvSub:PRESENTATION_SEG   %S (size=%d)\n", ReftimeToString(rtStart), m_nSegSize);
 
 							if (m_pCurrentObject) {
+								// A composition without a palette segment, like a move, shows the palette
+								// of its time and not the one of a later fade
+								if (!m_pCurrentObject->HavePalette() && m_pDefaultPalette) {
+									m_pCurrentObject->SetPalette (m_nDefaultPaletteNbEntry, m_pDefaultPalette, m_VideoDescriptor.nVideoWidth>720);
+								}
 								m_pCurrentObject->m_rtStop = rtStart;
 								m_pObjects.AddTail (m_pCurrentObject);
 								TRACE_HDMVSUB ("CHdmvSub:HDMV : %S => %S\n", ReftimeToString (m_pCurrentObject->m_rtStart), ReftimeToString(rtStart));
@@ -200,10 +205,21 @@ int CHdmvSub::ParsePresentationSegment(CGolombBuffer* pGBuffer)
 	palette_id_ref		= pGBuffer->ReadByte();
 	nObjectNumber		= pGBuffer->ReadByte();
 
+	if ((CompositionDescriptor.bState & 0xC0) == 0x80) {
+		// Epoch start, objects of the previous epoch can't be referenced anymore
+		ReleaseBitmaps();
+	}
+
 	if (nObjectNumber > 0) {
 		delete m_pCurrentObject;
 		m_pCurrentObject = DNew CompositionObject();
 		ParseCompositionObject (pGBuffer, m_pCurrentObject);
+
+		// Palette updates and moves reuse the object decoded earlier in the epoch
+		CompositionObjectBitmap*	pBitmap;
+		if (m_Bitmaps.Lookup (m_pCurrentObject->m_object_id_ref, pBitmap)) {
+			m_pCurrentObject->SetBitmap (pBitmap);
+		}
 	}
 
 	return nObjectNumber;
@@ -257,6 +273,24 @@ void CHdmvSub::ParseObject(CGolombBuffer* pGBuffer, USHORT nUnitSize)	// #498
 		} else {
 			m_pCurrentObject->AppendRLEData (pGBuffer->GetBufferPos(), nUnitSize-4);
 		}
+
+		if (m_pCurrentObject->IsRLEComplete()) {
+			// Decode once per (object_id, version), a repeated object keeps the cached bitmap
+			CompositionObjectBitmap*	pBitmap = NULL;
+			if (!m_Bitmaps.Lookup (object_id, pBitmap) || pBitmap->m_version_number != m_pCurrentObject->m_version_number
+					|| pBitmap->m_width != m_pCurrentObject->m_width || pBitmap->m_height != m_pCurrentObject->m_height) {
+				CompositionObjectBitmap*	pNewBitmap = m_pCurrentObject->DecodeHdmv (object_id);
+				if (pNewBitmap) {
+					if (pBitmap) {
+						pBitmap->Release();
+					}
+					m_Bitmaps[object_id] = pBitmap = pNewBitmap;
+				}
+			}
+			if (pBitmap) {
+				m_pCurrentObject->SetBitmap (pBitmap);
+			}
+		}
 	}
 }
 
@@ -342,6 +376,17 @@ void CHdmvSub::Reset()
 		pObject = m_pObjects.RemoveHead();
 		delete pObject;
 	}
+
+	ReleaseBitmaps();
+}
+
+void CHdmvSub::ReleaseBitmaps()
+{
+	POSITION	pos = m_Bitmaps.GetStartPosition();
+	while (pos) {
+		m_Bitmaps.GetNextValue(pos)->Release();
+	}
+	m_Bitmaps.RemoveAll();
 }
 
 CompositionObject*	CHdmvSub::FindObject(REFERENCE_TIME rt)
@@ -106,6 +106,9 @@ private :
 
 	int								m_nColorNumber;
 
+	// Decoded objects of the current epoch, by object_id
+	CAtlMap<SHORT, CompositionObjectBitmap*>	m_Bitmaps;
+
 
 	int					ParsePresentationSegment(CGolombBuffer* pGBuffer);
 	void				ParsePalette(CGolombBuffer* pGBuffer, USHORT nSize);
@@ -116,6 +119,7 @@ private :
 	void				ParseCompositionObject(CGolombBuffer* pGBuffer, CompositionObject* pCompositionObject);
 
 	void				AllocSegment(int nSize);
+	void				ReleaseBitmaps();
 
 	CompositionObject*	FindObject(REFERENCE_TIME rt);
 };
@@ -1722,6 +1722,7 @@ CRenderedTextSubtitle::CRenderedTextSubtitle(CCritSec* pLock, STSStyle *styleOve
 CRenderedTextSubtitle::~CRenderedTextSubtitle()
 {
 	Deinit();
+	EmptyTagCache();
 
 	g_hDC_refcnt--;
 	if(g_hDC_refcnt == 0) {
@@ -1743,6 +1744,7 @@ void CRenderedTextSubtitle::Copy(CSimpleTextSubtitle& sts)
 void CRenderedTextSubtitle::Empty()
 {
 	Deinit();
+	EmptyTagCache();
 
 	__super::Empty();
 }
@@ -1761,9 +1763,24 @@ void CRenderedTextSubtitle::OnChanged()
 
 	m_subtitleCache.RemoveAll();
 
+	EmptyTagCache();
+
 	m_sla.Empty();
 }
 
+void CRenderedTextSubtitle::EmptyTagCache()
+{
+	POSITION pos = m_tagCache.GetStartPosition();
+	while(pos) {
+		int i;
+		CSSATags* t;
+		m_tagCache.GetNextAssoc(pos, i, t);
+		delete t;
+	}
+
+	m_tagCache.RemoveAll();
+}
+
 bool CRenderedTextSubtitle::Init(CSize size, CRect vidrect)
 {
 	Deinit();
@@ -1906,14 +1923,10 @@ void CRenderedTextSubtitle::ParsePolygon(CSubtitle* sub, CStringW str, STSStyle&
 	}
 }
 
-bool CRenderedTextSubtitle::ParseSSATag(CSubtitle* sub, CStringW str, STSStyle& style, STSStyle& org, bool fAnimate)
+// Splits the override tags of a {} block into commands and parameters. The style
+// modifiers of a \t are appended right behind it, its nAnimTags tells how many.
+static void TokenizeSSATag(CStringW str, CAtlArray<CSSATag>& tags)
 {
-	if(!sub) {
-		return(false);
-	}
-
-	int nTags = 0, nUnrecognizedTags = 0;
-
 	for(int i = 0, j; (j = str.Find('\\', i)) >= 0; i = j) {
 		CStringW cmd;
 		for(WCHAR c = str[++j]; c && c != '(' && c != '\\'; cmd += c, c = str[++j]) {
@@ -2108,11 +2121,30 @@ bool CRenderedTextSubtitle::ParseSSATag(CSubtitle* sub, CStringW str, STSStyle&
 			params.Add(cmd.Mid(1)), cmd = cmd.Left(1);
 		}
 #endif
-		else {
-			nUnrecognizedTags++;
+
+		size_t n = tags.Add();
+		tags[n].cmd = cmd;
+		tags[n].params.Copy(params);
+
+		if(cmd == L"t") { // \t([<t1>,<t2>,][<accel>,]<style modifiers>)
+			size_t nParams = params.GetCount();
+			if(nParams >= 1 && nParams <= 4) {
+				TokenizeSSATag(params[nParams-1], tags);
+			}
+			tags[n].nAnimTags = tags.GetCount() - n - 1;
 		}
+	}
+}
 
-		nTags++;
+bool CRenderedTextSubtitle::ParseSSATag(CSubtitle* sub, CSSATag* tags, size_t nTags, STSStyle& style, STSStyle& org, bool fAnimate)
+{
+	if(!sub) {
+		return(false);
+	}
+
+	for(size_t iTag = 0; iTag < nTags; iTag += 1 + tags[iTag].nAnimTags) {
+		CStringW& cmd = tags[iTag].cmd;
+		CAtlArray<CStringW>& params = tags[iTag].params;
 
 		// TODO: call ParseStyleModifier(cmd, params, ..) and move the rest there
 
@@ -2820,28 +2852,22 @@ bool CRenderedTextSubtitle::ParseSSATag(CSubtitle* sub, CStringW str, STSStyle&
 							   ? (n == 0 ? false : n == 1 ? true : org.fStrikeOut)
 								   : org.fStrikeOut;
 		} else if(cmd == L"t") { // \t([<t1>,<t2>,][<accel>,]<style modifiers>)
-			p.Empty();
-
 			m_animStart = m_animEnd = 0;
 			m_animAccel = 1;
 
-			if(params.GetCount() == 1) {
-				p = params[0];
-			} else if(params.GetCount() == 2) {
+			if(params.GetCount() == 2) {
 				m_animAccel = wcstod(params[0], NULL);
-				p = params[1];
 			} else if(params.GetCount() == 3) {
 				m_animStart = (int)wcstod(params[0], NULL);
 				m_animEnd = (int)wcstod(params[1], NULL);
-				p = params[2];
 			} else if(params.GetCount() == 4) {
 				m_animStart = wcstol(params[0], NULL, 10);
 				m_animEnd = wcstol(params[1], NULL, 10);
 				m_animAccel = wcstod(params[2], NULL);
-				p = params[3];
 			}
 
-			ParseSSATag(sub, p, style, org, true);
+			// the modifiers were tokenized behind this tag
+			ParseSSATag(sub, tags + iTag + 1, tags[iTag].nAnimTags, style, org, true);
 
 			sub->m_fAnimated = true;
 		} else if(cmd == L"u") {
@@ -2883,7 +2909,6 @@ bool CRenderedTextSubtitle::ParseSSATag(CSubtitle* sub, CStringW str, STSStyle&
 #endif
 	}
 
-	//	return(nUnrecognizedTags < nTags);
 	return(true); // there are ppl keeping coments inside {}, lets make them happy now
 }
 
@@ -3095,13 +3120,31 @@ CSubtitle* CRenderedTextSubtitle::GetSubtitle(int entry)
 #endif
 	ParseEffect(sub, GetAt(entry).effect);
 
+	// animated subtitles come here for every frame, their tags are only tokenized the first time
+	CSSATags* tags = NULL;
+	if(!m_tagCache.Lookup(entry, tags) || tags->str != str) {
+		delete tags;
+		tags = DNew CSSATags();
+		tags->str = str;
+		tags->blocks.Add(0);
+		m_tagCache[entry] = tags;
+	}
+	size_t iBlock = 0;
+
 	while(!str.IsEmpty()) {
 		bool fParsed = false;
 
 		int i;
 
 		if(str[0] == '{' && (i = str.Find(L'}')) > 0) {
-			fParsed = ParseSSATag(sub, str.Mid(1, i-1), stss, orgstss);
+			// the blocks are always met in the same order, the missing ones get appended
+			if(iBlock + 1 >= tags->blocks.GetCount()) {
+				TokenizeSSATag(str.Mid(1, i-1), tags->tags);
+				tags->blocks.Add(tags->tags.GetCount());
+			}
+			size_t first = tags->blocks[iBlock], last = tags->blocks[iBlock+1];
+			iBlock++;
+			fParsed = ParseSSATag(sub, tags->tags.GetData() + first, last - first, stss, orgstss);
 			if(fParsed) {
 				str = str.Mid(i+1);
 			}
@@ -3290,6 +3333,20 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 				pos = m_subtitleCache.GetStartPosition();
 			}
 		}
+
+		pos = m_tagCache.GetStartPosition();
+		while(pos) {
+			int key;
+			CSSATags* value;
+			m_tagCache.GetNextAssoc(pos, key, value);
+
+			STSEntry& stse = GetAt(key);
+			if(stse.end <= (t-30000) || stse.start > (t+30000)) {
+				delete value;
+				m_tagCache.RemoveKey(key);
+				pos = m_tagCache.GetStartPosition();
+			}
+		}
 	}
 
 	m_sla.AdvanceToSegment(segment, stss->subs);
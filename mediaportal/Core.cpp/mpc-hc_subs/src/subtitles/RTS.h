@@ -203,6 +203,37 @@ public:
 	void MakeLines(CSize size, CRect marginRect);
 };
 
+// One override tag of a {} block, with its parameters split off
+class CSSATag
+{
+public:
+	CStringW cmd;
+	CAtlArray<CStringW> params;
+	size_t nAnimTags; // for \t, the number of tags behind it holding its style modifiers
+
+	CSSATag() : nAnimTags(0) {}
+	CSSATag(const CSSATag& tag) {
+		*this = tag;
+	}
+	CSSATag& operator = (const CSSATag& tag) {
+		if(this != &tag) {
+			cmd = tag.cmd;
+			params.Copy(tag.params);
+			nAnimTags = tag.nAnimTags;
+		}
+		return *this;
+	}
+};
+
+// The tokenized override tags of an entry
+class CSSATags
+{
+public:
+	CStringW str; // the text they were taken from
+	CAtlArray<CSSATag> tags;
+	CAtlArray<size_t> blocks; // block i holds tags[blocks[i]] .. tags[blocks[i+1]-1]
+};
+
 class CScreenLayoutAllocator
 {
 	typedef struct {
@@ -224,6 +255,7 @@ class __declspec(uuid("537DCACA-2812-4a4f-B2C6-1A34C17ADEB0"))
 	CRenderedTextSubtitle : public CSimpleTextSubtitle, public CSubPicProviderImpl, public ISubStream
 {
 	CAtlMap<int, CSubtitle*> m_subtitleCache;
+	CAtlMap<int, CSSATags*> m_tagCache;
 
 	CScreenLayoutAllocator m_sla;
 
@@ -243,12 +275,13 @@ class __declspec(uuid("537DCACA-2812-4a4f-B2C6-1A34C17ADEB0"))
 	void ParseEffect(CSubtitle* sub, CString str);
 	void ParseString(CSubtitle* sub, CStringW str, STSStyle& style);
 	void ParsePolygon(CSubtitle* sub, CStringW str, STSStyle& style);
-	bool ParseSSATag(CSubtitle* sub, CStringW str, STSStyle& style, STSStyle& org, bool fAnimate = false);
+	bool ParseSSATag(CSubtitle* sub, CSSATag* tags, size_t nTags, STSStyle& style, STSStyle& org, bool fAnimate = false);
 	bool ParseHtmlTag(CSubtitle* sub, CStringW str, STSStyle& style, STSStyle& org);
 
 	double CalcAnimation(double dst, double src, bool fAnimate);
 
 	CSubtitle* GetSubtitle(int entry);
+	void EmptyTagCache();
 
 protected:
 	virtual void OnChanged();
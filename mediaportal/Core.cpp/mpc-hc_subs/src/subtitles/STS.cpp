@@ -27,6 +27,8 @@
 
 #include "RealTextParser.h"
 #include <fstream>
+#include <algorithm>
+#include <process.h>
 
 // gathered from http://www.netwave.or.jp/~shikai/shikai/shcolor.htm
 
@@ -1467,7 +1469,138 @@ bool CSimpleTextSubtitle::LoadUUEFile(CTextFile* file, CString m_fn)
 }
 #endif
 
-static bool OpenSubStationAlpha(CTextFile* file, CSimpleTextSubtitle& ret, int CharSet)
+// A "Dialogue:" line of an ssa/ass script, read serially and parsed in parallel
+struct SSADialogue
+{
+	CStringW buff;		// the line after "Dialogue:", the text of the entry once parsed
+	int version;
+	ULONGLONG pos;		// file position after the line
+	bool fValid;
+	int start, end, layer;
+	CString Style, Actor, Effect;
+	CRect marginRect;
+};
+
+static void ParseSSADialogue(SSADialogue& d)
+{
+	d.fValid = false;
+
+	try {
+		CStringW& buff = d.buff;
+		int version = d.version;
+		int hh1, mm1, ss1, ms1_div10, hh2, mm2, ss2, ms2_div10;
+		CString& Style = d.Style;
+		CString& Actor = d.Actor;
+		CString& Effect = d.Effect;
+		CRect& marginRect = d.marginRect;
+
+		d.layer = 0;
+
+		if(version <= 4) {
+			GetStr(buff, '=');		/* Marked = */
+			GetInt(buff);
+		}
+		if(version >= 5) {
+			d.layer = GetInt(buff);
+		}
+		hh1 = GetInt(buff, ':');
+		mm1 = GetInt(buff, ':');
+		ss1 = GetInt(buff, '.');
+		ms1_div10 = GetInt(buff);
+		hh2 = GetInt(buff, ':');
+		mm2 = GetInt(buff, ':');
+		ss2 = GetInt(buff, '.');
+		ms2_div10 = GetInt(buff);
+		Style = WToT(GetStr(buff));
+		Actor = WToT(GetStr(buff));
+		marginRect.left = GetInt(buff);
+		marginRect.right = GetInt(buff);
+		marginRect.top = marginRect.bottom = GetInt(buff);
+		if(version >= 6) {
+			marginRect.bottom = GetInt(buff);
+		}
+		Effect = WToT(GetStr(buff));
+
+		int len = min(Effect.GetLength(), buff.GetLength());
+		if(Effect.Left(len) == WToT(buff.Left(len))) {
+			Effect.Empty();
+		}
+
+		Style.TrimLeft('*');
+		if(!Style.CompareNoCase(_T("Default"))) {
+			Style = _T("Default");
+		}
+
+		d.start = (((hh1*60 + mm1)*60) + ss1)*1000 + ms1_div10*10;
+		d.end = (((hh2*60 + mm2)*60) + ss2)*1000 + ms2_div10*10;
+		d.fValid = true;
+	} catch(...) {
+	}
+}
+
+struct SSAParseJob {
+	SSADialogue* dialogues;
+	size_t count;
+};
+
+static unsigned __stdcall SSAParseThread(void* param)
+{
+	SSAParseJob* job = (SSAParseJob*)param;
+	for(size_t i = 0; i < job->count; i++) {
+		ParseSSADialogue(job->dialogues[i]);
+	}
+	return 0;
+}
+
+#define SSA_MAX_PARSE_THREADS 8
+#define SSA_LINES_PER_THREAD 1000
+
+static void ParseSSADialogues(CAtlArray<SSADialogue>& dialogues)
+{
+	size_t count = dialogues.GetCount();
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	size_t nThreads = min((size_t)si.dwNumberOfProcessors, (size_t)SSA_MAX_PARSE_THREADS);
+	nThreads = min(nThreads, count / SSA_LINES_PER_THREAD);	// small scripts are not worth a thread
+
+	SSAParseJob jobs[SSA_MAX_PARSE_THREADS];
+	HANDLE threads[SSA_MAX_PARSE_THREADS];
+	size_t nStarted = 0;
+
+	if(nThreads <= 1) {
+		jobs[0].dialogues = dialogues.GetData();
+		jobs[0].count = count;
+		SSAParseThread(&jobs[0]);
+		return;
+	}
+
+	size_t chunk = (count + nThreads - 1) / nThreads;
+	for(size_t i = 0; i < nThreads; i++) {
+		jobs[i].dialogues = dialogues.GetData() + i*chunk;
+		jobs[i].count = min(chunk, count - i*chunk);
+	}
+
+	// the first chunk is parsed on this thread, also the fallback if a thread can't be started
+	for(size_t i = 1; i < nThreads; i++) {
+		HANDLE h = (HANDLE)_beginthreadex(NULL, 0, SSAParseThread, &jobs[i], 0, NULL);
+		if(h) {
+			threads[nStarted++] = h;
+		} else {
+			SSAParseThread(&jobs[i]);
+		}
+	}
+	SSAParseThread(&jobs[0]);
+
+	if(nStarted > 0) {
+		WaitForMultipleObjects((DWORD)nStarted, threads, TRUE, INFINITE);
+	}
+	for(size_t i = 0; i < nStarted; i++) {
+		CloseHandle(threads[i]);
+	}
+}
+
+static bool ReadSubStationAlpha(CTextFile* file, CSimpleTextSubtitle& ret, int CharSet, CAtlArray<SSADialogue>& dialogues)
 {
 	bool fRet = false;
 
@@ -1652,56 +1785,10 @@ static bool OpenSubStationAlpha(CTextFile* file, CSimpleTextSubtitle& ret, int C
 		} else if(entry == L"[events]") {
 			fRet = true;
 		} else if(entry == _T("dialogue")) {
-			try {
-				int hh1, mm1, ss1, ms1_div10, hh2, mm2, ss2, ms2_div10, layer = 0;
-				CString Style, Actor, Effect;
-				CRect marginRect;
-
-				if(version <= 4) {
-					GetStr(buff, '=');		/* Marked = */
-					GetInt(buff);
-				}
-				if(version >= 5) {
-					layer = GetInt(buff);
-				}
-				hh1 = GetInt(buff, ':');
-				mm1 = GetInt(buff, ':');
-				ss1 = GetInt(buff, '.');
-				ms1_div10 = GetInt(buff);
-				hh2 = GetInt(buff, ':');
-				mm2 = GetInt(buff, ':');
-				ss2 = GetInt(buff, '.');
-				ms2_div10 = GetInt(buff);
-				Style = WToT(GetStr(buff));
-				Actor = WToT(GetStr(buff));
-				marginRect.left = GetInt(buff);
-				marginRect.right = GetInt(buff);
-				marginRect.top = marginRect.bottom = GetInt(buff);
-				if(version >= 6) {
-					marginRect.bottom = GetInt(buff);
-				}
-				Effect = WToT(GetStr(buff));
-
-				int len = min(Effect.GetLength(), buff.GetLength());
-				if(Effect.Left(len) == WToT(buff.Left(len))) {
-					Effect.Empty();
-				}
-
-				Style.TrimLeft('*');
-				if(!Style.CompareNoCase(_T("Default"))) {
-					Style = _T("Default");
-				}
-
-				ret.Add(buff,
-						file->IsUnicode(),
-						(((hh1*60 + mm1)*60) + ss1)*1000 + ms1_div10*10,
-						(((hh2*60 + mm2)*60) + ss2)*1000 + ms2_div10*10,
-						Style, Actor, Effect,
-						marginRect,
-						layer);
-			} catch(...) {
-				return(false);
-			}
+			SSADialogue& d = dialogues[dialogues.Add()];
+			d.buff = buff;
+			d.version = version;
+			d.pos = file->GetPosition();
 		} else if(entry == L"fontname") {
 			LoadUUEFont(file);
 		}
@@ -1715,6 +1802,34 @@ static bool OpenSubStationAlpha(CTextFile* file, CSimpleTextSubtitle& ret, int C
 	return(fRet);
 }
 
+static bool OpenSubStationAlpha(CTextFile* file, CSimpleTextSubtitle& ret, int CharSet)
+{
+	CAtlArray<SSADialogue> dialogues;
+
+	bool fRet = ReadSubStationAlpha(file, ret, CharSet, dialogues);
+
+	ParseSSADialogues(dialogues);
+
+	for(size_t i = 0; i < dialogues.GetCount(); i++) {
+		SSADialogue& d = dialogues[i];
+		if(!d.fValid) {
+			// stop where reading line by line would have, Open() reports the line number
+			file->Seek(d.pos, 0);
+			return(false);
+		}
+
+		ret.Add(d.buff,
+				file->IsUnicode(),
+				d.start,
+				d.end,
+				d.Style, d.Actor, d.Effect,
+				d.marginRect,
+				d.layer);
+	}
+
+	return(fRet);
+}
+
 static bool OpenXombieSub(CTextFile* file, CSimpleTextSubtitle& ret, int CharSet)
 {
 	float version = 0;
@@ -1970,6 +2085,9 @@ CSimpleTextSubtitle::CSimpleTextSubtitle()
 	m_lcid = 0;
 	m_ePARCompensationType = EPCTDisabled;
 	m_dPARCompensation = 1.0;
+	m_fDeferSegments = false;
+	m_iLastSegment = -1;
+	m_iLastSub = -1;
 
 #ifdef _VSMOD // indexing
 	ind_size = 0;
@@ -2084,6 +2202,8 @@ void CSimpleTextSubtitle::Empty()
 	m_dstScreenSize = CSize(0, 0);
 	m_styles.Free();
 	m_segments.RemoveAll();
+	m_iLastSegment = -1;
+	m_iLastSub = -1;
 	RemoveAll();
 
 #ifdef _VSMOD // indexing
@@ -2122,6 +2242,10 @@ void CSimpleTextSubtitle::Add(CStringW str, bool fUnicode, int start, int end, C
 	int n = __super::Add(sub);
 
 #ifndef _VSMOD
+	if(m_fDeferSegments) {
+		return;
+	}
+
 	int len = m_segments.GetCount();
 
 	if(len == 0) {
@@ -2380,38 +2504,38 @@ void CSimpleTextSubtitle::ConvertToFrameBased(double fps)
 
 int CSimpleTextSubtitle::SearchSub(int t, double fps)
 {
-	int i = 0, j = GetCount() - 1, ret = -1;
+	// the entries are sorted by start: the first one starting at t, else the last one starting before it
+	int n = GetCount();
+
+	if(n > 0 && t >= TranslateStart(n-1, fps)) {
+		return(n-1);
+	}
 
-	if(j >= 0 && t >= TranslateStart(j, fps)) {
-		return(j);
+	// the entry found last time and the one after it, what sequential playback asks for
+	for(int k = max(m_iLastSub, 0); k <= m_iLastSub + 1 && k < n-1; k++) {
+		int start = TranslateStart(k, fps);
+		if(start <= t && t < TranslateStart(k+1, fps)
+				&& (start < t || k == 0 || TranslateStart(k-1, fps) < t)) {
+			m_iLastSub = k;
+			return(k);
+		}
 	}
 
+	// the first entry starting at or after t
+	int i = 0, j = n;
 	while(i < j) {
 		int mid = (i + j) >> 1;
-
-		int midt = TranslateStart(mid, fps);
-
-		if(t == midt) {
-			while(mid > 0 && t == TranslateStart(mid-1, fps)) {
-				mid--;
-			}
-			ret = mid;
-			break;
-		} else if(t < midt) {
-			ret = -1;
-			if(j == mid) {
-				mid--;
-			}
+		if(TranslateStart(mid, fps) < t) {
+			i = mid + 1;
+		} else {
 			j = mid;
-		} else if(t > midt) {
-			ret = mid;
-			if(i == mid) {
-				mid++;
-			}
-			i = mid;
 		}
 	}
 
+	int ret = i < n && TranslateStart(i, fps) == t ? i : i - 1;
+	if(ret >= 0) {
+		m_iLastSub = ret;
+	}
 	return(ret);
 }
 
@@ -2447,6 +2571,17 @@ const STSSegment* CSimpleTextSubtitle::SearchSubs(int t, double fps, /*[out]*/ i
 		return(NULL);
 	}
 
+	// the segments don't overlap, a segment containing t is what the search below would find
+	for(int k = max(m_iLastSegment, 0); k <= m_iLastSegment + 1 && k < j; k++) {
+		if(TranslateSegmentStart(k, fps) <= t && t < TranslateSegmentEnd(k, fps)) {
+			m_iLastSegment = k;
+			if(iSegment) {
+				*iSegment = k;
+			}
+			return(m_segments[k].subs.GetCount() > 0 ? &m_segments[k] : NULL);
+		}
+	}
+
 #ifdef _VSMOD
 	// find bounds
 	// is this nya?
@@ -2489,6 +2624,7 @@ const STSSegment* CSimpleTextSubtitle::SearchSubs(int t, double fps, /*[out]*/ i
 		if(iSegment) {
 			*iSegment = ret;
 		}
+		m_iLastSegment = ret;
 	}
 
 	if(0 <= ret && ret < m_segments.GetCount()
@@ -2701,35 +2837,71 @@ static int intcomp(const void* i1, const void* i2)
 void CSimpleTextSubtitle::CreateSegments()
 {
 	m_segments.RemoveAll();
+	m_iLastSegment = -1;
+	m_iLastSub = -1;
 
-	int i, j;
+	size_t i, n = GetCount();
 
 	CAtlArray<int> breakpoints;
+	breakpoints.SetCount(n*2);
 
-	for(i = 0; i < GetCount(); i++) {
+	for(i = 0; i < n; i++) {
 		STSEntry& stse = GetAt(i);
-		breakpoints.Add(stse.start);
-		breakpoints.Add(stse.end);
+		breakpoints[i*2] = stse.start;
+		breakpoints[i*2+1] = stse.end;
 	}
 
 	qsort(breakpoints.GetData(), breakpoints.GetCount(), sizeof(int), intcomp);
 
-	int* ptr = breakpoints.GetData(), prev = ptr ? *ptr : NULL;
-
-	for(i = breakpoints.GetCount(); i > 0; i--, ptr++) {
-		if(*ptr != prev) {
-			m_segments.Add(STSSegment(prev, *ptr));
-			prev = *ptr;
+	// the distinct breakpoints, segment k goes from points[k] to points[k+1]
+	size_t nPoints = 0;
+	for(i = 0; i < breakpoints.GetCount(); i++) {
+		if(nPoints == 0 || breakpoints[i] != breakpoints[nPoints-1]) {
+			breakpoints[nPoints++] = breakpoints[i];
 		}
 	}
+	int* points = breakpoints.GetData();
+
+	if(nPoints < 2) {
+		OnChanged();
+		return;
+	}
+
+	size_t nSegments = nPoints - 1;
+	m_segments.SetCount(nSegments);
+
+	// an entry covers the segments from the index of its start to the index of its end,
+	// count them per segment first so every subs array is allocated once
+	CAtlArray<int> first, last, count;
+	first.SetCount(n);
+	last.SetCount(n);
+	count.SetCount(nSegments + 1);
+	memset(count.GetData(), 0, (nSegments + 1) * sizeof(int));
 
-	for(i = 0; i < GetCount(); i++) {
+	for(i = 0; i < n; i++) {
 		STSEntry& stse = GetAt(i);
-		for(j = 0; j < m_segments.GetCount() && m_segments[j].start < stse.start; j++) {
-			;
+		first[i] = (int)(std::lower_bound(points, points + nPoints, stse.start) - points);
+		last[i] = (int)(std::lower_bound(points, points + nPoints, stse.end) - points);
+		if(first[i] < last[i]) {
+			count[first[i]]++;
+			count[last[i]]--;
 		}
-		for(; j < m_segments.GetCount() && m_segments[j].end <= stse.end; j++) {
-			m_segments[j].subs.Add(i);
+	}
+
+	int covering = 0;
+	for(i = 0; i < nSegments; i++) {
+		STSSegment& stss = m_segments[i];
+		stss.start = points[i];
+		stss.end = points[i+1];
+		covering += count[i];
+		stss.subs.SetCount(covering);
+		count[i] = 0;	// reused as the fill position
+	}
+
+	// in entry order, like the entries were added one by one
+	for(i = 0; i < n; i++) {
+		for(int k = first[i]; k < last[i]; k++) {
+			m_segments[k].subs[count[k]++] = (int)i;
 		}
 	}
 
@@ -2791,6 +2963,9 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 
 	ULONGLONG pos = f->GetPosition();
 
+	// the segments are built once the whole script is read
+	m_fDeferSegments = true;
+
 	for(ptrdiff_t i = 0; i < nOpenFuncts; i++) {
 		if(!OpenFuncts[i].open(f, *this, CharSet) /*|| !GetCount()*/) {
 			if(GetCount() > 0) {
@@ -2814,6 +2989,7 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 		m_path = f->GetFilePath();
 
 		//		Sort();
+		m_fDeferSegments = false;
 		CreateSegments();
 #ifdef _VSMOD // indexing
 		MakeIndex(0);
@@ -2834,6 +3010,8 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 		return(true);
 	}
 
+	m_fDeferSegments = false;
+
 	return(false);
 }
 
@@ -259,6 +259,9 @@ class CSimpleTextSubtitle : public CAtlArray<STSEntry>
 
 protected:
 	CAtlArray<STSSegment> m_segments;
+	bool m_fDeferSegments;	// set while Open() reads a script, it builds the segments once at the end
+	int m_iLastSegment;		// where SearchSubs() found the last time, playback mostly asks for the same or the next one
+	int m_iLastSub;			// the same for SearchSub()
 	virtual void OnChanged() {}
 
 public:
@@ -24,6 +24,61 @@
 #include "stdafx.h"
 #include "VobSubImage.h"
 
+// number of nibbles of a run code, indexed by its leading byte
+static const struct CVobSubCodeLength {
+	BYTE len[256];
+	CVobSubCodeLength() {
+		for(int i = 0; i < 256; i++) {
+			len[i] = i >= 0x40 ? 1 : i >= 0x10 ? 2 : i >= 0x04 ? 3 : 4;
+		}
+	}
+} s_codelen;
+
+// msb first bit reader, refilled 64 bits at a time, reads as zero past the end of the buffer
+class CVobSubBitReader
+{
+	const BYTE* m_ptr;
+	const BYTE* m_end;
+	unsigned __int64 m_bits;
+	int m_avail, m_pos;
+
+public:
+	CVobSubBitReader(const BYTE* ptr, const BYTE* end)
+		: m_ptr(ptr), m_end(end), m_bits(0), m_avail(0), m_pos(0) {
+	}
+
+	void Refill() {
+		if(m_end - m_ptr >= 8) {
+			m_bits |= _byteswap_uint64(*(unsigned __int64*)m_ptr) >> m_avail;
+			int n = (63 - m_avail) >> 3;
+			m_ptr += n;
+			m_avail += n << 3;
+		} else {
+			while(m_avail <= 56 && m_ptr < m_end) {
+				m_bits |= (unsigned __int64)*m_ptr++ << (56 - m_avail);
+				m_avail += 8;
+			}
+		}
+	}
+
+	DWORD Peek16() {
+		if(m_avail < 16) {
+			Refill();
+		}
+		return (DWORD)(m_bits >> 48);
+	}
+
+	void Skip(int n) {
+		m_bits <<= n;
+		m_avail = max(m_avail - n, 0);
+		m_pos += n;
+	}
+
+	int GetPos() const {
+		return m_pos;
+	}
+};
+
 CVobSubImage::CVobSubImage()
 {
 	iLang = iIdx = -1;
@@ -31,6 +86,7 @@ CVobSubImage::CVobSubImage()
 	start = delay = 0;
 	rect = CRect(0,0,0,0);
 	lpPixels = lpTemp1 = lpTemp2 = NULL;
+	lpIndex = lpIdxTemp1 = lpIdxTemp2 = NULL;
 	org = CSize(0,0);
 }
 
@@ -49,14 +105,11 @@ bool CVobSubImage::Alloc(int w, int h)
 		Free();
 
 		lpTemp1 = DNew RGBQUAD[w*h];
-		if(!lpTemp1) {
-			return(false);
-		}
-
 		lpTemp2 = DNew RGBQUAD[(w+2)*(h+2)];
-		if(!lpTemp2) {
-			delete [] lpTemp1;
-			lpTemp1 = NULL;
+		lpIdxTemp1 = DNew BYTE[w*h];
+		lpIdxTemp2 = DNew BYTE[(w+2)*(h+2)];
+		if(!lpTemp1 || !lpTemp2 || !lpIdxTemp1 || !lpIdxTemp2) {
+			Free();
 			return(false);
 		}
 
@@ -65,6 +118,7 @@ bool CVobSubImage::Alloc(int w, int h)
 	}
 
 	lpPixels = lpTemp1;
+	lpIndex = lpIdxTemp1;
 
 	return(true);
 }
@@ -81,7 +135,18 @@ void CVobSubImage::Free()
 	}
 	lpTemp2 = NULL;
 
+	if(lpIdxTemp1) {
+		delete [] lpIdxTemp1;
+	}
+	lpIdxTemp1 = NULL;
+
+	if(lpIdxTemp2) {
+		delete [] lpIdxTemp2;
+	}
+	lpIdxTemp2 = NULL;
+
 	lpPixels = NULL;
+	lpIndex = NULL;
 }
 
 bool CVobSubImage::Decode(BYTE* lpData, int packetsize, int datasize,
@@ -96,46 +161,38 @@ bool CVobSubImage::Decode(BYTE* lpData, int packetsize, int datasize,
 		return(false);
 	}
 
-	lpPixels = lpTemp1;
-
-	nPlane = 0;
-	fAligned = 1;
-
 	this->fCustomPal = fCustomPal;
 	this->orgpal = orgpal;
 	this->tridx = tridx;
 	this->cuspal = cuspal;
 
-	CPoint p(rect.left, rect.top);
+	SetupPalette();
 
-	int end0 = nOffset[1];
-	int end1 = datasize;
+	int w = rect.Width(), h = rect.Height();
 
-	while((nPlane == 0 && nOffset[0] < end0) || (nPlane == 1 && nOffset[1] < end1)) {
-		DWORD code;
+	// the two fields are stored separately, even lines first
+	int offset[2] = {nOffset[0], nOffset[1]};
+	int end[2] = {nOffset[1], datasize};
 
-		if((code = GetNibble(lpData)) >= 0x4
-				|| (code = (code << 4) | GetNibble(lpData)) >= 0x10
-				|| (code = (code << 4) | GetNibble(lpData)) >= 0x40
-				|| (code = (code << 4) | GetNibble(lpData)) >= 0x100) {
-			DrawPixels(p, code >> 2, code & 3);
-			if((p.x += code >> 2) < rect.right) {
-				continue;
-			}
-		}
+	int y = 0;
 
-		DrawPixels(p, rect.right - p.x, code & 3);
+	for(; y < h; y++) {
+		int field = y & 1;
 
-		if(!fAligned) {
-			GetNibble(lpData);    // align to byte
+		BYTE* idx = &lpIndex[w*y];
+
+		if(!DecodeLine(lpData, datasize, end[field], offset[field], idx, w)) {
+			break;
 		}
 
-		p.x = rect.left;
-		p.y++;
-		nPlane = 1 - nPlane;
+		RGBQUAD* dst = &lpPixels[w*y];
+
+		for(ptrdiff_t x = 0; x < w; x++) {
+			dst[x] = rgbpal[idx[x]];
+		}
 	}
 
-	rect.bottom = min(p.y, rect.bottom);
+	rect.bottom = rect.top + y;
 
 	if(fTrim) {
 		TrimSubImage();
@@ -144,6 +201,55 @@ bool CVobSubImage::Decode(BYTE* lpData, int packetsize, int datasize,
 	return(true);
 }
 
+void CVobSubImage::SetupPalette()
+{
+	for(int i = 0; i < 4; i++) {
+		if(!fCustomPal) {
+			rgbpal[i] = orgpal[pal[i].pal];
+			rgbpal[i].rgbReserved = (pal[i].tr<<4)|pal[i].tr;
+		} else {
+			rgbpal[i] = cuspal[i];
+		}
+	}
+
+	memset(&rgbpal[4], 0, sizeof(RGBQUAD));
+}
+
+// Decodes one run length encoded line of color ids into dst and leaves offset at
+// the byte aligned start of the next line of the same field. Returns false if the
+// field ended before the line was complete.
+bool CVobSubImage::DecodeLine(const BYTE* lpData, int datasize, int end, int& offset, BYTE* dst, int w)
+{
+	if(offset >= end || offset >= datasize) {
+		return(false);
+	}
+
+	CVobSubBitReader br(&lpData[offset], &lpData[datasize]);
+
+	for(int x = 0; x < w; ) {
+		if(offset + (br.GetPos() >> 3) >= end) {
+			return(false);
+		}
+
+		DWORD code = br.Peek16();
+		int n = s_codelen.len[code >> 8];
+		code >>= 16 - (n << 2);
+		br.Skip(n << 2);
+
+		int length = code >> 2;
+		if((n == 4 && code < 0x100) || length > w - x) {
+			length = w - x;    // fill until the end of the line
+		}
+
+		memset(&dst[x], code & 3, length);
+		x += length;
+	}
+
+	offset += (br.GetPos() + 7) >> 3;
+
+	return(true);
+}
+
 void CVobSubImage::GetPacketInfo(BYTE* lpData, int packetsize, int datasize)
 {
 	//	delay = 0;
@@ -249,48 +355,6 @@ void CVobSubImage::GetPacketInfo(BYTE* lpData, int packetsize, int datasize)
 	}
 }
 
-BYTE CVobSubImage::GetNibble(BYTE* lpData)
-{
-	WORD& off = nOffset[nPlane];
-	BYTE ret = (lpData[off] >> (fAligned << 2)) & 0x0f;
-	fAligned = !fAligned;
-	off += fAligned;
-	return(ret);
-}
-
-void CVobSubImage::DrawPixels(CPoint p, int length, int colorid)
-{
-	if(length <= 0
-			|| p.x + length < rect.left
-			|| p.x >= rect.right
-			|| p.y < rect.top
-			|| p.y >= rect.bottom) {
-		return;
-	}
-
-	if(p.x < rect.left) {
-		p.x = rect.left;
-	}
-	if(p.x + length >= rect.right) {
-		length = rect.right - p.x;
-	}
-
-	RGBQUAD* ptr = &lpPixels[rect.Width() * (p.y - rect.top) + (p.x - rect.left)];
-
-	RGBQUAD c;
-
-	if(!fCustomPal) {
-		c = orgpal[pal[colorid].pal];
-		c.rgbReserved = (pal[colorid].tr<<4)|pal[colorid].tr;
-	} else {
-		c = cuspal[colorid];
-	}
-
-	while(length-- > 0) {
-		*ptr++ = c;
-	}
-}
-
 void CVobSubImage::TrimSubImage()
 {
 	CRect r;
@@ -299,11 +363,11 @@ void CVobSubImage::TrimSubImage()
 	r.right = 0;
 	r.bottom = 0;
 
-	RGBQUAD* ptr = lpTemp1;
+	BYTE* ptr = lpIdxTemp1;
 
 	for(ptrdiff_t j = 0, y = rect.Height(); j < y; j++) {
 		for(ptrdiff_t i = 0, x = rect.Width(); i < x; i++, ptr++) {
-			if(ptr->rgbReserved) {
+			if(rgbpal[*ptr].rgbReserved) {
 				if(r.top > j) {
 					r.top = j;
 				}
@@ -336,19 +400,29 @@ void CVobSubImage::TrimSubImage()
 
 	DWORD* src = (DWORD*)&lpTemp1[offset];
 	DWORD* dst = (DWORD*)&lpTemp2[1 + w + 1];
+	BYTE* isrc = &lpIdxTemp1[offset];
+	BYTE* idst = &lpIdxTemp2[1 + w + 1];
 
 	memset(lpTemp2, 0, (1 + w + 1)*sizeof(RGBQUAD));
+	memset(lpIdxTemp2, 4, 1 + w + 1);
 
-	for(ptrdiff_t height = h; height; height--, src += rect.Width()) {
+	for(ptrdiff_t height = h; height; height--, src += rect.Width(), isrc += rect.Width()) {
 		*dst++ = 0;
 		memcpy(dst, src, w*sizeof(RGBQUAD));
 		dst += w;
 		*dst++ = 0;
+
+		*idst++ = 4;
+		memcpy(idst, isrc, w);
+		idst += w;
+		*idst++ = 4;
 	}
 
 	memset(dst, 0, (1 + w + 1)*sizeof(RGBQUAD));
+	memset(idst, 4, 1 + w + 1);
 
 	lpPixels = lpTemp2;
+	lpIndex = lpIdxTemp2;
 
 	rect = r + rect.TopLeft();
 }
@@ -378,10 +452,24 @@ CAutoPtrList<COutline>* CVobSubImage::GetOutlineList(CPoint& topleft)
 	}
 
 	BYTE* cp = p;
-	RGBQUAD* rgbp = (RGBQUAD*)lpPixels;
 
-	for(ptrdiff_t i = 0; i < len; i++, cp++, rgbp++) {
-		*cp = !!rgbp->rgbReserved;
+	if(lpIndex) {
+		BYTE opaque[5];
+		for(ptrdiff_t i = 0; i < 5; i++) {
+			opaque[i] = !!rgbpal[i].rgbReserved;
+		}
+
+		BYTE* idx = lpIndex;
+
+		for(ptrdiff_t i = 0; i < len; i++, cp++, idx++) {
+			*cp = opaque[*idx];
+		}
+	} else {
+		RGBQUAD* rgbp = (RGBQUAD*)lpPixels;
+
+		for(ptrdiff_t i = 0; i < len; i++, cp++, rgbp++) {
+			*cp = !!rgbp->rgbReserved;
+		}
 	}
 
 	enum {UP, RIGHT, DOWN, LEFT};
@@ -1279,47 +1367,3 @@ bool CVobSubImage::Polygonize(CStringW& assstr, bool fSmooth, int scale)
 
 	return nPoints > 0;
 }
-
-void CVobSubImage::Scale2x()
-{
-	int w = rect.Width(), h = rect.Height();
-
-	DWORD* src = (DWORD*)lpPixels;
-	DWORD* dst = DNew DWORD[w*h];
-
-	for(ptrdiff_t y = 0; y < h; y++) {
-		for(ptrdiff_t x = 0; x < w; x++, src++, dst++) {
-			DWORD E = *src;
-
-			DWORD A = x > 0 && y > 0 ? src[-w-1] : E;
-			DWORD B = y > 0 ? src[-w] : E;
-			DWORD C = x < w-1 && y > 0 ? src[-w+1] : E;
-			UNUSED_ALWAYS(A);
-			UNUSED_ALWAYS(C);
-
-			DWORD D = x > 0 ? src[-1] : E;;
-			DWORD F = x < w-1 ? src[+1] : E;;
-
-			DWORD G = x > 0 && y < h-1 ? src[+w-1] : E;
-			DWORD H = y < h-1 ? src[+w] : E;
-			DWORD I = x < w-1 && y < h-1 ? src[+w+1] : E;
-			UNUSED_ALWAYS(G);
-			UNUSED_ALWAYS(I);
-
-			DWORD E0 = D == B && B != F && D != H ? D : E;
-			DWORD E1 = B == F && B != D && F != H ? F : E;
-			DWORD E2 = D == H && D != B && H != F ? D : E;
-			DWORD E3 = H == F && D != H && B != F ? F : E;
-
-			*dst = ((((E0&0x00ff00ff)+(E1&0x00ff00ff)+(E2&0x00ff00ff)+(E3&0x00ff00ff)+2)>>2)&0x00ff00ff)
-				   | (((((E0>>8)&0x00ff00ff)+((E1>>8)&0x00ff00ff)+((E2>>8)&0x00ff00ff)+((E3>>8)&0x00ff00ff)+2)<<6)&0xff00ff00);
-		}
-	}
-
-	src -= w*h;
-	dst -= w*h;
-
-	memcpy(src, dst, w*h*4);
-
-	delete [] dst;
-}
@@ -47,17 +47,22 @@ private:
 	RGBQUAD* lpTemp1;
 	RGBQUAD* lpTemp2;
 
-	WORD nOffset[2], nPlane;
+	// palette index planes, parallel to lpTemp1/lpTemp2 (0-3: color id, 4: outside of the image)
+	BYTE* lpIdxTemp1;
+	BYTE* lpIdxTemp2;
+	BYTE* lpIndex;
+
+	WORD nOffset[2];
 	bool fCustomPal;
-	char fAligned; // we are also using this for calculations, that's why it is char instead of bool...
 	int tridx;
 	RGBQUAD* orgpal /*[16]*/,* cuspal /*[4]*/;
+	RGBQUAD rgbpal[5];
 
 	bool Alloc(int w, int h);
 	void Free();
 
-	BYTE GetNibble(BYTE* lpData);
-	void DrawPixels(CPoint p, int length, int colorid);
+	void SetupPalette();
+	bool DecodeLine(const BYTE* lpData, int datasize, int end, int& offset, BYTE* dst, int w);
 	void TrimSubImage();
 
 public:
@@ -96,6 +101,4 @@ private:
 public:
 	bool Polygonize(CAtlArray<BYTE>& pathTypes, CAtlArray<CPoint>& pathPoints, bool fSmooth, int scale);
 	bool Polygonize(CStringW& assstr, bool fSmooth = true, int scale = 3);
-
-	void Scale2x();
 };
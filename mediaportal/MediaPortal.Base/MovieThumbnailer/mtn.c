@@ -56,6 +56,9 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
@@ -69,6 +72,7 @@
 unsigned int _CRT_fmode = _O_BINARY;  // default binary file including stdin, stdout, stderr
 #include <tchar.h>
 #include <windows.h>
+#include <process.h>
 #ifdef _UNICODE
 #define UTF8_2_WC(wdst, src, size) MultiByteToWideChar(CP_UTF8, 0, (src), -1, (wdst), (size))
 #define WC_2_UTF8(dst, wsrc, size) WideCharToMultiByte(CP_UTF8, 0, (wsrc), -1, (dst), (size), NULL, NULL)
@@ -78,6 +82,7 @@ unsigned int _CRT_fmode = _O_BINARY;  // default binary file including stdin, st
 #endif
 #else
 #include "fake_tchar.h"
+#include <pthread.h>
 #define UTF8_2_WC(dst, src, size) ((dst) = (src)) // cant be used to check required size
 #define WC_2_UTF8(dst, src, size) ((dst) = (src))
 #endif
@@ -114,12 +119,17 @@ typedef struct shot
     float edge[EDGE_PARTS]; // edge detection
 } shot; // shot
 
+#define INFO_SIZE 4096 // max. length of the info text
+
 typedef struct thumbnail
 {
     gdImagePtr out_ip;
     char out_filename[UTF8_FILENAME_SIZE];
     char info_filename[UTF8_FILENAME_SIZE];
     int out_saved; // 1 = out file is successfully saved
+    int out_claimed; // 1 = out & info file names are claimed; see file_claim
+    int nb_file; // # of this file in this run
+    char info[INFO_SIZE]; // info text at the top
     int width, height;
     int txt_height;
     int column, row;
@@ -132,6 +142,15 @@ typedef struct thumbnail
     int64_t *ppts; // array of pts value of each shot
 } thumbnail; // thumbnail data & info
 
+typedef struct decode_state
+{
+    int run; // # of times read_and_decode has been called for a file
+    double avg_decoded_frame; // average # of decoded frame
+    int skip_non_key; // 1 = skip non key packets when looking for a key frame
+    int decoded_frame; // # of decoded frames in the last read_and_decode
+    uint64_t video_pkt_pts; // pts of the last packet; copied to AVFrame.opaque
+} decode_state; // per decoder state of read_and_decode
+
 /* LIBAVUTIL_VERSION_INT is too low for VERBOSE & INFO, so we'll define our own */
 #define LOG_INFO 0
 
@@ -176,6 +195,10 @@ rgb_color gb_k_bcolor = GB_K_BCOLOR; // background color
 int gb_L_info_location = GB_L_INFO_LOCATION;
 #define GB_L_TIME_LOCATION 1
 int gb_L_time_location = GB_L_TIME_LOCATION;
+#define GB_J_FILE 1
+int gb_J_file = GB_J_FILE; // # of files thumbnailed at the same time; 1 = off
+#define GB_M_WORKER 1
+int gb_m_worker = GB_M_WORKER; // # of threads decoding shots in seek mode; 1 = off
 #define GB_N_NORMAL 0
 int gb_n_normal = GB_N_NORMAL; // normal priority; 1 normal; 0 lower
 #define GB_N_SUFFIX NULL
@@ -194,6 +217,8 @@ int gb_p_pause = GB_P_PAUSE; // pause before exiting; 1 pause; 0 dont pause
 int gb_P_dontpause = GB_P_DONTPAUSE; // dont pause; overide gb_p_pause
 #define GB_Q_QUIET 0
 int gb_q_quiet = GB_Q_QUIET; // 1 on; 0 off
+#define GB_Q_SPOOL NULL
+char *gb_Q_spool = GB_Q_SPOOL; // spool directory of batch mode
 #define GB_R_ROW 0
 int gb_r_row = GB_R_ROW; // 0 = as many rows as needed
 #define GB_S_STEP 120
@@ -209,6 +234,8 @@ int gb_V = GB_V_VERBOSE; // 1 on; 0 off
 int gb_w_width = GB_W_WIDTH; // 0 = column * movie width
 #define GB_W_OVERWRITE 1
 int gb_W_overwrite = GB_W_OVERWRITE; // 1 = overwrite; 0 = dont overwrite
+#define GB_X_INDEX NULL
+char *gb_X_index = GB_X_INDEX; // index of thumbnailed files; skip unchanged files
 #define GB_Z_SEEK 0
 int gb_z_seek = GB_Z_SEEK; // always use seek mode; 1 on; 0 off
 #define GB_Z_NONSEEK 0
@@ -218,6 +245,63 @@ int gb_Z_nonseek = GB_Z_NONSEEK; // always use non-seek mode; 1 on; 0 off
 char *gb_argv0 = NULL;
 char *gb_version = "200808a copyright (c) 2007-2008 tuit, et al.";
 time_t gb_st_start = 0; // start time of program
+int gb_nb_file = 0; // # of files started; under file_lock
+
+/* locks for the worker threads (-m & -J options)
+codec_lock: avcodec_open, avcodec_close & av_find_stream_info (which opens decoders)
+aren't thread safe.
+file_lock: the index (-X) & the names of the output files being written.
+*/
+#ifdef WIN32
+CRITICAL_SECTION gb_codec_lock, gb_file_lock;
+#else
+pthread_mutex_t gb_codec_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t gb_file_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void lock_init()
+{
+#ifdef WIN32
+    InitializeCriticalSection(&gb_codec_lock);
+    InitializeCriticalSection(&gb_file_lock);
+#endif
+}
+
+void codec_lock()
+{
+#ifdef WIN32
+    EnterCriticalSection(&gb_codec_lock);
+#else
+    pthread_mutex_lock(&gb_codec_lock);
+#endif
+}
+
+void codec_unlock()
+{
+#ifdef WIN32
+    LeaveCriticalSection(&gb_codec_lock);
+#else
+    pthread_mutex_unlock(&gb_codec_lock);
+#endif
+}
+
+void file_lock()
+{
+#ifdef WIN32
+    EnterCriticalSection(&gb_file_lock);
+#else
+    pthread_mutex_lock(&gb_file_lock);
+#endif
+}
+
+void file_unlock()
+{
+#ifdef WIN32
+    LeaveCriticalSection(&gb_file_lock);
+#else
+    pthread_mutex_unlock(&gb_file_lock);
+#endif
+}
 
 /* misc functions */
 
@@ -359,6 +443,103 @@ int is_reg_newer(char *file, time_t st_time)
     return S_ISREG(buf.st_mode) && (difftime(buf.st_mtime, st_time) >= 0);
 }
 
+#define SIG_HASH_SIZE 65536 // # of bytes hashed at the beginning & at the end
+
+#ifdef WIN32
+#define mtn_fseek fseeko64
+#define mtn_ftell ftello64
+#else
+#define mtn_fseek fseeko
+#define mtn_ftell ftello
+#endif
+
+typedef struct file_sig
+{
+    int64_t size;
+    time_t mtime;
+    uint32_t hash; // FNV-1a of the first & last SIG_HASH_SIZE bytes
+} file_sig; // cheap check whether a file has changed
+
+uint32_t fnv1a(uint32_t hash, uint8_t *p, size_t n)
+{
+    while (n-- > 0) {
+        hash = (hash ^ *p++) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+like is_reg_newer, but also get size & a partial hash of the file so that
+files copied with their modified time are detected too
+return 0 if ok
+*/
+int get_file_sig(char *file, file_sig *psig)
+{
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t file_w[FILENAME_MAX];
+    UTF8_2_WC(file_w, file, FILENAME_MAX);
+#else
+    char *file_w = file;
+#endif
+
+    struct _stat buf;
+    if (0 != _tstat(file_w, &buf) || !S_ISREG(buf.st_mode)) {
+        return -1;
+    }
+    psig->mtime = buf.st_mtime;
+
+    // st_size is 32 bits in mingw; get the size from the file itself
+    FILE *fp = _tfopen(file_w, _TEXT("rb"));
+    if (NULL == fp) {
+        return -1;
+    }
+    int ret = -1;
+    uint8_t *data = malloc(SIG_HASH_SIZE);
+    if (NULL == data || 0 != mtn_fseek(fp, 0, SEEK_END)) {
+        goto cleanup;
+    }
+    psig->size = mtn_ftell(fp);
+    psig->hash = 2166136261u;
+
+    size_t n;
+    if (0 != mtn_fseek(fp, 0, SEEK_SET)) {
+        goto cleanup;
+    }
+    n = fread(data, 1, SIG_HASH_SIZE, fp);
+    psig->hash = fnv1a(psig->hash, data, n);
+    if (psig->size > SIG_HASH_SIZE) {
+        if (0 != mtn_fseek(fp, -SIG_HASH_SIZE, SEEK_END)) {
+            goto cleanup;
+        }
+        n = fread(data, 1, SIG_HASH_SIZE, fp);
+        psig->hash = fnv1a(psig->hash, data, n);
+    }
+    ret = 0;
+
+  cleanup:
+    free(data);
+    fclose(fp);
+    return ret;
+}
+
+/*
+rename, replacing dst if it exists
+return 0 if ok
+*/
+int rename_replace(char *src, char *dst)
+{
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t src_w[FILENAME_MAX], dst_w[FILENAME_MAX];
+    UTF8_2_WC(src_w, src, FILENAME_MAX);
+    UTF8_2_WC(dst_w, dst, FILENAME_MAX);
+    return MoveFileExW(src_w, dst_w, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#elif defined(WIN32)
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(src, dst);
+#endif
+}
+
 /* 
 return 1 if file is a directory
 return 0 if fail or is not a directory
@@ -592,6 +773,9 @@ void thumb_new(thumbnail *ptn)
     ptn->out_filename[0] = '\0';
     ptn->info_filename[0] = '\0';
     ptn->out_saved = 0;
+    ptn->out_claimed = 0;
+    ptn->nb_file = 0;
+    ptn->info[0] = '\0';
     ptn->width = ptn->height = 0;
     ptn->txt_height = 0;
     ptn->column = ptn->row = 0;
@@ -647,75 +831,49 @@ void thumb_add_shot(thumbnail *ptn, gdImagePtr ip, int idx, int64_t pts)
 #define MAX(a,b) ((a)<(b)?(b):(a))
 #endif
 /*
-perform convolution on pFrame and store result in ip
-pFrame must be a PIX_FMT_RGB24 frame
-ip must be of the same size as pFrame
+count the pixels in the rectangle where the 3x3 laplacian of luma is >= thresh
+luma must be a packed PIX_FMT_GRAY8 picture (linesize == width)
+the rectangle must not touch the border of the picture
 begin = upper left, end = lower right
-filter should be a 2-dimensional but since we cant pass it without knowning the size, we'll use 1 dimension
-modified from:
-http://cvs.php.net/viewvc.cgi/php-src/ext/gd/libgd/gd.c?revision=1.111&view=markup
-*/
-void FrameRGB_convolution(AVFrame *pFrame, int width, int height, 
-    float *filter, int filter_size, float filter_div, float offset,
-    gdImagePtr ip, int xbegin, int ybegin, int xend, int yend)
-{
-
-    int x, y, i, j;
-    float new_r, new_g, new_b;
-    uint8_t *src = pFrame->data[0];
-
-    for (y=ybegin; y<=yend; y++) {
-        for(x=xbegin; x<=xend; x++) {
-            new_r = new_g = new_b = 0;
-            //float grey = 0;
-
-            for (j=0; j<filter_size; j++) {
-                int yv = MIN(MAX(y - filter_size/2 + j, 0), height - 1);
-                for (i=0; i<filter_size; i++) {
-                    int xv = MIN(MAX(x - filter_size/2 + i, 0), width - 1);
-                    int pos = yv*width*3 + xv*3;
-                    new_r += src[pos]   * filter[j * filter_size + i];
-                    new_g += src[pos+1] * filter[j * filter_size + i];
-                    new_b += src[pos+2] * filter[j * filter_size + i];
-                    //grey += (src[pos] + src[pos+1] + src[pos+2])/3 * filter[j * filter_size + i];
-                }
-            }
-
-            new_r = (new_r/filter_div)+offset;
-            new_g = (new_g/filter_div)+offset;
-            new_b = (new_b/filter_div)+offset;
-            //grey = (grey/filter_div)+offset;
-
-            new_r = (new_r > 255.0f)? 255.0f : ((new_r < 0.0f)? 0.0f:new_r);
-            new_g = (new_g > 255.0f)? 255.0f : ((new_g < 0.0f)? 0.0f:new_g);
-            new_b = (new_b > 255.0f)? 255.0f : ((new_b < 0.0f)? 0.0f:new_b);
-            //grey = (grey > 255.0f)? 255.0f : ((grey < 0.0f)? 0.0f:grey);
-
-            gdImageSetPixel(ip, x, y, gdImageColorResolve(ip, (int)new_r, (int)new_g, (int)new_b));
-            //gdImageSetPixel(ip, x, y, gdTrueColor((int)new_r, (int)new_g, (int)new_b));
-            //gdImageSetPixel(ip, x, y, gdTrueColor((int)grey, (int)grey, (int)grey));
-        }
-    }
-}
-
-/* begin = upper left, end = lower right
 */
-float cmp_edge(gdImagePtr ip, int xbegin, int ybegin, int xend, int yend)
+int luma_edge_count(uint8_t *luma, int width, int xbegin, int ybegin, int xend, int yend, int thresh)
 {
-#define CMP_EDGE 208
     int count = 0;
-    int i, j;
-    for (j = ybegin; j <= yend; j++) {
-        for (i = xbegin; i <= xend; i++) {
-            int pixel = gdImageGetPixel(ip, i, j);
-            if (gdImageRed(ip, pixel) >= CMP_EDGE 
-                && gdImageGreen(ip, pixel) >= CMP_EDGE
-                && gdImageBlue(ip, pixel) >= CMP_EDGE) {
+    int x, y;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i t = _mm_set1_epi16(thresh - 1);
+#endif
+    for (y = ybegin; y <= yend; y++) {
+        uint8_t *p = luma + y * width;
+        x = xbegin;
+#ifdef __SSE2__
+        // 8 pixels at a time; -1 in each 16 bit lane for every edge
+        __m128i acc = zero;
+        for (; x + 8 <= xend + 1; x += 8) {
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (p + x)), zero);
+            __m128i n = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (p + x - width)), zero);
+            __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (p + x + width)), zero);
+            __m128i w = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (p + x - 1)), zero);
+            __m128i e = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (p + x + 1)), zero);
+            __m128i lap = _mm_sub_epi16(_mm_slli_epi16(c, 2), 
+                _mm_add_epi16(_mm_add_epi16(n, s), _mm_add_epi16(w, e)));
+            acc = _mm_sub_epi16(acc, _mm_cmpgt_epi16(lap, t));
+        }
+        acc = _mm_madd_epi16(acc, one);
+        acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+        acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+        count += _mm_cvtsi128_si32(acc);
+#endif
+        for (; x <= xend; x++) {
+            int lap = 4*p[x] - p[x - width] - p[x + width] - p[x - 1] - p[x + 1];
+            if (lap >= thresh) {
                 count++;
             }
         }
     }
-    return (float)count / (yend - ybegin + 1) / (xend - xbegin + 1);
+    return count;
 }
 
 int is_edge(float *edge, float edge_found)
@@ -737,40 +895,21 @@ int is_edge(float *edge, float edge_found)
 }
 
 /*
-pFrame must be an PIX_FMT_RGB24 frame
+luma must be a packed PIX_FMT_GRAY8 picture (linesize == width)
+the filter is the -D weighted laplacian that used to be run with gd's convolution 
+on each RGB channel; a pixel is an edge if the filtered value (offset 128) is >= 208,
+i.e. D/4 * laplacian >= 80. done on luma so that only accepted shots need to be
+converted to RGB.
+in verbose mode, return an image of the luma with the checked parts filtered; 
+otherwise NULL.
 http://student.kuleuven.be/~m0216922/CG/
 http://www.pages.drexel.edu/~weg22/edge.html
 http://student.kuleuven.be/~m0216922/CG/filtering.html
 http://cvs.php.net/viewvc.cgi/php-src/ext/gd/libgd/gd.c?revision=1.111&view=markup
 */
-gdImagePtr detect_edge(AVFrame *pFrame, int width, int height, float *edge, float edge_found)
+gdImagePtr detect_edge(uint8_t *luma, int width, int height, float *edge, float edge_found)
 {
-    static float filter[] = {
-         0,-1, 0,
-        -1, 4,-1,
-         0,-1, 0
-    };
-#define FILTER_SIZE 3 // 3x3
-#define FILTER_DIV 1
-#define OFFSET 128
-    static int init_filter = 0; // FIXME
-    if (0 == init_filter) {
-        init_filter = 1;
-        filter[1] = -gb_D_edge/4.0f;
-        filter[3] = -gb_D_edge/4.0f;
-        filter[4] =  gb_D_edge;
-        filter[5] = -gb_D_edge/4.0f;
-        filter[7] = -gb_D_edge/4.0f;
-    }
-
-    gdImagePtr ip = gdImageCreateTrueColor(width, height);
-    if (NULL == ip) {
-        av_log(NULL, AV_LOG_ERROR, "  gdImageCreateTrueColor failed\n");
-        return NULL;
-    }
-    if (gb_v_verbose > 0) {
-        FrameRGB_2_gdImage(pFrame, ip, width, height);
-    }
+    int thresh = (320 + gb_D_edge - 1) / gb_D_edge; // D*lap >= 320
 
     int i;
     for (i = 0; i < EDGE_PARTS; i++) {
@@ -796,13 +935,48 @@ gdImagePtr detect_edge(AVFrame *pFrame, int width, int height, float *edge, floa
     };
     int count = 0;
     for (i = 0; i < EDGE_PARTS && count < 2; i++) {
-        FrameRGB_convolution(pFrame, width, height, filter, FILTER_SIZE, FILTER_DIV, OFFSET, 
-            ip, parts[i][0], parts[i][1], parts[i][2], parts[i][3]);
-        edge[i] = cmp_edge(ip, parts[i][0], parts[i][1], parts[i][2], parts[i][3]);
+        // keep away from the border; only matters for tiny shots
+        parts[i][0] = MAX(parts[i][0], 1);
+        parts[i][1] = MAX(parts[i][1], 1);
+        parts[i][2] = MIN(parts[i][2], width - 2);
+        parts[i][3] = MIN(parts[i][3], height - 2);
+        if (parts[i][2] < parts[i][0] || parts[i][3] < parts[i][1]) {
+            edge[i] = 0;
+            continue;
+        }
+        int found = luma_edge_count(luma, width, parts[i][0], parts[i][1], parts[i][2], parts[i][3], thresh);
+        edge[i] = (float)found / (parts[i][3] - parts[i][1] + 1) / (parts[i][2] - parts[i][0] + 1);
         if (edge[i] >= edge_found) {
             count++;
         }
     }
+
+    if (gb_v_verbose <= 0) {
+        return NULL;
+    }
+    gdImagePtr ip = gdImageCreateTrueColor(width, height);
+    if (NULL == ip) {
+        av_log(NULL, AV_LOG_ERROR, "  gdImageCreateTrueColor failed\n");
+        return NULL;
+    }
+    int x, y;
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int v = luma[y*width + x];
+            gdImageSetPixel(ip, x, y, gdImageColorResolve(ip, v, v, v));
+        }
+    }
+    int j;
+    for (j = 0; j < i; j++) { // the parts checked above
+        for (y = parts[j][1]; y <= parts[j][3]; y++) {
+            for (x = parts[j][0]; x <= parts[j][2]; x++) {
+                uint8_t *p = luma + y*width + x;
+                int lap = 4*p[0] - p[-width] - p[width] - p[-1] - p[1];
+                int v = MIN(MAX(gb_D_edge * lap / 4 + 128, 0), 255);
+                gdImageSetPixel(ip, x, y, gdImageColorResolve(ip, v, v, v));
+            }
+        }
+    }
     return ip;
 }
 
@@ -1013,10 +1187,10 @@ void get_stream_info_type(AVFormatContext *ic, enum CodecType type, char *buf, A
 
 /*
 modified from libavformat's dump_format
+buf must have INFO_SIZE chars; returns buf
 */
-char *get_stream_info(AVFormatContext *ic, char *url, int strip_path, AVRational sample_aspect_ratio)
+char *get_stream_info(AVFormatContext *ic, char *url, int strip_path, AVRational sample_aspect_ratio, char *buf)
 {
-    static char buf[4096]; // FIXME: this is also used for all text at the top
     int duration = -1;
 
     char *file_name = url;
@@ -1067,7 +1241,10 @@ char *get_stream_info(AVFormatContext *ic, char *url, int strip_path, AVRational
     return buf;
 }
 
-void dump_format_context(AVFormatContext *p, int __attribute__((unused)) index, char *url, int __attribute__((unused)) is_output)
+/*
+buf must have INFO_SIZE chars
+*/
+void dump_format_context(AVFormatContext *p, int __attribute__((unused)) index, char *url, int __attribute__((unused)) is_output, char *buf)
 {
     //av_log(NULL, AV_LOG_ERROR, "\n");
     av_log(NULL, AV_LOG_VERBOSE, "***dump_format_context, name: %s, long_name: %s\n", 
@@ -1075,7 +1252,7 @@ void dump_format_context(AVFormatContext *p, int __attribute__((unused)) index,
     //dump_format(p, index, url, is_output);
 
     // dont show scaling info at this time because we dont have the proper sample_aspect_ratio
-    av_log(NULL, LOG_INFO, get_stream_info(p, url, 0, GB_A_RATIO)); 
+    av_log(NULL, LOG_INFO, get_stream_info(p, url, 0, GB_A_RATIO, buf)); 
 
     av_log(NULL, AV_LOG_VERBOSE, "start_time av: %"PRId64", duration av: %"PRId64", file_size: %"PRId64"\n",
         p->start_time, p->duration, p->file_size);
@@ -1100,18 +1277,35 @@ void dump_format_context(AVFormatContext *p, int __attribute__((unused)) index,
 }
 
 /*
+return the fraction of pixels where pb & pc are both within 20 of pa
 */
 double uint8_cmp(uint8_t *pa, uint8_t *pb, uint8_t *pc, int n)
 {
-    int i, same = 0;
-    for (i=0; i<n; i++) {
+    int i = 0, same = 0;
+#ifdef __SSE2__
+    // |a-b| & |a-c| < 20; 16 pixels at a time
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i limit = _mm_set1_epi8(19);
+    __m128i acc = zero;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((__m128i *) (pa + i));
+        __m128i b = _mm_loadu_si128((__m128i *) (pb + i));
+        __m128i c = _mm_loadu_si128((__m128i *) (pc + i));
+        __m128i diffab = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        __m128i diffac = _mm_or_si128(_mm_subs_epu8(a, c), _mm_subs_epu8(c, a));
+        __m128i diff = _mm_max_epu8(diffab, diffac);
+        __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(diff, limit), diff);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_and_si128(ok, one), zero));
+    }
+    same = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; i<n; i++) {
         int diffab = pa[i] - pb[i];
         int diffac = pa[i] - pc[i];
-        int diffbc = pb[i] - pb[i];
 
         if ((diffab > -20) && (diffab < 20) &&
-            (diffac > -20) && (diffac < 20) &&
-            (diffbc > -20) && (diffbc < 20)) {
+            (diffac > -20) && (diffac < 20)) {
             same++;
         }
     }
@@ -1120,15 +1314,14 @@ double uint8_cmp(uint8_t *pa, uint8_t *pb, uint8_t *pc, int n)
 
 /*
 return sameness of the frame; 1 means the frame is the same in all directions, i.e. blank
-pFrame must be an PIX_FMT_RGB24 frame
+luma must be a packed PIX_FMT_GRAY8 picture (linesize == width)
 */
-double blank_frame(AVFrame *pFrame, int width, int height)
+double blank_frame(uint8_t *luma, int width, int height)
 {
-    uint8_t *src = pFrame->data[0];
-    int hor_size = height/11 * width * 3;
-    uint8_t *pa = src+hor_size*2;
-    uint8_t *pb = src+hor_size*5;
-    uint8_t *pc = src+hor_size*8;
+    int hor_size = height/11 * width;
+    uint8_t *pa = luma+hor_size*2;
+    uint8_t *pb = luma+hor_size*5;
+    uint8_t *pc = luma+hor_size*8;
     double same = .4*uint8_cmp(pa, pb, pc, hor_size);
     int ver_size = hor_size/3;
     same += .6/3*uint8_cmp(pa, pa + ver_size, pa + ver_size*2, ver_size);
@@ -1137,18 +1330,18 @@ double blank_frame(AVFrame *pFrame, int width, int height)
     return same;
 }
 
-/* global */
-uint64_t gb_video_pkt_pts = AV_NOPTS_VALUE;
 /* These are called whenever we allocate a frame
- * buffer. We use this to store the global_pts in
+ * buffer. We use this to store the packet pts in
  * a frame at the time it is allocated.
+ * c->opaque must point to the decoder's decode_state.
  */
 int our_get_buffer(struct AVCodecContext *c, AVFrame *pic) {
   int ret = avcodec_default_get_buffer(c, pic);
+  decode_state *pds = c->opaque;
   uint64_t *pts = av_malloc(sizeof(uint64_t));
-  *pts = gb_video_pkt_pts;
+  *pts = (NULL != pds) ? pds->video_pkt_pts : AV_NOPTS_VALUE;
   pic->opaque = pts;
-  av_log(NULL, AV_LOG_VERBOSE, "*coping gb_video_pkt_pts: %"PRId64" to opaque\n", gb_video_pkt_pts);
+  av_log(NULL, AV_LOG_VERBOSE, "*coping video_pkt_pts: %"PRId64" to opaque\n", *pts);
   return ret;
 }
 
@@ -1157,6 +1350,31 @@ void our_release_buffer(struct AVCodecContext *c, AVFrame *pic) {
   avcodec_default_release_buffer(c, pic);
 }
 
+/*
+forget the stats of the previous runs
+*/
+void decode_state_reset(decode_state *pds)
+{
+    pds->run = 0;
+    pds->avg_decoded_frame = 0;
+    pds->skip_non_key = 0;
+}
+
+/*
+update the stats of a successful read_and_decode & enable skipping of non key packets
+*/
+void decode_state_add_run(decode_state *pds, int decoded_frame)
+{
+    pds->run++;
+    pds->avg_decoded_frame = (pds->avg_decoded_frame*(pds->run-1) + decoded_frame) / pds->run;
+    //av_log(NULL, LOG_INFO, "  decoded frames: %d, avg. decoded frames: %.2f\n", 
+    //    decoded_frame, pds->avg_decoded_frame); // DEBUG
+    if (0 == pds->skip_non_key && pds->run >= 3 && pds->avg_decoded_frame > 30) {
+        pds->skip_non_key = 1;
+        av_log(NULL, LOG_INFO, "  skipping non key packets for this file\n");
+    }
+}
+
 /*
 set first to 1 when calling this for the first time of a file
 return >0 if can read packet(s) & decode a frame, *pPts is set to packet's pts
@@ -1164,22 +1382,18 @@ return  0 if end of file
 return <0 if error
 */
 int read_and_decode(AVFormatContext *pFormatCtx, int video_index, 
-    AVCodecContext *pCodecCtx, AVFrame *pFrame, int64_t *pPts, int key_only, int first)
+    AVCodecContext *pCodecCtx, AVFrame *pFrame, int64_t *pPts, int key_only, int first,
+    decode_state *pds)
 {
     //double pts = -99999;
     AVPacket packet;
     AVStream *pStream = pFormatCtx->streams[video_index];
     int decoded_frame = 0;
-    static int run = 0; // # of times read_and_decode has been called for a file
-    static double avg_decoded_frame = 0; // average # of decoded frame
-    static int skip_non_key = 0;
 
     if (first) {
-        // reset stats
-        run = 0;
-        avg_decoded_frame = 0;
-        skip_non_key = 0;
+        decode_state_reset(pds);
     }
+    pds->decoded_frame = 0;
 
     int got_picture;
     int pkt_without_pic = 0; // # of video packet read without getting a picture
@@ -1208,16 +1422,16 @@ int read_and_decode(AVFormatContext *pFormatCtx, int video_index,
         // so we'll use it only when a key frame is difficult to find.
         // hope this wont break anything. :)
         // this seems to help a lot for files with vorbis audio
-        if (1 == skip_non_key && 1 == key_only && !(packet.flags & PKT_FLAG_KEY)) {
+        if (1 == pds->skip_non_key && 1 == key_only && !(packet.flags & PKT_FLAG_KEY)) {
             continue;
         }
         
         dump_packet(&packet, pStream);
         //dump_codec_context(pCodecCtx);
 
-        // Save global pts to be stored in pFrame in first call
-        av_log(NULL, AV_LOG_VERBOSE, "*saving gb_video_pkt_pts: %"PRId64"\n", packet.pts);
-        gb_video_pkt_pts = packet.pts;
+        // Save pts to be stored in pFrame in first call
+        av_log(NULL, AV_LOG_VERBOSE, "*saving video_pkt_pts: %"PRId64"\n", packet.pts);
+        pds->video_pkt_pts = packet.pts;
 
         // Decode video frame
         avcodec_decode_video(pCodecCtx, pFrame, &got_picture, packet.data, packet.size);
@@ -1269,14 +1483,8 @@ int read_and_decode(AVFormatContext *pFormatCtx, int video_index,
     av_free_packet(&packet);
 
     // stats & enable skipping of non key packets
-    run++;
-    avg_decoded_frame = (avg_decoded_frame*(run-1) + decoded_frame) / run;
-    //av_log(NULL, LOG_INFO, "  decoded frames: %d, avg. decoded frames: %.2f, pict_type: %d\n", 
-    //    decoded_frame, avg_decoded_frame, pFrame->pict_type); // DEBUG
-    if (0 == skip_non_key && run >= 3 && avg_decoded_frame > 30) {
-        skip_non_key = 1;
-        av_log(NULL, LOG_INFO, "  skipping non key packets for this file\n");
-    }
+    pds->decoded_frame = decoded_frame;
+    decode_state_add_run(pds, decoded_frame);
 
     av_log(NULL, AV_LOG_VERBOSE, "*****got picture, repeat_pict: %d%s, key_frame: %d, pict_type: %d\n", pFrame->repeat_pict,
         (pFrame->repeat_pict > 0) ? "**r**" : "", pFrame->key_frame, pFrame->pict_type);
@@ -1308,99 +1516,422 @@ double calc_time(int64_t timestamp, AVRational time_base, double start_time)
 }
 
 /*
-return the duration. guess when unknown.
-must be called after codec has been opened
+keyframe index for mpeg-ts files (recordings)
+
+ffmpeg's mpegts demuxer has no index; av_seek_frame bisects the whole file by 
+timestamps and then the decoder has to skip packets until the next key frame.
+instead we probe a few evenly spaced positions once for random access points 
+(pes packets of the video pid starting an i-frame) and for each seek narrow down
+between the 2 surrounding points by interpolating the byte position. a seek then
+reads about a gop or two and lands exactly on the start of an i-frame.
 */
-double guess_duration(AVFormatContext *pFormatCtx, int index, 
-    AVCodecContext __attribute__((unused)) *pCodecCtx, AVFrame __attribute__((unused)) *pFrame)
+#define TS_PACKET_SIZE 188
+#define TS_INDEX_POINTS 32 // # of positions probed when building the index
+#define TS_PROBE_SIZE (2*1024*1024) // max. bytes scanned per probe
+#define TS_PROBE_CHUNK (TS_PACKET_SIZE*192*8)
+#define TS_SEEK_PROBES 6 // max. # of probes per seek
+#define TS_SEEK_LEAD 45000 // aim 0.5 s before the target to land in front of it
+#define TS_PTS_WRAP (1LL << 33)
+
+typedef struct ts_rap
 {
-    double duration = (double) pFormatCtx->duration / AV_TIME_BASE; // can be incorrect for .vob files
-    if (duration > 0) {
-        return duration;
-    }
-
-    AVStream *pStream = pFormatCtx->streams[index];
-    double guess;
+    int64_t pts; // unwrapped, 90 kHz
+    int64_t pos; // byte offset of the packet starting the pes; -1 if none
+} ts_rap;
 
-    // if stream bitrate is known we'll interpolate from file size.
-    // pFormatCtx->start_time would be incorrect for .vob file with multiple titles.
-    // pStream->start_time doesn't work either. so we'll need to disable timestamping.
-    assert(NULL != pStream && NULL != pStream->codec);
-    if (pStream->codec->bit_rate > 0 && pFormatCtx->file_size > 0) {
-        guess = 0.9 * pFormatCtx->file_size / (pStream->codec->bit_rate / 8);
-        if (guess > 0) {
-            av_log(NULL, AV_LOG_ERROR, "  ** duration is unknown: %.2f; guessing: %.2f s from bit_rate\n", duration, guess);
-            return guess;
-        }
+typedef struct ts_index
+{
+    int pid; // video pid
+    int codec_id;
+    int packet_size; // 188, or 192 with time codes
+    int sync_offset; // offset of the first packet
+    int64_t file_size;
+    int64_t first_pts; // for unwrapping
+    int64_t last_pts; // last video pts in the file
+    ts_rap raps[TS_INDEX_POINTS];
+    int nb_rap; // 0 = no index; use ffmpeg's seeking
+} ts_index;
+
+int64_t ts_unwrap(ts_index *pti, int64_t pts)
+{
+    if (AV_NOPTS_VALUE != pti->first_pts && pts < pti->first_pts - TS_PTS_WRAP/2) {
+        pts += TS_PTS_WRAP;
     }
+    return pts;
+}
 
-    return -1;
-    
-    // the following doesn't work.
-    /*
-    // we'll guess the duration by seeking to near the end of the file and
-    // decode a frame. the timestamp of that frame is the guess.
-    // things get more complicated for dvd's .vob files. each .vob file
-    // can contain more than 1 title. and each title will have its own pts.
-    // for example, 90% of a .vob might be for title 1 and the last 10%
-    // might be for title 2; seeking to near the end will end up getting 
-    // title 2's pts. this problem cannot be solved if we just look at the
-    // .vob files. need to process other info outside .vob files too.
-    // as a result, the following will probably never work.
-    // .vob files weirdness will make our assumption to seek by byte incorrect too.
-    if (pFormatCtx->file_size <= 0) {
+/*
+p points to a 188 bytes ts packet
+return -1 if it doesn't start a pes of the video pid, 
+0 if it does & *ppts is set, 1 if it's also a random access point
+*/
+int ts_packet_rap(ts_index *pti, uint8_t *p, int64_t *ppts)
+{
+    int pid = ((p[1] & 0x1f) << 8) | p[2];
+    if (pid != pti->pid || !(p[1] & 0x40)) { // payload_unit_start_indicator
         return -1;
     }
-    int64_t byte_pos = 0.9 * pFormatCtx->file_size;
-    int ret = av_seek_frame(pFormatCtx, index, byte_pos, AVSEEK_FLAG_BYTE);
-    if (ret < 0) { // failed
-        return -1;
+    int afc = (p[3] >> 4) & 3;
+    uint8_t *end = p + TS_PACKET_SIZE;
+    uint8_t *pes = p + 4;
+    int rai = 0;
+    if (afc & 2) { // adaptation field
+        if (pes[0] > 0) {
+            rai = pes[1] & 0x40; // random_access_indicator
+        }
+        pes += 1 + pes[0];
     }
-    avcodec_flush_buffers(pCodecCtx);
-    int64_t pts;
-    ret = read_and_decode(pFormatCtx, index, pCodecCtx, pFrame, &pts, 0); // FIXME: key or not?
-    if (ret <= 0) { // end of file or error
-        av_log(NULL, AV_LOG_VERBOSE, "  read_and_decode during guessing duration failed\n");
+    if (!(afc & 1) || pes + 14 > end 
+        || 0 != pes[0] || 0 != pes[1] || 1 != pes[2] || !(pes[7] & 0x80)) { // no pes header or pts
         return -1;
     }
-    double start_time = (double) pFormatCtx->start_time / AV_TIME_BASE; // FIXME: can be unknown?
-    guess = calc_time(pts, pStream->time_base, start_time);
-    if (guess <= 0) {
-        return -1;
+    *ppts = ((int64_t) (pes[9] & 0x0e) << 29) | (pes[10] << 22) | ((pes[11] & 0xfe) << 14)
+        | (pes[12] << 7) | (pes[13] >> 1);
+    if (rai) {
+        return 1;
     }
-    av_log(NULL, AV_LOG_ERROR, "  ** duration is unknown: %.2f; guessing: %.2f s.\n", duration, guess);
-
-    // seek back to 0 & flush buffer; FIXME: is 0 correct?
-    av_seek_frame(pFormatCtx, index, 0, AVSEEK_FLAG_BYTE); // ignore errors
-    avcodec_flush_buffers(pCodecCtx);
 
-    return guess;
-    */
+    // not all muxers set random_access_indicator; look for the start of an i-frame
+    uint8_t *es;
+    for (es = pes + 9 + pes[8]; es + 6 <= end; es++) {
+        if (0 != es[0] || 0 != es[1] || 1 != es[2]) {
+            continue;
+        }
+        if (CODEC_ID_H264 == pti->codec_id) {
+            int nal = es[3] & 0x1f;
+            if (5 == nal || 7 == nal || (9 == nal && 0 == (es[4] >> 5))) { // idr, sps, i-only aud
+                return 1;
+            }
+        } else {
+            if (0xb3 == es[3] || 0xb8 == es[3]) { // sequence or gop header
+                return 1;
+            }
+            if (0x00 == es[3]) { // picture header
+                return (1 == ((es[5] >> 3) & 7)) ? 1 : 0;
+            }
+        }
+    }
+    return 0;
 }
 
 /*
-try hard to seek
-assume flags can be either 0 or AVSEEK_FLAG_BACKWARD
+scan up to TS_PROBE_SIZE bytes from pos for random access points.
+stop at the first one with pts >= target & store it in *pfound;
+*pprev is the last one before it (pprev->pos = -1 if none).
+if pmax_pts isn't NULL, it's set to the largest video pts seen.
+return 1 if *pfound is set, 0 if not, -1 if failed
 */
-int really_seek(AVFormatContext *pFormatCtx, int index, int64_t timestamp, int flags, double duration)
+int ts_scan(ByteIOContext *pb, ts_index *pti, int64_t pos, int64_t target, 
+    ts_rap *pfound, ts_rap *pprev, int64_t *pmax_pts)
 {
-    assert(flags == 0 || flags == AVSEEK_FLAG_BACKWARD);
-    int ret;
-
-    /* first try av_seek_frame */
-    ret = av_seek_frame(pFormatCtx, index, timestamp, flags);
-    if (ret >= 0) { // success
-        return ret;
+    pprev->pos = -1;
+    uint8_t *buf = av_malloc(TS_PROBE_CHUNK);
+    if (NULL == buf) {
+        return -1;
     }
 
-    /* then we try seeking to any (non key) frame AVSEEK_FLAG_ANY */
-    ret = av_seek_frame(pFormatCtx, index, timestamp, flags | AVSEEK_FLAG_ANY);
-    if (ret >= 0) { // success
-        av_log(NULL, LOG_INFO, "AVSEEK_FLAG_ANY: timestamp: %"PRId64"\n", timestamp); // DEBUG
-        return ret;
+    // align to a packet
+    int64_t base = MAX(pos - pti->sync_offset, 0) / pti->packet_size * pti->packet_size + pti->sync_offset;
+    int64_t end = MIN(pos + TS_PROBE_SIZE, pti->file_size);
+    int ret = 0;
+    while (base < end && 0 == ret) {
+        if (url_fseek(pb, base, SEEK_SET) < 0) {
+            ret = -1;
+            break;
+        }
+        int n = get_buffer(pb, buf, TS_PROBE_CHUNK);
+        if (n < pti->packet_size) {
+            break;
+        }
+        int off = 0;
+        while (off + pti->packet_size <= n) {
+            uint8_t *p = buf + off + pti->packet_size - TS_PACKET_SIZE;
+            if (0x47 != p[0]) { // lost sync
+                off++;
+                continue;
+            }
+            int64_t pts;
+            int rap = ts_packet_rap(pti, p, &pts);
+            if (rap >= 0) {
+                pts = ts_unwrap(pti, pts);
+                if (NULL != pmax_pts && pts > *pmax_pts) {
+                    *pmax_pts = pts;
+                }
+            }
+            if (1 == rap) {
+                ts_rap found = {pts, base + off};
+                if (pts >= target) {
+                    *pfound = found;
+                    ret = 1;
+                    break;
+                }
+                *pprev = found;
+            }
+            off += pti->packet_size;
+        }
+        base += off;
     }
+    av_free(buf);
+    return ret;
+}
 
-    /* and then we try seeking by byte (AVSEEK_FLAG_BYTE) */
+/*
+build the index if pFormatCtx is a mpeg-ts file with mpeg-1/2 or h.264 video.
+must be called before decoding starts; the file position is restored.
+pti->nb_rap is 0 if there's no index
+*/
+void ts_index_build(AVFormatContext *pFormatCtx, int index, ts_index *pti)
+{
+    pti->nb_rap = 0;
+    AVStream *pStream = pFormatCtx->streams[index];
+    ByteIOContext *pb = pFormatCtx->pb;
+    if (NULL == pFormatCtx->iformat || 0 != strcmp(pFormatCtx->iformat->name, "mpegts") 
+        || NULL == pb || 1 != pStream->time_base.num || 90000 != pStream->time_base.den) {
+        return;
+    }
+    pti->codec_id = pStream->codec->codec_id;
+    if (CODEC_ID_MPEG1VIDEO != pti->codec_id && CODEC_ID_MPEG2VIDEO != pti->codec_id
+        && CODEC_ID_H264 != pti->codec_id) {
+        return;
+    }
+    pti->pid = pStream->id; // the demuxer uses pids as stream ids
+    pti->file_size = url_fsize(pb);
+    pti->first_pts = AV_NOPTS_VALUE;
+    pti->last_pts = AV_NOPTS_VALUE;
+    int64_t saved_pos = url_ftell(pb);
+
+    // packet size & first sync byte
+    uint8_t head[192*4];
+    if (url_fseek(pb, 0, SEEK_SET) < 0 || get_buffer(pb, head, sizeof(head)) != sizeof(head)) {
+        goto cleanup;
+    }
+    pti->packet_size = 0;
+    int size, i, j;
+    for (size = TS_PACKET_SIZE; size <= 192 && 0 == pti->packet_size; size += 192 - TS_PACKET_SIZE) {
+        for (i = 0; i < size; i++) {
+            for (j = 0; j < 3 && 0x47 == head[i + j*size]; j++)
+                ;
+            if (3 == j) {
+                pti->packet_size = size;
+                pti->sync_offset = MAX(i - (size - TS_PACKET_SIZE), 0);
+                break;
+            }
+        }
+    }
+    if (0 == pti->packet_size) {
+        goto cleanup;
+    }
+
+    // evenly spaced random access points
+    int disorder = 0;
+    for (i = 0; i < TS_INDEX_POINTS; i++) {
+        ts_rap found, prev;
+        int64_t pos = pti->file_size / TS_INDEX_POINTS * i;
+        if (1 != ts_scan(pb, pti, pos, INT64_MIN, &found, &prev, NULL)) {
+            continue;
+        }
+        if (0 == pti->nb_rap) {
+            pti->first_pts = found.pts;
+        } else if (found.pts <= pti->raps[pti->nb_rap - 1].pts || found.pos <= pti->raps[pti->nb_rap - 1].pos) {
+            disorder++; // discontinuity or overlapping probes
+            continue;
+        }
+        pti->raps[pti->nb_rap++] = found;
+    }
+
+    // last pts for the duration
+    ts_rap found, prev;
+    int64_t max_pts = INT64_MIN;
+    ts_scan(pb, pti, MAX(pti->file_size - TS_PROBE_SIZE, 0), INT64_MAX, &found, &prev, &max_pts);
+    if (INT64_MIN != max_pts) {
+        pti->last_pts = max_pts;
+    }
+
+    // timestamps jump around; let ffmpeg handle it
+    if (pti->nb_rap < 2 || disorder > TS_INDEX_POINTS/4 || AV_NOPTS_VALUE == pti->last_pts) {
+        pti->nb_rap = 0;
+    }
+    av_log(NULL, AV_LOG_VERBOSE, "ts_index_build: packet_size: %d, pid: %d, nb_rap: %d, disorder: %d, first_pts: %"PRId64", last_pts: %"PRId64"\n", 
+        pti->packet_size, pti->pid, pti->nb_rap, disorder, pti->first_pts, pti->last_pts);
+
+  cleanup:
+    url_fseek(pb, saved_pos, SEEK_SET);
+}
+
+/*
+seek to the random access point at or after timestamp; at or before for AVSEEK_FLAG_BACKWARD
+return -1 if failed
+*/
+int ts_index_seek(AVFormatContext *pFormatCtx, int index, ts_index *pti, int64_t timestamp, int flags)
+{
+    ByteIOContext *pb = pFormatCtx->pb;
+    ts_rap lo = {AV_NOPTS_VALUE, -1};
+    ts_rap hi = {pti->last_pts, pti->file_size}; // end of file; not a random access point
+    int i;
+    for (i = 0; i < pti->nb_rap; i++) {
+        if (pti->raps[i].pts < timestamp) {
+            lo = pti->raps[i];
+        } else {
+            hi = pti->raps[i];
+            break;
+        }
+    }
+    if (lo.pos < 0) { // before the first one
+        lo = hi;
+    }
+
+    int probe;
+    for (probe = 0; probe < TS_SEEK_PROBES && lo.pos != hi.pos; probe++) {
+        int64_t pos = lo.pos;
+        if (hi.pos - lo.pos > TS_PROBE_SIZE) { // interpolate
+            int64_t aim = MAX(timestamp - TS_SEEK_LEAD - lo.pts, 0);
+            pos += av_rescale(aim, hi.pos - lo.pos, MAX(hi.pts - lo.pts, 1));
+            pos = MIN(pos, hi.pos - TS_PROBE_SIZE/2);
+        }
+        int from_lo = (pos == lo.pos);
+        ts_rap found, prev;
+        int ret = ts_scan(pb, pti, pos, timestamp, &found, &prev, NULL);
+        if (ret < 0) {
+            return -1;
+        }
+        if (prev.pos >= 0) {
+            lo = prev;
+        }
+        if (1 == ret) {
+            hi = found;
+            if (prev.pos >= 0 || from_lo) { // no random access point in between
+                break;
+            }
+        } else if (prev.pos < 0) { // nothing in the probed range
+            break;
+        }
+    }
+
+    int64_t pos;
+    if (AVSEEK_FLAG_BACKWARD == flags || hi.pos == pti->file_size) {
+        pos = (hi.pts == timestamp && hi.pos != pti->file_size) ? hi.pos : lo.pos;
+    } else {
+        pos = hi.pos;
+    }
+    if (pos < 0 || pos >= pti->file_size) {
+        return -1;
+    }
+    av_log(NULL, AV_LOG_VERBOSE, "ts_index_seek: timestamp: %"PRId64", lo: %"PRId64", hi: %"PRId64", pos: %"PRId64", probes: %d\n", 
+        timestamp, lo.pts, hi.pts, pos, probe);
+    return av_seek_frame(pFormatCtx, index, pos, AVSEEK_FLAG_BYTE);
+}
+
+/*
+return the duration. guess when unknown.
+must be called after codec has been opened
+pti can be NULL
+*/
+double guess_duration(AVFormatContext *pFormatCtx, int index, 
+    AVCodecContext __attribute__((unused)) *pCodecCtx, AVFrame __attribute__((unused)) *pFrame, ts_index *pti)
+{
+    double duration = (double) pFormatCtx->duration / AV_TIME_BASE; // can be incorrect for .vob files
+    if (duration > 0) {
+        return duration;
+    }
+
+    AVStream *pStream = pFormatCtx->streams[index];
+    double guess;
+
+    // for mpeg-ts, the pts at the beginning & the end of the file are known
+    if (NULL != pti && pti->nb_rap > 0 && pti->last_pts > pti->first_pts) {
+        guess = (pti->last_pts - pti->first_pts) * av_q2d(pStream->time_base);
+        av_log(NULL, AV_LOG_ERROR, "  ** duration is unknown: %.2f; guessing: %.2f s from pts\n", duration, guess);
+        return guess;
+    }
+
+    // if stream bitrate is known we'll interpolate from file size.
+    // pFormatCtx->start_time would be incorrect for .vob file with multiple titles.
+    // pStream->start_time doesn't work either. so we'll need to disable timestamping.
+    assert(NULL != pStream && NULL != pStream->codec);
+    if (pStream->codec->bit_rate > 0 && pFormatCtx->file_size > 0) {
+        guess = 0.9 * pFormatCtx->file_size / (pStream->codec->bit_rate / 8);
+        if (guess > 0) {
+            av_log(NULL, AV_LOG_ERROR, "  ** duration is unknown: %.2f; guessing: %.2f s from bit_rate\n", duration, guess);
+            return guess;
+        }
+    }
+
+    return -1;
+    
+    // the following doesn't work.
+    /*
+    // we'll guess the duration by seeking to near the end of the file and
+    // decode a frame. the timestamp of that frame is the guess.
+    // things get more complicated for dvd's .vob files. each .vob file
+    // can contain more than 1 title. and each title will have its own pts.
+    // for example, 90% of a .vob might be for title 1 and the last 10%
+    // might be for title 2; seeking to near the end will end up getting 
+    // title 2's pts. this problem cannot be solved if we just look at the
+    // .vob files. need to process other info outside .vob files too.
+    // as a result, the following will probably never work.
+    // .vob files weirdness will make our assumption to seek by byte incorrect too.
+    if (pFormatCtx->file_size <= 0) {
+        return -1;
+    }
+    int64_t byte_pos = 0.9 * pFormatCtx->file_size;
+    int ret = av_seek_frame(pFormatCtx, index, byte_pos, AVSEEK_FLAG_BYTE);
+    if (ret < 0) { // failed
+        return -1;
+    }
+    avcodec_flush_buffers(pCodecCtx);
+    int64_t pts;
+    ret = read_and_decode(pFormatCtx, index, pCodecCtx, pFrame, &pts, 0); // FIXME: key or not?
+    if (ret <= 0) { // end of file or error
+        av_log(NULL, AV_LOG_VERBOSE, "  read_and_decode during guessing duration failed\n");
+        return -1;
+    }
+    double start_time = (double) pFormatCtx->start_time / AV_TIME_BASE; // FIXME: can be unknown?
+    guess = calc_time(pts, pStream->time_base, start_time);
+    if (guess <= 0) {
+        return -1;
+    }
+    av_log(NULL, AV_LOG_ERROR, "  ** duration is unknown: %.2f; guessing: %.2f s.\n", duration, guess);
+
+    // seek back to 0 & flush buffer; FIXME: is 0 correct?
+    av_seek_frame(pFormatCtx, index, 0, AVSEEK_FLAG_BYTE); // ignore errors
+    avcodec_flush_buffers(pCodecCtx);
+
+    return guess;
+    */
+}
+
+/*
+try hard to seek
+assume flags can be either 0 or AVSEEK_FLAG_BACKWARD
+pti can be NULL
+*/
+int really_seek(AVFormatContext *pFormatCtx, int index, int64_t timestamp, int flags, double duration, ts_index *pti)
+{
+    assert(flags == 0 || flags == AVSEEK_FLAG_BACKWARD);
+    int ret;
+
+    /* mpeg-ts: go straight to a random access point */
+    if (NULL != pti && pti->nb_rap > 0) {
+        ret = ts_index_seek(pFormatCtx, index, pti, timestamp, flags);
+        if (ret >= 0) { // success
+            return ret;
+        }
+    }
+
+    /* first try av_seek_frame */
+    ret = av_seek_frame(pFormatCtx, index, timestamp, flags);
+    if (ret >= 0) { // success
+        return ret;
+    }
+
+    /* then we try seeking to any (non key) frame AVSEEK_FLAG_ANY */
+    ret = av_seek_frame(pFormatCtx, index, timestamp, flags | AVSEEK_FLAG_ANY);
+    if (ret >= 0) { // success
+        av_log(NULL, LOG_INFO, "AVSEEK_FLAG_ANY: timestamp: %"PRId64"\n", timestamp); // DEBUG
+        return ret;
+    }
+
+    /* and then we try seeking by byte (AVSEEK_FLAG_BYTE) */
     // here we assume that the whole file has duration seconds.
     // so we'll interpolate accordingly.
     AVStream *pStream = pFormatCtx->streams[index];
@@ -1426,106 +1957,629 @@ int really_seek(AVFormatContext *pFormatCtx, int index, int64_t timestamp, int f
     return -1;
 }
 
-/* 
-modify name so that it'll (hopefully) be unique
-by inserting a unique string before suffix.
-if unum is != 0, it'll be used
-returns the unique number
+/*
+the video stream's index as it was after the file was opened; see seek_shot
 */
-int make_unique_name(char *name, char *suffix, int unum)
+typedef struct index_snapshot
 {
-    // tmpnam() in mingw always return names which start with \ -- unuseable.
-    // so we'll use random number instead.
+    AVIndexEntry *entries;
+    int nb_entries;
+} index_snapshot;
 
-    char unique[FILENAME_MAX];
-    if (unum == 0) {
-        unum = rand();
+/*
+return -1 if failed
+*/
+int index_snapshot_take(index_snapshot *psi, AVStream *pStream)
+{
+    psi->nb_entries = pStream->nb_index_entries;
+    psi->entries = NULL;
+    if (psi->nb_entries > 0) {
+        psi->entries = av_malloc(psi->nb_entries * sizeof(AVIndexEntry));
+        if (NULL == psi->entries) {
+            psi->nb_entries = 0;
+            return -1;
+        }
+        memcpy(psi->entries, pStream->index_entries, psi->nb_entries * sizeof(AVIndexEntry));
     }
-    sprintf(unique, "_%d", unum);
+    return 0;
+}
 
-    char *found = strlaststr(name, suffix);
-    if (NULL == found || found == name) {
-        strcat(name, unique); // this shouldn't happen
-    } else {
-        strcat(unique, found);
-        strcpy(found, unique);
-    }
-    return unum;
+void index_snapshot_free(index_snapshot *psi)
+{
+    av_freep(&psi->entries);
+    psi->nb_entries = 0;
 }
 
 /*
+seek to a shot of seek mode the same way whatever was read & decoded before,
+so a shot doesn't depend on the shots before it. demuxers that add to the index
+while reading & bisect by it get back the index of psi, the file is rewound so 
+byte seeking & bisecting start from the same state, and the decoder is flushed.
+make_thumbnail & the -m workers both seek this way.
+a generic index (AVFMT_GENERIC_INDEX) is left alone: it only gets the key frames
+read and av_seek_frame scans forward to complete it up to the target, so it 
+gives the same frame anyway; restoring it would scan from the start every shot.
+psi & pti can be NULL
+return really_seek's return value
 */
-void make_thumbnail(char *file)
+int seek_shot(AVFormatContext *pFormatCtx, int index, AVCodecContext *pCodecCtx, 
+    int64_t timestamp, int flags, double duration, ts_index *pti, index_snapshot *psi)
 {
-    av_log(NULL, AV_LOG_VERBOSE, "make_thumbnail: %s\n", file);
-    static int nb_file = 0; // FIXME: static
-    nb_file++;
+    AVStream *pStream = pFormatCtx->streams[index];
+    if (NULL != psi && !(pFormatCtx->iformat->flags & AVFMT_GENERIC_INDEX)) {
+        unsigned int size = psi->nb_entries * sizeof(AVIndexEntry);
+        if (size > 0) {
+            pStream->index_entries = av_fast_realloc(pStream->index_entries, 
+                &pStream->index_entries_allocated_size, size);
+        }
+        if (0 == size || NULL == pStream->index_entries) {
+            pStream->nb_index_entries = 0;
+        } else {
+            memcpy(pStream->index_entries, psi->entries, size);
+            pStream->nb_index_entries = psi->nb_entries;
+        }
+    }
+    av_seek_frame(pFormatCtx, index, 0, AVSEEK_FLAG_BYTE); // rewind; ignore errors
+    int ret = really_seek(pFormatCtx, index, timestamp, flags, duration, pti);
+    avcodec_flush_buffers(pCodecCtx);
+    return ret;
+}
 
-    struct timeval tstart;
-    gettimeofday(&tstart, NULL);
+/*
+parallel shot extraction (-m option)
+
+worker threads, each with its own AVFormatContext & decoder, decode the shots of
+the seek mode loop in make_thumbnail ahead of time. a worker repeats the seek & 
+blank/edge evasion of one slot (one seek_target) with the same code as the loop.
+the loop in make_thumbnail still runs serially and only uses a prefetched try
+when it would have seeked to the same eff_target with the same skip_non_key
+setting; otherwise it seeks & decodes itself. a slot doesn't depend on the 
+ones before it in either mode: both seek with seek_shot & start each slot with 
+fresh decode_state stats, so a try decodes the same frame whichever decoder 
+does it and the output is the same as without workers.
+*/
+#define MAX_PREFETCH_TRY 8 // max. # of tries (evasions) prefetched per slot
 
-    int i;
-    thumbnail tn; // thumbnail data & info
-    thumb_new(&tn);
-    // shot sh; // shot info
-    shot fill_buffer[gb_c_column-1]; // skipped shots to fill the last row
-    for (i=0; i<gb_c_column-1; i++) {
-        fill_buffer[i].ip = NULL;
-    }
-    int nb_shots = 0; // # of decoded shots (stat purposes)
+typedef struct shot_try
+{
+    int64_t eff_target; // seek target of this try
+    int skip_non_key; // decoder's skip_non_key when seeking
+    int ret; // read_and_decode's return value
+    int decoded_frame; // decode_state.decoded_frame after read_and_decode
+    int64_t found_pts;
+    uint8_t *luma; // PIX_FMT_GRAY8 shot_width x shot_height; NULL if evasion is off
+    uint8_t *rgb; // PIX_FMT_RGB24 shot_width x shot_height; only for good shots
+} shot_try;
 
-    /* these are checked during cleaning up, must be NULL if not used */
-    AVFormatContext *pFormatCtx = NULL;
-    AVCodecContext *pCodecCtx = NULL;
-    AVFrame *pFrame = NULL;
-    AVFrame *pFrameRGB = NULL;
-    uint8_t *rgb_buffer = NULL;
-    struct SwsContext *pSwsCtx = NULL;
-    tn.out_ip = NULL;
-    FILE *out_fp = NULL;
-    FILE *info_fp = NULL;
-    gdImagePtr ip = NULL;
+typedef struct shot_slot
+{
+    int64_t seek_target;
+    int nb_try;
+    shot_try tries[MAX_PREFETCH_TRY];
+} shot_slot;
 
-    int t_timestamp = gb_t_timestamp; // local timestamp; can be turned off; 0 = off
-    int ret;
+typedef struct shot_pool
+{
+    /* job; read only for workers */
+    char *file;
+    int video_index;
+    int shot_width, shot_height;
+    int step; // seconds
+    int evade_step; // seconds
+    double duration;
+    int64_t duration_tb;
+    int64_t start_time_tb;
+    AVRational time_base;
+    ts_index *pti; // NULL if no keyframe index
+    index_snapshot *psi;
+    int rgb_bufsize;
+    int luma_bufsize;
+
+    shot_slot *slots;
+    int nb_slot;
+
+    /* next slot to decode */
+    int next_slot;
+#ifdef WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} shot_pool;
 
-    av_log(NULL, LOG_INFO, "\n");
+typedef struct shot_worker
+{
+    shot_pool *pool;
+    AVFormatContext *pFormatCtx;
+    AVCodecContext *pCodecCtx;
+    AVFrame *pFrame;
+    struct SwsContext *pSwsCtx;
+    struct SwsContext *pLumaCtx;
+    decode_state ds;
+} shot_worker;
+
+void shot_worker_close(shot_worker *pw)
+{
+    if (NULL != pw->pSwsCtx)
+        sws_freeContext(pw->pSwsCtx);
+    if (NULL != pw->pLumaCtx)
+        sws_freeContext(pw->pLumaCtx);
+    if (NULL != pw->pFrame)
+        av_free(pw->pFrame);
+    codec_lock();
+    if (NULL != pw->pCodecCtx && NULL != pw->pCodecCtx->codec)
+        avcodec_close(pw->pCodecCtx);
+    if (NULL != pw->pFormatCtx)
+        av_close_input_file(pw->pFormatCtx);
+    codec_unlock();
+    pw->pSwsCtx = NULL;
+    pw->pLumaCtx = NULL;
+    pw->pFrame = NULL;
+    pw->pCodecCtx = NULL;
+    pw->pFormatCtx = NULL;
+}
 
-    /* check if output file already exists & open output file */
-    if (NULL != gb_O_outdir && strlen(gb_O_outdir) > 0) {
-        strcpy_va(tn.out_filename, 3, gb_O_outdir, "/", path_2_file(file));
-        if (NULL != gb_N_suffix)
-            strcpy_va(tn.info_filename, 3, gb_O_outdir, "/", path_2_file(file));
-    } else {
-        strcpy(tn.out_filename, file);
-        if (NULL != gb_N_suffix)
-            strcpy(tn.info_filename, file);
+/*
+open the file & decoder like make_thumbnail does
+return -1 if failed
+*/
+int shot_worker_open(shot_worker *pw, shot_pool *pp)
+{
+    pw->pool = pp;
+    pw->pFormatCtx = NULL;
+    pw->pCodecCtx = NULL;
+    pw->pFrame = NULL;
+    pw->pSwsCtx = NULL;
+    pw->pLumaCtx = NULL;
+
+    if (0 != av_open_input_file(&pw->pFormatCtx, pp->file, NULL, 0, NULL)) {
+        goto error;
+    }
+    pw->pFormatCtx->flags |= AVFMT_FLAG_GENPTS;
+    codec_lock();
+    int ret = av_find_stream_info(pw->pFormatCtx);
+    codec_unlock();
+    if (ret < 0 || pp->video_index >= pw->pFormatCtx->nb_streams) {
+        goto error;
+    }
+    AVCodecContext *pCodecCtx = pw->pFormatCtx->streams[pp->video_index]->codec;
+    if (CODEC_TYPE_VIDEO != pCodecCtx->codec_type) {
+        goto error;
     }
-    char *suffix = strrchr(tn.out_filename, '.');
-    if (NULL == suffix) {
-        strcat(tn.out_filename, gb_o_suffix);
-    } else {
-        strcpy(suffix, gb_o_suffix);
+    AVCodec *pCodec = avcodec_find_decoder(pCodecCtx->codec_id);
+    if (NULL == pCodec) {
+        goto error;
     }
-    if (NULL != gb_N_suffix) {
-        suffix = strrchr(tn.info_filename, '.');
-        if (NULL == suffix) {
-            strcat(tn.info_filename, gb_N_suffix);
-        } else {
+    if (gb_s_step >= 0) {
+        pCodecCtx->skip_frame = AVDISCARD_NONREF; // same as make_thumbnail
+    }
+    codec_lock();
+    ret = avcodec_open(pCodecCtx, pCodec);
+    codec_unlock();
+    if (ret < 0) {
+        goto error;
+    }
+    pw->pCodecCtx = pCodecCtx;
+
+    pw->pFrame = avcodec_alloc_frame();
+    if (NULL == pw->pFrame) {
+        goto error;
+    }
+
+    // decode the first frame without seeking; see make_thumbnail
+    int64_t first_pts;
+    if (read_and_decode(pw->pFormatCtx, pp->video_index, pCodecCtx, pw->pFrame, &first_pts, 0, 1, &pw->ds) <= 0) {
+        goto error;
+    }
+
+    pw->pSwsCtx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt,
+        pp->shot_width, pp->shot_height, PIX_FMT_RGB24, SWS_BILINEAR, NULL, NULL, NULL);
+    pw->pLumaCtx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt,
+        pp->shot_width, pp->shot_height, PIX_FMT_GRAY8, SWS_BILINEAR, NULL, NULL, NULL);
+    if (NULL == pw->pSwsCtx || NULL == pw->pLumaCtx) {
+        goto error;
+    }
+    return 0;
+
+  error:
+    shot_worker_close(pw);
+    return -1;
+}
+
+/*
+decode the tries of one slot
+*/
+void shot_worker_slot(shot_worker *pw, shot_slot *ps)
+{
+    shot_pool *pp = pw->pool;
+    double tb = av_q2d(pp->time_base);
+    int64_t prevfound_pts = -1;
+    int evade_try;
+
+    decode_state_reset(&pw->ds); // same as make_thumbnail at the start of a slot
+    for (evade_try = 0; evade_try < MAX_PREFETCH_TRY; evade_try++) {
+        int64_t seek_evade = pp->evade_step * evade_try / tb;
+        int64_t eff_target = MAX(ps->seek_target + seek_evade, pp->start_time_tb);
+        if (evade_try > 0) {
+            eff_target = MAX(eff_target, prevfound_pts+1);
+        }
+        if (eff_target > pp->duration_tb) { // end of file
+            return;
+        }
+
+        shot_try *pt = &ps->tries[evade_try];
+        pt->eff_target = eff_target;
+        pt->skip_non_key = pw->ds.skip_non_key;
+        pt->luma = NULL;
+        pt->rgb = NULL;
+        ps->nb_try++;
+
+        if (seek_shot(pw->pFormatCtx, pp->video_index, pw->pCodecCtx, eff_target, 0, pp->duration, pp->pti, pp->psi) < 0) {
+            pt->ret = -1;
+            return;
+        }
+        pt->ret = read_and_decode(pw->pFormatCtx, pp->video_index, pw->pCodecCtx, pw->pFrame, &pt->found_pts, 1, 0, &pw->ds);
+        pt->decoded_frame = pw->ds.decoded_frame;
+        if (pt->ret <= 0) {
+            return;
+        }
+        prevfound_pts = pt->found_pts;
+
+        /* same blank & edge evasion as make_thumbnail; on luma so rejected shots aren't converted */
+        int good = 1;
+        if (pp->evade_step > 0) {
+            pt->luma = av_malloc(pp->luma_bufsize);
+            if (NULL == pt->luma) {
+                pt->ret = -1;
+                return;
+            }
+            AVPicture luma;
+            avpicture_fill(&luma, pt->luma, PIX_FMT_GRAY8, pp->shot_width, pp->shot_height);
+            sws_scale(pw->pLumaCtx, pw->pFrame->data, pw->pFrame->linesize, 0, pw->pCodecCtx->height, 
+                luma.data, luma.linesize);
+
+            double blank = blank_frame(pt->luma, pp->shot_width, pp->shot_height);
+            float edge[EDGE_PARTS] = {1,1,1,1,1,1}; // FIXME: change this if EDGE_PARTS is changed
+            if (blank <= gb_b_blank && gb_D_edge > 0) {
+                gdImagePtr edge_ip = detect_edge(pt->luma, pp->shot_width, pp->shot_height, edge, EDGE_FOUND);
+                if (NULL != edge_ip) {
+                    gdImageDestroy(edge_ip);
+                }
+            }
+            good = (blank <= gb_b_blank && is_edge(edge, EDGE_FOUND));
+        }
+
+        if (good) {
+            pt->rgb = av_malloc(pp->rgb_bufsize);
+            if (NULL == pt->rgb) {
+                pt->ret = -1;
+                return;
+            }
+            AVPicture rgb;
+            avpicture_fill(&rgb, pt->rgb, PIX_FMT_RGB24, pp->shot_width, pp->shot_height);
+            sws_scale(pw->pSwsCtx, pw->pFrame->data, pw->pFrame->linesize, 0, pw->pCodecCtx->height, 
+                rgb.data, rgb.linesize);
+            return;
+        }
+        seek_evade = pp->evade_step * (evade_try + 1) / tb;
+        if (seek_evade >= (pp->step - pp->evade_step) / tb) { // make_thumbnail will skip this shot
+            return;
+        }
+    }
+}
+
+#ifdef WIN32
+unsigned __stdcall shot_worker_thread(void *arg)
+#else
+void *shot_worker_thread(void *arg)
+#endif
+{
+    shot_worker *pw = arg;
+    shot_pool *pp = pw->pool;
+
+    while (1) {
+        int k;
+#ifdef WIN32
+        EnterCriticalSection(&pp->lock);
+        k = pp->next_slot++;
+        LeaveCriticalSection(&pp->lock);
+#else
+        pthread_mutex_lock(&pp->lock);
+        k = pp->next_slot++;
+        pthread_mutex_unlock(&pp->lock);
+#endif
+        if (k >= pp->nb_slot) {
+            break;
+        }
+        shot_worker_slot(pw, &pp->slots[k]);
+    }
+    return 0;
+}
+
+void shot_pool_cleanup(shot_pool *pp)
+{
+    int i, j;
+    if (NULL != pp->slots) {
+        for (i = 0; i < pp->nb_slot; i++) {
+            for (j = 0; j < pp->slots[i].nb_try; j++) {
+                if (NULL != pp->slots[i].tries[j].luma) {
+                    av_free(pp->slots[i].tries[j].luma);
+                }
+                if (NULL != pp->slots[i].tries[j].rgb) {
+                    av_free(pp->slots[i].tries[j].rgb);
+                }
+            }
+        }
+        free(pp->slots);
+        pp->slots = NULL;
+    }
+    pp->nb_slot = 0;
+}
+
+/*
+open nb_worker decoders & decode all slots; pp's job must be filled in and 
+pp->slots[].seek_target set.
+return the # of workers used; 0 if failed, pp is then empty
+*/
+int shot_pool_run(shot_pool *pp, int nb_worker)
+{
+    shot_worker *workers = calloc(nb_worker, sizeof(*workers));
+    if (NULL == workers) {
+        shot_pool_cleanup(pp);
+        return 0;
+    }
+
+    int i, opened = 0;
+    for (i = 0; i < nb_worker; i++) {
+        if (0 != shot_worker_open(&workers[opened], pp)) {
+            av_log(NULL, LOG_INFO, "  opening shot worker %d failed\n", i);
+            continue;
+        }
+        opened++;
+    }
+
+    if (opened > 0) {
+        pp->next_slot = 0;
+#ifdef WIN32
+        InitializeCriticalSection(&pp->lock);
+        HANDLE *threads = calloc(opened, sizeof(*threads));
+        for (i = 0; NULL != threads && i < opened; i++) {
+            threads[i] = (HANDLE) _beginthreadex(NULL, 0, shot_worker_thread, &workers[i], 0, NULL);
+        }
+        for (i = 0; NULL != threads && i < opened; i++) {
+            if (0 == threads[i]) { // couldn't start; do it here
+                shot_worker_thread(&workers[i]);
+            } else {
+                WaitForSingleObject(threads[i], INFINITE);
+                CloseHandle(threads[i]);
+            }
+        }
+        if (NULL == threads) {
+            shot_worker_thread(&workers[0]);
+        }
+        free(threads);
+        DeleteCriticalSection(&pp->lock);
+#else
+        pthread_mutex_init(&pp->lock, NULL);
+        pthread_t *threads = calloc(opened, sizeof(*threads));
+        int *started = calloc(opened, sizeof(*started));
+        for (i = 0; NULL != threads && NULL != started && i < opened; i++) {
+            started[i] = (0 == pthread_create(&threads[i], NULL, shot_worker_thread, &workers[i]));
+        }
+        for (i = 0; NULL != threads && NULL != started && i < opened; i++) {
+            if (started[i]) {
+                pthread_join(threads[i], NULL);
+            } else {
+                shot_worker_thread(&workers[i]);
+            }
+        }
+        if (NULL == threads || NULL == started) {
+            shot_worker_thread(&workers[0]);
+        }
+        free(threads);
+        free(started);
+        pthread_mutex_destroy(&pp->lock);
+#endif
+    } else {
+        shot_pool_cleanup(pp);
+    }
+
+    for (i = 0; i < opened; i++) {
+        shot_worker_close(&workers[i]);
+    }
+    free(workers);
+    return opened;
+}
+
+/*
+return the prefetched try if it was decoded with the same input as make_thumbnail
+would use now; NULL if it has to seek & decode itself
+*/
+shot_try *shot_pool_find(shot_pool *pp, int slot, int evade_try, int64_t eff_target, int skip_non_key)
+{
+    if (slot >= pp->nb_slot || evade_try >= pp->slots[slot].nb_try) {
+        return NULL;
+    }
+    shot_try *pt = &pp->slots[slot].tries[evade_try];
+    if (pt->ret <= 0 || (NULL == pt->luma && NULL == pt->rgb)
+        || pt->eff_target != eff_target || pt->skip_non_key != skip_non_key) {
+        return NULL;
+    }
+    return pt;
+}
+
+/* 
+modify name so that it'll (hopefully) be unique
+by inserting a unique string before suffix.
+if unum is != 0, it'll be used
+returns the unique number
+*/
+int make_unique_name(char *name, char *suffix, int unum)
+{
+    // tmpnam() in mingw always return names which start with \ -- unuseable.
+    // so we'll use random number instead.
+
+    char unique[FILENAME_MAX];
+    if (unum == 0) {
+        unum = rand();
+    }
+    sprintf(unique, "_%d", unum);
+
+    char *found = strlaststr(name, suffix);
+    if (NULL == found || found == name) {
+        strcat(name, unique); // this shouldn't happen
+    } else {
+        strcat(unique, found);
+        strcpy(found, unique);
+    }
+    return unum;
+}
+
+/*
+names of the output & info files being written; under file_lock.
+with -J two input files can have the same output name, e.g. a.ts & a.mpg with -O;
+the later one gets a unique name like when the first one is already done.
+*/
+char **gb_claimed = NULL; // points to thumbnail.out_filename & info_filename
+int gb_nb_claimed = 0, gb_claimed_size = 0;
+
+int file_claimed(char *name)
+{
+    int i;
+    for (i = 0; i < gb_nb_claimed; i++) {
+        if (0 == strcmp(gb_claimed[i], name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+claim the output & info file names of ptn until file_release
+return -1 if failed
+*/
+int file_claim(thumbnail *ptn)
+{
+    if (gb_nb_claimed + 2 > gb_claimed_size) {
+        int size = gb_claimed_size + 16;
+        char **new = realloc(gb_claimed, size * sizeof(*gb_claimed));
+        if (NULL == new) {
+            return -1;
+        }
+        gb_claimed = new;
+        gb_claimed_size = size;
+    }
+    gb_claimed[gb_nb_claimed++] = ptn->out_filename;
+    if ('\0' != ptn->info_filename[0]) {
+        gb_claimed[gb_nb_claimed++] = ptn->info_filename;
+    }
+    return 0;
+}
+
+void file_release(thumbnail *ptn)
+{
+    int i = 0;
+    while (i < gb_nb_claimed) {
+        if (gb_claimed[i] == ptn->out_filename || gb_claimed[i] == ptn->info_filename) {
+            gb_claimed[i] = gb_claimed[--gb_nb_claimed];
+        } else {
+            i++;
+        }
+    }
+}
+
+/*
+the output & info files are written to .tmp files first and renamed when done,
+so no one sees a half written file.
+if saved_filename isn't NULL, the name of the output file is copied to it.
+return 1 if the output file is saved
+*/
+int make_thumbnail(char *file, char *saved_filename)
+{
+    av_log(NULL, AV_LOG_VERBOSE, "make_thumbnail: %s\n", file);
+
+    struct timeval tstart;
+    gettimeofday(&tstart, NULL);
+
+    int i;
+    thumbnail tn; // thumbnail data & info
+    thumb_new(&tn);
+    file_lock();
+    tn.nb_file = ++gb_nb_file;
+    file_unlock();
+    // shot sh; // shot info
+    shot fill_buffer[gb_c_column-1]; // skipped shots to fill the last row
+    for (i=0; i<gb_c_column-1; i++) {
+        fill_buffer[i].ip = NULL;
+    }
+    int nb_shots = 0; // # of decoded shots (stat purposes)
+
+    /* these are checked during cleaning up, must be NULL if not used */
+    AVFormatContext *pFormatCtx = NULL;
+    AVCodecContext *pCodecCtx = NULL;
+    AVFrame *pFrame = NULL;
+    AVFrame *pFrameRGB = NULL;
+    uint8_t *rgb_buffer = NULL;
+    struct SwsContext *pSwsCtx = NULL;
+    uint8_t *luma_buffer = NULL;
+    struct SwsContext *pLumaCtx = NULL;
+    tn.out_ip = NULL;
+    FILE *out_fp = NULL;
+    FILE *info_fp = NULL;
+    gdImagePtr ip = NULL;
+    shot_pool pool; // prefetched shots; see -m option
+    pool.slots = NULL;
+    pool.nb_slot = 0;
+    decode_state ds; // read_and_decode's state for pCodecCtx
+    index_snapshot si; // index after opening; see seek_shot
+    si.entries = NULL;
+    si.nb_entries = 0;
+    ts_index ti; // keyframe index for mpeg-ts
+    ti.nb_rap = 0;
+
+    int t_timestamp = gb_t_timestamp; // local timestamp; can be turned off; 0 = off
+    int ret;
+
+    av_log(NULL, LOG_INFO, "\n");
+
+    /* check if output file already exists & open output file */
+    if (NULL != gb_O_outdir && strlen(gb_O_outdir) > 0) {
+        strcpy_va(tn.out_filename, 3, gb_O_outdir, "/", path_2_file(file));
+        if (NULL != gb_N_suffix)
+            strcpy_va(tn.info_filename, 3, gb_O_outdir, "/", path_2_file(file));
+    } else {
+        strcpy(tn.out_filename, file);
+        if (NULL != gb_N_suffix)
+            strcpy(tn.info_filename, file);
+    }
+    char *suffix = strrchr(tn.out_filename, '.');
+    if (NULL == suffix) {
+        strcat(tn.out_filename, gb_o_suffix);
+    } else {
+        strcpy(suffix, gb_o_suffix);
+    }
+    if (NULL != gb_N_suffix) {
+        suffix = strrchr(tn.info_filename, '.');
+        if (NULL == suffix) {
+            strcat(tn.info_filename, gb_N_suffix);
+        } else {
             strcpy(suffix, gb_N_suffix);
         }
     }
-    // if output files exist and modified time >= program start time,
-    // we'll not overwrite and use a new name
+    // if output files exist and modified time >= program start time, or another
+    // file worker is writing them, we'll not overwrite and use a new name
     int unum = 0;
-    if (is_reg_newer(tn.out_filename, gb_st_start)) {
+    file_lock();
+    if (is_reg_newer(tn.out_filename, gb_st_start) || file_claimed(tn.out_filename)) {
         unum = make_unique_name(tn.out_filename, gb_o_suffix, unum);
         av_log(NULL, LOG_INFO, "%s: output file already exists. using: %s\n", gb_argv0, tn.out_filename);
     }
-    if (NULL != gb_N_suffix && is_reg_newer(tn.info_filename, gb_st_start)) {
+    if (NULL != gb_N_suffix && (is_reg_newer(tn.info_filename, gb_st_start) || file_claimed(tn.info_filename))) {
         unum = make_unique_name(tn.info_filename, gb_N_suffix, unum);
         av_log(NULL, LOG_INFO, "%s: info file already exists. using: %s\n", gb_argv0, tn.info_filename);
     }
+    tn.out_claimed = (0 == file_claim(&tn));
+    file_unlock();
     if (0 == gb_W_overwrite) { // dont overwrite mode
         if (is_reg(tn.out_filename)) {
             av_log(NULL, LOG_INFO, "%s: output file %s already exists. omitted.\n", gb_argv0, tn.out_filename);
@@ -1536,14 +2590,18 @@ void make_thumbnail(char *file)
             goto cleanup;
         }
     }
+    char out_tmpname[UTF8_FILENAME_SIZE];
+    char info_tmpname[UTF8_FILENAME_SIZE];
+    strcpy_va(out_tmpname, 2, tn.out_filename, ".tmp");
+    strcpy_va(info_tmpname, 2, tn.info_filename, ".tmp");
 #if defined(WIN32) && defined(_UNICODE)
     wchar_t out_filename_w[FILENAME_MAX];
-    UTF8_2_WC(out_filename_w, tn.out_filename, FILENAME_MAX);
+    UTF8_2_WC(out_filename_w, out_tmpname, FILENAME_MAX);
     wchar_t info_filename_w[FILENAME_MAX];
-    UTF8_2_WC(info_filename_w, tn.info_filename, FILENAME_MAX);
+    UTF8_2_WC(info_filename_w, info_tmpname, FILENAME_MAX);
 #else
-    char *out_filename_w = tn.out_filename;
-    char *info_filename_w = tn.info_filename;
+    char *out_filename_w = out_tmpname;
+    char *info_filename_w = info_tmpname;
 #endif
     out_fp = _tfopen(out_filename_w, _TEXT("wb"));
     if (NULL == out_fp) {
@@ -1573,14 +2631,20 @@ void make_thumbnail(char *file)
             goto cleanup;
         }
         // Retrieve stream information
-        if((ret = av_find_stream_info(pFormatCtx)) <0)
+        codec_lock();
+        ret = av_find_stream_info(pFormatCtx);
+        codec_unlock();
+        if(ret <0)
         {
             av_log(NULL, AV_LOG_ERROR, "\n%s: av_find_stream_info %s failed: %d\n", gb_argv0, file, ret);
             goto cleanup;
         }
         duration = (double) pFormatCtx->duration / AV_TIME_BASE;
-        if (NULL != pFormatCtx)
+        if (NULL != pFormatCtx) {
+          codec_lock();
           av_close_input_file(pFormatCtx);
+          codec_unlock();
+        }
     }
    
     // Open video file
@@ -1597,13 +2661,15 @@ void make_thumbnail(char *file)
     //pFormatCtx->debug |= FF_FDEBUG_TS;
 
     // Retrieve stream information
+    codec_lock();
     ret = av_find_stream_info(pFormatCtx);
+    codec_unlock();
     
     if (ret < 0) {
         av_log(NULL, AV_LOG_ERROR, "\n%s: av_find_stream_info %s failed: %d\n", gb_argv0, file, ret);
         goto cleanup;
     }
-    dump_format_context(pFormatCtx, nb_file, file, 0);
+    dump_format_context(pFormatCtx, tn.nb_file, file, 0, tn.info);
 
     // Find the first video stream
     // int av_find_default_stream_index(AVFormatContext *s)
@@ -1643,11 +2709,14 @@ void make_thumbnail(char *file)
     }
 
     // Open codec
+    codec_lock();
     ret = avcodec_open(pCodecCtx, pCodec);
+    codec_unlock();
     if (ret < 0) {
         av_log(NULL, AV_LOG_ERROR, "  couldn't open codec %s id %d: %d\n", pCodec->name, pCodec->id, ret);
         goto cleanup;
     }
+    pCodecCtx->opaque = &ds;
     pCodecCtx->get_buffer = our_get_buffer;
     pCodecCtx->release_buffer = our_release_buffer;
 
@@ -1663,11 +2732,16 @@ void make_thumbnail(char *file)
     // is this a codec bug? it seem this value can be in the header or in the stream.
     AVRational sample_aspect_ratio = pCodecCtx->sample_aspect_ratio;
 
+    // keyframe index for mpeg-ts recordings; only useful for seek mode
+    if (1 != gb_Z_nonseek) {
+        ts_index_build(pFormatCtx, video_index, &ti);
+    }
+
     if (((double) pFormatCtx->duration / AV_TIME_BASE) > duration)
       duration = (double) pFormatCtx->duration / AV_TIME_BASE; // can be unknown & can be incorrect (e.g. .vob files)
 
     if (duration <= 0.0) {
-        duration = guess_duration(pFormatCtx, video_index, pCodecCtx, pFrame);
+        duration = guess_duration(pFormatCtx, video_index, pCodecCtx, pFrame, &ti);
         // have to turn timestamping off because it'll be incorrect
         if (1 == gb_t_timestamp) { // on
             t_timestamp = 0;
@@ -1700,13 +2774,17 @@ void make_thumbnail(char *file)
     // for .flv files. bug reported by: dragonbook 
     int64_t found_pts = -1;
     int64_t first_pts = -1; // pts of first frame
-    ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &first_pts, 0, 1);
+    ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &first_pts, 0, 1, &ds);
     if (0 == ret) { // end of file
         goto eof;
     } else if (ret < 0) { // error
         av_log(NULL, AV_LOG_ERROR, "  read_and_decode first failed!\n");
         goto cleanup;
     }
+    if (index_snapshot_take(&si, pStream) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "  couldn't allocate the index snapshot\n");
+        goto cleanup;
+    }
     //av_log(NULL, LOG_INFO, "first_pts: %"PRId64" (%.2f s)\n", first_pts, calc_time(first_pts, pStream->time_base, start_time)); // DEBUG
 
     // set sample_aspect_ratio
@@ -1810,7 +2888,7 @@ void make_thumbnail(char *file)
     if (gb_w_width > 0 && gb_w_width != tn.width) {
         av_log(NULL, LOG_INFO, "  changing width to %d to match movie's size (%dx%d)\n", tn.width, scaled_src_width, tn.column);
     }
-    char *all_text = get_stream_info(pFormatCtx, file, 1, sample_aspect_ratio); // FIXME: using function's static buffer
+    char *all_text = get_stream_info(pFormatCtx, file, 1, sample_aspect_ratio, tn.info);
     if (NULL != info_fp) {
         fprintf(info_fp, all_text);
     }
@@ -1861,6 +2939,22 @@ void make_thumbnail(char *file)
         goto cleanup;
     }
 
+    /* blank & edge detection only need the resized luma */
+    int luma_bufsize = avpicture_get_size(PIX_FMT_GRAY8, tn.shot_width, tn.shot_height);
+    luma_buffer = av_malloc(luma_bufsize);
+    if (NULL == luma_buffer) {
+        av_log(NULL, AV_LOG_ERROR, "  av_malloc %d bytes failed\n", luma_bufsize);
+        goto cleanup;
+    }
+    AVPicture luma_pic;
+    avpicture_fill(&luma_pic, luma_buffer, PIX_FMT_GRAY8, tn.shot_width, tn.shot_height);
+    pLumaCtx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt,
+        tn.shot_width, tn.shot_height, PIX_FMT_GRAY8, SWS_BILINEAR, NULL, NULL, NULL);
+    if (NULL == pLumaCtx) {
+        av_log(NULL, AV_LOG_ERROR, "  sws_getContext failed\n");
+        goto cleanup;
+    }
+
     /* create the output image */
     tn.out_ip = gdImageCreateTrueColor(tn.width, tn.height);
     if (NULL == tn.out_ip) {
@@ -1895,6 +2989,39 @@ void make_thumbnail(char *file)
         av_log(NULL, LOG_INFO, "  *** using non-seek mode -- slower but more accurate timing.\n");
     }
 
+    /* let the workers decode the shots of seek mode in parallel */
+    // verbose mode saves the edge images, which the workers dont keep
+    if (gb_m_worker > 1 && 1 == seek_mode && 0 == gb_v_verbose) {
+        pool.file = file;
+        pool.video_index = video_index;
+        pool.shot_width = tn.shot_width;
+        pool.shot_height = tn.shot_height;
+        pool.step = tn.step;
+        pool.evade_step = evade_step;
+        pool.duration = duration;
+        pool.duration_tb = duration_tb;
+        pool.start_time_tb = start_time_tb;
+        pool.time_base = pStream->time_base;
+        pool.pti = &ti;
+        pool.psi = &si;
+        pool.rgb_bufsize = rgb_bufsize;
+        pool.luma_bufsize = luma_bufsize;
+        pool.nb_slot = tn.row * tn.column;
+        pool.slots = calloc(pool.nb_slot, sizeof(*pool.slots));
+        if (NULL == pool.slots) {
+            pool.nb_slot = 0;
+        } else {
+            // same seek targets as the loop below
+            int64_t slot_target = (tn.step + start_time + gb_B_begin) / av_q2d(pStream->time_base);
+            for (i = 0; i < pool.nb_slot; i++) {
+                pool.slots[i].seek_target = slot_target;
+                slot_target += tn.step / av_q2d(pStream->time_base);
+            }
+            int nb_worker = shot_pool_run(&pool, gb_m_worker);
+            av_log(NULL, AV_LOG_VERBOSE, "  %d shot workers\n", nb_worker);
+        }
+    }
+
     /* decode & fill in the shots */
   restart:
     seek_mode = seek_mode; // target for restart
@@ -1903,6 +3030,7 @@ void make_thumbnail(char *file)
     }
 
     int64_t seek_target, seek_evade = 0; // in time_base unit
+    int slot = 0; // # of times seek_target has been stepped
     int evade_try = 0; // blank screen evasion index
     double avg_evade_try = 0; // average
     int direction = 0; // seek direction (seek flags)
@@ -1940,15 +3068,24 @@ void make_thumbnail(char *file)
         /* jump to next shot */
         //struct timeval dstart; // DEBUG
         //gettimeofday(&dstart, NULL); // calendar time; effected by load & io & etc. DEBUG
-        if (1 == seek_mode) { // seek mode
-            ret = really_seek(pFormatCtx, video_index, eff_target, direction, duration);
+        shot_try *prefetched = NULL;
+        if (1 == seek_mode && 0 == evade_try) {
+            decode_state_reset(&ds); // a slot doesn't depend on the ones before it
+        }
+        if (1 == seek_mode && 0 == direction) {
+            prefetched = shot_pool_find(&pool, slot, evade_try, eff_target, ds.skip_non_key);
+        }
+        if (NULL != prefetched) { // already decoded by a worker
+            found_pts = prefetched->found_pts;
+            decode_state_add_run(&ds, prefetched->decoded_frame);
+        } else if (1 == seek_mode) { // seek mode
+            ret = seek_shot(pFormatCtx, video_index, pCodecCtx, eff_target, direction, duration, &ti, &si);
             if (ret < 0) {
                 av_log(NULL, AV_LOG_ERROR, "  seeking to to %.2f s failed\n", calc_time(eff_target, pStream->time_base, start_time));
                 goto cleanup;
             }
-            avcodec_flush_buffers(pCodecCtx);
 
-            ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &found_pts, 1, 0);
+            ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &found_pts, 1, 0, &ds);
             if (0 == ret) { // end of file
                 goto eof;
             } else if (ret < 0) { // error
@@ -1960,7 +3097,7 @@ void make_thumbnail(char *file)
             found_pts = 0;
             while (found_pts < eff_target) {
                 // we should check if it's taking too long for this loop. FIXME
-                ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &found_pts, 0, 0);
+                ret = read_and_decode(pFormatCtx, video_index, pCodecCtx, pFrame, &found_pts, 0, 0, &ds);
                 if (0 == ret) { // end of file
                     goto eof;
                 } else if (ret < 0) { // error
@@ -2046,23 +3183,25 @@ void make_thumbnail(char *file)
             goto skip_shot;
         }
 
-        /* convert to PIX_FMT_RGB24 & resize */
-        sws_scale(pSwsCtx, pFrame->data, pFrame->linesize, 0, pCodecCtx->height, 
-            pFrameRGB->data, pFrameRGB->linesize);
-        /*
-        sprintf(debug_filename, "%s_resized%05d.jpg", tn.out_filename, nb_shots - 1); // DEBUG
-        save_AVFrame(pFrameRGB, tn.shot_width, tn.shot_height, PIX_FMT_RGB24, 
-            debug_filename, tn.shot_width, tn.shot_height);
-        */
-
         /* if blank screen, try again */
         // FIXME: make sure this'll work when step is small
         // FIXME: make sure each shot wont get repeated
-        double blank = blank_frame(pFrameRGB, tn.shot_width, tn.shot_height);
-        // only do edge when blank detection doesn't work
+        // done on the resized luma; only good shots are converted to PIX_FMT_RGB24
+        double blank = 0;
         float edge[EDGE_PARTS] = {1,1,1,1,1,1}; // FIXME: change this if EDGE_PARTS is changed
-        if (evade_step > 0 && blank <= gb_b_blank && gb_D_edge > 0) {
-            edge_ip = detect_edge(pFrameRGB, tn.shot_width, tn.shot_height, edge, EDGE_FOUND);
+        if (evade_step > 0) {
+            uint8_t *luma = luma_buffer;
+            if (NULL != prefetched) {
+                luma = prefetched->luma;
+            } else {
+                sws_scale(pLumaCtx, pFrame->data, pFrame->linesize, 0, pCodecCtx->height, 
+                    luma_pic.data, luma_pic.linesize);
+            }
+            blank = blank_frame(luma, tn.shot_width, tn.shot_height);
+            // only do edge when blank detection doesn't work
+            if (blank <= gb_b_blank && gb_D_edge > 0) {
+                edge_ip = detect_edge(luma, tn.shot_width, tn.shot_height, edge, EDGE_FOUND);
+            }
         }
         //av_log(NULL, AV_LOG_VERBOSE, "  idx: %d, evade_try: %d, blank: %.2f%s edge: %.3f %.3f %.3f %.3f %.3f %.3f%s\n", 
         //    idx, evade_try, blank, (blank > gb_b_blank) ? "**b**" : "", 
@@ -2087,6 +3226,20 @@ void make_thumbnail(char *file)
             goto skip_shot;
         }
 
+        /* convert to PIX_FMT_RGB24 & resize */
+        if (NULL != prefetched) {
+            assert(NULL != prefetched->rgb); // the worker accepted it too
+            memcpy(rgb_buffer, prefetched->rgb, rgb_bufsize);
+        } else {
+            sws_scale(pSwsCtx, pFrame->data, pFrame->linesize, 0, pCodecCtx->height, 
+                pFrameRGB->data, pFrameRGB->linesize);
+        }
+        /*
+        sprintf(debug_filename, "%s_resized%05d.jpg", tn.out_filename, nb_shots - 1); // DEBUG
+        save_AVFrame(pFrameRGB, tn.shot_width, tn.shot_height, PIX_FMT_RGB24, 
+            debug_filename, tn.shot_width, tn.shot_height);
+        */
+
         //
         avg_evade_try = (avg_evade_try * idx + evade_try ) / (idx+1); // DEBUG
         //av_log(NULL, AV_LOG_VERBOSE, "  *** avg_evade_try: %.2f\n", avg_evade_try); // DEBUG
@@ -2151,6 +3304,7 @@ void make_thumbnail(char *file)
       skip_shot:
         /* step */
         seek_target += tn.step / av_q2d(pStream->time_base);
+        slot++;
         
         seek_evade = 0;
         direction = 0;
@@ -2185,123 +3339,807 @@ void make_thumbnail(char *file)
         }
     }
 
-    /* fill in the last row if some shots were skipped */
+    /* fill in the last row if some shots were skipped */
+
+    /* save output image */
+    errno = 0;
+    gdImageJpeg(tn.out_ip, out_fp, gb_j_quality);  /* FIXME: how to check if write was successful? */
+    if (0 != errno) { // FIXME: this should work?
+        av_log(NULL, AV_LOG_ERROR, "  saving output image failed: %s\n", strerror(errno));
+        goto cleanup;
+    }
+    tn.out_saved = 1;
+
+    struct timeval tfinish;
+    gettimeofday(&tfinish, NULL); // calendar time; effected by load & io & etc.
+    double diff_time = (tfinish.tv_sec + tfinish.tv_usec/1000000.0) - (tstart.tv_sec + tstart.tv_usec/1000000.0);
+    // previous version reported # of decoded shots/s; now we report the # of final shots/s
+    //av_log(NULL, LOG_INFO, "  avg. %.2f shots/s; output file: %s\n", nb_shots / diff_time, tn.out_filename);
+    av_log(NULL, LOG_INFO, "  %.2f s, %.2f shots/s; output: %s\n", 
+        diff_time, (tn.idx + 1) / diff_time, tn.out_filename);
+
+  cleanup:
+    if (NULL != ip)
+        gdImageDestroy(ip);
+    if (NULL != tn.out_ip)
+        gdImageDestroy(tn.out_ip);
+
+    if (NULL != out_fp) {
+        if (0 != fclose(out_fp)) {
+            tn.out_saved = 0;
+        }
+    }
+    if (NULL != info_fp) {
+        if (0 != fclose(info_fp)) {
+            tn.out_saved = 0;
+        }
+    }
+    // info file first; whoever waits for the output file will find both
+    if (1 == tn.out_saved && NULL != info_fp && 0 != rename_replace(info_tmpname, tn.info_filename)) {
+        av_log(NULL, AV_LOG_ERROR, "  renaming %s failed: %s\n", info_tmpname, strerror(errno));
+        tn.out_saved = 0;
+    }
+    if (1 == tn.out_saved && 0 != rename_replace(out_tmpname, tn.out_filename)) {
+        av_log(NULL, AV_LOG_ERROR, "  renaming %s failed: %s\n", out_tmpname, strerror(errno));
+        tn.out_saved = 0;
+    }
+    if (NULL != out_fp && 1 != tn.out_saved) {
+        _tunlink(out_filename_w);
+    }
+    if (NULL != info_fp && 1 != tn.out_saved) {
+        _tunlink(info_filename_w);
+    }
+    if (1 == tn.out_saved && NULL != saved_filename) {
+        strcpy(saved_filename, tn.out_filename);
+    }
+
+    if (NULL != pSwsCtx)
+        sws_freeContext(pSwsCtx); // do we need to do this?
+    if (NULL != pLumaCtx)
+        sws_freeContext(pLumaCtx);
+
+    // Free the video frame
+    if (NULL != luma_buffer)
+        av_free(luma_buffer);
+    if (NULL != rgb_buffer)
+        av_free(rgb_buffer);
+    if (NULL != pFrameRGB)
+        av_free(pFrameRGB);
+    if (NULL != pFrame)
+        av_free(pFrame);
+
+    // Close the codec
+    codec_lock();
+    if (NULL != pCodecCtx && NULL != pCodecCtx->codec) {
+        avcodec_close(pCodecCtx);
+    }
+
+    // Close the video file
+    if (NULL != pFormatCtx)
+        av_close_input_file(pFormatCtx);
+    codec_unlock();
+
+    if (1 == tn.out_claimed) {
+        file_lock();
+        file_release(&tn);
+        file_unlock();
+    }
+
+    thumb_cleanup_dynamic(&tn);
+    shot_pool_cleanup(&pool);
+    index_snapshot_free(&si);
+    
+    av_log(NULL, AV_LOG_VERBOSE, "make_thumbnail: done\n");
+    return tn.out_saved;
+}
+
+/* modified from glibc
+*/
+int alphasort(const void *a, const void *b)
+{
+    return strcoll(*(const char **) a, *(const char **) b);
+    //return strcasecmp(*(const char **) a, *(const char **) b);
+}
+
+/* modified from glibc
+*/
+int alphacasesort(const void *a, const void *b)
+{
+    //return strcoll(*(const char **) a, *(const char **) b);
+    return strcasecmp(*(const char **) a, *(const char **) b);
+}
+
+/*
+return 1 if filename has one of the predefined extensions
+*/
+int check_extension(char *filename)
+{
+    static char *movie_ext[] = {
+        "3gp", "3g2", "asf", "avi", "avs", "dat", "divx", "dsm", "evo", "flv", 
+        "m1v", "m2ts", "m2v", "m4a", "mj2", "mjpg", "mjpeg", "mkv", "mov", 
+        "moov", "mp4", "mpg", "mpeg", "mpv", "nut", "ogg", "ogm", "qt", "rm", 
+        "rmvb", "swf", "ts", "vob", "wmv", "xvid"
+    }; // FIXME: static
+    static int sorted = 0; // 1 = sorted
+
+    static const int nb_ext = sizeof(movie_ext) / sizeof(*movie_ext);
+    if (0 == sorted) {
+        qsort(movie_ext, nb_ext, sizeof(*movie_ext), alphacasesort);
+        sorted = 1;
+    }
+
+    char *ext = strrchr(filename, '.');
+    if (NULL == ext) {
+        return 0;
+    }
+    ext += 1;
+    if (NULL == bsearch(&ext, movie_ext, nb_ext, sizeof(*movie_ext), alphacasesort)) {
+        return 0;
+    }
+    if (NULL != strstr(filename, "uTorrentPartFile")) {
+        return 0;
+    }
+    return 1;
+}
+
+void process_loop(int n, char **files);
+
+/* modified from glibc's scandir -- mingw doesn't have scandir
+*/
+void process_dir(char *dir)
+{
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t dir_w[FILENAME_MAX];
+    UTF8_2_WC(dir_w, dir, FILENAME_MAX);
+#else
+    char *dir_w = dir;
+#endif
+
+    _TDIR *dp = _topendir(dir_w);
+    if (NULL == dp) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: opendir failed: %s\n", dir, strerror(errno));
+        return;
+    }
+
+    /* read directory & sort */
+    struct _tdirent *d;
+    char **v = NULL;
+    size_t cnt = 0, vsize = 0;
+    while (1) {
+        errno = 0;
+        d = _treaddir(dp);
+        if (NULL == d) {
+            if (0 != errno) { // is this check good?
+                av_log(NULL, AV_LOG_ERROR, "\n%s: readdir failed: %s\n", dir, strerror(errno));
+                goto cleanup;
+            }
+            break;
+        }
+
+        if (_tcscmp(d->d_name, _TEXT(".")) == 0 || _tcscmp(d->d_name, _TEXT("..")) == 0) {
+            continue;
+        }
+
+#if defined(WIN32) && defined(_UNICODE)
+        char d_name_utf8[UTF8_FILENAME_SIZE];
+        WC_2_UTF8(d_name_utf8, d->d_name, UTF8_FILENAME_SIZE);
+#else
+        char *d_name_utf8 = d->d_name;
+#endif
+
+        char child_utf8[UTF8_FILENAME_SIZE];
+        strcpy_va(child_utf8, 3, dir, "/", d_name_utf8);
+
+        if (1 != is_dir(child_utf8) && 1 != check_extension(child_utf8)) {
+            continue;
+        }
+
+        if (cnt == vsize) {
+            char **new;
+            if (vsize == 0)
+                vsize = 50;
+            else
+                vsize *= 2;
+            new = realloc(v, vsize * sizeof(*v));
+            if (new == NULL) {
+                // mingw doesn't seem to set errno for memory functions
+                av_log(NULL, AV_LOG_ERROR, "\n%s: realloc failed: %s\n", dir, strerror(errno));
+                goto cleanup;
+            }
+            v = new;
+        }
+
+        char *vnew = malloc(strlen(child_utf8) + 1); // for '\0'
+        if (vnew == NULL) {
+            av_log(NULL, AV_LOG_ERROR, "\n%s: malloc failed: %s\n", dir, strerror(errno));
+            goto cleanup;
+        }
+        strcpy(vnew, child_utf8);
+        v[cnt++] = vnew;
+        //av_log(NULL, LOG_INFO, "process_dir added: %s\n", v[cnt-1]); // DEBUG
+    }
+    qsort(v, cnt, sizeof(*v), alphasort);
+
+    /* process dirs & files */
+    process_loop(cnt, v);
+
+  cleanup:
+    while (cnt > 0)
+        free(v[--cnt]);
+    free(v);
+    _tclosedir(dp);
+}
+
+/* index of thumbnailed files (-X)
+one line per input file: size mtime hash<TAB>input<TAB>output
+new entries are appended as files are done, a later line replaces an earlier one
+for the same input. the file is rewritten without the replaced lines at exit, or
+earlier when they make up more than half of it.
+*/
+typedef struct index_entry
+{
+    file_sig sig;
+    char *in;
+    char *out;
+} index_entry;
+
+index_entry *gb_index = NULL;
+int gb_index_cnt = 0, gb_index_size = 0;
+int gb_index_loaded = 0;
+int *gb_index_hash = NULL; // open addressing; entry # + 1, 0 = empty
+int gb_index_hash_size = 0; // power of 2, more than twice gb_index_cnt
+FILE *gb_index_fp = NULL; // index file opened for appending
+int gb_index_lines = 0; // lines in the index file
+
+/*
+FNV-1a
+*/
+unsigned int index_hash(char *file)
+{
+    unsigned int h = 2166136261u;
+    for (; '\0' != *file; file++) {
+        h = (h ^ (unsigned char) *file) * 16777619u;
+    }
+    return h;
+}
+
+/*
+return the hash slot of file's entry, or the empty slot where it would go
+*/
+int index_slot(char *file)
+{
+    int mask = gb_index_hash_size - 1;
+    int slot = index_hash(file) & mask;
+    while (0 != gb_index_hash[slot] && 0 != strcmp(gb_index[gb_index_hash[slot] - 1].in, file)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*
+make room for one more entry in the hash table
+return 0 if ok
+*/
+int index_hash_grow()
+{
+    if ((gb_index_cnt + 1) * 2 < gb_index_hash_size) {
+        return 0;
+    }
+    int size = (0 == gb_index_hash_size) ? 128 : gb_index_hash_size * 2;
+    int *new = calloc(size, sizeof(*new));
+    if (NULL == new) {
+        return -1;
+    }
+    free(gb_index_hash);
+    gb_index_hash = new;
+    gb_index_hash_size = size;
+    int i;
+    for (i = 0; i < gb_index_cnt; i++) {
+        gb_index_hash[index_slot(gb_index[i].in)] = i + 1;
+    }
+    return 0;
+}
+
+/*
+return index of the entry for file, or -1
+*/
+int index_find(char *file)
+{
+    if (0 == gb_index_hash_size) {
+        return -1;
+    }
+    return gb_index_hash[index_slot(file)] - 1;
+}
+
+/*
+add or replace entry
+return 0 if ok
+*/
+int index_set(char *in, char *out, file_sig *psig)
+{
+    char *in_dup = strdup(in);
+    char *out_dup = strdup(out);
+    if (NULL == in_dup || NULL == out_dup) {
+        goto error;
+    }
+    int i = index_find(in);
+    if (i < 0) {
+        if (0 != index_hash_grow()) {
+            goto error;
+        }
+        if (gb_index_cnt == gb_index_size) {
+            int size = (0 == gb_index_size) ? 50 : gb_index_size * 2;
+            index_entry *new = realloc(gb_index, size * sizeof(*gb_index));
+            if (NULL == new) {
+                goto error;
+            }
+            gb_index = new;
+            gb_index_size = size;
+        }
+        i = gb_index_cnt++;
+        gb_index_hash[index_slot(in)] = i + 1;
+    } else {
+        free(gb_index[i].in);
+        free(gb_index[i].out);
+    }
+    gb_index[i].sig = *psig;
+    gb_index[i].in = in_dup;
+    gb_index[i].out = out_dup;
+    return 0;
+
+  error:
+    free(in_dup);
+    free(out_dup);
+    return -1;
+}
+
+/*
+load the index file once; a missing file is an empty index
+*/
+void index_load()
+{
+    if (1 == gb_index_loaded) {
+        return;
+    }
+    gb_index_loaded = 1;
+
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t index_w[FILENAME_MAX];
+    UTF8_2_WC(index_w, gb_X_index, FILENAME_MAX);
+#else
+    char *index_w = gb_X_index;
+#endif
+    FILE *fp = _tfopen(index_w, _TEXT("rb"));
+    if (NULL == fp) {
+        return;
+    }
+    size_t line_size = UTF8_FILENAME_SIZE * 2 + 64;
+    char *line = malloc(line_size);
+    if (NULL == line) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: malloc failed: %s\n", gb_X_index, strerror(errno));
+        goto cleanup;
+    }
+    while (NULL != fgets(line, line_size, fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *in = strchr(line, '\t');
+        char *out = (NULL == in) ? NULL : strchr(in + 1, '\t');
+        gb_index_lines++;
+        if (NULL == out) {
+            continue; // broken line
+        }
+        *in++ = '\0';
+        *out++ = '\0';
+
+        file_sig sig;
+        char *tailptr;
+        sig.size = strtoll(line, &tailptr, 10);
+        sig.mtime = strtoll(tailptr, &tailptr, 10);
+        sig.hash = strtoul(tailptr, &tailptr, 10);
+        if (0 != index_set(in, out, &sig)) {
+            av_log(NULL, AV_LOG_ERROR, "\n%s: out of memory\n", gb_X_index);
+            break;
+        }
+    }
+    av_log(NULL, AV_LOG_VERBOSE, "index_load: %d entries from %s\n", gb_index_cnt, gb_X_index);
+
+  cleanup:
+    free(line);
+    fclose(fp);
+}
+
+void index_write_entry(FILE *fp, int i)
+{
+    fprintf(fp, "%"PRId64" %"PRId64" %u\t%s\t%s\n", gb_index[i].sig.size, (int64_t) gb_index[i].sig.mtime,
+        gb_index[i].sig.hash, gb_index[i].in, gb_index[i].out);
+}
+
+/*
+write the whole index to a .tmp file and rename it
+*/
+void index_save()
+{
+    char tmpname[UTF8_FILENAME_SIZE];
+    strcpy_va(tmpname, 2, gb_X_index, ".tmp");
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t tmpname_w[FILENAME_MAX];
+    UTF8_2_WC(tmpname_w, tmpname, FILENAME_MAX);
+#else
+    char *tmpname_w = tmpname;
+#endif
+    FILE *fp = _tfopen(tmpname_w, _TEXT("wb"));
+    if (NULL == fp) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: creating index failed: %s\n", tmpname, strerror(errno));
+        return;
+    }
+    int i;
+    for (i = 0; i < gb_index_cnt; i++) {
+        index_write_entry(fp, i);
+    }
+    if (0 != fclose(fp) || 0 != rename_replace(tmpname, gb_X_index)) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: saving index failed: %s\n", gb_X_index, strerror(errno));
+        _tunlink(tmpname_w);
+        return;
+    }
+    gb_index_lines = gb_index_cnt;
+}
+
+/*
+append entry i to the index file, so an interrupted batch isn't lost
+*/
+void index_append(int i)
+{
+    if (gb_index_lines > 2 * gb_index_cnt + 100) {
+        // mostly replaced lines; write it anew
+        if (NULL != gb_index_fp) {
+            fclose(gb_index_fp);
+            gb_index_fp = NULL;
+        }
+        index_save();
+        return;
+    }
+    if (NULL == gb_index_fp) {
+#if defined(WIN32) && defined(_UNICODE)
+        wchar_t index_w[FILENAME_MAX];
+        UTF8_2_WC(index_w, gb_X_index, FILENAME_MAX);
+#else
+        char *index_w = gb_X_index;
+#endif
+        gb_index_fp = _tfopen(index_w, _TEXT("ab"));
+        if (NULL == gb_index_fp) {
+            av_log(NULL, AV_LOG_ERROR, "\n%s: opening index failed: %s\n", gb_X_index, strerror(errno));
+            return;
+        }
+    }
+    index_write_entry(gb_index_fp, i);
+    if (0 != fflush(gb_index_fp)) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: saving index failed: %s\n", gb_X_index, strerror(errno));
+    }
+    gb_index_lines++;
+}
+
+/*
+close the index file at exit; drop the replaced lines
+*/
+void index_close()
+{
+    if (NULL != gb_index_fp) {
+        fclose(gb_index_fp);
+        gb_index_fp = NULL;
+    }
+    if (gb_index_lines > gb_index_cnt) {
+        index_save();
+    }
+}
+
+/*
+make thumbnail unless the index says the file hasn't changed since the last run
+called by the file workers with -J; the index is shared under file_lock.
+*/
+void thumbnail_file(char *file)
+{
+    if (NULL == gb_X_index) {
+        make_thumbnail(file, NULL);
+        return;
+    }
+
+    file_sig sig;
+    if (0 != get_file_sig(file, &sig)) {
+        make_thumbnail(file, NULL); // let make_thumbnail report the error
+        return;
+    }
+    file_lock();
+    index_load();
+    int i = index_find(file);
+    int unchanged = (i >= 0 && gb_index[i].sig.size == sig.size && gb_index[i].sig.mtime == sig.mtime 
+        && gb_index[i].sig.hash == sig.hash && 1 == is_reg(gb_index[i].out));
+    file_unlock();
+    if (unchanged) {
+        av_log(NULL, AV_LOG_VERBOSE, "thumbnail_file: %s is unchanged; skipped\n", file);
+        return;
+    }
 
-    /* save output image */
-    errno = 0;
-    gdImageJpeg(tn.out_ip, out_fp, gb_j_quality);  /* FIXME: how to check if write was successful? */
-    if (0 != errno) { // FIXME: this should work?
-        av_log(NULL, AV_LOG_ERROR, "  saving output image failed: %s\n", strerror(errno));
-        goto cleanup;
+    char saved_filename[UTF8_FILENAME_SIZE];
+    if (1 == make_thumbnail(file, saved_filename)) {
+        file_lock();
+        if (0 == index_set(file, saved_filename, &sig)) {
+            index_append(index_find(file));
+        }
+        file_unlock();
     }
-    tn.out_saved = 1;
+}
 
-    struct timeval tfinish;
-    gettimeofday(&tfinish, NULL); // calendar time; effected by load & io & etc.
-    double diff_time = (tfinish.tv_sec + tfinish.tv_usec/1000000.0) - (tstart.tv_sec + tstart.tv_usec/1000000.0);
-    // previous version reported # of decoded shots/s; now we report the # of final shots/s
-    //av_log(NULL, LOG_INFO, "  avg. %.2f shots/s; output file: %s\n", nb_shots / diff_time, tn.out_filename);
-    av_log(NULL, LOG_INFO, "  %.2f s, %.2f shots/s; output: %s\n", 
-        diff_time, (tn.idx + 1) / diff_time, tn.out_filename);
+/*
+file workers (-J option)
+the main thread queues the files it finds & each worker thumbnails one file at a
+time with its own decoder, so up to gb_J_file files are done at the same time.
+the queue holds FILE_QUEUE files per worker; when it's full the main thread waits,
+so a big directory or spool job isn't read ahead much further than the workers get.
+*/
+#define FILE_QUEUE 2 // queued files per worker
 
-  cleanup:
-    if (NULL != ip)
-        gdImageDestroy(ip);
-    if (NULL != tn.out_ip)
-        gdImageDestroy(tn.out_ip);
+typedef struct file_pool
+{
+    char **queue; // ring buffer of file names
+    int size;
+    int head; // next to take
+    int nb_queued;
+    int nb_busy; // queued or being thumbnailed
+    int quit;
+    int nb_worker;
+#ifdef WIN32
+    HANDLE *threads;
+    HANDLE queued; // semaphore; # of queued files
+    HANDLE space; // semaphore; # of free queue entries
+    HANDLE idle; // manual reset event; set when nb_busy is 0
+#else
+    pthread_t *threads;
+    pthread_cond_t changed;
+#endif
+} file_pool;
 
-    if (NULL != out_fp) {
-        fclose(out_fp);
-        if (1 != tn.out_saved) {
-            _tunlink(out_filename_w);
+file_pool gb_file_pool; // running if nb_worker > 0
+
+#ifdef WIN32
+unsigned __stdcall file_worker_thread(void *arg)
+#else
+void *file_worker_thread(void *arg)
+#endif
+{
+    file_pool *pp = arg;
+    while (1) {
+#ifdef WIN32
+        WaitForSingleObject(pp->queued, INFINITE);
+#endif
+        file_lock();
+#ifndef WIN32
+        while (0 == pp->nb_queued && 0 == pp->quit) {
+            pthread_cond_wait(&pp->changed, &gb_file_lock);
         }
-    }
-    if (NULL != info_fp) {
-        fclose(info_fp);
-        if (1 != tn.out_saved) {
-            _tunlink(info_filename_w);
+#endif
+        if (0 == pp->nb_queued) { // quit
+            file_unlock();
+            break;
         }
-    }
-
-    if (NULL != pSwsCtx)
-        sws_freeContext(pSwsCtx); // do we need to do this?
+        char *file = pp->queue[pp->head];
+        pp->head = (pp->head + 1) % pp->size;
+        pp->nb_queued--;
+#ifdef WIN32
+        ReleaseSemaphore(pp->space, 1, NULL);
+#else
+        pthread_cond_broadcast(&pp->changed);
+#endif
+        file_unlock();
 
-    // Free the video frame
-    if (NULL != rgb_buffer)
-        av_free(rgb_buffer);
-    if (NULL != pFrameRGB)
-        av_free(pFrameRGB);
-    if (NULL != pFrame)
-        av_free(pFrame);
+        thumbnail_file(file);
+        free(file);
 
-    // Close the codec
-    if (NULL != pCodecCtx && NULL != pCodecCtx->codec) {
-        avcodec_close(pCodecCtx);
+        file_lock();
+        pp->nb_busy--;
+#ifdef WIN32
+        if (0 == pp->nb_busy) {
+            SetEvent(pp->idle);
+        }
+#else
+        pthread_cond_broadcast(&pp->changed);
+#endif
+        file_unlock();
     }
+    return 0;
+}
 
-    // Close the video file
-    if (NULL != pFormatCtx)
-        av_close_input_file(pFormatCtx);
+/*
+start nb_worker file workers
+return the # of workers started; 0 if none, files are then done by the caller
+*/
+int file_pool_start(file_pool *pp, int nb_worker)
+{
+    memset(pp, 0, sizeof(*pp));
+    pp->size = nb_worker * FILE_QUEUE;
+    pp->queue = calloc(pp->size, sizeof(*pp->queue));
+    pp->threads = calloc(nb_worker, sizeof(*pp->threads));
+    if (NULL == pp->queue || NULL == pp->threads) {
+        goto error;
+    }
+#ifdef WIN32
+    pp->queued = CreateSemaphore(NULL, 0, pp->size, NULL);
+    pp->space = CreateSemaphore(NULL, pp->size, pp->size, NULL);
+    pp->idle = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (NULL == pp->queued || NULL == pp->space || NULL == pp->idle) {
+        goto error;
+    }
+    for (pp->nb_worker = 0; pp->nb_worker < nb_worker; pp->nb_worker++) {
+        pp->threads[pp->nb_worker] = (HANDLE) _beginthreadex(NULL, 0, file_worker_thread, pp, 0, NULL);
+        if (0 == pp->threads[pp->nb_worker]) {
+            break;
+        }
+    }
+#else
+    pthread_cond_init(&pp->changed, NULL);
+    for (pp->nb_worker = 0; pp->nb_worker < nb_worker; pp->nb_worker++) {
+        if (0 != pthread_create(&pp->threads[pp->nb_worker], NULL, file_worker_thread, pp)) {
+            break;
+        }
+    }
+#endif
+    if (0 == pp->nb_worker) {
+        goto error;
+    }
+    return pp->nb_worker;
 
-    thumb_cleanup_dynamic(&tn);
-    
-    av_log(NULL, AV_LOG_VERBOSE, "make_thumbnail: done\n");
+  error:
+#ifdef WIN32
+    if (NULL != pp->queued)
+        CloseHandle(pp->queued);
+    if (NULL != pp->space)
+        CloseHandle(pp->space);
+    if (NULL != pp->idle)
+        CloseHandle(pp->idle);
+#else
+    if (NULL != pp->threads)
+        pthread_cond_destroy(&pp->changed);
+#endif
+    free(pp->queue);
+    free(pp->threads);
+    memset(pp, 0, sizeof(*pp));
+    return 0;
 }
 
-/* modified from glibc
+/*
+queue a file; waits while the queue is full
 */
-int alphasort(const void *a, const void *b)
+void file_pool_add(file_pool *pp, char *file)
 {
-    return strcoll(*(const char **) a, *(const char **) b);
-    //return strcasecmp(*(const char **) a, *(const char **) b);
+    char *copy = strdup(file);
+    if (NULL == copy) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: malloc failed: %s\n", file, strerror(errno));
+        return;
+    }
+#ifdef WIN32
+    WaitForSingleObject(pp->space, INFINITE);
+    file_lock();
+#else
+    file_lock();
+    while (pp->nb_queued == pp->size) {
+        pthread_cond_wait(&pp->changed, &gb_file_lock);
+    }
+#endif
+    pp->queue[(pp->head + pp->nb_queued) % pp->size] = copy;
+    pp->nb_queued++;
+    pp->nb_busy++;
+#ifdef WIN32
+    ResetEvent(pp->idle);
+    ReleaseSemaphore(pp->queued, 1, NULL);
+#else
+    pthread_cond_broadcast(&pp->changed);
+#endif
+    file_unlock();
 }
 
-/* modified from glibc
+/*
+wait until all queued files are done
 */
-int alphacasesort(const void *a, const void *b)
+void file_pool_wait(file_pool *pp)
 {
-    //return strcoll(*(const char **) a, *(const char **) b);
-    return strcasecmp(*(const char **) a, *(const char **) b);
+#ifdef WIN32
+    WaitForSingleObject(pp->idle, INFINITE);
+#else
+    file_lock();
+    while (pp->nb_busy > 0) {
+        pthread_cond_wait(&pp->changed, &gb_file_lock);
+    }
+    file_unlock();
+#endif
 }
 
 /*
-return 1 if filename has one of the predefined extensions
+finish the queued files & stop the workers
 */
-int check_extension(char *filename)
+void file_pool_stop(file_pool *pp)
 {
-    static char *movie_ext[] = {
-        "3gp", "3g2", "asf", "avi", "avs", "dat", "divx", "dsm", "evo", "flv", 
-        "m1v", "m2ts", "m2v", "m4a", "mj2", "mjpg", "mjpeg", "mkv", "mov", 
-        "moov", "mp4", "mpg", "mpeg", "mpv", "nut", "ogg", "ogm", "qt", "rm", 
-        "rmvb", "swf", "ts", "vob", "wmv", "xvid"
-    }; // FIXME: static
-    static int sorted = 0; // 1 = sorted
-
-    static const int nb_ext = sizeof(movie_ext) / sizeof(*movie_ext);
-    if (0 == sorted) {
-        qsort(movie_ext, nb_ext, sizeof(*movie_ext), alphacasesort);
-        sorted = 1;
+    int i;
+    file_pool_wait(pp);
+    file_lock();
+    pp->quit = 1;
+#ifdef WIN32
+    ReleaseSemaphore(pp->queued, pp->nb_worker, NULL);
+#else
+    pthread_cond_broadcast(&pp->changed);
+#endif
+    file_unlock();
+    for (i = 0; i < pp->nb_worker; i++) {
+#ifdef WIN32
+        WaitForSingleObject(pp->threads[i], INFINITE);
+        CloseHandle(pp->threads[i]);
+#else
+        pthread_join(pp->threads[i], NULL);
+#endif
     }
+#ifdef WIN32
+    CloseHandle(pp->queued);
+    CloseHandle(pp->space);
+    CloseHandle(pp->idle);
+#else
+    pthread_cond_destroy(&pp->changed);
+#endif
+    free(pp->queue);
+    free(pp->threads);
+    memset(pp, 0, sizeof(*pp));
+}
 
-    char *ext = strrchr(filename, '.');
-    if (NULL == ext) {
-        return 0;
+/*
+read file names from stdin, one per line
+*/
+void process_stdin()
+{
+    char line[UTF8_FILENAME_SIZE];
+    while (NULL != fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ('\0' == line[0] || 0 == strcmp(line, "-")) {
+            continue;
+        }
+        char *files[1] = {line};
+        process_loop(1, files);
     }
-    ext += 1;
-    if (NULL == bsearch(&ext, movie_ext, nb_ext, sizeof(*movie_ext), alphacasesort)) {
-        return 0;
+}
+
+/*
+read file names from a job file, one per line
+*/
+void process_job(char *job)
+{
+#if defined(WIN32) && defined(_UNICODE)
+    wchar_t job_w[FILENAME_MAX];
+    UTF8_2_WC(job_w, job, FILENAME_MAX);
+#else
+    char *job_w = job;
+#endif
+    FILE *fp = _tfopen(job_w, _TEXT("rb"));
+    if (NULL == fp) {
+        av_log(NULL, AV_LOG_ERROR, "\n%s: open failed: %s\n", job, strerror(errno));
+        return;
     }
-    if (NULL != strstr(filename, "uTorrentPartFile")) {
-        return 0;
+    char line[UTF8_FILENAME_SIZE];
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ('\0' == line[0] || 0 == strcmp(line, "-")) {
+            continue;
+        }
+        char *files[1] = {line};
+        process_loop(1, files);
     }
-    return 1;
+    fclose(fp);
 }
 
-void process_loop(int n, char **files);
+#define SPOOL_POLL 2 // seconds between each scan of the spool directory
 
-/* modified from glibc's scandir -- mingw doesn't have scandir
+/*
+batch mode: keep processing job files dropped in the spool directory (-Q).
+each job file lists files or directories, one per line. job files are done
+in name order and deleted when done. names starting with '.' or ending with
+.tmp are ignored so jobs can be written there and renamed. a job named quit
+ends the loop.
 */
-void process_dir(char *dir)
+void process_spool(char *dir)
 {
 #if defined(WIN32) && defined(_UNICODE)
     wchar_t dir_w[FILENAME_MAX];
@@ -2310,82 +4148,95 @@ void process_dir(char *dir)
     char *dir_w = dir;
 #endif
 
-    _TDIR *dp = _topendir(dir_w);
-    if (NULL == dp) {
-        av_log(NULL, AV_LOG_ERROR, "\n%s: opendir failed: %s\n", dir, strerror(errno));
-        return;
-    }
-
-    /* read directory & sort */
-    struct _tdirent *d;
-    char **v = NULL;
-    size_t cnt = 0, vsize = 0;
-    while (1) {
-        errno = 0;
-        d = _treaddir(dp);
-        if (NULL == d) {
-            if (0 != errno) { // is this check good?
-                av_log(NULL, AV_LOG_ERROR, "\n%s: readdir failed: %s\n", dir, strerror(errno));
-                goto cleanup;
-            }
-            break;
-        }
-
-        if (_tcscmp(d->d_name, _TEXT(".")) == 0 || _tcscmp(d->d_name, _TEXT("..")) == 0) {
-            continue;
+    av_log(NULL, LOG_INFO, "%s: waiting for jobs in %s\n", gb_argv0, dir);
+    int quit = 0;
+    while (0 == quit) {
+        _TDIR *dp = _topendir(dir_w);
+        if (NULL == dp) {
+            av_log(NULL, AV_LOG_ERROR, "\n%s: opendir failed: %s\n", dir, strerror(errno));
+            return;
         }
 
+        /* read directory & sort */
+        struct _tdirent *d;
+        char **v = NULL;
+        size_t cnt = 0, vsize = 0;
+        while (NULL != (d = _treaddir(dp))) {
 #if defined(WIN32) && defined(_UNICODE)
-        char d_name_utf8[UTF8_FILENAME_SIZE];
-        WC_2_UTF8(d_name_utf8, d->d_name, UTF8_FILENAME_SIZE);
+            char d_name_utf8[UTF8_FILENAME_SIZE];
+            WC_2_UTF8(d_name_utf8, d->d_name, UTF8_FILENAME_SIZE);
 #else
-        char *d_name_utf8 = d->d_name;
+            char *d_name_utf8 = d->d_name;
 #endif
+            size_t len = strlen(d_name_utf8);
+            if ('.' == d_name_utf8[0] || (len >= 4 && 0 == strcmp(d_name_utf8 + len - 4, ".tmp"))) {
+                continue;
+            }
 
-        char child_utf8[UTF8_FILENAME_SIZE];
-        strcpy_va(child_utf8, 3, dir, "/", d_name_utf8);
+            char child_utf8[UTF8_FILENAME_SIZE];
+            strcpy_va(child_utf8, 3, dir, "/", d_name_utf8);
+            if (1 != is_reg(child_utf8)) {
+                continue;
+            }
 
-        if (1 != is_dir(child_utf8) && 1 != check_extension(child_utf8)) {
-            continue;
+            if (cnt == vsize) {
+                vsize = (0 == vsize) ? 50 : vsize * 2;
+                char **new = realloc(v, vsize * sizeof(*v));
+                if (NULL == new) {
+                    av_log(NULL, AV_LOG_ERROR, "\n%s: realloc failed: %s\n", dir, strerror(errno));
+                    break;
+                }
+                v = new;
+            }
+            char *vnew = strdup(child_utf8);
+            if (NULL == vnew) {
+                av_log(NULL, AV_LOG_ERROR, "\n%s: malloc failed: %s\n", dir, strerror(errno));
+                break;
+            }
+            v[cnt++] = vnew;
         }
-
-        if (cnt == vsize) {
-            char **new;
-            if (vsize == 0)
-                vsize = 50;
-            else
-                vsize *= 2;
-            new = realloc(v, vsize * sizeof(*v));
-            if (new == NULL) {
-                // mingw doesn't seem to set errno for memory functions
-                av_log(NULL, AV_LOG_ERROR, "\n%s: realloc failed: %s\n", dir, strerror(errno));
-                goto cleanup;
+        _tclosedir(dp);
+        qsort(v, cnt, sizeof(*v), alphasort);
+
+        /* process jobs */
+        size_t i;
+        for (i = 0; i < cnt && 0 == quit; i++) {
+            if (0 == strcmp(path_2_file(v[i]), "quit")) {
+                quit = 1;
+            } else {
+                av_log(NULL, AV_LOG_VERBOSE, "process_spool: job %s\n", v[i]);
+                process_job(v[i]);
+                if (gb_file_pool.nb_worker > 0) { // the job is done when its files are
+                    file_pool_wait(&gb_file_pool);
+                }
+            }
+#if defined(WIN32) && defined(_UNICODE)
+            wchar_t job_w[FILENAME_MAX];
+            UTF8_2_WC(job_w, v[i], FILENAME_MAX);
+#else
+            char *job_w = v[i];
+#endif
+            if (0 != _tunlink(job_w)) {
+                av_log(NULL, AV_LOG_ERROR, "\n%s: deleting job failed: %s; stopped\n", v[i], strerror(errno));
+                quit = 1; // would do the same job again
             }
-            v = new;
         }
+        while (cnt > 0)
+            free(v[--cnt]);
+        free(v);
 
-        char *vnew = malloc(strlen(child_utf8) + 1); // for '\0'
-        if (vnew == NULL) {
-            av_log(NULL, AV_LOG_ERROR, "\n%s: malloc failed: %s\n", dir, strerror(errno));
-            goto cleanup;
+        if (0 == quit && 0 == i) {
+#ifdef WIN32
+            Sleep(SPOOL_POLL * 1000);
+#else
+            sleep(SPOOL_POLL);
+#endif
         }
-        strcpy(vnew, child_utf8);
-        v[cnt++] = vnew;
-        //av_log(NULL, LOG_INFO, "process_dir added: %s\n", v[cnt-1]); // DEBUG
     }
-    qsort(v, cnt, sizeof(*v), alphasort);
-
-    /* process dirs & files */
-    process_loop(cnt, v);
-
-  cleanup:
-    while (cnt > 0)
-        free(v[--cnt]);
-    free(v);
-    _tclosedir(dp);
 }
 
 /*
+"-" reads file names from stdin
 */
 void process_loop(int n, char **files)
 {
@@ -2394,12 +4245,16 @@ void process_loop(int n, char **files)
         av_log(NULL, AV_LOG_VERBOSE, "process_loop: %s\n", files[i]);
         rem_trailing_slash(files[i]); //
 
-        if (is_dir(files[i])) { // directory
+        if (0 == strcmp(files[i], "-")) { // file names from stdin
+            process_stdin();
+        } else if (is_dir(files[i])) { // directory
             //av_log(NULL, LOG_INFO, "process_loop: %s is a DIR\n", files[i]); // DEBUG
             process_dir(files[i]);
+        } else if (gb_file_pool.nb_worker > 0) { // file workers
+            file_pool_add(&gb_file_pool, files[i]);
         } else { // not a directory
             //av_log(NULL, LOG_INFO, "process_loop: %s is not a DIR\n", files[i]); // DEBUG
-            make_thumbnail(files[i]);
+            thumbnail_file(files[i]);
         }
     }
 }
@@ -2684,8 +4539,10 @@ void usage()
     av_log(NULL, AV_LOG_ERROR, "  -i : info text off\n");
     av_log(NULL, AV_LOG_ERROR, "  -I : save individual shots too\n");
     av_log(NULL, AV_LOG_ERROR, "  -j %d : jpeg quality\n", GB_J_QUALITY);
+    av_log(NULL, AV_LOG_ERROR, "  -J %d : # of files thumbnailed at the same time; 1:off\n", GB_J_FILE);
     av_log(NULL, AV_LOG_ERROR, "  -k RRGGBB : background color (in hex)\n"); // backgroud color
     av_log(NULL, AV_LOG_ERROR, "  -L info_location[:time_location] : location of text\n     1=lower left, 2=lower right, 3=upper right, 4=upper left\n");
+    av_log(NULL, AV_LOG_ERROR, "  -m %d : # of threads decoding shots in seek mode; 1:off\n", GB_M_WORKER);
     av_log(NULL, AV_LOG_ERROR, "  -n : run at normal priority\n");
     av_log(NULL, AV_LOG_ERROR, "  -N info_suffix : save info text to a file with suffix\n");
     av_log(NULL, AV_LOG_ERROR, "  -o %s : output suffix\n", GB_O_SUFFIX);
@@ -2693,6 +4550,7 @@ void usage()
     av_log(NULL, AV_LOG_ERROR, "  -p : pause before exiting; default on in win32\n");
     av_log(NULL, AV_LOG_ERROR, "  -P : dont pause before exiting; override -p\n");
     //av_log(NULL, AV_LOG_ERROR, "  -q : to be done\n"); // quiet mode
+    av_log(NULL, AV_LOG_ERROR, "  -Q directory : batch mode; keep processing job files put in directory\n     each job lists files/dirs, one per line; a job named quit exits\n");
     av_log(NULL, AV_LOG_ERROR, "  -r %d : # of rows; >0:override -s\n", GB_R_ROW);
     av_log(NULL, AV_LOG_ERROR, "  -s %d : time step between each shot\n", GB_S_STEP);
     av_log(NULL, AV_LOG_ERROR, "  -t : time stamp off\n");
@@ -2700,6 +4558,7 @@ void usage()
     av_log(NULL, AV_LOG_ERROR, "  -v : verbose mode (debug)\n");
     av_log(NULL, AV_LOG_ERROR, "  -w %d : width of output image; 0:column * movie width\n", GB_W_WIDTH);
     av_log(NULL, AV_LOG_ERROR, "  -W : dont overwrite existing files, i.e. update mode\n");
+    av_log(NULL, AV_LOG_ERROR, "  -X index_file : skip files unchanged since listed in index_file\n");
     av_log(NULL, AV_LOG_ERROR, "  -z : always use seek mode\n");
     av_log(NULL, AV_LOG_ERROR, "  -Z : always use non-seek mode -- slower but more accurate timing\n");
     av_log(NULL, AV_LOG_ERROR, "examples:\n");
@@ -2710,6 +4569,8 @@ void usage()
     av_log(NULL, AV_LOG_ERROR, "  to save output files to writeable directory:\n    %s -O writeable /read/only/dir/infile.avi\n", gb_argv0);
     av_log(NULL, AV_LOG_ERROR, "  to get 2 columns in original movie size:\n    %s -c 2 -w 0 infile.avi\n", gb_argv0);
     av_log(NULL, AV_LOG_ERROR, "  to skip uninteresting shots, try:\n    %s -D 6 infile.avi\n", gb_argv0);
+    av_log(NULL, AV_LOG_ERROR, "  to read file names from stdin and only redo changed files:\n    %s -X mtn.idx -\n", gb_argv0);
+    av_log(NULL, AV_LOG_ERROR, "  to keep doing 4 files at a time from jobs put in a spool directory:\n    %s -J 4 -Q spool\n", gb_argv0);
 #ifdef WIN32
     av_log(NULL, AV_LOG_ERROR, "\nin windows, you can run %s from command prompt or drag files/dirs from\n", gb_argv0);
     av_log(NULL, AV_LOG_ERROR, "windows explorer and drop them on %s. you can change the default options\n", gb_argv0);
@@ -2754,7 +4615,7 @@ int main(int argc, char *argv[])
     /* get & check options */
     int parse_error = 0;
     int c;
-    while (-1 != (c = getopt(argc, argv, "a:b:B:c:C:D:e:E:f:F:g:h:iIj:k:L:nN:o:O:pPqr:s:tT:vVw:WzZ"))) {
+    while (-1 != (c = getopt(argc, argv, "a:b:B:c:C:D:e:E:f:F:g:h:iIj:J:k:L:m:nN:o:O:pPqQ:r:s:tT:vVw:WX:zZ"))) {
         switch (c) {
         double tmp_a_ratio = 0;
         case 'a':
@@ -2821,12 +4682,18 @@ int main(int argc, char *argv[])
         case 'j':
             parse_error += get_int_opt('j', &gb_j_quality, optarg, 1);
             break;
+        case 'J':
+            parse_error += get_int_opt('J', &gb_J_file, optarg, 1);
+            break;
         case 'k': // background color
             parse_error += get_color_opt('k', &gb_k_bcolor, optarg);
             break;
         case 'L':
             parse_error += get_location_opt('L', optarg);
             break;
+        case 'm':
+            parse_error += get_int_opt('m', &gb_m_worker, optarg, 1);
+            break;
         case 'n':
             gb_n_normal = 1; // normal priority
             break;
@@ -2849,6 +4716,9 @@ int main(int argc, char *argv[])
         case 'q':
             gb_q_quiet = 1; //quiet
             break;
+        case 'Q':
+            gb_Q_spool = optarg;
+            break;
         case 'r':
             parse_error += get_int_opt('r', &gb_r_row, optarg, 0);
             break;
@@ -2874,6 +4744,9 @@ int main(int argc, char *argv[])
         case 'W':
             gb_W_overwrite = 0;
             break;
+        case 'X':
+            gb_X_index = optarg;
+            break;
         case 'z':
             gb_z_seek = 1; // always seek mode
             break;
@@ -2886,7 +4759,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (optind == argc) {
+    if (optind == argc && NULL == gb_Q_spool) {
         av_log(NULL, AV_LOG_ERROR, "%s: no input files or directories specified\n", gb_argv0);
         parse_error += 1;
     }
@@ -2945,10 +4818,25 @@ int main(int argc, char *argv[])
         av_log_set_level(LOG_INFO);
     }
     //gdUseFontConfig(1); // set GD to use fontconfig patterns
+    lock_init();
+    gdFontCacheSetup(); // before the workers use the font cache
 
     signal(SIGSEGV, my_signal_handler);
+    if (gb_J_file > 1) {
+        int nb_worker = file_pool_start(&gb_file_pool, gb_J_file);
+        av_log(NULL, AV_LOG_VERBOSE, "%d file workers\n", nb_worker);
+    }
     /* process movie files */
     process_loop(argc - optind, argv + optind);
+    if (NULL != gb_Q_spool) {
+        process_spool(gb_Q_spool);
+    }
+    if (gb_file_pool.nb_worker > 0) {
+        file_pool_stop(&gb_file_pool);
+    }
+    if (NULL != gb_X_index) {
+        index_close();
+    }
 
   exit:
     // clean up